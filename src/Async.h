@@ -0,0 +1,281 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <type_traits>
+
+
+/*! \brief Coroutines on the Qt event loop and the global thread pool
+ *
+ * This namespace contains a small C++20 coroutine layer, used to write chains
+ * of background work as straight-line code instead of chains of signals and
+ * QFutureWatchers. A coroutine returns an Async::Task. It starts right away,
+ * on the thread of the caller, and typically looks like this.
+ *
+ * @code
+ * Async::Task MyObject::rebuild(QStringList fileNames, Async::CancellationToken token)
+ * {
+ *     auto data = co_await Async::inThreadPool(this, [fileNames]() { return read(fileNames); });
+ *     if (token.isCancelled()) {
+ *         co_return;
+ *     }
+ *     publish(data);
+ * }
+ * @endcode
+ *
+ * Each co_await runs its work elsewhere and resumes the coroutine on the
+ * thread of the context object, once the work has finished. Between two
+ * co_await, the coroutine can therefore use the context object without any
+ * locking. If the context object is destroyed while the coroutine is
+ * suspended, then the coroutine is destroyed without being resumed.
+ *
+ * Cancellation is cooperative: the coroutine checks a CancellationToken after
+ * every stage. Work that is already running in the thread pool is finished,
+ * but its result is ignored.
+ */
+
+namespace Async {
+
+/*! \brief Flag that tells a coroutine to stop at the next opportunity
+ *
+ * Copies of a token share the same flag, so the caller can keep one copy and
+ * hand another one to the coroutine. Tokens can be read and cancelled from
+ * any thread.
+ */
+
+class CancellationToken
+{
+public:
+    /*! \brief Cancel all copies of this token */
+    void cancel() const
+    {
+        m_cancelled->store(true, std::memory_order_relaxed);
+    }
+
+    /*! \brief Check if the token has been cancelled
+     *
+     * @returns True if cancel() has been called on any copy of the token
+     */
+    bool isCancelled() const
+    {
+        return m_cancelled->load(std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled {std::make_shared<std::atomic<bool>>(false)};
+};
+
+
+/*! \brief Return type of coroutines
+ *
+ * The coroutine starts immediately and runs independently of the Task, which
+ * can be discarded. The Task only gives access to a QFuture that finishes
+ * when the coroutine ends, either because it returned or because it was
+ * destroyed together with its context object. The future can be handed to
+ * code that expects one, such as the InitScheduler.
+ */
+
+class Task
+{
+public:
+    /*! \brief Promise type, as required by the C++ coroutine machinery */
+    struct promise_type
+    {
+        promise_type()
+        {
+            m_futureInterface.reportStarted();
+        }
+
+        ~promise_type()
+        {
+            m_futureInterface.reportFinished();
+        }
+
+        Q_DISABLE_COPY_MOVE(promise_type)
+
+        Task get_return_object()
+        {
+            return Task(m_futureInterface.future());
+        }
+
+        static std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        static std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        static void return_void()
+        {
+        }
+
+        // There is nobody to report exceptions to
+        static void unhandled_exception()
+        {
+            std::terminate();
+        }
+
+    private:
+        QFutureInterface<void> m_futureInterface;
+    };
+
+    /*! \brief Future of the coroutine
+     *
+     * @returns A future that finishes once the coroutine has ended
+     */
+    QFuture<void> future() const
+    {
+        return m_future;
+    }
+
+private:
+    explicit Task(QFuture<void> future)
+        : m_future(std::move(future))
+    {
+    }
+
+    QFuture<void> m_future;
+};
+
+
+/*! \brief Awaitable that suspends a coroutine until a QFuture has finished
+ *
+ * Use Async::await() or Async::inThreadPool() to construct instances.
+ */
+
+template<typename T>
+class FutureAwaiter
+{
+public:
+    FutureAwaiter(QObject* context, QFuture<T> future)
+        : m_context(context),
+          m_future(std::move(future))
+    {
+    }
+
+    bool await_ready() const
+    {
+        return m_future.isFinished();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) const
+    {
+        // The watcher lives on the thread of the context object, and so does
+        // the resumption. If the watcher is destroyed together with the context
+        // object, the slot is destroyed without being called and the Resumer
+        // destroys the coroutine.
+        auto* watcher = new QFutureWatcher<T>(m_context);
+        auto resumer = std::make_shared<Resumer>(handle);
+        QObject::connect(watcher, &QFutureWatcherBase::finished, watcher, [watcher, resumer]() {
+            watcher->deleteLater();
+            resumer->resume();
+        });
+        watcher->setFuture(m_future);
+    }
+
+    T await_resume() const
+    {
+        if constexpr (!std::is_void_v<T>) {
+            return m_future.result();
+        }
+    }
+
+private:
+    // Resumes the coroutine once, or destroys it if it was never resumed
+    class Resumer
+    {
+    public:
+        explicit Resumer(std::coroutine_handle<> handle)
+            : m_handle(handle)
+        {
+        }
+
+        ~Resumer()
+        {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+        }
+
+        Q_DISABLE_COPY_MOVE(Resumer)
+
+        void resume()
+        {
+            auto handle = m_handle;
+            m_handle = nullptr;
+            if (handle) {
+                handle.resume();
+            }
+        }
+
+    private:
+        std::coroutine_handle<> m_handle;
+    };
+
+    QObject* m_context;
+    QFuture<T> m_future;
+};
+
+
+/*! \brief Wait for a future
+ *
+ * @param context Object on whose thread the coroutine is resumed. This is
+ * usually the object that runs the coroutine.
+ *
+ * @param future Future to wait for
+ *
+ * @returns Awaitable whose result is the result of the future
+ */
+template<typename T>
+FutureAwaiter<T> await(QObject* context, QFuture<T> future)
+{
+    return {context, std::move(future)};
+}
+
+
+/*! \brief Run a function in the global thread pool
+ *
+ * @param context Object on whose thread the coroutine is resumed. This is
+ * usually the object that runs the coroutine.
+ *
+ * @param function Function to run. It must not touch the context object, or
+ * anything else that is not thread-safe, and should therefore capture its
+ * input by value.
+ *
+ * @returns Awaitable whose result is the return value of the function
+ */
+template<typename Function>
+auto inThreadPool(QObject* context, Function function) -> FutureAwaiter<std::invoke_result_t<Function>>
+{
+    return {context, QtConcurrent::run(std::move(function))};
+}
+
+}
@@ -80,7 +80,7 @@ void DemoRunner::run()
 
     // Set up traffic simulator
     auto* trafficSimulator = new Traffic::TrafficDataSource_Simulate();
-    GlobalObject::trafficDataProvider()->addDataSource( trafficSimulator );
+    GlobalObject::trafficDataProvider()->addDataSource( trafficSimulator, false );
     trafficSimulator->connectToTrafficReceiver();
     delay(10s);
 
@@ -159,15 +159,13 @@ void DemoRunner::run()
         flightMap->setProperty("followGPS", true);
         GlobalObject::settings()->setMapBearingPolicy(Settings::TTUp);
         QGeoCoordinate trafficPosition(48.0103, 7.7952, 540);
-        QGeoPositionInfo trafficInfo;
-        trafficInfo.setCoordinate(trafficPosition);
-        trafficInfo.setAttribute(QGeoPositionInfo::Direction, 160);
-        trafficInfo.setAttribute(QGeoPositionInfo::GroundSpeed, Units::Speed::fromKN(70).toMPS() );
-        trafficInfo.setAttribute(QGeoPositionInfo::VerticalSpeed, -2);
-        trafficInfo.setTimestamp( QDateTime::currentDateTimeUtc() );
+        Positioning::PositionInfo trafficInfo(trafficPosition, QDateTime::currentDateTimeUtc());
+        trafficInfo.setDirection( Units::Angle::fromDEG(160) );
+        trafficInfo.setGroundSpeed( Units::Speed::fromKN(70) );
+        trafficInfo.setVerticalSpeed( Units::Speed::fromMPS(-2) );
         auto* trafficFactor1 = new Traffic::TrafficFactor_WithPosition(this);
         trafficFactor1->setAlarmLevel(0);
-        trafficFactor1->setID("newID");
+        trafficFactor1->setID(Traffic::TargetID(0x3D2A51, Traffic::TargetID::FLARM));
         trafficFactor1->setType(Traffic::TrafficFactor_Abstract::Aircraft);
         trafficFactor1->setPositionInfo(trafficInfo);
         trafficFactor1->setHDist( Units::Distance::fromM(1000) );
@@ -176,7 +174,7 @@ void DemoRunner::run()
 
         auto* trafficFactor2 = new Traffic::TrafficFactor_DistanceOnly(this);
         trafficFactor2->setAlarmLevel(1);
-        trafficFactor2->setID("newID");
+        trafficFactor2->setID(Traffic::TargetID(0x3D2A51, Traffic::TargetID::FLARM));
         trafficFactor2->setHDist( Units::Distance::fromM(1000) );
         trafficFactor2->setType( Traffic::TrafficFactor_Abstract::Aircraft );
         trafficFactor2->setCallSign({});
@@ -24,18 +24,24 @@
 
 #include "DemoRunner.h"
 #include "GlobalObject.h"
+#include "InitScheduler.h"
 #include "Librarian.h"
+#include "Metrics.h"
 #include "MobileAdaptor.h"
+#include "Profiler.h"
 #include "Settings.h"
+#include "Tracer.h"
 #include "dataManagement/DataManager.h"
 #include "dataManagement/SSLErrorHandler.h"
 #include "geomaps/GeoMapProvider.h"
 #include "navigation/Navigator.h"
 #include "platform/Notifier.h"
+#include "positioning/FlightRecorder.h"
 #include "positioning/PositionProvider.h"
 #include "traffic/FlarmnetDB.h"
 #include "traffic/PasswordDB.h"
 #include "traffic/TrafficDataProvider.h"
+#include "ui/RenderBudget.h"
 #include "weather/WeatherDataProvider.h"
 
 bool isConstructing {false};
@@ -44,16 +50,22 @@ QPointer<DataManagement::DataManager> g_dataManager {};
 QPointer<DataManagement::SSLErrorHandler> g_sslErrorHandler {};
 QPointer<DemoRunner> g_demoRunner {};
 QPointer<Traffic::FlarmnetDB> g_flarmnetDB {};
+QPointer<Positioning::FlightRecorder> g_flightRecorder {};
 QPointer<GeoMaps::GeoMapProvider> g_geoMapProvider {};
+QPointer<InitScheduler> g_initScheduler {};
 QPointer<Librarian> g_librarian {};
+QPointer<Metrics> g_metrics {};
 QPointer<MobileAdaptor> g_mobileAdaptor {};
 QPointer<Navigation::Navigator> g_navigator {};
 QPointer<QNetworkAccessManager> g_networkAccessManager {};
 QPointer<Platform::Notifier> g_notifier {};
 QPointer<Traffic::PasswordDB> g_passwordDB {};
 QPointer<Positioning::PositionProvider> g_positionProvider {};
+QPointer<Profiler> g_profiler {};
+QPointer<Ui::RenderBudget> g_renderBudget {};
 QPointer<Settings> g_settings {};
 QPointer<Traffic::TrafficDataProvider> g_trafficDataProvider {};
+QPointer<Tracer> g_tracer {};
 QPointer<Weather::WeatherDataProvider> g_weatherDataProvider {};
 
 
@@ -63,6 +75,7 @@ template<typename T> auto GlobalObject::allocateInternal(QPointer<T>& pointer) -
     Q_ASSERT( !isConstructing );
 
     if (pointer.isNull()) {
+        TRACE_SCOPE(T::staticMetaObject.className());
         isConstructing = true;
         pointer = new T( QCoreApplication::instance() );
         isConstructing = false;
@@ -100,6 +113,12 @@ auto GlobalObject::flarmnetDB() -> Traffic::FlarmnetDB*
 }
 
 
+auto GlobalObject::flightRecorder() -> Positioning::FlightRecorder*
+{
+    return allocateInternal<Positioning::FlightRecorder>(g_flightRecorder);
+}
+
+
 auto GlobalObject::geoMapProvider() -> GeoMaps::GeoMapProvider*
 {
     return allocateInternal<GeoMaps::GeoMapProvider>(g_geoMapProvider);
@@ -118,12 +137,24 @@ auto GlobalObject::demoRunner() -> DemoRunner*
 }
 
 
+auto GlobalObject::initScheduler() -> InitScheduler*
+{
+    return allocateInternal<InitScheduler>(g_initScheduler);
+}
+
+
 auto GlobalObject::librarian() -> Librarian*
 {
     return allocateInternal<Librarian>(g_librarian);
 }
 
 
+auto GlobalObject::metrics() -> Metrics*
+{
+    return allocateInternal<Metrics>(g_metrics);
+}
+
+
 auto GlobalObject::mobileAdaptor() -> MobileAdaptor*
 {
     return allocateInternal<MobileAdaptor>(g_mobileAdaptor);
@@ -160,6 +191,18 @@ auto GlobalObject::positionProvider() -> Positioning::PositionProvider*
 }
 
 
+auto GlobalObject::profiler() -> Profiler*
+{
+    return allocateInternal<Profiler>(g_profiler);
+}
+
+
+auto GlobalObject::renderBudget() -> Ui::RenderBudget*
+{
+    return allocateInternal<Ui::RenderBudget>(g_renderBudget);
+}
+
+
 auto GlobalObject::settings() -> Settings*
 {
     return allocateInternal<Settings>(g_settings);
@@ -172,6 +215,12 @@ auto GlobalObject::sslErrorHandler() -> DataManagement::SSLErrorHandler*
 }
 
 
+auto GlobalObject::tracer() -> Tracer*
+{
+    return allocateInternal<Tracer>(g_tracer);
+}
+
+
 auto GlobalObject::trafficDataProvider() -> Traffic::TrafficDataProvider*
 {
     return allocateInternal<Traffic::TrafficDataProvider>(g_trafficDataProvider);
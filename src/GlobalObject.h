@@ -23,10 +23,14 @@
 #include <QObject>
 
 class DemoRunner;
+class InitScheduler;
 class Librarian;
+class Metrics;
 class MobileAdaptor;
+class Profiler;
 class QNetworkAccessManager;
 class Settings;
+class Tracer;
 
 namespace DataManagement {
 class DataManager;
@@ -52,9 +56,14 @@ class Notifier;
 }
 
 namespace Positioning {
+class FlightRecorder;
 class PositionProvider;
 }
 
+namespace Ui {
+class RenderBudget;
+}
+
 namespace Weather {
 class WeatherDataProvider;
 }
@@ -126,18 +135,36 @@ class GlobalObject : public QObject
      */
     Q_INVOKABLE static Traffic::FlarmnetDB* flarmnetDB();
 
+    /*! \brief Pointer to appplication-wide static FlightRecorder instance
+     *
+     * @returns Pointer to appplication-wide static instance.
+     */
+    Q_INVOKABLE static Positioning::FlightRecorder* flightRecorder();
+
     /*! \brief Pointer to appplication-wide static GeoMaps::GeoMapProvider instance
      *
      * @returns Pointer to appplication-wide static instance.
      */
     Q_INVOKABLE static GeoMaps::GeoMapProvider* geoMapProvider();
 
+    /*! \brief Pointer to appplication-wide static InitScheduler instance
+     *
+     * @returns Pointer to appplication-wide static instance.
+     */
+    Q_INVOKABLE static InitScheduler* initScheduler();
+
     /*! \brief Pointer to appplication-wide static librarian instance
      *
      * @returns Pointer to appplication-wide static instance.
      */
     Q_INVOKABLE static Librarian* librarian();
 
+    /*! \brief Pointer to appplication-wide static Metrics instance
+     *
+     * @returns Pointer to appplication-wide static instance.
+     */
+    Q_INVOKABLE static Metrics* metrics();
+
     /*! \brief Pointer to appplication-wide static MobileAdaptor instance
      *
      * @returns Pointer to appplication-wide static instance.
@@ -162,6 +189,18 @@ class GlobalObject : public QObject
      */
     Q_INVOKABLE static Positioning::PositionProvider* positionProvider();
 
+    /*! \brief Pointer to appplication-wide static Profiler instance
+     *
+     * @returns Pointer to appplication-wide static instance.
+     */
+    Q_INVOKABLE static Profiler* profiler();
+
+    /*! \brief Pointer to appplication-wide static RenderBudget instance
+     *
+     * @returns Pointer to appplication-wide static instance.
+     */
+    Q_INVOKABLE static Ui::RenderBudget* renderBudget();
+
     /*! \brief Pointer to appplication-wide static notification manager instance
      *
      * @returns Pointer to appplication-wide static instance.
@@ -186,6 +225,12 @@ class GlobalObject : public QObject
      */
     Q_INVOKABLE static DataManagement::SSLErrorHandler* sslErrorHandler();
 
+    /*! \brief Pointer to appplication-wide static Tracer instance
+     *
+     * @returns Pointer to appplication-wide static instance.
+     */
+    Q_INVOKABLE static Tracer* tracer();
+
     /*! \brief Pointer to appplication-wide static TrafficDataProvider instance
      *
      * @returns Pointer to appplication-wide static instance.
@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QDebug>
+#include <QFutureWatcher>
+
+#include "InitScheduler.h"
+#include "Tracer.h"
+
+
+InitScheduler::InitScheduler(QObject *parent) : GlobalObject(parent)
+{
+    m_scheduleTimer.setSingleShot(true);
+    connect(&m_scheduleTimer, &QTimer::timeout, this, &InitScheduler::startReadyTasks);
+}
+
+
+void InitScheduler::addTask(const char* name, const QList<QByteArray>& dependencies, const std::function<QFuture<void>()>& start, const std::function<void()>& finish)
+{
+    // Paranoid safety checks
+    if (m_tasks.contains(name)) {
+        qWarning() << "InitScheduler: task" << name << "registered twice";
+        return;
+    }
+
+    Task task;
+    task.name = name;
+    task.dependencies = dependencies;
+    task.start = start;
+    task.finish = finish;
+    m_tasks.insert(name, task);
+    m_scheduleTimer.start(0);
+}
+
+
+auto InitScheduler::isFinished(const QByteArray& name) const -> bool
+{
+    auto it = m_tasks.constFind(name);
+    return (it != m_tasks.constEnd()) && (it->state == Task::Finished);
+}
+
+
+void InitScheduler::startReadyTasks()
+{
+    // Collect the tasks first: start functions may register new tasks
+    QList<QByteArray> readyTasks;
+    for(auto it = m_tasks.constBegin(); it != m_tasks.constEnd(); ++it) {
+        if (it->state != Task::Waiting) {
+            continue;
+        }
+        bool ready = true;
+        for(const auto& dependency : it->dependencies) {
+            if (!isFinished(dependency)) {
+                ready = false;
+                break;
+            }
+        }
+        if (ready) {
+            readyTasks += it.key();
+        }
+    }
+
+    foreach(auto name, readyTasks) {
+        auto& task = m_tasks[name];
+        task.state = Task::Running;
+        task.startTime = Tracer::elapsed();
+        // Copy the start function: it may register new tasks, which
+        // invalidates the reference
+        auto start = task.start;
+        auto future = start ? start() : QFuture<void>();
+
+        if (future.isFinished()) {
+            onTaskDone(name);
+            continue;
+        }
+        auto* watcher = new QFutureWatcher<void>(this);
+        connect(watcher, &QFutureWatcher<void>::finished, this, [this, watcher, name]() {
+            watcher->deleteLater();
+            onTaskDone(name);
+        });
+        watcher->setFuture(future);
+    }
+}
+
+
+void InitScheduler::onTaskDone(const QByteArray& name)
+{
+    // The finish function may register new tasks, so that references into
+    // m_tasks are not stable. Copy what we need.
+    auto finish = m_tasks[name].finish;
+    if (finish) {
+        finish();
+    }
+
+    auto& task = m_tasks[name];
+    task.state = Task::Finished;
+#if defined(ENROUTE_TRACING)
+    Tracer::record(task.name, task.startTime, Tracer::elapsed());
+#endif
+    emit taskFinished(name);
+    m_scheduleTimer.start(0);
+}
@@ -0,0 +1,130 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QFuture>
+#include <QHash>
+#include <QTimer>
+#include <functional>
+
+#include "GlobalObject.h"
+
+
+/*! \brief Runs initialization tasks of the global objects in parallel
+ *
+ * Several global objects need to do expensive work when the app starts, such
+ * as reading the catalogue of maps, reading the geoid, building the aviation
+ * data or mapping the Flarmnet database. Much of this work is independent.
+ * This class runs the work on the global thread pool, while respecting the
+ * dependencies between the tasks.
+ *
+ * A task is registered with addTask(), which names the task and the tasks it
+ * depends on. Once all dependencies have finished, the scheduler calls the
+ * start function of the task on the GUI thread. The start function should do
+ * little more than collect the input data and launch the actual work with
+ * QtConcurrent::run(), returning the future. Once the future has finished,
+ * the finish function is called on the GUI thread, to do the QObject wiring
+ * with the result. Only then do tasks that depend on it start.
+ *
+ * Dependencies that have not been registered, or have not finished yet, are
+ * waited for; tasks may therefore be registered in any order. In builds
+ * with tracing, every task is recorded as a span from start to finish.
+ */
+
+class InitScheduler : public GlobalObject
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Standard constructor
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit InitScheduler(QObject* parent = nullptr);
+
+    /*! \brief Standard destructor */
+    ~InitScheduler() override = default;
+
+
+    //
+    // Methods
+    //
+
+    /*! \brief Register a task
+     *
+     * @param name Name of the task. The string is not copied and must remain
+     * valid for the lifetime of the program, as string literals do. Names of
+     * tasks must be unique; tasks with a name that has already been
+     * registered are ignored.
+     *
+     * @param dependencies Names of the tasks that must finish before this
+     * task starts
+     *
+     * @param start Function that starts the task, called on the GUI thread.
+     * The task is considered done once the future returned has finished.
+     * Return a default-constructed future if there is nothing to wait for.
+     *
+     * @param finish Function called on the GUI thread when the task is done,
+     * or an empty function
+     */
+    void addTask(const char* name, const QList<QByteArray>& dependencies, const std::function<QFuture<void>()>& start, const std::function<void()>& finish = {});
+
+    /*! \brief Check if a task has finished
+     *
+     * @param name Name of the task
+     *
+     * @returns True if the task has been registered and has finished
+     */
+    bool isFinished(const QByteArray& name) const;
+
+signals:
+    /*! \brief Emitted when a task has finished
+     *
+     * This signal is emitted after the finish function of the task has
+     * returned.
+     *
+     * @param name Name of the task
+     */
+    void taskFinished(const QByteArray& name);
+
+private:
+    Q_DISABLE_COPY_MOVE(InitScheduler)
+
+    // Starts all tasks that are waiting and whose dependencies have finished
+    void startReadyTasks();
+
+    // Calls the finish function of the task and starts dependent tasks
+    void onTaskDone(const QByteArray& name);
+
+    struct Task {
+        const char* name {nullptr};
+        QList<QByteArray> dependencies;
+        std::function<QFuture<void>()> start;
+        std::function<void()> finish;
+        enum State {Waiting, Running, Finished} state {Waiting};
+        qint64 startTime {0};
+    };
+
+    QHash<QByteArray, Task> m_tasks;
+
+    // Zero-interval timer that coalesces calls to startReadyTasks()
+    QTimer m_scheduleTimer;
+};
@@ -18,12 +18,92 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include <algorithm>
+
 #include "Librarian.h"
 
+#include <QDataStream>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
 #include <QNetworkAccessManager>
+#include <QSaveFile>
+#include <QSet>
 #include <QStandardPaths>
 #include <QtGlobal>
 
+#include "GlobalObject.h"
+#include "Settings.h"
+#include "geomaps/Waypoint.h"
+#include "units/Distance.h"
+
+
+namespace {
+
+// Magic number and format version of the flight route index. Increase the
+// version whenever the format changes.
+const quint32 indexMagic = 0x454E524C; // "ENRL"
+const quint32 indexVersion = 1;
+
+// Texts returned by getStringFromRessource, together with their hashes. Most
+// of these texts are assembled from many translated pieces or read from
+// files, so the cache keeps every text until the translators change.
+class RessourceCache
+{
+public:
+    struct Entry {
+        QString string;
+        uint hash {0};
+    };
+
+    Entry lookup(const QString &name)
+    {
+        QMutexLocker locker(&m_mutex);
+
+        auto generation = Settings::translatorGenerationStatic();
+        if (generation != m_generation) {
+            m_entries.clear();
+            m_generation = generation;
+        }
+
+        auto iterator = m_entries.constFind(name);
+        if (iterator == m_entries.constEnd()) {
+            Entry entry;
+            entry.string = Librarian::assembleStringFromRessource(name);
+            entry.hash = qHash(entry.string, 0);
+            iterator = m_entries.insert(name, entry);
+        }
+        return *iterator;
+    }
+
+private:
+    QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    int m_generation {-1};
+};
+
+RessourceCache ressourceCache;
+
+// Removes all characters except ASCII letters and digits
+auto removeSpecialChars(const QString &string) -> QString
+{
+    QString result;
+    result.reserve(string.size());
+    for(auto character : string) {
+        auto unicode = character.unicode();
+        if (((unicode >= 'a') && (unicode <= 'z')) ||
+                ((unicode >= 'A') && (unicode <= 'Z')) ||
+                ((unicode >= '0') && (unicode <= '9'))) {
+            result.append(character);
+        }
+    }
+    return result;
+}
+
+}
+
+
 Librarian::Librarian(QObject *parent) : QObject(parent)
 {
     auto libraryPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)+"/flight routes";
@@ -43,10 +123,35 @@ Librarian::Librarian(QObject *parent) : QObject(parent)
         }
     }
     d.rmdir(oldlibraryPath);
+
+    // Set up the flight route index
+    auto cachePath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(cachePath);
+    flightRouteIndexFileName = cachePath+"/flightRouteIndex.dat";
+    loadFlightRouteIndex();
+    updateFlightRouteIndex();
+
+    flightRouteIndexTimer.setSingleShot(true);
+    flightRouteIndexTimer.setInterval(200);
+    connect(&flightRouteIndexTimer, &QTimer::timeout, this, &Librarian::updateFlightRouteIndex);
+    connect(&flightRouteLibraryWatcher, &QFileSystemWatcher::directoryChanged, &flightRouteIndexTimer, qOverload<>(&QTimer::start));
+    flightRouteLibraryWatcher.addPath(libraryPath);
 }
 
 
 auto Librarian::getStringFromRessource(const QString &name) -> QString
+{
+    return ressourceCache.lookup(name).string;
+}
+
+
+auto Librarian::getStringHashFromRessource(const QString &name) -> uint
+{
+    return ressourceCache.lookup(name).hash;
+}
+
+
+auto Librarian::assembleStringFromRessource(const QString &name) -> QString
 {
 
     if (name == ":text/authors.html") {
@@ -290,12 +395,6 @@ auto Librarian::getStringFromRessource(const QString &name) -> QString
 }
 
 
-auto Librarian::getStringHashFromRessource(const QString &name) -> uint
-{
-    return qHash(getStringFromRessource(name), 0);
-}
-
-
 auto Librarian::flightRouteExists(const QString &baseName) const -> bool
 {
     return QFile::exists(flightRouteFullPath(baseName));
@@ -317,36 +416,73 @@ auto Librarian::flightRouteGet(const QString &baseName) const -> QObject *
 }
 
 
+auto Librarian::flightRouteBoundingRectangle(const QString &baseName) const -> QGeoRectangle
+{
+    auto iterator = flightRouteIndex.constFind(baseName);
+    if (iterator == flightRouteIndex.constEnd()) {
+        return {};
+    }
+    return iterator->boundingRectangle;
+}
+
+
 auto Librarian::flightRouteFullPath(const QString &baseName) const -> QString
 {
     return flightRouteLibraryDir.path()+"/"+baseName+".geojson";
 }
 
 
-void Librarian::flightRouteRemove(const QString &baseName) const
+void Librarian::flightRouteRemove(const QString &baseName)
 {
     QFile::remove(flightRouteFullPath(baseName));
+    updateFlightRouteIndex();
 }
 
 
-void Librarian::flightRouteRename(const QString &oldName, const QString &newName) const
+void Librarian::flightRouteRename(const QString &oldName, const QString &newName)
 {
     QFile::rename(flightRouteFullPath(oldName), flightRouteFullPath(newName));
+    updateFlightRouteIndex();
 }
 
 
 auto Librarian::flightRoutes(const QString &filter) -> QStringList
 {
-    QStringList filterList;
-    filterList << "*.geojson";
+    QString simplifiedFilter = simplifySpecialChars(filter);
+    if (simplifiedFilter.isEmpty()) {
+        return flightRouteNames;
+    }
+
+    QStringList result;
+    foreach(auto name, flightRouteNames) {
+        if (flightRouteIndex.value(name).simplifiedName.contains(simplifiedFilter, Qt::CaseInsensitive)) {
+            result << name;
+        }
+    }
+    return result;
+}
 
-    auto fileNames = flightRouteLibraryDir.entryList(filterList);
 
-    QStringList fileBaseNames;
-    foreach(auto fileName, fileNames)
-        fileBaseNames << fileName.section('.', 0, -2);
+auto Librarian::flightRouteSummary(const QString &baseName) const -> QString
+{
+    auto iterator = flightRouteIndex.constFind(baseName);
+    if (iterator == flightRouteIndex.constEnd()) {
+        return {};
+    }
 
-    return permissiveFilter(fileBaseNames, filter);
+    QString result;
+    if (iterator->numberOfWaypoints > 1) {
+        result += QStringLiteral("%1 → %2 • ").arg(iterator->firstWaypointName, iterator->lastWaypointName);
+    } else if (iterator->numberOfWaypoints == 1) {
+        result += QStringLiteral("%1 • ").arg(iterator->firstWaypointName);
+    }
+    auto distance = Units::Distance::fromM(iterator->distanceInM);
+    if (GlobalObject::settings()->useMetricUnits()) {
+        result += tr("%1&nbsp;km").arg(distance.toKM(), 0, 'f', 1);
+    } else {
+        result += tr("%1&nbsp;nm").arg(distance.toNM(), 0, 'f', 1);
+    }
+    return result;
 }
 
 
@@ -366,11 +502,188 @@ auto Librarian::permissiveFilter(const QStringList &inputStrings, const QString
 
 auto Librarian::simplifySpecialChars(const QString &string) -> QString
 {
-    QString cacheString = simplifySpecialChars_cache[string];
-    if (!cacheString.isEmpty()) {
-        return cacheString;
+    // ASCII strings are invariant under normalization, so only the special
+    // characters need to be removed. That is cheaper than a lookup in the memo
+    // table, so ASCII strings are never stored there.
+    auto isASCII = std::all_of(string.cbegin(), string.cend(), [](QChar character) { return character.unicode() < 0x80; });
+    if (isASCII) {
+        return removeSpecialChars(string);
+    }
+
+    auto iterator = simplifySpecialChars_cache.constFind(string);
+    if (iterator != simplifySpecialChars_cache.constEnd()) {
+        return *iterator;
+    }
+
+    // Keep the memo table bounded. Names seen in one session rarely exceed the
+    // limit, so simply starting afresh is good enough.
+    if (simplifySpecialChars_cache.size() >= simplifySpecialChars_cacheSize) {
+        simplifySpecialChars_cache.clear();
+    }
+    auto result = removeSpecialChars(string.normalized(QString::NormalizationForm_KD));
+    simplifySpecialChars_cache.insert(string, result);
+    return result;
+}
+
+
+auto Librarian::indexFlightRoute(const QString &fileName, FlightRouteIndexEntry &entry) -> bool
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QJsonParseError parseError{};
+    auto document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        return false;
+    }
+
+    // This mirrors FlightRoute::loadFromGeoJSON(), but avoids the construction
+    // of a FlightRoute with all its legs
+    QVector<GeoMaps::Waypoint> waypoints;
+    auto label = [](const GeoMaps::Waypoint& waypoint) {
+        return waypoint.ICAOCode().isEmpty() ? waypoint.name() : waypoint.ICAOCode();
+    };
+    foreach(auto value, document.object()["features"].toArray()) {
+        auto waypoint = GeoMaps::Waypoint(value.toObject());
+        if (!waypoint.isValid()) {
+            return false;
+        }
+        waypoints.append(waypoint);
+    }
+
+    entry.boundingRectangle = QGeoRectangle();
+    entry.numberOfWaypoints = waypoints.size();
+    entry.distanceInM = 0.0;
+    entry.firstWaypointName.clear();
+    entry.lastWaypointName.clear();
+    if (waypoints.isEmpty()) {
+        return true;
+    }
+
+    entry.firstWaypointName = label(waypoints.constFirst());
+    entry.lastWaypointName = label(waypoints.constLast());
+    entry.boundingRectangle.setTopLeft(waypoints[0].coordinate());
+    entry.boundingRectangle.setBottomRight(waypoints[0].coordinate());
+    for(int i=1; i<waypoints.size(); i++) {
+        entry.boundingRectangle.extendRectangle(waypoints[i].coordinate());
+        entry.distanceInM += waypoints[i-1].coordinate().distanceTo(waypoints[i].coordinate());
+    }
+    return true;
+}
+
+
+void Librarian::loadFlightRouteIndex()
+{
+    QFile file(flightRouteIndexFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 numEntries = 0;
+    in >> magic >> version >> numEntries;
+    if ((in.status() != QDataStream::Ok) || (magic != indexMagic) || (version != indexVersion)) {
+        return;
+    }
+
+    QHash<QString, FlightRouteIndexEntry> newIndex;
+    for(quint32 i=0; (i<numEntries) && (in.status() == QDataStream::Ok); i++) {
+        QString baseName;
+        FlightRouteIndexEntry entry;
+        double top = 0.0;
+        double left = 0.0;
+        double bottom = 0.0;
+        double right = 0.0;
+        qint32 numberOfWaypoints = 0;
+        in >> baseName >> entry.fileSize >> entry.lastModified >> top >> left >> bottom >> right
+           >> numberOfWaypoints >> entry.distanceInM >> entry.firstWaypointName >> entry.lastWaypointName;
+        entry.numberOfWaypoints = numberOfWaypoints;
+        if (numberOfWaypoints > 0) {
+            entry.boundingRectangle = QGeoRectangle(QGeoCoordinate(top, left), QGeoCoordinate(bottom, right));
+        }
+        entry.simplifiedName = simplifySpecialChars(baseName);
+        newIndex.insert(baseName, entry);
+    }
+    if (in.status() != QDataStream::Ok) {
+        return;
+    }
+    flightRouteIndex = newIndex;
+}
+
+
+void Librarian::saveFlightRouteIndex() const
+{
+    QSaveFile file(flightRouteIndexFileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+
+    out << indexMagic << indexVersion << static_cast<quint32>(flightRouteIndex.size());
+    for(auto iterator = flightRouteIndex.constBegin(); iterator != flightRouteIndex.constEnd(); ++iterator) {
+        const auto& rect = iterator->boundingRectangle;
+        out << iterator.key() << iterator->fileSize << iterator->lastModified
+            << rect.topLeft().latitude() << rect.topLeft().longitude()
+            << rect.bottomRight().latitude() << rect.bottomRight().longitude()
+            << static_cast<qint32>(iterator->numberOfWaypoints) << iterator->distanceInM
+            << iterator->firstWaypointName << iterator->lastWaypointName;
+    }
+    if (out.status() == QDataStream::Ok) {
+        file.commit();
+    }
+}
+
+
+void Librarian::updateFlightRouteIndex()
+{
+    bool changed = false;
+
+    // Find new and modified files
+    QSet<QString> baseNames;
+    foreach(auto fileInfo, flightRouteLibraryDir.entryInfoList(QStringList("*.geojson"), QDir::Files)) {
+        auto baseName = fileInfo.completeBaseName();
+        auto lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+        baseNames.insert(baseName);
+
+        auto iterator = flightRouteIndex.constFind(baseName);
+        if ((iterator != flightRouteIndex.constEnd()) &&
+                (iterator->fileSize == fileInfo.size()) &&
+                (iterator->lastModified == lastModified)) {
+            continue;
+        }
+
+        FlightRouteIndexEntry entry;
+        entry.fileSize = fileInfo.size();
+        entry.lastModified = lastModified;
+        entry.simplifiedName = simplifySpecialChars(baseName);
+        indexFlightRoute(fileInfo.filePath(), entry);
+        flightRouteIndex.insert(baseName, entry);
+        changed = true;
+    }
+
+    // Forget files that no longer exist
+    for(auto iterator = flightRouteIndex.begin(); iterator != flightRouteIndex.end(); ) {
+        if (baseNames.contains(iterator.key())) {
+            ++iterator;
+        } else {
+            iterator = flightRouteIndex.erase(iterator);
+            changed = true;
+        }
+    }
+
+    if (!changed && (flightRouteNames.size() == flightRouteIndex.size())) {
+        return;
     }
 
-    QString normalizedString = string.normalized(QString::NormalizationForm_KD);
-    return normalizedString.remove(specialChars);
+    flightRouteNames = flightRouteIndex.keys();
+    std::sort(flightRouteNames.begin(), flightRouteNames.end(), [](const QString& a, const QString& b) {
+        return QString::compare(a, b, Qt::CaseInsensitive) < 0;
+    });
+    saveFlightRouteIndex();
+    emit flightRoutesChanged();
 }
@@ -15,8 +15,10 @@
 #pragma once
 
 #include <QDir>
-#include <QRegularExpression>
+#include <QFileSystemWatcher>
+#include <QGeoRectangle>
 #include <QSettings>
+#include <QTimer>
 
 #include "navigation/FlightRoute.h"
 
@@ -25,6 +27,14 @@
   This simple class manage libraries of flight routes and text assets, and
   exposes these objects to QML.
 
+  To keep the flight route library responsive with hundreds of routes, the
+  class maintains an index of the library. For each route, the index stores
+  the simplified name used for filtering, the bounding rectangle and the data
+  needed for a short summary, together with the file size and modification
+  time. A QFileSystemWatcher keeps the index up to date, and the index is
+  stored in the cache directory, so that only new or modified files need to be
+  parsed when the app starts.
+
  */
 
 class Librarian : public QObject {
@@ -54,6 +64,9 @@ public:
      * - ":text/whatsnew.html" A text that describes new features in the current
      *   program version
      *
+     * The texts are assembled only once and cached until the translators are
+     * changed.
+     *
      * @param name Name of the file in the QRessource, such as
      * ":text/bugReport.html"
      *
@@ -65,7 +78,7 @@ public:
      *
      * This method reads a string from a file stored in the QRessource
      * system. The method expects that the file contains a string in UTF8
-     * encoding.
+     * encoding. The hash is computed once, together with the cached string.
      *
      * @param name Name of the file in the QRessource, such as ":text/bugReport.html"
      *
@@ -106,6 +119,30 @@ public:
      */
     Q_INVOKABLE QObject *flightRouteGet(const QString &baseName) const;
 
+    /*! \brief Bounding rectangle of a flight route in the library
+     *
+     * This method uses the index and does not read the file.
+     *
+     * @param baseName File name, without path and without extension
+     *
+     * @returns Bounding rectangle of the flight route. The rectangle is invalid
+     * if the route does not exist or contains no valid waypoints.
+     */
+    Q_INVOKABLE QGeoRectangle flightRouteBoundingRectangle(const QString &baseName) const;
+
+    /*! \brief Short summary of a flight route in the library
+     *
+     * This method uses the index and does not read the file. The summary
+     * names the first and last waypoint and gives the total distance, in the
+     * units chosen by the user.
+     *
+     * @param baseName File name, without path and without extension
+     *
+     * @returns Summary of the flight route, or an empty string if the route
+     * does not exist
+     */
+    Q_INVOKABLE QString flightRouteSummary(const QString &baseName) const;
+
     /*! \brief Full path of a flight route in the library
      *
      * @param baseName Name of the flight route, without path and without
@@ -119,7 +156,7 @@ public:
      *
      * @param baseName File name, without path and without extension
      */
-    Q_INVOKABLE void flightRouteRemove(const QString &baseName) const;
+    Q_INVOKABLE void flightRouteRemove(const QString &baseName);
 
     /*! \brief Renames a flight route in the library
      *
@@ -129,11 +166,12 @@ public:
      * @param newName New file name, without path and without extension. A file
      * with that name must not exist in the library
      */
-    Q_INVOKABLE void flightRouteRename(const QString &oldName, const QString &newName) const;
+    Q_INVOKABLE void flightRouteRename(const QString &oldName, const QString &newName);
 
     /*! \brief Lists all flight routes in the library whose name contains the string 'filter'
      *
-     * The check for string containment is done in a fuzzy way.
+     * The check for string containment is done in a fuzzy way. The list is
+     * taken from the index, and sorted alphabetically.
      *
      * @param filter String used to filter the list
      *
@@ -161,7 +199,9 @@ public:
      *
      * This helper method simplifies a unicode string, by transforming it to
      * QString::NormalizationForm_KD and then removing all 'special' character.
-     * The results are cached for better performance.
+     * Strings that contain only ASCII characters are not normalized, because
+     * normalization would not change them. For all other strings, the results
+     * are kept in a memo table of bounded size.
      *
      * @param string Input string
      *
@@ -169,13 +209,74 @@ public:
      */
     QString simplifySpecialChars(const QString &string);
 
+    /*! \brief Assembles string stored in QRessource
+     *
+     * This method does the actual work of getStringFromRessource, without any
+     * caching. It is meant to be used by the cache only.
+     *
+     * @param name Name of the file in the QRessource
+     *
+     * @returns File content as a QString
+     */
+    static QString assembleStringFromRessource(const QString &name);
+
+signals:
+    /*! \brief Notifier signal
+     *
+     * This signal is emitted whenever flight routes are added to, removed from
+     * or modified in the library.
+     */
+    void flightRoutesChanged();
+
+private slots:
+    // Compares the index with the library directory, parses new or modified
+    // files, saves the index and emits flightRoutesChanged() if anything
+    // changed
+    void updateFlightRouteIndex();
+
 private:
     Q_DISABLE_COPY_MOVE(Librarian)
 
+    // Entry of the flight route index
+    struct FlightRouteIndexEntry {
+        // Size and modification time of the file, used to detect changes
+        qint64 fileSize {-1};
+        qint64 lastModified {-1};
+
+        // Name, as returned by simplifySpecialChars
+        QString simplifiedName;
+
+        QGeoRectangle boundingRectangle;
+        int numberOfWaypoints {0};
+        double distanceInM {0.0};
+        QString firstWaypointName;
+        QString lastWaypointName;
+    };
+
+    // Reads a flight route file and fills the route-specific members of
+    // entry. Returns false if the file cannot be parsed.
+    static bool indexFlightRoute(const QString &fileName, FlightRouteIndexEntry &entry);
+
+    // Reads and writes the index in the cache directory
+    void loadFlightRouteIndex();
+    void saveFlightRouteIndex() const;
+
     QDir flightRouteLibraryDir;
 
-    // Caches used to speed up the method simplifySpecialChars
-    QRegularExpression specialChars {"[^a-zA-Z0-9]"};
+    // Index of the flight route library, keyed by base name, and the sorted
+    // list of base names
+    QHash<QString, FlightRouteIndexEntry> flightRouteIndex;
+    QStringList flightRouteNames;
+    QString flightRouteIndexFileName;
+
+    // Watches the library directory. Changes come in bursts when routes are
+    // saved, so updates are collected by a short single-shot timer.
+    QFileSystemWatcher flightRouteLibraryWatcher;
+    QTimer flightRouteIndexTimer;
+
+    // Memo table used to speed up the method simplifySpecialChars, and its
+    // maximal number of entries
     QHash<QString, QString> simplifySpecialChars_cache;
+    static constexpr int simplifySpecialChars_cacheSize = 4096;
 
 };
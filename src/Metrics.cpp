@@ -0,0 +1,267 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QtMath>
+#include <map>
+#include <memory>
+
+#include "Metrics.h"
+
+
+namespace {
+
+// Registry of all metrics. The maps are only modified when a metric is
+// created; values are never removed, so that pointers remain valid.
+struct Registry
+{
+    QMutex mutex;
+    std::map<QString, std::unique_ptr<Metrics::Counter>> counters;
+    std::map<QString, std::unique_ptr<Metrics::Gauge>> gauges;
+    std::map<QString, std::unique_ptr<Metrics::Histogram>> histograms;
+};
+
+auto registry() -> Registry&
+{
+    static Registry instance;
+    return instance;
+}
+
+// Shard used by the current thread
+std::atomic<int> numThreads {0};
+
+auto shardIndex() -> int
+{
+    thread_local int index = (numThreads++) % Metrics::numShards;
+    return index;
+}
+
+template<typename T> auto findOrCreate(std::map<QString, std::unique_ptr<T>>& map, const QString& name) -> T*
+{
+    QMutexLocker locker(&registry().mutex);
+    auto& entry = map[name];
+    if (!entry) {
+        entry = std::make_unique<T>();
+    }
+    return entry.get();
+}
+
+} // namespace
+
+
+void Metrics::Counter::add(quint64 n)
+{
+    m_shards[shardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+
+auto Metrics::Counter::value() const -> quint64
+{
+    quint64 result = 0;
+    for(const auto& shard : m_shards) {
+        result += shard.value.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+
+void Metrics::Histogram::record(qint64 microseconds)
+{
+    // Bucket i holds durations d with 2^(i-1) <= d < 2^i; bucket 0 holds
+    // durations below one microsecond
+    auto value = static_cast<quint64>(qMax(microseconds, qint64(0)));
+    int bucket = 0;
+    while ((bucket < numBuckets-1) && (value >= (quint64(1) << bucket))) {
+        bucket++;
+    }
+
+    auto& shard = m_shards[shardIndex()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+
+auto Metrics::Histogram::count() const -> quint64
+{
+    quint64 result = 0;
+    for(const auto& shard : m_shards) {
+        for(const auto& bucket : shard.buckets) {
+            result += bucket.load(std::memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+
+auto Metrics::Histogram::sum() const -> quint64
+{
+    quint64 result = 0;
+    for(const auto& shard : m_shards) {
+        result += shard.sum.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+
+auto Metrics::Histogram::quantile(double q) const -> quint64
+{
+    std::array<quint64, numBuckets> buckets {};
+    quint64 total = 0;
+    for(const auto& shard : m_shards) {
+        for(int i=0; i<numBuckets; i++) {
+            auto n = shard.buckets[i].load(std::memory_order_relaxed);
+            buckets[i] += n;
+            total += n;
+        }
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    auto rank = static_cast<quint64>(qCeil(q*static_cast<double>(total)));
+    quint64 cumulative = 0;
+    for(int i=0; i<numBuckets; i++) {
+        cumulative += buckets[i];
+        if (cumulative >= rank) {
+            return quint64(1) << i;
+        }
+    }
+    return quint64(1) << (numBuckets-1);
+}
+
+
+Metrics::Metrics(QObject *parent) : GlobalObject(parent)
+{
+    m_lastSnapshotTimer.start();
+}
+
+
+auto Metrics::counter(const QString& name) -> Counter*
+{
+    return findOrCreate(registry().counters, name);
+}
+
+
+auto Metrics::gauge(const QString& name) -> Gauge*
+{
+    return findOrCreate(registry().gauges, name);
+}
+
+
+auto Metrics::histogram(const QString& name) -> Histogram*
+{
+    return findOrCreate(registry().histograms, name);
+}
+
+
+auto Metrics::now() -> qint64
+{
+    static QElapsedTimer timer = []() {
+        QElapsedTimer result;
+        result.start();
+        return result;
+    }();
+    return timer.nsecsElapsed();
+}
+
+
+auto Metrics::snapshot() -> QVariantList
+{
+    auto seconds = static_cast<double>(m_lastSnapshotTimer.restart())/1000.0;
+
+    // Copy the pointers, so that the mutex is not held while values are
+    // aggregated
+    std::map<QString, QVariantMap> result;
+    QVector<QPair<QString, const Counter*>> counters;
+    QVector<QPair<QString, const Gauge*>> gauges;
+    QVector<QPair<QString, const Histogram*>> histograms;
+    {
+        auto& reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        for(const auto& [name, counter] : reg.counters) {
+            counters.append({name, counter.get()});
+        }
+        for(const auto& [name, gauge] : reg.gauges) {
+            gauges.append({name, gauge.get()});
+        }
+        for(const auto& [name, histogram] : reg.histograms) {
+            histograms.append({name, histogram.get()});
+        }
+    }
+
+    for(const auto& [name, counter] : counters) {
+        auto value = counter->value();
+        auto lastValue = m_lastCounterValues.value(name, value);
+        m_lastCounterValues.insert(name, value);
+
+        QVariantMap entry;
+        entry.insert(QStringLiteral("name"), name);
+        entry.insert(QStringLiteral("type"), QStringLiteral("counter"));
+        entry.insert(QStringLiteral("value"), value);
+        entry.insert(QStringLiteral("rate"), (seconds > 0.0) ? static_cast<double>(value-lastValue)/seconds : 0.0);
+        result[name] = entry;
+    }
+    for(const auto& [name, gauge] : gauges) {
+        QVariantMap entry;
+        entry.insert(QStringLiteral("name"), name);
+        entry.insert(QStringLiteral("type"), QStringLiteral("gauge"));
+        entry.insert(QStringLiteral("value"), gauge->value());
+        result[name] = entry;
+    }
+    for(const auto& [name, histogram] : histograms) {
+        auto count = histogram->count();
+        QVariantMap entry;
+        entry.insert(QStringLiteral("name"), name);
+        entry.insert(QStringLiteral("type"), QStringLiteral("histogram"));
+        entry.insert(QStringLiteral("count"), count);
+        entry.insert(QStringLiteral("mean"), (count > 0) ? static_cast<double>(histogram->sum())/static_cast<double>(count) : 0.0);
+        entry.insert(QStringLiteral("p50"), histogram->quantile(0.5));
+        entry.insert(QStringLiteral("p90"), histogram->quantile(0.9));
+        entry.insert(QStringLiteral("p99"), histogram->quantile(0.99));
+        result[name] = entry;
+    }
+
+    QVariantList list;
+    for(const auto& [name, entry] : result) {
+        list.append(entry);
+    }
+    return list;
+}
+
+
+auto Metrics::toJSON() -> QByteArray
+{
+    QJsonObject metrics;
+    foreach(auto variant, snapshot()) {
+        auto entry = QJsonObject::fromVariantMap(variant.toMap());
+        auto name = entry.take(QStringLiteral("name")).toString();
+        metrics.insert(name, entry);
+    }
+
+    QJsonObject result;
+    result.insert(QStringLiteral("app"), QStringLiteral("enroute flight navigation"));
+    result.insert(QStringLiteral("version"), QStringLiteral(PROJECT_VERSION));
+    result.insert(QStringLiteral("time"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    result.insert(QStringLiteral("metrics"), metrics);
+    return QJsonDocument(result).toJson();
+}
@@ -0,0 +1,267 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVariantList>
+#include <array>
+#include <atomic>
+
+#include "GlobalObject.h"
+
+
+/*! \brief Registry of counters, gauges and latency histograms
+ *
+ * This class holds named metrics that describe what the app is doing, such
+ * as the number of messages received from a traffic data source, the
+ * latency of queries or the hit ratio of caches. The metrics can be
+ * inspected on the diagnostics page and exported as JSON document, which
+ * helps to understand where a slow flight went wrong.
+ *
+ * Metrics are obtained by name with the static methods counter(), gauge()
+ * and histogram(), which create the metric on first use. Names have the
+ * form "category/name". The pointers returned remain valid for the
+ * lifetime of the program, so that callers can look up metrics once and
+ * keep the pointer.
+ *
+ * Updating metrics is lock-free and cheap enough for hot paths: counters
+ * and histograms are split into shards, and every thread writes to its own
+ * shard with relaxed atomic operations. The shards are aggregated only when
+ * the metrics are read. All methods of this class are thread-safe.
+ */
+
+class Metrics : public GlobalObject
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Number of shards of counters and histograms */
+    static constexpr int numShards = 16;
+
+    /*! \brief Monotonically increasing counter */
+    class Counter
+    {
+    public:
+        /*! \brief Add to the counter
+         *
+         * @param n Number to add
+         */
+        void add(quint64 n = 1);
+
+        /*! \brief Value of the counter
+         *
+         * @returns Sum over all shards
+         */
+        quint64 value() const;
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<quint64> value {0};
+        };
+        std::array<Shard, numShards> m_shards {};
+    };
+
+    /*! \brief Value that can go up and down */
+    class Gauge
+    {
+    public:
+        /*! \brief Set the value
+         *
+         * @param value New value
+         */
+        void set(qint64 value)
+        {
+            m_value.store(value, std::memory_order_relaxed);
+        }
+
+        /*! \brief Value of the gauge
+         *
+         * @returns Value last set
+         */
+        qint64 value() const
+        {
+            return m_value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<qint64> m_value {0};
+    };
+
+    /*! \brief Histogram of durations
+     *
+     * Durations are sorted into buckets whose bounds are powers of two
+     * microseconds. Quantiles are therefore accurate up to a factor of two,
+     * which is good enough to tell fast from slow.
+     */
+    class Histogram
+    {
+    public:
+        /*! \brief Number of buckets */
+        static constexpr int numBuckets = 32;
+
+        /*! \brief Record a duration
+         *
+         * @param microseconds Duration in microseconds
+         */
+        void record(qint64 microseconds);
+
+        /*! \brief Number of durations recorded
+         *
+         * @returns Sum over all shards
+         */
+        quint64 count() const;
+
+        /*! \brief Sum of all durations recorded
+         *
+         * @returns Sum in microseconds
+         */
+        quint64 sum() const;
+
+        /*! \brief Estimate quantile
+         *
+         * @param q Number between 0 and 1
+         *
+         * @returns Upper bound of the bucket that contains the quantile, in
+         * microseconds, or 0 if nothing has been recorded
+         */
+        quint64 quantile(double q) const;
+
+    private:
+        struct alignas(64) Shard {
+            std::array<std::atomic<quint64>, numBuckets> buckets {};
+            std::atomic<quint64> sum {0};
+        };
+        std::array<Shard, numShards> m_shards {};
+    };
+
+    /*! \brief Records the lifetime of the object in a histogram */
+    class ScopedTimer
+    {
+    public:
+        /*! \brief Starts the timer
+         *
+         * @param histogram Histogram where the duration is recorded
+         */
+        explicit ScopedTimer(Histogram* histogram)
+            : m_histogram(histogram)
+        {
+            m_timer.start();
+        }
+
+        /*! \brief Records the duration */
+        ~ScopedTimer()
+        {
+            m_histogram->record(m_timer.nsecsElapsed()/1000);
+        }
+
+    private:
+        Q_DISABLE_COPY_MOVE(ScopedTimer)
+
+        Histogram* m_histogram;
+        QElapsedTimer m_timer;
+    };
+
+    /*! \brief Standard constructor
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit Metrics(QObject* parent = nullptr);
+
+    /*! \brief Standard destructor */
+    ~Metrics() override = default;
+
+
+    //
+    // Methods
+    //
+
+    /*! \brief Counter with the given name
+     *
+     * @param name Name of the counter
+     *
+     * @returns Counter, which is created on first use
+     */
+    static Counter* counter(const QString& name);
+
+    /*! \brief Gauge with the given name
+     *
+     * @param name Name of the gauge
+     *
+     * @returns Gauge, which is created on first use
+     */
+    static Gauge* gauge(const QString& name);
+
+    /*! \brief Histogram with the given name
+     *
+     * @param name Name of the histogram
+     *
+     * @returns Histogram, which is created on first use
+     */
+    static Histogram* histogram(const QString& name);
+
+    /*! \brief Monotonic time
+     *
+     * This method is meant for timestamps that are handed from one thread to
+     * another, in order to measure latencies across threads.
+     *
+     * @returns Nanoseconds since the first call to this method
+     */
+    static qint64 now();
+
+    /*! \brief Current values of all metrics
+     *
+     * This method returns one QVariantMap for every metric, sorted by name.
+     * Every map contains the keys "name" and "type" ("counter", "gauge" or
+     * "histogram"). Counters and gauges have a key "value". Counters also
+     * have a key "rate", with the increase per second since the last call to
+     * this method. Histograms have the keys "count", "mean", "p50", "p90" and
+     * "p99", with durations in microseconds.
+     *
+     * @returns List of metrics
+     */
+    Q_INVOKABLE QVariantList snapshot();
+
+    /*! \brief Current values of all metrics, as JSON document
+     *
+     * @returns JSON document with the data returned by snapshot()
+     */
+    Q_INVOKABLE QByteArray toJSON();
+
+private:
+    Q_DISABLE_COPY_MOVE(Metrics)
+
+    // Values of the counters at the last call to snapshot(), and timer
+    // started at that time. Used to compute rates.
+    QHash<QString, quint64> m_lastCounterValues;
+    QElapsedTimer m_lastSnapshotTimer;
+};
+
+
+/*! \brief Records the duration of the enclosing block in a histogram
+ *
+ * The histogram with the given name is looked up only once.
+ */
+#define METRICS_CONCAT_INNER(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_INNER(a, b)
+#define METRICS_TIME_SCOPE(name) \
+    static auto* METRICS_CONCAT(metricsHistogram_, __LINE__) = Metrics::histogram(QStringLiteral(name)); \
+    Metrics::ScopedTimer METRICS_CONCAT(metricsTimer_, __LINE__)(METRICS_CONCAT(metricsHistogram_, __LINE__))
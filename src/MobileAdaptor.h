@@ -20,9 +20,12 @@
 
 #pragma once
 
+#include <functional>
+
 #include <QtGlobal>
 #include <QTimer>
 
+#include <QIODevice>
 #include <QObject>
 
 /*! \brief Interface to platform-specific capabilities of mobile devices
@@ -103,6 +106,31 @@ public:
      */
     Q_INVOKABLE QString exportContent(const QByteArray& content, const QString& mimeType, const QString& fileNameTemplate);
 
+    /*! \brief Function that writes content to a device
+     *
+     * Functions of this type are used by the streaming variants of
+     * exportContent() and viewContent(). They write the content to the
+     * device, which is already open for writing, and return false on error.
+     */
+    using ContentWriter = std::function<bool(QIODevice&)>;
+
+    /*! \brief Export content to file or to file sending app, without holding it in memory
+     *
+     * This method works like the QByteArray variant of exportContent(), but
+     * lets the writer serialize the content directly to the file that is
+     * shared or saved. Use it for large content, such as recorded tracks,
+     * that should not be materialized in memory.
+     *
+     * @param writer Function that writes the content
+     *
+     * @param mimeType the mimeType of the content
+     *
+     * @param fileNameTemplate See the QByteArray variant of this method
+     *
+     * @returns Empty string on success, the string "abort" on abort, and a translated error message otherwise
+     */
+    QString exportContent(const ContentWriter& writer, const QString& mimeType, const QString& fileNameTemplate);
+
     /*! \brief Lock connection to Wi-Fi network
      *
      * Under Android, this method can lock the Wi-Fi connection by acquiring a
@@ -147,6 +175,21 @@ public:
      */
     Q_INVOKABLE QString viewContent(const QByteArray& content, const QString& mimeType, const QString& fileNameTemplate);
 
+    /*! \brief View content in other app, without holding it in memory
+     *
+     * This method works like the QByteArray variant of viewContent(), but lets
+     * the writer serialize the content directly to the temporary file.
+     *
+     * @param writer Function that writes the content
+     *
+     * @param mimeType the mimeType of the content
+     *
+     * @param fileNameTemplate See the QByteArray variant of this method
+     *
+     * @returns Empty string on success, a translated error message otherwise
+     */
+    QString viewContent(const ContentWriter& writer, const QString& mimeType, const QString& fileNameTemplate);
+
     /*! \brief Start receiving "open file" requests from platform
      *
      * This method should be called to indicate that the GUI is set up and ready
@@ -167,6 +210,11 @@ public:
     void emitWifiConnected() {
         emit wifiConnected();
     }
+
+    // Emits the signal "memoryLow".
+    void emitMemoryLow() {
+        emit memoryLow();
+    }
 #endif
 
 public slots:
@@ -230,6 +278,15 @@ signals:
      */
     void wifiConnected();
 
+    /*! \brief Emitted when the platform asks the app to release memory
+     *
+     * On Android, this signal is emitted when the system reports that memory
+     * runs low, or when the app is in the background and might be killed to
+     * free memory for other apps. Receivers should release caches that can be
+     * rebuilt, and report the number of bytes released in the metrics.
+     */
+    void memoryLow();
+
 private slots:
     // Intializations that are moved out of the constructor, in order to avoid
     // nested uses of Global.
@@ -239,8 +296,12 @@ private:
     Q_DISABLE_COPY_MOVE(MobileAdaptor)
   
     // Helper function. Saves content to a file in a directory from where
-    // sharing to other android apps is possible
-    QString contentToTempFile(const QByteArray& content, const QString& fileNameTemplate);
+    // sharing to other android apps is possible. Returns an empty string on
+    // error.
+    QString contentToTempFile(const ContentWriter& writer, const QString& fileNameTemplate);
+
+    // Wraps a byte array into a ContentWriter
+    static ContentWriter byteArrayWriter(const QByteArray& content);
 
     // Name of a subdirectory within the AppDataLocation for sending and
     // receiving files.
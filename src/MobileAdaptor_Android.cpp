@@ -28,6 +28,7 @@
 #include <QTimer>
 
 #include "GlobalObject.h"
+#include "Metrics.h"
 #include "MobileAdaptor.h"
 #include "geomaps/GeoMapProvider.h"
 #include "platform/Notifier.h"
@@ -94,6 +95,18 @@ JNIEXPORT void JNICALL Java_de_akaflieg_1freiburg_enroute_MobileAdaptor_onWifiCo
     }
 }
 
+// This method is called from Java when the system asks the app to release
+// memory
+
+JNIEXPORT void JNICALL Java_de_akaflieg_1freiburg_enroute_MobileAdaptor_onMemoryLow(JNIEnv* /*unused*/, jobject /*unused*/)
+{
+    // See onWifiConnected()
+    if (GlobalObject::canConstruct()) {
+        Metrics::counter(QStringLiteral("memory/lowMemoryEvents"))->add();
+        GlobalObject::mobileAdaptor()->emitMemoryLow();
+    }
+}
+
 // This method is called from Java to indicate that the user has clicked into the Android
 // notification for reporting traffic data receiver errors
 
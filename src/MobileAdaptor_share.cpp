@@ -30,6 +30,7 @@
 #include <QDesktopServices>
 #include <QFile>
 #include <QMimeDatabase>
+#include <QSaveFile>
 #include <QUrl>
 
 #if defined(Q_OS_ANDROID)
@@ -57,19 +58,32 @@ void MobileAdaptor::importContent()
 }
 
 
+auto MobileAdaptor::byteArrayWriter(const QByteArray& content) -> ContentWriter
+{
+    return [content](QIODevice& device) {
+        return device.write(content) == content.size();
+    };
+}
+
+
 auto MobileAdaptor::exportContent(const QByteArray& content, const QString& mimeType, const QString& fileNameTemplate) -> QString
 {
-    //#warning Need to handle user abort!
+    return exportContent(byteArrayWriter(content), mimeType, fileNameTemplate);
+}
 
-    Q_UNUSED(content)
-    Q_UNUSED(mimeType)
-    Q_UNUSED(fileNameTemplate)
+
+auto MobileAdaptor::exportContent(const ContentWriter& writer, const QString& mimeType, const QString& fileNameTemplate) -> QString
+{
+    //#warning Need to handle user abort!
 
     QMimeDatabase db;
     QMimeType mime = db.mimeTypeForName(mimeType);
 
 #if defined(Q_OS_ANDROID)
-    auto tmpPath = contentToTempFile(content, fileNameTemplate+"-%1"+mime.preferredSuffix());
+    auto tmpPath = contentToTempFile(writer, fileNameTemplate+"-%1"+mime.preferredSuffix());
+    if (tmpPath.isEmpty()) {
+        return tr("Unable to write temporary file.");
+    }
     bool success = outgoingIntent("sendFile", tmpPath, mimeType);
     if (success) {
         return QString();
@@ -84,15 +98,14 @@ auto MobileAdaptor::exportContent(const QByteArray& content, const QString& mime
     if (fileNameX.isEmpty()) {
         return "abort";
     }
-    QFile file(fileNameX);
+    QSaveFile file(fileNameX);
     if (!file.open(QIODevice::WriteOnly)) {
         return tr("Unable to open file <strong>%1</strong>.").arg(fileNameX);
     }
 
-    if (file.write(content) != content.size()) {
+    if (!writer(file) || !file.commit()) {
         return tr("Unable to write to file <strong>%1</strong>.").arg(fileNameX);
     }
-    file.close();
     return QString();
 #endif
 }
@@ -100,11 +113,18 @@ auto MobileAdaptor::exportContent(const QByteArray& content, const QString& mime
 
 auto MobileAdaptor::viewContent(const QByteArray& content, const QString& mimeType, const QString& fileNameTemplate) -> QString
 {
-    Q_UNUSED(content)
+    return viewContent(byteArrayWriter(content), mimeType, fileNameTemplate);
+}
+
+
+auto MobileAdaptor::viewContent(const ContentWriter& writer, const QString& mimeType, const QString& fileNameTemplate) -> QString
+{
     Q_UNUSED(mimeType)
-    Q_UNUSED(fileNameTemplate)
 
-    QString tmpPath = contentToTempFile(content, fileNameTemplate);
+    QString tmpPath = contentToTempFile(writer, fileNameTemplate);
+    if (tmpPath.isEmpty()) {
+        return tr("Unable to write temporary file.");
+    }
 #if defined(Q_OS_ANDROID)
     bool success = outgoingIntent("viewFile", tmpPath, mimeType);
     if (success) {
@@ -121,7 +141,7 @@ auto MobileAdaptor::viewContent(const QByteArray& content, const QString& mimeTy
 }
 
 
-auto MobileAdaptor::contentToTempFile(const QByteArray& content, const QString& fileNameTemplate) -> QString
+auto MobileAdaptor::contentToTempFile(const ContentWriter& writer, const QString& fileNameTemplate) -> QString
 {
     QDateTime now = QDateTime::currentDateTimeUtc();
     QString fname = fileNameTemplate.arg(now.toString(QStringLiteral("yyyy-MM-dd_hh.mm.ss")));
@@ -137,7 +157,11 @@ auto MobileAdaptor::contentToTempFile(const QByteArray& content, const QString&
         return QString();
     }
 
-    file.write(content);
+    if (!writer(file)) {
+        file.close();
+        QFile::remove(filePath);
+        return QString();
+    }
     file.close();
 
     return filePath;
@@ -221,11 +245,13 @@ void MobileAdaptor::processFileOpenRequest(const QString &path)
         return;
     }
 
-    // FLARM Simulator file
-    if (Traffic::TrafficDataSource_File::containsFLARMSimulationData(myPath)) {
+    // FLARM Simulator file, GDL90 capture or recording of a traffic receiver
+    if (Traffic::TrafficDataSource_File::containsFLARMSimulationData(myPath)
+            || Traffic::TrafficDataSource_File::containsGDL90Data(myPath)
+            || Traffic::TrafficDataRecorder::containsRecording(myPath)) {
         auto *source = new Traffic::TrafficDataSource_File(myPath);
         GlobalObject::trafficDataProvider()->addDataSource(source); // Will take ownership of source
-        source->connectToTrafficReceiver();
+        QMetaObject::invokeMethod(source, &Traffic::TrafficDataSource_File::connectToTrafficReceiver);
         return;
     }
 
@@ -0,0 +1,394 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QAbstractEventDispatcher>
+#include <QDir>
+#include <QFile>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+
+#if defined(Q_OS_UNIX)
+#include <ctime>
+#include <unistd.h>
+#endif
+
+#include "Metrics.h"
+#include "Profiler.h"
+
+using namespace std::chrono_literals;
+
+
+// Static member variables
+
+std::atomic<bool> Profiler::s_enabled {false};
+
+
+namespace {
+
+// Metrics that hold the CPU time and the wakeups of the subsystems
+struct Counters
+{
+    std::array<Metrics::Counter*, Profiler::numSubsystems> cpuTime {};
+    std::array<Metrics::Counter*, Profiler::numSubsystems> wakeups {};
+};
+
+auto counters() -> const Counters&
+{
+    static const Counters instance = []() {
+        const std::array<const char*, Profiler::numSubsystems> names {"trafficDecode", "tileServing", "aviationQueries", "weather", "qml", "rendering"};
+        Counters result;
+        for(int i=0; i<Profiler::numSubsystems; i++) {
+            result.cpuTime[i] = Metrics::counter(QStringLiteral("profiler/%1/cpuTimeInNS").arg(names[i]));
+            result.wakeups[i] = Metrics::counter(QStringLiteral("profiler/%1/wakeups").arg(names[i]));
+        }
+        return result;
+    }();
+    return instance;
+}
+
+// Stack of subsystems of the current thread. Wakeups are numbered; a
+// subsystem is counted as woken up whenever it is pushed in a wakeup where
+// it was not pushed before. If the event dispatcher of the thread is watched,
+// the wakeup number is incremented whenever the dispatcher wakes up.
+// Otherwise, every outermost scope counts as a wakeup.
+struct ThreadState
+{
+    std::array<int, 8> stack {};
+    int depth {0};
+    qint64 lastChange {0};
+    quint64 wakeup {0};
+    bool dispatcherWatched {false};
+    std::array<quint64, Profiler::numSubsystems> lastWakeup {};
+};
+
+thread_local ThreadState threadState;
+
+// Called on the current thread whenever its event dispatcher wakes up
+void countDispatcherWakeup()
+{
+    auto& state = threadState;
+    state.dispatcherWatched = true;
+    state.wakeup++;
+}
+
+} // namespace
+
+
+Profiler::Profiler(QObject* parent)
+    : GlobalObject(parent)
+{
+    m_threadSamplingTimer.setInterval(10s);
+    connect(&m_threadSamplingTimer, &QTimer::timeout, this, &Profiler::sampleThreads);
+}
+
+
+auto Profiler::begin(Subsystem subsystem) -> bool
+{
+    auto& state = threadState;
+    if (state.depth >= static_cast<int>(state.stack.size())) {
+        return false;
+    }
+
+    const auto& metrics = counters();
+    auto now = threadCPUTime();
+    if (state.depth > 0) {
+        metrics.cpuTime[state.stack[state.depth-1]]->add(static_cast<quint64>(now-state.lastChange));
+    } else if (!state.dispatcherWatched) {
+        state.wakeup++;
+    }
+    state.stack[state.depth++] = subsystem;
+    state.lastChange = now;
+    if (state.lastWakeup[subsystem] != state.wakeup) {
+        state.lastWakeup[subsystem] = state.wakeup;
+        metrics.wakeups[subsystem]->add();
+    }
+    return true;
+}
+
+
+void Profiler::end()
+{
+    auto& state = threadState;
+    if (state.depth == 0) {
+        return;
+    }
+
+    auto now = threadCPUTime();
+    counters().cpuTime[state.stack[state.depth-1]]->add(static_cast<quint64>(now-state.lastChange));
+    state.depth--;
+    state.lastChange = now;
+}
+
+
+auto Profiler::breakdown() const -> QVariantList
+{
+    if (!enabled()) {
+        return {};
+    }
+    auto hours = static_cast<double>(m_elapsedTimer.elapsed())/3600000.0;
+    if (hours <= 0.0) {
+        return {};
+    }
+
+    const std::array<QString, numSubsystems> names {tr("Traffic decoding"), tr("Tile serving"), tr("Aviation data queries"), tr("Weather"), tr("QML"), tr("Rendering")};
+    const auto& metrics = counters();
+    auto processCPUTimeInNS = processCPUTime();
+    auto processDelta = (processCPUTimeInNS < 0) ? -1.0 : static_cast<double>(processCPUTimeInNS-m_processCPUTimeAtStart);
+
+    QVariantList result;
+    double attributed = 0.0;
+    for(int i=0; i<numSubsystems; i++) {
+        auto cpuTime = static_cast<double>(metrics.cpuTime[i]->value()-m_cpuTimeAtStart[i]);
+        auto wakeups = static_cast<double>(metrics.wakeups[i]->value()-m_wakeupsAtStart[i]);
+        attributed += cpuTime;
+
+        QVariantMap map;
+        map[QStringLiteral("name")] = names[i];
+        map[QStringLiteral("cpuSecondsPerHour")] = cpuTime/1e9/hours;
+        map[QStringLiteral("wakeupsPerHour")] = wakeups/hours;
+        map[QStringLiteral("share")] = (processDelta > 0.0) ? 100.0*cpuTime/processDelta : 0.0;
+        result.append(map);
+    }
+    if (processDelta >= 0.0) {
+        auto unattributed = qMax(processDelta-attributed, 0.0);
+        QVariantMap map;
+        map[QStringLiteral("name")] = tr("Not attributed");
+        map[QStringLiteral("cpuSecondsPerHour")] = unattributed/1e9/hours;
+        map[QStringLiteral("wakeupsPerHour")] = -1;
+        map[QStringLiteral("share")] = (processDelta > 0.0) ? 100.0*unattributed/processDelta : 0.0;
+        result.append(map);
+    }
+
+    std::sort(result.begin(), result.end(), [](const QVariant& a, const QVariant& b) {
+        return a.toMap().value(QStringLiteral("cpuSecondsPerHour")).toDouble() > b.toMap().value(QStringLiteral("cpuSecondsPerHour")).toDouble();
+    });
+    return result;
+}
+
+
+auto Profiler::currentSubsystem() -> int
+{
+    const auto& state = threadState;
+    return (state.depth > 0) ? state.stack[state.depth-1] : -1;
+}
+
+
+auto Profiler::elapsedSeconds() const -> qint64
+{
+    if (!enabled()) {
+        return 0;
+    }
+    return m_elapsedTimer.elapsed()/1000;
+}
+
+
+auto Profiler::processCPUTime() -> qint64
+{
+#if defined(Q_OS_UNIX)
+    timespec time {};
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) != 0) {
+        return -1;
+    }
+    return static_cast<qint64>(time.tv_sec)*1000000000 + time.tv_nsec;
+#else
+    return -1;
+#endif
+}
+
+
+void Profiler::sampleThreads()
+{
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+    static const auto ticksPerSecond = sysconf(_SC_CLK_TCK);
+    if (ticksPerSecond <= 0) {
+        return;
+    }
+
+    QDir taskDirectory(QStringLiteral("/proc/self/task"));
+    foreach(auto entry, taskDirectory.entryList(QDir::Dirs|QDir::NoDotAndDotDot)) {
+        QFile file(taskDirectory.filePath(entry+QStringLiteral("/stat")));
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        auto stat = file.readAll();
+
+        // The name is enclosed in parentheses and may itself contain spaces
+        // and parentheses. The fields after the name begin with field 3, the
+        // state; utime and stime are the fields 14 and 15.
+        auto open = stat.indexOf('(');
+        auto close = stat.lastIndexOf(')');
+        if ((open < 0) || (close < open)) {
+            continue;
+        }
+        auto fields = stat.mid(close+2).split(' ');
+        if (fields.size() < 13) {
+            continue;
+        }
+        auto ticks = fields[11].toLongLong() + fields[12].toLongLong();
+        auto threadID = entry.toLongLong();
+        m_threadNames[threadID] = QString::fromUtf8(stat.mid(open+1, close-open-1));
+        m_threadCPUTimes[threadID] = ticks*1000000000/ticksPerSecond;
+    }
+#endif
+}
+
+
+void Profiler::setEnabled(bool newEnabled)
+{
+    if (newEnabled == enabled()) {
+        return;
+    }
+
+    if (newEnabled) {
+        const auto& metrics = counters();
+        for(int i=0; i<numSubsystems; i++) {
+            m_cpuTimeAtStart[i] = metrics.cpuTime[i]->value();
+            m_wakeupsAtStart[i] = metrics.wakeups[i]->value();
+        }
+        m_processCPUTimeAtStart = processCPUTime();
+        m_threadCPUTimes.clear();
+        m_threadNames.clear();
+        sampleThreads();
+        m_threadCPUTimesAtStart = m_threadCPUTimes;
+        m_elapsedTimer.start();
+        m_threadSamplingTimer.start();
+    } else {
+        m_threadSamplingTimer.stop();
+    }
+    s_enabled = newEnabled;
+    updateConnections();
+    emit enabledChanged();
+}
+
+
+void Profiler::setWindow(QQuickWindow* window)
+{
+    if (window == m_window) {
+        return;
+    }
+    m_window = window;
+    updateConnections();
+}
+
+
+auto Profiler::threadCPUTime() -> qint64
+{
+#if defined(Q_OS_UNIX)
+    timespec time {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return static_cast<qint64>(time.tv_sec)*1000000000 + time.tv_nsec;
+#else
+    return Metrics::now();
+#endif
+}
+
+
+void Profiler::watchThread(QThread* thread)
+{
+    // The event dispatcher of a thread is created when the thread starts
+    QObject::connect(thread, &QThread::started, thread, []() {
+        auto* dispatcher = QAbstractEventDispatcher::instance();
+        if (dispatcher != nullptr) {
+            QObject::connect(dispatcher, &QAbstractEventDispatcher::awake, dispatcher, &countDispatcherWakeup, Qt::DirectConnection);
+        }
+    }, Qt::DirectConnection);
+}
+
+
+auto Profiler::threads() const -> QVariantList
+{
+    if (!enabled()) {
+        return {};
+    }
+    auto hours = static_cast<double>(m_elapsedTimer.elapsed())/3600000.0;
+    if (hours <= 0.0) {
+        return {};
+    }
+
+    QHash<QString, qint64> cpuTimeByName;
+    for(auto it = m_threadCPUTimes.constBegin(); it != m_threadCPUTimes.constEnd(); ++it) {
+        auto cpuTime = it.value() - m_threadCPUTimesAtStart.value(it.key(), 0);
+        if (cpuTime > 0) {
+            cpuTimeByName[m_threadNames.value(it.key())] += cpuTime;
+        }
+    }
+
+    QVariantList result;
+    for(auto it = cpuTimeByName.constBegin(); it != cpuTimeByName.constEnd(); ++it) {
+        QVariantMap map;
+        map[QStringLiteral("name")] = it.key();
+        map[QStringLiteral("cpuSecondsPerHour")] = static_cast<double>(it.value())/1e9/hours;
+        result.append(map);
+    }
+    std::sort(result.begin(), result.end(), [](const QVariant& a, const QVariant& b) {
+        return a.toMap().value(QStringLiteral("cpuSecondsPerHour")).toDouble() > b.toMap().value(QStringLiteral("cpuSecondsPerHour")).toDouble();
+    });
+    return result;
+}
+
+
+void Profiler::updateConnections()
+{
+    for(const auto& connection : qAsConst(m_connections)) {
+        disconnect(connection);
+    }
+    m_connections.clear();
+
+    if (!enabled()) {
+        // This method runs on the GUI thread, usually while the QML
+        // subsystem is on top of the stack
+        if (currentSubsystem() == QML) {
+            end();
+        }
+        return;
+    }
+
+    // Work on the GUI thread that is not tagged otherwise is charged to QML
+    auto* dispatcher = QAbstractEventDispatcher::instance(thread());
+    if (dispatcher != nullptr) {
+        m_connections << connect(dispatcher, &QAbstractEventDispatcher::awake, this, []() {
+            countDispatcherWakeup();
+            if (s_enabled.load(std::memory_order_relaxed) && (currentSubsystem() < 0)) {
+                begin(QML);
+            }
+        }, Qt::DirectConnection);
+        m_connections << connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, []() {
+            if (currentSubsystem() == QML) {
+                end();
+            }
+        }, Qt::DirectConnection);
+    }
+
+    // With the threaded render loop, these signals are emitted on the render
+    // thread and handled right there
+    if (!m_window.isNull()) {
+        m_connections << connect(m_window, &QQuickWindow::beforeSynchronizing, this, []() {
+            if (s_enabled.load(std::memory_order_relaxed) && (currentSubsystem() != Rendering)) {
+                begin(Rendering);
+            }
+        }, Qt::DirectConnection);
+        m_connections << connect(m_window, &QQuickWindow::frameSwapped, this, []() {
+            if (currentSubsystem() == Rendering) {
+                end();
+            }
+        }, Qt::DirectConnection);
+    }
+}
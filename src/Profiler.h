@@ -0,0 +1,276 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QQuickWindow>
+#include <QThread>
+#include <QTimer>
+#include <QVariantList>
+#include <array>
+#include <atomic>
+
+#include "GlobalObject.h"
+
+
+/*! \brief CPU time and wakeups, by subsystem
+ *
+ * This class implements a profiling mode that helps to find out which part
+ * of the app drains the battery on long flights. While the mode is enabled,
+ * work is attributed to subsystems as follows.
+ *
+ * - Code that belongs to a subsystem is tagged with PROFILER_SCOPE. The
+ *   CPU time that the thread spends in the scope is charged to the
+ *   subsystem. Scopes can be nested, in which case the time is charged to
+ *   the innermost scope.
+ *
+ * - Work on the GUI thread that is not tagged otherwise is charged to the
+ *   subsystem QML. This is done by watching the event dispatcher of the GUI
+ *   thread.
+ *
+ * - Frames of the main window are charged to the subsystem Rendering, on
+ *   whichever thread they are rendered.
+ *
+ * A subsystem is woken up whenever it does work in an iteration of the
+ * event loop in which it did not do any work before. A single wakeup of a
+ * thread can therefore count for several subsystems. Wakeups are detected by
+ * watching the event dispatcher of the GUI thread and of the worker threads
+ * passed to watchThread(). On all other threads, such as the threads of the
+ * thread pool, every outermost PROFILER_SCOPE counts as a wakeup.
+ *
+ * In addition, the CPU time of every thread of the process is sampled every
+ * ten seconds, so that work that is not tagged at all can be found. This is
+ * available on Linux and Android only.
+ *
+ * CPU time is read from the thread CPU clock on Unix systems, and measured
+ * as wall time elsewhere. All values are also available as metrics with
+ * names "profiler/<subsystem>/cpuTimeInNS" and
+ * "profiler/<subsystem>/wakeups". CPU time serves as a proxy for energy,
+ * which the app cannot measure directly.
+ *
+ * When the mode is disabled, a PROFILER_SCOPE costs a single relaxed atomic
+ * load. The static methods of this class are thread-safe; all other methods
+ * must be called from the GUI thread.
+ */
+
+class Profiler : public GlobalObject
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Subsystems to which work is attributed */
+    enum Subsystem {
+        TrafficDecode = 0,   /*!< Decoding data from traffic receivers */
+        TileServing = 1,     /*!< Serving map tiles to the map */
+        AviationQueries = 2, /*!< Queries to the aviation data, such as airspaces or waypoints near a position */
+        Weather = 3,         /*!< Downloading and decoding weather reports */
+        QML = 4,             /*!< Work on the GUI thread that is not attributed otherwise */
+        Rendering = 5        /*!< Rendering frames of the main window */
+    };
+    Q_ENUM(Subsystem)
+
+    /*! \brief Number of subsystems */
+    static constexpr int numSubsystems = 6;
+
+    /*! \brief Charges the lifetime of the object to a subsystem
+     *
+     * Use the macro PROFILER_SCOPE rather than this class directly.
+     */
+    class Scope
+    {
+    public:
+        /*! \brief Begins charging CPU time to the subsystem
+         *
+         * @param subsystem Subsystem
+         */
+        explicit Scope(Subsystem subsystem)
+        {
+            if (s_enabled.load(std::memory_order_relaxed)) {
+                m_isActive = begin(subsystem);
+            }
+        }
+
+        /*! \brief Ends charging CPU time to the subsystem */
+        ~Scope()
+        {
+            if (m_isActive) {
+                end();
+            }
+        }
+
+    private:
+        Q_DISABLE_COPY_MOVE(Scope)
+
+        bool m_isActive {false};
+    };
+
+    /*! \brief Standard constructor
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit Profiler(QObject* parent = nullptr);
+
+    /*! \brief Standard destructor */
+    ~Profiler() override = default;
+
+
+    //
+    // Properties
+    //
+
+    /*! \brief Profiling mode
+     *
+     * Setting this property to true resets all values shown by breakdown()
+     * and threads(). The property is not saved; profiling always starts out
+     * disabled.
+     */
+    Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     * @returns Property enabled
+     */
+    bool enabled() const
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    /*! \brief Setter function for the property with the same name
+     *
+     * @param newEnabled Property enabled
+     */
+    void setEnabled(bool newEnabled);
+
+
+    //
+    // Methods
+    //
+
+    /*! \brief Cost of the subsystems, per hour
+     *
+     * This method returns one QVariantMap for every subsystem, and one for the
+     * CPU time of the process that is not attributed to any subsystem. Every
+     * map contains the keys "name" (translated, human-readable),
+     * "cpuSecondsPerHour", "wakeupsPerHour" and "share", the percentage of
+     * the CPU time of the process. For the unattributed CPU time, the number
+     * of wakeups is not known and given as -1. The values are averages since
+     * profiling was enabled.
+     *
+     * @returns List of subsystems, sorted by CPU time, largest first
+     */
+    Q_INVOKABLE QVariantList breakdown() const;
+
+    /*! \brief Time since profiling was enabled
+     *
+     * @returns Time in seconds, or 0 if profiling is disabled
+     */
+    Q_INVOKABLE qint64 elapsedSeconds() const;
+
+    /*! \brief CPU time of the threads of the process, per hour
+     *
+     * This method returns one QVariantMap for every thread that has used CPU
+     * time since profiling was enabled, with keys "name" and
+     * "cpuSecondsPerHour". Threads with the same name are combined. The list
+     * is empty on platforms where threads cannot be sampled.
+     *
+     * @returns List of threads, sorted by CPU time, largest first
+     */
+    Q_INVOKABLE QVariantList threads() const;
+
+    /*! \brief Count wakeups of a worker thread
+     *
+     * This method watches the event dispatcher of the thread, so that
+     * wakeups of subsystems on the thread are counted once per iteration of
+     * its event loop, as on the GUI thread. It must be called before the
+     * thread is started. This method is thread-safe.
+     *
+     * @param thread Thread with an event loop
+     */
+    static void watchThread(QThread* thread);
+
+    /*! \brief Set window whose frames are charged to Rendering
+     *
+     * @param window Main window of the app
+     */
+    void setWindow(QQuickWindow* window);
+
+signals:
+    /*! \brief Notifier signal */
+    void enabledChanged();
+
+private:
+    Q_DISABLE_COPY_MOVE(Profiler)
+
+    // Pushes a subsystem onto the stack of the current thread, and charges
+    // the time since the last push or pop to the previous top. Returns false,
+    // and does nothing, if the stack is full.
+    static bool begin(Subsystem subsystem);
+
+    // Pops the stack of the current thread, and charges the time since the
+    // last push or pop to the subsystem that was on top. Does nothing if the
+    // stack is empty.
+    static void end();
+
+    // Subsystem on top of the stack of the current thread, or -1 if the
+    // stack is empty
+    static int currentSubsystem();
+
+    // CPU time of the current thread, and of the process, in nanoseconds
+    static qint64 threadCPUTime();
+    static qint64 processCPUTime();
+
+    // Reads the CPU time of all threads into m_threadCPUTimes
+    void sampleThreads();
+
+    // Connects to or disconnects from the event dispatcher and the window,
+    // depending on s_enabled
+    void updateConnections();
+
+    static std::atomic<bool> s_enabled;
+
+    QPointer<QQuickWindow> m_window;
+    QVector<QMetaObject::Connection> m_connections;
+
+    // Values when profiling was enabled
+    QElapsedTimer m_elapsedTimer;
+    qint64 m_processCPUTimeAtStart {0};
+    std::array<quint64, numSubsystems> m_cpuTimeAtStart {};
+    std::array<quint64, numSubsystems> m_wakeupsAtStart {};
+
+    // CPU time of the threads, by thread ID, in nanoseconds, first and last
+    // sample since profiling was enabled, and the names of the threads
+    QTimer m_threadSamplingTimer;
+    QHash<qint64, qint64> m_threadCPUTimesAtStart;
+    QHash<qint64, qint64> m_threadCPUTimes;
+    QHash<qint64, QString> m_threadNames;
+};
+
+
+/*! \brief Charges the CPU time of the enclosing block to a subsystem
+ *
+ * @param subsystem Member of Profiler::Subsystem, such as Profiler::Weather
+ */
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+#define PROFILER_SCOPE(subsystem) \
+    Profiler::Scope PROFILER_CONCAT(profilerScope_, __LINE__)(subsystem)
@@ -0,0 +1,126 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+
+/*! \brief Lock-free publication of a small value to many reader threads
+ *
+ * This class implements a sequence lock. A single writer thread publishes
+ * values with store(); any number of threads read them with load(), without
+ * locks, without allocation and without ever blocking the writer. A reader
+ * that overlaps with a store retries, so readers always see a value that
+ * has been stored as a whole.
+ *
+ * The value is kept in an array of atomic words, so that concurrent reads
+ * and writes are well-defined. This restricts T to small, trivially
+ * copyable types, such as structs of doubles.
+ *
+ * @note Only one thread may call store(). Calls to load() are thread-safe.
+ */
+
+template<typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock requires a trivially copyable type");
+    static_assert(sizeof(T) <= 64, "SeqLock is meant for small types");
+
+public:
+    /*! \brief Constructs a lock that holds the given value
+     *
+     * @param value Initial value
+     */
+    explicit SeqLock(const T& value = T())
+    {
+        writeWords(value);
+    }
+
+    /*! \brief Publish a value
+     *
+     * @param value Value to publish
+     */
+    void store(const T& value)
+    {
+        auto sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence+1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        writeWords(value);
+        m_sequence.store(sequence+2, std::memory_order_release);
+    }
+
+    /*! \brief Read the latest value
+     *
+     * @returns Value most recently published with store()
+     */
+    T load() const
+    {
+        std::array<quint64, wordCount> words {};
+        quint32 before = 0;
+        quint32 after = 0;
+        do {
+            before = m_sequence.load(std::memory_order_acquire);
+            for(std::size_t i=0; i<wordCount; i++) {
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        } while (((before & 1) != 0) || (before != after));
+
+        T result;
+        std::memcpy(&result, words.data(), sizeof(T));
+        return result;
+    }
+
+    /*! \brief Version of the value
+     *
+     * This method is meant for readers that keep a converted copy of the
+     * value, and want to convert it again only after it has changed.
+     *
+     * @returns Number that is even, and changes with every call to store()
+     */
+    quint32 version() const
+    {
+        return m_sequence.load(std::memory_order_acquire) & ~1U;
+    }
+
+private:
+    Q_DISABLE_COPY_MOVE(SeqLock)
+
+    static constexpr std::size_t wordCount = (sizeof(T)+sizeof(quint64)-1)/sizeof(quint64);
+
+    void writeWords(const T& value)
+    {
+        std::array<quint64, wordCount> words {};
+        std::memcpy(words.data(), &value, sizeof(T));
+        for(std::size_t i=0; i<wordCount; i++) {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+    // Odd while a store is in progress
+    std::atomic<quint32> m_sequence {0};
+    std::array<std::atomic<quint64>, wordCount> m_words {};
+};
@@ -22,11 +22,28 @@
 #include <QLibraryInfo>
 #include <QLocale>
 #include <QSettings>
+#include <atomic>
 
-#include "GlobalObject.h"
 #include "Settings.h"
 
 
+namespace {
+
+// Snapshot of the settings that are read by the static getters. These
+// getters are called very often, for instance whenever a distance is
+// formatted, and must not read QSettings. The values are set in the
+// constructor of Settings and updated by the setters.
+std::atomic<bool> acceptedWeatherTermsSnapshot {false};
+std::atomic<bool> hideGlidingSectorsSnapshot {true};
+std::atomic<bool> hideUpperAirspacesSnapshot {false};
+std::atomic<bool> useMetricUnitsSnapshot {false};
+
+// Incremented whenever the translators change
+std::atomic<int> translatorGeneration {0};
+
+} // namespace
+
+
 Settings::Settings(QObject *parent)
     : QObject(parent)
 {
@@ -34,18 +51,30 @@ Settings::Settings(QObject *parent)
 
     // Save some values
     settings.setValue("lastVersion", PROJECT_VERSION);
+
+    // Initialize snapshot
+    acceptedWeatherTermsSnapshot = acceptedWeatherTerms();
+    hideGlidingSectorsSnapshot = hideGlidingSectors();
+    hideUpperAirspacesSnapshot = hideUpperAirspaces();
+    useMetricUnitsSnapshot = useMetricUnits();
 }
 
 
 auto Settings::acceptedWeatherTermsStatic() -> bool
 {
-    return GlobalObject::settings()->acceptedWeatherTerms();
+    return acceptedWeatherTermsSnapshot.load(std::memory_order_relaxed);
+}
+
+
+auto Settings::hideGlidingSectorsStatic() -> bool
+{
+    return hideGlidingSectorsSnapshot.load(std::memory_order_relaxed);
 }
 
 
 auto Settings::hideUpperAirspacesStatic() -> bool
 {
-    return GlobalObject::settings()->hideUpperAirspaces();
+    return hideUpperAirspacesSnapshot.load(std::memory_order_relaxed);
 }
 
 
@@ -65,6 +94,7 @@ void Settings::setAcceptedWeatherTerms(bool terms)
         return;
     }
     settings.setValue("acceptedWeatherTerms", terms);
+    acceptedWeatherTermsSnapshot = terms;
     emit acceptedWeatherTermsChanged();
 }
 
@@ -75,6 +105,7 @@ void Settings::setHideGlidingSectors(bool hide)
         return;
     }
     settings.setValue("Map/hideGlidingSectors", hide);
+    hideGlidingSectorsSnapshot = hide;
     emit hideGlidingSectorsChanged();
 }
 
@@ -85,6 +116,7 @@ void Settings::setHideUpperAirspaces(bool hide)
         return;
     }
     settings.setValue("Map/hideUpperAirspaces", hide);
+    hideUpperAirspacesSnapshot = hide;
     emit hideUpperAirspacesChanged();
 }
 
@@ -142,6 +174,17 @@ void Settings::setMapBearingPolicy(MapBearingPolicyValues policy)
 }
 
 
+void Settings::setMaxTrafficObjects(int newMaxTrafficObjects)
+{
+    newMaxTrafficObjects = qBound(1, newMaxTrafficObjects, 500);
+    if (newMaxTrafficObjects == maxTrafficObjects()) {
+        return;
+    }
+    settings.setValue("Traffic/maxTrafficObjects", newMaxTrafficObjects);
+    emit maxTrafficObjectsChanged();
+}
+
+
 auto Settings::nightMode() const -> bool
 {
     return settings.value("Map/nightMode", false).toBool();
@@ -159,6 +202,17 @@ void Settings::setNightMode(bool newNightMode)
 }
 
 
+void Settings::setTileCacheSize(int sizeInMB)
+{
+    sizeInMB = qMax(sizeInMB, 0);
+    if (sizeInMB == tileCacheSize()) {
+        return;
+    }
+    settings.setValue("Map/tileCacheSize", sizeInMB);
+    emit tileCacheSizeChanged();
+}
+
+
 void Settings::setUseMetricUnits(bool unitHorizKmh)
 {
     if (unitHorizKmh == useMetricUnits()) {
@@ -166,13 +220,20 @@ void Settings::setUseMetricUnits(bool unitHorizKmh)
     }
 
     settings.setValue("System/useMetricUnits", unitHorizKmh);
+    useMetricUnitsSnapshot = unitHorizKmh;
     emit useMetricUnitsChanged();
 }
 
 
 auto Settings::useMetricUnitsStatic() -> bool
 {
-    return GlobalObject::settings()->useMetricUnits();
+    return useMetricUnitsSnapshot.load(std::memory_order_relaxed);
+}
+
+
+auto Settings::translatorGenerationStatic() -> int
+{
+    return translatorGeneration.load(std::memory_order_acquire);
 }
 
 
@@ -198,4 +259,5 @@ void Settings::installTranslators(const QString &localeName)
         enrouteTranslator->load(QString(":enroute_%1.qm").arg(localeName));
     }
     QCoreApplication::installTranslator(enrouteTranslator);
+    translatorGeneration.fetch_add(1, std::memory_order_release);
 }
@@ -98,6 +98,9 @@ public:
     /*! \brief Getter function for property of the same name
      *
      * This function differs from acceptedWeatherTerms() only in that it is static.
+     * It does not read QSettings, but returns a snapshot of the value that is
+     * kept up to date by the setter. It is therefore fast, and can be called
+     * from any thread.
      *
      * @returns Property acceptedWeatherTerms
      */
@@ -127,6 +130,16 @@ public:
      */
     bool hideGlidingSectors() const { return settings.value(QStringLiteral("Map/hideGlidingSectors"), true).toBool(); }
 
+    /*! \brief Getter function for property of the same name
+     *
+     * This function differs from hideGlidingSectors() only in that it is static.
+     * It returns a snapshot of the value, in the same way as
+     * hideUpperAirspacesStatic(), and can be called from any thread.
+     *
+     * @returns Property hideGlidingSectors
+     */
+    static bool hideGlidingSectorsStatic();
+
     /*! \brief Setter function for property of the same name
      *
      * @param hide Property hideGlidingSectors
@@ -145,6 +158,9 @@ public:
     /*! \brief Getter function for property of the same name
      *
      * This function differs from hideUpperAirspaces() only in that it is static.
+     * It does not read QSettings, but returns a snapshot of the value that is
+     * kept up to date by the setter. It is therefore fast, and can be called
+     * from any thread.
      *
      * @returns Property hideUpperAirspaces
      */
@@ -205,6 +221,23 @@ public:
      */
     void setMapBearingPolicy(MapBearingPolicyValues policy);
 
+    /*! \brief Maximal number of traffic targets with known position that are
+     *  tracked and shown at the same time */
+    Q_PROPERTY(int maxTrafficObjects READ maxTrafficObjects WRITE setMaxTrafficObjects NOTIFY maxTrafficObjectsChanged)
+
+    /*! \brief Getter function for property of the same name
+     *
+     * @returns Property maxTrafficObjects
+     */
+    int maxTrafficObjects() const { return settings.value(QStringLiteral("Traffic/maxTrafficObjects"), 20).toInt(); }
+
+    /*! \brief Setter function for property of the same name
+     *
+     * @param newMaxTrafficObjects Property maxTrafficObjects. The value is
+     * clamped to the range 1…500.
+     */
+    void setMaxTrafficObjects(int newMaxTrafficObjects);
+
     /*! \brief Night mode */
     Q_PROPERTY(bool nightMode READ nightMode WRITE setNightMode NOTIFY nightModeChanged)
 
@@ -220,6 +253,21 @@ public:
      */
     void setNightMode(bool newNightMode);
 
+    /*! \brief Size of the in-memory cache for map tiles, in megabytes */
+    Q_PROPERTY(int tileCacheSize READ tileCacheSize WRITE setTileCacheSize NOTIFY tileCacheSizeChanged)
+
+    /*! \brief Getter function for property of the same name
+     *
+     * @returns Property tileCacheSize
+     */
+    int tileCacheSize() const { return settings.value(QStringLiteral("Map/tileCacheSize"), 32).toInt(); }
+
+    /*! \brief Setter function for property of the same name
+     *
+     * @param sizeInMB Property tileCacheSize
+     */
+    void setTileCacheSize(int sizeInMB);
+
     /*! \brief Set to true is app should be shown in English rather than the
      * system language */
     Q_PROPERTY(bool useMetricUnits READ useMetricUnits WRITE setUseMetricUnits NOTIFY useMetricUnitsChanged)
@@ -233,6 +281,9 @@ public:
     /*! \brief Getter function for property of the same name
      *
      * This function differs from useMetricUnits() only in that it is static.
+     * It does not read QSettings, but returns a snapshot of the value that is
+     * kept up to date by the setter. It is therefore fast, and can be called
+     * from any thread.
      *
      * @returns Property useMetricUnits
      */
@@ -256,6 +307,17 @@ public:
      */
     void installTranslators(const QString &localeName={});
 
+    /*! \brief Counter for changes of the translators
+     *
+     * This number is incremented whenever installTranslators() is called.
+     * Code that caches translated strings can compare it to a stored value
+     * to find out if the cache is still valid. The method can be called from
+     * any thread.
+     *
+     * @returns Number of calls to installTranslators()
+     */
+    static int translatorGenerationStatic();
+
 signals:
     /*! Notifier signal */
     void acceptedTermsChanged();
@@ -278,9 +340,15 @@ signals:
     /*! Notifier signal */
     void mapBearingPolicyChanged();
 
+    /*! Notifier signal */
+    void maxTrafficObjectsChanged();
+
     /*! Notifier signal */
     void nightModeChanged();
 
+    /*! Notifier signal */
+    void tileCacheSizeChanged();
+
     /*! Notifier signal */
     void useMetricUnitsChanged();
 
@@ -0,0 +1,151 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "Tracer.h"
+
+
+namespace {
+
+// A recorded span
+struct Span
+{
+    const char* name {nullptr};
+    int threadID {0};
+    qint64 start {0};
+    qint64 end {0};
+};
+
+// Number of spans kept in the ring buffer
+constexpr std::size_t ringBufferSize = 4096;
+
+QMutex ringBufferMutex;
+std::array<Span, ringBufferSize> ringBuffer;
+
+// Total number of spans recorded so far. The most recent span is stored at
+// index (numSpans-1) % ringBufferSize.
+std::size_t numSpans {0};
+
+// Small, sequential thread IDs are easier to read in trace viewers than the
+// opaque values returned by QThread::currentThreadId()
+std::atomic<int> numThreads {0};
+
+auto currentThreadID() -> int
+{
+    thread_local int threadID = ++numThreads;
+    return threadID;
+}
+
+auto traceClock() -> QElapsedTimer&
+{
+    static QElapsedTimer timer = []() {
+        QElapsedTimer result;
+        result.start();
+        return result;
+    }();
+    return timer;
+}
+
+} // namespace
+
+
+Tracer::Scope::Scope(const char* name)
+    : m_name(name), m_start(Tracer::elapsed())
+{
+}
+
+
+Tracer::Scope::~Scope()
+{
+    Tracer::record(m_name, m_start, Tracer::elapsed());
+}
+
+
+Tracer::Tracer(QObject *parent) : GlobalObject(parent)
+{
+}
+
+
+auto Tracer::elapsed() -> qint64
+{
+    return traceClock().nsecsElapsed();
+}
+
+
+auto Tracer::enabled() -> bool
+{
+#if defined(ENROUTE_TRACING)
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+void Tracer::record(const char* name, qint64 start, qint64 end)
+{
+    Span span {name, currentThreadID(), start, end};
+
+    QMutexLocker locker(&ringBufferMutex);
+    ringBuffer[numSpans % ringBufferSize] = span;
+    numSpans++;
+}
+
+
+auto Tracer::toChromeTrace() -> QByteArray
+{
+    std::vector<Span> spans;
+    {
+        QMutexLocker locker(&ringBufferMutex);
+        auto count = qMin(numSpans, ringBufferSize);
+        spans.reserve(count);
+        for(auto i = numSpans-count; i < numSpans; i++) {
+            spans.push_back(ringBuffer[i % ringBufferSize]);
+        }
+    }
+
+    auto pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    for(const auto& span : spans) {
+        QJsonObject event;
+        event.insert(QStringLiteral("name"), QString::fromUtf8(span.name));
+        event.insert(QStringLiteral("ph"), QStringLiteral("X"));
+        // Chrome expects microseconds
+        event.insert(QStringLiteral("ts"), static_cast<double>(span.start)/1000.0);
+        event.insert(QStringLiteral("dur"), static_cast<double>(span.end-span.start)/1000.0);
+        event.insert(QStringLiteral("pid"), pid);
+        event.insert(QStringLiteral("tid"), span.threadID);
+        events.append(event);
+    }
+
+    QJsonObject result;
+    result.insert(QStringLiteral("traceEvents"), events);
+    result.insert(QStringLiteral("displayTimeUnit"), QStringLiteral("ms"));
+    return QJsonDocument(result).toJson(QJsonDocument::Compact);
+}
@@ -0,0 +1,143 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QByteArray>
+
+#include "GlobalObject.h"
+
+
+/*! \brief Lightweight tracing of startup and other expensive operations
+ *
+ * This class records spans (named intervals of time, together with the thread
+ * that spent the time) in a fixed-size ring buffer, so that the most recent
+ * spans are always available at very little cost. The recorded spans can be
+ * exported in the Chrome trace event format and inspected with
+ * chrome://tracing or ui.perfetto.dev.
+ *
+ * Spans are recorded with the macro TRACE_SCOPE, which creates a
+ * Tracer::Scope object that lives until the end of the enclosing block.
+ * Tracing is compiled in only if the macro ENROUTE_TRACING is defined, which
+ * is the case for debug builds and for builds configured with the CMake
+ * option ENROUTE_TRACING. In all other builds, TRACE_SCOPE expands to nothing
+ * and the ring buffer will always be empty.
+ *
+ * The recording methods are thread safe.
+ */
+
+class Tracer : public GlobalObject
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Records a span for the lifetime of the object */
+    class Scope
+    {
+    public:
+        /*! \brief Starts the span
+         *
+         * @param name Name of the span. The string is not copied and must
+         * remain valid for the lifetime of the program, as string literals do.
+         */
+        explicit Scope(const char* name);
+
+        /*! \brief Ends the span and records it */
+        ~Scope();
+
+    private:
+        Q_DISABLE_COPY_MOVE(Scope)
+
+        const char* m_name;
+        qint64 m_start;
+    };
+
+    /*! \brief Standard constructor
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit Tracer(QObject* parent = nullptr);
+
+    /*! \brief Standard destructor */
+    ~Tracer() override = default;
+
+
+    //
+    // PROPERTIES
+    //
+
+    /*! \brief Indicates if tracing has been compiled in */
+    Q_PROPERTY(bool enabled READ enabled CONSTANT)
+
+
+    //
+    // Getter Methods
+    //
+
+    /*! \brief Getter function for the property with the same name
+     *
+     * @returns Property enabled
+     */
+    static bool enabled();
+
+
+    //
+    // Methods
+    //
+
+    /*! \brief Nanoseconds since the process started
+     *
+     * More precisely, this method returns the time elapsed since the first
+     * call to any method of this class. The function main() calls this method
+     * first thing.
+     *
+     * @returns Time in nanoseconds
+     */
+    static qint64 elapsed();
+
+    /*! \brief Record a span
+     *
+     * @param name Name of the span. The string is not copied and must remain
+     * valid for the lifetime of the program, as string literals do.
+     *
+     * @param start Start of the span, as returned by elapsed()
+     *
+     * @param end End of the span, as returned by elapsed()
+     */
+    static void record(const char* name, qint64 start, qint64 end);
+
+    /*! \brief Recorded spans in Chrome trace event format
+     *
+     * @returns JSON document with all spans currently held in the ring buffer
+     */
+    Q_INVOKABLE static QByteArray toChromeTrace();
+
+private:
+    Q_DISABLE_COPY_MOVE(Tracer)
+};
+
+
+#if defined(ENROUTE_TRACING)
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) Tracer::Scope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
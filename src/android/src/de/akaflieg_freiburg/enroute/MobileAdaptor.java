@@ -43,6 +43,7 @@ public class MobileAdaptor extends de.akaflieg_freiburg.enroute.ShareActivity
 {
     public static native void onNotificationClicked(int notifyID);
     public static native void onWifiConnected();
+    public static native void onMemoryLow();
     
     private static MobileAdaptor           m_instance;
     
@@ -100,6 +101,23 @@ public class MobileAdaptor extends de.akaflieg_freiburg.enroute.ShareActivity
     }
     
     
+    @Override public void onTrimMemory(int level) {
+	super.onTrimMemory(level);
+	
+	// Release caches if memory runs low while the app is running, or if the
+	// app is in the background and might be killed
+	if ((level == TRIM_MEMORY_RUNNING_LOW) || (level == TRIM_MEMORY_RUNNING_CRITICAL) || (level >= TRIM_MEMORY_BACKGROUND)) {
+	    onMemoryLow();
+	}
+    }
+    
+    
+    @Override public void onLowMemory() {
+	super.onLowMemory();
+	onMemoryLow();
+    }
+    
+    
     //
     // Static Methods
     //
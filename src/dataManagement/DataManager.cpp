@@ -19,15 +19,18 @@
  ***************************************************************************/
 
 #include <QApplication>
+#include <QDataStream>
 #include <QDirIterator>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QLockFile>
+#include <QSaveFile>
 #include <QSettings>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QStandardPaths>
+#include <QThread>
+#include <QtConcurrent>
 
 #include <chrono>
 #include <utility> 
@@ -35,7 +38,38 @@
 using namespace std::chrono_literals;
 
 #include "DataManager.h"
+#include "dataManagement/FileRegistry.h"
+#include "geomaps/CompiledAviationMap.h"
+#include "geomaps/MBTilesReader.h"
+#include "InitScheduler.h"
 #include "Settings.h"
+#include "Tracer.h"
+
+
+namespace {
+
+// Magic number and format version of the binary cache of maps.json
+const quint32 catalogueCacheMagic = 0x454E4D43; // "ENMC"
+const quint32 catalogueCacheVersion = 1;
+
+// Prepares a downloaded mbtiles file for the tile server, see
+// Downloadable::setFileProcessor(). Tile lookups need an index, which not all
+// files have, and identical tiles should be stored only once. Deduplication
+// changes most blocks of the file. It is therefore skipped for maps with a
+// block manifest, so that their updates can still download changed blocks
+// only.
+auto mbtilesFileProcessor(const QUrl& blockManifestUrl) -> std::function<void(const QString&)>
+{
+    auto deduplicate = !blockManifestUrl.isValid();
+    return [deduplicate](const QString& fileName) {
+        if (deduplicate) {
+            GeoMaps::MBTilesReader::deduplicateTiles(fileName);
+        }
+        GeoMaps::MBTilesReader::ensureTileIndex(fileName);
+    };
+}
+
+}
 
 
 DataManagement::DataManager::DataManager(QObject *parent) :
@@ -60,10 +94,13 @@ DataManagement::DataManager::DataManager(QObject *parent) :
     }
 
     // Construct the Dowloadable object "_maps_json". Let it point to the remote
-    // file "maps.json" and wire it up.
+    // file "maps.json" and wire it up. The file is only downloaded if it has
+    // changed.
+    _maps_json.setUseConditionalRequests(true);
     connect(&_maps_json, &DataManagement::Downloadable::downloadingChanged, this, &DataManager::downloadingGeoMapListChanged);
     connect(&_maps_json, &DataManagement::Downloadable::fileContentChanged, this, &DataManager::readGeoMapListFromJSONFile);
     connect(&_maps_json, &DataManagement::Downloadable::fileContentChanged, this, &DataManager::setTimeOfLastUpdateToNow);
+    connect(&_maps_json, &DataManagement::Downloadable::fileUnchanged, this, &DataManager::setTimeOfLastUpdateToNow);
     connect(&_maps_json, &DataManagement::Downloadable::error, this, &DataManager::errorReceiver);
 
     // Cleanup
@@ -78,7 +115,7 @@ DataManagement::DataManager::DataManager(QObject *parent) :
 
 void DataManagement::DataManager::deferredInitialization()
 {
-
+    TRACE_SCOPE("DataManager::deferredInitialization");
     // Wire up the automatic update timer and check if automatic updates are
     // due. The method "autoUpdateGeoMapList" will also set a reasonable timeout
     // value for the timer and start it.
@@ -88,15 +125,27 @@ void DataManagement::DataManager::deferredInitialization()
         autoUpdateGeoMapList();
     }
 
-    // If there is a downloaded maps.json file, we read it. Otherwise, we start
-    // a download.
-    if (_maps_json.hasFile()) {
-        readGeoMapListFromJSONFile();
-    } else {
-        if (GlobalObject::settings()->acceptedTerms()) {
-            _maps_json.startFileDownload();
+    // If there is a downloaded maps.json file, we read it in the background
+    // and create the Downloadable objects once that is done. Otherwise, we
+    // start a download. Other global objects wait for the task "catalogue"
+    // before they look at the lists of maps.
+    auto catalogue = std::make_shared<QVector<CatalogueEntry>>();
+    GlobalObject::initScheduler()->addTask("catalogue", {}, [this, catalogue]() {
+        if (!_maps_json.hasFile()) {
+            if (GlobalObject::settings()->acceptedTerms()) {
+                _maps_json.startFileDownload();
+            }
+            return QFuture<void>();
         }
-    }
+        return QtConcurrent::run([this, catalogue]() { *catalogue = readCatalogue(); });
+    }, [this, catalogue]() {
+        if (!_maps_json.hasFile()) {
+            return;
+        }
+        _catalogue = *catalogue;
+        instantiateMaps();
+        emit geoMapListChanged();
+    });
 }
 
 
@@ -146,16 +195,11 @@ auto DataManagement::DataManager::describeMapFile(const QString& fileName) -> QS
                               tr("File Size"),
                               QLocale::system().formattedDataSize(fi.size(), 1, QLocale::DataSizeSIFormat));
 
-    // Extract infomation from GeoJSON
+    auto metadata = mapMetadata(fileName);
+
+    // Information from GeoJSON
     if (fileName.endsWith(u".geojson")) {
-        QLockFile lockFile(fileName+".lock");
-        lockFile.lock();
-        QFile file(fileName);
-        file.open(QIODevice::ReadOnly);
-        auto document = QJsonDocument::fromJson(file.readAll());
-        file.close();
-        lockFile.unlock();
-        QString concatInfoString = document.object()[QStringLiteral("info")].toString();
+        QString concatInfoString = metadata.value(QStringLiteral("info")).toString();
         if (!concatInfoString.isEmpty()) {
             result += "<p>"+tr("The map data was compiled from the following sources.")+"</p><ul>";
             auto infoStrings = concatInfoString.split(QStringLiteral(";"));
@@ -165,44 +209,106 @@ auto DataManagement::DataManager::describeMapFile(const QString& fileName) -> QS
         }
     }
 
-    // Extract infomation from MBTILES
+    // Information from MBTILES
+    if (fileName.endsWith(u".mbtiles")) {
+        QString intResult;
+        foreach(auto entry, metadata.value(QStringLiteral("metadata")).toArray()) {
+            auto pair = entry.toArray();
+            intResult += QStringLiteral("<tr><td><strong>%1 :&nbsp;&nbsp;</strong></td><td>%2</td></tr>")
+                             .arg(pair.at(0).toString(), pair.at(1).toString());
+        }
+        if (!intResult.isEmpty()) {
+            result += QStringLiteral("<h4>%1</h4><table>%2</table>").arg(tr("Internal Map Data"), intResult);
+        }
+    }
+
+    // Information from text file - this is simply the first line
+    if (fileName.endsWith(u".txt")) {
+        result += QString("<p>%1</p>").arg(metadata.value(QStringLiteral("description")).toString());
+    }
+
+    return result;
+}
+
+
+auto DataManagement::DataManager::mapMetadata(const QString& fileName) -> QJsonObject
+{
+    // Use the saved metadata if it belongs to the current file
+    QFileInfo fileInfo(fileName);
+    QFile metadataFile(mapMetadataFileName(fileName));
+    if (metadataFile.open(QIODevice::ReadOnly)) {
+        auto metadata = QJsonDocument::fromJson(metadataFile.readAll()).object();
+        if ((metadata.value(QStringLiteral("size")).toDouble() == static_cast<double>(fileInfo.size())) &&
+            (metadata.value(QStringLiteral("modified")).toString() == fileInfo.lastModified().toUTC().toString(Qt::ISODateWithMs))) {
+            return metadata;
+        }
+    }
+    return extractMapMetadata(fileName);
+}
+
+
+auto DataManagement::DataManager::extractMapMetadata(const QString& fileName) -> QJsonObject
+{
+    QJsonObject metadata;
+
+    FileRegistry::ReadLocker locker(fileName);
+    QFileInfo fileInfo(fileName);
+    if (!fileInfo.exists()) {
+        return metadata;
+    }
+    metadata.insert(QStringLiteral("size"), static_cast<double>(fileInfo.size()));
+    metadata.insert(QStringLiteral("modified"), fileInfo.lastModified().toUTC().toString(Qt::ISODateWithMs));
+
+    // GeoJSON: the list of sources
+    if (fileName.endsWith(u".geojson")) {
+        QFile file(fileName);
+        file.open(QIODevice::ReadOnly);
+        auto document = QJsonDocument::fromJson(file.readAll());
+        metadata.insert(QStringLiteral("info"), document.object()[QStringLiteral("info")].toString());
+    }
+
+    // MBTILES: the metadata table, except for the large entry "json"
     if (fileName.endsWith(u".mbtiles")) {
-        // Open database
-        auto databaseConnectionName = "GeoMapProvider::describeMapFile "+fileName;
-        auto db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), databaseConnectionName);
-        db.setDatabaseName(fileName);
-        db.open();
-        if (!db.isOpenError()) {
-            // Read metadata from database
-            QSqlQuery query(db);
-            QString intResult;
-            if (query.exec(QStringLiteral("select name, value from metadata;"))) {
-                while(query.next()) {
-                    QString key = query.value(0).toString();
-                    if (key == u"json") {
-                        continue;
+        auto databaseConnectionName = QStringLiteral("DataManager::extractMapMetadata %1 %2")
+                                          .arg(fileName)
+                                          .arg(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+        {
+            auto db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), databaseConnectionName);
+            db.setDatabaseName(fileName);
+            db.open();
+            if (!db.isOpenError()) {
+                QJsonArray entries;
+                QSqlQuery query(db);
+                if (query.exec(QStringLiteral("select name, value from metadata;"))) {
+                    while(query.next()) {
+                        QString key = query.value(0).toString();
+                        if (key == u"json") {
+                            continue;
+                        }
+                        entries.append(QJsonArray{key, query.value(1).toString()});
                     }
-                    intResult += QStringLiteral("<tr><td><strong>%1 :&nbsp;&nbsp;</strong></td><td>%2</td></tr>")
-                                     .arg(key, query.value(1).toString());
                 }
+                metadata.insert(QStringLiteral("metadata"), entries);
+                db.close();
             }
-            if (!intResult.isEmpty()) {
-                result += QStringLiteral("<h4>%1</h4><table>%2</table>").arg(tr("Internal Map Data"), intResult);
-            }
-            db.close();
         }
+        QSqlDatabase::removeDatabase(databaseConnectionName);
     }
 
-    // Extract infomation from text file - this is simply the first line
+    // Text file: the first line
     if (fileName.endsWith(u".txt")) {
-        // Open file and read first line
         QFile dataFile(fileName);
         dataFile.open(QIODevice::ReadOnly);
-        auto description = dataFile.readLine();
-        result += QString("<p>%1</p>").arg( QString::fromLatin1(description));
+        metadata.insert(QStringLiteral("description"), QString::fromLatin1(dataFile.readLine()));
     }
 
-    return result;
+    // Save metadata
+    QSaveFile metadataFile(mapMetadataFileName(fileName));
+    if (metadataFile.open(QIODevice::WriteOnly)) {
+        metadataFile.write(QJsonDocument(metadata).toJson(QJsonDocument::Compact));
+        metadataFile.commit();
+    }
+    return metadata;
 }
 
 
@@ -246,29 +352,133 @@ void DataManagement::DataManager::readGeoMapListFromJSONFile()
     if (!_maps_json.hasFile()) {
         return;
     }
+    _catalogue = readCatalogue();
+    instantiateMaps();
+    emit geoMapListChanged();
+}
 
-    // List of maps as we have them now
-    QVector<QPointer<DataManagement::Downloadable>> oldMaps = _geoMaps.downloadables();
 
-    // To begin, we handle the maps described in the maps.json file. If these
-    // maps were already present in the old list, we re-use them. Otherwise, we
-    // create new Downloadable objects.
-    QJsonParseError parseError{};
-    auto doc = QJsonDocument::fromJson(_maps_json.fileContent(), &parseError);
-    if (parseError.error != QJsonParseError::NoError) {
+void DataManagement::DataManager::loadFullCatalogue()
+{
+    if (_fullCatalogueLoaded) {
         return;
     }
+    _fullCatalogueLoaded = true;
+    instantiateMaps();
+}
+
+
+auto DataManagement::DataManager::readCatalogue() const -> QVector<CatalogueEntry>
+{
+    QVector<CatalogueEntry> catalogue;
+    QFileInfo jsonInfo(_maps_json.fileName());
+    auto cacheFileName = _maps_json.fileName()+".cache";
+
+    // Use the binary cache if it belongs to the current maps.json
+    QFile cacheFile(cacheFileName);
+    if (cacheFile.open(QIODevice::ReadOnly)) {
+        QDataStream in(&cacheFile);
+        in.setVersion(QDataStream::Qt_5_15);
+        quint32 magic = 0;
+        quint32 version = 0;
+        qint64 jsonSize = 0;
+        qint64 jsonLastModified = 0;
+        in >> magic >> version >> jsonSize >> jsonLastModified;
+        if ((in.status() == QDataStream::Ok) && (magic == catalogueCacheMagic) && (version == catalogueCacheVersion) &&
+                (jsonSize == jsonInfo.size()) && (jsonLastModified == jsonInfo.lastModified().toMSecsSinceEpoch())) {
+            quint32 count = 0;
+            in >> count;
+            catalogue.reserve(static_cast<int>(count));
+            for(quint32 i=0; (i<count) && (in.status() == QDataStream::Ok); i++) {
+                CatalogueEntry entry;
+                bool hasBoundingBox = false;
+                double left = 0.0;
+                double bottom = 0.0;
+                double right = 0.0;
+                double top = 0.0;
+                in >> entry.path >> entry.url >> entry.time >> entry.size >> entry.blockManifestUrl >> entry.checksum
+                   >> hasBoundingBox >> left >> bottom >> right >> top;
+                if (hasBoundingBox) {
+                    entry.boundingBox = QGeoRectangle(QGeoCoordinate(top, left), QGeoCoordinate(bottom, right));
+                }
+                catalogue.append(entry);
+            }
+            if (in.status() == QDataStream::Ok) {
+                return catalogue;
+            }
+        }
+        cacheFile.close();
+    }
+
+    // Parse maps.json
+    catalogue.clear();
+    QJsonParseError parseError{};
+    {
+        auto mapsJSON = _maps_json.mapFile();
+        auto doc = QJsonDocument::fromJson(mapsJSON->bytes(), &parseError);
+        if (parseError.error != QJsonParseError::NoError) {
+            return catalogue;
+        }
+
+        auto top = doc.object();
+        auto baseURL = top.value("url").toString();
+        foreach(auto map, top.value("maps").toArray()) {
+            auto obj = map.toObject();
+            CatalogueEntry entry;
+            entry.path = obj.value("path").toString();
+            entry.url = QUrl(baseURL + "/" + entry.path);
+            entry.time = QDateTime::fromString(obj.value("time").toString(), "yyyyMMdd");
+            entry.size = static_cast<qint64>(obj.value("size").toDouble());
+
+            // Some maps come with a block manifest, for delta updates
+            if (obj.contains("blocks")) {
+                entry.blockManifestUrl = QUrl(baseURL + "/" + obj.value("blocks").toString());
+            }
+
+            // Checksum of the map, if known
+            entry.checksum = QByteArray::fromHex(obj.value("sha256").toString().toLatin1());
+
+            // Area covered by the map, if known, in the form [left, bottom, right, top]
+            auto bbox = obj.value("bbox").toArray();
+            if (bbox.size() == 4) {
+                entry.boundingBox = QGeoRectangle(QGeoCoordinate(bbox[3].toDouble(), bbox[0].toDouble()),
+                                                  QGeoCoordinate(bbox[1].toDouble(), bbox[2].toDouble()));
+            }
+            catalogue.append(entry);
+        }
+    }
+
+    // Write binary cache
+    QSaveFile saveFile(cacheFileName);
+    if (saveFile.open(QIODevice::WriteOnly)) {
+        QDataStream out(&saveFile);
+        out.setVersion(QDataStream::Qt_5_15);
+        out << catalogueCacheMagic << catalogueCacheVersion << static_cast<qint64>(jsonInfo.size()) << jsonInfo.lastModified().toMSecsSinceEpoch();
+        out << static_cast<quint32>(catalogue.size());
+        foreach(auto entry, catalogue) {
+            auto hasBoundingBox = entry.boundingBox.isValid();
+            out << entry.path << entry.url << entry.time << entry.size << entry.blockManifestUrl << entry.checksum
+                << hasBoundingBox << entry.boundingBox.topLeft().longitude() << entry.boundingBox.bottomRight().latitude()
+                << entry.boundingBox.bottomRight().longitude() << entry.boundingBox.topLeft().latitude();
+        }
+        saveFile.commit();
+    }
+    return catalogue;
+}
+
 
-    auto top = doc.object();
-    auto baseURL = top.value("url").toString();
+void DataManagement::DataManager::instantiateMaps()
+{
+    // List of maps as we have them now
+    QVector<QPointer<DataManagement::Downloadable>> oldMaps = _geoMaps.downloadables();
 
-    foreach(auto map, top.value("maps").toArray()) {
-        auto obj = map.toObject();
-        auto mapFileName = obj.value("path").toString();
+    // To begin, we handle the maps described in the catalogue. If these maps
+    // were already present in the old list, we re-use them. Otherwise, we
+    // create new Downloadable objects, unless the map is neither installed
+    // nor being downloaded and the full catalogue has not been requested.
+    foreach(auto entry, _catalogue) {
+        auto mapFileName = entry.path;
         auto mapName = mapFileName.section('.',-2,-2);
-        auto mapUrlName = baseURL + "/"+ obj.value("path").toString();
-        auto fileModificationDateTime = QDateTime::fromString(obj.value("time").toString(), "yyyyMMdd");
-        auto fileSize = obj.value("size").toInt();
 
         // If a map with the given name already exists, update that element, delete its entry in oldMaps
         DataManagement::Downloadable *mapPtr = nullptr;
@@ -282,28 +492,62 @@ void DataManagement::DataManager::readGeoMapListFromJSONFile()
         if (mapPtr != nullptr) {
             // Map exists
             oldMaps.removeAll(mapPtr);
-            mapPtr->setRemoteFileDate(fileModificationDateTime);
-            mapPtr->setRemoteFileSize(fileSize);
+            mapPtr->setRemoteFileDate(entry.time);
+            mapPtr->setRemoteFileSize(entry.size);
+            mapPtr->setBlockManifestUrl(entry.blockManifestUrl);
+            if (mapPtr->fileName().endsWith("mbtiles")) {
+                mapPtr->setFileProcessor(mbtilesFileProcessor(entry.blockManifestUrl));
+            }
+            mapPtr->setBoundingBox(entry.boundingBox);
+            mapPtr->setChecksum(entry.checksum);
         } else {
             // Construct local file name
             auto localFileName = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/aviation_maps/"+mapFileName;
 
+            // Databases are always needed, because other parts of the app look
+            // for them
+            if (!_fullCatalogueLoaded && !localFileName.endsWith("txt") &&
+                    !QFile::exists(localFileName) && !QFile::exists(localFileName+".part")) {
+                continue;
+            }
+
             // Construct a new downloadable object.
-            auto *downloadable = new DataManagement::Downloadable(QUrl(mapUrlName), localFileName, this);
+            auto *downloadable = new DataManagement::Downloadable(entry.url, localFileName, this);
             downloadable->setObjectName(mapName.section("/", -1, -1));
             downloadable->setSection(mapName.section("/", -2, -2));
-            downloadable->setRemoteFileDate(fileModificationDateTime);
-            downloadable->setRemoteFileSize(fileSize);
+            downloadable->setRemoteFileDate(entry.time);
+            downloadable->setRemoteFileSize(entry.size);
+            downloadable->setBlockManifestUrl(entry.blockManifestUrl);
+            downloadable->setBoundingBox(entry.boundingBox);
+            downloadable->setChecksum(entry.checksum);
             _geoMaps.addToGroup(downloadable);
             if (localFileName.endsWith("geojson")) {
                 _aviationMaps.addToGroup(downloadable);
             }
             if (localFileName.endsWith("mbtiles")) {
                 _baseMaps.addToGroup(downloadable);
+
+                downloadable->setFileProcessor(mbtilesFileProcessor(entry.blockManifestUrl));
             }
             if (localFileName.endsWith("txt")) {
                 _databases.addToGroup(downloadable);
             }
+            if (localFileName.endsWith("terrain")) {
+                _terrainMaps.addToGroup(downloadable);
+            }
+            if (localFileName.endsWith("geoid")) {
+                _geoidModels.addToGroup(downloadable);
+            }
+
+            // Extract the metadata shown in describeMapFile() once, right
+            // after installation, and delete it together with the map
+            connect(downloadable, &DataManagement::Downloadable::fileContentChanged, downloadable, [localFileName]() {
+                if (QFile::exists(localFileName)) {
+                    QtConcurrent::run(&DataManagement::DataManager::extractMapMetadata, localFileName);
+                } else {
+                    QFile::remove(mapMetadataFileName(localFileName));
+                }
+            });
         }
 
     }
@@ -381,10 +625,16 @@ auto DataManagement::DataManager::unattachedFiles() const -> QList<QString>
         fileIterator.next();
 
         // Now check if this file exists as the local file of some geographic
-        // map
+        // map, or as one of its auxiliary files (partial downloads, lock and
+        // validator files), or as the binary cache of an existing local file
         bool isAttachedToAviationMap = false;
+        auto filePath = QFileInfo(fileIterator.filePath()).absoluteFilePath();
         foreach(auto geoMapPtr, _geoMaps.downloadables()) {
-            if (geoMapPtr->fileName() == QFileInfo(fileIterator.filePath()).absoluteFilePath()) {
+            if (filePath.startsWith(geoMapPtr->fileName())) {
+                isAttachedToAviationMap = true;
+                break;
+            }
+            if (geoMapPtr->hasFile() && (GeoMaps::CompiledAviationMap::cacheFileName(geoMapPtr->fileName()) == filePath)) {
                 isAttachedToAviationMap = true;
                 break;
             }
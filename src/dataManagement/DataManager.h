@@ -20,10 +20,12 @@
 
 #pragma once
 
+#include <QJsonObject>
 #include <QTimer>
 
 #include "GlobalObject.h"
 #include "dataManagement/DownloadableGroup.h"
+#include "dataManagement/DownloadScheduler.h"
 
 
 namespace DataManagement {
@@ -115,6 +117,32 @@ public:
    */
   DataManagement::DownloadableGroupWatcher *databases() { return &_databases; };
 
+  /*! \brief Pointer to the DownloadableGroup that holds all terrain maps
+   *
+   *  This is a DownloadableGroup that holds all terrain elevation rasters,
+   *  in the format read by GeoMaps::TerrainRaster.
+   */
+  Q_PROPERTY(DataManagement::DownloadableGroupWatcher *terrainMaps READ terrainMaps CONSTANT)
+
+  /*! \brief Getter function for the property with the same name
+   *
+   *  @returns Property terrainMaps
+   */
+  DataManagement::DownloadableGroupWatcher *terrainMaps() { return &_terrainMaps; };
+
+  /*! \brief Pointer to the DownloadableGroup that holds all geoid models
+   *
+   *  This is a DownloadableGroup that holds high-resolution geoid models, in
+   *  the format read by Positioning::GeoidRaster.
+   */
+  Q_PROPERTY(DataManagement::DownloadableGroupWatcher *geoidModels READ geoidModels CONSTANT)
+
+  /*! \brief Getter function for the property with the same name
+   *
+   *  @returns Property geoidModels
+   */
+  DataManagement::DownloadableGroupWatcher *geoidModels() { return &_geoidModels; };
+
   /*! \brief Describe installed map
      *
      * This method describes installed GeoJSON map files.
@@ -131,6 +159,19 @@ public:
      */
   Q_INVOKABLE static QString describeMapFile(const QString& fileName);
 
+  /*! \brief Scheduler for map downloads
+
+    Downloads of several maps should be queued here rather than started
+    directly, so that the most useful maps become available first.
+  */
+  Q_PROPERTY(DataManagement::DownloadScheduler *downloadScheduler READ downloadScheduler CONSTANT)
+
+  /*! \brief Getter function for the property with the same name
+
+    @returns Property downloadScheduler
+  */
+  DataManagement::DownloadScheduler *downloadScheduler() { return &_downloadScheduler; }
+
   /*! \brief Indicates whether the file "maps.json" is currently being downloaded */
   Q_PROPERTY(bool downloadingGeoMapList READ downloadingGeoMapList NOTIFY downloadingGeoMapListChanged)
 
@@ -160,7 +201,16 @@ public:
     
     @returns hasGeoMapList
    */
-  bool hasGeoMapList() const { return !_geoMaps.downloadables().isEmpty(); }
+  bool hasGeoMapList() const { return !_catalogue.isEmpty() || !_geoMaps.downloadables().isEmpty(); }
+
+  /*! \brief Create Downloadable objects for all maps of the catalogue
+
+    To save time and memory at startup, Downloadable objects are created only
+    for databases and for maps that are installed or partially downloaded.
+    The map manager calls this method when it is opened, so that all
+    available maps are listed. Further calls do nothing.
+  */
+  Q_INVOKABLE void loadFullCatalogue();
 
 public slots:
   /*! \brief Triggers an update of the list of available maps
@@ -224,6 +274,44 @@ private:
   // corresponding entry in _aviationMaps.
   QList<QString> unattachedFiles() const;
 
+  // Entry of the catalogue of available maps, as described in maps.json
+  struct CatalogueEntry {
+    QString path;
+    QUrl url;
+    QDateTime time;
+    qint64 size {0};
+    QUrl blockManifestUrl;
+    QByteArray checksum;
+    QGeoRectangle boundingBox;
+  };
+
+  // Reads the catalogue from the binary cache maps.json.cache, if that
+  // belongs to the current maps.json. Otherwise, parses maps.json and writes
+  // the cache.
+  QVector<CatalogueEntry> readCatalogue() const;
+
+  // Creates or updates the Downloadable objects for the catalogue, as
+  // described in loadFullCatalogue()
+  void instantiateMaps();
+
+  // Catalogue of available maps
+  QVector<CatalogueEntry> _catalogue;
+
+  // Set once loadFullCatalogue() has been called
+  bool _fullCatalogueLoaded {false};
+
+  // Metadata of an installed map file, used by describeMapFile(). The metadata
+  // is stored in a small JSON file next to the map, at
+  // mapMetadataFileName(), which records the size and modification time of
+  // the map file. The method mapMetadata() reads that file, or extracts the
+  // metadata anew if the file is missing or outdated. The method
+  // extractMapMetadata() extracts the metadata from the map file and saves
+  // it. It is thread-safe and is run in a worker thread once a map has been
+  // installed.
+  static QString mapMetadataFileName(const QString& fileName) { return fileName + ".meta"; }
+  static QJsonObject mapMetadata(const QString& fileName);
+  static QJsonObject extractMapMetadata(const QString& fileName);
+
   // This timer is used to trigger automatic updates. Its signal QTimer::timeout
   // is connected to the slot autoUpdateGeoMapList.
   QTimer _autoUpdateTimer;
@@ -235,9 +323,14 @@ private:
   
   // List of geographic maps
   DataManagement::DownloadableGroup _databases;
+  DataManagement::DownloadableGroup _geoidModels;
   DataManagement::DownloadableGroup _geoMaps;
   DataManagement::DownloadableGroup _baseMaps;
   DataManagement::DownloadableGroup _aviationMaps;
+  DataManagement::DownloadableGroup _terrainMaps;
+
+  // Scheduler for downloads of several maps
+  DataManagement::DownloadScheduler _downloadScheduler;
 };
 
 };
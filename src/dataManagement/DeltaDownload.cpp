@@ -0,0 +1,302 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkRequest>
+#include <QtConcurrent/QtConcurrentRun>
+#include <utility>
+
+#include "GlobalObject.h"
+#include "dataManagement/DeltaDownload.h"
+
+
+namespace {
+
+// Runs of missing blocks that are separated by fewer than this number of
+// blocks are fetched in one request. This trades a few bytes for fewer round
+// trips.
+const qint64 maxGapBlocks = 4;
+
+// Reads block number i of a file, which must be open
+QByteArray readBlock(QFile& file, qint64 i, qint64 blockSize, qint64 size)
+{
+    auto begin = i*blockSize;
+    auto length = qMin(blockSize, size-begin);
+    if (!file.seek(begin)) {
+        return {};
+    }
+    return file.read(length);
+}
+
+} // namespace
+
+
+DataManagement::DeltaDownload::DeltaDownload(QUrl url, QUrl manifestUrl, QString localFileName, QString targetFileName, QObject* parent)
+    : QObject(parent),
+      _url(std::move(url)),
+      _localFileName(std::move(localFileName)),
+      _targetFileName(std::move(targetFileName))
+{
+    connect(&_copyWatcher, &QFutureWatcher<CopyResult>::finished, this, &DataManagement::DeltaDownload::onCopyFinished);
+    connect(&_verifyWatcher, &QFutureWatcher<bool>::finished, this, &DataManagement::DeltaDownload::onVerifyFinished);
+
+    _reply = GlobalObject::networkAccessManager()->get(QNetworkRequest(manifestUrl));
+    connect(_reply, &QNetworkReply::finished, this, &DataManagement::DeltaDownload::onManifestFinished);
+}
+
+
+DataManagement::DeltaDownload::~DeltaDownload()
+{
+    _done = true;
+    if (!_reply.isNull()) {
+        _reply->abort();
+        delete _reply;
+    }
+    delete _targetFile;
+
+    // The worker threads access the files by name only; wait for them
+    _copyWatcher.waitForFinished();
+    _verifyWatcher.waitForFinished();
+}
+
+
+void DataManagement::DeltaDownload::onManifestFinished()
+{
+    if (_reply.isNull()) {
+        fail();
+        return;
+    }
+    auto* reply = _reply.data();
+    _reply = nullptr;
+    reply->deleteLater();
+    if (reply->error() != QNetworkReply::NoError) {
+        fail();
+        return;
+    }
+
+    // Read manifest
+    auto manifest = QJsonDocument::fromJson(reply->readAll()).object();
+    _blockSize = manifest.value("blockSize").toVariant().toLongLong();
+    _size = manifest.value("size").toVariant().toLongLong();
+    foreach(auto hash, manifest.value("sha1").toArray()) {
+        _hashes.append(QByteArray::fromHex(hash.toString().toLatin1()));
+    }
+    if ((_blockSize <= 0) || (_size < 0) || (_hashes.size() != (_size+_blockSize-1)/_blockSize)) {
+        fail();
+        return;
+    }
+
+    _copyWatcher.setFuture(QtConcurrent::run(&DataManagement::DeltaDownload::copyMatchingBlocks, _localFileName, _targetFileName, _blockSize, _size, _hashes));
+}
+
+
+auto DataManagement::DeltaDownload::copyMatchingBlocks(const QString& localFileName, const QString& targetFileName, qint64 blockSize, qint64 size, const QVector<QByteArray>& hashes) -> CopyResult
+{
+    CopyResult result;
+
+    QFile localFile(localFileName);
+    QFile targetFile(targetFileName);
+    if (!localFile.open(QIODevice::ReadOnly) || !targetFile.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+        return result;
+    }
+    if (!targetFile.resize(size)) {
+        return result;
+    }
+
+    // Index the blocks of the local file by their hashes. Blocks that have
+    // moved to another position by whole blocks are thus found, too.
+    QHash<QByteArray, qint64> localBlocks;
+    auto localSize = localFile.size();
+    auto numLocalBlocks = (localSize+blockSize-1)/blockSize;
+    for(qint64 i=0; i<numLocalBlocks; i++) {
+        auto block = readBlock(localFile, i, blockSize, localSize);
+        localBlocks.insert(QCryptographicHash::hash(block, QCryptographicHash::Sha1), i);
+    }
+
+    // Copy matching blocks and collect the missing ones
+    for(qint64 i=0; i<hashes.size(); i++) {
+        auto local = localBlocks.constFind(hashes[i]);
+        auto begin = i*blockSize;
+        auto end = qMin(begin+blockSize, size);
+        if (local != localBlocks.constEnd()) {
+            auto block = readBlock(localFile, local.value(), blockSize, localSize);
+            if ((block.size() == end-begin) && targetFile.seek(begin) && (targetFile.write(block) == block.size())) {
+                continue;
+            }
+        }
+
+        if (!result.missing.isEmpty() && (begin-result.missing.last().end < maxGapBlocks*blockSize)) {
+            result.missing.last().end = end;
+        } else {
+            result.missing.append({begin, end});
+        }
+    }
+
+    result.ok = true;
+    return result;
+}
+
+
+void DataManagement::DeltaDownload::onCopyFinished()
+{
+    if (_done) {
+        return;
+    }
+    auto result = _copyWatcher.result();
+    if (!result.ok) {
+        fail();
+        return;
+    }
+
+    _missing = result.missing;
+    _missingBytes = 0;
+    for(const auto& range : qAsConst(_missing)) {
+        _missingBytes += range.end-range.begin;
+    }
+
+    _targetFile = new QFile(_targetFileName);
+    if (!_targetFile->open(QIODevice::ReadWrite)) {
+        fail();
+        return;
+    }
+    startNextRange();
+}
+
+
+void DataManagement::DeltaDownload::startNextRange()
+{
+    if (_missing.isEmpty()) {
+        _targetFile->close();
+        emit progress(100);
+        _verifyWatcher.setFuture(QtConcurrent::run(&DataManagement::DeltaDownload::verify, _targetFileName, _blockSize, _size, _hashes, _sha256));
+        return;
+    }
+
+    _currentRange = _missing.takeFirst();
+    _writePosition = _currentRange.begin;
+
+    // Byte ranges refer to the file itself, so ask for no content encoding
+    QNetworkRequest request(_url);
+    request.setRawHeader("Accept-Encoding", "identity");
+    request.setRawHeader("Range", "bytes=" + QByteArray::number(_currentRange.begin) + "-" + QByteArray::number(_currentRange.end-1));
+    _reply = GlobalObject::networkAccessManager()->get(request);
+    connect(_reply, &QNetworkReply::readyRead, this, &DataManagement::DeltaDownload::onRangeDataReceived);
+    connect(_reply, &QNetworkReply::finished, this, &DataManagement::DeltaDownload::onRangeFinished);
+}
+
+
+void DataManagement::DeltaDownload::onRangeDataReceived()
+{
+    if (_reply.isNull() || _done) {
+        return;
+    }
+
+    // Servers that do not understand ranges send the full file. Give up, the
+    // full download is faster then.
+    if (_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+        _reply->abort();
+        return;
+    }
+
+    auto data = _reply->readAll();
+    if ((_writePosition+data.size() > _currentRange.end) || !_targetFile->seek(_writePosition) || (_targetFile->write(data) != data.size())) {
+        _reply->abort();
+        return;
+    }
+    _writePosition += data.size();
+    _receivedBytes += data.size();
+    if (_missingBytes > 0) {
+        emit progress(qBound(0, qRound(99.0*_receivedBytes/_missingBytes), 99));
+    }
+}
+
+
+void DataManagement::DeltaDownload::onRangeFinished()
+{
+    if (_reply.isNull()) {
+        fail();
+        return;
+    }
+    onRangeDataReceived();
+    if (_reply.isNull()) {
+        return;
+    }
+    auto* reply = _reply.data();
+    _reply = nullptr;
+    reply->deleteLater();
+    auto ok = (reply->error() == QNetworkReply::NoError) && (_writePosition == _currentRange.end);
+    if (!ok) {
+        fail();
+        return;
+    }
+    startNextRange();
+}
+
+
+auto DataManagement::DeltaDownload::verify(const QString& targetFileName, qint64 blockSize, qint64 size, const QVector<QByteArray>& hashes, const QByteArray& sha256) -> bool
+{
+    QFile targetFile(targetFileName);
+    if (!targetFile.open(QIODevice::ReadOnly) || (targetFile.size() != size)) {
+        return false;
+    }
+    QCryptographicHash fileHash(QCryptographicHash::Sha256);
+    for(qint64 i=0; i<hashes.size(); i++) {
+        auto block = readBlock(targetFile, i, blockSize, size);
+        if (QCryptographicHash::hash(block, QCryptographicHash::Sha1) != hashes[i]) {
+            return false;
+        }
+        if (!sha256.isEmpty()) {
+            fileHash.addData(block);
+        }
+    }
+    return sha256.isEmpty() || (fileHash.result() == sha256);
+}
+
+
+void DataManagement::DeltaDownload::onVerifyFinished()
+{
+    if (_done) {
+        return;
+    }
+    if (!_verifyWatcher.result()) {
+        fail();
+        return;
+    }
+    _done = true;
+    emit finished(true);
+}
+
+
+void DataManagement::DeltaDownload::fail()
+{
+    if (_done) {
+        return;
+    }
+    _done = true;
+    if (_targetFile != nullptr) {
+        _targetFile->close();
+    }
+    emit finished(false);
+}
@@ -0,0 +1,193 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QFile>
+#include <QFutureWatcher>
+#include <QNetworkReply>
+#include <QPointer>
+#include <QUrl>
+#include <QVector>
+
+
+namespace DataManagement {
+
+/*! \brief Delta update of a downloadable file
+ *
+ * This class updates a local file to a new remote version by downloading only
+ * those blocks that have changed. It relies on a block manifest that the server
+ * publishes next to the remote file, in the following JSON format.
+ *
+ * \code
+ * { "blockSize": 65536, "size": 123456789, "sha1": ["0a4d55a8…", …] }
+ * \endcode
+ *
+ * The array "sha1" holds the SHA-1 hashes of the consecutive blocks of the
+ * remote file, in hex encoding; the last block may be shorter than blockSize.
+ *
+ * The update runs in the following steps. Hashing and copying are done in a
+ * worker thread.
+ *
+ * -# The manifest is downloaded.
+ *
+ * -# The local file is cut into blocks of the same size, and their hashes are
+ *    computed. The target file is created. Every block of the remote file
+ *    whose hash matches a block of the local file is copied from there.
+ *
+ * -# The remaining blocks are downloaded with HTTP Range requests, one
+ *    request for every run of missing blocks.
+ *
+ * -# The target file is verified against the manifest and, if one has been
+ *    set with setChecksum(), against the SHA-256 hash of the remote file.
+ *
+ * The local file is never modified. Once the signal finished() has been
+ * emitted with success == true, the target file holds a verified copy of the
+ * remote file. This class is used by Downloadable, which falls back to a
+ * full download if the delta update fails.
+ */
+
+class DeltaDownload : public QObject {
+    Q_OBJECT
+
+public:
+    /*! \brief Standard constructor
+     *
+     * The update starts immediately.
+     *
+     * @param url URL of the remote file
+     *
+     * @param manifestUrl URL of the block manifest of the remote file
+     *
+     * @param localFileName Name of the local file, holding an older version of
+     * the remote file
+     *
+     * @param targetFileName Name of the file that will hold the new version
+     *
+     * @param parent The standard QObject parent
+     */
+    DeltaDownload(QUrl url, QUrl manifestUrl, QString localFileName, QString targetFileName, QObject* parent = nullptr);
+
+    /*! \brief Standard destructor
+     *
+     * If the update is still running, it is aborted.
+     */
+    ~DeltaDownload() override;
+
+    /*! \brief Set the SHA-256 hash of the remote file
+     *
+     * If set, the target file is also checked against this hash. The hash is
+     * computed while the blocks are verified, so that the target file is read
+     * only once. The method must be called before the update has finished,
+     * typically right after construction.
+     *
+     * @param sha256 SHA-256 hash of the remote file, as raw bytes. If empty,
+     * no check is done.
+     */
+    void setChecksum(const QByteArray& sha256) { _sha256 = sha256; }
+
+signals:
+    /*! \brief Progress of the update
+     *
+     * @param percent Progress in percent
+     */
+    void progress(int percent);
+
+    /*! \brief The update has finished
+     *
+     * @param success True if the target file now holds a verified copy of the
+     * remote file
+     */
+    void finished(bool success);
+
+private slots:
+    // Called when the manifest has been downloaded
+    void onManifestFinished();
+
+    // Called when the worker thread has copied all matching blocks
+    void onCopyFinished();
+
+    // Called when data of a range request arrives, or the request is done
+    void onRangeDataReceived();
+    void onRangeFinished();
+
+    // Called when the worker thread has verified the target file
+    void onVerifyFinished();
+
+private:
+    Q_DISABLE_COPY_MOVE(DeltaDownload)
+
+    // Range of bytes that must be downloaded
+    struct Range {
+        qint64 begin;
+        qint64 end;
+    };
+
+    // Copies all matching blocks from the local file to the target file and
+    // returns the ranges that are still missing. In case of an error, the
+    // method sets ok to false. This method runs in a worker thread.
+    struct CopyResult {
+        bool ok {false};
+        QVector<Range> missing;
+    };
+    static CopyResult copyMatchingBlocks(const QString& localFileName, const QString& targetFileName, qint64 blockSize, qint64 size, const QVector<QByteArray>& hashes);
+
+    // Checks all blocks of the target file against the hashes, and the whole
+    // file against sha256 unless that is empty. This method runs in a worker
+    // thread.
+    static bool verify(const QString& targetFileName, qint64 blockSize, qint64 size, const QVector<QByteArray>& hashes, const QByteArray& sha256);
+
+    // Starts the next range request, or verification if there is none left
+    void startNextRange();
+
+    // Emits finished(false), once
+    void fail();
+
+    QUrl _url;
+    QString _localFileName;
+    QString _targetFileName;
+
+    // Data from the manifest
+    qint64 _blockSize {0};
+    qint64 _size {0};
+    QVector<QByteArray> _hashes;
+
+    // SHA-256 hash of the remote file, as set with setChecksum()
+    QByteArray _sha256;
+
+    // Ranges that still need to be downloaded, and progress
+    QVector<Range> _missing;
+    qint64 _missingBytes {0};
+    qint64 _receivedBytes {0};
+
+    // Range that is currently being downloaded, and the position where the
+    // next bytes go
+    QPointer<QNetworkReply> _reply;
+    Range _currentRange {0, 0};
+    qint64 _writePosition {0};
+    QFile* _targetFile {nullptr};
+
+    QFutureWatcher<CopyResult> _copyWatcher;
+    QFutureWatcher<bool> _verifyWatcher;
+
+    bool _done {false};
+};
+
+};
@@ -0,0 +1,276 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QSettings>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+using namespace std::chrono_literals;
+
+#include "DownloadScheduler.h"
+#include "positioning/PositionProvider.h"
+
+
+DataManagement::DownloadScheduler::DownloadScheduler(QObject* parent)
+    : QObject(parent)
+{
+    QSettings settings;
+    _maxConcurrentDownloads = qMax(1, settings.value("DownloadScheduler/maxConcurrentDownloads", _maxConcurrentDownloads).toInt());
+
+    _scheduleTimer.setSingleShot(true);
+    connect(&_scheduleTimer, &QTimer::timeout, this, &DownloadScheduler::schedule);
+}
+
+
+void DataManagement::DownloadScheduler::setMaxConcurrentDownloads(int max)
+{
+    max = qMax(1, max);
+    if (max == _maxConcurrentDownloads) {
+        return;
+    }
+    _maxConcurrentDownloads = max;
+    QSettings settings;
+    settings.setValue("DownloadScheduler/maxConcurrentDownloads", _maxConcurrentDownloads);
+    emit maxConcurrentDownloadsChanged();
+    _scheduleTimer.start(0);
+}
+
+
+void DataManagement::DownloadScheduler::setPaused(bool paused)
+{
+    if (paused == _paused) {
+        return;
+    }
+    _paused = paused;
+
+    if (_paused) {
+        // Put the running downloads back to the queue, keeping the partial
+        // files
+        foreach(auto entry, _running) {
+            if (entry.downloadable.isNull()) {
+                continue;
+            }
+            disconnect(entry.downloadable, nullptr, this, nullptr);
+            entry.downloadable->pauseFileDownload();
+            entry.notBefore = QDeadlineTimer(0);
+            _queue.prepend(entry);
+        }
+        _running.clear();
+        _scheduleTimer.stop();
+    } else {
+        _scheduleTimer.start(0);
+    }
+    emit pausedChanged();
+}
+
+
+void DataManagement::DownloadScheduler::enqueue(DataManagement::Downloadable* downloadable)
+{
+    if ((downloadable == nullptr) || (queueIndex(downloadable) >= 0)) {
+        return;
+    }
+    foreach(auto entry, _running) {
+        if (entry.downloadable == downloadable) {
+            return;
+        }
+    }
+
+    Entry entry;
+    entry.downloadable = downloadable;
+    _queue.append(entry);
+    emit pendingDownloadsChanged();
+    _scheduleTimer.start(0);
+}
+
+
+void DataManagement::DownloadScheduler::remove(DataManagement::Downloadable* downloadable)
+{
+    auto index = queueIndex(downloadable);
+    if (index >= 0) {
+        _queue.remove(index);
+        emit pendingDownloadsChanged();
+        return;
+    }
+    for(int i=0; i<_running.size(); i++) {
+        if (_running[i].downloadable == downloadable) {
+            _running.remove(i);
+            release(downloadable);
+            downloadable->stopFileDownload();
+            emit pendingDownloadsChanged();
+            _scheduleTimer.start(0);
+            return;
+        }
+    }
+}
+
+
+void DataManagement::DownloadScheduler::schedule()
+{
+    auto oldPendingDownloads = pendingDownloads();
+
+    // Handle downloads that have ended. Downloads that failed go back to the
+    // queue, unless they failed too often.
+    for(int i=_running.size()-1; i>=0; i--) {
+        auto entry = _running[i];
+        if (!entry.downloadable.isNull() && entry.downloadable->downloading()) {
+            continue;
+        }
+        _running.remove(i);
+        if (entry.downloadable.isNull()) {
+            continue;
+        }
+        release(entry.downloadable);
+        if (entry.failed && (entry.failures < maxFailures)) {
+            entry.failed = false;
+            entry.notBefore = QDeadlineTimer(30s*(1 << (entry.failures-1)));
+            _queue.append(entry);
+        }
+    }
+
+    if (_paused) {
+        if (pendingDownloads() != oldPendingDownloads) {
+            emit pendingDownloadsChanged();
+        }
+        return;
+    }
+
+    // Sort the queue by priority
+    auto position = Positioning::PositionProvider::lastValidCoordinate();
+    std::stable_sort(_queue.begin(), _queue.end(), [position](const Entry& a, const Entry& b) {
+        if (a.downloadable.isNull() || b.downloadable.isNull()) {
+            return !a.downloadable.isNull() && b.downloadable.isNull();
+        }
+        auto categoryA = category(a.downloadable);
+        auto categoryB = category(b.downloadable);
+        if (categoryA != categoryB) {
+            return categoryA < categoryB;
+        }
+        return distance(a.downloadable, position) < distance(b.downloadable, position);
+    });
+
+    // Start downloads while there are free slots
+    qint64 nextRetry = -1;
+    for(int i=0; (i<_queue.size()) && (_running.size()<_maxConcurrentDownloads); ) {
+        if (!_queue[i].notBefore.hasExpired()) {
+            auto remaining = _queue[i].notBefore.remainingTime();
+            nextRetry = (nextRetry < 0) ? remaining : qMin(nextRetry, remaining);
+            i++;
+            continue;
+        }
+
+        auto entry = _queue.takeAt(i);
+        auto downloadable = entry.downloadable;
+
+        // Skip Downloadables that have been deleted, are already being
+        // downloaded, or have been installed in the meantime
+        if (downloadable.isNull() || downloadable->downloading()) {
+            continue;
+        }
+        if (downloadable->hasFile() && !downloadable->updatable()) {
+            continue;
+        }
+
+        _running.append(entry);
+        connect(downloadable, &Downloadable::downloadingChanged, this, &DownloadScheduler::onDownloadingChanged);
+        connect(downloadable, &Downloadable::error, this, &DownloadScheduler::onError);
+        downloadable->startFileDownload();
+    }
+    if (nextRetry >= 0) {
+        _scheduleTimer.start(static_cast<int>(nextRetry));
+    }
+
+    if (pendingDownloads() != oldPendingDownloads) {
+        emit pendingDownloadsChanged();
+    }
+}
+
+
+void DataManagement::DownloadScheduler::onDownloadingChanged()
+{
+    // Defer the handling: if the download failed, the signal 'error' follows
+    // right after this one.
+    _scheduleTimer.start(0);
+}
+
+
+void DataManagement::DownloadScheduler::onError()
+{
+    auto* downloadable = qobject_cast<Downloadable*>(sender());
+    for(auto& entry : _running) {
+        if (entry.downloadable == downloadable) {
+            entry.failed = true;
+            entry.failures++;
+        }
+    }
+    _scheduleTimer.start(0);
+}
+
+
+auto DataManagement::DownloadScheduler::category(const Downloadable* downloadable) -> int
+{
+    auto fileName = downloadable->fileName();
+    if (fileName.endsWith(u".geojson")) {
+        return 0;
+    }
+    if (fileName.endsWith(u".txt")) {
+        return 1;
+    }
+    if (fileName.endsWith(u".mbtiles")) {
+        return 2;
+    }
+    if (fileName.endsWith(u".terrain")) {
+        return 3;
+    }
+    return 4;
+}
+
+
+auto DataManagement::DownloadScheduler::distance(const Downloadable* downloadable, const QGeoCoordinate& position) -> double
+{
+    auto boundingBox = downloadable->boundingBox();
+    if (!boundingBox.isValid() || !position.isValid()) {
+        return std::numeric_limits<double>::infinity();
+    }
+    if (boundingBox.contains(position)) {
+        return 0.0;
+    }
+    return position.distanceTo(boundingBox.center());
+}
+
+
+auto DataManagement::DownloadScheduler::queueIndex(const Downloadable* downloadable) const -> int
+{
+    for(int i=0; i<_queue.size(); i++) {
+        if (_queue[i].downloadable == downloadable) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+void DataManagement::DownloadScheduler::release(Downloadable* downloadable)
+{
+    if (downloadable != nullptr) {
+        disconnect(downloadable, nullptr, this, nullptr);
+    }
+}
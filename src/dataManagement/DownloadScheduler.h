@@ -0,0 +1,183 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QDeadlineTimer>
+#include <QTimer>
+
+#include "Downloadable.h"
+
+
+namespace DataManagement {
+
+/*! \brief Schedules downloads of Downloadable objects
+
+  This class holds a queue of Downloadable objects that should be downloaded,
+  and starts the downloads one by one, so that only a limited number of them
+  compete for bandwidth and flash memory. The queue is ordered by priority:
+  aviation maps come before databases, which come before base maps. Within
+  each class, maps that cover the current position, or are close to it, come
+  first. Failed downloads are retried after a delay that doubles with every
+  failure, and are dropped after a few attempts.
+
+  Downloads that are started directly with Downloadable::startFileDownload()
+  are not managed by this class and do not count towards the limit.
+*/
+
+class DownloadScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Standard constructor
+
+      @param parent The standard QObject parent
+    */
+    explicit DownloadScheduler(QObject* parent = nullptr);
+
+    /*! \brief Maximal number of downloads that run at the same time
+
+      The value is saved in the settings and restored at the next start of
+      the app. It is at least one.
+    */
+    Q_PROPERTY(int maxConcurrentDownloads READ maxConcurrentDownloads WRITE setMaxConcurrentDownloads NOTIFY maxConcurrentDownloadsChanged)
+
+    /*! \brief Getter function for the property with the same name
+
+      @returns Property maxConcurrentDownloads
+    */
+    int maxConcurrentDownloads() const { return _maxConcurrentDownloads; }
+
+    /*! \brief Setter function for the property with the same name
+
+      @param max Property maxConcurrentDownloads
+    */
+    void setMaxConcurrentDownloads(int max);
+
+    /*! \brief Indicates if the scheduler is paused
+
+      While the scheduler is paused, no downloads are started. Pausing the
+      scheduler pauses all downloads that it has started, keeping the
+      partially downloaded data. Once the scheduler is resumed, these
+      downloads continue where they left off.
+    */
+    Q_PROPERTY(bool paused READ paused WRITE setPaused NOTIFY pausedChanged)
+
+    /*! \brief Getter function for the property with the same name
+
+      @returns Property paused
+    */
+    bool paused() const { return _paused; }
+
+    /*! \brief Setter function for the property with the same name
+
+      @param paused Property paused
+    */
+    void setPaused(bool paused);
+
+    /*! \brief Number of downloads that are queued or running */
+    Q_PROPERTY(int pendingDownloads READ pendingDownloads NOTIFY pendingDownloadsChanged)
+
+    /*! \brief Getter function for the property with the same name
+
+      @returns Property pendingDownloads
+    */
+    int pendingDownloads() const { return _queue.size() + _running.size(); }
+
+    /*! \brief Add a Downloadable to the queue
+
+      If the Downloadable is already queued or running, this method does
+      nothing. The download starts as soon as a slot is free and no
+      Downloadable of higher priority is waiting.
+
+      @param downloadable Downloadable to download
+    */
+    Q_INVOKABLE void enqueue(DataManagement::Downloadable* downloadable);
+
+    /*! \brief Remove a Downloadable from the queue
+
+      If the download is already running, it is stopped and the partially
+      downloaded data is deleted.
+
+      @param downloadable Downloadable to remove
+    */
+    Q_INVOKABLE void remove(DataManagement::Downloadable* downloadable);
+
+signals:
+    /*! \brief Notifier signal */
+    void maxConcurrentDownloadsChanged();
+
+    /*! \brief Notifier signal */
+    void pausedChanged();
+
+    /*! \brief Notifier signal */
+    void pendingDownloadsChanged();
+
+private slots:
+    // Starts downloads as long as there are free slots
+    void schedule();
+
+    // Connected to the signals of the running Downloadable objects
+    void onDownloadingChanged();
+    void onError();
+
+private:
+    Q_DISABLE_COPY_MOVE(DownloadScheduler)
+
+    // Queued download
+    struct Entry {
+        QPointer<Downloadable> downloadable;
+
+        // Number of failed attempts so far
+        int failures {0};
+
+        // Set if the running download reported an error
+        bool failed {false};
+
+        // Earliest time of the next attempt
+        QDeadlineTimer notBefore {0};
+    };
+
+    // Priority of a Downloadable, smaller numbers come first
+    static int category(const Downloadable* downloadable);
+    static double distance(const Downloadable* downloadable, const QGeoCoordinate& position);
+
+    // Index of the Downloadable in _queue, or -1
+    int queueIndex(const Downloadable* downloadable) const;
+
+    // Stops watching a running Downloadable
+    void release(Downloadable* downloadable);
+
+    // Number of failed attempts after which a download is dropped
+    static constexpr int maxFailures = 5;
+
+    QVector<Entry> _queue;
+    QVector<Entry> _running;
+
+    int _maxConcurrentDownloads {2};
+    bool _paused {false};
+
+    // Triggers schedule(), coalescing several requests into one, and waking
+    // up the scheduler when a retry is due
+    QTimer _scheduleTimer;
+};
+
+};
@@ -22,12 +22,33 @@
 #include <QFileInfo>
 #include <QLocale>
 #include <QLockFile>
+#include <cstdio>
 #include <utility>
 
 #include "Downloadable.h"
+#include "FileRegistry.h"
 #include "GlobalObject.h"
 #include "Settings.h"
 
+
+namespace {
+
+// Renames a file, replacing the target file if it exists. On POSIX systems,
+// the target is replaced in a single step, so that after a crash either the
+// old or the new file is present. Where the system cannot rename over an
+// existing file, the target is removed first.
+auto renameOver(const QString& oldName, const QString& newName) -> bool
+{
+    if (std::rename(QFile::encodeName(oldName).constData(), QFile::encodeName(newName).constData()) == 0) {
+        return true;
+    }
+    QFile::remove(newName);
+    return QFile::rename(oldName, newName);
+}
+
+} // namespace
+
+
 DataManagement::Downloadable::Downloadable(QUrl url, const QString &fileName, QObject *parent)
     : QObject(parent), _url(std::move(url)) {
     // Paranoid safety checks
@@ -48,8 +69,8 @@ DataManagement::Downloadable::Downloadable(QUrl url, const QString &fileName, QO
 DataManagement::Downloadable::~Downloadable() {
     // Free all ressources
     delete _networkReplyDownloadFile;
-    delete _networkReplyDownloadHeader;
-    delete _saveFile;
+    delete _deltaDownload;
+    delete _partialFile;
 }
 
 
@@ -93,12 +114,10 @@ auto DataManagement::Downloadable::fileContent() const -> QByteArray {
         return QByteArray();
     }
 
-    QLockFile lockFile(_fileName + ".lock");
-    lockFile.lock();
+    FileRegistry::ReadLocker locker(_fileName);
     file.open(QIODevice::ReadOnly);
     QByteArray result = file.readAll();
     file.close();
-    lockFile.unlock();
 
     return result;
 }
@@ -114,6 +133,7 @@ void DataManagement::Downloadable::setRemoteFileDate(const QDateTime &date) {
     bool oldUpdatable = updatable();
 
     _remoteFileDate = date;
+    _deltaUpdateFailed = false;
 
     // Emit signals as appropriate
     if (oldUpdatable != updatable()) {
@@ -148,6 +168,12 @@ void DataManagement::Downloadable::setRemoteFileSize(qint64 size) {
 }
 
 
+void DataManagement::Downloadable::setBlockManifestUrl(const QUrl& url)
+{
+    _blockManifestUrl = url;
+}
+
+
 void DataManagement::Downloadable::setSection(const QString& sectionName)
 {
     if (sectionName == _section) {
@@ -172,6 +198,9 @@ auto DataManagement::Downloadable::updatable() const -> bool {
 
 
 void DataManagement::Downloadable::deleteFile() {
+    // Cancel the installation of a file that is currently being processed
+    _downloadGeneration++;
+
     // If the local file does not exist, there is nothing to do
     if (!QFile::exists(_fileName)) {
         return;
@@ -181,10 +210,16 @@ void DataManagement::Downloadable::deleteFile() {
     bool oldUpdatable = updatable();
 
     emit aboutToChangeFile(_fileName);
-    QLockFile lockFile(_fileName + ".lock");
-    lockFile.lock();
-    QFile::remove(_fileName);
-    lockFile.unlock();
+    {
+        FileRegistry::WriteLocker locker(_fileName);
+        QLockFile lockFile(_fileName + ".lock");
+        lockFile.lock();
+        QFile::remove(_fileName);
+        lockFile.unlock();
+    }
+    QFile::remove(partialFileName());
+    QFile::remove(partialFileValidatorName());
+    QFile::remove(fileValidatorName());
     emit hasFileChanged();
     emit fileContentChanged();
 
@@ -195,21 +230,6 @@ void DataManagement::Downloadable::deleteFile() {
 }
 
 
-void DataManagement::Downloadable::startInfoDownload() {
-
-    // Do not start a new check if an old one is still running
-    if (!_networkReplyDownloadHeader.isNull()) {
-        return;
-    }
-
-    // Start the download process for the remote file info
-    _networkReplyDownloadHeader = GlobalObject::networkAccessManager()->head(QNetworkRequest(_url));
-    connect(_networkReplyDownloadHeader, &QNetworkReply::finished, this,
-            &Downloadable::downloadHeaderFinished);
-
-}
-
-
 void DataManagement::Downloadable::startFileDownload() {
 
     // Do not begin a new download if one is already running
@@ -222,8 +242,8 @@ void DataManagement::Downloadable::startFileDownload() {
     auto oldDownloadProgress =_downloadProgress;
     auto oldIsDownloading = downloading();
 
-    // Clear temporary file
-    delete _saveFile;
+    // Clear partial file
+    delete _partialFile;
 
     // Create directory that will hold the local file, if it does not yet exist
     QDir dir(QFileInfo(_fileName).dir());
@@ -231,17 +251,22 @@ void DataManagement::Downloadable::startFileDownload() {
         dir.mkpath(".");
     }
 
-    // Copy the temporary file to the local file
-    _saveFile = new QSaveFile(_fileName, this);
-    _saveFile->open(QIODevice::WriteOnly);
-
-    // Start download
-    QNetworkRequest request(_url);
-    _networkReplyDownloadFile = GlobalObject::networkAccessManager()->get(request);
-    connect(_networkReplyDownloadFile, &QNetworkReply::finished, this, &Downloadable::downloadFileFinished);
-    connect(_networkReplyDownloadFile, &QNetworkReply::readyRead, this, &Downloadable::downloadFilePartialDataReceiver);
-    connect(_networkReplyDownloadFile, &QNetworkReply::downloadProgress, this, &Downloadable::downloadFileProgressReceiver);
-    connect(_networkReplyDownloadFile, &QNetworkReply::errorOccurred, this, &Downloadable::downloadFileErrorReceiver);
+    // If an older version of the file is installed and the server publishes a
+    // block manifest, try a delta update first. Do not try if a full
+    // download is waiting to be resumed.
+    if (_blockManifestUrl.isValid() && !_deltaUpdateFailed && QFile::exists(_fileName) && !QFile::exists(partialFileName())) {
+        _deltaDownload = new DeltaDownload(_url, _blockManifestUrl, _fileName, partialFileName(), this);
+        _deltaDownload->setChecksum(_checksum);
+        connect(_deltaDownload, &DeltaDownload::progress, this, [this](int percent) {
+            if (percent != _downloadProgress) {
+                _downloadProgress = percent;
+                emit downloadProgressChanged(_downloadProgress);
+            }
+        });
+        connect(_deltaDownload, &DeltaDownload::finished, this, &Downloadable::deltaDownloadFinished);
+    } else {
+        startFullFileDownload();
+    }
     _downloadProgress = 0;
 
     // Emit signals as appropriate
@@ -257,27 +282,144 @@ void DataManagement::Downloadable::startFileDownload() {
 }
 
 
-void DataManagement::Downloadable::stopFileDownload() {
+void DataManagement::Downloadable::startFullFileDownload() {
+    // Prepare request. Ask for the file without content encoding, so that
+    // byte ranges refer to the file itself.
+    QNetworkRequest request(_url);
+    request.setRawHeader("Accept-Encoding", "identity");
+
+    // If there is a partial file from an earlier attempt, together with a
+    // validator for the same URL, then ask only for the missing data. The
+    // header "If-Range" makes sure that the server sends the full file if the
+    // remote file has changed in the meantime.
+    _resumeOffset = 0;
+    QFile validatorFile(partialFileValidatorName());
+    if (QFile::exists(partialFileName()) && validatorFile.open(QIODevice::ReadOnly)) {
+        auto url = QUrl::fromEncoded(validatorFile.readLine().trimmed());
+        auto validator = validatorFile.readLine().trimmed();
+        auto size = QFileInfo(partialFileName()).size();
+        if ((url == _url) && !validator.isEmpty() && (size > 0)) {
+            _resumeOffset = size;
+            request.setRawHeader("Range", "bytes=" + QByteArray::number(size) + "-");
+            request.setRawHeader("If-Range", validator);
+        }
+    }
+
+    // If conditional requests are used, ask the server to send the file only
+    // if it differs from the local file
+    if (_useConditionalRequests && (_resumeOffset == 0) && hasFile()) {
+        QFile fileValidator(fileValidatorName());
+        if (fileValidator.open(QIODevice::ReadOnly)) {
+            auto url = QUrl::fromEncoded(fileValidator.readLine().trimmed());
+            auto validator = fileValidator.readLine().trimmed();
+            if ((url == _url) && !validator.isEmpty()) {
+                // Entity tags are quoted strings, everything else is a date
+                request.setRawHeader(validator.startsWith('"') ? "If-None-Match" : "If-Modified-Since", validator);
+            }
+        }
+    }
+
+    // Start download
+    _networkReplyDownloadFile = GlobalObject::networkAccessManager()->get(request);
+    connect(_networkReplyDownloadFile, &QNetworkReply::finished, this, &Downloadable::downloadFileFinished);
+    connect(_networkReplyDownloadFile, &QNetworkReply::readyRead, this, &Downloadable::downloadFilePartialDataReceiver);
+    connect(_networkReplyDownloadFile, &QNetworkReply::downloadProgress, this, &Downloadable::downloadFileProgressReceiver);
+    connect(_networkReplyDownloadFile, &QNetworkReply::errorOccurred, this, &Downloadable::downloadFileErrorReceiver);
+}
+
+
+void DataManagement::Downloadable::deltaDownloadFinished(bool success) {
+    if (_deltaDownload.isNull()) {
+        return;
+    }
+    _deltaDownload->deleteLater();
+    _deltaDownload = nullptr;
+
+    // If the delta update failed, download the full file instead
+    if (!success) {
+        QFile::remove(partialFileName());
+        _deltaUpdateFailed = true;
+        startFileDownload();
+        return;
+    }
+    processAndInstallPartialFile();
+}
+
+
+void DataManagement::Downloadable::abortFileDownload(bool keepPartialFile) {
 
     // Do stop a new download if none is already running
     if (!downloading()) {
         return;
     }
 
-    // Save old value to see if anything changed
+    // Save old values to see if anything changed
     bool oldUpdatable = updatable();
+    bool oldIsDownloading = downloading();
 
-    // Stop the download
-    _networkReplyDownloadFile->deleteLater();
-    _networkReplyDownloadFile = nullptr;
-    delete _saveFile;
+    // Stop the download. The partial file of an interrupted delta update
+    // cannot be resumed. A partial file that is being processed is discarded
+    // once processing ends; until then, the download counts as running, so
+    // that no new download writes to the partial file.
+    _downloadGeneration++;
+    if (!_deltaDownload.isNull() || _processingPartialFile) {
+        keepPartialFile = false;
+    }
+    if (!_networkReplyDownloadFile.isNull()) {
+        _networkReplyDownloadFile->deleteLater();
+        _networkReplyDownloadFile = nullptr;
+    }
+    delete _deltaDownload;
+    delete _partialFile;
+    if (!keepPartialFile) {
+        QFile::remove(partialFileName());
+        QFile::remove(partialFileValidatorName());
+    }
 
     // Emit signals as appropriate
     if (oldUpdatable != updatable()) {
         emit updatableChanged();
     }
-    emit downloadingChanged();
+    if (oldIsDownloading != downloading()) {
+        emit downloadingChanged();
+    }
+}
 
+
+auto DataManagement::Downloadable::openPartialFile() -> bool {
+    auto status = _networkReplyDownloadFile->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    // If the server sends only the missing part, then append. Otherwise, it
+    // ignored the range or the remote file has changed; start from scratch.
+    _partialFile = new QFile(partialFileName(), this);
+    if ((status == 206) && (_resumeOffset > 0)) {
+        if (!_partialFile->open(QIODevice::WriteOnly|QIODevice::Append)) {
+            return false;
+        }
+    } else {
+        _resumeOffset = 0;
+        if (!_partialFile->open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+            return false;
+        }
+    }
+
+    // Data is hashed as it arrives. The data of a resumed download that is
+    // already present is not read here, on the GUI thread. Instead, the
+    // complete file is hashed in the thread pool once the download is
+    // finished.
+    _partialFileHash.reset();
+
+    // Remember the validator of the remote file, so that the download can be
+    // resumed if it is interrupted
+    auto validator = _networkReplyDownloadFile->rawHeader("ETag");
+    if (validator.isEmpty() || validator.startsWith("W/")) {
+        validator = _networkReplyDownloadFile->rawHeader("Last-Modified");
+    }
+    QFile validatorFile(partialFileValidatorName());
+    if (validatorFile.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+        validatorFile.write(_url.toEncoded() + "\n" + validator + "\n");
+    }
+    return true;
 }
 
 
@@ -289,8 +431,27 @@ void DataManagement::Downloadable::downloadFileErrorReceiver(QNetworkReply::Netw
         return;
     }
 
-    // Stop the download
-    stopFileDownload();
+    // If the partial file is already complete, the server answers the request
+    // for the missing data with "Range Not Satisfiable". Install the partial
+    // file then, rather than retrying the download over and over. A partial
+    // file of the wrong size is discarded.
+    if (!_networkReplyDownloadFile.isNull() && (_resumeOffset > 0)
+            && (_networkReplyDownloadFile->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 416)) {
+        if ((_remoteFileSize >= 0) && (_resumeOffset != _remoteFileSize)) {
+            abortFileDownload(false);
+            return;
+        }
+        _networkReplyDownloadFile->disconnect(this);
+        _networkReplyDownloadFile->deleteLater();
+        _networkReplyDownloadFile = nullptr;
+        delete _partialFile;
+        processAndInstallPartialFile(true);
+        return;
+    }
+
+    // Stop the download, but keep the partial file so that the download can
+    // be resumed
+    abortFileDownload(true);
 
     // Do not do anything about SSL errors; this has already been handled by the SSLErrorHandler
     if ((code == QNetworkReply::SslHandshakeFailedError) &&
@@ -461,19 +622,96 @@ void DataManagement::Downloadable::downloadFileErrorReceiver(QNetworkReply::Netw
 
 void DataManagement::Downloadable::downloadFileFinished() {
     // Paranoid safety checks
-    //  Q_ASSERT(!_networkReplyDownloadFile.isNull() && !_tmpFile.isNull());
-    if (_networkReplyDownloadFile.isNull() || _saveFile.isNull()) {
+    if (_networkReplyDownloadFile.isNull()) {
         stopFileDownload();
         return;
     }
     if (_networkReplyDownloadFile->error() != QNetworkReply::NoError) {
-        stopFileDownload();
+        abortFileDownload(true);
         return;
     }
 
-    // Read the last remaining bits of data, then close the temporary file
+    // If the server answers a conditional request with "Not Modified", the
+    // local file is current
+    if (_networkReplyDownloadFile->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        abortFileDownload(false);
+        emit fileUnchanged();
+        return;
+    }
+
+    // Read the last remaining bits of data, then close the partial file
     downloadFilePartialDataReceiver();
+    if (_partialFile.isNull() && !openPartialFile()) {
+        stopFileDownload();
+        return;
+    }
+    _partialFile->close();
+
+    // Reject the file if it does not match the checksum. If the download was
+    // resumed, the checksum is verified by processAndInstallPartialFile().
+    auto resumed = (_resumeOffset > 0);
+    if (!_checksum.isEmpty() && !resumed && (_partialFileHash.result() != _checksum)) {
+        abortFileDownload(false);
+        emit error(objectName(), tr("the downloaded file is corrupt"));
+        return;
+    }
+
+    // Delete the data structures for the download
+    delete _partialFile;
+    _networkReplyDownloadFile->deleteLater();
+    _networkReplyDownloadFile = nullptr;
+
+    processAndInstallPartialFile(resumed);
+}
+
 
+auto DataManagement::Downloadable::processAndInstallPartialFile(bool verifyChecksum) -> Async::Task
+{
+    verifyChecksum = verifyChecksum && !_checksum.isEmpty();
+    if (!verifyChecksum && !_fileProcessor) {
+        installPartialFile();
+        co_return;
+    }
+
+    _processingPartialFile = true;
+    emit downloadingChanged();
+    auto generation = _downloadGeneration;
+    auto fileName = partialFileName();
+
+    // Hash the complete file, in the thread pool
+    auto checksumMatches = true;
+    if (verifyChecksum) {
+        auto checksum = _checksum;
+        checksumMatches = co_await Async::inThreadPool(this, [fileName, checksum]() {
+            QFile file(fileName);
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            return file.open(QIODevice::ReadOnly) && hash.addData(&file) && (hash.result() == checksum);
+        });
+    }
+
+    // Run the file processor, in the thread pool
+    if (checksumMatches && (generation == _downloadGeneration) && _fileProcessor) {
+        auto processor = _fileProcessor;
+        co_await Async::inThreadPool(this, [processor, fileName]() { processor(fileName); });
+    }
+    _processingPartialFile = false;
+
+    // If the file is corrupt, or if the download was stopped or the file
+    // deleted in the meantime, discard the partial file
+    if (!checksumMatches || (generation != _downloadGeneration)) {
+        QFile::remove(partialFileName());
+        QFile::remove(partialFileValidatorName());
+        emit downloadingChanged();
+        if (!checksumMatches && (generation == _downloadGeneration)) {
+            emit error(objectName(), tr("the downloaded file is corrupt"));
+        }
+        co_return;
+    }
+    installPartialFile();
+}
+
+
+void DataManagement::Downloadable::installPartialFile() {
     // Download is now finished to 100%
     if (_downloadProgress != 100) {
         _downloadProgress = 100;
@@ -484,18 +722,23 @@ void DataManagement::Downloadable::downloadFileFinished() {
     bool oldIsUpdatable = updatable();
     bool oldHasLocalFile = hasFile();
 
-    // Copy the temporary file to the local file
+    // Replace the local file by the partial file
     emit aboutToChangeFile(_fileName);
-    QLockFile lockFile(_fileName + ".lock");
-    lockFile.lock();
-    _saveFile->commit();
-    lockFile.unlock();
+    {
+        FileRegistry::WriteLocker locker(_fileName);
+        QLockFile lockFile(_fileName + ".lock");
+        lockFile.lock();
+        renameOver(partialFileName(), _fileName);
+        lockFile.unlock();
+    }
+    if (_useConditionalRequests) {
+        renameOver(partialFileValidatorName(), fileValidatorName());
+    } else {
+        QFile::remove(fileValidatorName());
+        QFile::remove(partialFileValidatorName());
+    }
     emit fileContentChanged();
-
-    // Delete the data structures for the download
-    delete _saveFile;
-    _networkReplyDownloadFile->deleteLater();
-    _networkReplyDownloadFile = nullptr;
+    _deltaUpdateFailed = false;
 
     // Emit signals as appropriate
     if (oldIsUpdatable != updatable()) {
@@ -513,8 +756,13 @@ void DataManagement::Downloadable::downloadFileProgressReceiver(qint64 bytesRece
 
     // If the content is compressed, then Qt does not know the total size and will set 'bytesTotal' to -1. In that case, the number _remoteFileSize might be a better estimate.
     if ((bytesTotal < 0) && (_remoteFileSize > 0)) {
-        bytesTotal = _remoteFileSize;
+        bytesTotal = _remoteFileSize-_resumeOffset;
     }
+
+    // If the download has been resumed, the numbers refer to the missing part only
+    bytesReceived += _resumeOffset;
+    bytesTotal += _resumeOffset;
+
     if (bytesTotal <= 0) {
         _downloadProgress = 0;
     } else {
@@ -532,48 +780,28 @@ void DataManagement::Downloadable::downloadFileProgressReceiver(qint64 bytesRece
 
 void DataManagement::Downloadable::downloadFilePartialDataReceiver() {
     // Paranoid safety checks
-    if (_networkReplyDownloadFile.isNull() || _saveFile.isNull()) {
+    if (_networkReplyDownloadFile.isNull()) {
         stopFileDownload();
         return;
     }
     if (_networkReplyDownloadFile->error() != QNetworkReply::NoError) {
         return;
     }
-
-    // Write all available data to the temporary file
-    _saveFile->write(_networkReplyDownloadFile->readAll());
-}
-
-
-void DataManagement::Downloadable::downloadHeaderFinished() {
-    // Paranoid safety checks
-    Q_ASSERT(!_networkReplyDownloadHeader.isNull());
-    if (_networkReplyDownloadHeader.isNull()) {
+    if (_networkReplyDownloadFile->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
         return;
     }
-    if (_networkReplyDownloadHeader->error() != QNetworkReply::NoError) {
+
+    // Open the partial file when the first data arrives. By then, the status
+    // code of the reply is known.
+    if (_partialFile.isNull() && !openPartialFile()) {
+        stopFileDownload();
         return;
     }
 
-    // Save old value to see if anything changed
-    bool oldUpdatable = updatable();
-
-    // Update remote file information
-    auto old_remoteFileDate = _remoteFileDate;
-    auto old_remoteFileSize = _remoteFileSize;
-    _remoteFileDate =
-            _networkReplyDownloadHeader->header(QNetworkRequest::LastModifiedHeader).toDateTime();
-    _remoteFileSize =
-            _networkReplyDownloadHeader->header(QNetworkRequest::ContentLengthHeader).toLongLong();
-
-    // Emit signals as appropriate
-    if (_remoteFileDate != old_remoteFileDate) {
-        emit remoteFileDateChanged();
-    }
-    if (_remoteFileSize != old_remoteFileSize) {
-        emit remoteFileSizeChanged();
-    }
-    if (oldUpdatable != updatable()) {
-        emit updatableChanged();
+    // Write all available data to the partial file, and hash it
+    auto data = _networkReplyDownloadFile->readAll();
+    _partialFile->write(data);
+    if (!_checksum.isEmpty() && (_resumeOffset == 0)) {
+        _partialFileHash.addData(data);
     }
 }
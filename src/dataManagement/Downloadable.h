@@ -20,12 +20,20 @@
 
 #pragma once
 
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
+#include <QGeoRectangle>
 #include <QNetworkReply>
 #include <QPointer>
-#include <QSaveFile>
+
+#include <functional>
+#include <memory>
+
+#include "Async.h"
+#include "dataManagement/DeltaDownload.h"
+#include "dataManagement/MappedFile.h"
 
 
 namespace DataManagement {
@@ -38,7 +46,9 @@ namespace DataManagement {
   - Download the file asynchronously from the server.
 
   - Check if a newer version of the file is available at the URL and update the
-    file if desired.
+    file if desired. The remote file date and size are not fetched by this
+    class; they are set by the owner, for maps from the list of available
+    maps, so that no request per file is needed.
 
   The URL and the name of the local file are given in the constructor and cannot
   be changed. See the description of the method startFileDownload() to see how
@@ -93,7 +103,7 @@ public:
      *
      * @returns Property downloading
      */
-    bool downloading() const { return !_networkReplyDownloadFile.isNull(); }
+    bool downloading() const { return !_networkReplyDownloadFile.isNull() || !_deltaDownload.isNull() || _processingPartialFile; }
 
     /*! \brief Download progress
      *
@@ -152,7 +162,8 @@ public:
     /*! \brief Content of the downloaded file
      *
      * This convenience property holds the content of the downloaded file, or a null
-     * QByteArray, if nothing has been downloaded
+     * QByteArray, if nothing has been downloaded. Reading the property copies
+     * the file; C++ code should use mapFile() instead.
      */
     Q_PROPERTY(QByteArray fileContent READ fileContent NOTIFY fileContentChanged)
 
@@ -162,6 +173,22 @@ public:
      */
     QByteArray fileContent() const;
 
+    /*! \brief Map the downloaded file into memory
+     *
+     * This method gives read-only access to the content of the downloaded
+     * file without copying it. The returned object records the generation of
+     * the file, so that its owner can check with MappedFile::isCurrent()
+     * whether the file has been replaced since. The owner should release the
+     * object once the signal aboutToChangeFile() is emitted.
+     *
+     * @returns Mapped file. If nothing has been downloaded, the object is not
+     * valid.
+     */
+    std::shared_ptr<const MappedFile> mapFile() const
+    {
+        return std::make_shared<const MappedFile>(_fileName);
+    }
+
     /*! \brief Modification date of the remote file
      *
      * If the modification date of the remote file is not known, the property
@@ -202,6 +229,76 @@ public:
      */
     void setRemoteFileSize(qint64 size);
 
+    /*! \brief Set URL of the block manifest
+     *
+     * If the server publishes a block manifest for the remote file, as
+     * described in the documentation of the class DeltaDownload, updates of
+     * an installed file download only the blocks that have changed. If the
+     * delta update fails, the full file is downloaded.
+     *
+     * @param url URL of the block manifest, or an invalid URL if the server
+     * does not publish one
+     */
+    void setBlockManifestUrl(const QUrl& url);
+
+    /*! \brief Set a function that prepares downloaded files for use
+     *
+     * The function is run in the thread pool, on the completely downloaded
+     * and verified partial file, before it replaces the local file. Readers of
+     * the local file therefore never see a file that is being prepared, and
+     * they learn about the new file only once it is ready. While the function
+     * runs, the property downloading remains true.
+     *
+     * @param processor Function that takes the name of the file. The function
+     * must be thread-safe. An empty function disables processing.
+     */
+    void setFileProcessor(std::function<void(const QString&)> processor)
+    {
+        _fileProcessor = std::move(processor);
+    }
+
+    /*! \brief Set the SHA-256 hash of the remote file
+     *
+     * If set, the data is hashed while it is downloaded, and a download whose
+     * hash does not match is rejected before it replaces the local file. The
+     * partial file is then deleted, and the signal error() is emitted. When
+     * an interrupted download is resumed, the data that is already present is
+     * hashed once before the download continues.
+     *
+     * @param sha256 SHA-256 hash of the remote file, as raw bytes, or an empty
+     * QByteArray if the hash is unknown
+     */
+    void setChecksum(const QByteArray& sha256) { _checksum = sha256; }
+
+    /*! \brief Use conditional requests
+     *
+     * If set, the validator (ETag or Last-Modified) of the installed file is
+     * kept next to it, and startFileDownload() asks the server to send the
+     * file only if it has changed. If it has not, the download ends and the
+     * signal fileUnchanged() is emitted. This is meant for small files that
+     * are downloaded regularly, such as the list of available maps.
+     *
+     * @param useConditionalRequests True if conditional requests are used
+     */
+    void setUseConditionalRequests(bool useConditionalRequests) { _useConditionalRequests = useConditionalRequests; }
+
+    /*! \brief Area covered by the file
+     *
+     * For geographic maps, this is the area covered by the map, as described
+     * in the list of available maps. The DownloadScheduler uses it to download
+     * maps near the current position first. If the area is unknown, the
+     * rectangle is invalid.
+     *
+     * @returns Bounding box of the area covered by the file
+     */
+    QGeoRectangle boundingBox() const { return _boundingBox; }
+
+    /*! \brief Set the area covered by the file
+     *
+     * @param boundingBox Bounding box of the area covered by the file
+     */
+    void setBoundingBox(const QGeoRectangle& boundingBox) { _boundingBox = boundingBox; }
+
     /*! \brief Headline name for the Downloadable
      *
      * This property is a convenience storing one string along with the
@@ -259,7 +356,7 @@ public slots:
      *
      * This convenience method deletes the local file. The singals
      * aboutToChangeLocalFile() and localFileChanged() are emitted
-     * appropriately, and a QLockFile is used at fileName()+".lock".
+     * appropriately. The file is locked as described for startFileDownload().
      */
     void deleteFile();
 
@@ -269,11 +366,16 @@ public slots:
      * already in progress, nothing will happen.  Otherwise, the following will
      * take place.
      *
-     * -# Data is retrieved from the remote server and stored in temporary
-     *    file. The signal downloadProgress() will be emitted regularly.
+     * -# Data is retrieved from the remote server and stored in the partial
+     *    file fileName()+".part". The signal downloadProgress() will be
+     *    emitted regularly.
      *
      * -# In case of an error, the signal error() is emitted and the download
-     *    stops.
+     *    stops. The partial file is kept, together with the validator
+     *    (ETag or Last-Modified) that the server sent. When the download is
+     *    started again, only the missing data is requested, using an HTTP Range
+     *    request. If the remote file has changed in the meantime, the server
+     *    sends the full file and the partial file is discarded.
      *
      * -# Optionally, the download can be stopped using the method
      *    stopFileDownload().
@@ -285,38 +387,43 @@ public slots:
      *    this indicates that the local file is about to change and that it
      *    should not be used anymore.
      *
-     * -# A QLockFile is created at fileName()+".lock"
+     * -# The file is locked for writing with a FileRegistry::WriteLocker,
+     *    which waits for readers in this process, and with a QLockFile at
+     *    fileName()+".lock", which coordinates with other instances of the
+     *    app that download into the same directory.
      *
-     * -# The local file is overwritten by the newly downloaded data.
+     * -# The local file is replaced by the partial file.
      *
-     * -# The QLockFile is removed
+     * -# The locks are released. The generation of the file in the
+     *    FileRegistry is incremented.
      *
      * -# The signal fileChanged() is emitted to indicate that the file is
      *    again ready to be used.
      */
     void startFileDownload();
 
-    /*! \brief Contacts the server and downloads information about the remote
-     *  file
-     *
-     * This method contacts the remote server, retrieves information about the
-     * remote file and updates the properties remoteFileDate and remoteFileSize
-     * accordingly.  This method runs asynchronously, and emits the signal
-     * remoteFileInfoChanged() if the data really changes.  If a request is
-     * already running, this method does nothing.
-     *
-     * @warning This method fails silently if the server cannot be contacted or
-     * if the server is unable to provide the requested data.
-     */
-    void startInfoDownload();
-
     /*! \brief Stops download process
      *
      * This method stops the currenly running download process gracefully and
      * deletes any partially downloaded data. No signal will be emitted.  If no
      * download is in progress, nothing will happen.
      */
-    void stopFileDownload();
+    void stopFileDownload()
+    {
+        abortFileDownload(false);
+    }
+
+    /*! \brief Pauses download process
+     *
+     * This method stops the currently running download process, but keeps
+     * the partially downloaded data, so that the download continues where it
+     * left off when startFileDownload() is called again. No signal will be
+     * emitted.  If no download is in progress, nothing will happen.
+     */
+    void pauseFileDownload()
+    {
+        abortFileDownload(true);
+    }
 
 signals:
     /*! \brief Warning that local file is about to change
@@ -373,12 +480,18 @@ signals:
      */
     void fileContentChanged();
 
+    /*! \brief The remote file has not changed
+     *
+     * If conditional requests are used, this signal is emitted when a download
+     * ends because the server reports that the remote file is identical to
+     * the local file. The local file is not touched.
+     */
+    void fileUnchanged();
+
     /*! \brief Notifier signal for the properties remoteFileDate and remoteFileSize
      *
      * This signal is emitted once one of the property remoteFileDate changes,
-     * either in response to a use of the setter methods, or because
-     * downloadRemoteFileData() has been called and data has been retrieved from
-     * the server.
+     * in response to a use of the setter methods.
      */
     void remoteFileDateChanged();
 
@@ -386,9 +499,7 @@ signals:
      *  remoteFileSize
      *
      * This signal is emitted once one of the property remoteFileSize changes,
-     * either in response to a use of the setter methods, or because
-     * downloadRemoteFileData() has been called and data has been retrieved from
-     * the server.
+     * in response to a use of the setter methods.
      */
     void remoteFileSizeChanged();
 
@@ -422,15 +533,54 @@ private slots:
     // _networkReplyDownload.
     void downloadFilePartialDataReceiver();
 
-    // Called once download of the remote file header data is finished, this
-    // method updates the properties remoteFileDate and remoteFileSize, and
-    // _networkReplyDownloadHeader by calling deleteLater. Connected to
-    // &QNetworkReply::finished of _networkReplyDownloadHeader.
-    void downloadHeaderFinished();
+    // Called once the delta update has finished. On success, the partial file
+    // is installed; otherwise, the full file is downloaded.
+    void deltaDownloadFinished(bool success);
+
 
 private:
      Q_DISABLE_COPY_MOVE(Downloadable)
 
+    // Stops the download. If keepPartialFile is true, the partially
+    // downloaded data is kept so that the download can later be resumed.
+    void abortFileDownload(bool keepPartialFile);
+
+    // Names of the partial file, and of the file holding the validator of the
+    // partial file, as sent by the server
+    QString partialFileName() const { return _fileName + ".part"; }
+    QString partialFileValidatorName() const { return _fileName + ".part.validator"; }
+
+    // Name of the file holding the validator of the local file, if
+    // conditional requests are used
+    QString fileValidatorName() const { return _fileName + ".validator"; }
+
+    // Opens _partialFile, once the status of the reply is known. Returns false
+    // on error.
+    bool openPartialFile();
+
+    // Starts downloading the full file, or resumes an interrupted download
+    void startFullFileDownload();
+
+    // Replaces the local file by the completely downloaded partial file and
+    // emits the signals. The download must no longer be running.
+    void installPartialFile();
+
+    // Verifies the checksum of the partial file in the thread pool, if
+    // verifyChecksum is true and a checksum is set, runs _fileProcessor on the
+    // partial file in the thread pool, if set, and then calls
+    // installPartialFile(), unless the file is corrupt or the download was
+    // stopped or the file deleted in the meantime
+    Async::Task processAndInstallPartialFile(bool verifyChecksum = false);
+
+    // Set with setFileProcessor(), and set while it runs
+    std::function<void(const QString&)> _fileProcessor;
+    bool _processingPartialFile {false};
+
+    // Incremented whenever a download is stopped or the file is deleted, so
+    // that a partial file whose processing was started earlier is not
+    // installed
+    quint64 _downloadGeneration {0};
+
     // This member holds the download progress.
     int _downloadProgress{0};
 
@@ -438,13 +588,32 @@ private:
     // download is in progress.
     QPointer<QNetworkReply> _networkReplyDownloadFile;
 
-    // NetworkReply for downloading of remote file header. Set to nullptr when
-    // no download is in progress.
-    QPointer<QNetworkReply> _networkReplyDownloadHeader;
+    // Partial file for storing data when downloading the remote file. Set to
+    // nullptr when no download is in progress, or the reply has not yet
+    // started to deliver data.
+    QPointer<QFile> _partialFile{};
 
-    // Temporary file for storing partiall data when downloading the remote
-    // file. Set to nullptr when no download is in progress.
-    QPointer<QSaveFile> _saveFile{};
+    // Number of bytes that were already present in the partial file when the
+    // download was resumed
+    qint64 _resumeOffset{0};
+
+    // Delta update that is currently running, if any
+    QPointer<DeltaDownload> _deltaDownload;
+
+    // URL of the block manifest, as set with setBlockManifestUrl()
+    QUrl _blockManifestUrl;
+
+    // Set if a delta update of the current remote file has already failed
+    bool _deltaUpdateFailed{false};
+
+    // SHA-256 hash of the remote file, as set with setChecksum(), and the hash
+    // of the data written to the partial file so far. The hash is not updated
+    // while a download is resumed.
+    QByteArray _checksum;
+    QCryptographicHash _partialFileHash{QCryptographicHash::Sha256};
+
+    // Set with setUseConditionalRequests()
+    bool _useConditionalRequests{false};
 
     // URL of the remote file, as set in the constructor
     QUrl _url;
@@ -452,16 +621,17 @@ private:
     // Name of the local file, as set in the constructor
     QString _fileName{};
 
-    // Modification date of the remote file, set directly via a setter method or
-    // by calling downloadRemoteFileInfo().
+    // Modification date of the remote file, set via a setter method
     QDateTime _remoteFileDate;
 
-    // Size of the remote file, set directly via a setter method or by calling
-    // downloadRemoteFileInfo().
+    // Size of the remote file, set via a setter method
     qint64 _remoteFileSize{-1};
 
     // Section name
     QString _section {};
+
+    // Area covered by the file, as set with setBoundingBox()
+    QGeoRectangle _boundingBox;
 };
 
 };
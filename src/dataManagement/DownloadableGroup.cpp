@@ -36,12 +36,7 @@ void DataManagement::DownloadableGroup::addToGroup(Downloadable *downloadable)
 
     // Add element to group
     _downloadables.append(downloadable);
-
-    connect(downloadable, &Downloadable::downloadingChanged, this, &DownloadableGroup::checkAndEmitSignals);
-    connect(downloadable, &Downloadable::updatableChanged, this, &DownloadableGroup::checkAndEmitSignals);
-    connect(downloadable, &Downloadable::hasFileChanged, this, &DownloadableGroup::checkAndEmitSignals);
-    connect(downloadable, &Downloadable::fileContentChanged, this, &DownloadableGroup::localFileContentChanged);
-    connect(downloadable, &QObject::destroyed, this, &DownloadableGroup::cleanUp);
+    watch(downloadable);
     checkAndEmitSignals();
 
     emit downloadablesChanged();
@@ -59,6 +54,7 @@ void DataManagement::DownloadableGroup::removeFromGroup(Downloadable *downloadab
 
     _downloadables.takeAt(index);
     disconnect(downloadable, nullptr, this, nullptr);
+    unwatch(downloadable);
     checkAndEmitSignals();
     emit downloadablesChanged();
 }
@@ -21,6 +21,7 @@
 #include <QLocale>
 
 #include "DownloadableGroupWatcher.h"
+#include "dataManagement/DataManager.h"
 #include <chrono>
 
 using namespace std::chrono_literals;
@@ -45,94 +46,149 @@ void DataManagement::DownloadableGroupWatcher::emitLocalFileContentChanged_delay
 }
 
 
-auto DataManagement::DownloadableGroupWatcher::hasFile() const -> bool
+void DataManagement::DownloadableGroupWatcher::cleanUp()
 {
-    foreach(auto _downloadable, _downloadables) {
-        if (_downloadable.isNull()) {
-            continue;
-        }
-        if (_downloadable->hasFile()) {
-            return true;
-        }
+    // The sender is being destroyed; use the pointer as a key only
+    unwatch(static_cast<Downloadable*>(sender()));
+
+    auto idx = _downloadables.indexOf(nullptr);
+    _downloadables.removeAll(nullptr);
+    if (idx >= 0) {
+        checkAndEmitSignals();
+        emit downloadablesChanged();
     }
-    return false;
 }
 
 
-auto DataManagement::DownloadableGroupWatcher::downloading() const -> bool
+void DataManagement::DownloadableGroupWatcher::watch(Downloadable* downloadable)
 {
-    foreach(auto _downloadable, _downloadables) {
-        if (_downloadable.isNull()) {
-            continue;
-        }
-        if (_downloadable->downloading()) {
-            return true;
-        }
+    connect(downloadable, &Downloadable::downloadingChanged, this, &DownloadableGroupWatcher::onDownloadableChanged);
+    connect(downloadable, &Downloadable::updatableChanged, this, &DownloadableGroupWatcher::onDownloadableChanged);
+    connect(downloadable, &Downloadable::hasFileChanged, this, &DownloadableGroupWatcher::onDownloadableChanged);
+    connect(downloadable, &Downloadable::remoteFileSizeChanged, this, &DownloadableGroupWatcher::onDownloadableChanged);
+    connect(downloadable, &Downloadable::sectionChanged, this, &DownloadableGroupWatcher::onDownloadableSectionChanged);
+    connect(downloadable, &Downloadable::fileContentChanged, this, &DownloadableGroupWatcher::localFileContentChanged);
+    connect(downloadable, &QObject::destroyed, this, &DownloadableGroupWatcher::cleanUp);
+
+    auto state = stateOf(downloadable);
+    _states.insert(downloadable, state);
+    addToTotals(state, 1);
+    if (state.hasFile) {
+        _downloadablesWithFileValid = false;
     }
-    return false;
 }
 
 
-auto DataManagement::DownloadableGroupWatcher::files() const -> QStringList
+void DataManagement::DownloadableGroupWatcher::unwatch(Downloadable* downloadable)
 {
-    QStringList result;
+    auto it = _states.find(downloadable);
+    if (it == _states.end()) {
+        return;
+    }
+    addToTotals(it.value(), -1);
+    if (it.value().hasFile) {
+        _downloadablesWithFileValid = false;
+    }
+    _states.erase(it);
+}
 
-    foreach(auto _downloadable, _downloadables) {
-        if (_downloadable.isNull()) {
-            continue;
-        }
-        if (!_downloadable->hasFile()) {
-            continue;
-        }
-        result += _downloadable->fileName();
+
+auto DataManagement::DownloadableGroupWatcher::stateOf(const Downloadable* downloadable) -> State
+{
+    State state;
+    state.downloading = downloadable->downloading();
+    state.hasFile = downloadable->hasFile();
+    state.updatable = downloadable->updatable();
+    state.remoteFileSize = downloadable->remoteFileSize();
+    return state;
+}
+
+
+void DataManagement::DownloadableGroupWatcher::addToTotals(const State& state, int sign)
+{
+    _numDownloading += sign*static_cast<int>(state.downloading);
+    _numHasFile += sign*static_cast<int>(state.hasFile);
+    _numUpdatable += sign*static_cast<int>(state.updatable);
+    _numFilesTotal += sign*static_cast<int>(state.hasFile || state.downloading);
+    if (state.updatable) {
+        _updateSize += sign*state.remoteFileSize;
+    }
+}
+
+
+void DataManagement::DownloadableGroupWatcher::onDownloadableChanged()
+{
+    auto* downloadable = qobject_cast<Downloadable*>(sender());
+    auto it = _states.find(downloadable);
+    if (it == _states.end()) {
+        return;
     }
 
-    return result;
+    auto state = stateOf(downloadable);
+    addToTotals(it.value(), -1);
+    addToTotals(state, 1);
+    if (state.hasFile != it.value().hasFile) {
+        _downloadablesWithFileValid = false;
+    }
+    it.value() = state;
+    checkAndEmitSignals();
 }
 
 
-auto DataManagement::DownloadableGroupWatcher::updatable() const -> bool
+void DataManagement::DownloadableGroupWatcher::onDownloadableSectionChanged()
 {
+    // The sort order of downloadablesWithFile might have changed
+    _downloadablesWithFileValid = false;
+    checkAndEmitSignals();
+}
+
+
+void DataManagement::DownloadableGroupWatcher::updateDownloadablesWithFile() const
+{
+    if (_downloadablesWithFileValid) {
+        return;
+    }
+    _downloadablesWithFileValid = true;
+
+    _downloadablesWithFile.clear();
     foreach(auto _downloadable, _downloadables) {
         if (_downloadable.isNull()) {
             continue;
         }
-        if (_downloadable->updatable()) {
-            return true;
+        if (!_states.value(_downloadable).hasFile) {
+            continue;
         }
+        _downloadablesWithFile += _downloadable;
     }
 
-    return false;
-}
-
+    // Sort Downloadables according to lower boundary
+    std::sort(_downloadablesWithFile.begin(), _downloadablesWithFile.end(), [](Downloadable* a, Downloadable* b)
+    {
+        if (a->section() != b->section()) {
+            return (a->section() < b->section());
+        }
+        return (a->fileName() < b->fileName());
+    }
+    );
 
-void DataManagement::DownloadableGroupWatcher::cleanUp()
-{
-    auto idx = _downloadables.indexOf(nullptr);
-    _downloadables.removeAll(nullptr);
-    if (idx >= 0) {
-        emit downloadablesChanged();
+    _files.clear();
+    foreach(auto _downloadable, _downloadablesWithFile) {
+        _files += _downloadable->fileName();
     }
 }
 
-
 void DataManagement::DownloadableGroupWatcher::checkAndEmitSignals()
 {
-    bool                          newDownloading           = downloading();
-    QVector<QPointer<Downloadable>> newDownloadablesWithFile = downloadablesWithFile();
-    QStringList                   newFiles                 = files();
-    bool                          newHasFile               = hasFile();
-    bool                          newUpdatable             = updatable();
-    QString                       newUpdateSize            = updateSize();
-
-    if (newDownloadablesWithFile != _cachedDownloadablesWithFile) {
-        _cachedDownloadablesWithFile = newDownloadablesWithFile;
-        emit downloadablesWithFileChanged(newDownloadablesWithFile);
-    }
+    updateDownloadablesWithFile();
 
-    if (newDownloading != _cachedDownloading) {
-        _cachedDownloading = newDownloading;
-        emit downloadingChanged(newDownloading);
+    bool    newDownloading = downloading();
+    bool    newHasFile     = hasFile();
+    bool    newUpdatable   = updatable();
+    QString newUpdateSize  = updateSize();
+
+    if (_downloadablesWithFile != _cachedDownloadablesWithFile) {
+        _cachedDownloadablesWithFile = _downloadablesWithFile;
+        emit downloadablesWithFileChanged(_downloadablesWithFile);
     }
 
     if (newDownloading != _cachedDownloading) {
@@ -140,9 +196,9 @@ void DataManagement::DownloadableGroupWatcher::checkAndEmitSignals()
         emit downloadingChanged(newDownloading);
     }
 
-    if (newFiles != _cachedFiles) {
-        _cachedFiles = newFiles;
-        emit filesChanged(newFiles);
+    if (_files != _cachedFiles) {
+        _cachedFiles = _files;
+        emit filesChanged(_files);
     }
 
     if (newHasFile != _cachedHasFile) {
@@ -161,7 +217,6 @@ void DataManagement::DownloadableGroupWatcher::checkAndEmitSignals()
     }
 }
 
-
 auto DataManagement::DownloadableGroupWatcher::downloadables() const -> QVector<QPointer<Downloadable>>
 {
     QVector<QPointer<Downloadable>> result;
@@ -188,31 +243,17 @@ auto DataManagement::DownloadableGroupWatcher::downloadables() const -> QVector<
 
 auto DataManagement::DownloadableGroupWatcher::downloadablesWithFile() const -> QVector<QPointer<Downloadable>>
 {
-    QVector<QPointer<Downloadable>> result;
-    foreach(auto _downloadable, _downloadables) {
-        if (_downloadable.isNull()) {
-            continue;
-        }
-        if (!_downloadable->hasFile()) {
-            continue;
-        }
-        result += _downloadable;
-    }
+    updateDownloadablesWithFile();
+    return _downloadablesWithFile;
+}
 
-    // Sort Downloadables according to lower boundary
-    std::sort(result.begin(), result.end(), [](Downloadable* a, Downloadable* b)
-    {
-        if (a->section() != b->section()) {
-            return (a->section() < b->section());
-        }
-        return (a->fileName() < b->fileName());
-    }
-    );
 
-    return result;
+auto DataManagement::DownloadableGroupWatcher::files() const -> QStringList
+{
+    updateDownloadablesWithFile();
+    return _files;
 }
 
-
 auto DataManagement::DownloadableGroupWatcher::downloadablesAsObjectList() const -> QVector<QObject*>
 {
     QVector<QObject*> result;
@@ -229,7 +270,7 @@ void DataManagement::DownloadableGroupWatcher::updateAll()
             continue;
         }
         if (downloadablePtr->updatable()) {
-            downloadablePtr->startFileDownload();
+            GlobalObject::dataManager()->downloadScheduler()->enqueue(downloadablePtr);
         }
     }
 }
@@ -237,30 +278,5 @@ void DataManagement::DownloadableGroupWatcher::updateAll()
 
 auto DataManagement::DownloadableGroupWatcher::updateSize() const -> QString
 {
-    qint64 downloadSize = 0;
-    foreach(auto downloadable, _downloadables)
-        if (downloadable->updatable()) {
-            downloadSize += downloadable->remoteFileSize();
-        }
-
-    return QLocale::system().formattedDataSize(downloadSize, 1, QLocale::DataSizeSIFormat);
-}
-
-
-auto DataManagement::DownloadableGroupWatcher::numberOfFilesTotal() const -> int
-{
-    int nFilesTotal = 0;
-    foreach(auto _downloadable, _downloadables) {
-        if (_downloadable.isNull()) {
-            continue;
-        }
-        if (_downloadable->hasFile()) {
-            nFilesTotal += 1;
-        } else {
-            if (_downloadable->downloading()) {
-                nFilesTotal += 1;
-            }
-        }
-    }
-    return nFilesTotal;
+    return QLocale::system().formattedDataSize(_updateSize, 1, QLocale::DataSizeSIFormat);
 }
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <QHash>
 #include <QTimer>
 
 #include "Downloadable.h"
@@ -92,7 +93,7 @@ public:
 
       @returns Property downloading
     */
-    bool downloading() const;
+    bool downloading() const { return _numDownloading > 0; }
 
     /*! \brief Names of all files that have been downloaded by any of the Downloadble objects in this group */
     Q_PROPERTY(QStringList files READ files NOTIFY filesChanged)
@@ -110,7 +111,7 @@ public:
 
     @returns Property hasFile
     */
-    bool hasFile() const;
+    bool hasFile() const { return _numHasFile > 0; }
 
     /*! \brief Indicates any one of Downloadable objects is updatable
 
@@ -122,7 +123,7 @@ public:
       
       @returns Property updatable
     */
-    bool updatable() const;
+    bool updatable() const { return _numUpdatable > 0; }
 
     /*! \brief Gives an estimate for the download size for all updates in this group, as a localized string
 
@@ -140,10 +141,13 @@ public:
 
       @returns int nFilesTotal
     */
-    Q_INVOKABLE int numberOfFilesTotal() const;
+    Q_INVOKABLE int numberOfFilesTotal() const { return _numFilesTotal; }
 
 public slots:
-    /*! Update all updatable Downloadable objects */
+    /*! Update all updatable Downloadable objects
+
+      The downloads are queued in the DownloadScheduler of the DataManager.
+    */
     void updateAll();
 
 signals:
@@ -190,9 +194,18 @@ protected slots:
     // the appropriate notification signals.
     void checkAndEmitSignals();
 
-    // Remove all instances of nullptr from _downloadables
+    // Remove all instances of nullptr from _downloadables. Connected to the
+    // signal destroyed() of the Downloadable objects.
     void cleanUp();
 
+    // Update the state of the sending Downloadable and the totals, then call
+    // checkAndEmitSignals()
+    void onDownloadableChanged();
+
+    // Resort the list of Downloadables with files, then call
+    // checkAndEmitSignals()
+    void onDownloadableSectionChanged();
+
 protected:
     /*! \brief Constructs an empty group
 
@@ -203,6 +216,12 @@ protected:
     // List of QPointers to the Downloadable objects in this group
     QList<QPointer<Downloadable>> _downloadables;
 
+    // Start and stop watching a Downloadable, which must be added to or
+    // removed from _downloadables by the caller. The method unwatch() does not
+    // access the Downloadable and can be used while it is destroyed.
+    void watch(Downloadable* downloadable);
+    void unwatch(Downloadable* downloadable);
+
 private:
      Q_DISABLE_COPY_MOVE(DownloadableGroupWatcher)
 
@@ -210,6 +229,34 @@ private:
     void emitLocalFileContentChanged_delayed();
     QTimer emitLocalFileContentChanged_delayedTimer;
 
+    // State of a Downloadable, as last seen. The properties downloading,
+    // hasFile, updatable, updateSize and numberOfFilesTotal are computed from
+    // the sums below, which are updated whenever the state of a Downloadable
+    // changes. This way, the cost of a change does not grow with the size of
+    // the group.
+    struct State {
+        bool downloading {false};
+        bool hasFile {false};
+        bool updatable {false};
+        qint64 remoteFileSize {0};
+    };
+    static State stateOf(const Downloadable* downloadable);
+    void addToTotals(const State& state, int sign);
+    QHash<Downloadable*, State> _states;
+    int _numDownloading {0};
+    int _numHasFile {0};
+    int _numUpdatable {0};
+    int _numFilesTotal {0};
+    qint64 _updateSize {0};
+
+    // Sorted list of the Downloadables with files, and their file names. These
+    // are recomputed only if a Downloadable gains or loses its file, or
+    // changes its section.
+    void updateDownloadablesWithFile() const;
+    mutable QVector<QPointer<Downloadable>> _downloadablesWithFile;
+    mutable QStringList _files;
+    mutable bool _downloadablesWithFileValid {false};
+
     bool                          _cachedDownloading {false};        // Cached value for the 'downloading' property
     QVector<QPointer<Downloadable>> _cachedDownloadablesWithFile {};   // Cached value for the 'downloadablesWithFiles' property
     QStringList                   _cachedFiles {};                   // Cached value for the 'files' property
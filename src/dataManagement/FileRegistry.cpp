@@ -0,0 +1,73 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QHash>
+#include <QMutex>
+
+#include <memory>
+
+#include "FileRegistry.h"
+
+
+DataManagement::FileRegistry::ReadLocker::ReadLocker(const QString& fileName)
+    : m_lock(entry(fileName).lock)
+{
+    m_lock.lockForRead();
+}
+
+
+DataManagement::FileRegistry::ReadLocker::~ReadLocker()
+{
+    m_lock.unlock();
+}
+
+
+DataManagement::FileRegistry::WriteLocker::WriteLocker(const QString& fileName)
+    : m_lock(entry(fileName).lock), m_generation(entry(fileName).generation)
+{
+    m_lock.lockForWrite();
+}
+
+
+DataManagement::FileRegistry::WriteLocker::~WriteLocker()
+{
+    m_generation++;
+    m_lock.unlock();
+}
+
+
+auto DataManagement::FileRegistry::generation(const QString& fileName) -> quint64
+{
+    return entry(fileName).generation;
+}
+
+
+auto DataManagement::FileRegistry::entry(const QString& fileName) -> Entry&
+{
+    static QMutex mutex;
+    static QHash<QString, std::shared_ptr<Entry>> entries;
+
+    QMutexLocker locker(&mutex);
+    auto& result = entries[fileName];
+    if (!result) {
+        result = std::make_shared<Entry>();
+    }
+    return *result;
+}
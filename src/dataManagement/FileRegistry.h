@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QReadWriteLock>
+#include <QString>
+
+#include <atomic>
+
+
+namespace DataManagement {
+
+/*! \brief In-process coordination of readers and writers of data files
+ *
+ * Downloaded files are read by several parts of the app, sometimes in worker
+ * threads, and are replaced or deleted by Downloadable. This class keeps a
+ * reader/writer lock and a generation counter for every file name. Readers
+ * hold a ReadLocker while reading a file, writers hold a WriteLocker while
+ * replacing or deleting it. Every WriteLocker increments the generation of
+ * the file, so that a reader can detect with generation() whether a file has
+ * been swapped since it last read it, without accessing the file system.
+ *
+ * The locks are recursive: a thread that holds a ReadLocker can construct
+ * further ReadLockers for the same file, e.g. through a MappedFile.
+ *
+ * The locks only coordinate threads of this process. Code that replaces files
+ * which might be used by other processes at the same time must in addition
+ * use a QLockFile.
+ *
+ * All methods are thread-safe. The data for a file name is kept until the
+ * app terminates.
+ */
+
+class FileRegistry
+{
+public:
+    /*! \brief Holds a read lock for a file, for the lifetime of the object */
+    class ReadLocker
+    {
+    public:
+        /*! \brief Locks the file for reading
+         *
+         * @param fileName Name of the file
+         */
+        explicit ReadLocker(const QString& fileName);
+
+        /*! \brief Unlocks the file */
+        ~ReadLocker();
+
+    private:
+        Q_DISABLE_COPY_MOVE(ReadLocker)
+        QReadWriteLock& m_lock;
+    };
+
+    /*! \brief Holds a write lock for a file, for the lifetime of the object
+     *
+     * The generation of the file is incremented when the lock is released.
+     */
+    class WriteLocker
+    {
+    public:
+        /*! \brief Locks the file for writing
+         *
+         * @param fileName Name of the file
+         */
+        explicit WriteLocker(const QString& fileName);
+
+        /*! \brief Increments the generation and unlocks the file */
+        ~WriteLocker();
+
+    private:
+        Q_DISABLE_COPY_MOVE(WriteLocker)
+        QReadWriteLock& m_lock;
+        std::atomic<quint64>& m_generation;
+    };
+
+    /*! \brief Generation of a file
+     *
+     * @param fileName Name of the file
+     *
+     * @returns Number of times a WriteLocker has been released for the file.
+     * If the caller holds a ReadLocker, the value does not change until the
+     * ReadLocker is destructed.
+     */
+    static quint64 generation(const QString& fileName);
+
+private:
+    struct Entry {
+        QReadWriteLock lock {QReadWriteLock::Recursive};
+        std::atomic<quint64> generation {0};
+    };
+
+    // Entry for the file, created if necessary. The reference stays valid
+    // until the app terminates.
+    static Entry& entry(const QString& fileName);
+};
+
+};
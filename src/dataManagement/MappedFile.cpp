@@ -0,0 +1,68 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <limits>
+
+#include "FileRegistry.h"
+#include "MappedFile.h"
+
+
+DataManagement::MappedFile::MappedFile(const QString& fileName) : m_file(fileName)
+{
+    FileRegistry::ReadLocker locker(fileName);
+    m_generation = FileRegistry::generation(fileName);
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    m_size = m_file.size();
+    if (m_size == 0) {
+        m_valid = true;
+        return;
+    }
+    m_data = m_file.map(0, m_size);
+    if (m_data == nullptr) {
+        m_size = 0;
+        m_file.close();
+        return;
+    }
+    m_valid = true;
+}
+
+
+DataManagement::MappedFile::~MappedFile()
+{
+    if (m_data != nullptr) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+}
+
+
+auto DataManagement::MappedFile::bytes() const -> QByteArray
+{
+    auto size = qMin(m_size, static_cast<qint64>(std::numeric_limits<int>::max()));
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(m_data), static_cast<int>(size));
+}
+
+
+auto DataManagement::MappedFile::isCurrent() const -> bool
+{
+    return m_generation == FileRegistry::generation(m_file.fileName());
+}
@@ -0,0 +1,125 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+
+
+namespace DataManagement {
+
+/*! \brief Read-only memory map of a file
+ *
+ * This class maps a file into memory, so that its content can be parsed
+ * without copying it. The mapping is established while holding a
+ * FileRegistry::ReadLocker, and the generation of the file in the
+ * FileRegistry is recorded at that time. Use isCurrent() to check if the file
+ * has since been replaced or deleted.
+ *
+ * The mapping stays valid for the lifetime of the instance, even if the file
+ * is replaced in the meantime. Because not all platforms allow replacing a file
+ * that is mapped, owners should release the instance when the Downloadable
+ * that owns the file emits aboutToChangeFile(). Instances are usually shared
+ * with std::shared_ptr.
+ *
+ * Once constructed, the instance is never modified. It can therefore be read
+ * from several threads at the same time.
+ */
+
+class MappedFile
+{
+public:
+    /*! \brief Maps a file
+     *
+     * @param fileName Name of the file
+     */
+    explicit MappedFile(const QString& fileName);
+
+    /*! \brief Unmaps the file */
+    ~MappedFile();
+
+    /*! \brief Content of the file
+     *
+     * @returns Pointer to the mapped memory, or nullptr if the file could not
+     * be mapped, or is empty
+     */
+    const uchar* data() const
+    {
+        return m_data;
+    }
+
+    /*! \brief Content of the file, as a QByteArray
+     *
+     * The QByteArray refers to the mapped memory and does not copy it. It must
+     * not be used after the instance has been destructed. Files larger than
+     * 2GB are truncated.
+     *
+     * @returns Content of the file, or an empty QByteArray if the file could
+     * not be mapped
+     */
+    QByteArray bytes() const;
+
+    /*! \brief Generation of the file at the time of mapping
+     *
+     * @returns Generation in the FileRegistry
+     */
+    quint64 generation() const
+    {
+        return m_generation;
+    }
+
+    /*! \brief Check if the mapping reflects the current file
+     *
+     * @returns True if the file has not been replaced or deleted in this
+     * process since it was mapped
+     */
+    bool isCurrent() const;
+
+    /*! \brief Check if the file could be mapped
+     *
+     * @returns True if the file exists and could be mapped; empty files are
+     * valid, but have no data
+     */
+    bool isValid() const
+    {
+        return m_valid;
+    }
+
+    /*! \brief Size of the file
+     *
+     * @returns Number of bytes in the mapped memory
+     */
+    qint64 size() const
+    {
+        return m_size;
+    }
+
+private:
+    Q_DISABLE_COPY_MOVE(MappedFile)
+
+    QFile m_file;
+    const uchar* m_data {nullptr};
+    qint64 m_size {0};
+    quint64 m_generation {0};
+    bool m_valid {false};
+};
+
+};
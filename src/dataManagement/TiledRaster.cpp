@@ -0,0 +1,69 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <cmath>
+#include <cstring>
+
+#include "dataManagement/TiledRaster.h"
+
+
+DataManagement::TiledRaster::TiledRaster(const QString& fileName, const char* magic, qint64 headerSize, bool allowsMissingTiles, bool (*readLayout)(const uchar* data, Layout& layout))
+    : m_fileName(fileName),
+      m_file(std::make_shared<const DataManagement::MappedFile>(fileName))
+{
+    // Paranoid safety checks
+    const auto* data = m_file->data();
+    auto size = m_file->size();
+    if ((data == nullptr) || (size < headerSize) || (std::memcmp(data, magic, 4) != 0) || (qFromLittleEndian<quint32>(data+4) != 1)) {
+        return;
+    }
+
+    Layout layout;
+    if (!readLayout(data, layout)) {
+        return;
+    }
+    if (!std::isfinite(layout.west) || !std::isfinite(layout.north) || (layout.samplesPerDegree == 0) || (layout.samplesPerDegree > 3600) ||
+            (layout.tileSize == 0) || (layout.tileSize > 4096) || (layout.tileColumns == 0) || (layout.tileRows == 0) ||
+            (layout.tileColumns > 65536) || (layout.tileRows > 65536)) {
+        return;
+    }
+    auto tileCount = static_cast<qint64>(layout.tileColumns)*layout.tileRows;
+    if (size < headerSize+8*tileCount) {
+        return;
+    }
+
+    // Every tile must lie inside the file
+    auto tileBytes = 2*static_cast<qint64>(layout.tileSize+1)*(layout.tileSize+1);
+    for(qint64 i=0; i<tileCount; i++) {
+        auto offset = qFromLittleEndian<quint64>(data+headerSize+8*i);
+        if ((offset == 0) && allowsMissingTiles) {
+            continue;
+        }
+        if ((size < tileBytes) || (offset < static_cast<quint64>(headerSize)) || (offset > static_cast<quint64>(size-tileBytes))) {
+            return;
+        }
+    }
+
+    m_layout = layout;
+    m_tileSize = static_cast<int>(layout.tileSize);
+    m_tileColumns = static_cast<int>(layout.tileColumns);
+    m_tileRows = static_cast<int>(layout.tileRows);
+    m_tileOffsets = data+headerSize;
+}
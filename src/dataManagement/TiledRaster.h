@@ -0,0 +1,208 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QtEndian>
+#include <memory>
+
+#include "dataManagement/MappedFile.h"
+
+
+namespace DataManagement {
+
+/*! \brief Memory-mapped raster of qint16 samples, stored in square tiles
+ *
+ * This class implements the file format that GeoMaps::TerrainRaster and
+ * Positioning::GeoidRaster have in common. The file is memory-mapped, so that
+ * only the pages around the queried positions are ever loaded into RAM. All
+ * numbers are little-endian.
+ *
+ * A file starts with a four-character magic and a quint32 format version,
+ * currently 1. Next comes a header whose layout depends on the magic and
+ * which describes the Layout of the raster, followed by the table of tile
+ * offsets, as quint64, row by row from the north.
+ *
+ * A tile with n cells along each edge holds (n+1)x(n+1) samples, as qint16,
+ * row by row from the north. The last row and column repeat the first row
+ * and column of the neighbouring tiles, so that every interpolation reads
+ * from one tile only. If the format allows missing tiles, tiles with offset
+ * zero are not stored.
+ *
+ * Once constructed, the instance is never modified. It can therefore be read
+ * from several threads at the same time.
+ */
+
+class TiledRaster
+{
+public:
+    /*! \brief Position and size of the raster */
+    struct Layout {
+        /*! \brief Longitude of the westernmost samples, in degrees */
+        double west {0.0};
+
+        /*! \brief Latitude of the northernmost samples, in degrees */
+        double north {0.0};
+
+        /*! \brief Number of samples per degree */
+        quint32 samplesPerDegree {0};
+
+        /*! \brief Number of cells along each edge of a tile */
+        quint32 tileSize {0};
+
+        /*! \brief Number of tile columns */
+        quint32 tileColumns {0};
+
+        /*! \brief Number of tile rows */
+        quint32 tileRows {0};
+    };
+
+    /*! \brief Four samples around a point, and the position of the point between them */
+    struct Cell {
+        /*! \brief Samples at the corners of the cell */
+        qint16 northWest {0};
+        qint16 northEast {0};
+        qint16 southWest {0};
+        qint16 southEast {0};
+
+        /*! \brief Distance of the point from the western edge, in cells */
+        double columnDist {0.0};
+
+        /*! \brief Distance of the point from the northern edge, in cells */
+        double rowDist {0.0};
+
+        /*! \brief Bilinear interpolation between the samples
+         *
+         * @returns Interpolated sample value at the point
+         */
+        double interpolate() const
+        {
+            return northWest * (1.0-rowDist) * (1.0-columnDist)
+                    + northEast * (1.0-rowDist) * columnDist
+                    + southWest * rowDist * (1.0-columnDist)
+                    + southEast * rowDist * columnDist;
+        }
+    };
+
+    /*! \brief Maps a file
+     *
+     * @param fileName Name of the file
+     *
+     * @param magic Four characters that the file must start with
+     *
+     * @param headerSize Size of the header, including magic and version. The
+     * table of tile offsets follows the header.
+     *
+     * @param allowsMissingTiles If false, every tile must be stored
+     *
+     * @param readLayout Function that reads the layout from the header. The
+     * function is called with the content of the file, which holds at least
+     * headerSize bytes, and returns false if the header is invalid. The
+     * layout is then checked for plausibility.
+     */
+    TiledRaster(const QString& fileName, const char* magic, qint64 headerSize, bool allowsMissingTiles, bool (*readLayout)(const uchar* data, Layout& layout));
+
+    /*! \brief Cell that contains a point
+     *
+     * Points on the eastern and southern edge of the raster belong to the
+     * last column and row of cells.
+     *
+     * @param x Position of the point in samples, measured eastwards from the
+     * westernmost samples. The position must lie within the raster.
+     *
+     * @param y Position of the point in samples, measured southwards from the
+     * northernmost samples. The position must lie within the raster.
+     *
+     * @param result Cell, set if true is returned
+     *
+     * @returns True on success, false if the tile is missing
+     */
+    bool cell(double x, double y, Cell& result) const
+    {
+        auto tileSize = static_cast<double>(m_tileSize);
+        auto tileX = qMin(static_cast<int>(x/tileSize), m_tileColumns-1);
+        auto tileY = qMin(static_cast<int>(y/tileSize), m_tileRows-1);
+        auto offset = qFromLittleEndian<quint64>(m_tileOffsets+8*(static_cast<qint64>(tileY)*m_tileColumns + tileX));
+        if (offset == 0) {
+            return false;
+        }
+
+        auto column = x - tileX*tileSize;
+        auto row = y - tileY*tileSize;
+        auto west = qMin(static_cast<int>(column), m_tileSize-1);
+        auto north = qMin(static_cast<int>(row), m_tileSize-1);
+        result.columnDist = column - west;
+        result.rowDist = row - north;
+
+        auto stride = m_tileSize+1;
+        const auto* sample = m_file->data() + offset + 2*(static_cast<qint64>(north)*stride + west);
+        result.northWest = qFromLittleEndian<qint16>(sample);
+        result.northEast = qFromLittleEndian<qint16>(sample+2);
+        result.southWest = qFromLittleEndian<qint16>(sample+2*stride);
+        result.southEast = qFromLittleEndian<qint16>(sample+2*stride+2);
+        return true;
+    }
+
+    /*! \brief Name of the file
+     *
+     * @returns File name, as passed to the constructor
+     */
+    QString fileName() const
+    {
+        return m_fileName;
+    }
+
+    /*! \brief Check if the file could be mapped and is well-formed
+     *
+     * @returns True if the raster can be queried
+     */
+    bool isValid() const
+    {
+        return m_tileOffsets != nullptr;
+    }
+
+    /*! \brief Position and size of the raster
+     *
+     * @returns Layout, as read from the header
+     */
+    const Layout& layout() const
+    {
+        return m_layout;
+    }
+
+private:
+    Q_DISABLE_COPY_MOVE(TiledRaster)
+
+    QString m_fileName;
+    std::shared_ptr<const DataManagement::MappedFile> m_file;
+    Layout m_layout;
+
+    // Copies of the layout, in the types used by cell()
+    int m_tileSize {0};
+    int m_tileColumns {0};
+    int m_tileRows {0};
+
+    // Table of tile offsets, inside the mapped file, or nullptr if the file
+    // is invalid
+    const uchar* m_tileOffsets {nullptr};
+};
+
+};
@@ -19,6 +19,10 @@
  ***************************************************************************/
 
 #include <QJsonArray>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
 
 //#include "Units.h"
 
@@ -26,6 +30,127 @@
 
 
 GeoMaps::Airspace::Airspace(const QJsonObject &geoJSONObject) {
+    readGeoJSON(geoJSONObject);
+    computeCachedProperties();
+}
+
+GeoMaps::Airspace::Airspace(QString name, QString CAT, QString upperBound, QString lowerBound, const std::vector<double>& latitudes, const std::vector<double>& longitudes)
+    : _name(std::move(name)),
+      _CAT(std::move(CAT)),
+      _upperBound(std::move(upperBound)),
+      _lowerBound(std::move(lowerBound))
+{
+    setGeometry(latitudes, longitudes);
+    computeCachedProperties();
+}
+
+auto GeoMaps::Airspace::boundingBox() const -> QGeoRectangle
+{
+    if (!_geometry) {
+        return {};
+    }
+    const auto& coordinates = _geometry->coordinates;
+    return {QGeoCoordinate(coordinates[2]/microdegreesPerDegree, coordinates[1]/microdegreesPerDegree),
+                QGeoCoordinate(coordinates[0]/microdegreesPerDegree, coordinates[3]/microdegreesPerDegree)};
+}
+
+void GeoMaps::Airspace::computeCachedProperties() {
+    _lowerLimit = parseVerticalLimit(_lowerBound);
+    _upperLimit = parseVerticalLimit(_upperBound);
+}
+
+auto GeoMaps::Airspace::flatPolygon() const -> const FlatPolygon&
+{
+    static const FlatPolygon empty;
+    if (!_geometry) {
+        return empty;
+    }
+    return _geometry->flatPolygon;
+}
+
+auto GeoMaps::Airspace::verticalExtentInFtMSL() const -> std::pair<double, double>
+{
+    auto lower = -std::numeric_limits<double>::infinity();
+    switch(_lowerLimit.datum) {
+    case Datum::FL:
+        lower = _lowerLimit.valueInFt - flightLevelTolerance;
+        break;
+    case Datum::MSL:
+    case Datum::AGL:
+        // Above ground, the airspace begins no lower than above sea level
+        lower = _lowerLimit.valueInFt;
+        break;
+    case Datum::Unknown:
+        break;
+    }
+
+    auto upper = std::numeric_limits<double>::infinity();
+    switch(_upperLimit.datum) {
+    case Datum::FL:
+        upper = _upperLimit.valueInFt + flightLevelTolerance;
+        break;
+    case Datum::MSL:
+        upper = _upperLimit.valueInFt;
+        break;
+    case Datum::AGL:
+    case Datum::Unknown:
+        break;
+    }
+    return {lower, upper};
+}
+
+auto GeoMaps::Airspace::polygon() const -> QGeoPolygon
+{
+    QList<QGeoCoordinate> path;
+    if (_geometry) {
+        const auto& coordinates = _geometry->coordinates;
+        path.reserve(static_cast<int>(coordinates.size()/2-2));
+        for(std::size_t i=4; i+1<coordinates.size(); i+=2) {
+            path.append(QGeoCoordinate(coordinates[i]/microdegreesPerDegree, coordinates[i+1]/microdegreesPerDegree));
+        }
+    }
+    return QGeoPolygon(path);
+}
+
+auto GeoMaps::Airspace::parseVerticalLimit(const QString &limit) -> VerticalLimit {
+    VerticalLimit result;
+    bool ok = false;
+
+    QString AL = limit.simplified();
+
+    if (AL.startsWith("FL", Qt::CaseInsensitive)) {
+        auto fl = AL.remove(0, 2).toDouble(&ok);
+        if (ok) {
+            result.valueInFt = 100 * fl;
+            result.datum = Datum::FL;
+        }
+        return result;
+    }
+
+    auto datum = Datum::MSL;
+    if (AL.endsWith("msl")) {
+        AL.chop(3);
+        AL = AL.simplified();
+    }
+    if (AL.endsWith("agl")) {
+        AL.chop(3);
+        AL = AL.simplified();
+        datum = Datum::AGL;
+    }
+    if (AL.endsWith("ft")) {
+        AL.chop(2);
+        AL = AL.simplified();
+    }
+
+    auto value = AL.toDouble(&ok);
+    if (ok) {
+        result.valueInFt = value;
+        result.datum = datum;
+    }
+    return result;
+}
+
+void GeoMaps::Airspace::readGeoJSON(const QJsonObject &geoJSONObject) {
     // Paranoid safety checks
     if (geoJSONObject["type"] != "Feature") {
         return;
@@ -47,12 +172,16 @@ GeoMaps::Airspace::Airspace(const QJsonObject &geoJSONObject) {
         return;
     }
     auto polygonCoordinates = polygonArray[0].toArray();
+    std::vector<double> latitudes;
+    std::vector<double> longitudes;
+    latitudes.reserve(polygonCoordinates.size());
+    longitudes.reserve(polygonCoordinates.size());
     foreach (auto coordinate, polygonCoordinates) {
         auto coordinateArray = coordinate.toArray();
-        auto geoCoordinate =
-                QGeoCoordinate(coordinateArray[1].toDouble(), coordinateArray[0].toDouble());
-        _polygon.addCoordinate(geoCoordinate);
+        latitudes.push_back(coordinateArray[1].toDouble());
+        longitudes.push_back(coordinateArray[0].toDouble());
     }
+    setGeometry(latitudes, longitudes);
 
     // Get properties
     if (!geoJSONObject.contains("properties")) {
@@ -80,52 +209,40 @@ GeoMaps::Airspace::Airspace(const QJsonObject &geoJSONObject) {
     _lowerBound = properties["BOT"].toString();
 }
 
-auto GeoMaps::Airspace::estimatedLowerBoundInFtMSL() const -> double {
-    double result = 0.0;
-    bool ok = false;
-
-    QString AL = _lowerBound.simplified();
-
-    if (AL.startsWith("FL", Qt::CaseInsensitive)) {
-        result = AL.remove(0, 2).toDouble(&ok);
-        if (ok) {
-            return 100 * result;
-        }
-        return 0.0;
-    }
-
-    if (AL.endsWith("msl")) {
-        AL.chop(3);
-        AL = AL.simplified();
-    }
-    if (AL.endsWith("agl")) {
-        AL.chop(3);
-        AL = AL.simplified();
-    }
-    if (AL.endsWith("ft")) {
-        AL.chop(2);
-        AL = AL.simplified();
-    }
-
-    result = AL.toDouble(&ok);
-    if (ok) {
-        return result;
-    }
-    return 0.0;
-}
-
-auto GeoMaps::Airspace::isUpper() const -> bool {
-    QString AL = _lowerBound.simplified();
-
-    if (!AL.startsWith("FL", Qt::CaseInsensitive)) {
-        return false;
-    }
-
-    bool ok = false;
-    double fl = AL.remove(0, 2).toDouble(&ok);
-    if (!ok) {
-        return false;
+void GeoMaps::Airspace::setGeometry(const std::vector<double>& latitudes, const std::vector<double>& longitudes)
+{
+    _geometry.reset();
+    auto size = latitudes.size();
+    if ((size == 0) || (size != longitudes.size())) {
+        return;
     }
 
-    return fl >= 100.0;
+    auto geometry = std::make_shared<Geometry>();
+    auto& coordinates = geometry->coordinates;
+    coordinates.resize(4+2*size);
+    std::vector<double> quantizedLatitudes(size);
+    std::vector<double> quantizedLongitudes(size);
+    for(std::size_t i=0; i<size; i++) {
+        auto latitude = static_cast<qint32>(std::lround(latitudes[i]*microdegreesPerDegree));
+        auto longitude = static_cast<qint32>(std::lround(longitudes[i]*microdegreesPerDegree));
+        coordinates[4+2*i] = latitude;
+        coordinates[5+2*i] = longitude;
+        quantizedLatitudes[i] = latitude/microdegreesPerDegree;
+        quantizedLongitudes[i] = longitude/microdegreesPerDegree;
+    }
+
+    // Bounding box
+    coordinates[0] = coordinates[2] = coordinates[4];
+    coordinates[1] = coordinates[3] = coordinates[5];
+    for(std::size_t i=1; i<size; i++) {
+        coordinates[0] = std::min(coordinates[0], coordinates[4+2*i]);
+        coordinates[1] = std::min(coordinates[1], coordinates[5+2*i]);
+        coordinates[2] = std::max(coordinates[2], coordinates[4+2*i]);
+        coordinates[3] = std::max(coordinates[3], coordinates[5+2*i]);
+    }
+
+    // The containment test uses the quantized vertices, so that it agrees
+    // with the polygon shown in the GUI
+    geometry->flatPolygon = FlatPolygon(quantizedLatitudes, quantizedLongitudes);
+    _geometry = geometry;
 }
@@ -21,11 +21,23 @@
 #pragma once
 
 #include <QGeoPolygon>
+#include <QGeoRectangle>
 #include <QJsonObject>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "FlatPolygon.h"
 
 namespace GeoMaps {
 
-/*! \brief A very simple class that describes an airspace */
+/*! \brief A very simple class that describes an airspace
+ *
+ * The lateral limits are stored in compact form, as vertices in
+ * microdegrees, prefixed by the bounding box. The geometry is shared between
+ * all copies of an airspace, so that copying is cheap. A QGeoPolygon is only
+ * constructed when the property polygon is read, typically by QML.
+ */
 
 class Airspace {
     Q_GADGET
@@ -44,16 +56,93 @@ public:
      */
     explicit Airspace(const QJsonObject &geoJSONObject);
 
+    /*! \brief Constructs an airspace from its data
+     *
+     * This constructor is used to restore airspaces from a binary cache
+     * without parsing GeoJSON.
+     *
+     * @param name Name of the airspace
+     *
+     * @param CAT Category of the airspace
+     *
+     * @param upperBound Upper limit of the airspace
+     *
+     * @param lowerBound Lower limit of the airspace
+     *
+     * @param latitudes Latitudes of the vertices of the lateral limits, in
+     * degrees
+     *
+     * @param longitudes Longitudes of the vertices of the lateral limits, in
+     * degrees. This vector must have the same size as latitudes.
+     */
+    Airspace(QString name, QString CAT, QString upperBound, QString lowerBound, const std::vector<double>& latitudes, const std::vector<double>& longitudes);
+
+    /*! \brief Test if a position lies within the lateral limits
+     *
+     * This method uses the vectorized ray-crossing test of FlatPolygon and is
+     * much faster than polygon().contains().
+     *
+     * @param position Position to test
+     *
+     * @returns True if the position lies inside the polygon
+     */
+    bool contains(const QGeoCoordinate& position) const
+    {
+        if (!_geometry) {
+            return false;
+        }
+        auto latitude = position.latitude()*microdegreesPerDegree;
+        auto longitude = position.longitude()*microdegreesPerDegree;
+        const auto& coordinates = _geometry->coordinates;
+        return (latitude >= coordinates[0]) && (longitude >= coordinates[1]) &&
+                (latitude <= coordinates[2]) && (longitude <= coordinates[3]) &&
+                _geometry->flatPolygon.contains(position.latitude(), position.longitude());
+    }
+
     /*! \brief Estimates the lower limit of the airspace, in feet above MSL
      *
      * This method gives a rought estimate for the lower limit of the airspace
      * in ft MSL. The result is not reliable enough for aviation purposes but
      * can be used to sort the airspaces in the GUI.
      *
+     * The value is computed once, when the airspace is constructed.
+     *
      * @returns Estimated lower bound of the airspace, in feet above main sea
      * level
      */
-    double estimatedLowerBoundInFtMSL() const;
+    double estimatedLowerBoundInFtMSL() const { return _lowerLimit.valueInFt; }
+
+    /*! \brief Estimates the upper limit of the airspace, in feet above MSL
+     *
+     * This method works like estimatedLowerBoundInFtMSL(). If the upper limit
+     * cannot be interpreted, for instance because it is given as "UNL", the
+     * method returns 0.0.
+     *
+     * @returns Estimated upper bound of the airspace, in feet above main sea
+     * level
+     */
+    double estimatedUpperBoundInFtMSL() const { return _upperLimit.valueInFt; }
+
+    /*! \brief Vertical extent of the airspace, in feet above MSL
+     *
+     * This method returns an interval that contains the airspace for any
+     * reasonable terrain elevation and QNH. Flight levels are widened by
+     * flightLevelTolerance, lower limits that cannot be interpreted (such as
+     * "GND") extend to minus infinity, and upper limits that are given above
+     * ground level or cannot be interpreted (such as "UNL") extend to
+     * infinity. The interval is meant for pruning queries by altitude, not for
+     * display.
+     *
+     * @returns Pair of lower and upper end of the interval
+     */
+    std::pair<double, double> verticalExtentInFtMSL() const;
+
+    /*! \brief Uncertainty of flight levels, in feet
+     *
+     * This is the largest difference between pressure altitude and altitude
+     * above MSL that verticalExtentInFtMSL() allows for.
+     */
+    static constexpr double flightLevelTolerance = 1500.0;
 
     /*! \brief Estimates if the airspace begins at FL100 or above
      *
@@ -66,7 +155,25 @@ public:
      *
      * @returns Property isUpper
      */
-    bool isUpper() const;
+    bool isUpper() const { return (_lowerLimit.datum == Datum::FL) && (_lowerLimit.valueInFt >= 10000.0); }
+
+    /*! \brief Bounding box of the lateral limits
+     *
+     * The bounding box is computed once, when the airspace is constructed.
+     *
+     * @returns Bounding box of the polygon, or an invalid rectangle if the
+     * airspace is invalid
+     */
+    QGeoRectangle boundingBox() const;
+
+    /*! \brief Lateral limits, as a FlatPolygon
+     *
+     * Use this to test many points against the airspace at once, e.g. when
+     * analysing a flight route.
+     *
+     * @returns Polygon that describes the lateral limits of the airspace
+     */
+    const FlatPolygon& flatPolygon() const;
 
     /*! \brief Validity */
     Q_PROPERTY(bool isValid READ isValid CONSTANT)
@@ -75,7 +182,7 @@ public:
      *
      * @returns Property isValid
      */
-    bool isValid() const { return !_polygon.isEmpty(); }
+    bool isValid() const { return _geometry != nullptr; }
 
     /*! \brief Lower limit of the airspace
      *
@@ -104,10 +211,13 @@ public:
     Q_PROPERTY(QGeoPolygon polygon READ polygon CONSTANT)
 
     /*! \brief Getter function for property with the same name
+     *
+     * The QGeoPolygon is constructed from the compact representation on
+     * every call.
      *
      * @returns Property polygon
      */
-    QGeoPolygon polygon() const { return _polygon; }
+    QGeoPolygon polygon() const;
 
     /* \brief Category of the airspace
      *
@@ -138,11 +248,59 @@ public:
     QString upperBound() const { return _upperBound; }
 
 private:
+    // Reference datum of a vertical limit
+    enum class Datum {
+        Unknown,
+        MSL,
+        AGL,
+        FL
+    };
+
+    // Vertical limit, parsed from a string such as "FL 65", "2500 ft" or
+    // "1000 agl". For flight levels, the value is given in feet, i.e. 100 times
+    // the flight level. If the string cannot be interpreted, the value is 0.0
+    // and the datum is Unknown.
+    struct VerticalLimit {
+        double valueInFt {0.0};
+        Datum datum {Datum::Unknown};
+    };
+
+    // Conversion factor between degrees and the units used in Geometry
+    static constexpr double microdegreesPerDegree = 1e6;
+
+    // Lateral limits, shared between all copies of an airspace
+    struct Geometry {
+        // Minimal latitude, minimal longitude, maximal latitude and maximal
+        // longitude, followed by the latitude/longitude pairs of all
+        // vertices, in microdegrees
+        std::vector<qint32> coordinates;
+
+        // Polygon used for containment tests
+        FlatPolygon flatPolygon;
+    };
+
+    // Computes the cached properties; this is used by the constructors
+    void computeCachedProperties();
+
+    // Sets the geometry. If the vectors are empty or of different sizes, the
+    // airspace becomes invalid.
+    void setGeometry(const std::vector<double>& latitudes, const std::vector<double>& longitudes);
+
+    // Parses a vertical limit
+    static VerticalLimit parseVerticalLimit(const QString &limit);
+
+    // Reads name, category, limits and polygon from a GeoJSON object
+    void readGeoJSON(const QJsonObject &geoJSONObject);
+
     QString _name{};
     QString _CAT{};
     QString _upperBound{};
     QString _lowerBound{};
-    QGeoPolygon _polygon{};
+    std::shared_ptr<const Geometry> _geometry{};
+
+    // Cached properties
+    VerticalLimit _lowerLimit{};
+    VerticalLimit _upperLimit{};
 };
 
 }
@@ -0,0 +1,216 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QGeoPath>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "AirspaceMonitor.h"
+#include "GeoMapProvider.h"
+#include "Metrics.h"
+#include "Profiler.h"
+
+
+namespace {
+
+// Meters per degree of latitude
+constexpr double metersPerDegree = 111319.49;
+
+// Number of samples along each of the three tracks
+constexpr int sampleCount = static_cast<int>(GeoMaps::AirspaceMonitor::lookAhead/GeoMaps::AirspaceMonitor::sampleInterval)+1;
+
+// Number of bisection steps for entry times; this gives a resolution of
+// about half a second
+constexpr int bisectionSteps = 5;
+
+} // namespace
+
+
+// Member functions
+
+GeoMaps::AirspaceMonitor::AirspaceMonitor(const GeoMapProvider* geoMapProvider, QObject* parent)
+    : QObject(parent),
+      m_geoMapProvider(geoMapProvider),
+      m_latitudes(3*sampleCount),
+      m_longitudes(3*sampleCount),
+      m_inside(new bool[3*sampleCount])
+{
+    qRegisterMetaType<QVector<GeoMaps::AirspaceAlert>>();
+
+    m_timer.setInterval(monitorInterval);
+    connect(&m_timer, &QTimer::timeout, this, &GeoMaps::AirspaceMonitor::monitor);
+}
+
+
+void GeoMaps::AirspaceMonitor::setPositionInfo(const Positioning::PositionInfo& info)
+{
+    m_ownship = info;
+
+    // Velocities; the aircraft is considered stationary if the track is
+    // unknown, so that only the current position is checked
+    auto groundSpeed = info.groundSpeed().toMPS();
+    auto track = info.trueTrack().toRAD();
+    if (std::isfinite(groundSpeed) && std::isfinite(track)) {
+        m_vx = groundSpeed*std::sin(track);
+        m_vy = groundSpeed*std::cos(track);
+    } else {
+        m_vx = 0.0;
+        m_vy = 0.0;
+    }
+    auto verticalSpeed = info.verticalSpeed().toFPM()/60.0;
+    m_vzInFtPerS = std::isfinite(verticalSpeed) ? verticalSpeed : 0.0;
+
+    if (!m_timer.isActive()) {
+        m_timer.start();
+    }
+}
+
+
+void GeoMaps::AirspaceMonitor::monitor()
+{
+    METRICS_TIME_SCOPE("airspaceMonitor/monitor");
+    PROFILER_SCOPE(Profiler::AviationQueries);
+
+    auto coordinate = m_ownship.coordinate();
+    auto altitude = m_ownship.trueAltitude().toFeet();
+    if (!m_ownship.isValid() || !std::isfinite(altitude)) {
+        m_timer.stop();
+        if (m_hasAlerts) {
+            m_hasAlerts = false;
+            emit alertsChanged({});
+        }
+        return;
+    }
+
+    // Sample the projected track, starting at the current time, together
+    // with the parallel tracks to the left and right
+    auto age = qMax(qint64(0), m_ownship.timestamp().msecsTo(QDateTime::currentDateTimeUtc()))/1000.0;
+    auto sampleS = std::chrono::duration<double>(sampleInterval).count();
+    auto metersPerDegreeLongitude = metersPerDegree*qMax(qCos(qDegreesToRadians(coordinate.latitude())), 0.01);
+    auto speed = std::hypot(m_vx, m_vy);
+    auto offsetX = (speed > 0.0) ? -m_vy/speed*lateralMargin.toM() : 0.0;
+    auto offsetY = (speed > 0.0) ? m_vx/speed*lateralMargin.toM() : lateralMargin.toM();
+    for(int k=0; k<sampleCount; k++) {
+        auto t = age + k*sampleS;
+        auto x = m_vx*t;
+        auto y = m_vy*t;
+        m_latitudes[k] = coordinate.latitude() + y/metersPerDegree;
+        m_longitudes[k] = coordinate.longitude() + x/metersPerDegreeLongitude;
+        m_latitudes[sampleCount+k] = coordinate.latitude() + (y+offsetY)/metersPerDegree;
+        m_longitudes[sampleCount+k] = coordinate.longitude() + (x+offsetX)/metersPerDegreeLongitude;
+        m_latitudes[2*sampleCount+k] = coordinate.latitude() + (y-offsetY)/metersPerDegree;
+        m_longitudes[2*sampleCount+k] = coordinate.longitude() + (x-offsetX)/metersPerDegreeLongitude;
+    }
+
+    // Candidates, from the spatial index, restricted to the altitudes that
+    // the projected track passes through
+    QGeoPath corridor({QGeoCoordinate(m_latitudes[0], m_longitudes[0]),
+                       QGeoCoordinate(m_latitudes[sampleCount-1], m_longitudes[sampleCount-1])});
+    auto firstAltitude = altitude + m_vzInFtPerS*age;
+    auto lastAltitude = altitude + m_vzInFtPerS*(age + (sampleCount-1)*sampleS);
+    auto bottom = Units::Distance::fromFT(qMin(firstAltitude, lastAltitude)) - verticalMargin;
+    auto top = Units::Distance::fromFT(qMax(firstAltitude, lastAltitude)) + verticalMargin;
+    auto candidates = m_geoMapProvider->airspacesInCorridor(corridor, lateralMargin+lateralMargin, bottom, top);
+
+    QVector<AirspaceAlert> alerts;
+    for(const auto& airspace : candidates) {
+        const auto& polygon = airspace.flatPolygon();
+        if (polygon.isEmpty()) {
+            continue;
+        }
+
+        // Upper limits that cannot be interpreted, such as "UNL", are
+        // reported as 0.0
+        auto lowerInFt = airspace.estimatedLowerBoundInFtMSL();
+        auto upperInFt = airspace.estimatedUpperBoundInFtMSL();
+        if (upperInFt <= lowerInFt) {
+            upperInFt = std::numeric_limits<double>::infinity();
+        }
+        auto verticallyInside = [&](int k, double margin) {
+            auto sampleAltitude = altitude + m_vzInFtPerS*(age + k*sampleS);
+            return (sampleAltitude >= lowerInFt-margin) && (sampleAltitude <= upperInFt+margin);
+        };
+
+        polygon.contains(m_latitudes.data(), m_longitudes.data(), 3*sampleCount, m_inside.get());
+
+        // Penetration and predicted entry, along the projected track
+        int entry = -1;
+        for(int k=0; k<sampleCount; k++) {
+            if (m_inside[k] && verticallyInside(k, 0.0)) {
+                entry = k;
+                break;
+            }
+        }
+        if (entry == 0) {
+            alerts.append({airspace, AirspaceAlert::Inside, Units::Time::fromS(0.0)});
+            continue;
+        }
+        if (entry > 0) {
+            auto entryS = refineEntryTime(airspace, lowerInFt, upperInFt, age, (entry-1)*sampleS, entry*sampleS);
+            alerts.append({airspace, AirspaceAlert::Entry, Units::Time::fromS(entryS)});
+            continue;
+        }
+
+        // Proximity, along any of the three tracks
+        auto margin = verticalMargin.toFeet();
+        for(int k=0; k<sampleCount; k++) {
+            if ((m_inside[k] || m_inside[sampleCount+k] || m_inside[2*sampleCount+k]) && verticallyInside(k, margin)) {
+                alerts.append({airspace, AirspaceAlert::Proximity, Units::Time::fromS(k*sampleS)});
+                break;
+            }
+        }
+    }
+
+    std::sort(alerts.begin(), alerts.end(), [](const AirspaceAlert& a, const AirspaceAlert& b) {
+        if ((a.kind == AirspaceAlert::Inside) != (b.kind == AirspaceAlert::Inside)) {
+            return a.kind == AirspaceAlert::Inside;
+        }
+        return a.timeToEntry.toS() < b.timeToEntry.toS();
+    });
+    if (!alerts.isEmpty() || m_hasAlerts) {
+        m_hasAlerts = !alerts.isEmpty();
+        emit alertsChanged(alerts);
+    }
+}
+
+
+auto GeoMaps::AirspaceMonitor::refineEntryTime(const Airspace& airspace, double lowerInFt, double upperInFt, double age, double outsideS, double insideS) const -> double
+{
+    auto coordinate = m_ownship.coordinate();
+    auto altitude = m_ownship.trueAltitude().toFeet();
+    auto metersPerDegreeLongitude = metersPerDegree*qMax(qCos(qDegreesToRadians(coordinate.latitude())), 0.01);
+
+    for(int i=0; i<bisectionSteps; i++) {
+        auto middleS = (outsideS+insideS)/2.0;
+        auto t = age + middleS;
+        auto latitude = coordinate.latitude() + m_vy*t/metersPerDegree;
+        auto longitude = coordinate.longitude() + m_vx*t/metersPerDegreeLongitude;
+        auto sampleAltitude = altitude + m_vzInFtPerS*t;
+        auto inside = (sampleAltitude >= lowerInFt) && (sampleAltitude <= upperInFt) && airspace.flatPolygon().contains(latitude, longitude);
+        if (inside) {
+            insideS = middleS;
+        } else {
+            outsideS = middleS;
+        }
+    }
+    return insideS;
+}
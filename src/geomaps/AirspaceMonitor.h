@@ -0,0 +1,183 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QTimer>
+#include <QVector>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "Airspace.h"
+#include "positioning/PositionInfo.h"
+#include "units/Distance.h"
+#include "units/Time.h"
+
+using namespace std::chrono_literals;
+
+
+namespace GeoMaps {
+
+class GeoMapProvider;
+
+
+/*! \brief Predicted proximity to, or penetration of, an airspace */
+
+struct AirspaceAlert
+{
+    Q_GADGET
+
+public:
+    /*! \brief Kind of alert */
+    enum Kind : quint8 {
+        Proximity, /*!< The aircraft will come closer than the margins of AirspaceMonitor */
+        Entry,     /*!< The aircraft will enter the airspace */
+        Inside     /*!< The aircraft is inside the airspace */
+    };
+    Q_ENUM(Kind)
+
+    /*! \brief Airspace */
+    Q_PROPERTY(GeoMaps::Airspace airspace MEMBER airspace CONSTANT)
+
+    /*! \brief Kind of alert */
+    Q_PROPERTY(Kind kind MEMBER kind CONSTANT)
+
+    /*! \brief Time until the event, zero for kind Inside */
+    Q_PROPERTY(Units::Time timeToEntry MEMBER timeToEntry CONSTANT)
+
+    /*! \brief Member for the property with the same name */
+    GeoMaps::Airspace airspace;
+
+    /*! \brief Member for the property with the same name */
+    Kind kind {Proximity};
+
+    /*! \brief Member for the property with the same name */
+    Units::Time timeToEntry;
+};
+
+
+/*! \brief Predictive airspace monitor
+ *
+ *  This class predicts whether the aircraft will enter an airspace, or come
+ *  close to one, within the next lookAhead. It assumes that the aircraft
+ *  keeps its current ground speed, track and vertical speed. Once per
+ *  monitorInterval, the monitor samples the projected track, together with
+ *  two parallel tracks at a distance of lateralMargin to the left and right,
+ *  at intervals of sampleInterval. It finds candidate airspaces with the
+ *  spatial index of the aviation data, tests all samples at once against the
+ *  lateral limits of each candidate with the vectorized kernel of
+ *  FlatPolygon, and compares the predicted altitudes with the vertical
+ *  limits. Entry times are refined by bisection.
+ *
+ *  Vertical limits are taken from Airspace::estimatedLowerBoundInFtMSL() and
+ *  Airspace::estimatedUpperBoundInFtMSL(), which treat flight levels and
+ *  heights above ground as altitudes. The alerts are for situational
+ *  awareness only.
+ *
+ *  The class is meant to live in a worker thread of the GeoMapProvider. It
+ *  reads the aviation data through GeoMapProvider::airspacesInCorridor(),
+ *  which is thread-safe.
+ */
+
+class AirspaceMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    /*! \brief Default constructor
+     *
+     * @param geoMapProvider GeoMapProvider whose aviation data is monitored.
+     * The GeoMapProvider must outlive this object.
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit AirspaceMonitor(const GeoMapProvider* geoMapProvider, QObject* parent = nullptr);
+
+    // Standard destructor
+    ~AirspaceMonitor() override = default;
+
+    /*! \brief Time between two predictions */
+    static constexpr auto monitorInterval = 1s;
+
+    /*! \brief Time span of the prediction */
+    static constexpr auto lookAhead = 5min;
+
+    /*! \brief Time between two samples of the projected track */
+    static constexpr auto sampleInterval = 10s;
+
+    /*! \brief Horizontal distance below which an airspace is considered close */
+    static constexpr Units::Distance lateralMargin = Units::Distance::fromNM(1.0);
+
+    /*! \brief Vertical distance below which an airspace is considered close */
+    static constexpr Units::Distance verticalMargin = Units::Distance::fromFT(500.0);
+
+public slots:
+    /*! \brief Update the state of ownship
+     *
+     *  @param info Current position info of ownship. Position infos without
+     *  true altitude do not generate alerts.
+     */
+    void setPositionInfo(const Positioning::PositionInfo& info);
+
+signals:
+    /*! \brief Result of a prediction
+     *
+     *  This signal is emitted once per monitorInterval while there are
+     *  alerts, and once when the last alert disappears.
+     *
+     *  @param alerts Alerts, with alerts of kind Inside first, and all others
+     *  sorted by time to entry
+     */
+    void alertsChanged(const QVector<GeoMaps::AirspaceAlert>& alerts);
+
+private slots:
+    // Runs one prediction
+    void monitor();
+
+private:
+    Q_DISABLE_COPY_MOVE(AirspaceMonitor)
+
+    // Predicted time of entry into the airspace, between two sample times
+    // where the aircraft is outside and inside, found by bisection. Times
+    // are in seconds from now; age is the age of m_ownship, in seconds.
+    double refineEntryTime(const Airspace& airspace, double lowerInFt, double upperInFt, double age, double outsideS, double insideS) const;
+
+    const GeoMapProvider* m_geoMapProvider;
+    QTimer m_timer {this};
+    bool m_hasAlerts {false};
+
+    // State of ownship, at the time of the last call to setPositionInfo().
+    // Velocities are in meters per second, with x pointing east and y
+    // pointing north.
+    Positioning::PositionInfo m_ownship;
+    double m_vx {0.0};
+    double m_vy {0.0};
+    double m_vzInFtPerS {0.0};
+
+    // Scratch arrays for monitor(). The samples of the projected track are
+    // followed by the samples of the left and right parallel tracks.
+    std::vector<double> m_latitudes;
+    std::vector<double> m_longitudes;
+    std::unique_ptr<bool[]> m_inside;
+};
+
+}
+
+Q_DECLARE_METATYPE(GeoMaps::AirspaceAlert)
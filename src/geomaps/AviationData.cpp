@@ -0,0 +1,319 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtMath>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+#include "AviationData.h"
+
+
+namespace {
+
+// Bounding box of a QGeoRectangle, in the format used by GeoMaps::RTree
+auto boxFromRectangle(const QGeoRectangle& rectangle) -> GeoMaps::RTree::Box
+{
+    return {rectangle.topLeft().longitude(), rectangle.bottomRight().latitude(),
+                rectangle.bottomRight().longitude(), rectangle.topLeft().latitude()};
+}
+
+// Source of generation numbers
+std::atomic<quint64> nextGeneration {1};
+
+}
+
+
+GeoMaps::AviationData::AviationData()
+    : m_generation(nextGeneration++)
+{
+    QJsonObject resultObject;
+    resultObject.insert(QStringLiteral("type"), "FeatureCollection");
+    resultObject.insert(QStringLiteral("features"), QJsonArray());
+    QJsonDocument geoDoc(resultObject);
+    m_geoJSON = std::make_shared<const QByteArray>(geoDoc.toJson(QJsonDocument::JsonFormat::Compact));
+}
+
+
+GeoMaps::AviationData::AviationData(QVector<Waypoint> waypoints, QVector<Airspace> airspaces, QByteArray geoJSON, QVector<VectorTileFeature> tileFeatures, quint64 contentKey)
+    : m_waypoints(std::move(waypoints)),
+      m_airspaces(std::move(airspaces)),
+      m_geoJSON(std::make_shared<const QByteArray>(std::move(geoJSON))),
+      m_tileFeatures(std::move(tileFeatures)),
+      m_generation(nextGeneration++),
+      m_contentKey(contentKey)
+{
+    // Sort waypoints by name
+    std::sort(m_waypoints.begin(), m_waypoints.end(), [](const Waypoint &a, const Waypoint &b) {return a.name() < b.name(); });
+
+    // Build spatial index for the airspaces, together with the attributes
+    // used for pruning
+    std::vector<RTree::Box> airspaceBoxes;
+    airspaceBoxes.reserve(m_airspaces.size());
+    m_airspaceAttributes.reserve(m_airspaces.size());
+    foreach(auto airspace, m_airspaces) {
+        airspaceBoxes.push_back(boxFromRectangle(airspace.boundingBox()));
+        auto verticalExtent = airspace.verticalExtentInFtMSL();
+        m_airspaceAttributes.push_back({verticalExtent.first, verticalExtent.second, airspace.isUpper(), airspace.CAT() == u"GLD"});
+    }
+    m_airspaceIndex = RTree(airspaceBoxes);
+
+    // Build spatial index for the tile features
+    std::vector<RTree::Box> tileFeatureBoxes;
+    tileFeatureBoxes.reserve(m_tileFeatures.size());
+    foreach(auto tileFeature, m_tileFeatures) {
+        tileFeatureBoxes.push_back(tileFeature.boundingBox());
+    }
+    m_tileFeatureIndex = RTree(tileFeatureBoxes);
+
+    // Simplified tile features. Simplification only removes vertices, so the
+    // spatial index of the full-resolution features applies to all levels.
+    for(auto zoom : simplificationZooms) {
+        QVector<VectorTileFeature> simplifiedFeatures;
+        simplifiedFeatures.reserve(m_tileFeatures.size());
+        foreach(auto tileFeature, m_tileFeatures) {
+            simplifiedFeatures.append(tileFeature.simplified(zoom));
+        }
+        m_simplifiedTileFeatures.push_back(simplifiedFeatures);
+    }
+
+    // Build spatial indices for the waypoints, one for all waypoints and one for each type
+    std::vector<KDTree::Point> waypointPoints;
+    QHash<QString, std::vector<KDTree::Point>> waypointPointsByType;
+    waypointPoints.reserve(m_waypoints.size());
+    for(int i=0; i<m_waypoints.size(); i++) {
+        const auto& wp = m_waypoints[i];
+        KDTree::Point point {wp.coordinate().latitude(), wp.coordinate().longitude(), i};
+        waypointPoints.push_back(point);
+        waypointPointsByType[wp.type()].push_back(point);
+    }
+    m_waypointIndex = KDTree(waypointPoints);
+    for(auto it = waypointPointsByType.constBegin(); it != waypointPointsByType.constEnd(); ++it) {
+        m_waypointIndexByType.insert(it.key(), KDTree(it.value()));
+    }
+
+    // Build full-text index
+    m_waypointSearchIndex = WaypointSearchIndex(m_waypoints);
+
+    // Build ICAO code index. If several waypoints share the same code, the first one wins.
+    for(int i=0; i<m_waypoints.size(); i++) {
+        auto code = m_waypoints[i].ICAOCode();
+        if (!code.isEmpty() && !m_waypointsByICAOCode.contains(code)) {
+            m_waypointsByICAOCode.insert(code, i);
+        }
+    }
+}
+
+
+auto GeoMaps::AviationData::airspacesAt(const QGeoCoordinate& position, const AirspaceFilter& filter) const -> QVector<Airspace>
+{
+    // Test only those airspaces whose bounding box contains the position
+    QVector<Airspace> result;
+    result.reserve(10);
+    for(auto index : m_airspaceIndex.query(position.longitude(), position.latitude())) {
+        if (!matches(index, filter)) {
+            continue;
+        }
+        const auto& airspace = m_airspaces[index];
+        if (airspace.contains(position)) {
+            result.append(airspace);
+        }
+    }
+
+    // Sort airspaces according to lower boundary
+    std::sort(result.begin(), result.end(), [](const Airspace& a, const Airspace& b) {return (a.estimatedLowerBoundInFtMSL() > b.estimatedLowerBoundInFtMSL()); });
+    return result;
+}
+
+
+auto GeoMaps::AviationData::airspacesInCorridor(const QGeoPath& path, Units::Distance corridorWidth, const AirspaceFilter& filter) const -> QVector<Airspace>
+{
+    const auto coordinates = path.path();
+    if (coordinates.isEmpty()) {
+        return {};
+    }
+
+    // Half the corridor width, in degrees of latitude (one degree of latitude
+    // is roughly 111km long)
+    auto halfWidthLat = corridorWidth.toM()/2.0/111000.0;
+
+    // Query the index for the bounding box of every segment, suitably enlarged
+    QVector<bool> found(m_airspaces.size(), false);
+    for(int i=0; i<coordinates.size(); i++) {
+        const auto& start = coordinates[i];
+        const auto& end = coordinates[qMin(i+1, coordinates.size()-1)];
+
+        auto maxAbsLat = qMin(qMax(qAbs(start.latitude()), qAbs(end.latitude()))+halfWidthLat, 89.0);
+        auto halfWidthLon = halfWidthLat/qCos(qDegreesToRadians(maxAbsLat));
+
+        RTree::Box box {qMin(start.longitude(), end.longitude())-halfWidthLon,
+                    qMin(start.latitude(), end.latitude())-halfWidthLat,
+                    qMax(start.longitude(), end.longitude())+halfWidthLon,
+                    qMax(start.latitude(), end.latitude())+halfWidthLat};
+        for(auto index : m_airspaceIndex.query(box)) {
+            if (matches(index, filter)) {
+                found[index] = true;
+            }
+        }
+    }
+
+    QVector<Airspace> result;
+    for(int i=0; i<found.size(); i++) {
+        if (found[i]) {
+            result.append(m_airspaces[i]);
+        }
+    }
+    return result;
+}
+
+
+auto GeoMaps::AviationData::airspaceIndicesInRectangle(const QGeoRectangle& rectangle, const AirspaceFilter& filter) const -> std::vector<int>
+{
+    if (!rectangle.isValid()) {
+        return {};
+    }
+
+    auto result = m_airspaceIndex.query(boxFromRectangle(rectangle));
+    result.erase(std::remove_if(result.begin(), result.end(), [&](int index) { return !matches(index, filter); }), result.end());
+    return result;
+}
+
+
+auto GeoMaps::AviationData::airspacesInRectangle(const QGeoRectangle& rectangle, const AirspaceFilter& filter) const -> QVector<Airspace>
+{
+    QVector<Airspace> result;
+    for(auto index : airspaceIndicesInRectangle(rectangle, filter)) {
+        result.append(m_airspaces[index]);
+    }
+    return result;
+}
+
+
+auto GeoMaps::AviationData::closestWaypoint(const QGeoCoordinate& position) const -> Waypoint
+{
+    auto nearest = m_waypointIndex.nearest(position.latitude(), position.longitude(), 1);
+    if (nearest.empty()) {
+        return {};
+    }
+    return m_waypoints[nearest[0].id];
+}
+
+
+auto GeoMaps::AviationData::filteredWaypoints(const QString& filter) const -> QVector<Waypoint>
+{
+    QVector<Waypoint> result;
+    foreach(auto index, m_waypointSearchIndex.find(filter)) {
+        result.append(m_waypoints[index]);
+    }
+    return result;
+}
+
+
+auto GeoMaps::AviationData::findByID(const QString& id) const -> Waypoint
+{
+    auto index = m_waypointsByICAOCode.value(id, -1);
+    if (index < 0) {
+        return {};
+    }
+    return m_waypoints[index];
+}
+
+
+auto GeoMaps::AviationData::geoJSON() const -> QByteArray
+{
+    auto document = std::atomic_load(&m_geoJSON);
+    if (document == nullptr) {
+        return {};
+    }
+    return *document;
+}
+
+
+auto GeoMaps::AviationData::nearbyWaypoints(const QGeoCoordinate& position, const QString& type, int maxNumber) const -> QVector<Waypoint>
+{
+    auto index = m_waypointIndexByType.constFind(type);
+    if (index == m_waypointIndexByType.constEnd()) {
+        return {};
+    }
+
+    QVector<Waypoint> result;
+    for(const auto& neighbour : index->nearest(position.latitude(), position.longitude(), maxNumber)) {
+        result.append(m_waypoints[neighbour.id]);
+    }
+    return result;
+}
+
+
+auto GeoMaps::AviationData::waypointsWithinRadius(const QGeoCoordinate& position, Units::Distance radius, const QString& type) const -> QVector<Waypoint>
+{
+    const KDTree* index = &m_waypointIndex;
+    if (!type.isEmpty()) {
+        auto typeIndex = m_waypointIndexByType.constFind(type);
+        if (typeIndex == m_waypointIndexByType.constEnd()) {
+            return {};
+        }
+        index = &typeIndex.value();
+    }
+
+    QVector<Waypoint> result;
+    for(const auto& neighbour : index->withinRadius(position.latitude(), position.longitude(), radius.toM())) {
+        result.append(m_waypoints[neighbour.id]);
+    }
+    return result;
+}
+
+
+auto GeoMaps::AviationData::releaseGeoJSON() const -> qint64
+{
+    auto document = std::atomic_exchange(&m_geoJSON, std::shared_ptr<const QByteArray>());
+    if (document == nullptr) {
+        return 0;
+    }
+    return document->size();
+}
+
+
+auto GeoMaps::AviationData::vectorTile(int zoom, int x, int y, int simplificationReduction) const -> QByteArray
+{
+    VectorTileEncoder encoder(zoom, x, y);
+
+    // Use the coarsest level of detail that is still exact at this zoom,
+    // or at a lower zoom if simplificationReduction is set
+    const auto* features = &m_tileFeatures;
+    auto simplificationZoom = zoom-simplificationReduction;
+    for(std::size_t level=0; level<simplificationZooms.size(); level++) {
+        if (simplificationZoom <= simplificationZooms[level]) {
+            features = &m_simplifiedTileFeatures[level];
+            break;
+        }
+    }
+
+    // Add features in document order, so that the map renders them in the
+    // same order as the GeoJSON document
+    auto indices = m_tileFeatureIndex.query(encoder.bounds());
+    std::sort(indices.begin(), indices.end());
+    for(auto index : indices) {
+        encoder.addFeature((*features)[index]);
+    }
+    return encoder.encode("aviationData");
+}
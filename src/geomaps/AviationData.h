@@ -0,0 +1,363 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QGeoPath>
+#include <QGeoRectangle>
+#include <QHash>
+#include <QVector>
+#include <array>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "Airspace.h"
+#include "KDTree.h"
+#include "RTree.h"
+#include "VectorTileEncoder.h"
+#include "Waypoint.h"
+#include "WaypointSearchIndex.h"
+#include "units/Distance.h"
+
+
+namespace GeoMaps {
+
+/*! \brief Criteria for airspace queries
+ *
+ * The default-constructed filter accepts all airspaces.
+ */
+
+struct AirspaceFilter
+{
+    /*! \brief Lower end of the altitude band, in feet above MSL */
+    double bottomInFtMSL {-std::numeric_limits<double>::infinity()};
+
+    /*! \brief Upper end of the altitude band, in feet above MSL */
+    double topInFtMSL {std::numeric_limits<double>::infinity()};
+
+    /*! \brief Include airspaces that begin at FL100 or above, see Airspace::isUpper() */
+    bool includeUpper {true};
+
+    /*! \brief Include gliding sectors */
+    bool includeGlidingSectors {true};
+};
+
+
+/*! \brief Immutable snapshot of the aviation data
+ *
+ * This class holds the union of all installed aviation maps: the list of
+ * waypoints, the list of airspaces, the combined GeoJSON document, the
+ * features from which vector tiles are cut, and all indices that are used to answer queries quickly. Instances are built by the
+ * GeoMapProvider in a worker thread and then published as a
+ * std::shared_ptr<const AviationData>. Once constructed, an instance is never
+ * modified, so that any number of threads can read and query it without
+ * locking. The only exception is the GeoJSON document, which can be released
+ * when memory runs low, see releaseGeoJSON().
+ */
+
+class AviationData
+{
+public:
+    /*! \brief Constructs an empty snapshot
+     *
+     * The snapshot contains no waypoints and no airspaces. The GeoJSON
+     * document is an empty feature collection.
+     */
+    AviationData();
+
+    /*! \brief Constructs a snapshot and builds all indices
+     *
+     * @param waypoints List of waypoints. The waypoints will be sorted by
+     * name.
+     *
+     * @param airspaces List of airspaces
+     *
+     * @param geoJSON Combined GeoJSON document of all aviation maps
+     *
+     * @param tileFeatures Features of the GeoJSON document, in the same order,
+     * as used to generate vector tiles
+     *
+     * @param contentKey Key that identifies the content, see contentKey()
+     */
+    AviationData(QVector<Waypoint> waypoints, QVector<Airspace> airspaces, QByteArray geoJSON, QVector<VectorTileFeature> tileFeatures={}, quint64 contentKey=0);
+
+    /*! \brief Airspaces
+     *
+     * @returns List of all airspaces in the snapshot
+     */
+    const QVector<Airspace>& airspaces() const
+    {
+        return m_airspaces;
+    }
+
+    /*! \brief Airspaces at a given location
+     *
+     * Airspaces that do not match the filter are pruned before their lateral
+     * limits are tested. An airspace matches the altitude band of the filter
+     * if its vertical extent, as given by Airspace::verticalExtentInFtMSL(),
+     * overlaps the band.
+     *
+     * @param position Position over which airspaces are searched for
+     *
+     * @param filter Criteria that the airspaces must match
+     *
+     * @returns All matching airspaces that exist over a given position, sorted
+     * by lower boundary, highest first
+     */
+    QVector<Airspace> airspacesAt(const QGeoCoordinate& position, const AirspaceFilter& filter={}) const;
+
+    /*! \brief Airspaces in a corridor around a path
+     *
+     * @see GeoMapProvider::airspacesInCorridor
+     *
+     * @param path Path around which airspaces are searched for
+     *
+     * @param corridorWidth Width of the corridor
+     *
+     * @param filter Criteria that the airspaces must match, see airspacesAt()
+     *
+     * @returns Matching airspaces whose bounding box intersects the corridor
+     */
+    QVector<Airspace> airspacesInCorridor(const QGeoPath& path, Units::Distance corridorWidth, const AirspaceFilter& filter={}) const;
+
+    /*! \brief Airspaces in a given rectangle
+     *
+     * @see GeoMapProvider::airspacesInRectangle
+     *
+     * @param rectangle Rectangle in which airspaces are searched for
+     *
+     * @param filter Criteria that the airspaces must match, see airspacesAt()
+     *
+     * @returns Matching airspaces whose bounding box intersects the rectangle
+     */
+    QVector<Airspace> airspacesInRectangle(const QGeoRectangle& rectangle, const AirspaceFilter& filter={}) const;
+
+    /*! \brief Indices of airspaces in a given rectangle
+     *
+     * This method works like airspacesInRectangle(), but returns indices into
+     * airspaces() rather than copies. Together with generation(), the indices
+     * identify airspaces uniquely and can be used as keys in caches.
+     *
+     * @param rectangle Rectangle in which airspaces are searched for
+     *
+     * @param filter Criteria that the airspaces must match, see airspacesAt()
+     *
+     * @returns Indices of matching airspaces whose bounding box intersects the
+     * rectangle, in unspecified order
+     */
+    std::vector<int> airspaceIndicesInRectangle(const QGeoRectangle& rectangle, const AirspaceFilter& filter={}) const;
+
+    /*! \brief Closest waypoint
+     *
+     * @param position Position near which waypoints are searched for
+     *
+     * @returns The waypoint closest to the position, or an invalid waypoint if
+     * the snapshot contains no waypoints
+     */
+    Waypoint closestWaypoint(const QGeoCoordinate& position) const;
+
+    /*! \brief Waypoints whose name or code contain a given set of words
+     *
+     * @see WaypointSearchIndex::find
+     *
+     * @param filter List of words
+     *
+     * @returns Matching waypoints, sorted by name
+     */
+    QVector<Waypoint> filteredWaypoints(const QString& filter) const;
+
+    /*! \brief Find waypoint by ICAO code
+     *
+     * @param id ICAO code of the waypoint
+     *
+     * @returns The waypoint, or an invalid waypoint if no waypoint with the
+     * given code exists
+     */
+    Waypoint findByID(const QString& id) const;
+
+    /*! \brief Combined GeoJSON document
+     *
+     * @returns The union of all aviation maps, in GeoJSON format, or an empty
+     * array if the document has been released
+     */
+    QByteArray geoJSON() const;
+
+    /*! \brief Check if the GeoJSON document has been released
+     *
+     * @returns True if releaseGeoJSON() has been called
+     */
+    bool isGeoJSONReleased() const
+    {
+        return std::atomic_load(&m_geoJSON) == nullptr;
+    }
+
+    /*! \brief Release the GeoJSON document
+     *
+     * The GeoJSON document is not needed to answer queries or to generate
+     * vector tiles. This method releases it, in order to save memory. It is
+     * safe to call this method while other threads read the snapshot.
+     *
+     * @returns Number of bytes released
+     */
+    qint64 releaseGeoJSON() const;
+
+    /*! \brief Content key
+     *
+     * Unlike generation(), this key does not change when the app is
+     * restarted. Snapshots built from the same features have the same key, so
+     * that data derived from a snapshot, such as vector tiles, can be stored
+     * on disk and reused later.
+     *
+     * @returns Key of the content, or 0 if the content is not identified
+     */
+    quint64 contentKey() const
+    {
+        return m_contentKey;
+    }
+
+    /*! \brief Generation number
+     *
+     * Every snapshot receives a number that is larger than the numbers of all
+     * snapshots constructed before. The number can be used to distinguish
+     * snapshots, for instance in URLs and cache keys.
+     *
+     * @returns Generation number of this snapshot
+     */
+    quint64 generation() const
+    {
+        return m_generation;
+    }
+
+    /*! \brief Nearby waypoints
+     *
+     * @param position Position near which waypoints are searched for
+     *
+     * @param type Type of waypoints (AD, NAV, WP)
+     *
+     * @param maxNumber Maximal number of waypoints returned
+     *
+     * @returns Waypoints of the given type closest to the position, sorted by
+     * distance
+     */
+    QVector<Waypoint> nearbyWaypoints(const QGeoCoordinate& position, const QString& type, int maxNumber) const;
+
+    /*! \brief Waypoints
+     *
+     * @returns List of all waypoints in the snapshot, sorted by name
+     */
+    const QVector<Waypoint>& waypoints() const
+    {
+        return m_waypoints;
+    }
+
+    /*! \brief Waypoints within a given radius
+     *
+     * @see GeoMapProvider::waypointsWithinRadius
+     *
+     * @param position Center of the search area
+     *
+     * @param radius Search radius
+     *
+     * @param type Type of waypoints (AD, NAV, WP), or an empty string for
+     * waypoints of all types
+     *
+     * @returns Matching waypoints, sorted by distance
+     */
+    QVector<Waypoint> waypointsWithinRadius(const QGeoCoordinate& position, Units::Distance radius, const QString& type={}) const;
+
+    /*! \brief Vector tile
+     *
+     * This method cuts a Mapbox Vector Tile from the features of the snapshot.
+     * The tile contains a single layer, called "aviationData", which holds
+     * the same features and properties as the GeoJSON document. At low zoom
+     * levels, lines and polygons are taken from simplified copies that are
+     * computed together with the snapshot.
+     *
+     * @param zoom Zoom level of the tile
+     *
+     * @param x Column of the tile
+     *
+     * @param y Row of the tile, counted from the north
+     *
+     * @param simplificationReduction Number of zoom levels by which the
+     * geometry is coarsened, in order to save rendering time. With the
+     * default value 0, the simplification is invisible at the given zoom.
+     *
+     * @returns Tile in protobuf format, without compression
+     */
+    QByteArray vectorTile(int zoom, int x, int y, int simplificationReduction=0) const;
+
+private:
+    QVector<Waypoint> m_waypoints;
+    QVector<Airspace> m_airspaces;
+    mutable std::shared_ptr<const QByteArray> m_geoJSON;
+    QVector<VectorTileFeature> m_tileFeatures;
+    quint64 m_generation;
+    quint64 m_contentKey {0};
+
+    // Spatial index for m_tileFeatures, entries are indices into m_tileFeatures
+    RTree m_tileFeatureIndex;
+
+    // Zoom levels for which simplified tile features are precomputed, in
+    // ascending order. Tiles of zoom z use the first level that is at least z.
+    // Above the last level, tiles are cut from the full-resolution features.
+    static constexpr std::array<int, 4> simplificationZooms {4, 6, 8, 10};
+
+    // Simplified copies of m_tileFeatures, one for each entry of
+    // simplificationZooms, with the same indices as m_tileFeatures
+    std::vector<QVector<VectorTileFeature>> m_simplifiedTileFeatures;
+
+    // Spatial index for m_airspaces, entries are indices into m_airspaces
+    RTree m_airspaceIndex;
+
+    // Data used to prune airspace queries, with one entry for each element of
+    // m_airspaces. Kept separate from the airspaces, so that the pruning does
+    // not touch the airspace objects.
+    struct AirspaceAttributes {
+        double bottomInFtMSL;
+        double topInFtMSL;
+        bool isUpper;
+        bool isGlidingSector;
+    };
+    std::vector<AirspaceAttributes> m_airspaceAttributes;
+
+    // Checks if airspace number index matches the filter
+    bool matches(int index, const AirspaceFilter& filter) const
+    {
+        const auto& attributes = m_airspaceAttributes[index];
+        return (attributes.bottomInFtMSL <= filter.topInFtMSL) && (attributes.topInFtMSL >= filter.bottomInFtMSL) &&
+                (filter.includeUpper || !attributes.isUpper) &&
+                (filter.includeGlidingSectors || !attributes.isGlidingSector);
+    }
+
+    // Spatial indices for m_waypoints, IDs are indices into m_waypoints. There
+    // is one index for all waypoints and one for each waypoint type.
+    KDTree m_waypointIndex;
+    QHash<QString, KDTree> m_waypointIndexByType;
+
+    // Full-text index for m_waypoints
+    WaypointSearchIndex m_waypointSearchIndex;
+
+    // Indices into m_waypoints, by ICAO code
+    QHash<QString, int> m_waypointsByICAOCode;
+};
+
+};
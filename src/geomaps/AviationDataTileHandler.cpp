@@ -0,0 +1,124 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <utility>
+
+#include <qhttpengine/socket.h>
+
+#include "AviationDataTileHandler.h"
+#include "GeoMapProvider.h"
+#include "GlobalObject.h"
+#include "Profiler.h"
+#include "TileHandler.h"
+
+
+GeoMaps::AviationDataTileHandler::AviationDataTileHandler(QString baseURLName, TileCache* tileCache, QObject *parent)
+    : Handler(parent),
+      _baseURLName(std::move(baseURLName)),
+      _tileCache(tileCache)
+{
+}
+
+
+void GeoMaps::AviationDataTileHandler::process(QHttpEngine::Socket *socket, const QString &path)
+{
+    PROFILER_SCOPE(Profiler::TileServing);
+    auto aviationData = GlobalObject::geoMapProvider()->aviationData();
+    auto generation = QString::number(aviationData->generation());
+
+    // Serve tileJSON file, if requested
+    QRegularExpression tileJSONPattern("^/?([0-9]+(?:-[0-9])?)\\.json$");
+    auto tileJSONMatch = tileJSONPattern.match(path);
+    if (tileJSONMatch.hasMatch()) {
+        auto requestedGeneration = tileJSONMatch.captured(1);
+        if (requestedGeneration != _tileJSONGeneration) {
+            _tileJSONGeneration = requestedGeneration;
+            _tileJSON = tileJSON(requestedGeneration);
+            _tileJSONETag = TileHandler::eTag(_tileJSON);
+        }
+        TileHandler::writeJSON(socket, _tileJSON, _tileJSONETag);
+        return;
+    }
+
+    // Serve tile, if requested. Requests for tiles of older snapshots are
+    // answered with tiles of the current snapshot; the map will load the new
+    // style file shortly.
+    QRegularExpression tileQueryPattern("^/?[0-9]+(?:-([0-9]))?/([0-9]{1,2})/([0-9]{1,5})/([0-9]{1,5})\\.pbf$");
+    auto match = tileQueryPattern.match(path);
+    if (match.hasMatch()) {
+        auto simplificationReduction = match.captured(1).toInt();
+        auto z = match.captured(2).toUInt();
+        auto x = match.captured(3).toUInt();
+        auto y = match.captured(4).toUInt();
+        if ((z <= static_cast<uint>(maxzoom)) && (x < (1U << z)) && (y < (1U << z))) {
+            // The bundle is kept alive until the data has been written
+            auto briefingBundle = _briefingBundle;
+            QByteArray data;
+            if ((briefingBundle != nullptr) && (simplificationReduction == 0) && (aviationData->contentKey() != 0)) {
+                data = briefingBundle->tile(aviationData->contentKey(), z, x, y);
+            }
+
+            auto tileSet = "aviationData/"+generation+"-"+QString::number(simplificationReduction);
+            if (data.isEmpty() && ((_tileCache == nullptr) || !_tileCache->find(tileSet, z, x, y, data))) {
+                data = aviationData->vectorTile(static_cast<int>(z), static_cast<int>(x), static_cast<int>(y), simplificationReduction);
+                if (_tileCache != nullptr) {
+                    _tileCache->insert(tileSet, z, x, y, data);
+                }
+            }
+
+            // Set the headers and write the content
+            socket->setHeader("Content-Type", "application/octet-stream");
+            socket->setHeader("Content-Length", QByteArray::number(data.length()));
+            socket->write(data);
+            socket->close();
+            return;
+        }
+    }
+
+    // Unknown request, responding with 'not found'
+    socket->writeError(QHttpEngine::Socket::NotFound);
+    socket->close();
+}
+
+
+auto GeoMaps::AviationDataTileHandler::tileJSON(const QString& generation) const -> QByteArray
+{
+    QJsonObject result;
+    result.insert("tilejson", "2.2.0");
+
+    // Insert tiles
+    QJsonArray tiles;
+    tiles.append(_baseURLName+"/"+generation+"/{z}/{x}/{y}.pbf");
+    result.insert("tiles", tiles);
+
+    result.insert("name", "aviationData");
+    result.insert("description", "Aviation data");
+    result.insert("minzoom", 0);
+    result.insert("maxzoom", maxzoom);
+
+    QJsonDocument tileJSONDocument;
+    tileJSONDocument.setObject(result);
+    return tileJSONDocument.toJson();
+}
@@ -0,0 +1,121 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <memory>
+
+#include <qhttpengine/handler.h>
+
+#include "BriefingBundle.h"
+#include "TileCache.h"
+
+
+namespace GeoMaps {
+
+/*! \brief Implementation of QHttpEngine::Handler that serves aviation data as vector tiles
+
+  This handler serves the current snapshot of the aviation data, as returned
+  by GeoMapProvider::aviationData(), in the form of Mapbox Vector Tiles with a
+  single layer called "aviationData". Tiles are cut on demand and kept in the
+  tile cache of the TileServer. The handler answers the following requests.
+
+  - "<generation>.json" returns a TileJSON file (following the TileJSON
+    Specification 2.2.0 found
+    https://github.com/mapbox/tilejson-spec/tree/master/2.2.0) that describes
+    the tile set of the snapshot with the given generation number.
+
+  - "<generation>/{z}/{x}/{y}.pbf" returns a tile. The tiles are not
+    compressed.
+
+  The generation number can be followed by "-<n>", with a single digit n, in
+  order to request tiles whose airspace geometry is coarsened by n zoom
+  levels, see AviationData::vectorTile().
+
+  Tiles without coarsening are served from the briefing bundle first, if the
+  bundle holds tiles of the current snapshot.
+*/
+
+class AviationDataTileHandler : public QHttpEngine::Handler
+{
+  Q_OBJECT
+
+public:
+  /*! \brief Create a new tile handler
+
+    @param baseURLName The name of the URL under which the tile server allows
+    access to this handler. Typically a string of the form
+    "http://localhost:8080/aviationData"
+
+    @param tileCache Cache for tile data, shared by all tile handlers of the
+    tile server. Can be a nullptr, in which case tiles are never cached.
+
+    @param parent The standard QObject parent
+  */
+  explicit AviationDataTileHandler(QString baseURLName, TileCache* tileCache = nullptr, QObject *parent = nullptr);
+
+  // Destructor
+  ~AviationDataTileHandler() override = default;
+
+  /*! \brief Maximal zoom level for which tiles are generated
+
+    At higher zoom levels, the map overzooms the tiles of this level.
+  */
+  static constexpr int maxzoom = 12;
+
+  /*! \brief Set the briefing bundle
+
+    @param briefingBundle Bundle, or nullptr. The source of the tiles in the
+    bundle is AviationData::contentKey().
+  */
+  void setBriefingBundle(std::shared_ptr<const BriefingBundle> briefingBundle) {_briefingBundle = std::move(briefingBundle);}
+
+protected:
+  /*
+   * @brief Reimplementation of
+   * [Handler::process()](QHttpEngine::Handler::process)
+   */
+  void process(QHttpEngine::Socket *socket, const QString &path) override;
+
+private:
+  Q_DISABLE_COPY_MOVE(AviationDataTileHandler)
+
+  // TileJSON for the snapshot with the given generation number
+  QByteArray tileJSON(const QString& generation) const;
+
+  QString _baseURLName;
+
+  // Serialized TileJSON of the most recently requested generation, with its
+  // entity tag. The renderer requests the TileJSON of one generation only.
+  QString _tileJSONGeneration;
+  QByteArray _tileJSON;
+  QByteArray _tileJSONETag;
+
+  // Cache for tile data, not owned by this handler. Tiles are stored under
+  // the names "aviationData/<generation>-<n>". Tiles of older snapshots are
+  // never requested again and will eventually be dropped by the cache.
+  TileCache* _tileCache;
+
+  // Tiles prepared for a flight, consulted before the cache
+  std::shared_ptr<const BriefingBundle> _briefingBundle;
+};
+
+};
@@ -0,0 +1,158 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QDataStream>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "BriefingBundle.h"
+#include "Metrics.h"
+#include "dataManagement/FileRegistry.h"
+
+
+GeoMaps::BriefingBundle::BriefingBundle(const QString& fileName)
+    : m_file(std::make_shared<const DataManagement::MappedFile>(fileName))
+{
+    // Paranoid safety checks
+    const auto* data = m_file->data();
+    auto size = m_file->size();
+    if ((data == nullptr) || (size < headerSize) || (std::memcmp(data, "ENBR", 4) != 0) || (qFromLittleEndian<quint32>(data+4) != 1)) {
+        return;
+    }
+
+    auto created = qFromLittleEndian<qint64>(data+8);
+    auto west = qFromLittleEndian<double>(data+16);
+    auto south = qFromLittleEndian<double>(data+24);
+    auto east = qFromLittleEndian<double>(data+32);
+    auto north = qFromLittleEndian<double>(data+40);
+    auto numTiles = qFromLittleEndian<quint32>(data+48);
+    if (!std::isfinite(west) || !std::isfinite(south) || !std::isfinite(east) || !std::isfinite(north) ||
+            (numTiles > static_cast<quint64>((size-headerSize)/entrySize))) {
+        return;
+    }
+
+    // Every tile must lie inside the file, behind the index
+    auto dataBegin = static_cast<quint64>(headerSize+entrySize*numTiles);
+    for(quint32 i=0; i<numTiles; i++) {
+        const auto* entry = data+headerSize+entrySize*i;
+        auto offset = qFromLittleEndian<quint64>(entry+16);
+        auto tileSize = qFromLittleEndian<quint32>(entry+24);
+        if ((offset < dataBegin) || (offset > static_cast<quint64>(size)) || (tileSize > static_cast<quint64>(size)-offset)) {
+            return;
+        }
+    }
+
+    m_created = QDateTime::fromMSecsSinceEpoch(created, Qt::UTC);
+    m_corridor = QGeoRectangle(QGeoCoordinate(north, west), QGeoCoordinate(south, east));
+    m_numTiles = static_cast<int>(numTiles);
+    m_index = data+headerSize;
+}
+
+
+auto GeoMaps::BriefingBundle::tile(quint64 source, quint32 z, quint32 x, quint32 y) const -> QByteArray
+{
+    static auto* hitsMetric = Metrics::counter(QStringLiteral("briefingBundle/tileHits"));
+
+    if (!isValid()) {
+        return {};
+    }
+
+    // Binary search in the index, which is sorted by source and key
+    auto key = tileKey(z, x, y);
+    int first = 0;
+    int count = m_numTiles;
+    while (count > 0) {
+        auto step = count/2;
+        const auto* entry = m_index+entrySize*(first+step);
+        auto entrySource = qFromLittleEndian<quint64>(entry);
+        auto entryKey = qFromLittleEndian<quint64>(entry+8);
+        if ((entrySource < source) || ((entrySource == source) && (entryKey < key))) {
+            first += step+1;
+            count -= step+1;
+        } else {
+            count = step;
+        }
+    }
+    if (first >= m_numTiles) {
+        return {};
+    }
+    const auto* entry = m_index+entrySize*first;
+    if ((qFromLittleEndian<quint64>(entry) != source) || (qFromLittleEndian<quint64>(entry+8) != key)) {
+        return {};
+    }
+
+    hitsMetric->add();
+    auto offset = qFromLittleEndian<quint64>(entry+16);
+    auto tileSize = qFromLittleEndian<quint32>(entry+24);
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(m_file->data()+offset), static_cast<int>(tileSize));
+}
+
+
+auto GeoMaps::BriefingBundle::write(const QString& fileName, QVector<Tile> tiles, const QGeoRectangle& corridor) -> bool
+{
+    // Sort the tiles as in the index, and drop duplicates and empty tiles
+    auto before = [](const Tile& a, const Tile& b) {
+        auto keyA = tileKey(a.z, a.x, a.y);
+        auto keyB = tileKey(b.z, b.x, b.y);
+        return (a.source < b.source) || ((a.source == b.source) && (keyA < keyB));
+    };
+    auto equal = [](const Tile& a, const Tile& b) {
+        return (a.source == b.source) && (a.z == b.z) && (a.x == b.x) && (a.y == b.y);
+    };
+    tiles.erase(std::remove_if(tiles.begin(), tiles.end(), [](const Tile& tile) { return tile.data.isEmpty(); }), tiles.end());
+    std::sort(tiles.begin(), tiles.end(), before);
+    tiles.erase(std::unique(tiles.begin(), tiles.end(), equal), tiles.end());
+
+    DataManagement::FileRegistry::WriteLocker locker(fileName);
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+    // Header
+    out.writeRawData("ENBR", 4);
+    out << static_cast<quint32>(1) << QDateTime::currentMSecsSinceEpoch();
+    out << corridor.topLeft().longitude() << corridor.bottomRight().latitude() << corridor.bottomRight().longitude() << corridor.topLeft().latitude();
+    out << static_cast<quint32>(tiles.size()) << static_cast<quint32>(0);
+
+    // Index
+    auto offset = static_cast<quint64>(headerSize+entrySize*tiles.size());
+    foreach(auto tile, tiles) {
+        out << tile.source << tileKey(tile.z, tile.x, tile.y) << offset << static_cast<quint32>(tile.data.size()) << static_cast<quint32>(0);
+        offset += static_cast<quint64>(tile.data.size());
+    }
+
+    // Tile data
+    foreach(auto tile, tiles) {
+        out.writeRawData(tile.data.constData(), tile.data.size());
+    }
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
@@ -0,0 +1,200 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QDateTime>
+#include <QGeoRectangle>
+#include <QVector>
+#include <memory>
+
+#include "dataManagement/MappedFile.h"
+
+
+namespace GeoMaps {
+
+/*! \brief Memory-mapped bundle of tiles for a planned flight
+ *
+ * This class reads tiles from a file in the following format, which is
+ * memory-mapped, so that serving a tile takes a binary search in the index
+ * and nothing else. All numbers are little-endian.
+ *
+ * | Offset | Type     | Content                                                |
+ * |--------|----------|--------------------------------------------------------|
+ * | 0      | char[4]  | Magic "ENBR"                                           |
+ * | 4      | quint32  | Format version, currently 1                            |
+ * | 8      | qint64   | Time of creation, in milliseconds since the epoch, UTC |
+ * | 16     | double   | Western, southern, eastern and northern edge of the corridor, in degrees |
+ * | 48     | quint32  | Number of tiles                                        |
+ * | 52     | quint32  | Reserved, always 0                                     |
+ * | 56     | Entry[]  | Index, sorted by source and tile key                   |
+ *
+ * Every entry of the index takes 32 bytes: the source of the tile as
+ * quint64, its tileKey() as quint64, the offset of the tile data in the file
+ * as quint64 and the size of the data as quint32, followed by four reserved
+ * bytes. The source identifies the data from which the tile was taken, such
+ * as TileHandler::contentKey() or AviationData::contentKey(), so that tiles
+ * are never served once the data has changed.
+ *
+ * Once constructed, the instance is never modified. It can therefore be
+ * read from several threads at the same time.
+ */
+
+class BriefingBundle
+{
+public:
+    /*! \brief Tile, as passed to write() */
+    struct Tile {
+        /*! \brief Source of the tile */
+        quint64 source {0};
+
+        /*! \brief Zoom level */
+        quint32 z {0};
+
+        /*! \brief Column */
+        quint32 x {0};
+
+        /*! \brief Row, counted from the north, as in XYZ URLs */
+        quint32 y {0};
+
+        /*! \brief Tile data */
+        QByteArray data;
+    };
+
+    /*! \brief Maps a file
+     *
+     * @param fileName Name of a file in the format described above
+     */
+    explicit BriefingBundle(const QString& fileName);
+
+    /*! \brief Corridor covered by the bundle
+     *
+     * @returns Bounding rectangle of the corridor for which the bundle was
+     * prepared
+     */
+    QGeoRectangle corridor() const
+    {
+        return m_corridor;
+    }
+
+    /*! \brief Time of creation
+     *
+     * @returns Time at which the bundle was written
+     */
+    QDateTime created() const
+    {
+        return m_created;
+    }
+
+    /*! \brief Check if the file could be mapped and is well-formed
+     *
+     * @returns True if tiles can be read
+     */
+    bool isValid() const
+    {
+        return m_index != nullptr;
+    }
+
+    /*! \brief Number of tiles
+     *
+     * @returns Number of tiles in the bundle
+     */
+    int numTiles() const
+    {
+        return m_numTiles;
+    }
+
+    /*! \brief Size of the file
+     *
+     * @returns Size of the file in bytes
+     */
+    qint64 size() const
+    {
+        return m_file->size();
+    }
+
+    /*! \brief Tile data
+     *
+     * @param source Source of the tile, as passed to write()
+     *
+     * @param z Zoom level
+     *
+     * @param x Column
+     *
+     * @param y Row, counted from the north
+     *
+     * @returns Tile data, or an empty array if the bundle does not contain
+     * the tile. The array refers to the mapped memory and does not copy it.
+     * It must be copied if it is used after the instance has been
+     * destructed.
+     */
+    QByteArray tile(quint64 source, quint32 z, quint32 x, quint32 y) const;
+
+    /*! \brief Identifies a tile, packed into 64 bits
+     *
+     * @param z Zoom level
+     *
+     * @param x Column
+     *
+     * @param y Row
+     *
+     * @returns Key of the tile
+     */
+    static quint64 tileKey(quint32 z, quint32 x, quint32 y)
+    {
+        return (static_cast<quint64>(z) << 48) | (static_cast<quint64>(x) << 24) | static_cast<quint64>(y);
+    }
+
+    /*! \brief Write a bundle
+     *
+     * The file is written atomically while holding a
+     * DataManagement::FileRegistry::WriteLocker. Tiles with empty data are
+     * skipped. This method is thread-safe.
+     *
+     * @param fileName Name of the file
+     *
+     * @param tiles Tiles. If a tile appears more than once, only one of the
+     * copies is written.
+     *
+     * @param corridor Corridor covered by the tiles
+     *
+     * @returns True on success
+     */
+    static bool write(const QString& fileName, QVector<Tile> tiles, const QGeoRectangle& corridor);
+
+private:
+    Q_DISABLE_COPY_MOVE(BriefingBundle)
+
+    // Size of the header, before the index, and of an index entry
+    static constexpr qint64 headerSize = 56;
+    static constexpr qint64 entrySize = 32;
+
+    std::shared_ptr<const DataManagement::MappedFile> m_file;
+
+    // Data from the header
+    QDateTime m_created;
+    QGeoRectangle m_corridor;
+    int m_numTiles {0};
+
+    // Index, inside the mapped file, or nullptr if the file is invalid
+    const uchar* m_index {nullptr};
+};
+
+};
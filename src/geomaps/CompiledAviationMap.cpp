@@ -0,0 +1,450 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+#include "CompiledAviationMap.h"
+#include "GeoJSONStreamReader.h"
+#include "dataManagement/FileRegistry.h"
+#include "dataManagement/MappedFile.h"
+
+
+namespace {
+
+// Magic number and format version of the binary cache. Increase the version
+// whenever the format changes, or whenever the interpretation of GeoJSON by
+// the classes Waypoint and Airspace changes.
+const quint32 cacheMagic = 0x454E5243; // "ENRC"
+const quint32 cacheVersion = 4;
+
+// Tags for property values
+enum ValueTag : quint8 {
+    StringValue = 0,
+    DoubleValue = 1,
+    VariantValue = 2
+};
+
+// 64-bit FNV-1a hash. Unlike qHash, the result does not depend on a seed that
+// changes with every program start, so it can be stored in the cache.
+auto featureKey(const QByteArray& data) -> quint64
+{
+    quint64 hash = 14695981039346656037ULL;
+    for(auto character : data) {
+        hash ^= static_cast<quint8>(character);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Equivalents of QJsonValue::toDouble() and QJsonValue::toString() for
+// values produced by QJsonValue::toVariant()
+auto jsonDouble(const QVariant& value) -> double
+{
+    if (value.type() == QVariant::Double) {
+        return value.toDouble();
+    }
+    return 0.0;
+}
+
+auto jsonString(const QVariant& value) -> QString
+{
+    if (value.type() == QVariant::String) {
+        return value.toString();
+    }
+    return {};
+}
+
+// Table of interned strings, used when writing the cache
+class StringTable
+{
+public:
+    quint32 indexOf(const QString& string)
+    {
+        auto it = m_indices.constFind(string);
+        if (it != m_indices.constEnd()) {
+            return it.value();
+        }
+        auto index = static_cast<quint32>(m_strings.size());
+        m_indices.insert(string, index);
+        m_strings.append(string);
+        return index;
+    }
+
+    const QVector<QString>& strings() const
+    {
+        return m_strings;
+    }
+
+private:
+    QHash<QString, quint32> m_indices;
+    QVector<QString> m_strings;
+};
+
+}
+
+
+GeoMaps::CompiledAviationMap::CompiledAviationMap(const QString& geoJSONFileName)
+{
+    QFileInfo sourceInfo(geoJSONFileName);
+    if (!sourceInfo.exists()) {
+        return;
+    }
+    if (readCache(geoJSONFileName, sourceInfo)) {
+        return;
+    }
+    clear();
+
+    readGeoJSON(geoJSONFileName);
+    writeCache(geoJSONFileName, sourceInfo);
+}
+
+
+auto GeoMaps::CompiledAviationMap::isCurrent(const QString& geoJSONFileName) const -> bool
+{
+    return m_sourceGeneration == DataManagement::FileRegistry::generation(geoJSONFileName);
+}
+
+
+auto GeoMaps::CompiledAviationMap::read(const QString& geoJSONFileName) -> CompiledAviationMap
+{
+    DataManagement::FileRegistry::ReadLocker locker(geoJSONFileName);
+    CompiledAviationMap map(geoJSONFileName);
+    map.m_sourceGeneration = DataManagement::FileRegistry::generation(geoJSONFileName);
+    return map;
+}
+
+
+void GeoMaps::CompiledAviationMap::clear()
+{
+    m_features.clear();
+    m_geoJSONText.clear();
+    m_waypoints.clear();
+    m_airspaces.clear();
+}
+
+
+auto GeoMaps::CompiledAviationMap::readCache(const QString& geoJSONFileName, const QFileInfo& sourceInfo) -> bool
+{
+    QFile file(cacheFileName(geoJSONFileName));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    auto size = file.size();
+    auto* memory = file.map(0, size);
+    if (memory == nullptr) {
+        return false;
+    }
+
+    // The QByteArray refers to the mapped memory and does not copy it
+    auto raw = QByteArray::fromRawData(reinterpret_cast<const char*>(memory), static_cast<int>(size));
+    QDataStream in(raw);
+    in.setVersion(QDataStream::Qt_5_15);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    // Header
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint64 sourceSize = 0;
+    qint64 sourceLastModified = 0;
+    in >> magic >> version >> sourceSize >> sourceLastModified;
+    if ((in.status() != QDataStream::Ok) || (magic != cacheMagic) || (version != cacheVersion) ||
+            (sourceSize != sourceInfo.size()) || (sourceLastModified != sourceInfo.lastModified().toMSecsSinceEpoch())) {
+        return false;
+    }
+
+    // Interned strings
+    quint32 numStrings = 0;
+    in >> numStrings;
+    if ((in.status() != QDataStream::Ok) || (numStrings > static_cast<quint64>(size))) {
+        return false;
+    }
+    QVector<QString> strings(static_cast<int>(numStrings));
+    for(auto& string : strings) {
+        in >> string;
+    }
+    auto string = [&](quint32 index) {
+        return (index < numStrings) ? strings.at(static_cast<int>(index)) : QString();
+    };
+
+    // Features
+    quint32 numFeatures = 0;
+    in >> numFeatures;
+    if ((in.status() != QDataStream::Ok) || (numFeatures > static_cast<quint64>(size))) {
+        return false;
+    }
+    m_features.reserve(static_cast<int>(numFeatures));
+    m_geoJSONText.reserve(static_cast<int>(size));
+    for(quint32 i=0; (i<numFeatures) && (in.status() == QDataStream::Ok); i++) {
+        Feature feature;
+        quint8 type = 0;
+        quint8 flags = 0;
+        quint32 geoJSONSize = 0;
+        in >> type >> flags >> feature.key >> geoJSONSize;
+
+        // The GeoJSON is serialized as a QByteArray. It is read directly
+        // into the shared buffer instead of into a QByteArray of its own.
+        if (geoJSONSize == 0xFFFFFFFF) {
+            geoJSONSize = 0;
+        }
+        if (geoJSONSize > static_cast<quint64>(size)) {
+            return false;
+        }
+        feature.geoJSONOffset = m_geoJSONText.size();
+        feature.geoJSONSize = static_cast<int>(geoJSONSize);
+        m_geoJSONText.resize(feature.geoJSONOffset+feature.geoJSONSize);
+        if (in.readRawData(m_geoJSONText.data()+feature.geoJSONOffset, feature.geoJSONSize) != feature.geoJSONSize) {
+            return false;
+        }
+        feature.isUpperAirspace = ((flags & 0x01) != 0);
+        feature.isGlidingSector = ((flags & 0x02) != 0);
+
+        // Geometry, as flat arrays
+        quint8 geometryType = 0;
+        quint32 numParts = 0;
+        in >> geometryType >> numParts;
+        if (numParts > static_cast<quint64>(size)) {
+            return false;
+        }
+        auto& tileFeature = feature.tileFeature;
+        tileFeature.geometryType = static_cast<VectorTileFeature::GeometryType>(geometryType);
+        quint64 numCoordinates = 0;
+        for(quint32 j=0; j<numParts; j++) {
+            quint32 partSize = 0;
+            in >> partSize;
+            tileFeature.partSizes.append(static_cast<int>(partSize));
+            numCoordinates += partSize;
+        }
+        if (numCoordinates > static_cast<quint64>(size)) {
+            return false;
+        }
+        tileFeature.coordinates.resize(static_cast<int>(2*numCoordinates));
+        for(auto& coordinate : tileFeature.coordinates) {
+            in >> coordinate;
+        }
+
+        // Properties
+        quint32 numProperties = 0;
+        in >> numProperties;
+        for(quint32 j=0; (j<numProperties) && (in.status() == QDataStream::Ok); j++) {
+            quint32 key = 0;
+            quint8 tag = 0;
+            in >> key >> tag;
+            switch(tag) {
+            case StringValue: {
+                quint32 value = 0;
+                in >> value;
+                tileFeature.properties.insert(string(key), string(value));
+                break;
+            }
+            case DoubleValue: {
+                double value = 0.0;
+                in >> value;
+                tileFeature.properties.insert(string(key), value);
+                break;
+            }
+            case VariantValue: {
+                QVariant value;
+                in >> value;
+                tileFeature.properties.insert(string(key), value);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        if (in.status() != QDataStream::Ok) {
+            return false;
+        }
+
+        // Restore waypoint or airspace from the geometry and the properties,
+        // in the same way as the constructors that take GeoJSON
+        if ((type == WaypointFeature) && (tileFeature.coordinates.size() >= 2)) {
+            QGeoCoordinate coordinate(tileFeature.coordinates[0], tileFeature.coordinates[1]);
+            if (tileFeature.properties.contains("ELE")) {
+                coordinate.setAltitude(jsonDouble(tileFeature.properties.value("ELE")));
+            }
+            feature.type = WaypointFeature;
+            feature.index = m_waypoints.size();
+            m_waypoints.append(Waypoint(coordinate, QMultiMap<QString, QVariant>(tileFeature.properties)));
+        }
+        if ((type == AirspaceFeature) && !tileFeature.partSizes.isEmpty()) {
+            auto size = static_cast<std::size_t>(tileFeature.partSizes[0]);
+            std::vector<double> latitudes(size);
+            std::vector<double> longitudes(size);
+            for(std::size_t j=0; j<size; j++) {
+                latitudes[j] = tileFeature.coordinates[static_cast<int>(2*j)];
+                longitudes[j] = tileFeature.coordinates[static_cast<int>(2*j+1)];
+            }
+
+            // Airspace(const QJsonObject&) stops reading properties at the
+            // first one that is missing
+            const auto& properties = tileFeature.properties;
+            QStringList limits;
+            foreach(auto key, QStringList({"CAT", "NAM", "TOP", "BOT"})) {
+                if (!properties.contains(key)) {
+                    break;
+                }
+                limits += jsonString(properties.value(key));
+            }
+            while (limits.size() < 4) {
+                limits += QString();
+            }
+
+            feature.type = AirspaceFeature;
+            feature.index = m_airspaces.size();
+            m_airspaces.append(Airspace(limits[1], limits[0], limits[2], limits[3], latitudes, longitudes));
+        }
+
+        m_features.append(feature);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+    m_geoJSONText.squeeze();
+    return true;
+}
+
+
+void GeoMaps::CompiledAviationMap::readGeoJSON(const QString& geoJSONFileName)
+{
+    // Map the file into memory and read the features one by one, so that the
+    // file content is not copied and the DOM of the full document is never
+    // held in memory
+    DataManagement::MappedFile file(geoJSONFileName);
+    if (file.data() == nullptr) {
+        return;
+    }
+    GeoJSONStreamReader reader(file.bytes());
+    m_geoJSONText.reserve(file.bytes().size());
+
+    QJsonObject object;
+    while (reader.readNext(object)) {
+        Feature feature;
+        auto geoJSON = QJsonDocument(object).toJson(QJsonDocument::JsonFormat::Compact);
+        feature.key = featureKey(geoJSON);
+        feature.geoJSONOffset = m_geoJSONText.size();
+        feature.geoJSONSize = geoJSON.size();
+        m_geoJSONText += geoJSON;
+        feature.tileFeature = VectorTileFeature::fromGeoJSON(object);
+
+        Airspace airspaceTest(object);
+        feature.isUpperAirspace = airspaceTest.isUpper();
+        feature.isGlidingSector = (airspaceTest.CAT() == "GLD");
+
+        // Upper airspaces are marked in the vector tiles, so that the map
+        // style can hide them with a layer filter
+        if (feature.isUpperAirspace && (feature.tileFeature.geometryType != VectorTileFeature::Unknown)) {
+            feature.tileFeature.properties.insert(QStringLiteral("UPPER"), true);
+        }
+
+        // Check if the current object is a waypoint or an airspace
+        Waypoint wp(object);
+        if (wp.isValid()) {
+            feature.type = WaypointFeature;
+            feature.index = m_waypoints.size();
+            m_waypoints.append(wp);
+        } else if (airspaceTest.isValid()) {
+            feature.type = AirspaceFeature;
+            feature.index = m_airspaces.size();
+            m_airspaces.append(airspaceTest);
+        }
+
+        m_features.append(feature);
+    }
+
+    // Like QJsonDocument::fromJson, ignore files that are not well-formed
+    if (reader.hasError()) {
+        clear();
+    }
+    m_geoJSONText.squeeze();
+}
+
+
+void GeoMaps::CompiledAviationMap::writeCache(const QString& geoJSONFileName, const QFileInfo& sourceInfo) const
+{
+    // Serialize the features first, collecting the strings
+    StringTable strings;
+    QByteArray featureData;
+    QDataStream featureStream(&featureData, QIODevice::WriteOnly);
+    featureStream.setVersion(QDataStream::Qt_5_15);
+    featureStream.setByteOrder(QDataStream::LittleEndian);
+
+    foreach(auto feature, m_features) {
+        quint8 flags = 0;
+        if (feature.isUpperAirspace) {
+            flags |= 0x01;
+        }
+        if (feature.isGlidingSector) {
+            flags |= 0x02;
+        }
+        featureStream << static_cast<quint8>(feature.type) << flags << feature.key
+                      << QByteArray::fromRawData(m_geoJSONText.constData()+feature.geoJSONOffset, feature.geoJSONSize);
+
+        const auto& tileFeature = feature.tileFeature;
+        featureStream << static_cast<quint8>(tileFeature.geometryType) << static_cast<quint32>(tileFeature.partSizes.size());
+        foreach(auto partSize, tileFeature.partSizes) {
+            featureStream << static_cast<quint32>(partSize);
+        }
+        foreach(auto coordinate, tileFeature.coordinates) {
+            featureStream << coordinate;
+        }
+
+        featureStream << static_cast<quint32>(tileFeature.properties.size());
+        for(auto it = tileFeature.properties.constBegin(); it != tileFeature.properties.constEnd(); ++it) {
+            featureStream << strings.indexOf(it.key());
+            const auto& value = it.value();
+            if (value.type() == QVariant::String) {
+                featureStream << static_cast<quint8>(StringValue) << strings.indexOf(value.toString());
+            } else if (value.type() == QVariant::Double) {
+                featureStream << static_cast<quint8>(DoubleValue) << value.toDouble();
+            } else {
+                featureStream << static_cast<quint8>(VariantValue) << value;
+            }
+        }
+    }
+
+    // Now write the file. QSaveFile guarantees that readers never see a
+    // partially written cache.
+    QSaveFile file(cacheFileName(geoJSONFileName));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << cacheMagic << cacheVersion << static_cast<qint64>(sourceInfo.size()) << static_cast<qint64>(sourceInfo.lastModified().toMSecsSinceEpoch());
+    out << static_cast<quint32>(strings.strings().size());
+    foreach(auto string, strings.strings()) {
+        out << string;
+    }
+    out << static_cast<quint32>(m_features.size());
+    out.writeRawData(featureData.constData(), featureData.size());
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return;
+    }
+    file.commit();
+}
@@ -0,0 +1,202 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QFileInfo>
+#include <QVector>
+
+#include "Airspace.h"
+#include "VectorTileEncoder.h"
+#include "Waypoint.h"
+
+
+namespace GeoMaps {
+
+/*! \brief Content of an aviation map, with binary cache
+ *
+ * This class holds the features of one aviation map in GeoJSON format,
+ * together with the waypoints and airspaces that these features describe.
+ *
+ * Parsing large GeoJSON files is slow on older devices. The first time that a
+ * map file is read, this class therefore writes a compiled, versioned binary
+ * cache next to the file, at cacheFileName(). The cache holds interned
+ * strings, and for every feature its compact GeoJSON, its geometry as flat
+ * coordinate arrays and its properties.
+ * The compact GeoJSON of all features is held in a single buffer,
+ * geoJSONText(), rather than in one small allocation per feature. The buffer
+ * is allocated once while reading and freed in one piece when the map is
+ * retired.
+ * On subsequent reads, the cache is memory-mapped and the content is restored
+ * without parsing any JSON. The cache is ignored and rewritten if its format
+ * version is unknown, or if the size or modification date of the map file
+ * have changed.
+ */
+
+class CompiledAviationMap
+{
+public:
+    /*! \brief Type of a feature */
+    enum FeatureType : quint8 {
+        OtherFeature = 0,    /*!< Feature is neither waypoint nor airspace */
+        WaypointFeature = 1, /*!< Feature is a valid waypoint */
+        AirspaceFeature = 2  /*!< Feature is a valid airspace */
+    };
+
+    /*! \brief Feature of the aviation map */
+    struct Feature {
+        /*! \brief Offset of the compact GeoJSON of the feature in geoJSONText() */
+        int geoJSONOffset {0};
+
+        /*! \brief Size of the compact GeoJSON of the feature, in bytes */
+        int geoJSONSize {0};
+
+        /*! \brief Type of the feature */
+        FeatureType type {OtherFeature};
+
+        /*! \brief Stable 64-bit hash of the GeoJSON, used to detect features
+         *  that appear in more than one map */
+        quint64 key {0};
+
+        /*! \brief Index into waypoints() or airspaces(), depending on type */
+        int index {-1};
+
+        /*! \brief Feature is an airspace that begins at FL100 or above */
+        bool isUpperAirspace {false};
+
+        /*! \brief Feature is a gliding sector */
+        bool isGlidingSector {false};
+
+        /*! \brief Geometry and properties, as used to generate vector tiles */
+        VectorTileFeature tileFeature;
+    };
+
+    /*! \brief Constructs an empty aviation map */
+    CompiledAviationMap() = default;
+
+    /*! \brief Reads an aviation map
+     *
+     * The constructor reads the binary cache if it is valid. Otherwise, it
+     * parses the GeoJSON file and writes a new cache. The caller is
+     * responsible for locking the file with a
+     * DataManagement::FileRegistry::ReadLocker.
+     *
+     * @param geoJSONFileName Name of a GeoJSON file
+     */
+    explicit CompiledAviationMap(const QString& geoJSONFileName);
+
+    /*! \brief Reads an aviation map, locking the file
+     *
+     * This convenience method locks the file with a
+     * DataManagement::FileRegistry::ReadLocker and then reads the map. Since it has no side
+     * effects apart from writing the binary cache, it can be used to read
+     * several maps in parallel, e.g. with QtConcurrent::mapped.
+     *
+     * @param geoJSONFileName Name of a GeoJSON file
+     *
+     * @returns The aviation map
+     */
+    static CompiledAviationMap read(const QString& geoJSONFileName);
+
+    /*! \brief Airspaces
+     *
+     * @returns List of airspaces described by the features
+     */
+    const QVector<Airspace>& airspaces() const
+    {
+        return m_airspaces;
+    }
+
+    /*! \brief Name of the binary cache
+     *
+     * @param geoJSONFileName Name of a GeoJSON file
+     *
+     * @returns Name of the binary cache that belongs to the file
+     */
+    static QString cacheFileName(const QString& geoJSONFileName)
+    {
+        return geoJSONFileName+".cache";
+    }
+
+    /*! \brief Features
+     *
+     * @returns List of features, in the order of the GeoJSON file
+     */
+    const QVector<Feature>& features() const
+    {
+        return m_features;
+    }
+
+    /*! \brief GeoJSON of all features
+     *
+     * @returns The compact GeoJSON of all features, concatenated without
+     * separators. Use Feature::geoJSONOffset and Feature::geoJSONSize to find
+     * the GeoJSON of a single feature.
+     */
+    const QByteArray& geoJSONText() const
+    {
+        return m_geoJSONText;
+    }
+
+    /*! \brief Check if the map reflects the current file content
+     *
+     * @param geoJSONFileName Name of the GeoJSON file that was read
+     *
+     * @returns True if the file has not been replaced or deleted in this
+     * process since the map was read with read(). This compares generations
+     * in the DataManagement::FileRegistry and does not access the file
+     * system.
+     */
+    bool isCurrent(const QString& geoJSONFileName) const;
+
+    /*! \brief Waypoints
+     *
+     * @returns List of waypoints described by the features
+     */
+    const QVector<Waypoint>& waypoints() const
+    {
+        return m_waypoints;
+    }
+
+private:
+    // Reads the binary cache. Returns false if the cache does not exist or is
+    // invalid; the content of the object is then undefined.
+    bool readCache(const QString& geoJSONFileName, const QFileInfo& sourceInfo);
+
+    // Parses the GeoJSON file
+    void readGeoJSON(const QString& geoJSONFileName);
+
+    // Writes the binary cache
+    void writeCache(const QString& geoJSONFileName, const QFileInfo& sourceInfo) const;
+
+    // Removes all content
+    void clear();
+
+    QVector<Feature> m_features;
+    QByteArray m_geoJSONText;
+    QVector<Waypoint> m_waypoints;
+    QVector<Airspace> m_airspaces;
+
+    // Generation of the GeoJSON file in the FileRegistry, at the time of
+    // reading. Set by read() only.
+    quint64 m_sourceGeneration {0};
+};
+
+};
@@ -0,0 +1,195 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FLATPOLYGON_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FLATPOLYGON_NEON
+#endif
+
+#include "FlatPolygon.h"
+
+
+GeoMaps::FlatPolygon::FlatPolygon(const std::vector<double>& latitudes, const std::vector<double>& longitudes)
+{
+    // Paranoid safety checks
+    auto size = latitudes.size();
+    if ((size != longitudes.size()) || (size < 3)) {
+        return;
+    }
+
+    m_latitude0.reserve(size);
+    m_latitude1.reserve(size);
+    m_longitude0.reserve(size);
+    m_slope.reserve(size);
+    for(std::size_t i=0; i<size; i++) {
+        auto j = (i+1 == size) ? 0 : i+1;
+
+        // Horizontal edges are never crossed by a horizontal ray
+        if (latitudes[i] == latitudes[j]) {
+            m_horizontalLatitude.push_back(latitudes[i]);
+            m_horizontalLongitude0.push_back(std::min(longitudes[i], longitudes[j]));
+            m_horizontalLongitude1.push_back(std::max(longitudes[i], longitudes[j]));
+            continue;
+        }
+        m_latitude0.push_back(latitudes[i]);
+        m_latitude1.push_back(latitudes[j]);
+        m_longitude0.push_back(longitudes[i]);
+        m_slope.push_back((longitudes[j]-longitudes[i])/(latitudes[j]-latitudes[i]));
+    }
+}
+
+
+auto GeoMaps::FlatPolygon::contains(double latitude, double longitude) const -> bool
+{
+    auto size = m_latitude0.size();
+    std::size_t i = 0;
+    std::size_t crossings = 0;
+
+#if defined(FLATPOLYGON_SSE2)
+    auto lat = _mm_set1_pd(latitude);
+    auto lon = _mm_set1_pd(longitude);
+    for(; i+2<=size; i+=2) {
+        auto lat0 = _mm_loadu_pd(&m_latitude0[i]);
+        auto lat1 = _mm_loadu_pd(&m_latitude1[i]);
+        auto straddles = _mm_xor_pd(_mm_cmpgt_pd(lat0, lat), _mm_cmpgt_pd(lat1, lat));
+        auto edgeLongitude = _mm_add_pd(_mm_loadu_pd(&m_longitude0[i]), _mm_mul_pd(_mm_sub_pd(lat, lat0), _mm_loadu_pd(&m_slope[i])));
+        auto mask = _mm_movemask_pd(_mm_and_pd(straddles, _mm_cmplt_pd(lon, edgeLongitude)));
+        crossings += (mask & 1) + ((mask >> 1) & 1);
+    }
+#elif defined(FLATPOLYGON_NEON)
+    auto lat = vdupq_n_f64(latitude);
+    auto lon = vdupq_n_f64(longitude);
+    auto counter = vdupq_n_u64(0);
+    for(; i+2<=size; i+=2) {
+        auto lat0 = vld1q_f64(&m_latitude0[i]);
+        auto lat1 = vld1q_f64(&m_latitude1[i]);
+        auto straddles = veorq_u64(vcgtq_f64(lat0, lat), vcgtq_f64(lat1, lat));
+        auto edgeLongitude = vaddq_f64(vld1q_f64(&m_longitude0[i]), vmulq_f64(vsubq_f64(lat, lat0), vld1q_f64(&m_slope[i])));
+        auto mask = vandq_u64(straddles, vcltq_f64(lon, edgeLongitude));
+        // Lanes of the mask are all ones (= -1) where the ray crosses the edge
+        counter = vsubq_u64(counter, mask);
+    }
+    crossings += vgetq_lane_u64(counter, 0) + vgetq_lane_u64(counter, 1);
+#endif
+
+    for(; i<size; i++) {
+        auto straddles = (m_latitude0[i] > latitude) != (m_latitude1[i] > latitude);
+        if (straddles && (longitude < m_longitude0[i]+(latitude-m_latitude0[i])*m_slope[i])) {
+            crossings++;
+        }
+    }
+    return (crossings & 1) != 0;
+}
+
+
+void GeoMaps::FlatPolygon::contains(const double* latitudes, const double* longitudes, int count, bool* result) const
+{
+    auto size = m_latitude0.size();
+    int p = 0;
+
+#if defined(FLATPOLYGON_SSE2)
+    for(; p+2<=count; p+=2) {
+        auto lat = _mm_loadu_pd(latitudes+p);
+        auto lon = _mm_loadu_pd(longitudes+p);
+        auto inside = _mm_setzero_pd();
+        for(std::size_t i=0; i<size; i++) {
+            auto lat0 = _mm_set1_pd(m_latitude0[i]);
+            auto lat1 = _mm_set1_pd(m_latitude1[i]);
+            auto straddles = _mm_xor_pd(_mm_cmpgt_pd(lat0, lat), _mm_cmpgt_pd(lat1, lat));
+            auto edgeLongitude = _mm_add_pd(_mm_set1_pd(m_longitude0[i]), _mm_mul_pd(_mm_sub_pd(lat, lat0), _mm_set1_pd(m_slope[i])));
+            inside = _mm_xor_pd(inside, _mm_and_pd(straddles, _mm_cmplt_pd(lon, edgeLongitude)));
+        }
+        auto mask = _mm_movemask_pd(inside);
+        result[p] = ((mask & 1) != 0);
+        result[p+1] = ((mask & 2) != 0);
+    }
+#elif defined(FLATPOLYGON_NEON)
+    for(; p+2<=count; p+=2) {
+        auto lat = vld1q_f64(latitudes+p);
+        auto lon = vld1q_f64(longitudes+p);
+        auto inside = vdupq_n_u64(0);
+        for(std::size_t i=0; i<size; i++) {
+            auto lat0 = vdupq_n_f64(m_latitude0[i]);
+            auto lat1 = vdupq_n_f64(m_latitude1[i]);
+            auto straddles = veorq_u64(vcgtq_f64(lat0, lat), vcgtq_f64(lat1, lat));
+            auto edgeLongitude = vaddq_f64(vdupq_n_f64(m_longitude0[i]), vmulq_f64(vsubq_f64(lat, lat0), vdupq_n_f64(m_slope[i])));
+            inside = veorq_u64(inside, vandq_u64(straddles, vcltq_f64(lon, edgeLongitude)));
+        }
+        result[p] = (vgetq_lane_u64(inside, 0) != 0);
+        result[p+1] = (vgetq_lane_u64(inside, 1) != 0);
+    }
+#endif
+
+    for(; p<count; p++) {
+        result[p] = contains(latitudes[p], longitudes[p]);
+    }
+}
+
+
+auto GeoMaps::FlatPolygon::intersections(double latitude0, double longitude0, double latitude1, double longitude1) const -> std::vector<double>
+{
+    std::vector<double> result;
+    auto deltaLatitude = latitude1-latitude0;
+    auto deltaLongitude = longitude1-longitude0;
+
+    // Edges that are not horizontal. The segment meets the line through edge
+    // i where the longitude of the segment equals the longitude of the edge.
+    // The intersection counts if it lies within the latitude range of the
+    // edge, with the same half-open convention as the containment test.
+    auto size = m_latitude0.size();
+    for(std::size_t i=0; i<size; i++) {
+        auto denominator = deltaLongitude - deltaLatitude*m_slope[i];
+        if (denominator == 0.0) {
+            continue;
+        }
+        auto t = (m_longitude0[i] + (latitude0-m_latitude0[i])*m_slope[i] - longitude0)/denominator;
+        if ((t < 0.0) || (t > 1.0)) {
+            continue;
+        }
+        auto latitude = latitude0 + t*deltaLatitude;
+        if ((m_latitude0[i] > latitude) != (m_latitude1[i] > latitude)) {
+            result.push_back(t);
+        }
+    }
+
+    // Horizontal edges
+    if (deltaLatitude != 0.0) {
+        auto horizontalSize = m_horizontalLatitude.size();
+        for(std::size_t i=0; i<horizontalSize; i++) {
+            auto t = (m_horizontalLatitude[i]-latitude0)/deltaLatitude;
+            if ((t < 0.0) || (t > 1.0)) {
+                continue;
+            }
+            auto longitude = longitude0 + t*deltaLongitude;
+            if ((longitude >= m_horizontalLongitude0[i]) && (longitude <= m_horizontalLongitude1[i])) {
+                result.push_back(t);
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
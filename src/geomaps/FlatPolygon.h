@@ -0,0 +1,132 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+
+namespace GeoMaps {
+
+/*! \brief Polygon with flat coordinate arrays and fast containment tests
+ *
+ * This class stores the edges of a polygon in flat arrays of doubles and
+ * implements the ray-crossing test for point containment. Edges are treated
+ * as straight lines in the latitude/longitude plane. On x86 processors with
+ * SSE2 and on 64-bit ARM processors with NEON, the test is vectorized: a
+ * single point is tested against two edges at a time, and batches of points
+ * are tested two at a time against every edge. Other processors use a
+ * portable scalar implementation.
+ *
+ * The class is meant to be shared by all code that needs to test points
+ * against airspaces, such as the airspace lookup under the aircraft or the
+ * analysis of route crossings.
+ *
+ * Once constructed, the polygon is never modified. It is therefore safe to
+ * query the same instance from several threads at the same time.
+ */
+
+class FlatPolygon
+{
+public:
+    /*! \brief Constructs an empty polygon */
+    FlatPolygon() = default;
+
+    /*! \brief Constructs a polygon
+     *
+     * The polygon is closed automatically: the last vertex is connected to the
+     * first one.
+     *
+     * @param latitudes Latitudes of the vertices, in degrees
+     *
+     * @param longitudes Longitudes of the vertices, in degrees. This vector
+     * must have the same size as latitudes.
+     */
+    FlatPolygon(const std::vector<double>& latitudes, const std::vector<double>& longitudes);
+
+    /*! \brief Test if a point lies inside the polygon
+     *
+     * @param latitude Latitude of the point, in degrees
+     *
+     * @param longitude Longitude of the point, in degrees
+     *
+     * @returns True if the point lies inside the polygon
+     */
+    bool contains(double latitude, double longitude) const;
+
+    /*! \brief Test if points lie inside the polygon
+     *
+     * @param latitudes Latitudes of the points, in degrees
+     *
+     * @param longitudes Longitudes of the points, in degrees
+     *
+     * @param count Number of points
+     *
+     * @param result Array of size count. For every point, this method sets
+     * the corresponding entry to true if the point lies inside the polygon,
+     * and to false otherwise.
+     */
+    void contains(const double* latitudes, const double* longitudes, int count, bool* result) const;
+
+    /*! \brief Intersections of a line segment with the boundary
+     *
+     * The segment is treated as a straight line in the latitude/longitude
+     * plane, just like the edges of the polygon. All edges are tested in one
+     * pass over the flat arrays.
+     *
+     * @param latitude0 Latitude of the start point, in degrees
+     *
+     * @param longitude0 Longitude of the start point, in degrees
+     *
+     * @param latitude1 Latitude of the end point, in degrees
+     *
+     * @param longitude1 Longitude of the end point, in degrees
+     *
+     * @returns Parameters t between 0 and 1, in ascending order, where the
+     * point (1-t)*start + t*end lies on the boundary of the polygon
+     */
+    std::vector<double> intersections(double latitude0, double longitude0, double latitude1, double longitude1) const;
+
+    /*! \brief Check if the polygon is empty
+     *
+     * @returns True if the polygon has no edges that could be crossed by a ray
+     */
+    bool isEmpty() const
+    {
+        return m_latitude0.empty();
+    }
+
+private:
+    // Flat arrays, with one entry for each edge that is not horizontal. For
+    // edge i, the longitude of the edge at latitude lat equals
+    // m_longitude0[i] + (lat-m_latitude0[i])*m_slope[i].
+    std::vector<double> m_latitude0;
+    std::vector<double> m_latitude1;
+    std::vector<double> m_longitude0;
+    std::vector<double> m_slope;
+
+    // Horizontal edges, which are never crossed by the ray of the containment
+    // test but are needed to intersect segments with the boundary
+    std::vector<double> m_horizontalLatitude;
+    std::vector<double> m_horizontalLongitude0;
+    std::vector<double> m_horizontalLongitude1;
+};
+
+};
@@ -0,0 +1,297 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QDir>
+#include <QFile>
+#include <QLocale>
+#include <QSet>
+#include <QStandardPaths>
+#include <QtMath>
+#include <algorithm>
+#include <utility>
+
+#include "AviationDataTileHandler.h"
+#include "FlightBriefing.h"
+#include "GeoMapProvider.h"
+#include "GlobalObject.h"
+#include "Metrics.h"
+#include "TileServer.h"
+#include "WebMercator.h"
+#include "dataManagement/FileRegistry.h"
+#include "navigation/FlightRoute.h"
+#include "navigation/Navigator.h"
+
+
+namespace {
+
+// Half the width of the corridor, in degrees of latitude and of longitude
+auto corridorHalfWidthInDegrees(double latitude) -> std::pair<double, double>
+{
+    auto halfWidthInDegrees = GeoMaps::FlightBriefing::corridorHalfWidth.toNM()/60.0;
+    return {halfWidthInDegrees, halfWidthInDegrees/qMax(qCos(qDegreesToRadians(latitude)), 0.01)};
+}
+
+}
+
+
+GeoMaps::FlightBriefing::FlightBriefing(TileServer* tileServer, QObject *parent)
+    : QObject(parent),
+      m_tileServer(tileServer)
+{
+    load();
+}
+
+
+auto GeoMaps::FlightBriefing::corridorTiles(const QVector<QGeoCoordinate>& route, int z) -> QVector<quint64>
+{
+    QSet<quint64> keys;
+    auto halfWidthInM = corridorHalfWidth.toM();
+    for(int i=1; i<route.size(); i++) {
+        const auto& start = route[i-1];
+        const auto& end = route[i];
+        auto distance = start.distanceTo(end);
+        auto azimuth = start.azimuthTo(end);
+
+        // Sample the leg densely enough that the squares around the samples
+        // cover the corridor, and add the tiles that cover the squares
+        auto tileSizeInM = webMercatorTileWidthInM(start.latitude(), z);
+        auto step = qMax(qMin(halfWidthInM, tileSizeInM/2.0), 500.0);
+        for(double d=0.0; d<distance+step; d+=step) {
+            auto sample = start.atDistanceAndAzimuth(qMin(d, distance), azimuth);
+            auto [halfHeight, halfWidth] = corridorHalfWidthInDegrees(sample.latitude());
+            auto [minX, minY] = webMercatorTile(sample.latitude()+halfHeight, sample.longitude()-halfWidth, z);
+            auto [maxX, maxY] = webMercatorTile(sample.latitude()-halfHeight, sample.longitude()+halfWidth, z);
+            for(auto x=minX; x<=maxX; x++) {
+                for(auto y=minY; y<=maxY; y++) {
+                    keys += BriefingBundle::tileKey(static_cast<quint32>(z), x, y);
+                }
+            }
+        }
+    }
+
+    QVector<quint64> result(keys.begin(), keys.end());
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+
+auto GeoMaps::FlightBriefing::description() const -> QString
+{
+    if (m_bundle == nullptr) {
+        return {};
+    }
+    QLocale locale;
+    return tr("Prepared %1, %2 tiles, %3").arg(locale.toString(m_bundle->created().toLocalTime(), QLocale::ShortFormat),
+                                               locale.toString(m_bundle->numTiles()),
+                                               locale.formattedDataSize(m_bundle->size()));
+}
+
+
+void GeoMaps::FlightBriefing::discard()
+{
+    if (m_preparing) {
+        return;
+    }
+
+    m_bundle.reset();
+    if (!m_tileServer.isNull()) {
+        m_tileServer->setBriefingBundle(nullptr);
+    }
+    {
+        DataManagement::FileRegistry::WriteLocker locker(fileName());
+        QFile::remove(fileName());
+    }
+    emit descriptionChanged();
+}
+
+
+auto GeoMaps::FlightBriefing::fileName() -> QString
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)+"/briefing.bundle";
+}
+
+
+void GeoMaps::FlightBriefing::load()
+{
+    std::shared_ptr<const BriefingBundle> bundle;
+    if (QFile::exists(fileName())) {
+        bundle = std::make_shared<const BriefingBundle>(fileName());
+        if (!bundle->isValid()) {
+            bundle.reset();
+        }
+    }
+    m_bundle = bundle;
+    if (!m_tileServer.isNull()) {
+        m_tileServer->setBriefingBundle(m_bundle);
+    }
+    emit descriptionChanged();
+}
+
+
+void GeoMaps::FlightBriefing::prepareFlight()
+{
+    if (m_preparing || m_tileServer.isNull()) {
+        return;
+    }
+
+    QVector<QGeoCoordinate> route;
+    foreach(auto variant, GlobalObject::navigator()->flightRoute()->geoPath()) {
+        route += variant.value<QGeoCoordinate>();
+    }
+    if (route.size() < 2) {
+        emit error(tr("The flight route needs at least two waypoints."));
+        return;
+    }
+
+    // Corridor, as a rectangle
+    auto north = -90.0;
+    auto south = 90.0;
+    auto west = 180.0;
+    auto east = -180.0;
+    foreach(auto coordinate, route) {
+        auto [halfHeight, halfWidth] = corridorHalfWidthInDegrees(coordinate.latitude());
+        north = qMax(north, coordinate.latitude()+halfHeight);
+        south = qMin(south, coordinate.latitude()-halfHeight);
+        west = qMin(west, coordinate.longitude()-halfWidth);
+        east = qMax(east, coordinate.longitude()+halfWidth);
+    }
+    QGeoRectangle corridor(QGeoCoordinate(qMin(north, 90.0), qMax(west, -180.0)), QGeoCoordinate(qMax(south, -90.0), qMin(east, 180.0)));
+
+    // Tiles, by zoom level
+    QVector<QVector<quint64>> tilesByZoom(maxZoom+1);
+    for(int z=minZoom; z<=maxZoom; z++) {
+        tilesByZoom[z] = corridorTiles(route, z);
+    }
+    auto numTiles = [&](int fromZoom, int toZoom) {
+        int result = 0;
+        for(int z=qMax(fromZoom, minZoom); z<=qMin(toZoom, maxZoom); z++) {
+            result += tilesByZoom[z].size();
+        }
+        return result;
+    };
+    if (numTiles(minZoom, maxZoom) > maxTiles) {
+        emit error(tr("The flight route is too long for an offline briefing."));
+        return;
+    }
+
+    // Queue the base-map tiles of all tile sets
+    m_queue.clear();
+    m_tiles.clear();
+    m_pendingRequests = 0;
+    foreach(auto tileSetName, m_tileServer->tileSetNames()) {
+        auto handler = m_tileServer->tileHandler(tileSetName);
+        if (handler.isNull() || (handler->contentKey() == 0)) {
+            continue;
+        }
+        for(int z=qMax(minZoom, handler->minzoom()); z<=qMin(maxZoom, handler->maxzoom()); z++) {
+            foreach(auto key, tilesByZoom[z]) {
+                m_queue.enqueue({handler, handler->contentKey(), key});
+            }
+        }
+    }
+    m_tiles.reserve(m_queue.size()+numTiles(minZoom, AviationDataTileHandler::maxzoom));
+
+    m_aviationTileKeys.clear();
+    for(int z=minZoom; z<=qMin(maxZoom, AviationDataTileHandler::maxzoom); z++) {
+        m_aviationTileKeys += tilesByZoom[z];
+    }
+    m_corridor = corridor;
+
+    m_preparing = true;
+    m_reading = true;
+    emit preparingChanged();
+    processQueue();
+}
+
+
+void GeoMaps::FlightBriefing::processQueue()
+{
+    while ((m_pendingRequests < maxPendingRequests) && !m_queue.isEmpty()) {
+        auto request = m_queue.dequeue();
+        if (request.handler.isNull()) {
+            continue;
+        }
+        auto z = static_cast<quint32>(request.key >> 48);
+        auto x = static_cast<quint32>((request.key >> 24) & 0xFFFFFF);
+        auto y = static_cast<quint32>(request.key & 0xFFFFFF);
+
+        QPointer<FlightBriefing> self(this);
+        auto source = request.source;
+        m_pendingRequests++;
+        request.handler->fetchTile(z, x, y, [self, source, z, x, y](const QByteArray& tileData) {
+            if (self.isNull()) {
+                return;
+            }
+            self->m_pendingRequests--;
+
+            // Tiles served from the current bundle refer to its mapped
+            // memory, which is released before the new bundle is written
+            if (!tileData.isEmpty()) {
+                self->m_tiles.append({source, z, x, y, QByteArray(tileData.constData(), tileData.size())});
+            }
+
+            // Queued, so that tiles served synchronously do not recurse
+            QMetaObject::invokeMethod(self, &FlightBriefing::processQueue, Qt::QueuedConnection);
+        });
+    }
+
+    if (m_reading && m_queue.isEmpty() && (m_pendingRequests == 0)) {
+        m_reading = false;
+        writeBundle(std::exchange(m_tiles, {}), std::exchange(m_aviationTileKeys, {}), m_corridor);
+    }
+}
+
+
+auto GeoMaps::FlightBriefing::writeBundle(QVector<BriefingBundle::Tile> tiles, QVector<quint64> aviationTileKeys, QGeoRectangle corridor) -> Async::Task
+{
+    // Release the current bundle, so that the file can be replaced on all
+    // platforms
+    m_bundle.reset();
+    if (!m_tileServer.isNull()) {
+        m_tileServer->setBriefingBundle(nullptr);
+    }
+
+    auto aviationData = GlobalObject::geoMapProvider()->aviationData();
+    auto success = co_await Async::inThreadPool(this, [tiles, aviationTileKeys, aviationData, corridor]() {
+        METRICS_TIME_SCOPE("briefingBundle/write");
+        auto allTiles = tiles;
+        auto source = aviationData->contentKey();
+        if (source != 0) {
+            foreach(auto key, aviationTileKeys) {
+                auto z = static_cast<quint32>(key >> 48);
+                auto x = static_cast<quint32>((key >> 24) & 0xFFFFFF);
+                auto y = static_cast<quint32>(key & 0xFFFFFF);
+                allTiles.append({source, z, x, y, aviationData->vectorTile(static_cast<int>(z), static_cast<int>(x), static_cast<int>(y))});
+            }
+        }
+        QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+        return BriefingBundle::write(fileName(), allTiles, corridor);
+    });
+
+    // If writing failed, the previous file is still in place
+    load();
+    m_preparing = false;
+    emit preparingChanged();
+    if (success) {
+        emit prepared();
+    } else {
+        emit error(tr("The offline briefing could not be written."));
+    }
+}
@@ -0,0 +1,209 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QGeoCoordinate>
+#include <QGeoRectangle>
+#include <QPointer>
+#include <QQueue>
+#include <memory>
+
+#include "Async.h"
+#include "BriefingBundle.h"
+#include "units/Distance.h"
+
+
+namespace GeoMaps {
+
+class TileHandler;
+class TileServer;
+
+
+/*! \brief Offline briefing bundle for the planned flight
+
+  This class prepares a BriefingBundle for the current flight route and hands
+  it to the TileServer, which then serves tiles from the bundle before
+  looking at the tile cache, the mbtiles databases or the aviation data. In
+  flight, the map is therefore drawn from a single memory-mapped file.
+
+  The bundle holds the tiles of all base maps and of the aviation data that
+  cover a corridor of width 2*corridorHalfWidth along the route, for zoom
+  levels minZoom to maxZoom. Base-map tiles are read through
+  TileHandler::fetchTile, with at most maxPendingRequests requests at any
+  time. The aviation tiles are then cut from the current snapshot of the
+  aviation data and the file is written, both in the thread pool.
+
+  The bundle is stored in QStandardPaths::AppDataLocation and mapped again
+  when the app starts. It stays in use until it is discarded or replaced.
+  Tiles are tagged with the content of the data from which they were taken,
+  so that tiles of outdated maps are never served. Weather reports, terrain
+  and the indices of airspaces and waypoints are not part of the bundle: the
+  WeatherDataProvider already restores decoded reports at startup, and the
+  terrain maps and the aviation data are read without SQLite or GeoJSON.
+*/
+
+class FlightBriefing : public QObject
+{
+  Q_OBJECT
+
+public:
+  /*! \brief Create a new briefing
+
+    If a bundle was prepared earlier, it is mapped and handed to the tile
+    server.
+
+    @param tileServer Tile server that serves the tiles of the bundle
+
+    @param parent The standard QObject parent
+  */
+  explicit FlightBriefing(TileServer* tileServer, QObject *parent = nullptr);
+
+  // Destructor
+  ~FlightBriefing() override = default;
+
+  /*! \brief Half the width of the corridor along the route */
+  static constexpr Units::Distance corridorHalfWidth = Units::Distance::fromNM(10.0);
+
+  /*! \brief Lowest zoom level for which tiles are bundled */
+  static constexpr int minZoom = 4;
+
+  /*! \brief Highest zoom level for which tiles are bundled */
+  static constexpr int maxZoom = 12;
+
+  /*! \brief Maximal number of tiles per tile set */
+  static constexpr int maxTiles = 20000;
+
+  /*! \brief Number of concurrent requests to the tile handlers */
+  static constexpr int maxPendingRequests = 4;
+
+
+  //
+  // Properties
+  //
+
+  /*! \brief Description of the bundle
+
+    This property holds a translated, human-readable description of the
+    current bundle, with time of preparation, number of tiles and size, or an
+    empty string if there is no bundle.
+  */
+  Q_PROPERTY(QString description READ description NOTIFY descriptionChanged)
+
+  /*! \brief Getter function for the property with the same name
+
+    @returns Property description
+  */
+  QString description() const;
+
+  /*! \brief Indicates that a bundle is being prepared */
+  Q_PROPERTY(bool preparing READ preparing NOTIFY preparingChanged)
+
+  /*! \brief Getter function for the property with the same name
+
+    @returns Property preparing
+  */
+  bool preparing() const
+  {
+    return m_preparing;
+  }
+
+
+  //
+  // Methods
+  //
+
+  /*! \brief Delete the bundle
+
+    The tile server stops serving tiles from the bundle, and the file is
+    deleted. Does nothing while a bundle is being prepared.
+  */
+  Q_INVOKABLE void discard();
+
+  /*! \brief Prepare a bundle for the current flight route
+
+    This method returns immediately. Once the bundle is written, it replaces
+    the current bundle and the signal prepared() is emitted. On failure, the
+    signal error() is emitted and the current bundle is kept. Does nothing
+    while a bundle is being prepared.
+  */
+  Q_INVOKABLE void prepareFlight();
+
+signals:
+  /*! \brief Notification signal for the property with the same name */
+  void descriptionChanged();
+
+  /*! \brief Emitted when a bundle could not be prepared
+
+    @param message Translated, human-readable error message
+  */
+  void error(QString message);
+
+  /*! \brief Emitted when a bundle has been prepared */
+  void prepared();
+
+  /*! \brief Notification signal for the property with the same name */
+  void preparingChanged();
+
+private:
+  Q_DISABLE_COPY_MOVE(FlightBriefing)
+
+  // Keys of the tiles of a zoom level that cover the corridor along the
+  // route, as in BriefingBundle::tileKey()
+  static QVector<quint64> corridorTiles(const QVector<QGeoCoordinate>& route, int z);
+
+  // Name of the bundle file
+  static QString fileName();
+
+  // Maps the bundle file and hands the bundle to the tile server
+  void load();
+
+  // Sends requests to the tile handlers, until maxPendingRequests are
+  // pending. Once all requests are answered, writeBundle() is started.
+  void processQueue();
+
+  // Cuts the aviation tiles and writes the bundle, in the thread pool, then
+  // loads the new bundle
+  Async::Task writeBundle(QVector<BriefingBundle::Tile> tiles, QVector<quint64> aviationTileKeys, QGeoRectangle corridor);
+
+  QPointer<TileServer> m_tileServer;
+  std::shared_ptr<const BriefingBundle> m_bundle;
+  bool m_preparing {false};
+
+  // Base-map tiles waiting to be read, and the tiles read so far. While
+  // m_reading is true, processQueue() starts writeBundle() once all tiles
+  // are read.
+  bool m_reading {false};
+  struct Request {
+    QPointer<TileHandler> handler;
+    quint64 source;
+    quint64 key;
+  };
+  QQueue<Request> m_queue;
+  int m_pendingRequests {0};
+  QVector<BriefingBundle::Tile> m_tiles;
+
+  // Aviation tiles to be cut once the base-map tiles are read, and the
+  // corridor of the bundle
+  QVector<quint64> m_aviationTileKeys;
+  QGeoRectangle m_corridor;
+};
+
+};
@@ -0,0 +1,216 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QJsonDocument>
+
+#include "GeoJSONStreamReader.h"
+
+
+GeoMaps::GeoJSONStreamReader::GeoJSONStreamReader(const QByteArray& data)
+    : m_data(data)
+{
+}
+
+
+auto GeoMaps::GeoJSONStreamReader::endOfString(int pos) const -> int
+{
+    // Paranoid safety checks
+    if ((pos >= m_data.size()) || (m_data[pos] != '"')) {
+        return -1;
+    }
+
+    for(pos++; pos<m_data.size(); pos++) {
+        auto character = m_data[pos];
+        if (character == '\\') {
+            pos++;
+            continue;
+        }
+        if (character == '"') {
+            return pos+1;
+        }
+    }
+    return -1;
+}
+
+
+auto GeoMaps::GeoJSONStreamReader::endOfValue(int pos) const -> int
+{
+    if (pos >= m_data.size()) {
+        return -1;
+    }
+
+    // Strings
+    if (m_data[pos] == '"') {
+        return endOfString(pos);
+    }
+
+    // Objects and arrays. Brackets inside strings are ignored.
+    if ((m_data[pos] == '{') || (m_data[pos] == '[')) {
+        int depth = 0;
+        while (pos < m_data.size()) {
+            auto character = m_data[pos];
+            if (character == '"') {
+                pos = endOfString(pos);
+                if (pos < 0) {
+                    return -1;
+                }
+                continue;
+            }
+            if ((character == '{') || (character == '[')) {
+                depth++;
+            }
+            if ((character == '}') || (character == ']')) {
+                depth--;
+                if (depth == 0) {
+                    return pos+1;
+                }
+            }
+            pos++;
+        }
+        return -1;
+    }
+
+    // Numbers, true, false, null
+    while (pos < m_data.size()) {
+        auto character = m_data[pos];
+        if ((character == ',') || (character == '}') || (character == ']') || (QChar::isSpace(static_cast<uchar>(character)))) {
+            break;
+        }
+        pos++;
+    }
+    return pos;
+}
+
+
+void GeoMaps::GeoJSONStreamReader::fail()
+{
+    m_hasError = true;
+    m_atEnd = true;
+}
+
+
+void GeoMaps::GeoJSONStreamReader::findFeatures()
+{
+    m_pos = skipWhiteSpace(m_pos);
+    if ((m_pos >= m_data.size()) || (m_data[m_pos] != '{')) {
+        fail();
+        return;
+    }
+    m_pos++;
+
+    // Walk through the members of the top-level object
+    while (true) {
+        m_pos = skipWhiteSpace(m_pos);
+        if ((m_pos < m_data.size()) && (m_data[m_pos] == '}')) {
+            // Document without features
+            m_atEnd = true;
+            return;
+        }
+
+        auto keyEnd = endOfString(m_pos);
+        if (keyEnd < 0) {
+            fail();
+            return;
+        }
+        auto key = QByteArray::fromRawData(m_data.constData()+m_pos+1, keyEnd-m_pos-2);
+
+        m_pos = skipWhiteSpace(keyEnd);
+        if ((m_pos >= m_data.size()) || (m_data[m_pos] != ':')) {
+            fail();
+            return;
+        }
+        m_pos = skipWhiteSpace(m_pos+1);
+
+        if (key == "features") {
+            if ((m_pos >= m_data.size()) || (m_data[m_pos] != '[')) {
+                fail();
+                return;
+            }
+            m_pos++;
+            m_inFeatures = true;
+            return;
+        }
+
+        m_pos = endOfValue(m_pos);
+        if (m_pos < 0) {
+            fail();
+            return;
+        }
+        m_pos = skipWhiteSpace(m_pos);
+        if ((m_pos < m_data.size()) && (m_data[m_pos] == ',')) {
+            m_pos++;
+        }
+    }
+}
+
+
+auto GeoMaps::GeoJSONStreamReader::readNext(QJsonObject& feature) -> bool
+{
+    if (m_atEnd) {
+        return false;
+    }
+    if (!m_inFeatures) {
+        findFeatures();
+        if (m_atEnd) {
+            return false;
+        }
+    }
+
+    m_pos = skipWhiteSpace(m_pos);
+    if (m_pos >= m_data.size()) {
+        fail();
+        return false;
+    }
+    if (m_data[m_pos] == ']') {
+        m_atEnd = true;
+        return false;
+    }
+
+    auto end = endOfValue(m_pos);
+    if (end < 0) {
+        fail();
+        return false;
+    }
+
+    // Parse the feature, and nothing else
+    QJsonParseError error {};
+    auto document = QJsonDocument::fromJson(QByteArray::fromRawData(m_data.constData()+m_pos, end-m_pos), &error);
+    if ((error.error != QJsonParseError::NoError) || !document.isObject()) {
+        fail();
+        return false;
+    }
+    feature = document.object();
+
+    // Advance to the next feature
+    m_pos = skipWhiteSpace(end);
+    if ((m_pos < m_data.size()) && (m_data[m_pos] == ',')) {
+        m_pos++;
+    }
+    return true;
+}
+
+
+auto GeoMaps::GeoJSONStreamReader::skipWhiteSpace(int pos) const -> int
+{
+    while ((pos < m_data.size()) && QChar::isSpace(static_cast<uchar>(m_data[pos]))) {
+        pos++;
+    }
+    return pos;
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QJsonObject>
+
+
+namespace GeoMaps {
+
+/*! \brief Streaming reader for GeoJSON feature collections
+ *
+ * This class reads the features of a GeoJSON feature collection one at a
+ * time. It scans the raw text for the elements of the top-level "features"
+ * array and parses only one feature at a time, so that the DOM of the full
+ * document is never held in memory. Other top-level members of the document
+ * are skipped.
+ *
+ * The reader does not own the data. Typically, the data is a memory-mapped
+ * file, wrapped with QByteArray::fromRawData. The data must remain valid as
+ * long as the reader is in use.
+ *
+ * Typical use:
+ * @code
+ * GeoJSONStreamReader reader(data);
+ * QJsonObject feature;
+ * while (reader.readNext(feature)) {
+ *     ...
+ * }
+ * if (reader.hasError()) {
+ *     ...
+ * }
+ * @endcode
+ */
+
+class GeoJSONStreamReader
+{
+public:
+    /*! \brief Constructs a reader
+     *
+     * @param data GeoJSON document
+     */
+    explicit GeoJSONStreamReader(const QByteArray& data);
+
+    /*! \brief Check for errors
+     *
+     * @returns True if the document is not a well-formed GeoJSON feature
+     * collection. Features that were read before the error are valid.
+     */
+    bool hasError() const
+    {
+        return m_hasError;
+    }
+
+    /*! \brief Read next feature
+     *
+     * @param feature If a feature was read, it is stored here
+     *
+     * @returns False if there are no more features, or if an error occurred
+     */
+    bool readNext(QJsonObject& feature);
+
+private:
+    // Finds the beginning of the "features" array and positions m_pos at its
+    // first element
+    void findFeatures();
+
+    // Returns the position just after the value that starts at pos, or -1 on
+    // error
+    int endOfValue(int pos) const;
+
+    // Returns the position just after the string that starts at pos, or -1 on
+    // error
+    int endOfString(int pos) const;
+
+    // Returns the first position at or after pos that is not white space
+    int skipWhiteSpace(int pos) const;
+
+    // Marks the reader as failed
+    void fail();
+
+    QByteArray m_data;
+    int m_pos {0};
+    bool m_inFeatures {false};
+    bool m_atEnd {false};
+    bool m_hasError {false};
+};
+
+};
@@ -19,38 +19,66 @@
  ***************************************************************************/
 
 #include <QApplication>
+#include <QFile>
 #include <QGeoCoordinate>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QLockFile>
+#include <QHash>
 #include <QQmlEngine>
 #include <QRandomGenerator>
 #include <QSqlDatabase>
 #include <QSqlQuery>
+#include <QtConcurrent/QtConcurrentMap>
 #include <QtConcurrent/QtConcurrentRun>
+#include <QtMath>
+#include <algorithm>
 #include <chrono>
+#include <string_view>
 
+#include "CompiledAviationMap.h"
 #include "GeoMapProvider.h"
 #include "GlobalObject.h"
+#include "InitScheduler.h"
+#include "Metrics.h"
+#include "MobileAdaptor.h"
+#include "Profiler.h"
+#include "Settings.h"
+#include "Tracer.h"
 #include "navigation/Clock.h"
 #include "navigation/Navigator.h"
+#include "positioning/PositionProvider.h"
+#include "ui/RenderBudget.h"
 
-using namespace std::chrono_literals;
+
+namespace {
+
+// Minimal time between two changes of the simplification of the aviation data
+// in the style file. Every change reloads the whole style.
+constexpr auto styleSimplificationHoldTime = std::chrono::seconds(30);
+
+// Airspaces are always part of the aviation data; the settings hideGlidingSectors
+// and hideUpperAirspaces are applied when the data is queried, and by layer
+// filters in the map style. This function is called from worker threads.
+auto settingsFilter(Units::Distance bottom, Units::Distance top) -> GeoMaps::AirspaceFilter
+{
+    GeoMaps::AirspaceFilter filter;
+    if (bottom.isFinite()) {
+        filter.bottomInFtMSL = bottom.toFeet();
+    }
+    if (top.isFinite()) {
+        filter.topInFtMSL = top.toFeet();
+    }
+    filter.includeUpper = !Settings::hideUpperAirspacesStatic();
+    filter.includeGlidingSectors = !Settings::hideGlidingSectorsStatic();
+    return filter;
+}
+
+} // namespace
 
 
 GeoMaps::GeoMapProvider::GeoMapProvider(QObject *parent)
     : QObject(parent),
       _tileServer(QUrl()),
-      _styleFile(nullptr)
+      _aviationData(std::make_shared<const AviationData>())
 {
-    // Initialize _combinedGeoJSON_ with an empty document
-    QJsonObject resultObject;
-    resultObject.insert(QStringLiteral("type"), "FeatureCollection");
-    resultObject.insert(QStringLiteral("features"), QJsonArray());
-    QJsonDocument geoDoc(resultObject);
-    _combinedGeoJSON_ = geoDoc.toJson(QJsonDocument::JsonFormat::Compact);
-
     _tileServer.listen(QHostAddress(QStringLiteral("127.0.0.1")));
 
     // Deferred initializsation
@@ -58,59 +86,71 @@ GeoMaps::GeoMapProvider::GeoMapProvider(QObject *parent)
 }
 
 
-auto GeoMaps::GeoMapProvider::airspaces(const QGeoCoordinate& position) -> QVariantList
+GeoMaps::GeoMapProvider::~GeoMapProvider()
 {
-    // Lock data
-    QMutexLocker lock(&_aviationDataMutex);
-
-    QVector<Airspace> result;
-    result.reserve(10);
-    foreach(auto airspace, _airspaces_) {
-        if (airspace.polygon().contains(position)) {
-            result.append(airspace);
-        }
+    _airspaceMonitorThread.quit();
+    _airspaceMonitorThread.wait();
+}
+
+
+auto GeoMaps::GeoMapProvider::airspaceAlerts() const -> QVariantList
+{
+    QVariantList result;
+    result.reserve(_airspaceAlerts.size());
+    for(const auto& alert : _airspaceAlerts) {
+        result.append(QVariant::fromValue(alert));
     }
+    return result;
+}
 
-    // Sort airspaces according to lower boundary
-    std::sort(result.begin(), result.end(), [](const Airspace& a, const Airspace& b) {return (a.estimatedLowerBoundInFtMSL() > b.estimatedLowerBoundInFtMSL()); });
 
+auto GeoMaps::GeoMapProvider::airspaces(const QGeoCoordinate& position, Units::Distance bottom, Units::Distance top) const -> QVariantList
+{
+    METRICS_TIME_SCOPE("geoMapProvider/airspaces");
+    PROFILER_SCOPE(Profiler::AviationQueries);
     QVariantList final;
-    foreach(auto airspace, result)
+    foreach(auto airspace, aviationData()->airspacesAt(position, settingsFilter(bottom, top))) {
         final.append( QVariant::fromValue(airspace) );
+    }
 
     return final;
 }
 
 
+auto GeoMaps::GeoMapProvider::airspacesInCorridor(const QGeoPath& path, Units::Distance corridorWidth, Units::Distance bottom, Units::Distance top) const -> QVector<Airspace>
+{
+    METRICS_TIME_SCOPE("geoMapProvider/airspacesInCorridor");
+    PROFILER_SCOPE(Profiler::AviationQueries);
+    return aviationData()->airspacesInCorridor(path, corridorWidth, settingsFilter(bottom, top));
+}
+
+
+auto GeoMaps::GeoMapProvider::airspacesInRectangle(const QGeoRectangle& rectangle) -> QVector<Airspace>
+{
+    METRICS_TIME_SCOPE("geoMapProvider/airspacesInRectangle");
+    PROFILER_SCOPE(Profiler::AviationQueries);
+    return aviationData()->airspacesInRectangle(rectangle, settingsFilter({}, {}));
+}
+
+
 auto GeoMaps::GeoMapProvider::closestWaypoint(QGeoCoordinate position, const QGeoCoordinate& distPosition) -> Waypoint
 {
+    METRICS_TIME_SCOPE("geoMapProvider/closestWaypoint");
+    PROFILER_SCOPE(Profiler::AviationQueries);
     position.setAltitude(qQNaN());
 
-    Waypoint result;
-    const auto wpts = waypoints();
-    for(const auto& wp : wpts) {
-        if (!wp.isValid()) {
-            continue;
-        }
-        if (!result.isValid()) {
-            result = wp;
-        }
-        if (position.distanceTo(wp.coordinate()) < position.distanceTo(result.coordinate())) {
-            result = wp;
-        }
-    }
-
+    auto result = aviationData()->closestWaypoint(position);
     for(auto& variant : GlobalObject::navigator()->flightRoute()->midFieldWaypoints() ) {
         auto wp = variant.value<GeoMaps::Waypoint>();
         if (!wp.isValid()) {
             continue;
         }
-        if (position.distanceTo(wp.coordinate()) < position.distanceTo(result.coordinate())) {
+        if (!result.isValid() || (position.distanceTo(wp.coordinate()) < position.distanceTo(result.coordinate()))) {
             result = wp;
         }
     }
 
-    if (position.distanceTo(result.coordinate()) > position.distanceTo(distPosition)) {
+    if (!result.isValid() || (position.distanceTo(result.coordinate()) > position.distanceTo(distPosition))) {
         return Waypoint(position);
     }
 
@@ -118,111 +158,78 @@ auto GeoMaps::GeoMapProvider::closestWaypoint(QGeoCoordinate position, const QGe
 }
 
 
-auto GeoMaps::GeoMapProvider::filteredWaypointObjects(const QString &filter) -> QVariantList
+auto GeoMaps::GeoMapProvider::filteredWaypointModel(const QString &filter) -> GeoMaps::WaypointListModel*
 {
-    auto wps = waypoints();
-
-    QStringList filterWords;
-    foreach(auto word, filter.simplified().split(' ', Qt::SkipEmptyParts)) {
-        QString simplifiedWord = GlobalObject::librarian()->simplifySpecialChars(word);
-        if (simplifiedWord.isEmpty()) {
-            continue;
-        }
-        filterWords.append(simplifiedWord);
-    }
-
-    QVariantList result;
-    foreach(auto wp, wps) {
-        if (!wp.isValid()) {
-            continue;
-        }
-        bool allWordsFound = true;
-        foreach(auto word, filterWords) {
-            QString fullName = GlobalObject::librarian()->simplifySpecialChars(wp.name());
-            QString codeName = GlobalObject::librarian()->simplifySpecialChars(wp.ICAOCode());
-            QString wordx = GlobalObject::librarian()->simplifySpecialChars(word);
-
-            if (!fullName.contains(wordx, Qt::CaseInsensitive) && !codeName.contains(wordx, Qt::CaseInsensitive)) {
-                allWordsFound = false;
-                break;
-            }
-        }
-        if (allWordsFound) {
-            result.append( QVariant::fromValue(wp) );
-        }
-    }
-
-    return result;
+    METRICS_TIME_SCOPE("geoMapProvider/filteredWaypointModel");
+    PROFILER_SCOPE(Profiler::AviationQueries);
+    return new WaypointListModel(aviationData()->filteredWaypoints(filter));
 }
 
 
 auto GeoMaps::GeoMapProvider::findByID(const QString &id) -> Waypoint
 {
-    auto wps = waypoints();
-
-    foreach(auto wp, wps) {
-        if (!wp.isValid()) {
-            continue;
-        }
-        if (wp.ICAOCode() == id) {
-            return wp;
-        }
-    }
-    return {};
+    METRICS_TIME_SCOPE("geoMapProvider/findByID");
+    PROFILER_SCOPE(Profiler::AviationQueries);
+    return aviationData()->findByID(id);
 }
 
 
-auto GeoMaps::GeoMapProvider::nearbyWaypoints(const QGeoCoordinate& position, const QString& type) -> QVariantList
+auto GeoMaps::GeoMapProvider::findByIDs(const QStringList& ids) -> QHash<QString, Waypoint>
 {
-    auto wps = waypoints();
+    METRICS_TIME_SCOPE("geoMapProvider/findByIDs");
+    PROFILER_SCOPE(Profiler::AviationQueries);
+    auto data = aviationData();
 
-    QVector<Waypoint> tWps;
-    foreach(auto wp, wps) {
-        if (!wp.isValid()) {
-            continue;
-        }
-        if (wp.type() != type) {
-            continue;
+    QHash<QString, Waypoint> result;
+    foreach(auto id, ids) {
+        auto wp = data->findByID(id);
+        if (wp.isValid()) {
+            result.insert(id, wp);
         }
-        tWps.append(wp);
     }
+    return result;
+}
 
-    std::sort(tWps.begin(), tWps.end(), [position](const Waypoint &a, const Waypoint &b) {return position.distanceTo(a.coordinate()) < position.distanceTo(b.coordinate()); });
 
-    QVariantList result;
-    int sz = 0;
-    foreach(auto ad, tWps) {
-        result.append( QVariant::fromValue(ad) );
-        sz++;
-        if (sz == 20) {
-            break;
-        }
-    }
+auto GeoMaps::GeoMapProvider::nearbyWaypointModel(const QGeoCoordinate& position, const QString& type) -> GeoMaps::WaypointListModel*
+{
+    METRICS_TIME_SCOPE("geoMapProvider/nearbyWaypointModel");
+    PROFILER_SCOPE(Profiler::AviationQueries);
+    return new WaypointListModel(aviationData()->nearbyWaypoints(position, type, 20));
+}
 
-    return result;
+
+auto GeoMaps::GeoMapProvider::waypointsWithinRadius(const QGeoCoordinate& position, Units::Distance radius, const QString& type) -> QVector<Waypoint>
+{
+    METRICS_TIME_SCOPE("geoMapProvider/waypointsWithinRadius");
+    PROFILER_SCOPE(Profiler::AviationQueries);
+    return aviationData()->waypointsWithinRadius(position, radius, type);
 }
 
 
 auto GeoMaps::GeoMapProvider::styleFileURL() const -> QString
 {
-    if (_styleFile.isNull()) {
+    if (_styleTemplate.isEmpty()) {
         return QStringLiteral(":/flightMap/empty.json");
     }
-    return "file://"+_styleFile->fileName();
+    return _tileServer.styleUrl();
 }
 
 
-void GeoMaps::GeoMapProvider::aviationMapsChanged()
+auto GeoMaps::GeoMapProvider::geoJSON() const -> QByteArray
 {
-    // Paranoid safety checks
-    if (_aviationDataCacheFuture.isRunning()) {
-        _aviationDataCacheTimer.start();
-        return;
+    auto data = aviationData();
+    if (data->isGeoJSONReleased()) {
+        // The document was released by releaseMemory(). Build a new snapshot,
+        // which comes with a new GeoJSON document.
+        QMetaObject::invokeMethod(const_cast<GeoMapProvider*>(this), &GeoMaps::GeoMapProvider::aviationMapsChanged, Qt::QueuedConnection);
     }
+    return data->geoJSON();
+}
 
-    //
-    // Generate new GeoJSON array and new list of waypoints
-    //
+
+void GeoMaps::GeoMapProvider::aviationMapsChanged()
+{
     QStringList JSONFileNames;
     foreach(auto geoMapPtr, GlobalObject::dataManager()->aviationMaps()->downloadables()) {
         // Ignore everything but geojson files
@@ -235,132 +242,276 @@ void GeoMaps::GeoMapProvider::aviationMapsChanged()
         JSONFileNames += geoMapPtr->fileName();
     }
 
-    _aviationDataCacheFuture = QtConcurrent::run(this, &GeoMaps::GeoMapProvider::fillAviationDataCache, JSONFileNames, GlobalObject::settings()->hideUpperAirspaces(), GlobalObject::settings()->hideGlidingSectors());
+    // The result of a running pipeline is outdated
+    _aviationDataRebuildToken.cancel();
+    _aviationDataRebuildToken = Async::CancellationToken();
+    _aviationDataRebuildFuture = rebuildAviationData(JSONFileNames, _aviationDataRebuildToken).future();
+}
+
+
+auto GeoMaps::GeoMapProvider::rebuildAviationData(QStringList JSONFileNames, Async::CancellationToken token) -> Async::Task
+{
+    // Compile the maps that are new or that have changed since the last run
+    auto changedFileNames = changedAviationMaps(JSONFileNames);
+    auto changedMaps = co_await Async::inThreadPool(this, [changedFileNames]() { return compileAviationMaps(changedFileNames); });
+    if (token.isCancelled()) {
+        co_return;
+    }
+    auto maps = updateCompiledAviationMaps(JSONFileNames, changedFileNames, changedMaps);
+
+    // Merge the maps and build the indices
+    auto newAviationData = co_await Async::inThreadPool(this, [maps]() { return mergeAviationMaps(maps); });
+    if (token.isCancelled()) {
+        co_return;
+    }
+
+    // Publish the new snapshot
+    std::atomic_store(&_aviationData, newAviationData);
+    emit geoJSONChanged();
 }
 
 
 void GeoMaps::GeoMapProvider::baseMapsChanged()
 {
 
-    // Delete old style file, stop serving tiles
-    delete _styleFile;
+    // Stop serving tiles
     _tileServer.removeMbtilesFileSet(_currentPath);
 
     // Serve new tile set under new name
     _currentPath = QString::number(QRandomGenerator::global()->bounded(static_cast<quint32>(1000000000)));
     _tileServer.addMbtilesFileSet(GlobalObject::dataManager()->baseMaps()->downloadablesWithFile(), _currentPath);
+    _tilePrefetcher.setTileSet(_currentPath);
+
+    updateStyleFile();
+}
+
 
-    // Generate new mapbox style file
-    _styleFile = new QTemporaryFile(this);
-    QFile file(QStringLiteral(":/flightMap/osm-liberty.json"));
-    file.open(QIODevice::ReadOnly);
-    QByteArray data = file.readAll();
+void GeoMaps::GeoMapProvider::updateStyleFile()
+{
+    // The URL of the aviation data contains the generation number of the
+    // snapshot, so that the map discards tiles of older snapshots, and the
+    // simplification requested by the render budget, see
+    // updateStyleSimplification()
+    auto aviationURL = _tileServer.serverUrl()+"/aviationData/"+QString::number(aviationData()->generation())
+            +"-"+QString::number(_styleSimplificationReduction)+".json";
+
+    // Generate new mapbox style, in memory. The template is read only once.
+    if (_styleTemplate.isEmpty()) {
+        QFile file(QStringLiteral(":/flightMap/osm-liberty.json"));
+        file.open(QIODevice::ReadOnly);
+        _styleTemplate = file.readAll();
+    }
+    QByteArray data = _styleTemplate;
     data.replace("%URL%", (_tileServer.serverUrl()+"/"+_currentPath).toLatin1());
     data.replace("%URL2%", _tileServer.serverUrl().toLatin1());
-    _styleFile->open();
-    _styleFile->write(data);
-    _styleFile->close();
+    data.replace("%AVIATIONURL%", aviationURL.toLatin1());
 
-    emit styleFileURLChanged();
+    // The tile server answers with the new style under a new URL
+    if (_tileServer.setStyle(data)) {
+        emit styleFileURLChanged();
+    }
+}
 
+
+void GeoMaps::GeoMapProvider::updateStyleSimplification()
+{
+    // Each simplification level is held for styleSimplificationHoldTime.
+    // Changes in the meantime are applied when the timer runs out.
+    auto reduction = GlobalObject::renderBudget()->simplificationReduction();
+    if ((reduction == _styleSimplificationReduction) || _styleSimplificationTimer.isActive()) {
+        return;
+    }
+    _styleSimplificationReduction = reduction;
+    _styleSimplificationTimer.start();
+    updateStyleFile();
 }
 
 
-void GeoMaps::GeoMapProvider::fillAviationDataCache(const QStringList& JSONFileNames, bool hideUpperAirspaces, bool hideGlidingSectors)
+void GeoMaps::GeoMapProvider::fillAviationDataCache(const QStringList& JSONFileNames)
 {
-    //
-    // Generate new GeoJSON array and new list of waypoints
-    //
+    auto changedFileNames = changedAviationMaps(JSONFileNames);
+    auto maps = updateCompiledAviationMaps(JSONFileNames, changedFileNames, compileAviationMaps(changedFileNames));
+    std::atomic_store(&_aviationData, mergeAviationMaps(maps));
+    emit geoJSONChanged();
+}
+
 
-    // First, create a set of JSON objects, in order to avoid duplicated entries
-    QSet<QJsonObject> objectSet;
+auto GeoMaps::GeoMapProvider::changedAviationMaps(const QStringList& JSONFileNames) const -> QStringList
+{
+    QStringList changedFileNames;
     foreach(auto JSONFileName, JSONFileNames) {
-        // Read the lock file
-        QLockFile lockFile(JSONFileName+".lock");
-        lockFile.lock();
-        QFile file(JSONFileName);
-        file.open(QIODevice::ReadOnly);
-        auto document = QJsonDocument::fromJson(file.readAll());
-        file.close();
-        lockFile.unlock();
-
-        foreach(auto value, document.object()["features"].toArray()) {
-            auto object = value.toObject();
-
-            // If 'hideUpperAirspaces' is set, ignore all objects that are airspaces
-            // and that begin at FL100 or above.
-            if (hideUpperAirspaces) {
-                Airspace airspaceTest(object);
-                if (airspaceTest.isUpper()) {
-                    continue;
-                }
-            }
+        auto it = _compiledAviationMaps.constFind(JSONFileName);
+        if ((it == _compiledAviationMaps.constEnd()) || !it->isCurrent(JSONFileName)) {
+            changedFileNames += JSONFileName;
+        }
+    }
+    return changedFileNames;
+}
 
-            // If 'hideGlidingSector' is set, ignore all objects that are airspaces
-            // and that are gliding sectors
-            if (hideGlidingSectors) {
-                Airspace airspaceTest(object);
-                if (airspaceTest.CAT() == "GLD") {
-                    continue;
-                }
-            }
 
-            objectSet += object;
+auto GeoMaps::GeoMapProvider::updateCompiledAviationMaps(const QStringList& JSONFileNames, const QStringList& changedFileNames, const QVector<CompiledAviationMap>& changedMaps) -> QVector<CompiledAviationMap>
+{
+    for(int i=0; i<changedFileNames.size(); i++) {
+        _compiledAviationMaps.insert(changedFileNames[i], changedMaps[i]);
+    }
+    foreach(auto JSONFileName, _compiledAviationMaps.keys()) {
+        if (!JSONFileNames.contains(JSONFileName)) {
+            _compiledAviationMaps.remove(JSONFileName);
         }
     }
 
+    QVector<CompiledAviationMap> maps;
+    maps.reserve(JSONFileNames.size());
+    foreach(auto JSONFileName, JSONFileNames) {
+        maps.append(_compiledAviationMaps.value(JSONFileName));
+    }
+    return maps;
+}
+
 
-    // Then, create a new JSONArray of features and a new list of waypoints
-    QJsonArray newFeatures;
+auto GeoMaps::GeoMapProvider::compileAviationMaps(const QStringList& JSONFileNames) -> QVector<CompiledAviationMap>
+{
+    METRICS_TIME_SCOPE("geoMapProvider/aviationMapsCompile");
+    return QtConcurrent::blockingMapped<QVector<CompiledAviationMap>>(JSONFileNames, &CompiledAviationMap::read);
+}
+
+
+auto GeoMaps::GeoMapProvider::mergeAviationMaps(const QVector<CompiledAviationMap>& maps) -> std::shared_ptr<const AviationData>
+{
+    METRICS_TIME_SCOPE("geoMapProvider/aviationDataRebuild");
+
+    // Merge the features of all maps. Features that appear in more than one
+    // map are included only once. The content key is the sum of the keys of
+    // all features, which does not depend on the order of the maps.
+
+    // All containers are reserved for the worst case before merging,
+    // so that each is allocated exactly once.
+    int numFeatures = 0;
+    int numWaypoints = 0;
+    int numAirspaces = 0;
+    int geoJSONSize = 0;
+    for(const auto& map : maps) {
+        numFeatures += map.features().size();
+        numWaypoints += map.waypoints().size();
+        numAirspaces += map.airspaces().size();
+        geoJSONSize += map.geoJSONText().size()+map.features().size();
+    }
+
+    // Features are looked up by their key. Because different features may
+    // have the same key, the compact GeoJSON texts are compared before a
+    // feature is dropped as a duplicate. The texts point into the maps, which
+    // outlive this method.
+    QMultiHash<quint64, std::string_view> featureTexts;
+    featureTexts.reserve(numFeatures);
+    quint64 contentKey = 0;
+    QByteArray geoJSON = R"({"type":"FeatureCollection","features":[)";
+    geoJSON.reserve(geoJSON.size()+geoJSONSize+2);
     QVector<Airspace> newAirspaces;
+    newAirspaces.reserve(numAirspaces);
     QVector<Waypoint> newWaypoints;
-    foreach(auto object, objectSet) {
-        newFeatures += object;
-
-        // Check if the current object is a waypoint. If so, add it to the list of waypoints.
-        Waypoint wp(object);
-        if (wp.isValid()) {
-            newWaypoints.append(wp);
-            continue;
-        }
+    newWaypoints.reserve(numWaypoints);
+    QVector<VectorTileFeature> newTileFeatures;
+    newTileFeatures.reserve(numFeatures);
+    for(const auto& map : maps) {
+        for(const auto& feature : map.features()) {
+            std::string_view text(map.geoJSONText().constData()+feature.geoJSONOffset, feature.geoJSONSize);
+            auto isDuplicate = false;
+            for(auto it = featureTexts.constFind(feature.key); (it != featureTexts.constEnd()) && (it.key() == feature.key); ++it) {
+                if (it.value() == text) {
+                    isDuplicate = true;
+                    break;
+                }
+            }
+            if (isDuplicate) {
+                continue;
+            }
+            if (!featureTexts.isEmpty()) {
+                geoJSON += ',';
+            }
+            featureTexts.insert(feature.key, text);
+            contentKey += feature.key;
+            geoJSON.append(text.data(), static_cast<int>(text.size()));
+            if (feature.tileFeature.geometryType != VectorTileFeature::Unknown) {
+                newTileFeatures.append(feature.tileFeature);
+            }
 
-        // Check if the current object is an airspace. If so, add it to the list of airspaces.
-        Airspace as(object);
-        if (as.isValid()) {
-            newAirspaces.append(as);
-            continue;
+            if (feature.type == CompiledAviationMap::WaypointFeature) {
+                newWaypoints.append(map.waypoints()[feature.index]);
+            }
+            if (feature.type == CompiledAviationMap::AirspaceFeature) {
+                newAirspaces.append(map.airspaces()[feature.index]);
+            }
         }
     }
-    QJsonObject resultObject;
-    resultObject.insert(QStringLiteral("type"), "FeatureCollection");
-    resultObject.insert(QStringLiteral("features"), newFeatures);
-    QJsonDocument geoDoc(resultObject);
 
-    // Sort waypoints by name
-    std::sort(newWaypoints.begin(), newWaypoints.end(), [](const Waypoint &a, const Waypoint &b) {return a.name() < b.name(); });
+    geoJSON += "]}";
+
+    // Build new snapshot, including all indices
+    return std::make_shared<const AviationData>(newWaypoints, newAirspaces, geoJSON, newTileFeatures, contentKey);
+}
 
-    _aviationDataMutex.lock();
-    _airspaces_ = newAirspaces;
-    _waypoints_ = newWaypoints;
-    _combinedGeoJSON_ = geoDoc.toJson(QJsonDocument::JsonFormat::Compact);
-    _aviationDataMutex.unlock();
 
-    emit geoJSONChanged();
+void GeoMaps::GeoMapProvider::releaseMemory()
+{
+    static auto* tileCacheMetric = Metrics::counter(QStringLiteral("memory/tileCache/bytesReleased"));
+    static auto* geoJSONMetric = Metrics::counter(QStringLiteral("memory/geoJSON/bytesReleased"));
+
+    tileCacheMetric->add(_tileServer.clearTileCache());
+    geoJSONMetric->add(aviationData()->releaseGeoJSON());
 }
 
 
 void GeoMaps::GeoMapProvider::deferredInitialization()
 {
+    TRACE_SCOPE("GeoMapProvider::deferredInitialization");
     // Connect the WeatherProvider, so aviation maps will be generated
     connect(GlobalObject::dataManager()->aviationMaps(), &DataManagement::DownloadableGroup::localFileContentChanged_delayed, this, &GeoMaps::GeoMapProvider::aviationMapsChanged);
     connect(GlobalObject::dataManager()->baseMaps(), &DataManagement::DownloadableGroup::localFileContentChanged_delayed, this, &GeoMaps::GeoMapProvider::baseMapsChanged);
-    connect(GlobalObject::settings(), &Settings::hideUpperAirspacesChanged, this, &GeoMaps::GeoMapProvider::aviationMapsChanged);
-    connect(GlobalObject::settings(), &Settings::hideGlidingSectorsChanged, this, &GeoMaps::GeoMapProvider::aviationMapsChanged);
-
-    _aviationDataCacheTimer.setSingleShot(true);
-    _aviationDataCacheTimer.setInterval(3s);
-    connect(&_aviationDataCacheTimer, &QTimer::timeout, this, &GeoMaps::GeoMapProvider::aviationMapsChanged);
-
-    aviationMapsChanged();
+    connect(GlobalObject::mobileAdaptor(), &MobileAdaptor::memoryLow, this, &GeoMaps::GeoMapProvider::releaseMemory);
+
+    // Size of the tile cache
+    auto updateTileCacheSize = [this]() {
+        _tileServer.setTileCacheSize(qint64(GlobalObject::settings()->tileCacheSize())*1024*1024);
+    };
+    connect(GlobalObject::settings(), &Settings::tileCacheSizeChanged, this, updateTileCacheSize);
+    updateTileCacheSize();
+
+    // Prefetch tiles along the route and ahead of the aircraft
+    _tilePrefetcher.setFlightRoute(GlobalObject::navigator()->flightRoute());
+    connect(GlobalObject::positionProvider(), &Positioning::PositionProvider::positionInfoChanged, &_tilePrefetcher, &TilePrefetcher::onPositionUpdated);
+
+    // Airspace monitor
+    _airspaceMonitorThread.setObjectName("Airspace monitor");
+    Profiler::watchThread(&_airspaceMonitorThread);
+    _airspaceMonitorThread.start();
+    _airspaceMonitor = new AirspaceMonitor(this);
+    _airspaceMonitor->moveToThread(&_airspaceMonitorThread);
+    connect(&_airspaceMonitorThread, &QThread::finished, _airspaceMonitor, &QObject::deleteLater);
+    connect(GlobalObject::positionProvider(), &Positioning::PositionProvider::positionInfoChanged, _airspaceMonitor, &AirspaceMonitor::setPositionInfo);
+    connect(_airspaceMonitor, &AirspaceMonitor::alertsChanged, this, [this](const QVector<GeoMaps::AirspaceAlert>& alerts) {
+        _airspaceAlerts = alerts;
+        emit airspaceAlertsChanged();
+    });
+
+    // Terrain
+    connect(GlobalObject::dataManager()->terrainMaps(), &DataManagement::DownloadableGroupWatcher::downloadablesWithFileChanged, &_terrain, &GeoMaps::Terrain::setDownloadables);
+    connect(GlobalObject::positionProvider(), &Positioning::PositionProvider::positionInfoChanged, &_terrain, &GeoMaps::Terrain::setPositionInfo);
+    _terrain.setDownloadables(GlobalObject::dataManager()->terrainMaps()->downloadablesWithFile());
+
+    // Coarser airspace geometry while frames are slow
+    _styleSimplificationTimer.setSingleShot(true);
+    _styleSimplificationTimer.setInterval(styleSimplificationHoldTime);
+    connect(GlobalObject::renderBudget(), &Ui::RenderBudget::detailLevelChanged, this, &GeoMaps::GeoMapProvider::updateStyleSimplification);
+    connect(&_styleSimplificationTimer, &QTimer::timeout, this, &GeoMaps::GeoMapProvider::updateStyleSimplification);
+
+    // geoJSONChanged is emitted by the last stage of rebuildAviationData()
+    connect(this, &GeoMaps::GeoMapProvider::geoJSONChanged, this, &GeoMaps::GeoMapProvider::updateStyleFile, Qt::QueuedConnection);
+
+    // Build the aviation data in the background, as soon as the catalogue of
+    // maps is known
+    GlobalObject::initScheduler()->addTask("aviationData", {"catalogue"}, [this]() {
+        aviationMapsChanged();
+        return _aviationDataRebuildFuture;
+    });
     baseMapsChanged();
 }
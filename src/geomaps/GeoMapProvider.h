@@ -22,19 +22,29 @@
 
 #include <QFuture>
 #include <QGeoCoordinate>
+#include <QGeoPath>
+#include <QGeoRectangle>
 #include <QJsonArray>
-#include <QMutex>
-#include <QMutexLocker>
 #include <QPointer>
 #include <QRegularExpression>
-#include <QTemporaryFile>
+#include <QThread>
+#include <QTimer>
+#include <memory>
 
 #include "Airspace.h"
+#include "AirspaceMonitor.h"
+#include "AviationData.h"
+#include "CompiledAviationMap.h"
 #include "Librarian.h"
 #include "dataManagement/DataManager.h"
+#include "FlightBriefing.h"
 #include "Settings.h"
+#include "Terrain.h"
 #include "Waypoint.h"
+#include "WaypointListModel.h"
+#include "TilePrefetcher.h"
 #include "TileServer.h"
+#include "units/Distance.h"
 
 
 class Librarian;
@@ -55,7 +65,10 @@ namespace GeoMaps {
  * served via two channels.
  *
  * - All files in GeoJSON format are concatenated, and the resulting compound
- *   GeoJSON is served via the geoJSON property of this class.
+ *   GeoJSON is served via the geoJSON property of this class. The same data
+ *   is also cut into vector tiles on demand, which the TileServer serves
+ *   under the path "aviationData". The mapbox style file references these
+ *   tiles as the source "aviationData".
  *
  * - A list of waypoints is generated and available via the waypoints property
  *
@@ -82,7 +95,7 @@ public:
     explicit GeoMapProvider(QObject *parent = nullptr);
 
     /*! \brief Destructor */
-    ~GeoMapProvider() = default;
+    ~GeoMapProvider() override;
 
 
     //
@@ -105,15 +118,79 @@ public:
     // Properties
     //
 
+    /*! \brief Predicted airspace proximity and penetration
+     *
+     * This property holds the alerts computed by the AirspaceMonitor, which
+     * runs in a worker thread and projects the current track of the aircraft
+     * into the future. The list contains elements of type
+     * GeoMaps::AirspaceAlert, with alerts of kind Inside first, and all others
+     * sorted by time to entry. Hidden airspaces do not generate alerts.
+     */
+    Q_PROPERTY(QVariantList airspaceAlerts READ airspaceAlerts NOTIFY airspaceAlertsChanged)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     * @returns Property airspaceAlerts
+     */
+    QVariantList airspaceAlerts() const;
+
     /*! \brief List of airspaces at a given location
+     *
+     * Hidden airspaces are pruned by the spatial index, as are airspaces that
+     * do not overlap the altitude band between bottom and top. The vertical
+     * test is conservative, see Airspace::verticalExtentInFtMSL(), so that
+     * the list may contain airspaces that lie just outside the band.  This
+     * method can be called from any thread.
      *
      * @param position Position over which airspaces are searched for
      *
+     * @param bottom Lower end of the altitude band, above MSL. If the distance
+     * is not finite, the band extends downwards without limit.
+     *
+     * @param top Upper end of the altitude band, above MSL. If the distance is
+     * not finite, the band extends upwards without limit.
+     *
      * @returns all airspaces that exist over a given position. For better
      * cooperation with QML the list returns contains elements of type QObject*,
      * and not Airspace*.
      */
-    Q_INVOKABLE QVariantList airspaces(const QGeoCoordinate& position);
+    Q_INVOKABLE QVariantList airspaces(const QGeoCoordinate& position, Units::Distance bottom={}, Units::Distance top={}) const;
+
+    /*! \brief List of airspaces in a corridor around a path
+     *
+     * This method uses the spatial index of the airspace cache to find all
+     * airspaces whose bounding box comes closer to the path than corridorWidth/2.
+     * The check is done on the level of bounding boxes only, so that the list
+     * may contain airspaces that do not actually touch the corridor. The
+     * method is meant to be used by code that performs exact tests, such as
+     * route analysis or the AirspaceMonitor. It can be called from any thread.
+     *
+     * @param path Path around which airspaces are searched for
+     *
+     * @param corridorWidth Width of the corridor
+     *
+     * @param bottom Lower end of the altitude band, as in airspaces()
+     *
+     * @param top Upper end of the altitude band, as in airspaces()
+     *
+     * @returns Airspaces whose bounding box intersects the corridor, in
+     * unspecified order
+     */
+    QVector<Airspace> airspacesInCorridor(const QGeoPath& path, Units::Distance corridorWidth, Units::Distance bottom={}, Units::Distance top={}) const;
+
+    /*! \brief List of airspaces in a given rectangle
+     *
+     * This method uses the spatial index of the airspace cache to find all
+     * airspaces whose bounding box intersects the rectangle. The check is done
+     * on the level of bounding boxes only, so that the list may contain
+     * airspaces that do not actually intersect the rectangle.
+     *
+     * @param rectangle Rectangle in which airspaces are searched for
+     *
+     * @returns Airspaces whose bounding box intersects the rectangle, in
+     * unspecified order
+     */
+    QVector<Airspace> airspacesInRectangle(const QGeoRectangle& rectangle);
 
     /*! \brief Find closest waypoint to a given position
      *
@@ -148,12 +225,27 @@ public:
      *
      * @param filter List of words
      *
-     * @returns all those waypoints whose fullName or codeName contains each of
-     * the words in filter.  In order to make the result accessible to QML, the
-     * list is returned as QList<QObject*>. It can thus be used as a data model
-     * in QML.
+     * @returns A model with all those waypoints whose fullName or codeName
+     * contains each of the words in filter. The model has no parent, so that
+     * QML takes ownership when it is used as the model of a view.
+     */
+    Q_INVOKABLE GeoMaps::WaypointListModel* filteredWaypointModel(const QString &filter);
+
+    /*! \brief Offline briefing bundle for the planned flight
+     *
+     * This property holds the FlightBriefing object, which prepares the
+     * bundle of tiles that the tile server serves first.
+     */
+    Q_PROPERTY(GeoMaps::FlightBriefing* flightBriefing READ flightBriefing CONSTANT)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     * @returns Property flightBriefing
      */
-    Q_INVOKABLE QVariantList filteredWaypointObjects(const QString &filter);
+    GeoMaps::FlightBriefing* flightBriefing()
+    {
+        return &_flightBriefing;
+    }
 
     /*! Find a waypoint by its ICAO code
      *
@@ -166,10 +258,24 @@ public:
      */
     Waypoint findByID(const QString& id);
 
+    /*! Find waypoints by their ICAO codes
+     *
+     * This method is equivalent to calling findByID() for every element of
+     * ids, but locks the aviation data only once.
+     *
+     * @param ids ICAO codes of the waypoints
+     *
+     * @returns A hash that maps ICAO codes to waypoints. ICAO codes for which
+     * no waypoint has been found are not contained in the hash.
+     */
+    QHash<QString, Waypoint> findByIDs(const QStringList& ids);
+
     /*! \brief Union of all aviation maps in GeoJSON format
      *
      * This property holds all installed aviation maps in GeoJSON format,
-     * combined into one GeoJSON document.
+     * combined into one GeoJSON document. The document is released when
+     * memory runs low. It is then empty, until it has been rebuilt in the
+     * background and geoJSONChanged() is emitted.
      */
     Q_PROPERTY(QByteArray geoJSON READ geoJSON NOTIFY geoJSONChanged)
 
@@ -177,9 +283,20 @@ public:
      *
      * @returns Property geoJSON
      */
-    QByteArray geoJSON() {
-        QMutexLocker lock(&_aviationDataMutex);
-        return _combinedGeoJSON_;
+    QByteArray geoJSON() const;
+
+    /*! \brief Current snapshot of the aviation data
+     *
+     * This method never blocks. The snapshot returned is immutable and remains
+     * valid for as long as the caller holds the pointer, even if the
+     * GeoMapProvider publishes a new snapshot in the meantime. The method is
+     * thread-safe.
+     *
+     * @returns Pointer to the current snapshot. The pointer is never a nullptr.
+     */
+    std::shared_ptr<const AviationData> aviationData() const
+    {
+        return std::atomic_load(&_aviationData);
     }
 
     /*! List of nearby waypoints
@@ -187,20 +304,37 @@ public:
      * @param position Position near which waypoints are searched for
      * @param type Type of waypoints (AD, NAV, WP)
      *
-     * @returns a list of the 20 waypoints of requested type that are closest to
-     * the given position; the list may however be empty or contain fewer than
-     * 20 items.  For better cooperation with QML the list does not contain
-     * elements of type Waypoint*, but elements of type QObject*
+     * @returns a model with the 20 waypoints of requested type that are
+     * closest to the given position; the model may however be empty or
+     * contain fewer than 20 items. The model has no parent, so that QML takes
+     * ownership when it is used as the model of a view.
      */
-    Q_INVOKABLE QVariantList nearbyWaypoints(const QGeoCoordinate& position, const QString& type);
+    Q_INVOKABLE GeoMaps::WaypointListModel* nearbyWaypointModel(const QGeoCoordinate& position, const QString& type);
+
+    /*! \brief Waypoints within a given radius
+     *
+     * This method uses the spatial index of the waypoint cache.
+     *
+     * @param position Center of the search area
+     *
+     * @param radius Search radius
+     *
+     * @param type Type of waypoints (AD, NAV, WP), or an empty string for
+     * waypoints of all types
+     *
+     * @returns All waypoints of the given type whose distance to position is
+     * at most radius, sorted by distance
+     */
+    QVector<Waypoint> waypointsWithinRadius(const QGeoCoordinate& position, Units::Distance radius, const QString& type={});
 
     /*! \brief URL where a style file for the base map can be retrieved
      *
      * This property holds a URL where a mapbox style file for the base map can
      * be retrieved. The style file is adjusted, so that its source element
-     * points to the local TileServer URL where the base map is served.
-     * Whenever the base map changes (e.g. because new maps have been downloaded
-     * or removed), the style file is deleted, a new style file is generated and
+     * points to the local TileServer URL where the base map is served. The
+     * style is generated in memory and served by the TileServer. Whenever the
+     * base map or the aviation data change, a new style is generated; if it
+     * differs from the old one, the TileServer serves it under a new URL and
      * a notification signal is emitted.
      */
     Q_PROPERTY(QString styleFileURL READ styleFileURL NOTIFY styleFileURLChanged)
@@ -211,17 +345,36 @@ public:
      */
     QString styleFileURL() const;
 
+    /*! \brief Terrain elevation and terrain awareness
+     *
+     * This property holds the Terrain object, which reads the terrain maps of
+     * the DataManager and follows the position of ownship.
+     */
+    Q_PROPERTY(GeoMaps::Terrain* terrain READ terrain CONSTANT)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     * @returns Property terrain
+     */
+    GeoMaps::Terrain* terrain()
+    {
+        return &_terrain;
+    }
+
     /*! \brief Waypoints
      *
      * @returns a list of all waypoints known to this GeoMapProvider (that is,
      * the union of all waypoints in any of the installed maps)
      */
-    QVector<Waypoint> waypoints() {
-        QMutexLocker locker(&_aviationDataMutex);
-        return _waypoints_;
+    QVector<Waypoint> waypoints() const
+    {
+        return aviationData()->waypoints();
     }
 
 signals:
+    /*! \brief Notification signal for the property with the same name */
+    void airspaceAlertsChanged();
+
     /*! \brief Notification signal for the property with the same name */
     void geoJSONChanged();
 
@@ -237,23 +390,54 @@ private slots:
 private:
     Q_DISABLE_COPY_MOVE(GeoMapProvider)
 
-    // Caches used to speed up the method simplifySpecialChars
-    QRegularExpression specialChars {QStringLiteral("[^a-zA-Z0-9]")};
-    QHash<QString, QString> simplifySpecialChars_cache;
+    // The benchmark loads synthetic data via fillAviationDataCache()
+    friend class QueryBenchmark;
 
     // This slot is called every time the the set of GeoJSON files changes. It
-    // fills the aviation data cache.
+    // cancels any running rebuild and starts rebuildAviationData().
     void aviationMapsChanged();
 
-    // Interal function that does most of the work for aviationMapsChanged() emits
-    // geoJSONChanged() when done. This function is meant to be run in a separate
-    // thread.
-    void fillAviationDataCache(const QStringList& JSONFileNames, bool hideUpperAirspaces, bool hideGlidingSectors);
+    // Pipeline that compiles the changed maps and merges all maps in the
+    // thread pool, then publishes the new snapshot and emits geoJSONChanged()
+    // on the GUI thread. The pipeline stops after the current stage once the
+    // token is cancelled; only the last pipeline started ever publishes.
+    Async::Task rebuildAviationData(QStringList JSONFileNames, Async::CancellationToken token);
+
+    // Synchronous version of rebuildAviationData(), for the benchmark
+    void fillAviationDataCache(const QStringList& JSONFileNames);
+
+    // Those files that are not in _compiledAviationMaps, or that have changed
+    // since they were compiled
+    QStringList changedAviationMaps(const QStringList& JSONFileNames) const;
+
+    // Stores newly compiled maps in _compiledAviationMaps, forgets about maps
+    // that are no longer installed, and returns the compiled maps for
+    // JSONFileNames, in that order
+    QVector<CompiledAviationMap> updateCompiledAviationMaps(const QStringList& JSONFileNames, const QStringList& changedFileNames, const QVector<CompiledAviationMap>& changedMaps);
+
+    // Compiles maps, in parallel. Thread-safe.
+    static QVector<CompiledAviationMap> compileAviationMaps(const QStringList& JSONFileNames);
+
+    // Merges compiled maps into a snapshot, including all indices. Features
+    // that appear in more than one map are included only once. Thread-safe.
+    static std::shared_ptr<const AviationData> mergeAviationMaps(const QVector<CompiledAviationMap>& maps);
+
+    // Releases the tile cache and the GeoJSON document, when the platform
+    // reports that memory runs low
+    void releaseMemory();
 
     // This slot is called every time the the set of MBTile files changes. It
     // sets up the tile server to and generates a new style file.
     void baseMapsChanged();
 
+    // Generates a new style file, which points to the current tile sets of the
+    // base maps and of the aviation data
+    void updateStyleFile();
+
+    // Applies the simplification requested by the render budget to the style
+    // file, but holds every level for a minimum time
+    void updateStyleSimplification();
+
     // This is the path under which is tiles are available on the
     // _tileServer. This is set to a random number that changes every time the
     // set of MBTile files changes
@@ -262,22 +446,47 @@ private:
     // Tile Server
     TileServer _tileServer;
 
-    // Temporary file that holds the current style file
-    QPointer<QTemporaryFile> _styleFile;
+    // Loads tiles along the route and ahead of the aircraft into the cache of
+    // _tileServer
+    TilePrefetcher _tilePrefetcher {&_tileServer};
+
+    // Offline briefing bundle, whose tiles are served by _tileServer
+    FlightBriefing _flightBriefing {&_tileServer};
+
+    // Contents of the style file osm-liberty.json, with placeholders for the
+    // URLs. Empty until the style is generated for the first time.
+    QByteArray _styleTemplate;
+
+    // Simplification of the aviation data in the current style file, and
+    // timer that runs while the simplification must not change
+    int _styleSimplificationReduction {0};
+    QTimer _styleSimplificationTimer;
+
+    // Airspace monitor, which lives in its own thread, and its latest alerts
+    QThread _airspaceMonitorThread;
+    QPointer<AirspaceMonitor> _airspaceMonitor;
+    QVector<AirspaceAlert> _airspaceAlerts;
+
+    // Terrain elevation, read from the terrain maps
+    Terrain _terrain;
 
     //
     // Aviation Data Cache
     //
-    QFuture<void>    _aviationDataCacheFuture; // Future; indicates if fillAviationDataCache() is currently running
-    QTimer           _aviationDataCacheTimer;  // Timer used to start another run of fillAviationDataCache()
-
-    // The data in this group is accessed by several threads. The following classes
-    // (whose names ends in an underscore) are therefore
-    // protected by this mutex.
-    QMutex           _aviationDataMutex;
-    QByteArray       _combinedGeoJSON_; // Cache: GeoJSON
-    QVector<Waypoint> _waypoints_;       // Cache: Waypoints
-    QVector<Airspace> _airspaces_;       // Cache: Airspaces
+    Async::CancellationToken _aviationDataRebuildToken; // Token of the latest run of rebuildAviationData()
+    QFuture<void>            _aviationDataRebuildFuture; // Finishes when the latest run of rebuildAviationData() ends
+
+    // Current snapshot of the aviation data. This pointer is accessed by
+    // several threads and must only be read and written with std::atomic_load
+    // and std::atomic_store.
+    std::shared_ptr<const AviationData> _aviationData;
+
+    // Compiled aviation maps, by file name, as read by the last run of
+    // rebuildAviationData(). When a single map changes, only that map is
+    // read again. When filter settings change, no file is read at all. This
+    // member is only used on the GUI thread, between the stages of the
+    // pipeline, so no locking is required.
+    QHash<QString, CompiledAviationMap> _compiledAviationMaps;
 };
 
 };
@@ -0,0 +1,210 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+#include "KDTree.h"
+
+
+namespace {
+
+// Squared Euclidean distance of two vectors
+inline auto distanceSquared(const double (&a)[3], const double (&b)[3]) -> double
+{
+    auto dx = a[0]-b[0];
+    auto dy = a[1]-b[1];
+    auto dz = a[2]-b[2];
+    return dx*dx + dy*dy + dz*dz;
+}
+
+}
+
+
+GeoMaps::KDTree::KDTree(const std::vector<Point>& points)
+{
+    m_nodes.reserve(points.size());
+    for(const auto& point : points) {
+        Node node;
+        toXYZ(point.latitude, point.longitude, node.xyz);
+        node.id = point.id;
+        m_nodes.push_back(node);
+    }
+    build(0, static_cast<int>(m_nodes.size()));
+}
+
+
+void GeoMaps::KDTree::build(int begin, int end)
+{
+    if (end-begin <= 1) {
+        return;
+    }
+
+    // Split along the axis of largest spread
+    double minimum[3] {2.0, 2.0, 2.0};
+    double maximum[3] {-2.0, -2.0, -2.0};
+    for(int i=begin; i<end; i++) {
+        for(int a=0; a<3; a++) {
+            minimum[a] = std::min(minimum[a], m_nodes[i].xyz[a]);
+            maximum[a] = std::max(maximum[a], m_nodes[i].xyz[a]);
+        }
+    }
+    int axis = 0;
+    for(int a=1; a<3; a++) {
+        if (maximum[a]-minimum[a] > maximum[axis]-minimum[axis]) {
+            axis = a;
+        }
+    }
+
+    auto mid = begin + (end-begin)/2;
+    std::nth_element(m_nodes.begin()+begin, m_nodes.begin()+mid, m_nodes.begin()+end,
+                     [axis](const Node& a, const Node& b) { return a.xyz[axis] < b.xyz[axis]; });
+    m_nodes[mid].axis = axis;
+
+    build(begin, mid);
+    build(mid+1, end);
+}
+
+
+template<typename Visitor> void GeoMaps::KDTree::search(int begin, int end, const double (&query)[3], Visitor& visitor) const
+{
+    if (begin >= end) {
+        return;
+    }
+
+    auto mid = begin + (end-begin)/2;
+    const auto& node = m_nodes[mid];
+
+    auto d2 = distanceSquared(query, node.xyz);
+    if (d2 <= visitor.radiusSquared) {
+        visitor.visit(mid, d2);
+    }
+    if (end-begin == 1) {
+        return;
+    }
+
+    // Descend into the half that contains the query point first, and into the
+    // other half only if the splitting plane is within the search radius
+    auto delta = query[node.axis] - node.xyz[node.axis];
+    if (delta < 0) {
+        search(begin, mid, query, visitor);
+        if (delta*delta <= visitor.radiusSquared) {
+            search(mid+1, end, query, visitor);
+        }
+    } else {
+        search(mid+1, end, query, visitor);
+        if (delta*delta <= visitor.radiusSquared) {
+            search(begin, mid, query, visitor);
+        }
+    }
+}
+
+
+auto GeoMaps::KDTree::nearest(double latitude, double longitude, int k, double maxDistanceInM) const -> std::vector<Neighbour>
+{
+    std::vector<Neighbour> result;
+    if ((k <= 0) || m_nodes.empty()) {
+        return result;
+    }
+
+    // Visitor that keeps the k best candidates in a max-heap
+    struct Visitor {
+        using Candidate = std::pair<double,int>;
+        std::priority_queue<Candidate> heap;
+        double radiusSquared;
+        size_t k;
+        void visit(int index, double d2)
+        {
+            heap.emplace(d2, index);
+            if (heap.size() > k) {
+                heap.pop();
+            }
+            if (heap.size() == k) {
+                radiusSquared = std::min(radiusSquared, heap.top().first);
+            }
+        }
+    };
+
+    auto maxChord = metersToChord(maxDistanceInM);
+    Visitor visitor {{}, maxChord*maxChord, static_cast<size_t>(k)};
+    double query[3];
+    toXYZ(latitude, longitude, query);
+    search(0, static_cast<int>(m_nodes.size()), query, visitor);
+
+    result.resize(visitor.heap.size());
+    for(auto i=static_cast<int>(result.size())-1; i>=0; i--) {
+        const auto& candidate = visitor.heap.top();
+        result[i] = {m_nodes[candidate.second].id, chordToMeters(std::sqrt(candidate.first))};
+        visitor.heap.pop();
+    }
+    return result;
+}
+
+
+auto GeoMaps::KDTree::withinRadius(double latitude, double longitude, double radiusInM) const -> std::vector<Neighbour>
+{
+    // Visitor that collects all candidates
+    struct Visitor {
+        std::vector<std::pair<double,int>> found;
+        double radiusSquared;
+        void visit(int index, double d2)
+        {
+            found.emplace_back(d2, index);
+        }
+    };
+
+    auto chord = metersToChord(radiusInM);
+    Visitor visitor {{}, chord*chord};
+    double query[3];
+    toXYZ(latitude, longitude, query);
+    search(0, static_cast<int>(m_nodes.size()), query, visitor);
+
+    std::sort(visitor.found.begin(), visitor.found.end());
+    std::vector<Neighbour> result;
+    result.reserve(visitor.found.size());
+    for(const auto& candidate : visitor.found) {
+        result.push_back({m_nodes[candidate.second].id, chordToMeters(std::sqrt(candidate.first))});
+    }
+    return result;
+}
+
+
+auto GeoMaps::KDTree::chordToMeters(double chord) -> double
+{
+    return 2.0*std::asin(std::min(chord/2.0, 1.0))*earthRadiusInM;
+}
+
+
+auto GeoMaps::KDTree::metersToChord(double meters) -> double
+{
+    auto angle = std::min(meters/earthRadiusInM, M_PI);
+    return 2.0*std::sin(angle/2.0);
+}
+
+
+void GeoMaps::KDTree::toXYZ(double latitude, double longitude, double (&xyz)[3])
+{
+    auto lat = latitude*M_PI/180.0;
+    auto lon = longitude*M_PI/180.0;
+    xyz[0] = std::cos(lat)*std::cos(lon);
+    xyz[1] = std::cos(lat)*std::sin(lon);
+    xyz[2] = std::sin(lat);
+}
@@ -0,0 +1,154 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+
+namespace GeoMaps {
+
+/*! \brief Static k-d tree for nearest-neighbour queries on the globe
+ *
+ * This class implements a read-only k-d tree over points on the surface of the
+ * earth.  Points are converted to three-dimensional unit vectors, so that the
+ * Euclidean (chord) distance used internally is a monotone function of the
+ * great-circle distance. Nearest-neighbour searches are therefore exact, and
+ * there are no problems at the poles or at the date line.
+ *
+ * Entries are identified by integer IDs that are chosen by the caller,
+ * typically indices into a vector of waypoints.
+ *
+ * Once constructed, the tree is never modified. It is therefore safe to query
+ * the same instance from several threads at the same time.
+ */
+
+class KDTree
+{
+public:
+    /*! \brief Point with ID, as used to construct the tree */
+    struct Point
+    {
+        /*! \brief Latitude in degrees */
+        double latitude {0.0};
+
+        /*! \brief Longitude in degrees */
+        double longitude {0.0};
+
+        /*! \brief ID of the point */
+        int id {-1};
+    };
+
+    /*! \brief Result of a query */
+    struct Neighbour
+    {
+        /*! \brief ID of the point */
+        int id {-1};
+
+        /*! \brief Great-circle distance to the query point, in meters */
+        double distanceInM {0.0};
+    };
+
+    /*! \brief Constructs an empty tree */
+    KDTree() = default;
+
+    /*! \brief Constructs a tree
+     *
+     * @param points Points that are to be stored in the tree
+     */
+    explicit KDTree(const std::vector<Point>& points);
+
+    /*! \brief Check if the tree is empty
+     *
+     * @returns True if the tree holds no points
+     */
+    bool isEmpty() const
+    {
+        return m_nodes.empty();
+    }
+
+    /*! \brief k nearest neighbours
+     *
+     * @param latitude Latitude of the query point, in degrees
+     *
+     * @param longitude Longitude of the query point, in degrees
+     *
+     * @param k Maximal number of points returned
+     *
+     * @param maxDistanceInM Only points closer than this distance are returned
+     *
+     * @returns Up to k points closest to the query point, sorted by distance
+     */
+    std::vector<Neighbour> nearest(double latitude, double longitude, int k, double maxDistanceInM=earthRadiusInM*3.15) const;
+
+    /*! \brief Radius query
+     *
+     * @param latitude Latitude of the query point, in degrees
+     *
+     * @param longitude Longitude of the query point, in degrees
+     *
+     * @param radiusInM Search radius, in meters
+     *
+     * @returns All points whose distance to the query point is at most
+     * radiusInM, sorted by distance
+     */
+    std::vector<Neighbour> withinRadius(double latitude, double longitude, double radiusInM) const;
+
+    /*! \brief Number of points
+     *
+     * @returns Number of points in the tree
+     */
+    int size() const
+    {
+        return static_cast<int>(m_nodes.size());
+    }
+
+    /*! \brief Mean earth radius, in meters, as used by QGeoCoordinate */
+    static constexpr double earthRadiusInM = 6371007.2;
+
+private:
+    struct Node
+    {
+        double xyz[3] {0.0, 0.0, 0.0};
+        int id {-1};
+        int axis {0};
+    };
+
+    // Recursively arranges m_nodes[begin, end) as an implicit, balanced tree
+    // whose root is the median element
+    void build(int begin, int end);
+
+    // Recursive search. Calls visitor.visit() with node index and squared
+    // chord distance for every node within visitor.radiusSquared, which the
+    // visitor may shrink during the search
+    template<typename Visitor> void search(int begin, int end, const double (&query)[3], Visitor& visitor) const;
+
+    // Conversion between chord lengths on the unit sphere and great-circle
+    // distances in meters
+    static double chordToMeters(double chord);
+    static double metersToChord(double meters);
+
+    // Conversion to unit vectors
+    static void toXYZ(double latitude, double longitude, double (&xyz)[3]);
+
+    std::vector<Node> m_nodes;
+};
+
+};
@@ -0,0 +1,309 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QSqlDatabase>
+#include <QUrl>
+#include <utility>
+
+#include "MBTilesReader.h"
+#include "WebMercator.h"
+
+
+GeoMaps::MBTilesReader::MBTilesReader(QVector<Source> sources, QString connectionPrefix, QObject *parent)
+    : QObject(parent),
+      m_sources(std::move(sources)),
+      m_connectionPrefix(std::move(connectionPrefix))
+{
+}
+
+
+GeoMaps::MBTilesReader::~MBTilesReader()
+{
+    auto fileNames = m_tileQueries.keys();
+    m_tileQueries.clear();
+    foreach(auto fileName, fileNames) {
+        QSqlDatabase::removeDatabase(m_connectionPrefix+"-"+fileName);
+    }
+}
+
+
+void GeoMaps::MBTilesReader::closeFile(const QString& fileName)
+{
+    for(int i=m_sources.size()-1; i>=0; i--) {
+        if (m_sources[i].fileName == fileName) {
+            m_sources.removeAt(i);
+        }
+    }
+    if (m_tileQueries.remove(fileName) > 0) {
+        QSqlDatabase::removeDatabase(m_connectionPrefix+"-"+fileName);
+    }
+}
+
+
+auto GeoMaps::MBTilesReader::deduplicateTiles(const QString& fileName) -> bool
+{
+    // SQLite would create a new, empty database
+    if (!QFileInfo::exists(fileName)) {
+        return false;
+    }
+
+    auto connectionName = "GeoMaps::MBTilesReader::deduplicateTiles "+fileName;
+    bool result = false;
+    {
+        auto db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(fileName);
+        db.open();
+        if (!db.isOpenError()) {
+            QSqlQuery query(db);
+            if (query.exec("select type from sqlite_master where name='tiles';") && query.first() && (query.value(0).toString() == "table") &&
+                    db.transaction()) {
+                bool ok = query.exec("create table images (tile_id text primary key, tile_data blob);") &&
+                        query.exec("create table map (zoom_level integer, tile_column integer, tile_row integer, tile_id text);");
+
+                // Copy all tiles. Identical tile data has identical hashes and
+                // is stored only once.
+                QSqlQuery insertImage(db);
+                QSqlQuery insertMap(db);
+                ok = ok && insertImage.prepare("insert or ignore into images (tile_id, tile_data) values (?, ?);") &&
+                        insertMap.prepare("insert into map (zoom_level, tile_column, tile_row, tile_id) values (?, ?, ?, ?);");
+                query.setForwardOnly(true);
+                ok = ok && query.exec("select zoom_level, tile_column, tile_row, tile_data from tiles;");
+                qint64 tileBytes = 0;
+                qint64 imageBytes = 0;
+                while(ok && query.next()) {
+                    auto tileData = query.value(3).toByteArray();
+                    auto tileID = QCryptographicHash::hash(tileData, QCryptographicHash::Sha1).toHex();
+                    tileBytes += tileData.size();
+
+                    insertImage.bindValue(0, tileID);
+                    insertImage.bindValue(1, tileData);
+                    ok = insertImage.exec();
+                    if (insertImage.numRowsAffected() > 0) {
+                        imageBytes += tileData.size();
+                    }
+
+                    insertMap.bindValue(0, query.value(0));
+                    insertMap.bindValue(1, query.value(1));
+                    insertMap.bindValue(2, query.value(2));
+                    insertMap.bindValue(3, tileID);
+                    ok = ok && insertMap.exec();
+                }
+                query.finish();
+                insertImage.finish();
+                insertMap.finish();
+
+                // Replace the table by a view, unless the savings are too
+                // small to justify the new layout
+                ok = ok && (tileBytes > 0) && (imageBytes <= (1.0-minDeduplicationSavings)*tileBytes);
+                ok = ok && query.exec("drop table tiles;") &&
+                        query.exec("create unique index map_index on map (zoom_level, tile_column, tile_row);") &&
+                        query.exec("create view tiles as select map.zoom_level as zoom_level, map.tile_column as tile_column, map.tile_row as tile_row, images.tile_data as tile_data from map join images on images.tile_id = map.tile_id;");
+                if (ok && db.commit()) {
+                    // Failure to vacuum leaves a valid file, which is merely
+                    // not smaller than before
+                    query.exec("vacuum;");
+                    result = true;
+                } else {
+                    db.rollback();
+                }
+            }
+            query.finish();
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return result;
+}
+
+
+auto GeoMaps::MBTilesReader::ensureTileIndex(const QString& fileName) -> bool
+{
+    // SQLite would create a new, empty database
+    if (!QFileInfo::exists(fileName)) {
+        return false;
+    }
+
+    auto connectionName = "GeoMaps::MBTilesReader::ensureTileIndex "+fileName;
+    bool result = false;
+    {
+        auto db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(fileName);
+        db.open();
+        if (!db.isOpenError()) {
+            result = true;
+
+            QSqlQuery query(db);
+            if (query.exec("select type from sqlite_master where name='tiles';") && query.first() && (query.value(0).toString() == "table")) {
+                // Look for an index whose leading columns are zoom_level,
+                // tile_column and tile_row
+                bool hasIndex = false;
+                QStringList indexNames;
+                if (query.exec("pragma index_list(tiles);")) {
+                    while(query.next()) {
+                        indexNames += query.value(1).toString();
+                    }
+                }
+                foreach(auto indexName, indexNames) {
+                    QStringList columns;
+                    if (query.exec(QString("pragma index_info(\"%1\");").arg(indexName))) {
+                        while(query.next()) {
+                            columns += query.value(2).toString();
+                        }
+                    }
+                    if (columns.mid(0, 3) == QStringList({"zoom_level", "tile_column", "tile_row"})) {
+                        hasIndex = true;
+                        break;
+                    }
+                }
+                if (!hasIndex) {
+                    result = query.exec("create unique index if not exists tile_index on tiles (zoom_level, tile_column, tile_row);");
+                }
+            }
+            query.finish();
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return result;
+}
+
+
+auto GeoMaps::MBTilesReader::openDatabase(const QString& connectionName, const QString& fileName) -> QSqlDatabase
+{
+    auto db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_OPEN_URI");
+    db.setDatabaseName(QUrl::fromLocalFile(fileName).toString(QUrl::FullyEncoded)+"?immutable=1");
+    db.open();
+    if (db.isOpenError()) {
+        return db;
+    }
+
+    // Map the whole file into memory, and keep a moderate page cache for
+    // the pages that are not mapped (for instance, if mmap is unavailable)
+    QSqlQuery query(db);
+    query.exec(QString("pragma mmap_size=%1;").arg(QFileInfo(fileName).size()));
+    query.exec("pragma cache_size=-2048;");
+    return db;
+}
+
+
+void GeoMaps::MBTilesReader::readTile(quint64 requestID, quint32 z, quint32 x, quint32 y)
+{
+    quint32 yflipped = ((quint32(1) <<z)-1)-y;
+
+    // Retrieve tile data from those databases that might contain the tile
+    foreach(const auto& source, m_sources) {
+        if (!source.covers(z, x, y)) {
+            continue;
+        }
+        auto* query = tileQuery(source.fileName);
+        if (query == nullptr) {
+            continue;
+        }
+        query->bindValue(0, z);
+        query->bindValue(1, x);
+        query->bindValue(2, yflipped);
+        query->exec();
+
+        // Error handling
+        if (!query->first()) {
+            continue;
+        }
+
+        // Get data
+        auto tileData = query->value(0).toByteArray();
+        query->finish();
+        emit tileRead(requestID, tileData);
+        return;
+    }
+
+    emit tileRead(requestID, QByteArray());
+}
+
+
+auto GeoMaps::MBTilesReader::tileQuery(const QString& fileName) -> QSqlQuery*
+{
+    auto it = m_tileQueries.find(fileName);
+    if (it != m_tileQueries.end()) {
+        return &it.value();
+    }
+
+    // Open database
+    auto db = openDatabase(m_connectionPrefix+"-"+fileName, fileName);
+    if (db.isOpenError()) {
+        return nullptr;
+    }
+
+    // Prepare statement for tile retrieval. In the deduplicated layout, the
+    // tiles table is a view on the tables map and images.
+    QSqlQuery query(db);
+    auto deduplicated = db.tables().contains("map") && db.tables().contains("images");
+    auto statement = deduplicated ?
+                QStringLiteral("select images.tile_data from map join images on images.tile_id = map.tile_id where map.zoom_level=? and map.tile_column=? and map.tile_row=?;") :
+                QStringLiteral("select tile_data from tiles where zoom_level=? and tile_column=? and tile_row=?;");
+    if (!query.prepare(statement)) {
+        return nullptr;
+    }
+    return &m_tileQueries.insert(fileName, query).value();
+}
+
+
+void GeoMaps::MBTilesReader::Source::computeCoverage(const QString& bounds, int fileMinzoom, int fileMaxzoom)
+{
+    ranges.clear();
+
+    // Bounds are given as "left,bottom,right,top", in degrees
+    auto values = bounds.split(',');
+    if ((values.size() != 4) || (fileMinzoom < 0) || (fileMaxzoom < fileMinzoom) || (fileMaxzoom > 24)) {
+        return;
+    }
+    bool ok[4] = {false, false, false, false};
+    auto west = values[0].toDouble(&ok[0]);
+    auto south = values[1].toDouble(&ok[1]);
+    auto east = values[2].toDouble(&ok[2]);
+    auto north = values[3].toDouble(&ok[3]);
+    if (!ok[0] || !ok[1] || !ok[2] || !ok[3] || (west > east) || (south > north)) {
+        return;
+    }
+
+    minzoom = fileMinzoom;
+    for(int z=fileMinzoom; z<=fileMaxzoom; z++) {
+        auto [minX, minY] = webMercatorTile(north, west, z);
+        auto [maxX, maxY] = webMercatorTile(south, east, z);
+        ranges.append({minX, maxX, minY, maxY});
+    }
+}
+
+
+auto GeoMaps::MBTilesReader::Source::covers(quint32 z, quint32 x, quint32 y) const -> bool
+{
+    if (ranges.isEmpty()) {
+        return true;
+    }
+    auto index = static_cast<int>(z)-minzoom;
+    if ((index < 0) || (index >= ranges.size())) {
+        return false;
+    }
+    const auto& range = ranges[index];
+    return (x >= range.minX) && (x <= range.maxX) && (y >= range.minY) && (y <= range.maxY);
+}
@@ -0,0 +1,221 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVector>
+
+
+namespace GeoMaps {
+
+/*! \brief Reads tiles from a set of MBTiles files, in a worker thread
+
+  This class reads tiles from one or more MBTiles files. It is meant to be
+  moved to a worker thread, so that SQLite reads never block the thread that
+  serves HTTP requests. Because QSqlDatabase connections may only be used in
+  the thread that created them, every instance opens its own connections,
+  lazily, in the thread in which it lives. The connections are closed when
+  the instance is destructed, and must therefore be destructed in that thread
+  as well.
+*/
+
+class MBTilesReader : public QObject
+{
+  Q_OBJECT
+
+public:
+  /*! \brief Range of tile columns and rows, in XYZ numbering */
+  struct TileRange {
+    quint32 minX; /*!< Minimal column */
+    quint32 maxX; /*!< Maximal column */
+    quint32 minY; /*!< Minimal row, counted from the north */
+    quint32 maxY; /*!< Maximal row, counted from the north */
+  };
+
+  /*! \brief MBTiles file, with the area covered by its tiles */
+  struct Source {
+    /*! \brief Name of the file */
+    QString fileName;
+
+    /*! \brief Zoom level of the first entry in ranges */
+    int minzoom {0};
+
+    /*! \brief Coverage of the file
+
+      For every zoom level, starting at minzoom, the range of tiles covered by
+      the file, as computed from its bounds metadata. If empty, the file is
+      assumed to cover all tiles.
+    */
+    QVector<TileRange> ranges;
+
+    /*! \brief Compute coverage from metadata
+
+      @param bounds Bounds metadata, of the form "left,bottom,right,top"
+
+      @param fileMinzoom Minzoom metadata
+
+      @param fileMaxzoom Maxzoom metadata
+    */
+    void computeCoverage(const QString& bounds, int fileMinzoom, int fileMaxzoom);
+
+    /*! \brief Check if the file might contain a tile
+
+      @param z Zoom level
+
+      @param x Column
+
+      @param y Row, counted from the north
+
+      @returns False if the file is known not to contain the tile
+    */
+    bool covers(quint32 z, quint32 x, quint32 y) const;
+  };
+
+  /*! \brief Create a new reader
+
+    @param sources MBTiles files which are expected to conform to the MBTiles
+    Specification 1.3
+    (https://github.com/mapbox/mbtiles-spec/blob/master/1.3/spec.md). If a tile
+    is contained in more than one of the files, the data is expected to be
+    identical in each of the files.
+
+    @param connectionPrefix Prefix for the names of the database connections.
+    The prefix must be unique for every instance.
+
+    @param parent The standard QObject parent
+  */
+  explicit MBTilesReader(QVector<Source> sources, QString connectionPrefix, QObject *parent = nullptr);
+
+  // Destructor, closes all database connections
+  ~MBTilesReader() override;
+
+  /*! \brief Convert a file to the deduplicated layout
+
+    Base maps contain large numbers of byte-identical tiles, for instance
+    over open sea. This method converts a file in which "tiles" is a table
+    into the layout that the MBTiles specification allows as an alternative:
+    a table "map" that references unique tile data in a table "images" by
+    the SHA-1 hash of the data, and a view "tiles" that joins the two. The
+    conversion runs in a single transaction and is rolled back if it saves
+    less than minDeduplicationSavings of the tile data. Otherwise, the file
+    is vacuumed, in order to return the space to the file system.
+
+    Files that are not in the plain layout are left alone. This method opens
+    the file for writing and can take a long time. It is thread-safe and
+    meant to be run in a worker thread, once, on a downloaded file before it
+    is installed.
+
+    @param fileName Name of an MBTiles file
+
+    @returns True if the file was converted
+  */
+  static bool deduplicateTiles(const QString& fileName);
+
+  /*! \brief Minimal fraction of the tile data that deduplicateTiles() must save */
+  static constexpr double minDeduplicationSavings = 0.1;
+
+  /*! \brief Ensure that a file has an index for tile lookups
+
+    Every tile lookup searches the tiles table by zoom level, column and row.
+    This method checks that the table has an index on these columns, and
+    builds the index if it does not. Files in which "tiles" is a view, rather
+    than a table, are left alone. This method opens the file for writing and
+    can take a long time if the index needs to be built. It is thread-safe
+    and meant to be run in a worker thread, once, on a downloaded file before
+    it is installed.
+
+    @param fileName Name of an MBTiles file
+
+    @returns True if the index exists or was built successfully
+  */
+  static bool ensureTileIndex(const QString& fileName);
+
+  /*! \brief Open an MBTiles file for reading
+
+    This method adds a database connection and opens the file read-only and
+    as immutable, so that SQLite never takes locks and never looks for a
+    journal. The file is memory-mapped in full. The file must therefore not
+    change while the connection is open.
+
+    @param connectionName Name of the database connection
+
+    @param fileName Name of an MBTiles file
+
+    @returns The database. Use isOpenError() to check for errors.
+  */
+  static QSqlDatabase openDatabase(const QString& connectionName, const QString& fileName);
+
+public slots:
+  /*! \brief Close a file
+
+    Removes the file from the list of sources and closes the database
+    connection, if one is open.
+
+    @param fileName Name of the file
+  */
+  void closeFile(const QString& fileName);
+
+  /*! \brief Read a tile
+
+    This method reads a tile and emits tileRead() when done.
+
+    @param requestID Number that is passed on to tileRead()
+
+    @param z Zoom level
+
+    @param x Column
+
+    @param y Row, counted from the north
+  */
+  void readTile(quint64 requestID, quint32 z, quint32 x, quint32 y);
+
+signals:
+  /*! \brief Emitted when readTile() is done
+
+    @param requestID Number passed to readTile()
+
+    @param tileData Tile data, exactly as found in the file, or an empty
+    array if the tile was not found
+  */
+  void tileRead(quint64 requestID, QByteArray tileData);
+
+private:
+  Q_DISABLE_COPY_MOVE(MBTilesReader)
+
+  // Prepared statement that reads a tile from the given file, opening the
+  // database connection if necessary. For files in the deduplicated layout,
+  // the statement joins the tables "map" and "images" directly. Returns
+  // nullptr on error.
+  QSqlQuery* tileQuery(const QString& fileName);
+
+  QVector<Source> m_sources;
+  QString m_connectionPrefix;
+
+  // Prepared statements, by file name. The statements must be destructed
+  // before the connections are removed.
+  QHash<QString, QSqlQuery> m_tileQueries;
+};
+
+};
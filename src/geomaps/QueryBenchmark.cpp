@@ -0,0 +1,207 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtMath>
+#include <functional>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#include "GlobalObject.h"
+#include "geomaps/GeoMapProvider.h"
+#include "geomaps/QueryBenchmark.h"
+
+
+namespace {
+
+// Size of the synthetic map
+const int numWaypoints = 50000;
+const int numAirspaces = 10000;
+
+// Number of calls for each query
+const int numQueries = 2000;
+
+// Region covered by the synthetic map, roughly Europe
+const double minLatitude = 35.0;
+const double maxLatitude = 70.0;
+const double minLongitude = -10.0;
+const double maxLongitude = 40.0;
+
+// Seed for the random number generator
+const quint32 seed = 4711;
+
+auto randomCoordinate(QRandomGenerator& generator) -> QGeoCoordinate
+{
+    return {minLatitude+generator.generateDouble()*(maxLatitude-minLatitude),
+                minLongitude+generator.generateDouble()*(maxLongitude-minLongitude)};
+}
+
+// Synthetic ICAO code for airfield number i
+auto airfieldCode(int i) -> QString
+{
+    QString code = QStringLiteral("XAAA");
+    for(int j=3; j>0; j--) {
+        code[j] = QChar('A'+i%26);
+        i /= 26;
+    }
+    return code;
+}
+
+}
+
+
+auto GeoMaps::QueryBenchmark::run() -> int
+{
+    QTextStream out(stdout);
+    out << QStringLiteral("Peak memory before benchmark: %1 kB").arg(peakMemory()) << Qt::endl;
+
+    QTemporaryDir dir;
+    auto fileName = dir.filePath(QStringLiteral("synthetic.geojson"));
+    if (!dir.isValid() || !writeSyntheticMap(fileName)) {
+        out << "Cannot write synthetic map" << Qt::endl;
+        return 1;
+    }
+
+    auto* provider = GlobalObject::geoMapProvider();
+    QElapsedTimer timer;
+
+    // First run parses the GeoJSON file and writes the binary cache, second
+    // run reads the binary cache, third run only merges the compiled map
+    timer.start();
+    provider->fillAviationDataCache({fileName});
+    out << QStringLiteral("fillAviationDataCache, GeoJSON: %1 ms").arg(timer.elapsed()) << Qt::endl;
+    provider->_compiledAviationMaps.clear();
+    timer.start();
+    provider->fillAviationDataCache({fileName});
+    out << QStringLiteral("fillAviationDataCache, binary cache: %1 ms").arg(timer.elapsed()) << Qt::endl;
+    timer.start();
+    provider->fillAviationDataCache({fileName});
+    out << QStringLiteral("fillAviationDataCache, unchanged: %1 ms").arg(timer.elapsed()) << Qt::endl;
+    out << QStringLiteral("Waypoints: %1, airspaces: %2").arg(provider->aviationData()->waypoints().size()).arg(provider->aviationData()->airspaces().size()) << Qt::endl;
+
+    // Positions and search strings are generated before timing starts
+    QRandomGenerator generator(seed+1);
+    QVector<QGeoCoordinate> positions;
+    QStringList filters;
+    QStringList codes;
+    for(int i=0; i<numQueries; i++) {
+        positions.append(randomCoordinate(generator));
+        filters.append(QStringLiteral("Wpt %1").arg(generator.bounded(numWaypoints/10)));
+        codes.append(airfieldCode(generator.bounded(numWaypoints/5)));
+    }
+
+    auto measure = [&](const QString& name, const std::function<void(int)>& query) {
+        timer.start();
+        for(int i=0; i<numQueries; i++) {
+            query(i);
+        }
+        auto nsecs = timer.nsecsElapsed();
+        out << QStringLiteral("%1: %2 µs/call, %3 calls/s")
+               .arg(name, -24)
+               .arg(static_cast<double>(nsecs)/numQueries/1000.0, 0, 'f', 1)
+               .arg(qRound64(1e9*numQueries/static_cast<double>(qMax(nsecs, Q_INT64_C(1)))))
+            << Qt::endl;
+    };
+    measure(QStringLiteral("airspaces"), [&](int i) { provider->airspaces(positions[i]); });
+    measure(QStringLiteral("closestWaypoint"), [&](int i) { provider->closestWaypoint(positions[i], positions[(i+1)%numQueries]); });
+    measure(QStringLiteral("nearbyWaypointModel"), [&](int i) { delete provider->nearbyWaypointModel(positions[i], QStringLiteral("AD")); });
+    measure(QStringLiteral("filteredWaypointModel"), [&](int i) { delete provider->filteredWaypointModel(filters[i]); });
+    measure(QStringLiteral("findByID"), [&](int i) { provider->findByID(codes[i]); });
+
+    out << QStringLiteral("Peak memory after benchmark: %1 kB").arg(peakMemory()) << Qt::endl;
+    return 0;
+}
+
+
+auto GeoMaps::QueryBenchmark::writeSyntheticMap(const QString& fileName) -> bool
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QTextStream stream(&file);
+    stream.setRealNumberPrecision(8);
+    QRandomGenerator generator(seed);
+
+    stream << R"({"type":"FeatureCollection","features":[)";
+
+    // Every fifth waypoint is an airfield with an ICAO code, all others are
+    // reporting points
+    for(int i=0; i<numWaypoints; i++) {
+        auto coordinate = randomCoordinate(generator);
+        if (i > 0) {
+            stream << ',';
+        }
+        stream << R"({"type":"Feature","geometry":{"type":"Point","coordinates":[)" << coordinate.longitude() << ',' << coordinate.latitude() << "]},";
+        if (i%5 == 0) {
+            stream << R"("properties":{"TYP":"AD","CAT":"AD-PAVED","COD":")" << airfieldCode(i/5) << R"(","ELE":)" << generator.bounded(3000)
+                   << R"(,"NAM":"Airfield )" << i << R"("}})";
+        } else {
+            stream << R"("properties":{"TYP":"WP","CAT":"WP","NAM":"Wpt )" << i << R"("}})";
+        }
+    }
+
+    // Airspaces are regular polygons with 32 vertices and radii between 5km
+    // and 40km
+    const QStringList categories {"CTR", "D", "R", "TMZ", "GLD"};
+    for(int i=0; i<numAirspaces; i++) {
+        auto center = randomCoordinate(generator);
+        auto radius = 5000.0+generator.generateDouble()*35000.0;
+        stream << R"(,{"type":"Feature","geometry":{"type":"Polygon","coordinates":[[)";
+        for(int j=0; j<=32; j++) {
+            auto vertex = center.atDistanceAndAzimuth(radius, (j%32)*360.0/32.0);
+            if (j > 0) {
+                stream << ',';
+            }
+            stream << '[' << vertex.longitude() << ',' << vertex.latitude() << ']';
+        }
+        stream << R"(]]},"properties":{"CAT":")" << categories[i%categories.size()] << R"(","NAM":"Airspace )" << i
+               << R"(","TOP":")" << ((i%4 == 0) ? "FL100" : "FL65") << R"(","BOT":")" << ((i%2 == 0) ? "GND" : "2500 msl") << R"("}})";
+    }
+
+    stream << "]}";
+    stream.flush();
+    return stream.status() == QTextStream::Ok;
+}
+
+
+auto GeoMaps::QueryBenchmark::peakMemory() -> qint64
+{
+#if defined(Q_OS_UNIX)
+    rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#if defined(Q_OS_MACOS) || defined(Q_OS_IOS)
+    // Darwin reports bytes, all other systems report kilobytes
+    return usage.ru_maxrss/1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QString>
+
+
+namespace GeoMaps {
+
+/*! \brief Measures the performance of the GeoMapProvider on synthetic data
+ *
+ * This class generates a synthetic aviation map of continental size, with
+ * 50,000 airfields and waypoints and 10,000 airspaces, loads it into the
+ * GeoMapProvider and measures the throughput of the most important queries.
+ * The results, together with the peak memory usage of the process, are
+ * written to stdout. The benchmark is built as the separate executable
+ * "enroute-query-benchmark", which is not built by default, and is meant for
+ * developers who work on the map code.
+ *
+ * The random data is generated with a fixed seed, so that the results of
+ * different runs can be compared.
+ */
+
+class QueryBenchmark
+{
+public:
+    /*! \brief Run the benchmark
+     *
+     * This method replaces the aviation data of the GeoMapProvider by the
+     * synthetic data.
+     *
+     * @returns Exit code for the application, zero on success
+     */
+    static int run();
+
+private:
+    // Writes a synthetic map in GeoJSON format to the given file. Returns
+    // true on success.
+    static bool writeSyntheticMap(const QString& fileName);
+
+    // Peak resident set size of the process in kB, or -1 if unknown
+    static qint64 peakMemory();
+};
+
+};
@@ -0,0 +1,35 @@
+/***************************************************************************
+ *   Copyright (C) 2019-2021 by Stefan Kebekus                             *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QApplication>
+
+#include "geomaps/QueryBenchmark.h"
+
+
+auto main(int argc, char *argv[]) -> int
+{
+    // The GeoMapProvider needs an application object, and reads the settings
+    // of the app
+    QApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("Akaflieg Freiburg");
+    QCoreApplication::setOrganizationDomain("akaflieg_freiburg.de");
+    QCoreApplication::setApplicationName("enroute flight navigation");
+    return GeoMaps::QueryBenchmark::run();
+}
@@ -0,0 +1,165 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "RTree.h"
+
+
+void GeoMaps::RTree::Box::unite(const Box& other)
+{
+    minX = std::min(minX, other.minX);
+    minY = std::min(minY, other.minY);
+    maxX = std::max(maxX, other.maxX);
+    maxY = std::max(maxY, other.maxY);
+}
+
+
+GeoMaps::RTree::RTree(const std::vector<Box>& boxes)
+{
+    if (boxes.empty()) {
+        return;
+    }
+
+    // Pack the entries into leaf nodes
+    std::vector<int> order(boxes.size());
+    std::iota(order.begin(), order.end(), 0);
+    m_levels.push_back(pack(boxes, order));
+    m_entries = order;
+    m_entryBoxes.reserve(boxes.size());
+    for(auto idx : m_entries) {
+        m_entryBoxes.push_back(boxes[idx]);
+    }
+
+    // Pack nodes into parent nodes, until there is only one node left
+    while (m_levels.back().size() > 1) {
+        auto& level = m_levels.back();
+
+        std::vector<Box> levelBoxes;
+        levelBoxes.reserve(level.size());
+        for(const auto& node : level) {
+            levelBoxes.push_back(node.box);
+        }
+
+        std::vector<int> levelOrder(level.size());
+        std::iota(levelOrder.begin(), levelOrder.end(), 0);
+        auto parents = pack(levelBoxes, levelOrder);
+
+        // Re-arrange the current level in the order chosen by pack()
+        std::vector<Node> reordered;
+        reordered.reserve(level.size());
+        for(auto idx : levelOrder) {
+            reordered.push_back(level[idx]);
+        }
+        level = reordered;
+
+        m_levels.push_back(parents);
+    }
+}
+
+
+auto GeoMaps::RTree::pack(const std::vector<Box>& boxes, std::vector<int>& order) -> std::vector<Node>
+{
+    auto centerX = [&boxes](int i) { return boxes[i].minX + boxes[i].maxX; };
+    auto centerY = [&boxes](int i) { return boxes[i].minY + boxes[i].maxY; };
+
+    // Sort by x-coordinate of the center, cut into vertical slices and sort
+    // each slice by y-coordinate of the center
+    auto numNodes = static_cast<int>(std::ceil(static_cast<double>(order.size())/nodeCapacity));
+    auto numSlices = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(numNodes))));
+    auto sliceSize = numSlices*nodeCapacity;
+
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return centerX(a) < centerX(b); });
+    for(size_t sliceBegin = 0; sliceBegin < order.size(); sliceBegin += sliceSize) {
+        auto sliceEnd = std::min(order.size(), sliceBegin+sliceSize);
+        std::sort(order.begin()+sliceBegin, order.begin()+sliceEnd, [&](int a, int b) { return centerY(a) < centerY(b); });
+    }
+
+    // Group consecutive entries into nodes
+    std::vector<Node> result;
+    result.reserve(numNodes);
+    for(size_t begin = 0; begin < order.size(); begin += nodeCapacity) {
+        Node node;
+        node.begin = static_cast<int>(begin);
+        node.end = static_cast<int>(std::min(order.size(), begin+nodeCapacity));
+        node.box = boxes[order[begin]];
+        for(int i=node.begin+1; i<node.end; i++) {
+            node.box.unite(boxes[order[i]]);
+        }
+        result.push_back(node);
+    }
+    return result;
+}
+
+
+template<typename Predicate> auto GeoMaps::RTree::queryInternal(Predicate matches) const -> std::vector<int>
+{
+    std::vector<int> result;
+    if (m_levels.empty()) {
+        return result;
+    }
+
+    // Stack of (level, node index) pairs that still need to be visited
+    std::vector<std::pair<int,int>> stack;
+    stack.reserve(64);
+    auto topLevel = static_cast<int>(m_levels.size())-1;
+    for(int i=0; i<static_cast<int>(m_levels[topLevel].size()); i++) {
+        stack.emplace_back(topLevel, i);
+    }
+
+    while (!stack.empty()) {
+        auto [level, index] = stack.back();
+        stack.pop_back();
+
+        const auto& node = m_levels[level][index];
+        if (!matches(node.box)) {
+            continue;
+        }
+
+        if (level == 0) {
+            for(int i=node.begin; i<node.end; i++) {
+                if (matches(m_entryBoxes[i])) {
+                    result.push_back(m_entries[i]);
+                }
+            }
+            continue;
+        }
+
+        for(int i=node.begin; i<node.end; i++) {
+            stack.emplace_back(level-1, i);
+        }
+    }
+
+    return result;
+}
+
+
+auto GeoMaps::RTree::query(double x, double y) const -> std::vector<int>
+{
+    return queryInternal([x, y](const Box& box) { return box.contains(x, y); });
+}
+
+
+auto GeoMaps::RTree::query(const Box& box) const -> std::vector<int>
+{
+    return queryInternal([&box](const Box& other) { return box.intersects(other); });
+}
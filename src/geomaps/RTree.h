@@ -0,0 +1,170 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+
+namespace GeoMaps {
+
+/*! \brief Static R-tree over axis-aligned bounding boxes
+ *
+ * This class implements a read-only R-tree, bulk-loaded with the
+ * Sort-Tile-Recursive (STR) algorithm. The tree is meant to index objects with
+ * a geographic extent, such as airspaces. Boxes are given in degrees, with the
+ * x-coordinate holding the longitude and the y-coordinate holding the latitude.
+ *
+ * Entries are identified by their index in the vector passed to the
+ * constructor. Queries return the indices of all entries whose bounding box
+ * matches the query; it is up to the caller to perform exact tests on the
+ * candidates.
+ *
+ * Once constructed, the tree is never modified. It is therefore safe to query
+ * the same instance from several threads at the same time.
+ */
+
+class RTree
+{
+public:
+    /*! \brief Axis-aligned bounding box */
+    struct Box
+    {
+        /*! \brief Minimal x-coordinate (longitude) */
+        double minX {0.0};
+
+        /*! \brief Minimal y-coordinate (latitude) */
+        double minY {0.0};
+
+        /*! \brief Maximal x-coordinate (longitude) */
+        double maxX {0.0};
+
+        /*! \brief Maximal y-coordinate (latitude) */
+        double maxY {0.0};
+
+        /*! \brief Check if a point is contained in the box
+         *
+         * @param x x-coordinate of the point
+         *
+         * @param y y-coordinate of the point
+         *
+         * @returns True if the point lies inside the box or on its boundary
+         */
+        bool contains(double x, double y) const
+        {
+            return (x >= minX) && (x <= maxX) && (y >= minY) && (y <= maxY);
+        }
+
+        /*! \brief Check if two boxes intersect
+         *
+         * @param other Other box
+         *
+         * @returns True if the boxes have at least one point in common
+         */
+        bool intersects(const Box& other) const
+        {
+            return (other.minX <= maxX) && (other.maxX >= minX) && (other.minY <= maxY) && (other.maxY >= minY);
+        }
+
+        /*! \brief Enlarge box so that it contains another box
+         *
+         * @param other Other box
+         */
+        void unite(const Box& other);
+    };
+
+    /*! \brief Constructs an empty tree */
+    RTree() = default;
+
+    /*! \brief Constructs a tree and bulk-loads it with the STR algorithm
+     *
+     * @param boxes Bounding boxes of the entries. Entries are identified by
+     * their index in this vector.
+     */
+    explicit RTree(const std::vector<Box>& boxes);
+
+    /*! \brief Check if the tree is empty
+     *
+     * @returns True if the tree holds no entries
+     */
+    bool isEmpty() const
+    {
+        return m_entries.empty();
+    }
+
+    /*! \brief Point query
+     *
+     * @param x x-coordinate of the point
+     *
+     * @param y y-coordinate of the point
+     *
+     * @returns Indices of all entries whose bounding box contains the point, in
+     * unspecified order
+     */
+    std::vector<int> query(double x, double y) const;
+
+    /*! \brief Box query
+     *
+     * @param box Query box
+     *
+     * @returns Indices of all entries whose bounding box intersects the query
+     * box, in unspecified order
+     */
+    std::vector<int> query(const Box& box) const;
+
+    /*! \brief Number of entries
+     *
+     * @returns Number of entries in the tree
+     */
+    int size() const
+    {
+        return static_cast<int>(m_entries.size());
+    }
+
+private:
+    // Maximal number of children per node
+    static constexpr int nodeCapacity = 16;
+
+    // A node of the tree. On the lowest level, [begin, end) are indices into
+    // m_entries, on all other levels they are indices into the level below.
+    struct Node
+    {
+        Box box;
+        int begin {0};
+        int end {0};
+    };
+
+    // Packs a sorted list of boxes into nodes, using the STR algorithm.
+    // The vector 'order' is permuted.
+    static std::vector<Node> pack(const std::vector<Box>& boxes, std::vector<int>& order);
+
+    // Generic query method. The predicate decides if a box matches.
+    template<typename Predicate> std::vector<int> queryInternal(Predicate matches) const;
+
+    // Entries, in leaf order, and their bounding boxes
+    std::vector<int> m_entries;
+    std::vector<Box> m_entryBoxes;
+
+    // Levels of the tree. m_levels.front() is the lowest level of nodes,
+    // m_levels.back() contains the root nodes.
+    std::vector<std::vector<Node>> m_levels;
+};
+
+};
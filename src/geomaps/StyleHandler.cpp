@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QRegularExpression>
+
+#include <qhttpengine/socket.h>
+
+#include "StyleHandler.h"
+#include "TileHandler.h"
+
+
+GeoMaps::StyleHandler::StyleHandler(QObject *parent)
+    : Handler(parent),
+      _style("{}"),
+      _styleETag(TileHandler::eTag(_style))
+{
+}
+
+
+auto GeoMaps::StyleHandler::setStyle(const QByteArray& style) -> bool
+{
+    if (style == _style) {
+        return false;
+    }
+    _style = style;
+    _styleETag = TileHandler::eTag(_style);
+    _version++;
+    return true;
+}
+
+
+void GeoMaps::StyleHandler::process(QHttpEngine::Socket *socket, const QString &path)
+{
+    QRegularExpression stylePattern("^/?[0-9]+\\.json$");
+    if (stylePattern.match(path).hasMatch()) {
+        TileHandler::writeJSON(socket, _style, _styleETag);
+        return;
+    }
+
+    // Unknown request, responding with 'not found'
+    socket->writeError(QHttpEngine::Socket::NotFound);
+    socket->close();
+}
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <qhttpengine/handler.h>
+
+
+namespace GeoMaps {
+
+/*! \brief Implementation of QHttpEngine::Handler that serves the map style
+
+  This handler serves a Mapbox style file from memory, so that no temporary
+  file needs to be written when the style changes. Every change of the style
+  increments a version number, which is part of the URL. The handler answers
+  requests of the form "<version>.json"; requests for older versions are
+  answered with the current style, as the map will load the new URL shortly.
+  Responses carry an entity tag, so that the renderer can revalidate its
+  cached copy without downloading the style again.
+*/
+
+class StyleHandler : public QHttpEngine::Handler
+{
+  Q_OBJECT
+
+public:
+  /*! \brief Create a new style handler
+
+    The handler serves an empty style until setStyle() is called.
+
+    @param parent The standard QObject parent
+  */
+  explicit StyleHandler(QObject *parent = nullptr);
+
+  // Destructor
+  ~StyleHandler() override = default;
+
+  /*! \brief Set the style
+
+    If the style differs from the current one, the version number is
+    incremented.
+
+    @param style Mapbox style, in JSON format
+
+    @returns True if the style has changed
+  */
+  bool setStyle(const QByteArray& style);
+
+  /*! \brief Version number of the style
+
+    @returns Version number, which is zero as long as no style has been set
+  */
+  quint64 version() const {return _version;}
+
+protected:
+  /*
+   * @brief Reimplementation of
+   * [Handler::process()](QHttpEngine::Handler::process)
+   */
+  void process(QHttpEngine::Socket *socket, const QString &path) override;
+
+private:
+  Q_DISABLE_COPY_MOVE(StyleHandler)
+
+  QByteArray _style;
+  QByteArray _styleETag;
+  quint64 _version {0};
+};
+
+};
@@ -0,0 +1,200 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QDebug>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "GlobalObject.h"
+#include "Metrics.h"
+#include "Terrain.h"
+#include "navigation/Navigator.h"
+
+
+namespace {
+
+// Meters per degree of latitude
+constexpr double metersPerDegree = 111319.49;
+
+// Number of samples of the look-ahead profile, including the position of
+// the fix
+constexpr int sampleCount = static_cast<int>(GeoMaps::Terrain::lookAhead/GeoMaps::Terrain::sampleInterval)+1;
+
+} // namespace
+
+
+GeoMaps::Terrain::Terrain(QObject* parent)
+    : QObject(parent),
+      m_rasters(std::make_shared<const std::vector<std::shared_ptr<const TerrainRaster>>>()),
+      m_latitudes(sampleCount),
+      m_longitudes(sampleCount)
+{
+}
+
+
+auto GeoMaps::Terrain::elevation(const QGeoCoordinate& position) const -> Units::Distance
+{
+    if (!position.isValid()) {
+        return {};
+    }
+    auto latitude = position.latitude();
+    auto longitude = position.longitude();
+    double result = NAN;
+    elevations(&latitude, &longitude, 1, &result);
+    return Units::Distance::fromM(result);
+}
+
+
+void GeoMaps::Terrain::elevations(const double* latitudes, const double* longitudes, int count, double* result) const
+{
+    std::fill(result, result+count, std::numeric_limits<double>::quiet_NaN());
+
+    // Rasters do not overlap, except along their edges, where they agree. Each
+    // raster therefore sets only the entries that it covers.
+    auto rasters = std::atomic_load(&m_rasters);
+    for(const auto& raster : *rasters) {
+        raster->elevations(latitudes, longitudes, count, result);
+    }
+}
+
+
+auto GeoMaps::Terrain::lookAheadProfile() const -> QVariantList
+{
+    QVariantList result;
+    result.reserve(static_cast<int>(m_profile.size()));
+    for(auto elevationInM : m_profile) {
+        result.append(QVariant::fromValue(Units::Distance::fromM(elevationInM)));
+    }
+    return result;
+}
+
+
+void GeoMaps::Terrain::removeFile(const QString& localFileName)
+{
+    auto rasters = std::atomic_load(&m_rasters);
+    auto newRasters = std::make_shared<std::vector<std::shared_ptr<const TerrainRaster>>>();
+    for(const auto& raster : *rasters) {
+        if (raster->fileName() != localFileName) {
+            newRasters->push_back(raster);
+        }
+    }
+    std::atomic_store(&m_rasters, std::shared_ptr<const std::vector<std::shared_ptr<const TerrainRaster>>>(newRasters));
+}
+
+
+void GeoMaps::Terrain::setDownloadables(const QVector<QPointer<DataManagement::Downloadable>>& downloadables)
+{
+    auto rasters = std::atomic_load(&m_rasters);
+    auto newRasters = std::make_shared<std::vector<std::shared_ptr<const TerrainRaster>>>();
+    for(const auto& downloadable : downloadables) {
+        if (downloadable.isNull()) {
+            continue;
+        }
+        connect(downloadable, &DataManagement::Downloadable::aboutToChangeFile, this, &GeoMaps::Terrain::removeFile, Qt::UniqueConnection);
+
+        auto fileName = downloadable->fileName();
+        auto existing = std::find_if(rasters->begin(), rasters->end(), [&fileName](const auto& raster) { return raster->fileName() == fileName; });
+        if (existing != rasters->end()) {
+            newRasters->push_back(*existing);
+            continue;
+        }
+        auto raster = std::make_shared<const TerrainRaster>(fileName);
+        if (!raster->isValid()) {
+            qWarning() << "Terrain map" << fileName << "is invalid";
+            continue;
+        }
+        newRasters->push_back(raster);
+    }
+    std::atomic_store(&m_rasters, std::shared_ptr<const std::vector<std::shared_ptr<const TerrainRaster>>>(newRasters));
+}
+
+
+void GeoMaps::Terrain::setPositionInfo(const Positioning::PositionInfo& info)
+{
+    METRICS_TIME_SCOPE("terrain/setPositionInfo");
+
+    Units::Distance newTerrainElevation;
+    Units::Distance newHeightAboveTerrain;
+    bool newTerrainWarning = false;
+    bool hadProfile = !m_profile.empty();
+
+    if (!info.isValid()) {
+        m_profile.clear();
+    } else {
+        // Sample the projected track. The aircraft is considered stationary
+        // if the track is unknown, so that only the current position is
+        // checked.
+        auto coordinate = info.coordinate();
+        auto groundSpeed = info.groundSpeed().toMPS();
+        auto track = info.trueTrack().toRAD();
+        auto vx = 0.0;
+        auto vy = 0.0;
+        if (std::isfinite(groundSpeed) && std::isfinite(track)) {
+            vx = groundSpeed*std::sin(track);
+            vy = groundSpeed*std::cos(track);
+        }
+        auto sampleS = std::chrono::duration<double>(sampleInterval).count();
+        auto metersPerDegreeLongitude = metersPerDegree*qMax(qCos(qDegreesToRadians(coordinate.latitude())), 0.01);
+        for(int k=0; k<sampleCount; k++) {
+            m_latitudes[k] = coordinate.latitude() + vy*k*sampleS/metersPerDegree;
+            m_longitudes[k] = coordinate.longitude() + vx*k*sampleS/metersPerDegreeLongitude;
+        }
+        m_profile.resize(sampleCount);
+        elevations(m_latitudes.data(), m_longitudes.data(), sampleCount, m_profile.data());
+
+        newTerrainElevation = Units::Distance::fromM(m_profile[0]);
+        auto altitude = info.trueAltitude();
+        newHeightAboveTerrain = altitude-newTerrainElevation;
+
+        // Predicted clearance; samples without terrain data never warn
+        auto verticalSpeed = info.verticalSpeed().toMPS();
+        if (!std::isfinite(verticalSpeed)) {
+            verticalSpeed = 0.0;
+        }
+        if (altitude.isFinite() && GlobalObject::navigator()->isInFlight()) {
+            for(int k=0; k<sampleCount; k++) {
+                auto clearance = altitude.toM() + verticalSpeed*k*sampleS - m_profile[k];
+                if (clearance < minimumClearance.toM()) {
+                    newTerrainWarning = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // NaN compares unequal to itself, so check finiteness first
+    if ((newTerrainElevation.isFinite() != m_terrainElevation.isFinite()) || (newTerrainElevation.isFinite() && (newTerrainElevation != m_terrainElevation))) {
+        m_terrainElevation = newTerrainElevation;
+        emit terrainElevationChanged();
+    }
+    if ((newHeightAboveTerrain.isFinite() != m_heightAboveTerrain.isFinite()) || (newHeightAboveTerrain.isFinite() && (newHeightAboveTerrain != m_heightAboveTerrain))) {
+        m_heightAboveTerrain = newHeightAboveTerrain;
+        emit heightAboveTerrainChanged();
+    }
+    if (newTerrainWarning != m_terrainWarning) {
+        m_terrainWarning = newTerrainWarning;
+        emit terrainWarningChanged();
+    }
+    if (hadProfile || !m_profile.empty()) {
+        emit lookAheadProfileChanged();
+    }
+}
@@ -0,0 +1,232 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QGeoCoordinate>
+#include <QPointer>
+#include <QVariantList>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "TerrainRaster.h"
+#include "dataManagement/Downloadable.h"
+#include "positioning/PositionInfo.h"
+#include "units/Distance.h"
+
+using namespace std::chrono_literals;
+
+
+namespace GeoMaps {
+
+/*! \brief Terrain elevation, height above terrain and terrain awareness
+ *
+ *  This class reads the terrain maps of the DataManager, which are files in
+ *  the format of TerrainRaster. The files are memory-mapped and never loaded
+ *  into RAM as a whole.
+ *
+ *  With every position fix, the class computes the terrain elevation under
+ *  the aircraft and the height above terrain. It also samples the terrain
+ *  along the projected track, assuming that the aircraft keeps its current
+ *  ground speed and track, at intervals of sampleInterval up to lookAhead.
+ *  If the aircraft is in flight and the predicted altitude at any sample,
+ *  assuming constant vertical speed, exceeds the terrain by less than
+ *  minimumClearance, the property terrainWarning is set. All samples of a fix
+ *  are looked up in one batch.
+ *
+ *  The methods elevation() and elevations() are thread-safe.
+ */
+
+class Terrain : public QObject {
+    Q_OBJECT
+
+public:
+    /*! \brief Default constructor
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit Terrain(QObject* parent = nullptr);
+
+    // Standard destructor
+    ~Terrain() override = default;
+
+    /*! \brief Time span of the look-ahead profile */
+    static constexpr auto lookAhead = 60s;
+
+    /*! \brief Time between two samples of the look-ahead profile */
+    static constexpr auto sampleInterval = 2s;
+
+    /*! \brief Vertical distance to terrain below which a warning is issued */
+    static constexpr Units::Distance minimumClearance = Units::Distance::fromFT(500.0);
+
+
+    //
+    // Properties
+    //
+
+    /*! \brief Height of the aircraft above terrain
+     *
+     *  This property holds the true altitude of the latest position fix, minus
+     *  the terrain elevation. It is NaN if either value is unknown.
+     */
+    Q_PROPERTY(Units::Distance heightAboveTerrain READ heightAboveTerrain NOTIFY heightAboveTerrainChanged)
+
+    /*! \brief Terrain along the projected track
+     *
+     *  This property holds a list of Units::Distance, with the terrain
+     *  elevation at the position of the latest fix, followed by the terrain
+     *  elevations along the projected track, at intervals of sampleInterval.
+     *  Entries are NaN where no terrain data is available. The list is empty
+     *  if there is no valid position.
+     */
+    Q_PROPERTY(QVariantList lookAheadProfile READ lookAheadProfile NOTIFY lookAheadProfileChanged)
+
+    /*! \brief Terrain elevation under the aircraft
+     *
+     *  This property holds the terrain elevation at the position of the latest
+     *  fix, or NaN if unknown.
+     */
+    Q_PROPERTY(Units::Distance terrainElevation READ terrainElevation NOTIFY terrainElevationChanged)
+
+    /*! \brief Terrain warning
+     *
+     *  This property is true if the aircraft is in flight and expected to
+     *  come closer to terrain than minimumClearance within lookAhead.
+     */
+    Q_PROPERTY(bool terrainWarning READ terrainWarning NOTIFY terrainWarningChanged)
+
+
+    //
+    // Getter Methods
+    //
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property heightAboveTerrain
+     */
+    Units::Distance heightAboveTerrain() const
+    {
+        return m_heightAboveTerrain;
+    }
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property lookAheadProfile
+     */
+    QVariantList lookAheadProfile() const;
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property terrainElevation
+     */
+    Units::Distance terrainElevation() const
+    {
+        return m_terrainElevation;
+    }
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property terrainWarning
+     */
+    bool terrainWarning() const
+    {
+        return m_terrainWarning;
+    }
+
+
+    //
+    // Methods
+    //
+
+    /*! \brief Terrain elevation at a point
+     *
+     *  @param position Point
+     *
+     *  @returns Terrain elevation above MSL, or NaN if no terrain data is
+     *  available
+     */
+    Q_INVOKABLE Units::Distance elevation(const QGeoCoordinate& position) const;
+
+    /*! \brief Terrain elevations at many points
+     *
+     *  @param latitudes Latitudes of the points, in degrees
+     *
+     *  @param longitudes Longitudes of the points, in degrees
+     *
+     *  @param count Number of points
+     *
+     *  @param result Array of size count. For every point, this method sets
+     *  the corresponding entry to the terrain elevation in meters above MSL, or
+     *  to NaN if no terrain data is available.
+     */
+    void elevations(const double* latitudes, const double* longitudes, int count, double* result) const;
+
+public slots:
+    /*! \brief Set the terrain maps
+     *
+     *  @param downloadables Downloadables whose files are terrain rasters.
+     *  Rasters of files that are already mapped are reused.
+     */
+    void setDownloadables(const QVector<QPointer<DataManagement::Downloadable>>& downloadables);
+
+    /*! \brief Update the state of ownship
+     *
+     *  @param info Current position info of ownship
+     */
+    void setPositionInfo(const Positioning::PositionInfo& info);
+
+signals:
+    /*! \brief Notification signal for the property with the same name */
+    void heightAboveTerrainChanged();
+
+    /*! \brief Notification signal for the property with the same name */
+    void lookAheadProfileChanged();
+
+    /*! \brief Notification signal for the property with the same name */
+    void terrainElevationChanged();
+
+    /*! \brief Notification signal for the property with the same name */
+    void terrainWarningChanged();
+
+private:
+    Q_DISABLE_COPY_MOVE(Terrain)
+
+    // Unmaps a file, before the Downloadable changes it
+    void removeFile(const QString& localFileName);
+
+    // Current set of rasters. This pointer is accessed by several threads and
+    // must only be read and written with std::atomic_load and
+    // std::atomic_store.
+    std::shared_ptr<const std::vector<std::shared_ptr<const TerrainRaster>>> m_rasters;
+
+    // Results for the latest position fix
+    Units::Distance m_heightAboveTerrain;
+    Units::Distance m_terrainElevation;
+    bool m_terrainWarning {false};
+
+    // Scratch arrays for setPositionInfo(). The entry with index zero is the
+    // position of the fix; m_profile holds the results of the latest lookup.
+    std::vector<double> m_latitudes;
+    std::vector<double> m_longitudes;
+    std::vector<double> m_profile;
+};
+
+}
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QtEndian>
+
+#include "TerrainRaster.h"
+
+
+namespace {
+
+// Size of the header, before the table of tile offsets
+const qint64 headerSize = 40;
+
+auto readLayout(const uchar* data, DataManagement::TiledRaster::Layout& layout) -> bool
+{
+    layout.west = qFromLittleEndian<double>(data+8);
+    layout.north = qFromLittleEndian<double>(data+16);
+    layout.samplesPerDegree = qFromLittleEndian<quint32>(data+24);
+    layout.tileSize = qFromLittleEndian<quint32>(data+28);
+    layout.tileColumns = qFromLittleEndian<quint32>(data+32);
+    layout.tileRows = qFromLittleEndian<quint32>(data+36);
+    return true;
+}
+
+}
+
+
+GeoMaps::TerrainRaster::TerrainRaster(const QString& fileName)
+    : m_raster(fileName, "ENTR", headerSize, true, readLayout)
+{
+}
+
+
+auto GeoMaps::TerrainRaster::bounds() const -> RTree::Box
+{
+    const auto& layout = m_raster.layout();
+    auto tileSizeInDegrees = static_cast<double>(layout.tileSize)/layout.samplesPerDegree;
+    return {layout.west, layout.north-layout.tileRows*tileSizeInDegrees, layout.west+layout.tileColumns*tileSizeInDegrees, layout.north};
+}
+
+
+void GeoMaps::TerrainRaster::elevations(const double* latitudes, const double* longitudes, int count, double* result) const
+{
+    if (!isValid()) {
+        return;
+    }
+
+    const auto& layout = m_raster.layout();
+    auto samplesPerDegree = static_cast<double>(layout.samplesPerDegree);
+    auto width = static_cast<double>(layout.tileColumns)*layout.tileSize;
+    auto height = static_cast<double>(layout.tileRows)*layout.tileSize;
+    for(int i=0; i<count; i++) {
+        // Position in samples, measured from the north-west corner. Points
+        // outside the raster, including NaN, are discarded.
+        auto x = (longitudes[i]-layout.west)*samplesPerDegree;
+        auto y = (layout.north-latitudes[i])*samplesPerDegree;
+        if (!((x >= 0.0) && (x < width) && (y >= 0.0) && (y < height))) {
+            continue;
+        }
+
+        DataManagement::TiledRaster::Cell cell;
+        if (!m_raster.cell(x, y, cell)) {
+            continue;
+        }
+        if ((cell.northWest == noData) || (cell.northEast == noData) || (cell.southWest == noData) || (cell.southEast == noData)) {
+            continue;
+        }
+        result[i] = cell.interpolate();
+    }
+}
@@ -0,0 +1,115 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include "RTree.h"
+#include "dataManagement/TiledRaster.h"
+
+
+namespace GeoMaps {
+
+/*! \brief Memory-mapped raster of terrain elevations
+ *
+ * This class reads terrain elevations from a file in the tiled format of
+ * DataManagement::TiledRaster, with magic "ENTR" and the following header.
+ *
+ * | Offset | Type      | Content                                              |
+ * |--------|-----------|------------------------------------------------------|
+ * | 0      | char[4]   | Magic "ENTR"                                         |
+ * | 4      | quint32   | Format version, currently 1                          |
+ * | 8      | double    | Longitude of the westernmost samples, in degrees     |
+ * | 16     | double    | Latitude of the northernmost samples, in degrees     |
+ * | 24     | quint32   | Number of samples per degree                         |
+ * | 28     | quint32   | Number of cells along each edge of a tile            |
+ * | 32     | quint32   | Number of tile columns                               |
+ * | 36     | quint32   | Number of tile rows                                  |
+ * | 40     | quint64[] | Offsets of the tiles in the file, row by row from the north |
+ *
+ * Samples are elevations in meters above MSL. Tiles without data, for
+ * instance over open sea, are not stored. Samples without data hold the
+ * value noData.
+ *
+ * Once constructed, the instance is never modified. It can therefore be
+ * read from several threads at the same time.
+ */
+
+class TerrainRaster
+{
+public:
+    /*! \brief Sample value that indicates missing data */
+    static constexpr qint16 noData = -32768;
+
+    /*! \brief Maps a file
+     *
+     * @param fileName Name of a file in the format described above
+     */
+    explicit TerrainRaster(const QString& fileName);
+
+    /*! \brief Area covered by the raster
+     *
+     * @returns Bounding box in degrees, in the format used by RTree
+     */
+    RTree::Box bounds() const;
+
+    /*! \brief Terrain elevations at many points
+     *
+     * This method interpolates bilinearly between the four samples that
+     * surround each point. The loop over the points is free of branches, apart
+     * from the lookup of the tile.
+     *
+     * @param latitudes Latitudes of the points, in degrees
+     *
+     * @param longitudes Longitudes of the points, in degrees
+     *
+     * @param count Number of points
+     *
+     * @param result Array of size count. For every point that lies within the
+     * raster and where data is available, this method sets the corresponding
+     * entry to the elevation in meters above MSL. All other entries are left
+     * untouched, so that several rasters can be queried in turn.
+     */
+    void elevations(const double* latitudes, const double* longitudes, int count, double* result) const;
+
+    /*! \brief Name of the file
+     *
+     * @returns File name, as passed to the constructor
+     */
+    QString fileName() const
+    {
+        return m_raster.fileName();
+    }
+
+    /*! \brief Check if the file could be mapped and is well-formed
+     *
+     * @returns True if the raster can be queried
+     */
+    bool isValid() const
+    {
+        return m_raster.isValid();
+    }
+
+private:
+    Q_DISABLE_COPY_MOVE(TerrainRaster)
+
+    DataManagement::TiledRaster m_raster;
+};
+
+};
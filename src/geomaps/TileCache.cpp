@@ -0,0 +1,133 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QMutexLocker>
+
+#include "TileCache.h"
+
+
+namespace GeoMaps {
+
+uint qHash(const TileCache::Key& key, uint seed)
+{
+    return ::qHash(key.tileSet, seed) ^ ::qHash((quint64(key.z) << 48) | (quint64(key.x) << 24) | quint64(key.y), seed);
+}
+
+}
+
+
+GeoMaps::TileCache::TileCache(qint64 maxSize)
+    : m_maxSize(maxSize)
+{
+}
+
+
+void GeoMaps::TileCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_index.clear();
+    m_entries.clear();
+    m_size = 0;
+}
+
+
+auto GeoMaps::TileCache::find(const QString& tileSet, quint32 z, quint32 x, quint32 y, QByteArray& data) -> bool
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_index.constFind({tileSet, z, x, y});
+    if (it == m_index.constEnd()) {
+        return false;
+    }
+
+    // Move entry to the front
+    m_entries.splice(m_entries.begin(), m_entries, it.value());
+    data = it.value()->data;
+    return true;
+}
+
+
+void GeoMaps::TileCache::insert(const QString& tileSet, quint32 z, quint32 x, quint32 y, const QByteArray& data)
+{
+    QMutexLocker locker(&m_mutex);
+    if (data.size() > m_maxSize) {
+        return;
+    }
+
+    Key key {tileSet, z, x, y};
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        m_size -= it.value()->data.size();
+        m_entries.erase(it.value());
+        m_index.erase(it);
+    }
+
+    m_entries.push_front({key, data});
+    m_index.insert(key, m_entries.begin());
+    m_size += data.size();
+    shrink();
+}
+
+
+auto GeoMaps::TileCache::maxSize() const -> qint64
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxSize;
+}
+
+
+void GeoMaps::TileCache::removeTileSet(const QString& tileSet)
+{
+    QMutexLocker locker(&m_mutex);
+    for(auto it = m_entries.begin(); it != m_entries.end(); ) {
+        if (it->key.tileSet != tileSet) {
+            ++it;
+            continue;
+        }
+        m_size -= it->data.size();
+        m_index.remove(it->key);
+        it = m_entries.erase(it);
+    }
+}
+
+
+void GeoMaps::TileCache::setMaxSize(qint64 maxSize)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxSize = maxSize;
+    shrink();
+}
+
+
+void GeoMaps::TileCache::shrink()
+{
+    while ((m_size > m_maxSize) && !m_entries.empty()) {
+        const auto& entry = m_entries.back();
+        m_size -= entry.data.size();
+        m_index.remove(entry.key);
+        m_entries.pop_back();
+    }
+}
+
+
+auto GeoMaps::TileCache::size() const -> qint64
+{
+    QMutexLocker locker(&m_mutex);
+    return m_size;
+}
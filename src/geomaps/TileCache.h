@@ -0,0 +1,154 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <list>
+
+
+namespace GeoMaps {
+
+/*! \brief Size-bounded LRU cache for tile data
+ *
+ * This class caches tile data, exactly as it is sent to clients (for tiles
+ * from MBTiles files, this is gzip-compressed data). Tiles are identified by
+ * the name of the tile set, and by zoom level, column and row. The cache
+ * holds at most maxSize() bytes of tile data. If the limit is exceeded, the
+ * tiles that were least recently used are dropped.
+ *
+ * All methods of this class are thread-safe.
+ */
+
+class TileCache
+{
+public:
+    /*! \brief Constructs an empty cache
+     *
+     * @param maxSize Maximal size of the cached data, in bytes
+     */
+    explicit TileCache(qint64 maxSize = 32*1024*1024);
+
+    /*! \brief Removes all tiles */
+    void clear();
+
+    /*! \brief Find a tile
+     *
+     * If the tile is found, it is marked as the most recently used tile.
+     *
+     * @param tileSet Name of the tile set
+     *
+     * @param z Zoom level
+     *
+     * @param x Column
+     *
+     * @param y Row, counted from the north
+     *
+     * @param data If the tile is found, its data is stored here
+     *
+     * @returns True if the tile is found in the cache
+     */
+    bool find(const QString& tileSet, quint32 z, quint32 x, quint32 y, QByteArray& data);
+
+    /*! \brief Insert a tile
+     *
+     * If the tile is already in the cache, its data is replaced. Tiles larger
+     * than maxSize() are not cached.
+     *
+     * @param tileSet Name of the tile set
+     *
+     * @param z Zoom level
+     *
+     * @param x Column
+     *
+     * @param y Row, counted from the north
+     *
+     * @param data Tile data
+     */
+    void insert(const QString& tileSet, quint32 z, quint32 x, quint32 y, const QByteArray& data);
+
+    /*! \brief Maximal size of the cached data
+     *
+     * @returns Maximal size of the cached data, in bytes
+     */
+    qint64 maxSize() const;
+
+    /*! \brief Removes all tiles of a tile set
+     *
+     * @param tileSet Name of the tile set
+     */
+    void removeTileSet(const QString& tileSet);
+
+    /*! \brief Set maximal size of the cached data
+     *
+     * If the cache holds more data than allowed, the tiles that were least
+     * recently used are dropped.
+     *
+     * @param maxSize Maximal size of the cached data, in bytes
+     */
+    void setMaxSize(qint64 maxSize);
+
+    /*! \brief Size of the cached data
+     *
+     * @returns Total size of the cached tile data, in bytes
+     */
+    qint64 size() const;
+
+private:
+    // Identifies a tile
+    struct Key {
+        QString tileSet;
+        quint32 z;
+        quint32 x;
+        quint32 y;
+
+        bool operator==(const Key& other) const
+        {
+            return (z == other.z) && (x == other.x) && (y == other.y) && (tileSet == other.tileSet);
+        }
+    };
+    friend uint qHash(const Key& key, uint seed);
+
+    struct Entry {
+        Key key;
+        QByteArray data;
+    };
+
+    // Drops least recently used entries until the size limit is met. The
+    // mutex must be locked when this method is called.
+    void shrink();
+
+    // Protects all members below
+    mutable QMutex m_mutex;
+
+    // Entries, the most recently used first
+    std::list<Entry> m_entries;
+
+    // Index into m_entries
+    QHash<Key, std::list<Entry>::iterator> m_index;
+
+    qint64 m_size {0};
+    qint64 m_maxSize;
+};
+
+};
@@ -18,21 +18,27 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include <QCryptographicHash>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QRegularExpression>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QtEndian>
+#include <algorithm>
+#include <utility>
 
 #include <qhttpengine/socket.h>
 
+#include "Metrics.h"
+#include "Profiler.h"
 #include "TileHandler.h"
 #include "dataManagement/Downloadable.h"
 
-GeoMaps::TileHandler::TileHandler(const QVector<QPointer<DataManagement::Downloadable>>& mbtileFiles, const QString& baseURL, QObject *parent)
-    : Handler(parent)
+GeoMaps::TileHandler::TileHandler(const QVector<QPointer<DataManagement::Downloadable>>& mbtileFiles, const QString& baseURL, TileCache* tileCache, QString tileSetName, QObject *parent)
+    : Handler(parent), tileCache(tileCache), tileSetName(std::move(tileSetName))
 {
     // Initialize with default values
     _name        = "empty";
@@ -45,55 +51,31 @@ GeoMaps::TileHandler::TileHandler(const QVector<QPointer<DataManagement::Downloa
     _tiles       = baseURL+"/{z}/{x}/{y}."+_format;
 
     // Go through mbtile files and find real values
+    QVector<MBTilesReader::Source> sources;
+    QStringList fileDescriptions;
     foreach (auto mbtileFile, mbtileFiles) {
         // Check that file really exists
         if (!QFile::exists(mbtileFile->fileName())) {
             hasDBError = true;
-            return;
+            break;
         }
         connect(mbtileFile, &DataManagement::Downloadable::aboutToChangeFile, this, &TileHandler::removeFile);
 
-        // Open database
+        // Open database. The connection is used only here, to read the
+        // metadata; the readers open their own connections.
         auto databaseConnectionName = baseURL+"-"+mbtileFile->fileName();
-        auto db = QSqlDatabase::addDatabase("QSQLITE", databaseConnectionName);
-        db.setDatabaseName(mbtileFile->fileName());
-        db.open();
-        if (db.isOpenError()) {
-            hasDBError = true;
-            return;
-        }
-        databaseConnections += databaseConnectionName;
-
-        // Read metadata from database
-        QSqlQuery query(db);
-        if (!query.exec("select name, value from metadata;")) {
-            hasDBError = true;
-            return;
-        }
-        while(query.next()) {
-            QString key = query.value(0).toString();
-            if (key == "name") {
-                _name = query.value(1).toString();
-            }
-            if (key == "format") {
-                _format= query.value(1).toString();
-            }
-            if (key == "description") {
-                _description = query.value(1).toString();
-            }
-            if (key == "version") {
-                _version = query.value(1).toString();
-            }
-            if (key == "attribution") {
-                _attribution = query.value(1).toString();
-            }
-            if (key == "maxzoom") {
-               _maxzoom = query.value(1).toInt();
-            }
-            if (key == "minzoom") {
-                _minzoom = query.value(1).toInt();
+        {
+            auto db = MBTilesReader::openDatabase(databaseConnectionName, mbtileFile->fileName());
+            if (db.isOpenError() || !readMetadata(db, sources, mbtileFile->fileName())) {
+                hasDBError = true;
             }
         }
+        QSqlDatabase::removeDatabase(databaseConnectionName);
+        if (hasDBError) {
+            break;
+        }
+        QFileInfo fileInfo(mbtileFile->fileName());
+        fileDescriptions += fileInfo.fileName()+"/"+QString::number(fileInfo.size())+"/"+QString::number(fileInfo.lastModified().toMSecsSinceEpoch());
         _tiles = baseURL+"/{z}/{x}/{y}."+_format;
 
         // Safety check
@@ -102,86 +84,283 @@ GeoMaps::TileHandler::TileHandler(const QVector<QPointer<DataManagement::Downloa
             _minzoom = -1;
         }
     }
+    _tileJSON = makeTileJSON();
+    _tileJSONETag = eTag(_tileJSON);
+
+    // Content key, independent of the order of the files
+    if (!hasDBError && !fileDescriptions.isEmpty()) {
+        std::sort(fileDescriptions.begin(), fileDescriptions.end());
+        auto hash = QCryptographicHash::hash(fileDescriptions.join("\n").toUtf8(), QCryptographicHash::Sha1);
+        _contentKey = qFromLittleEndian<quint64>(hash.constData());
+    }
+
+    // Start readers, each in its own thread
+    for(int i=0; i<numReaderThreads; i++) {
+        auto* thread = new QThread(this);
+        auto* reader = new MBTilesReader(sources, baseURL+"-"+QString::number(reinterpret_cast<quintptr>(this))+"-"+QString::number(i));
+        reader->moveToThread(thread);
+        connect(thread, &QThread::finished, reader, &QObject::deleteLater);
+        connect(reader, &MBTilesReader::tileRead, this, &TileHandler::onTileRead);
+        thread->start();
+        readers += reader;
+        readerThreads += thread;
+    }
+}
+
+
+auto GeoMaps::TileHandler::readMetadata(QSqlDatabase& db, QVector<MBTilesReader::Source>& sources, const QString& fileName) -> bool
+{
+    // Read metadata from database
+    QSqlQuery query(db);
+    if (!query.exec("select name, value from metadata;")) {
+        return false;
+    }
+    QString fileBounds;
+    int fileMinzoom = -1;
+    int fileMaxzoom = -1;
+    while(query.next()) {
+        QString key = query.value(0).toString();
+        if (key == "name") {
+            _name = query.value(1).toString();
+        }
+        if (key == "format") {
+            _format= query.value(1).toString();
+        }
+        if (key == "description") {
+            _description = query.value(1).toString();
+        }
+        if (key == "version") {
+            _version = query.value(1).toString();
+        }
+        if (key == "attribution") {
+            _attribution = query.value(1).toString();
+        }
+        if (key == "maxzoom") {
+           _maxzoom = query.value(1).toInt();
+           fileMaxzoom = _maxzoom;
+        }
+        if (key == "minzoom") {
+            _minzoom = query.value(1).toInt();
+            fileMinzoom = _minzoom;
+        }
+        if (key == "bounds") {
+            fileBounds = query.value(1).toString();
+        }
+    }
+
+    MBTilesReader::Source source;
+    source.fileName = fileName;
+    source.computeCoverage(fileBounds, fileMinzoom, fileMaxzoom);
+    sources += source;
+    return true;
 }
 
 
 GeoMaps::TileHandler::~TileHandler()
 {
-    foreach(auto databaseConnectionName, databaseConnections)
-        QSqlDatabase::removeDatabase(databaseConnectionName);
+    // Stop the threads. The readers are deleted in their threads, along with
+    // their database connections.
+    foreach(auto thread, readerThreads) {
+        thread->quit();
+    }
+    foreach(auto thread, readerThreads) {
+        thread->wait();
+    }
+
+    // Answer pending requests
+    foreach(auto request, pendingRequests) {
+        request.callback({});
+    }
 }
 
 
 void GeoMaps::TileHandler::removeFile(const QString& localFileName)
 {
-    QString connectionToRemove;
-    foreach(auto databaseConnectionName, databaseConnections) {
-        if (!databaseConnectionName.endsWith(localFileName)) {
-            continue;
+    foreach(auto* reader, readers) {
+        QMetaObject::invokeMethod(reader, [reader, localFileName]() { reader->closeFile(localFileName); }, Qt::BlockingQueuedConnection);
+    }
+
+    // Tiles of the file might still be in the cache
+    if (tileCache != nullptr) {
+        tileCache->removeTileSet(tileSetName);
+    }
+}
+
+
+void GeoMaps::TileHandler::fetchTile(quint32 z, quint32 x, quint32 y, const std::function<void(const QByteArray&)>& callback)
+{
+    PROFILER_SCOPE(Profiler::TileServing);
+    static auto* requestsMetric = Metrics::counter(QStringLiteral("tiles/requests"));
+    static auto* cacheHitsMetric = Metrics::counter(QStringLiteral("tiles/cacheHits"));
+    static auto* cacheHitRatioMetric = Metrics::gauge(QStringLiteral("tiles/cacheHitRatioPercent"));
+    requestsMetric->add();
+    auto updateCacheHitRatio = [&]() {
+        cacheHitRatioMetric->set(static_cast<qint64>(100*cacheHitsMetric->value()/qMax(requestsMetric->value(), quint64(1))));
+    };
+
+    // The bundle is kept alive until the callback has returned
+    auto briefingBundle = _briefingBundle;
+    if ((briefingBundle != nullptr) && (_contentKey != 0)) {
+        auto tileData = briefingBundle->tile(_contentKey, z, x, y);
+        if (!tileData.isEmpty()) {
+            callback(tileData);
+            return;
         }
-        connectionToRemove = databaseConnectionName;
-        break;
     }
 
-    QSqlDatabase::removeDatabase(connectionToRemove);
-    databaseConnections.remove(connectionToRemove);
+    QByteArray tileData;
+    if ((tileCache != nullptr) && tileCache->find(tileSetName, z, x, y, tileData)) {
+        cacheHitsMetric->add();
+        updateCacheHitRatio();
+        callback(tileData);
+        return;
+    }
+    updateCacheHitRatio();
+    if (readers.isEmpty()) {
+        callback({});
+        return;
+    }
+
+    // Hand the request over to one of the readers
+    auto* reader = readers[nextReader];
+    nextReader = (nextReader+1) % readers.size();
+    auto requestID = nextRequestID++;
+    pendingRequests.insert(requestID, {callback, z, x, y});
+    QMetaObject::invokeMethod(reader, [reader, requestID, z, x, y]() { reader->readTile(requestID, z, x, y); }, Qt::QueuedConnection);
+}
+
+
+void GeoMaps::TileHandler::onTileRead(quint64 requestID, const QByteArray& tileData)
+{
+    PROFILER_SCOPE(Profiler::TileServing);
+    auto request = pendingRequests.take(requestID);
+    if (!request.callback) {
+        return;
+    }
+
+    if (!tileData.isEmpty() && (tileCache != nullptr)) {
+        tileCache->insert(tileSetName, request.z, request.x, request.y, tileData);
+    }
+    request.callback(tileData);
 }
 
 
 void GeoMaps::TileHandler::process(QHttpEngine::Socket *socket, const QString &path)
 {
+    PROFILER_SCOPE(Profiler::TileServing);
     // Serve tileJSON file, if requested
     if (path.isEmpty() || path.endsWith("json", Qt::CaseInsensitive)) {
-        socket->setHeader("Content-Type", "application/json");
-        QByteArray json = tileJSON();
-        socket->setHeader("Content-Length", QByteArray::number(json.length()));
-        socket->write(json);
-        socket->close();
+        writeJSON(socket, _tileJSON, _tileJSONETag);
         return;
     }
 
     // Serve tile, if requested
-    QRegularExpression tileQueryPattern("[0-9]{1,2}/[0-9]{1,4}/[0-9]{1,4}");
-    QRegularExpressionMatch match = tileQueryPattern.match(path);
-    if (match.hasMatch()) {
-        // Retrieve tile data from the database
-        quint32 z       = path.section('/', 1, 1).toInt();
-        QString x       = path.section('/', 2, 2);
-        quint32 y       = path.section('/', 3, 3).section('.', 0, 0).toInt();
-        quint32 yflipped = ((quint32(1) <<z)-1)-y;
-        QString queryString = QString("select zoom_level, tile_column, tile_row, tile_data from tiles where zoom_level=%1 and tile_column=%2 and tile_row=%3;").arg(z).arg(x).arg(yflipped);
-
-        foreach(auto databaseConnection, databaseConnections) {
-            auto db = QSqlDatabase::database(databaseConnection);
-
-            QSqlQuery query(db);
-            query.exec(queryString);
-
-            // Error handling
-            if (!query.first()) {
-                continue;
+    quint32 z = 0;
+    quint32 x = 0;
+    quint32 y = 0;
+    if (parseTilePath(path, z, x, y)) {
+        QPointer<QHttpEngine::Socket> socketPointer(socket);
+        fetchTile(z, x, y, [socketPointer](const QByteArray& tileData) {
+            if (socketPointer.isNull()) {
+                return;
             }
+            if (tileData.isEmpty()) {
+                // Unknown tile, responding with 'not found'
+                socketPointer->writeError(QHttpEngine::Socket::NotFound);
+                socketPointer->close();
+                return;
+            }
+            writeTile(socketPointer, tileData);
+        });
+        return;
+    }
+
+    // Unknown request, responding with 'not found'
+    socket->writeError(QHttpEngine::Socket::NotFound);
+    socket->close();
+}
 
-            // Get data
-            QByteArray tileData = query.value(3).toByteArray();
 
-            // Set the headers and write the content
-            socket->setHeader("Content-Type", "application/octet-stream");
-            socket->setHeader("Content-Encoding", "gzip");
-            socket->setHeader("Content-Length", QByteArray::number(tileData.length()));
-            socket->write(tileData);
-            socket->close();
-            return;
+auto GeoMaps::TileHandler::parseTilePath(const QString& path, quint32& z, quint32& x, quint32& y) -> bool
+{
+    const auto* character = path.constData();
+    const auto* end = character+path.size();
+    if ((character != end) && (*character == '/')) {
+        character++;
+    }
+
+    // Reads a number of at most maxDigits digits
+    auto readNumber = [&](quint32& result, int maxDigits) {
+        result = 0;
+        int digits = 0;
+        while ((character != end) && character->isDigit() && (digits < maxDigits)) {
+            result = 10*result + static_cast<quint32>(character->digitValue());
+            character++;
+            digits++;
         }
+        return digits > 0;
+    };
+
+    if (!readNumber(z, 2) || (character == end) || (*character != '/')) {
+        return false;
+    }
+    character++;
+    if (!readNumber(x, 5) || (character == end) || (*character != '/')) {
+        return false;
+    }
+    character++;
+    if (!readNumber(y, 5)) {
+        return false;
+    }
+    if ((character != end) && (*character != '.')) {
+        return false;
     }
 
-    // Unknown request, responding with 'not found'
-    socket->writeError(QHttpEngine::Socket::NotFound);
+    // Paranoid safety checks
+    if ((z > 30) || (x >= (quint32(1) << z)) || (y >= (quint32(1) << z))) {
+        return false;
+    }
+    return true;
+}
+
+
+void GeoMaps::TileHandler::writeTile(QHttpEngine::Socket *socket, const QByteArray& tileData)
+{
+    // Set the headers and write the content
+    socket->setHeader("Content-Type", "application/octet-stream");
+    socket->setHeader("Content-Encoding", "gzip");
+    socket->setHeader("Content-Length", QByteArray::number(tileData.length()));
+    socket->write(tileData);
+    socket->close();
+}
+
+
+auto GeoMaps::TileHandler::eTag(const QByteArray& document) -> QByteArray
+{
+    return '"'+QCryptographicHash::hash(document, QCryptographicHash::Md5).toHex()+'"';
+}
+
+
+void GeoMaps::TileHandler::writeJSON(QHttpEngine::Socket *socket, const QByteArray& json, const QByteArray& eTag)
+{
+    socket->setHeader("ETag", eTag);
+    socket->setHeader("Cache-Control", "no-cache");
+    if (socket->headers().value("If-None-Match") == eTag) {
+        socket->setStatusCode(QHttpEngine::Socket::NotModified);
+        socket->setHeader("Content-Length", "0");
+        socket->writeHeaders();
+        socket->close();
+        return;
+    }
+
+    socket->setHeader("Content-Type", "application/json");
+    socket->setHeader("Content-Length", QByteArray::number(json.length()));
+    socket->write(json);
     socket->close();
 }
 
 
-auto GeoMaps::TileHandler::tileJSON() const -> QByteArray
+auto GeoMaps::TileHandler::makeTileJSON() const -> QByteArray
 {
     QJsonObject result;
     result.insert("tilejson", "2.2.0");
@@ -20,13 +20,22 @@
 
 #pragma once
 
-#include <QSet>
+#include <QHash>
+#include <QPointer>
 #include <QSqlDatabase>
+#include <QThread>
+#include <functional>
+#include <memory>
 
 #include <qhttpengine/handler.h>
+#include <qhttpengine/socket.h>
 
 #include <dataManagement/Downloadable.h>
 
+#include "BriefingBundle.h"
+#include "MBTilesReader.h"
+#include "TileCache.h"
+
 
 namespace GeoMaps {
 
@@ -41,6 +50,10 @@ class Downloadable;
   TileJSON Specification 2.2.0 found
   https://github.com/mapbox/tilejson-spec/tree/master/2.2.0) is served at the
   URL whose names is set in the baseURLName argument of the constructor.
+
+  Tiles are read from the files by instances of MBTilesReader that live in
+  worker threads. The thread that serves the HTTP requests, typically the
+  main thread, therefore never waits for SQLite.
 */
 
 class TileHandler : public QHttpEngine::Handler
@@ -67,10 +80,17 @@ public:
     @param baseURLName The name of the URL under which the tile server allows
     access to this tile. Typically a string of the form
     "http://localhost:8080/osm"
+
+    @param tileCache Cache for tile data, shared by all tile handlers of the
+    tile server. Can be a nullptr, in which case tiles are never cached.
+
+    @param tileSetName Name under which the tiles are stored in tileCache.
+    Whenever a file is removed from this handler, all tiles of that name are
+    removed from the cache.
     
     @param parent The standard QObject parent
   */
-  explicit TileHandler(const QVector<QPointer<DataManagement::Downloadable>>& mbtileFiles, const QString& baseURLName, QObject *parent = nullptr);
+  explicit TileHandler(const QVector<QPointer<DataManagement::Downloadable>>& mbtileFiles, const QString& baseURLName, TileCache* tileCache = nullptr, QString tileSetName = {}, QObject *parent = nullptr);
   
   // Destructor
   ~TileHandler() override;
@@ -87,6 +107,16 @@ public:
   */
   QString attribution() const {return _attribution;}
   
+  /*! \brief Key that identifies the content of the files
+
+    The key is computed from the names, sizes and modification times of the
+    files. It does not change when the app is restarted, and is used as the
+    source of the tiles in a BriefingBundle.
+
+    @returns Key of the content, or 0 if the files could not be read
+  */
+  quint64 contentKey() const {return _contentKey;}
+
   /*! \brief Description property, as found in the metadata table of the mbtile file
     
     This property is empty if no description is found.
@@ -145,7 +175,8 @@ public:
     
     This property holds a TileJSON file that describes the source. The file
     complies with specification 2.2.0
-    (https://github.com/mapbox/tilejson-spec/tree/master/2.2.0).
+    (https://github.com/mapbox/tilejson-spec/tree/master/2.2.0). It is
+    serialized once, in the constructor.
   */
   Q_PROPERTY(QByteArray tileJSON READ tileJSON CONSTANT)
   
@@ -153,7 +184,7 @@ public:
 
      @returns Property tileJSON
   */
-  QByteArray tileJSON() const;
+  QByteArray tileJSON() const {return _tileJSON;}
   
   /*! \brief Tile URL endpoints
     
@@ -181,6 +212,61 @@ public:
   */
   QString version() const {return _version;}
   
+  /*! \brief Retrieve a tile, without going through HTTP
+
+    This method retrieves a tile from the briefing bundle, from the tile cache
+    or, if the tile is found in neither, from the files, in a worker thread.
+    It returns immediately. HTTP requests for tiles are served by this method,
+    too.
+
+    @param z Zoom level
+
+    @param x Column
+
+    @param y Row, counted from the north, as in XYZ URLs
+
+    @param callback Function that is called in the thread of this handler
+    once the tile is available. The argument is the tile data, exactly as
+    found in the file (typically gzip-compressed), or an empty array if the
+    tile does not exist. If the tile is in the briefing bundle or cached, the
+    callback is called before this method returns. Tiles from the briefing
+    bundle refer to the mapped file and must be copied if they are kept after
+    the callback returns. If the handler is destructed before the tile is
+    read, the callback is called with an empty array.
+  */
+  void fetchTile(quint32 z, quint32 x, quint32 y, const std::function<void(const QByteArray&)>& callback);
+
+  /*! \brief Set the briefing bundle
+
+    Tiles found in the bundle are served from the bundle, without looking at
+    the tile cache or the files.
+
+    @param briefingBundle Bundle, or nullptr
+  */
+  void setBriefingBundle(std::shared_ptr<const BriefingBundle> briefingBundle) {_briefingBundle = std::move(briefingBundle);}
+
+  /*! \brief Entity tag for a document
+
+    @param document Document, such as a TileJSON or style file
+
+    @returns Quoted entity tag, suitable for the HTTP header "ETag"
+  */
+  static QByteArray eTag(const QByteArray& document);
+
+  /*! \brief Write a JSON document to the socket and close the socket
+
+    The response carries the entity tag and asks clients to revalidate before
+    reusing a cached copy. If the request carries a matching "If-None-Match"
+    header, the response is "304 Not Modified", without content.
+
+    @param socket Socket
+
+    @param json JSON document
+
+    @param eTag Entity tag of the document, as returned by eTag()
+  */
+  static void writeJSON(QHttpEngine::Socket *socket, const QByteArray& json, const QByteArray& eTag);
+
 protected:
   /*
    * @brief Reimplementation of
@@ -191,12 +277,55 @@ protected:
 private slots:
   // This slot is connected to aboutToChangeLocalFile of the Downloadables, in
   // order to make sure that databases are closed before the file changes.
+  // This method waits until all readers have closed the file.
   void removeFile(const QString& localFileName);
 
 private:
   Q_DISABLE_COPY_MOVE(TileHandler)
 
-  QSet<QString> databaseConnections;
+  // Parses paths of the form "/z/x/y.format", without allocating memory.
+  // Returns true on success.
+  static bool parseTilePath(const QString& path, quint32& z, quint32& x, quint32& y);
+
+  // Writes gzip-compressed tile data to the socket and closes the socket
+  static void writeTile(QHttpEngine::Socket *socket, const QByteArray& tileData);
+
+  // Serializes the TileJSON, from the metadata
+  QByteArray makeTileJSON() const;
+
+  // Reads the metadata of the database, and appends the file to sources.
+  // Returns true on success.
+  bool readMetadata(QSqlDatabase& db, QVector<MBTilesReader::Source>& sources, const QString& fileName);
+
+  // Number of worker threads
+  static constexpr int numReaderThreads = 2;
+
+  // Hands a tile that was read by one of the readers to the callback
+  void onTileRead(quint64 requestID, const QByteArray& tileData);
+
+  // Readers that read tiles from the databases, each living in its own
+  // worker thread. The readers are deleted when their threads finish.
+  QVector<MBTilesReader*> readers;
+  QVector<QThread*> readerThreads;
+  int nextReader {0};
+
+  // Requests that are currently handled by the readers
+  struct PendingRequest {
+    std::function<void(const QByteArray&)> callback;
+    quint32 z;
+    quint32 x;
+    quint32 y;
+  };
+  QHash<quint64, PendingRequest> pendingRequests;
+  quint64 nextRequestID {0};
+
+  // Cache for tile data, not owned by this handler
+  TileCache* tileCache;
+  QString tileSetName;
+
+  // Tiles prepared for a flight, consulted before the cache
+  std::shared_ptr<const BriefingBundle> _briefingBundle;
+  quint64 _contentKey {0};
   
   QString _name;
   QString _format;
@@ -209,6 +338,10 @@ private:
   
   int _maxzoom {-1};
   int _minzoom {-1};
+
+  // Serialized TileJSON, with its entity tag
+  QByteArray _tileJSON;
+  QByteArray _tileJSONETag;
   
   bool hasDBError {false};
 };
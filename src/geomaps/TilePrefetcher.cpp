@@ -0,0 +1,182 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "GlobalObject.h"
+#include "TilePrefetcher.h"
+#include "TileServer.h"
+#include "WebMercator.h"
+#include "navigation/FlightRoute.h"
+#include "navigation/Navigator.h"
+
+
+GeoMaps::TilePrefetcher::TilePrefetcher(TileServer* tileServer, QObject *parent)
+    : QObject(parent),
+      m_tileServer(tileServer)
+{
+}
+
+
+void GeoMaps::TilePrefetcher::enqueue(const QGeoCoordinate& coordinate, int z)
+{
+    if (!coordinate.isValid()) {
+        return;
+    }
+
+    auto [x, y] = webMercatorTile(coordinate.latitude(), coordinate.longitude(), z);
+    auto numTiles = quint32(1) << z;
+    for(int dx=-1; dx<=1; dx++) {
+        for(int dy=-1; dy<=1; dy++) {
+            auto tileX = static_cast<qint64>(x)+dx;
+            auto tileY = static_cast<qint64>(y)+dy;
+            if ((tileX < 0) || (tileY < 0) || (tileX >= numTiles) || (tileY >= numTiles)) {
+                continue;
+            }
+            auto key = tileKey(z, static_cast<quint32>(tileX), static_cast<quint32>(tileY));
+            if (m_seen.contains(key)) {
+                continue;
+            }
+            m_seen += key;
+            m_queue.enqueue(key);
+        }
+    }
+}
+
+
+void GeoMaps::TilePrefetcher::enqueueLine(const QGeoCoordinate& start, const QGeoCoordinate& end)
+{
+    if (!start.isValid() || !end.isValid()) {
+        return;
+    }
+    auto distance = start.distanceTo(end);
+    auto azimuth = start.azimuthTo(end);
+
+    // Sample the line at intervals of half a tile, roughly. Low zoom levels
+    // come first, so that an overview is available early.
+    for(int z=minZoom; z<=maxZoom; z++) {
+        auto tileSizeInM = webMercatorTileWidthInM(start.latitude(), z);
+        auto step = qMax(tileSizeInM/2.0, 1000.0);
+        for(double d=0.0; d<distance+step; d+=step) {
+            enqueue(start.atDistanceAndAzimuth(qMin(d, distance), azimuth), z);
+        }
+    }
+}
+
+
+void GeoMaps::TilePrefetcher::enqueueRoute()
+{
+    if (m_flightRoute.isNull() || m_tileSet.isEmpty()) {
+        return;
+    }
+
+    QGeoCoordinate previous;
+    foreach(auto variant, m_flightRoute->geoPath()) {
+        auto coordinate = variant.value<QGeoCoordinate>();
+        if (previous.isValid()) {
+            enqueueLine(previous, coordinate);
+        }
+        previous = coordinate;
+    }
+    processQueue();
+}
+
+
+void GeoMaps::TilePrefetcher::onPositionUpdated(const Positioning::PositionInfo& info)
+{
+    if (m_tileSet.isEmpty() || !info.isValid() || !GlobalObject::navigator()->isInFlight()) {
+        return;
+    }
+
+    // Work only when the aircraft has moved to another tile
+    auto [x, y] = webMercatorTile(info.coordinate().latitude(), info.coordinate().longitude(), maxZoom);
+    auto aircraftTile = tileKey(maxZoom, x, y);
+    if (aircraftTile == m_lastAircraftTile) {
+        return;
+    }
+    m_lastAircraftTile = aircraftTile;
+
+    auto groundSpeed = info.groundSpeed();
+    auto trueTrack = info.trueTrack();
+    if (!groundSpeed.isFinite() || !trueTrack.isFinite()) {
+        return;
+    }
+    auto lookAheadDistance = groundSpeed.toMPS()*lookAheadTimeInS;
+    auto start = info.coordinate();
+    enqueueLine(start, start.atDistanceAndAzimuth(lookAheadDistance, trueTrack.toDEG()));
+    processQueue();
+}
+
+
+void GeoMaps::TilePrefetcher::processQueue()
+{
+    while ((m_pendingRequests < maxPendingRequests) && !m_queue.isEmpty() && !m_tileServer.isNull()) {
+        auto key = m_queue.dequeue();
+        auto z = static_cast<quint32>(key >> 48);
+        auto x = static_cast<quint32>((key >> 24) & 0xFFFFFF);
+        auto y = static_cast<quint32>(key & 0xFFFFFF);
+
+        QPointer<TilePrefetcher> self(this);
+        auto tileSet = m_tileSet;
+        m_pendingRequests++;
+        auto found = m_tileServer->fetchTile(m_tileSet, z, x, y, [self, tileSet](const QByteArray& /*tileData*/) {
+            if (self.isNull() || (self->m_tileSet != tileSet)) {
+                return;
+            }
+            self->m_pendingRequests--;
+
+            // Continue with the next tile, after returning to the event loop
+            QMetaObject::invokeMethod(self, &TilePrefetcher::processQueue, Qt::QueuedConnection);
+        });
+        if (!found) {
+            // The tile set does not exist (any more)
+            m_pendingRequests--;
+            m_queue.clear();
+        }
+    }
+}
+
+
+void GeoMaps::TilePrefetcher::setFlightRoute(Navigation::FlightRoute* flightRoute)
+{
+    if (!m_flightRoute.isNull()) {
+        disconnect(m_flightRoute, nullptr, this, nullptr);
+    }
+    m_flightRoute = flightRoute;
+    if (!m_flightRoute.isNull()) {
+        connect(m_flightRoute, &Navigation::FlightRoute::waypointsChanged, this, &TilePrefetcher::enqueueRoute);
+    }
+    enqueueRoute();
+}
+
+
+void GeoMaps::TilePrefetcher::setTileSet(const QString& baseName)
+{
+    m_tileSet = baseName;
+    m_queue.clear();
+    m_seen.clear();
+    m_pendingRequests = 0;
+    m_lastAircraftTile = 0;
+    enqueueRoute();
+}
+
+
+auto GeoMaps::TilePrefetcher::tileKey(int z, quint32 x, quint32 y) -> quint64
+{
+    return (static_cast<quint64>(z) << 48) | (static_cast<quint64>(x) << 24) | static_cast<quint64>(y);
+}
@@ -0,0 +1,146 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QGeoCoordinate>
+#include <QPointer>
+#include <QQueue>
+#include <QSet>
+
+#include "positioning/PositionInfo.h"
+
+namespace Navigation {
+class FlightRoute;
+};
+
+
+namespace GeoMaps {
+
+class TileServer;
+
+
+/*! \brief Loads tiles along the route and ahead of the aircraft into the tile cache
+
+  This class warms the tile cache of a TileServer, so that the map never has
+  to wait for the mbtiles databases in flight. It loads the tiles that cover
+  the current flight route, and while in flight it keeps loading the tiles on
+  the track ahead of the aircraft. The tiles are loaded through
+  TileServer::fetchTile, with at most maxPendingRequests requests at any
+  time, so that requests from the map renderer are not delayed noticeably.
+
+  Every tile is loaded only once per tile set. Because the size of the tile
+  cache is limited, tiles loaded early might be dropped before they are used
+  on long routes.
+*/
+
+class TilePrefetcher : public QObject
+{
+  Q_OBJECT
+
+public:
+  /*! \brief Create a new prefetcher
+
+    @param tileServer Tile server whose cache is warmed
+
+    @param parent The standard QObject parent
+  */
+  explicit TilePrefetcher(TileServer* tileServer, QObject *parent = nullptr);
+
+  // Destructor
+  ~TilePrefetcher() override = default;
+
+  /*! \brief Lowest zoom level for which tiles are loaded */
+  static constexpr int minZoom = 7;
+
+  /*! \brief Highest zoom level for which tiles are loaded */
+  static constexpr int maxZoom = 10;
+
+  /*! \brief Number of concurrent requests */
+  static constexpr int maxPendingRequests = 2;
+
+  /*! \brief Time span ahead of the aircraft for which tiles are loaded, in seconds */
+  static constexpr double lookAheadTimeInS = 15*60.0;
+
+public slots:
+  /*! \brief Set the tile set whose tiles are loaded
+
+    This method drops all queued requests and forgets about all tiles loaded
+    previously. If a flight route is set, the tiles along the route are
+    queued again.
+
+    @param baseName Name of the tile set, as passed to
+    TileServer::addMbtilesFileSet(), or an empty string to stop loading tiles
+  */
+  void setTileSet(const QString& baseName);
+
+  /*! \brief Set the flight route
+
+    The tiles along the route are queued whenever the route changes.
+
+    @param flightRoute Flight route, or nullptr
+  */
+  void setFlightRoute(Navigation::FlightRoute* flightRoute);
+
+  /*! \brief Queue the tiles ahead of the aircraft
+
+    This slot is meant to be connected to the positionInfoChanged signal of
+    the PositionProvider. It does nothing if the aircraft is not flying.
+
+    @param info Current position
+  */
+  void onPositionUpdated(const Positioning::PositionInfo& info);
+
+private:
+  Q_DISABLE_COPY_MOVE(TilePrefetcher)
+
+  // Identifies a tile, packed into 64 bits
+  static quint64 tileKey(int z, quint32 x, quint32 y);
+
+  // Queues the tile that contains the coordinate, along with its neighbours
+  void enqueue(const QGeoCoordinate& coordinate, int z);
+
+  // Queues the tiles that cover a line, at all zoom levels
+  void enqueueLine(const QGeoCoordinate& start, const QGeoCoordinate& end);
+
+  // Queues the tiles along the flight route
+  void enqueueRoute();
+
+  // Sends requests to the tile server, until maxPendingRequests are pending
+  void processQueue();
+
+  QPointer<TileServer> m_tileServer;
+  QPointer<Navigation::FlightRoute> m_flightRoute;
+  QString m_tileSet;
+
+  // Tiles waiting to be loaded
+  QQueue<quint64> m_queue;
+
+  // Tiles that are queued or have been loaded
+  QSet<quint64> m_seen;
+
+  int m_pendingRequests {0};
+
+  // Tile at maxZoom below the aircraft, when onPositionUpdated was last run
+  quint64 m_lastAircraftTile {0};
+};
+
+};
@@ -21,6 +21,7 @@
 #include <QUrl>
 #include <utility>
 
+#include "AviationDataTileHandler.h"
 #include "TileHandler.h"
 #include "TileServer.h"
 #include "dataManagement/Downloadable.h"
@@ -29,10 +30,22 @@
 GeoMaps::TileServer::TileServer(QUrl baseUrl, QObject *parent)
     : QHttpEngine::Server(parent), _baseUrl(std::move(baseUrl))
 {
+    styleHandler = new StyleHandler(this);
     setUpTileHandlers();
 }
 
 
+auto GeoMaps::TileServer::fetchTile(const QString& baseName, quint32 z, quint32 x, quint32 y, const std::function<void(const QByteArray&)>& callback) -> bool
+{
+    auto handler = tileHandlers.value(baseName);
+    if (handler.isNull()) {
+        return false;
+    }
+    handler->fetchTile(z, x, y, callback);
+    return true;
+}
+
+
 auto GeoMaps::TileServer::serverUrl() const -> QString
 {
     if (isListening()) {
@@ -42,6 +55,36 @@ auto GeoMaps::TileServer::serverUrl() const -> QString
 }
 
 
+auto GeoMaps::TileServer::styleUrl() const -> QString
+{
+    auto url = _baseUrl.isEmpty() ? serverUrl() : _baseUrl.toString();
+    if (url.isEmpty()) {
+        return {};
+    }
+    return url+"/style/"+QString::number(styleHandler->version())+".json";
+}
+
+
+void GeoMaps::TileServer::setBriefingBundle(const std::shared_ptr<const BriefingBundle>& bundle)
+{
+    briefingBundle = bundle;
+    if (!aviationDataTileHandler.isNull()) {
+        aviationDataTileHandler->setBriefingBundle(bundle);
+    }
+    foreach(auto handler, tileHandlers) {
+        if (!handler.isNull()) {
+            handler->setBriefingBundle(bundle);
+        }
+    }
+}
+
+
+auto GeoMaps::TileServer::setStyle(const QByteArray& style) -> bool
+{
+    return styleHandler->setStyle(style);
+}
+
+
 void GeoMaps::TileServer::addMbtilesFileSet(const QVector<QPointer<DataManagement::Downloadable>>& baseMapsWithFiles, const QString& baseName)
 {
     mbtileFileNameSets[baseName] = baseMapsWithFiles;
@@ -52,10 +95,25 @@ void GeoMaps::TileServer::addMbtilesFileSet(const QVector<QPointer<DataManagemen
 void GeoMaps::TileServer::removeMbtilesFileSet(const QString& path)
 {
     mbtileFileNameSets.remove(path);
+    tileCache.removeTileSet(path);
     setUpTileHandlers();
 }
 
 
+auto GeoMaps::TileServer::clearTileCache() -> qint64
+{
+    auto size = tileCache.size();
+    tileCache.clear();
+    return size;
+}
+
+
+void GeoMaps::TileServer::setTileCacheSize(qint64 bytes)
+{
+    tileCache.setMaxSize(bytes);
+}
+
+
 void GeoMaps::TileServer::setUpTileHandlers()
 {
     // Create new file system handler and delete old one
@@ -65,7 +123,19 @@ void GeoMaps::TileServer::setUpTileHandlers()
     delete currentFileSystemHandler;
     currentFileSystemHandler = newFileSystemHandler;
 
+    // Find base URL
+    QString baseURL = _baseUrl.isEmpty() ? serverUrl() : _baseUrl.toString();
+
+    // Serve the map style
+    newFileSystemHandler->addSubHandler(QRegExp("^style"), styleHandler);
+
+    // Serve the aviation data as vector tiles
+    aviationDataTileHandler = new AviationDataTileHandler(baseURL+"/aviationData", &tileCache, newFileSystemHandler);
+    aviationDataTileHandler->setBriefingBundle(briefingBundle);
+    newFileSystemHandler->addSubHandler(QRegExp("^aviationData"), aviationDataTileHandler);
+
     // Now add subhandlers for each tile
+    tileHandlers.clear();
     QMapIterator<QString, QVector<QPointer<DataManagement::Downloadable>>> iterator(mbtileFileNameSets);
     while (iterator.hasNext()) {
         iterator.next();
@@ -78,8 +148,10 @@ void GeoMaps::TileServer::setUpTileHandlers()
             URL = _baseUrl.toString()+"/"+iterator.key();
         }
 
-        auto *handler = new TileHandler(iterator.value(), URL, newFileSystemHandler);
+        auto *handler = new TileHandler(iterator.value(), URL, &tileCache, iterator.key(), newFileSystemHandler);
+        handler->setBriefingBundle(briefingBundle);
         newFileSystemHandler->addSubHandler(QRegExp("^"+iterator.key()), handler);
+        tileHandlers[iterator.key()] = handler;
     }
 
 }
@@ -24,6 +24,14 @@
 #include <qhttpengine/server.h>
 
 #include <QPointer>
+#include <functional>
+#include <memory>
+
+#include "AviationDataTileHandler.h"
+#include "BriefingBundle.h"
+#include "StyleHandler.h"
+#include "TileCache.h"
+#include "TileHandler.h"
 
 
 namespace GeoMaps {
@@ -47,6 +55,11 @@ namespace GeoMaps {
   containing openstreetmap data and one set with raster data used for
   hillshading. Each set contains two MBTiles files, one for Africa and one for
   Europe.
+
+  The server closes the connection after every response, because
+  QHttpEngine::Socket does not support persistent connections. Clients that
+  request many tiles at once should therefore open several connections in
+  parallel, as the map renderer does.
 */
 
 class TileServer : public QHttpEngine::Server
@@ -85,7 +98,63 @@ public:
     @returns URL under which this server is presently reachable
   */
   QString serverUrl() const;
+
+  /*! \brief URL of the map style
+
+    The style set with setStyle() is served from memory under this URL. The
+    URL contains a version number and changes whenever the style changes.
+
+    @returns URL of the style, or an empty string if the server is not
+    listening to incoming connections
+  */
+  QString styleUrl() const;
 			   
+  /*! \brief Retrieve a tile in-process, without going through HTTP
+
+    This method gives code that lives in the same process direct access to
+    the tiles, bypassing the socket, the HTTP protocol and the loopback
+    device. HTTP is still used by the map renderer, which can only load tiles
+    from URLs.
+
+    @see TileHandler::fetchTile
+
+    @param baseName Name of the tile set, as passed to addMbtilesFileSet()
+
+    @param z Zoom level
+
+    @param x Column
+
+    @param y Row, counted from the north, as in XYZ URLs
+
+    @param callback Function that is called once the tile is available. The
+    argument is the tile data, exactly as found in the file, or an empty array
+    if the tile does not exist.
+
+    @returns False if no tile set of the given name exists. In that case, the
+    callback is never called.
+  */
+  bool fetchTile(const QString& baseName, quint32 z, quint32 x, quint32 y, const std::function<void(const QByteArray&)>& callback);
+
+  /*! \brief Tile handler of a tile set
+
+    @param baseName Name of the tile set, as passed to addMbtilesFileSet()
+
+    @returns Handler, or nullptr if no tile set of the given name exists
+  */
+  QPointer<TileHandler> tileHandler(const QString& baseName) const
+  {
+    return tileHandlers.value(baseName);
+  }
+
+  /*! \brief Names of the tile sets
+
+    @returns Names of all tile sets, as passed to addMbtilesFileSet()
+  */
+  QStringList tileSetNames() const
+  {
+    return tileHandlers.keys();
+  }
+
 public slots:
   /*! \brief Add a new set of tile files
     
@@ -108,11 +177,46 @@ public slots:
   */
   void addMbtilesFileSet(const QVector<QPointer<DataManagement::Downloadable>>& baseMapsWithFiles, const QString& baseName);
 
+  /*! \brief Set the briefing bundle
+
+    All tile handlers, including those that are set up later, serve tiles
+    from the bundle before looking at the tile cache.
+
+    @param bundle Bundle, or nullptr
+  */
+  void setBriefingBundle(const std::shared_ptr<const BriefingBundle>& bundle);
+
+  /*! \brief Set the map style
+
+    @param style Mapbox style, in JSON format, which typically references
+    the tile sets of this server
+
+    @returns True if the style has changed. In that case, styleUrl() returns
+    a new URL.
+  */
+  bool setStyle(const QByteArray& style);
+
   /*! \brief Removes a set of tile files
    
     @param path Path of tiles to remove
    */
   void removeMbtilesFileSet(const QString& path);
+
+  /*! \brief Set size of the tile cache
+
+    All tile handlers of this server share one cache for tile data, so that
+    tiles requested repeatedly while panning and zooming need not be read
+    from the databases again.
+
+    @param bytes Maximal size of the cached tile data, in bytes
+   */
+  void setTileCacheSize(qint64 bytes);
+
+  /*! \brief Removes all tiles from the tile cache
+
+    @returns Number of bytes released
+   */
+  qint64 clearTileCache();
   
 private:
   Q_DISABLE_COPY_MOVE(TileServer)
@@ -122,8 +226,22 @@ private:
   QPointer<QHttpEngine::FilesystemHandler> currentFileSystemHandler;
   
   QMap<QString,QVector<QPointer<DataManagement::Downloadable>>> mbtileFileNameSets;
+
+  // Tile handlers for the sets in mbtileFileNameSets
+  QMap<QString,QPointer<TileHandler>> tileHandlers;
   
   QUrl _baseUrl;
+
+  TileCache tileCache;
+
+  // Tiles prepared for a flight, and the handler of the aviation data, which
+  // serves tiles from the bundle as well
+  std::shared_ptr<const BriefingBundle> briefingBundle;
+  QPointer<AviationDataTileHandler> aviationDataTileHandler;
+
+  // Handler for the map style. Unlike the other handlers, it survives
+  // setUpTileHandlers(), so that the style is kept.
+  QPointer<StyleHandler> styleHandler;
 };
 
 };
@@ -0,0 +1,589 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QJsonArray>
+#include <QPoint>
+#include <QtEndian>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "VectorTileEncoder.h"
+
+
+namespace {
+
+// Protobuf wire types
+const quint32 varintType = 0;
+const quint32 fixed64Type = 1;
+const quint32 lengthDelimitedType = 2;
+
+// Geometry commands
+const quint32 moveTo = 1;
+const quint32 lineTo = 2;
+const quint32 closePath = 7;
+
+// Web Mercator is not defined near the poles
+const double maxLatitude = 85.0511287798;
+
+void writeVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+void writeTag(QByteArray& out, quint32 field, quint32 wireType)
+{
+    writeVarint(out, (field << 3) | wireType);
+}
+
+void writeBytes(QByteArray& out, quint32 field, const QByteArray& data)
+{
+    writeTag(out, field, lengthDelimitedType);
+    writeVarint(out, static_cast<quint64>(data.size()));
+    out.append(data);
+}
+
+void writePackedVarints(QByteArray& out, quint32 field, const QVector<quint32>& values)
+{
+    QByteArray packed;
+    foreach(auto value, values) {
+        writeVarint(packed, value);
+    }
+    writeBytes(out, field, packed);
+}
+
+auto zigzag(qint32 value) -> quint32
+{
+    return (static_cast<quint32>(value) << 1) ^ static_cast<quint32>(value >> 31);
+}
+
+auto command(quint32 id, quint32 count) -> quint32
+{
+    return (id & 0x7) | (count << 3);
+}
+
+// Web Mercator projection, to a square of size worldSize
+auto worldCoordinate(double latitude, double longitude, double worldSize) -> std::pair<double, double>
+{
+    auto sinLatitude = std::sin(qDegreesToRadians(qBound(-maxLatitude, latitude, maxLatitude)));
+    auto x = (longitude+180.0)/360.0*worldSize;
+    auto y = (0.5-std::log((1.0+sinLatitude)/(1.0-sinLatitude))/(4.0*M_PI))*worldSize;
+    return {x, y};
+}
+
+// Squared distance of point p from the segment from a to b
+auto squaredSegmentDistance(std::pair<double, double> p, std::pair<double, double> a, std::pair<double, double> b) -> double
+{
+    auto dx = b.first-a.first;
+    auto dy = b.second-a.second;
+    auto lengthSquared = dx*dx+dy*dy;
+    auto t = (lengthSquared > 0.0) ? qBound(0.0, ((p.first-a.first)*dx+(p.second-a.second)*dy)/lengthSquared, 1.0) : 0.0;
+    auto ex = a.first+t*dx-p.first;
+    auto ey = a.second+t*dy-p.second;
+    return ex*ex+ey*ey;
+}
+
+}
+
+
+//
+// VectorTileFeature
+//
+
+auto GeoMaps::VectorTileFeature::fromGeoJSON(const QJsonObject& geoJSONObject) -> VectorTileFeature
+{
+    VectorTileFeature result;
+
+    auto appendCoordinate = [&result](const QJsonArray& coordinate) {
+        if (coordinate.size() < 2) {
+            return false;
+        }
+        result.coordinates.append(coordinate[1].toDouble());
+        result.coordinates.append(coordinate[0].toDouble());
+        return true;
+    };
+
+    auto geometry = geoJSONObject["geometry"].toObject();
+    auto type = geometry["type"].toString();
+    auto coordinates = geometry["coordinates"].toArray();
+    if (type == "Point") {
+        if (!appendCoordinate(coordinates)) {
+            return {};
+        }
+        result.partSizes.append(1);
+        result.geometryType = Point;
+    } else if ((type == "LineString") || (type == "Polygon")) {
+        // A LineString is treated like a polygon with a single part
+        QJsonArray parts;
+        if (type == "LineString") {
+            parts.append(coordinates);
+        } else {
+            parts = coordinates;
+        }
+        foreach(auto part, parts) {
+            int size = 0;
+            foreach(auto coordinate, part.toArray()) {
+                if (appendCoordinate(coordinate.toArray())) {
+                    size++;
+                }
+            }
+            result.partSizes.append(size);
+        }
+        if (result.partSizes.isEmpty()) {
+            return {};
+        }
+        result.geometryType = (type == "LineString") ? LineString : Polygon;
+    } else {
+        return {};
+    }
+
+    result.properties = geoJSONObject["properties"].toObject().toVariantMap();
+    return result;
+}
+
+
+auto GeoMaps::VectorTileFeature::boundingBox() const -> RTree::Box
+{
+    RTree::Box box {std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                -std::numeric_limits<double>::max(), -std::numeric_limits<double>::max()};
+    for(int i=0; i+1<coordinates.size(); i+=2) {
+        box.minY = qMin(box.minY, coordinates[i]);
+        box.maxY = qMax(box.maxY, coordinates[i]);
+        box.minX = qMin(box.minX, coordinates[i+1]);
+        box.maxX = qMax(box.maxX, coordinates[i+1]);
+    }
+    return box;
+}
+
+
+auto GeoMaps::VectorTileFeature::simplified(int zoom) const -> VectorTileFeature
+{
+    if ((geometryType != LineString) && (geometryType != Polygon)) {
+        return *this;
+    }
+
+    VectorTileFeature result;
+    result.geometryType = geometryType;
+    result.properties = properties;
+    result.partSizes.reserve(partSizes.size());
+
+    // Douglas-Peucker, in the coordinates of the tiles at the given zoom
+    auto worldSize = static_cast<double>(VectorTileEncoder::extent)*std::exp2(zoom);
+    auto toleranceSquared = VectorTileEncoder::simplificationTolerance*VectorTileEncoder::simplificationTolerance;
+    auto minimalSize = (geometryType == Polygon) ? 4 : 2;
+    std::vector<std::pair<double, double>> points;
+    std::vector<bool> keep;
+    std::vector<std::pair<int, int>> stack;
+    int start = 0;
+    foreach(auto partSize, partSizes) {
+        points.clear();
+        for(int i=0; (i<partSize) && (2*(start+i)+1<coordinates.size()); i++) {
+            points.push_back(worldCoordinate(coordinates[2*(start+i)], coordinates[2*(start+i)+1], worldSize));
+        }
+        auto size = static_cast<int>(points.size());
+        keep.assign(size, false);
+        if (size > 0) {
+            keep.front() = true;
+            keep.back() = true;
+        }
+        stack.clear();
+        if (size > 2) {
+            stack.emplace_back(0, size-1);
+        }
+        while(!stack.empty()) {
+            auto [first, last] = stack.back();
+            stack.pop_back();
+            auto maxDistanceSquared = 0.0;
+            auto farthest = first;
+            for(int i=first+1; i<last; i++) {
+                auto distanceSquared = squaredSegmentDistance(points[i], points[first], points[last]);
+                if (distanceSquared > maxDistanceSquared) {
+                    maxDistanceSquared = distanceSquared;
+                    farthest = i;
+                }
+            }
+            if (maxDistanceSquared > toleranceSquared) {
+                keep[farthest] = true;
+                stack.emplace_back(first, farthest);
+                stack.emplace_back(farthest, last);
+            }
+        }
+
+        // Parts that collapse are kept at full resolution; quantization will
+        // reduce them to a few units anyway
+        auto kept = static_cast<int>(std::count(keep.begin(), keep.end(), true));
+        auto simplify = (kept >= minimalSize);
+        auto simplifiedSize = 0;
+        for(int i=0; i<size; i++) {
+            if (!simplify || keep[i]) {
+                result.coordinates.append(coordinates[2*(start+i)]);
+                result.coordinates.append(coordinates[2*(start+i)+1]);
+                simplifiedSize++;
+            }
+        }
+        result.partSizes.append(simplifiedSize);
+        start += partSize;
+    }
+    return result;
+}
+
+
+//
+// VectorTileEncoder
+//
+
+GeoMaps::VectorTileEncoder::VectorTileEncoder(int zoom, int x, int y)
+    : m_zoom(zoom), m_x(x), m_y(y)
+{
+}
+
+
+void GeoMaps::VectorTileEncoder::addFeature(const VectorTileFeature& feature)
+{
+    if ((feature.geometryType == VectorTileFeature::Unknown) || !feature.boundingBox().intersects(bounds())) {
+        return;
+    }
+
+    // Project all parts to tile coordinates
+    QVector<QVector<TilePoint>> parts;
+    int index = 0;
+    foreach(auto partSize, feature.partSizes) {
+        QVector<TilePoint> part;
+        part.reserve(partSize);
+        for(int i=0; (i<partSize) && (index+1<feature.coordinates.size()); i++, index+=2) {
+            part.append(project(feature.coordinates[index], feature.coordinates[index+1]));
+        }
+        parts.append(part);
+    }
+
+    // Generate geometry
+    QVector<quint32> geometry;
+    qint32 cursorX = 0;
+    qint32 cursorY = 0;
+    switch(feature.geometryType) {
+    case VectorTileFeature::Point: {
+        const auto& point = parts[0][0];
+        if ((point.x < -buffer) || (point.x > extent+buffer) || (point.y < -buffer) || (point.y > extent+buffer)) {
+            return;
+        }
+        appendPart(geometry, parts[0], VectorTileFeature::Point, false, cursorX, cursorY);
+        break;
+    }
+    case VectorTileFeature::LineString:
+        foreach(auto piece, clipLine(parts[0])) {
+            appendPart(geometry, piece, VectorTileFeature::LineString, false, cursorX, cursorY);
+        }
+        break;
+    case VectorTileFeature::Polygon:
+        for(int i=0; i<parts.size(); i++) {
+            auto sizeBefore = geometry.size();
+            appendPart(geometry, clipRing(parts[i]), VectorTileFeature::Polygon, i == 0, cursorX, cursorY);
+
+            // Without outer ring, there is no polygon
+            if ((i == 0) && (geometry.size() == sizeBefore)) {
+                return;
+            }
+        }
+        break;
+    case VectorTileFeature::Unknown:
+        break;
+    }
+    if (geometry.isEmpty()) {
+        return;
+    }
+
+    // Generate tags
+    QVector<quint32> tags;
+    for(auto it = feature.properties.constBegin(); it != feature.properties.constEnd(); ++it) {
+        if (!it.value().isValid() || it.value().isNull()) {
+            continue;
+        }
+        tags.append(keyIndex(it.key()));
+        tags.append(valueIndex(it.value()));
+    }
+
+    // Encode feature and append it to the list
+    QByteArray message;
+    writePackedVarints(message, 2, tags);
+    writeTag(message, 3, varintType);
+    writeVarint(message, feature.geometryType);
+    writePackedVarints(message, 4, geometry);
+    writeBytes(m_features, 2, message);
+}
+
+
+void GeoMaps::VectorTileEncoder::appendPart(QVector<quint32>& geometry, const QVector<TilePoint>& part, VectorTileFeature::GeometryType type, bool clockwise, qint32& cursorX, qint32& cursorY) const
+{
+    // Quantize, removing consecutive duplicates. Quantization is what
+    // simplifies the geometry at low zoom levels.
+    QVector<QPoint> points;
+    points.reserve(part.size());
+    foreach(auto point, part) {
+        QPoint quantized(qRound(point.x), qRound(point.y));
+        if (points.isEmpty() || (points.last() != quantized)) {
+            points.append(quantized);
+        }
+    }
+    auto isRing = (type == VectorTileFeature::Polygon);
+    if (isRing) {
+        if ((points.size() > 1) && (points.first() == points.last())) {
+            points.removeLast();
+        }
+        if (points.size() < 3) {
+            return;
+        }
+
+        // Exterior rings must have positive area in tile coordinates,
+        // interior rings negative area
+        qint64 area = 0;
+        for(int i=0; i<points.size(); i++) {
+            const auto& a = points[i];
+            const auto& b = points[(i+1) % points.size()];
+            area += static_cast<qint64>(a.x())*b.y() - static_cast<qint64>(b.x())*a.y();
+        }
+        if (area == 0) {
+            return;
+        }
+        if ((area > 0) != clockwise) {
+            std::reverse(points.begin(), points.end());
+        }
+    }
+
+    // Points have exactly one vertex, lines at least two
+    if (points.isEmpty() || ((type == VectorTileFeature::LineString) && (points.size() < 2))) {
+        return;
+    }
+
+    geometry.append(command(moveTo, 1));
+    geometry.append(zigzag(points[0].x()-cursorX));
+    geometry.append(zigzag(points[0].y()-cursorY));
+    cursorX = points[0].x();
+    cursorY = points[0].y();
+    if (points.size() > 1) {
+        geometry.append(command(lineTo, static_cast<quint32>(points.size()-1)));
+        for(int i=1; i<points.size(); i++) {
+            geometry.append(zigzag(points[i].x()-cursorX));
+            geometry.append(zigzag(points[i].y()-cursorY));
+            cursorX = points[i].x();
+            cursorY = points[i].y();
+        }
+    }
+    if (isRing) {
+        geometry.append(command(closePath, 1));
+    }
+}
+
+
+auto GeoMaps::VectorTileEncoder::bounds() const -> RTree::Box
+{
+    auto worldSize = static_cast<double>(extent)*std::exp2(m_zoom);
+    auto longitude = [&](double px) {
+        return (px+m_x*static_cast<double>(extent))/worldSize*360.0-180.0;
+    };
+    auto latitude = [&](double py) {
+        return qRadiansToDegrees(std::atan(std::sinh(M_PI*(1.0-2.0*(py+m_y*static_cast<double>(extent))/worldSize))));
+    };
+    return {longitude(-buffer), latitude(extent+buffer), longitude(extent+buffer), latitude(-buffer)};
+}
+
+
+auto GeoMaps::VectorTileEncoder::clipLine(const QVector<TilePoint>& line) const -> QVector<QVector<TilePoint>>
+{
+    const double min = -buffer;
+    const double max = extent+buffer;
+
+    // Clip each segment with the Liang-Barsky algorithm, joining consecutive
+    // visible segments
+    QVector<QVector<TilePoint>> result;
+    bool previousVisible = false;
+    for(int i=0; i+1<line.size(); i++) {
+        auto a = line[i];
+        auto b = line[i+1];
+        auto dx = b.x-a.x;
+        auto dy = b.y-a.y;
+        double t0 = 0.0;
+        double t1 = 1.0;
+        bool visible = true;
+        const double p[4] = {-dx, dx, -dy, dy};
+        const double q[4] = {a.x-min, max-a.x, a.y-min, max-a.y};
+        for(int k=0; k<4; k++) {
+            if (p[k] == 0.0) {
+                if (q[k] < 0.0) {
+                    visible = false;
+                    break;
+                }
+                continue;
+            }
+            auto t = q[k]/p[k];
+            if (p[k] < 0.0) {
+                t0 = qMax(t0, t);
+            } else {
+                t1 = qMin(t1, t);
+            }
+            if (t0 > t1) {
+                visible = false;
+                break;
+            }
+        }
+        if (!visible) {
+            previousVisible = false;
+            continue;
+        }
+
+        TilePoint start {a.x+t0*dx, a.y+t0*dy};
+        TilePoint end {a.x+t1*dx, a.y+t1*dy};
+        if (!previousVisible || (t0 > 0.0)) {
+            result.append(QVector<TilePoint> {start});
+        }
+        result.last().append(end);
+        previousVisible = (t1 >= 1.0);
+    }
+    return result;
+}
+
+
+auto GeoMaps::VectorTileEncoder::clipRing(const QVector<TilePoint>& ring) const -> QVector<TilePoint>
+{
+    const double min = -buffer;
+    const double max = extent+buffer;
+
+    // Sutherland-Hodgman, one edge of the clip rectangle at a time
+    auto clipEdge = [](const QVector<TilePoint>& input, auto inside, auto intersect) {
+        QVector<TilePoint> output;
+        if (input.isEmpty()) {
+            return output;
+        }
+        auto previous = input.last();
+        foreach(auto current, input) {
+            if (inside(current)) {
+                if (!inside(previous)) {
+                    output.append(intersect(previous, current));
+                }
+                output.append(current);
+            } else if (inside(previous)) {
+                output.append(intersect(previous, current));
+            }
+            previous = current;
+        }
+        return output;
+    };
+    auto atX = [](double x) {
+        return [x](const TilePoint& a, const TilePoint& b) {
+            return TilePoint {x, a.y+(b.y-a.y)*(x-a.x)/(b.x-a.x)};
+        };
+    };
+    auto atY = [](double y) {
+        return [y](const TilePoint& a, const TilePoint& b) {
+            return TilePoint {a.x+(b.x-a.x)*(y-a.y)/(b.y-a.y), y};
+        };
+    };
+
+    auto result = clipEdge(ring, [min](const TilePoint& p) { return p.x >= min; }, atX(min));
+    result = clipEdge(result, [max](const TilePoint& p) { return p.x <= max; }, atX(max));
+    result = clipEdge(result, [min](const TilePoint& p) { return p.y >= min; }, atY(min));
+    result = clipEdge(result, [max](const TilePoint& p) { return p.y <= max; }, atY(max));
+    return result;
+}
+
+
+auto GeoMaps::VectorTileEncoder::encode(const QByteArray& layerName) const -> QByteArray
+{
+    QByteArray layer;
+    writeTag(layer, 15, varintType);
+    writeVarint(layer, 2);
+    writeBytes(layer, 1, layerName);
+    layer.append(m_features);
+    foreach(auto key, m_keys) {
+        writeBytes(layer, 3, key.toUtf8());
+    }
+    foreach(auto value, m_values) {
+        writeBytes(layer, 4, value);
+    }
+    writeTag(layer, 5, varintType);
+    writeVarint(layer, extent);
+
+    QByteArray tile;
+    writeBytes(tile, 3, layer);
+    return tile;
+}
+
+
+auto GeoMaps::VectorTileEncoder::keyIndex(const QString& key) -> quint32
+{
+    auto it = m_keyIndices.constFind(key);
+    if (it != m_keyIndices.constEnd()) {
+        return it.value();
+    }
+    auto index = static_cast<quint32>(m_keys.size());
+    m_keyIndices.insert(key, index);
+    m_keys.append(key);
+    return index;
+}
+
+
+auto GeoMaps::VectorTileEncoder::project(double latitude, double longitude) const -> TilePoint
+{
+    auto [x, y] = worldCoordinate(latitude, longitude, static_cast<double>(extent)*std::exp2(m_zoom));
+    return {x-m_x*static_cast<double>(extent), y-m_y*static_cast<double>(extent)};
+}
+
+
+auto GeoMaps::VectorTileEncoder::valueIndex(const QVariant& value) -> quint32
+{
+    // Encode the value message, which also serves as key for deduplication
+    QByteArray message;
+    switch(value.type()) {
+    case QVariant::Bool:
+        writeTag(message, 7, varintType);
+        writeVarint(message, value.toBool() ? 1 : 0);
+        break;
+    case QVariant::Double:
+    case QVariant::Int:
+    case QVariant::LongLong: {
+        writeTag(message, 3, fixed64Type);
+        auto number = value.toDouble();
+        quint64 bits = 0;
+        std::memcpy(&bits, &number, sizeof(bits));
+        bits = qToLittleEndian(bits);
+        message.append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+        break;
+    }
+    default:
+        writeBytes(message, 1, value.toString().toUtf8());
+        break;
+    }
+
+    auto it = m_valueIndices.constFind(message);
+    if (it != m_valueIndices.constEnd()) {
+        return it.value();
+    }
+    auto index = static_cast<quint32>(m_values.size());
+    m_valueIndices.insert(message, index);
+    m_values.append(message);
+    return index;
+}
@@ -0,0 +1,182 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QVariantMap>
+#include <QVector>
+
+#include "RTree.h"
+
+
+namespace GeoMaps {
+
+/*! \brief Geometry and properties of a GeoJSON feature, in flat arrays
+ *
+ * This struct holds a GeoJSON feature of type Point, LineString or Polygon in
+ * a form that can be cut into vector tiles quickly.
+ */
+
+struct VectorTileFeature
+{
+    /*! \brief Geometry type, numbered as in the Mapbox Vector Tile specification */
+    enum GeometryType : quint8 {
+        Unknown = 0,    /*!< Unsupported geometry */
+        Point = 1,      /*!< Single point */
+        LineString = 2, /*!< One line */
+        Polygon = 3     /*!< Polygon; the first part is the outer ring, all others are holes */
+    };
+
+    /*! \brief Constructs from a GeoJSON object
+     *
+     * @param geoJSONObject GeoJSON feature
+     *
+     * @returns The feature. If the geometry is not supported, geometryType is
+     * Unknown.
+     */
+    static VectorTileFeature fromGeoJSON(const QJsonObject& geoJSONObject);
+
+    /*! \brief Bounding box
+     *
+     * @returns Bounding box of all coordinates, in the format used by RTree
+     */
+    RTree::Box boundingBox() const;
+
+    /*! \brief Simplified feature, for tiles of a given zoom level
+     *
+     * This method simplifies every line and ring with the Douglas-Peucker
+     * algorithm, in the coordinates of the tiles at the given zoom level.
+     * The simplified geometry deviates from the original by no more than
+     * VectorTileEncoder::simplificationTolerance units. Lines and rings that
+     * would degenerate are left as they are. Points are never simplified.
+     *
+     * @param zoom Zoom level
+     *
+     * @returns Simplified feature, with the same properties
+     */
+    VectorTileFeature simplified(int zoom) const;
+
+    /*! \brief Type of the geometry */
+    GeometryType geometryType {Unknown};
+
+    /*! \brief Coordinates, as latitude/longitude pairs in degrees, all parts concatenated */
+    QVector<double> coordinates;
+
+    /*! \brief Number of coordinate pairs in each part (line or ring) */
+    QVector<int> partSizes;
+
+    /*! \brief Properties, as found in the GeoJSON feature */
+    QVariantMap properties;
+};
+
+
+/*! \brief Encoder for Mapbox Vector Tiles
+ *
+ * This class encodes features into a single-layer tile that follows the
+ * [Mapbox Vector Tile Specification 2.1](https://github.com/mapbox/vector-tile-spec/tree/master/2.1).
+ * Coordinates are projected to Web Mercator and quantized to the tile
+ * extent. Lines and polygons are clipped to the tile, with a buffer large
+ * enough to hide clipping artefacts at tile boundaries.
+ */
+
+class VectorTileEncoder
+{
+public:
+    /*! \brief Number of units per tile edge */
+    static constexpr int extent = 4096;
+
+    /*! \brief Width of the buffer around the tile, in units */
+    static constexpr int buffer = 128;
+
+    /*! \brief Maximal deviation of simplified features, in units
+     *
+     * With tiles rendered at 512 pixels, this is a quarter of a pixel.
+     */
+    static constexpr double simplificationTolerance = 2.0;
+
+    /*! \brief Constructs an encoder for a tile
+     *
+     * @param zoom Zoom level of the tile
+     *
+     * @param x Column of the tile
+     *
+     * @param y Row of the tile, counted from the north, as in XYZ URLs
+     */
+    VectorTileEncoder(int zoom, int x, int y);
+
+    /*! \brief Add a feature to the tile
+     *
+     * Features that do not intersect the tile (including its buffer) are
+     * silently ignored.
+     *
+     * @param feature Feature to add
+     */
+    void addFeature(const VectorTileFeature& feature);
+
+    /*! \brief Bounding box of the tile, including the buffer
+     *
+     * @returns Bounding box in degrees, in the format used by RTree
+     */
+    RTree::Box bounds() const;
+
+    /*! \brief Encode tile
+     *
+     * @param layerName Name of the layer
+     *
+     * @returns Tile in protobuf format, without compression
+     */
+    QByteArray encode(const QByteArray& layerName) const;
+
+private:
+    // Point in tile coordinates, before rounding
+    struct TilePoint {
+        double x;
+        double y;
+    };
+
+    // Index of a key or value in the respective table, adding it if needed
+    quint32 keyIndex(const QString& key);
+    quint32 valueIndex(const QVariant& value);
+
+    // Projects a coordinate to tile coordinates
+    TilePoint project(double latitude, double longitude) const;
+
+    // Clips a polygon ring or a line to the tile, including the buffer
+    QVector<TilePoint> clipRing(const QVector<TilePoint>& ring) const;
+    QVector<QVector<TilePoint>> clipLine(const QVector<TilePoint>& line) const;
+
+    // Appends geometry commands for one part to the geometry. For rings,
+    // clockwise indicates an exterior ring.
+    void appendPart(QVector<quint32>& geometry, const QVector<TilePoint>& part, VectorTileFeature::GeometryType type, bool clockwise, qint32& cursorX, qint32& cursorY) const;
+
+    int m_zoom;
+    int m_x;
+    int m_y;
+
+    QByteArray m_features;
+    QHash<QString, quint32> m_keyIndices;
+    QVector<QString> m_keys;
+    QHash<QByteArray, quint32> m_valueIndices;
+    QVector<QByteArray> m_values;
+};
+
+};
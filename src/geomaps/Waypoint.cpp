@@ -19,17 +19,100 @@
  ***************************************************************************/
 
 
+#include <QHash>
 #include <QJsonArray>
+#include <QReadWriteLock>
+#include <algorithm>
 
 #include "Waypoint.h"
 #include "units/Distance.h"
 
 
+namespace {
+
+// Table of property keys that are not held in typed members. Since
+// waypoints are constructed in several threads at the same time, access is
+// guarded by a lock. The table only grows, so indices remain valid forever.
+class KeyTable
+{
+public:
+    // Index of the key, adding it if needed
+    quint32 indexOf(const QString& key)
+    {
+        {
+            QReadLocker locker(&m_lock);
+            auto it = m_indices.constFind(key);
+            if (it != m_indices.constEnd()) {
+                return it.value();
+            }
+        }
+        QWriteLocker locker(&m_lock);
+        auto it = m_indices.constFind(key);
+        if (it != m_indices.constEnd()) {
+            return it.value();
+        }
+        auto index = static_cast<quint32>(m_keys.size());
+        m_indices.insert(key, index);
+        m_keys.append(key);
+        return index;
+    }
+
+    // Index of the key, or -1 if the key is unknown
+    qint64 find(const QString& key) const
+    {
+        QReadLocker locker(&m_lock);
+        auto it = m_indices.constFind(key);
+        if (it == m_indices.constEnd()) {
+            return -1;
+        }
+        return it.value();
+    }
+
+    // Key with the given index
+    QString key(quint32 index) const
+    {
+        QReadLocker locker(&m_lock);
+        return m_keys.value(static_cast<int>(index));
+    }
+
+private:
+    mutable QReadWriteLock m_lock;
+    QHash<QString, quint32> m_indices;
+    QVector<QString> m_keys;
+};
+
+auto keyTable() -> KeyTable&
+{
+    static KeyTable table;
+    return table;
+}
+
+// Types and categories of waypoints, as defined in the GeoJSON
+// specification. Index zero is unused, so that default-initialized members
+// never refer to a valid entry.
+auto types() -> const QStringList&
+{
+    static const QStringList table {QString(), "AD", "NAV", "WP"};
+    return table;
+}
+
+auto categories() -> const QStringList&
+{
+    static const QStringList table {QString(),
+                "AD", "AD-GLD", "AD-GRASS", "AD-INOP", "AD-MIL", "AD-MIL-GRASS", "AD-MIL-PAVED", "AD-PAVED", "AD-UL", "AD-WATER",
+                "DVOR", "DVOR-DME", "DVORTAC", "NDB", "VOR", "VOR-DME", "VORTAC",
+                "MRP", "RP", "WP"};
+    return table;
+}
+
+}
+
+
 GeoMaps::Waypoint::Waypoint()
 {
-    m_properties.insert("CAT", QString("WP"));
-    m_properties.insert("NAM", QString("Waypoint"));
-    m_properties.insert("TYP", QString("WP"));
+    setProperty(QStringLiteral("CAT"), QStringLiteral("WP"));
+    setProperty(QStringLiteral("NAM"), QStringLiteral("Waypoint"));
+    setProperty(QStringLiteral("TYP"), QStringLiteral("WP"));
 
     // Set cached property
     m_isValid = computeIsValid();
@@ -39,9 +122,21 @@ GeoMaps::Waypoint::Waypoint()
 GeoMaps::Waypoint::Waypoint(const QGeoCoordinate& coordinate)
     : m_coordinate(coordinate)
 {
-    m_properties.insert("CAT", QString("WP"));
-    m_properties.insert("NAM", QString("Waypoint"));
-    m_properties.insert("TYP", QString("WP"));
+    setProperty(QStringLiteral("CAT"), QStringLiteral("WP"));
+    setProperty(QStringLiteral("NAM"), QStringLiteral("Waypoint"));
+    setProperty(QStringLiteral("TYP"), QStringLiteral("WP"));
+
+    // Set cached property
+    m_isValid = computeIsValid();
+}
+
+
+GeoMaps::Waypoint::Waypoint(const QGeoCoordinate& coordinate, const QMultiMap<QString, QVariant>& properties)
+    : m_coordinate(coordinate)
+{
+    for(auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+        setProperty(it.key(), it.value());
+    }
 
     // Set cached property
     m_isValid = computeIsValid();
@@ -61,7 +156,7 @@ GeoMaps::Waypoint::Waypoint(const QJsonObject &geoJSONObject)
     }
     auto properties = geoJSONObject["properties"].toObject();
     foreach(auto propertyName, properties.keys())
-        m_properties.insert(propertyName, properties[propertyName].toVariant());
+        setProperty(propertyName, properties[propertyName].toVariant());
 
     // Get geometry
     if (!geoJSONObject.contains("geometry")) {
@@ -79,7 +174,7 @@ GeoMaps::Waypoint::Waypoint(const QJsonObject &geoJSONObject)
         return;
     }
     m_coordinate = QGeoCoordinate(coordinateArray[1].toDouble(), coordinateArray[0].toDouble() );
-    if (m_properties.contains("ELE")) {
+    if (hasProperty("ELE")) {
         m_coordinate.setAltitude(properties["ELE"].toDouble());
     }
 
@@ -97,18 +192,18 @@ auto GeoMaps::Waypoint::computeIsValid() const -> bool
     if (!m_coordinate.isValid()) {
         return false;
     }
-    if (!m_properties.contains("TYP")) {
+    if (!hasProperty("TYP")) {
         return false;
     }
-    auto TYP = m_properties.value("TYP").toString();
+    auto TYP = property("TYP").toString();
 
     // Handle airfields
     if (TYP == "AD") {
         // Property CAT
-        if (!m_properties.contains("CAT")) {
+        if (!hasProperty("CAT")) {
             return false;
         }
-        auto CAT = m_properties.value("CAT").toString();
+        auto CAT = property("CAT").toString();
         if ((CAT != "AD") && (CAT != "AD-GRASS") && (CAT != "AD-PAVED") &&
                 (CAT != "AD-INOP") && (CAT != "AD-GLD") && (CAT != "AD-MIL") &&
                 (CAT != "AD-MIL-GRASS") && (CAT != "AD-MIL-PAVED") && (CAT != "AD-UL") &&
@@ -117,17 +212,17 @@ auto GeoMaps::Waypoint::computeIsValid() const -> bool
         }
 
         // Property ELE
-        if (!m_properties.contains("ELE")) {
+        if (!hasProperty("ELE")) {
             return false;
         }
         bool ok = false;
-        m_properties.value("ELE").toInt(&ok);
+        property("ELE").toInt(&ok);
         if (!ok) {
             return false;
         }
 
         // Property NAM
-        if (!m_properties.contains("NAM")) {
+        if (!hasProperty("NAM")) {
             return false;
         }
         return true;
@@ -136,10 +231,10 @@ auto GeoMaps::Waypoint::computeIsValid() const -> bool
     // Handle NavAids
     if (TYP == "NAV") {
         // Property CAT
-        if (!m_properties.contains("CAT")) {
+        if (!hasProperty("CAT")) {
             return false;
         }
-        auto CAT = m_properties.value("CAT").toString();
+        auto CAT = property("CAT").toString();
         if ((CAT != "NDB") && (CAT != "VOR") && (CAT != "VOR-DME") &&
                 (CAT != "VORTAC") && (CAT != "DVOR") && (CAT != "DVOR-DME") &&
                 (CAT != "DVORTAC")) {
@@ -147,22 +242,22 @@ auto GeoMaps::Waypoint::computeIsValid() const -> bool
         }
 
         // Property COD
-        if (!m_properties.contains("COD")) {
+        if (!hasProperty("COD")) {
             return false;
         }
 
         // Property NAM
-        if (!m_properties.contains("NAM")) {
+        if (!hasProperty("NAM")) {
             return false;
         }
 
         // Property NAV
-        if (!m_properties.contains("NAV")) {
+        if (!hasProperty("NAV")) {
             return false;
         }
 
         // Property MOR
-        if (!m_properties.contains("MOR")) {
+        if (!hasProperty("MOR")) {
             return false;
         }
 
@@ -172,29 +267,29 @@ auto GeoMaps::Waypoint::computeIsValid() const -> bool
     // Handle waypoints
     if (TYP == "WP") {
         // Property CAT
-        if (!m_properties.contains("CAT")) {
+        if (!hasProperty("CAT")) {
             return false;
         }
-        auto CAT = m_properties.value("CAT").toString();
+        auto CAT = property("CAT").toString();
         if ((CAT != "MRP") && (CAT != "RP") && (CAT != "WP")) {
             return false;
         }
 
         // Property COD
         if ((CAT == "MRP") || (CAT == "RP")) {
-            if (!m_properties.contains("COD")) {
+            if (!hasProperty("COD")) {
                 return false;
             }
         }
 
         // Property NAM
-        if (!m_properties.contains("NAM")) {
+        if (!hasProperty("NAM")) {
             return false;
         }
 
         // Property SCO
         if ((CAT == "MRP") || (CAT == "RP")) {
-            if (!m_properties.contains("SCO")) {
+            if (!hasProperty("SCO")) {
                 return false;
             }
         }
@@ -207,6 +302,155 @@ auto GeoMaps::Waypoint::computeIsValid() const -> bool
 }
 
 
+auto GeoMaps::Waypoint::hasProperty(const QString& key) const -> bool
+{
+    if (key == QLatin1String("CAT")) {
+        if ((m_coreProperties & CategoryProperty) != 0) {
+            return true;
+        }
+    } else if (key == QLatin1String("COD")) {
+        if ((m_coreProperties & ICAOCodeProperty) != 0) {
+            return true;
+        }
+    } else if (key == QLatin1String("ELE")) {
+        if ((m_coreProperties & ElevationProperty) != 0) {
+            return true;
+        }
+    } else if (key == QLatin1String("NAM")) {
+        if ((m_coreProperties & NameProperty) != 0) {
+            return true;
+        }
+    } else if (key == QLatin1String("TYP")) {
+        if ((m_coreProperties & TypeProperty) != 0) {
+            return true;
+        }
+    }
+
+    auto index = keyTable().find(key);
+    if (index < 0) {
+        return false;
+    }
+    return std::any_of(m_extras.cbegin(), m_extras.cend(), [index](const Extra& extra) { return extra.key == index; });
+}
+
+
+auto GeoMaps::Waypoint::property(const QString& key) const -> QVariant
+{
+    if ((key == QLatin1String("CAT")) && ((m_coreProperties & CategoryProperty) != 0)) {
+        return categories().at(m_category);
+    }
+    if ((key == QLatin1String("COD")) && ((m_coreProperties & ICAOCodeProperty) != 0)) {
+        return m_ICAOCode;
+    }
+    if ((key == QLatin1String("ELE")) && ((m_coreProperties & ElevationProperty) != 0)) {
+        return m_elevation;
+    }
+    if ((key == QLatin1String("NAM")) && ((m_coreProperties & NameProperty) != 0)) {
+        return m_name;
+    }
+    if ((key == QLatin1String("TYP")) && ((m_coreProperties & TypeProperty) != 0)) {
+        return types().at(m_type);
+    }
+
+    auto index = keyTable().find(key);
+    if (index < 0) {
+        return {};
+    }
+    foreach(const auto& extra, m_extras) {
+        if (extra.key == index) {
+            return extra.value;
+        }
+    }
+    return {};
+}
+
+
+auto GeoMaps::Waypoint::properties() const -> QMultiMap<QString, QVariant>
+{
+    QMultiMap<QString, QVariant> result;
+    if ((m_coreProperties & CategoryProperty) != 0) {
+        result.insert(QStringLiteral("CAT"), categories().at(m_category));
+    }
+    if ((m_coreProperties & ICAOCodeProperty) != 0) {
+        result.insert(QStringLiteral("COD"), m_ICAOCode);
+    }
+    if ((m_coreProperties & ElevationProperty) != 0) {
+        result.insert(QStringLiteral("ELE"), m_elevation);
+    }
+    if ((m_coreProperties & NameProperty) != 0) {
+        result.insert(QStringLiteral("NAM"), m_name);
+    }
+    if ((m_coreProperties & TypeProperty) != 0) {
+        result.insert(QStringLiteral("TYP"), types().at(m_type));
+    }
+    foreach(const auto& extra, m_extras) {
+        result.insert(keyTable().key(extra.key), extra.value);
+    }
+    return result;
+}
+
+
+void GeoMaps::Waypoint::setProperty(const QString& key, const QVariant& value)
+{
+    // Remove previous value
+    if (key == QLatin1String("CAT")) {
+        m_coreProperties &= ~CategoryProperty;
+    } else if (key == QLatin1String("COD")) {
+        m_coreProperties &= ~ICAOCodeProperty;
+        m_ICAOCode.clear();
+    } else if (key == QLatin1String("ELE")) {
+        m_coreProperties &= ~ElevationProperty;
+    } else if (key == QLatin1String("NAM")) {
+        m_coreProperties &= ~NameProperty;
+        m_name.clear();
+    } else if (key == QLatin1String("TYP")) {
+        m_coreProperties &= ~TypeProperty;
+    }
+    auto index = keyTable().find(key);
+    if (index >= 0) {
+        m_extras.erase(std::remove_if(m_extras.begin(), m_extras.end(), [index](const Extra& extra) { return extra.key == index; }), m_extras.end());
+    }
+
+    // Store values of the expected type in typed members
+    if (key == QLatin1String("CAT") && (value.type() == QVariant::String)) {
+        auto category = categories().indexOf(value.toString());
+        if (category > 0) {
+            m_coreProperties |= CategoryProperty;
+            m_category = static_cast<quint8>(category);
+            return;
+        }
+    }
+    if (key == QLatin1String("COD") && (value.type() == QVariant::String)) {
+        m_coreProperties |= ICAOCodeProperty;
+        m_ICAOCode = value.toString();
+        return;
+    }
+    if (key == QLatin1String("ELE") && (value.type() == QVariant::Double)) {
+        m_coreProperties |= ElevationProperty;
+        m_elevation = value.toDouble();
+        return;
+    }
+    if (key == QLatin1String("NAM") && (value.type() == QVariant::String)) {
+        m_coreProperties |= NameProperty;
+        m_name = value.toString();
+        return;
+    }
+    if (key == QLatin1String("TYP") && (value.type() == QVariant::String)) {
+        auto type = types().indexOf(value.toString());
+        if (type > 0) {
+            m_coreProperties |= TypeProperty;
+            m_type = static_cast<quint8>(type);
+            return;
+        }
+    }
+
+    // Store everything else as an extra, keeping the extras sorted
+    Extra extra {keyTable().indexOf(key), value};
+    auto it = std::lower_bound(m_extras.begin(), m_extras.end(), extra, [](const Extra& a, const Extra& b) { return a.key < b.key; });
+    m_extras.insert(it, extra);
+}
+
+
 auto GeoMaps::Waypoint::isNear(const Waypoint& other) const -> bool
 {
     if (!m_coordinate.isValid()) {
@@ -223,7 +467,9 @@ auto GeoMaps::Waypoint::isNear(const Waypoint& other) const -> bool
 auto GeoMaps::Waypoint::renamed(const QString &newName) const -> GeoMaps::Waypoint
 {
     Waypoint copy(*this);
-    copy.m_properties.replace("NAM", newName);
+    copy.setProperty(QStringLiteral("NAM"), newName);
+    // The copy must not share the strings computed for the old name
+    copy.m_presentation = std::make_shared<Presentation>();
     return copy;
 }
 
@@ -238,7 +484,7 @@ auto GeoMaps::Waypoint::toJSON() const -> QJsonObject
     geometry.insert("coordinates", coords);
     QJsonObject feature;
     feature.insert("type", "Feature");
-    feature.insert("properties", QJsonObject::fromVariantMap(m_properties));
+    feature.insert("properties", QJsonObject::fromVariantMap(properties()));
     feature.insert("geometry", geometry);
 
     return feature;
@@ -250,17 +496,60 @@ auto GeoMaps::Waypoint::toJSON() const -> QJsonObject
 //
 
 
-auto GeoMaps::Waypoint::extendedName() const -> QString
+auto GeoMaps::Waypoint::presentation() const -> const Presentation&
 {
-    if (m_properties.value("TYP").toString() == "NAV") {
-        return QString("%1 (%2)").arg(m_properties.value("NAM").toString(), m_properties.value("CAT").toString());
+    // Paranoid safety check. This can only happen for waypoints that have
+    // been moved from.
+    static Presentation empty;
+    if (!m_presentation) {
+        return empty;
     }
 
-    return m_properties.value("NAM").toString();
+    std::call_once(m_presentation->computed, [this]() {
+        m_presentation->extendedName = computeExtendedName();
+        m_presentation->icon = computeIcon();
+        m_presentation->tabularDescription = computeTabularDescription();
+        m_presentation->twoLineTitle = computeTwoLineTitle();
+    });
+    return *m_presentation;
+}
+
+
+auto GeoMaps::Waypoint::extendedName() const -> QString
+{
+    return presentation().extendedName;
 }
 
 
 auto GeoMaps::Waypoint::icon() const -> QString
+{
+    return presentation().icon;
+}
+
+
+auto GeoMaps::Waypoint::tabularDescription() const -> QList<QString>
+{
+    return presentation().tabularDescription;
+}
+
+
+auto GeoMaps::Waypoint::twoLineTitle() const -> QString
+{
+    return presentation().twoLineTitle;
+}
+
+
+auto GeoMaps::Waypoint::computeExtendedName() const -> QString
+{
+    if (property("TYP").toString() == "NAV") {
+        return QString("%1 (%2)").arg(m_name, category());
+    }
+
+    return m_name;
+}
+
+
+auto GeoMaps::Waypoint::computeIcon() const -> QString
 {
     auto CAT = category();
 
@@ -275,47 +564,47 @@ auto GeoMaps::Waypoint::icon() const -> QString
 }
 
 
-auto GeoMaps::Waypoint::tabularDescription() const -> QList<QString>
+auto GeoMaps::Waypoint::computeTabularDescription() const -> QList<QString>
 {
     QList<QString> result;
 
-    if (m_properties.value("TYP").toString() == "NAV") {
-        result.append("ID  " + m_properties.value("COD").toString() + " " + m_properties.value("MOR").toString());
-        result.append("NAV " + m_properties.value("NAV").toString());
-        if (m_properties.contains("ELE")) {
-            result.append(QString("ELEV%1 ft AMSL").arg(qRound(Units::Distance::fromM(m_properties.value("ELE").toDouble()).toFeet())));
+    if (property("TYP").toString() == "NAV") {
+        result.append("ID  " + property("COD").toString() + " " + property("MOR").toString());
+        result.append("NAV " + property("NAV").toString());
+        if (hasProperty("ELE")) {
+            result.append(QString("ELEV%1 ft AMSL").arg(qRound(Units::Distance::fromM(property("ELE").toDouble()).toFeet())));
         }
     }
 
-    if (m_properties.value("TYP").toString() == "AD") {
-        if (m_properties.contains("COD")) {
-            result.append("ID  " + m_properties.value("COD").toString());
+    if (property("TYP").toString() == "AD") {
+        if (hasProperty("COD")) {
+            result.append("ID  " + property("COD").toString());
         }
-        if (m_properties.contains("INF")) {
-            result.append("INF " + m_properties.value("INF").toString().replace("\n", "<br>"));
+        if (hasProperty("INF")) {
+            result.append("INF " + property("INF").toString().replace("\n", "<br>"));
         }
-        if (m_properties.contains("COM")) {
-            result.append("COM " + m_properties.value("COM").toString().replace("\n", "<br>"));
+        if (hasProperty("COM")) {
+            result.append("COM " + property("COM").toString().replace("\n", "<br>"));
         }
-        if (m_properties.contains("NAV")) {
-            result.append("NAV " + m_properties.value("NAV").toString().replace("\n", "<br>"));
+        if (hasProperty("NAV")) {
+            result.append("NAV " + property("NAV").toString().replace("\n", "<br>"));
         }
-        if (m_properties.contains("OTH")) {
-            result.append("OTH " + m_properties.value("OTH").toString().replace("\n", "<br>"));
+        if (hasProperty("OTH")) {
+            result.append("OTH " + property("OTH").toString().replace("\n", "<br>"));
         }
-        if (m_properties.contains("RWY")) {
-            result.append("RWY " + m_properties.value("RWY").toString().replace("\n", "<br>"));
+        if (hasProperty("RWY")) {
+            result.append("RWY " + property("RWY").toString().replace("\n", "<br>"));
         }
 
-        result.append( QString("ELEV%1 ft AMSL").arg(qRound(Units::Distance::fromM(m_properties.value("ELE").toDouble()).toFeet())));
+        result.append( QString("ELEV%1 ft AMSL").arg(qRound(Units::Distance::fromM(property("ELE").toDouble()).toFeet())));
     }
 
-    if (m_properties.value("TYP").toString() == "WP") {
-        if (m_properties.contains("ICA")) {
-            result.append("ID  " + m_properties.value("COD").toString());
+    if (property("TYP").toString() == "WP") {
+        if (hasProperty("ICA")) {
+            result.append("ID  " + property("COD").toString());
         }
-        if (m_properties.contains("COM")) {
-            result.append("COM " + m_properties.value("COM").toString());
+        if (hasProperty("COM")) {
+            result.append("COM " + property("COM").toString());
         }
     }
 
@@ -323,19 +612,19 @@ auto GeoMaps::Waypoint::tabularDescription() const -> QList<QString>
 }
 
 
-auto GeoMaps::Waypoint::twoLineTitle() const -> QString
+auto GeoMaps::Waypoint::computeTwoLineTitle() const -> QString
 {
     QString codeName;
-    if (m_properties.contains("COD")) {
-        codeName += m_properties.value("COD").toString();
+    if (hasProperty("COD")) {
+        codeName += property("COD").toString();
     }
-    if (m_properties.contains("MOR")) {
-        codeName += " " + m_properties.value("MOR").toString();
+    if (hasProperty("MOR")) {
+        codeName += " " + property("MOR").toString();
     }
 
     if (!codeName.isEmpty()) {
-        return QString("<strong>%1</strong><br><font size='2'>%2</font>").arg(codeName, extendedName());
+        return QString("<strong>%1</strong><br><font size='2'>%2</font>").arg(codeName, computeExtendedName());
     }
 
-    return extendedName();
+    return computeExtendedName();
 }
@@ -23,6 +23,9 @@
 #include <QGeoCoordinate>
 #include <QMap>
 #include <QJsonObject>
+#include <QVector>
+#include <memory>
+#include <mutex>
 
 
 namespace GeoMaps {
@@ -32,6 +35,16 @@ namespace GeoMaps {
  * This class represents a waypoint.  The properties stored in this class correspond to the feature of the GeoJSON files
  * that are used in Enroute, as described
  * [here](https://github.com/Akaflieg-Freiburg/enrouteServer/wiki/GeoJSON-files-used-in-enroute-flight-navigation).
+ *
+ * Since the app holds tens of thousands of waypoints in memory, the class
+ * stores the properties in compact form. Type, category, name, ICAO code and
+ * elevation are held in typed members. All other properties are rare; they
+ * are held in a small, implicitly shared vector whose keys are interned in a
+ * table that is shared by all waypoints.
+ *
+ * The strings shown in the GUI (extendedName, icon, tabularDescription and
+ * twoLineTitle) are computed on first use, in a thread-safe manner, and are
+ * shared by all copies of the waypoint.
  */
 
 class Waypoint
@@ -61,6 +74,18 @@ public:
      */
     Waypoint(const QGeoCoordinate& coordinate);
 
+    /*! \brief Constructs a waypoint from a coordinate and a set of properties
+     *
+     * The properties are those found in the "properties" member of a GeoJSON
+     * description of the waypoint. This constructor is used to restore
+     * waypoints from a binary cache without parsing GeoJSON.
+     *
+     * @param coordinate Geographical position of the waypoint
+     *
+     * @param properties Properties of the waypoint
+     */
+    Waypoint(const QGeoCoordinate& coordinate, const QMultiMap<QString, QVariant>& properties);
+
     /*! \brief Constructs a waypoint from a GeoJSON object
      *
      * This method constructs a Waypoint from a GeoJSON description.  The
@@ -105,7 +130,14 @@ public:
      */
     bool operator==(const Waypoint &other) const
     {
-        return (m_coordinate == other.m_coordinate) && (m_properties == other.m_properties);
+        return (m_coordinate == other.m_coordinate) &&
+                (m_coreProperties == other.m_coreProperties) &&
+                (m_type == other.m_type) &&
+                (m_category == other.m_category) &&
+                (m_elevation == other.m_elevation) &&
+                (m_ICAOCode == other.m_ICAOCode) &&
+                (m_name == other.m_name) &&
+                (m_extras == other.m_extras);
     }
 
     /*! \brief Copy waypoint and change name
@@ -127,6 +159,13 @@ public:
      */
     QJsonObject toJSON() const;
 
+    /*! \brief Properties of the waypoint
+     *
+     * @returns The properties of the waypoint, as found in the "properties"
+     * member of its GeoJSON description
+     */
+    QMultiMap<QString, QVariant> properties() const;
+
 
     //
     // PROPERTIES
@@ -146,7 +185,7 @@ public:
      */
     QString category() const
     {
-        return m_properties.value("CAT").toString();
+        return property(QStringLiteral("CAT")).toString();
     }
 
     /*! \brief Coordinate of the waypoint
@@ -189,7 +228,7 @@ public:
      */
     QString ICAOCode() const
     {
-        return m_properties.value("COD").toString();
+        return m_ICAOCode;
     }
 
     /*! \brief Suggested icon for use in GUI
@@ -233,7 +272,7 @@ public:
      */
     QString name() const
     {
-        return m_properties.value("NAM").toString();
+        return m_name;
     }
 
     /* \brief Verbose description of waypoint properties
@@ -282,17 +321,83 @@ public:
      */
     QString type() const
     {
-        return m_properties.value("TYP").toString();
+        return property(QStringLiteral("TYP")).toString();
     }
 
 private:
     // Computes the property isValid; this is used by the constructors to set the cached value
     bool computeIsValid() const;
 
+    // Strings for the GUI, computed once and shared by all copies of a
+    // waypoint. Every constructed waypoint receives a new, empty instance;
+    // renamed() gives the copy an instance of its own.
+    struct Presentation {
+        std::once_flag computed;
+        QString extendedName;
+        QString icon;
+        QList<QString> tabularDescription;
+        QString twoLineTitle;
+    };
+
+    // Returns m_presentation, computing the strings if necessary
+    const Presentation& presentation() const;
+
+    // Compute the strings held in Presentation
+    QString computeExtendedName() const;
+    QString computeIcon() const;
+    QList<QString> computeTabularDescription() const;
+    QString computeTwoLineTitle() const;
+
+    // Access to the properties, as found in the GeoJSON description,
+    // regardless of how they are stored. Setting a property replaces any
+    // previous value.
+    bool hasProperty(const QString& key) const;
+    QVariant property(const QString& key) const;
+    void setProperty(const QString& key, const QVariant& value);
+
+    // Flags for the properties held in typed members
+    enum CoreProperty : quint8 {
+        CategoryProperty = 1,
+        ElevationProperty = 2,
+        ICAOCodeProperty = 4,
+        NameProperty = 8,
+        TypeProperty = 16
+    };
+
+    // Property that is not held in a typed member. The key is an index into
+    // the table of interned keys.
+    struct Extra {
+        quint32 key;
+        QVariant value;
+
+        bool operator==(const Extra& other) const
+        {
+            return (key == other.key) && (value == other.value);
+        }
+    };
+
 protected:
     bool m_isValid {false};
     QGeoCoordinate m_coordinate;
-    QMultiMap<QString, QVariant> m_properties;
+
+    // Combination of CoreProperty flags, indicating which typed members are set
+    quint8 m_coreProperties {0};
+
+    // Indices into the tables of known types and categories
+    quint8 m_type {0};
+    quint8 m_category {0};
+
+    // Properties held in typed members. The name and the ICAO code are empty
+    // if the corresponding property does not exist or is not a string.
+    double m_elevation {0.0};
+    QString m_ICAOCode;
+    QString m_name;
+
+    // All other properties, sorted by key index
+    QVector<Extra> m_extras;
+
+    // Cached strings for the GUI
+    std::shared_ptr<Presentation> m_presentation {std::make_shared<Presentation>()};
 };
 
 }
@@ -0,0 +1,100 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <utility>
+
+#include "WaypointListModel.h"
+
+
+GeoMaps::WaypointListModel::WaypointListModel(QVector<Waypoint> waypoints, QObject* parent)
+    : QAbstractListModel(parent), m_waypoints(std::move(waypoints))
+{
+}
+
+
+auto GeoMaps::WaypointListModel::canFetchMore(const QModelIndex& parent) const -> bool
+{
+    if (parent.isValid()) {
+        return false;
+    }
+    return m_rows.size() < m_waypoints.size();
+}
+
+
+auto GeoMaps::WaypointListModel::data(const QModelIndex& index, int role) const -> QVariant
+{
+    // Paranoid safety checks
+    if (!index.isValid() || (index.row() >= m_rows.size())) {
+        return {};
+    }
+
+    switch(role) {
+    case WaypointRole:
+        return QVariant::fromValue(m_waypoints.at(index.row()));
+    case IconRole:
+        return m_rows.at(index.row()).icon;
+    case TwoLineTitleRole:
+        return m_rows.at(index.row()).twoLineTitle;
+    default:
+        return {};
+    }
+}
+
+
+void GeoMaps::WaypointListModel::fetchMore(const QModelIndex& parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+
+    auto first = m_rows.size();
+    auto last = qMin(first+pageSize, m_waypoints.size())-1;
+    beginInsertRows(QModelIndex(), first, last);
+    m_rows.reserve(last+1);
+    for(int i=first; i<=last; i++) {
+        const auto& waypoint = m_waypoints.at(i);
+        m_rows.append({waypoint.icon(), waypoint.twoLineTitle()});
+    }
+    endInsertRows();
+}
+
+
+auto GeoMaps::WaypointListModel::roleNames() const -> QHash<int, QByteArray>
+{
+    return {{WaypointRole, "modelData"}, {IconRole, "icon"}, {TwoLineTitleRole, "twoLineTitle"}};
+}
+
+
+auto GeoMaps::WaypointListModel::rowCount(const QModelIndex& parent) const -> int
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_rows.size();
+}
+
+
+auto GeoMaps::WaypointListModel::waypoint(int index) const -> Waypoint
+{
+    if ((index < 0) || (index >= m_waypoints.size())) {
+        return {};
+    }
+    return m_waypoints.at(index);
+}
@@ -0,0 +1,145 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QVector>
+
+#include "Waypoint.h"
+
+namespace GeoMaps {
+
+/*! \brief Paged list model for lists of waypoints
+ *
+ *  This class exposes a list of waypoints, such as the result of a search,
+ *  to QML views. The list is held in C++. Rows are handed to the view in
+ *  pages of pageSize rows, as the view scrolls, via canFetchMore() and
+ *  fetchMore(). The fields shown by the delegates are computed once per row
+ *  when the page is fetched:
+ *
+ *  - "modelData" holds the waypoint, as a GeoMaps::Waypoint
+ *  - "icon" holds the icon of the waypoint, as returned by Waypoint::icon()
+ *  - "twoLineTitle" holds the title, as returned by Waypoint::twoLineTitle()
+ *
+ *  Broad searches with thousands of results therefore cost no more than the
+ *  rows actually shown.
+ */
+
+class WaypointListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Roles of the model */
+    enum Roles {
+        WaypointRole = Qt::UserRole+1, /*!< Waypoint */
+        IconRole,                      /*!< Icon of the waypoint */
+        TwoLineTitleRole               /*!< Title of the waypoint */
+    };
+    Q_ENUM(Roles)
+
+    /*! \brief Number of rows fetched at a time */
+    static constexpr int pageSize = 40;
+
+    /*! \brief Constructs a model
+     *
+     * @param waypoints Waypoints shown by the model, in the order given
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit WaypointListModel(QVector<Waypoint> waypoints, QObject* parent = nullptr);
+
+    // Standard destructor
+    ~WaypointListModel() override = default;
+
+    /*! \brief Implementation of QAbstractListModel::canFetchMore
+     *
+     * @param parent Parent index, must be invalid
+     *
+     * @returns True if not all waypoints have been fetched
+     */
+    bool canFetchMore(const QModelIndex& parent) const override;
+
+    /*! \brief Implementation of QAbstractListModel::data
+     *
+     * @param index Index of the waypoint
+     *
+     * @param role Role
+     *
+     * @returns Data
+     */
+    QVariant data(const QModelIndex& index, int role = WaypointRole) const override;
+
+    /*! \brief Implementation of QAbstractListModel::fetchMore
+     *
+     * This method makes the next pageSize waypoints available.
+     *
+     * @param parent Parent index, must be invalid
+     */
+    void fetchMore(const QModelIndex& parent) override;
+
+    /*! \brief Implementation of QAbstractListModel::roleNames
+     *
+     * @returns Role names
+     */
+    QHash<int, QByteArray> roleNames() const override;
+
+    /*! \brief Implementation of QAbstractListModel::rowCount
+     *
+     * @param parent Parent index, must be invalid
+     *
+     * @returns Number of waypoints fetched so far
+     */
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    /*! \brief Total number of waypoints
+     *
+     * @returns Number of waypoints, including those not yet fetched
+     */
+    Q_INVOKABLE int size() const
+    {
+        return m_waypoints.size();
+    }
+
+    /*! \brief Waypoint by index
+     *
+     * @param index Index of the waypoint. The waypoint need not have been
+     * fetched.
+     *
+     * @returns The waypoint, or an invalid waypoint if the index is out of
+     * range
+     */
+    Q_INVOKABLE GeoMaps::Waypoint waypoint(int index) const;
+
+private:
+    Q_DISABLE_COPY_MOVE(WaypointListModel)
+
+    // Fields computed when a row is fetched
+    struct Row {
+        QString icon;
+        QString twoLineTitle;
+    };
+
+    QVector<Waypoint> m_waypoints;
+    QVector<Row> m_rows;
+};
+
+}
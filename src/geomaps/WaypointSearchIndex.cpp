@@ -0,0 +1,137 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+#include "WaypointSearchIndex.h"
+
+
+GeoMaps::WaypointSearchIndex::WaypointSearchIndex(const QVector<Waypoint>& waypoints)
+{
+    m_names.reserve(waypoints.size());
+    m_codes.reserve(waypoints.size());
+    for(int i=0; i<waypoints.size(); i++) {
+        m_names.append(normalize(waypoints[i].name()));
+        m_codes.append(normalize(waypoints[i].ICAOCode()));
+        addTrigrams(m_names.last(), i);
+        addTrigrams(m_codes.last(), i);
+    }
+    m_trigrams.squeeze();
+}
+
+
+void GeoMaps::WaypointSearchIndex::addTrigrams(const QByteArray& key, int index)
+{
+    for(int i=0; i+3<=key.size(); i++) {
+        auto& list = m_trigrams[trigram(key.constData()+i)];
+        if (list.isEmpty() || (list.last() != index)) {
+            list.append(index);
+        }
+    }
+}
+
+
+auto GeoMaps::WaypointSearchIndex::find(const QString& filter) const -> QVector<int>
+{
+    // Normalize filter words
+    QVector<QByteArray> words;
+    foreach(auto word, filter.simplified().split(' ', Qt::SkipEmptyParts)) {
+        auto normalizedWord = normalize(word);
+        if (!normalizedWord.isEmpty()) {
+            words.append(normalizedWord);
+        }
+    }
+
+    // Find candidates, by intersecting the lists of all trigrams in all words
+    // that are long enough to have trigrams
+    QVector<const QVector<int>*> lists;
+    foreach(auto word, words) {
+        for(int i=0; i+3<=word.size(); i++) {
+            auto list = m_trigrams.constFind(trigram(word.constData()+i));
+            if (list == m_trigrams.constEnd()) {
+                return {};
+            }
+            lists.append(&list.value());
+        }
+    }
+
+    QVector<int> candidates;
+    if (lists.isEmpty()) {
+        candidates.resize(m_names.size());
+        std::iota(candidates.begin(), candidates.end(), 0);
+    } else {
+        // Start with the shortest list, to keep intermediate results small
+        std::sort(lists.begin(), lists.end(), [](const QVector<int>* a, const QVector<int>* b) { return a->size() < b->size(); });
+        candidates = *lists[0];
+        for(int i=1; (i<lists.size()) && !candidates.isEmpty(); i++) {
+            QVector<int> intersection;
+            std::set_intersection(candidates.constBegin(), candidates.constEnd(), lists[i]->constBegin(), lists[i]->constEnd(), std::back_inserter(intersection));
+            candidates = intersection;
+        }
+    }
+    if (words.isEmpty()) {
+        return candidates;
+    }
+
+    // Verify candidates. Every word must be contained in the name or in the code.
+    QVector<int> result;
+    foreach(auto index, candidates) {
+        bool allWordsFound = true;
+        foreach(auto word, words) {
+            if (!m_names[index].contains(word) && !m_codes[index].contains(word)) {
+                allWordsFound = false;
+                break;
+            }
+        }
+        if (allWordsFound) {
+            result.append(index);
+        }
+    }
+    return result;
+}
+
+
+auto GeoMaps::WaypointSearchIndex::normalize(const QString& string) -> QByteArray
+{
+    QByteArray result;
+
+    // Strings that contain only ASCII characters are invariant under
+    // normalization
+    auto isASCII = std::all_of(string.cbegin(), string.cend(), [](QChar character) { return character.unicode() < 0x80; });
+    auto normalizedString = isASCII ? string : string.normalized(QString::NormalizationForm_KD);
+    result.reserve(normalizedString.size());
+    for(auto character : normalizedString) {
+        auto unicode = character.unicode();
+        if ((unicode >= 'a') && (unicode <= 'z')) {
+            result.append(static_cast<char>(unicode));
+            continue;
+        }
+        if ((unicode >= 'A') && (unicode <= 'Z')) {
+            result.append(static_cast<char>(unicode-'A'+'a'));
+            continue;
+        }
+        if ((unicode >= '0') && (unicode <= '9')) {
+            result.append(static_cast<char>(unicode));
+        }
+    }
+    return result;
+}
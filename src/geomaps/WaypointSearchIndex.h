@@ -0,0 +1,102 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QVector>
+
+#include "Waypoint.h"
+
+
+namespace GeoMaps {
+
+/*! \brief Full-text search index for waypoint names and codes
+ *
+ * This class holds normalized versions of the names and ICAO codes of a list
+ * of waypoints, together with a trigram index over these keys.  It is built
+ * once, when the list of waypoints changes, and allows to answer type-ahead
+ * queries without normalizing any waypoint data at query time.
+ *
+ * Normalization follows Librarian::simplifySpecialChars: strings are
+ * transformed to QString::NormalizationForm_KD and all characters except
+ * ASCII letters and digits are removed. In addition, keys are folded to
+ * lower case.
+ *
+ * Once constructed, the index is never modified. It is therefore safe to query
+ * the same instance from several threads at the same time.
+ */
+
+class WaypointSearchIndex
+{
+public:
+    /*! \brief Constructs an empty index */
+    WaypointSearchIndex() = default;
+
+    /*! \brief Constructs an index
+     *
+     * @param waypoints List of waypoints. The index refers to waypoints by
+     * their position in this list.
+     */
+    explicit WaypointSearchIndex(const QVector<Waypoint>& waypoints);
+
+    /*! \brief Search for waypoints
+     *
+     * @param filter List of words, separated by white space
+     *
+     * @returns Indices of all waypoints whose name or ICAO code contains each
+     * of the words in filter, in ascending order. If the filter contains no
+     * words, the indices of all waypoints are returned.
+     */
+    QVector<int> find(const QString& filter) const;
+
+    /*! \brief Normalize string
+     *
+     * This method is thread-safe.
+     *
+     * @param string Input string
+     *
+     * @returns String transformed to QString::NormalizationForm_KD, with all
+     * characters except ASCII letters and digits removed, folded to lower
+     * case
+     */
+    static QByteArray normalize(const QString& string);
+
+private:
+    // Trigram of normalized ASCII characters, packed into an integer
+    static quint32 trigram(const char* characters)
+    {
+        return (quint32(quint8(characters[0])) << 16) | (quint32(quint8(characters[1])) << 8) | quint32(quint8(characters[2]));
+    }
+
+    // Adds all trigrams of key to the index, for the waypoint with the given index
+    void addTrigrams(const QByteArray& key, int index);
+
+    // Normalized names and codes, one entry per waypoint
+    QVector<QByteArray> m_names;
+    QVector<QByteArray> m_codes;
+
+    // Trigram index. For every trigram, the list contains the indices of all
+    // waypoints whose name or code contains the trigram, in ascending order and
+    // without duplicates
+    QHash<quint32, QVector<int>> m_trigrams;
+};
+
+};
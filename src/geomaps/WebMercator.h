@@ -0,0 +1,69 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QtMath>
+#include <utility>
+
+
+namespace GeoMaps {
+
+/*! \brief Web Mercator tile that contains a point
+ *
+ * Map tiles are numbered in the XYZ scheme: at zoom level z, the Web Mercator
+ * projection of the world is cut into 2^z columns and 2^z rows of tiles,
+ * counted from the north-west corner. Latitudes beyond ±85.0511°, where the
+ * projection ends, and longitudes beyond ±180° are mapped to the tiles at the
+ * edge.
+ *
+ * @param latitude Latitude of the point, in degrees
+ *
+ * @param longitude Longitude of the point, in degrees
+ *
+ * @param z Zoom level, between 0 and 24
+ *
+ * @returns Column and row of the tile
+ */
+inline std::pair<quint32, quint32> webMercatorTile(double latitude, double longitude, int z)
+{
+    auto numTiles = quint32(1) << z;
+    auto mercatorX = (longitude+180.0)/360.0;
+    auto sinLatitude = qSin(qDegreesToRadians(qBound(-85.0511, latitude, 85.0511)));
+    auto mercatorY = 0.5-qLn((1.0+sinLatitude)/(1.0-sinLatitude))/(4.0*M_PI);
+    return {qMin(static_cast<quint32>(qBound(0.0, mercatorX, 1.0)*numTiles), numTiles-1),
+            qMin(static_cast<quint32>(qBound(0.0, mercatorY, 1.0)*numTiles), numTiles-1)};
+}
+
+
+/*! \brief Width of a Web Mercator tile on the ground
+ *
+ * @param latitude Latitude, in degrees
+ *
+ * @param z Zoom level, between 0 and 24
+ *
+ * @returns East-west extent of the tiles at the given latitude, in meters
+ */
+inline double webMercatorTileWidthInM(double latitude, int z)
+{
+    return 40075000.0*qCos(qDegreesToRadians(qBound(-85.0, latitude, 85.0)))/(1 << z);
+}
+
+}
@@ -27,6 +27,7 @@
 #include <QQmlContext>
 #include <QQmlProperty>
 #include <QQuickItem>
+#include <QQuickWindow>
 #include <QSettings>
 #include <QTranslator>
 #include <QtWebView/QtWebView>
@@ -39,8 +40,11 @@
 #include "DemoRunner.h"
 #include "GlobalObject.h"
 #include "Librarian.h"
+#include "Metrics.h"
 #include "MobileAdaptor.h"
+#include "Profiler.h"
 #include "Settings.h"
+#include "Tracer.h"
 #include "dataManagement/DataManager.h"
 #include "dataManagement/SSLErrorHandler.h"
 #include "geomaps/Airspace.h"
@@ -49,11 +53,16 @@
 #include "navigation/Clock.h"
 #include "navigation/Navigator.h"
 #include "platform/Notifier.h"
+#include "positioning/FlightRecorder.h"
 #include "positioning/PositionProvider.h"
 #include "traffic/PasswordDB.h"
 #include "traffic/TrafficDataProvider.h"
+#include "traffic/TrafficDataSource_Simulate.h"
 #include "traffic/TrafficFactor_WithPosition.h"
+#include "ui/IconImageProvider.h"
+#include "ui/RenderBudget.h"
 #include "ui/ScaleQuickItem.h"
+#include "ui/TrafficQuickItem.h"
 #include "units/Angle.h"
 #include "units/Distance.h"
 #include "units/Speed.h"
@@ -66,6 +75,9 @@ using namespace std::chrono_literals;
 
 auto main(int argc, char *argv[]) -> int
 {
+    // Start the clock used for tracing, so that all spans are measured from here
+    Tracer::elapsed();
+
     // It seems that MapBoxGL does not work well with threaded rendering, so we disallow that.
     qputenv("QSG_RENDER_LOOP", "basic");
 
@@ -77,6 +89,7 @@ auto main(int argc, char *argv[]) -> int
     qRegisterMetaType<GeoMaps::Airspace>();
     qRegisterMetaType<GeoMaps::Waypoint>();
     qRegisterMetaType<Positioning::PositionInfo>();
+    qRegisterMetaType<Traffic::TargetID>();
     qRegisterMetaType<Traffic::Warning>();
 
     qRegisterMetaType<MobileAdaptor::FileFunction>("MobileAdaptor::FileFunction");
@@ -88,17 +101,27 @@ auto main(int argc, char *argv[]) -> int
     qmlRegisterType<DataManagement::DownloadableGroup>("enroute", 1, 0, "DownloadableGroup");
     qmlRegisterType<DataManagement::DownloadableGroupWatcher>("enroute", 1, 0, "DownloadableGroupWatcher");
     qmlRegisterUncreatableType<Librarian>("enroute", 1, 0, "Librarian", "Librarian objects cannot be created in QML");
+    qmlRegisterUncreatableType<GeoMaps::FlightBriefing>("enroute", 1, 0, "FlightBriefing", "FlightBriefing objects cannot be created in QML");
+    qmlRegisterUncreatableType<Positioning::FlightRecorder>("enroute", 1, 0, "FlightRecorder", "FlightRecorder objects cannot be created in QML");
     qmlRegisterUncreatableType<GeoMaps::GeoMapProvider>("enroute", 1, 0, "GeoMapProvider", "GeoMapProvider objects cannot be created in QML");
     qmlRegisterUncreatableType<DataManagement::DataManager>("enroute", 1, 0, "DataManager", "DataManager objects cannot be created in QML");
     qmlRegisterType<Settings>("enroute", 1, 0, "GlobalSettings");
+    qmlRegisterUncreatableType<Metrics>("enroute", 1, 0, "Metrics", "Metrics objects cannot be created in QML");
     qmlRegisterUncreatableType<MobileAdaptor>("enroute", 1, 0, "MobileAdaptor", "MobileAdaptor objects cannot be created in QML");
     qmlRegisterUncreatableType<Navigation::Navigator>("enroute", 1, 0, "Navigator", "Navigator objects cannot be created in QML");
+    qmlRegisterUncreatableType<Traffic::GDL90Server>("enroute", 1, 0, "GDL90Server", "GDL90Server objects cannot be created in QML");
     qmlRegisterUncreatableType<Traffic::PasswordDB>("enroute", 1, 0, "PasswordDB", "PasswordDB objects cannot be created in QML");
     qmlRegisterUncreatableType<Traffic::TrafficDataProvider>("enroute", 1, 0, "TrafficDataProvider", "TrafficDataProvider objects cannot be created in QML");
     qmlRegisterUncreatableType<Platform::Notifier>("enroute", 1, 0, "Notifier", "Notifier objects cannot be created in QML");
     qmlRegisterUncreatableType<Positioning::PositionProvider>("enroute", 1, 0, "PositionProvider", "PositionProvider objects cannot be created in QML");
+    qmlRegisterUncreatableType<Profiler>("enroute", 1, 0, "Profiler", "Profiler objects cannot be created in QML");
+    qmlRegisterUncreatableType<Ui::RenderBudget>("enroute", 1, 0, "RenderBudget", "RenderBudget objects cannot be created in QML");
+    qmlRegisterUncreatableType<Navigation::RouteProgress>("enroute", 1, 0, "RouteProgress", "RouteProgress objects cannot be created in QML");
+    qmlRegisterUncreatableType<GeoMaps::Terrain>("enroute", 1, 0, "Terrain", "Terrain objects cannot be created in QML");
+    qmlRegisterUncreatableType<Tracer>("enroute", 1, 0, "Tracer", "Tracer objects cannot be created in QML");
     qmlRegisterUncreatableType<Traffic::TrafficFactor_WithPosition>("enroute", 1, 0, "TrafficFactor_WithPosition", "TrafficFactor_WithPosition objects cannot be created in QML");
     qmlRegisterType<Ui::ScaleQuickItem>("enroute", 1, 0, "Scale");
+    qmlRegisterType<Ui::TrafficQuickItem>("enroute", 1, 0, "TrafficLayer");
     qmlRegisterUncreatableType<Weather::WeatherDataProvider>("enroute", 1, 0, "WeatherProvider", "Weather::WeatherProvider objects cannot be created in QML");
     qmlRegisterType<Weather::Station>("enroute", 1, 0, "WeatherStation");
 
@@ -128,6 +151,12 @@ auto main(int argc, char *argv[]) -> int
     parser.addVersionOption();
     QCommandLineOption screenshotOption("s", QCoreApplication::translate("main", "Run simulator and generate screenshots for manual"));
     parser.addOption(screenshotOption);
+    QCommandLineOption trafficOption("t", QCoreApplication::translate("main", "Simulate synthetic traffic with the given number of aircraft, for load tests"), "count");
+    parser.addOption(trafficOption);
+    QCommandLineOption trafficEncodingOption("traffic-encoding", QCoreApplication::translate("main", "Encoding of simulated traffic, 'flarm' or 'gdl90'"), "encoding", "flarm");
+    parser.addOption(trafficEncodingOption);
+    QCommandLineOption trafficIntervalOption("traffic-interval", QCoreApplication::translate("main", "Time between two updates of simulated traffic, in milliseconds"), "ms", "1000");
+    parser.addOption(trafficIntervalOption);
     parser.addPositionalArgument("[fileName]", QCoreApplication::translate("main", "File to import."));
     parser.process(app);
     auto positionalArguments = parser.positionalArguments();
@@ -157,21 +186,65 @@ auto main(int argc, char *argv[]) -> int
     QObject::connect(&kdsingleapp, SIGNAL(messageReceived(QByteArray)), GlobalObject::mobileAdaptor(), SLOT(processFileOpenRequest(QByteArray)));
 #endif
 
+    // Start recording the flight track
+    GlobalObject::flightRecorder();
+
     /*
      * Set up ApplicationEngine for QML
      */
     QQmlApplicationEngine engine;
+    engine.addImageProvider(QStringLiteral("icons"), new Ui::IconImageProvider());
     engine.rootContext()->setContextProperty("angle", QVariant::fromValue(Units::Angle()) );
     engine.rootContext()->setContextProperty("manual_location", MANUAL_LOCATION );
     engine.rootContext()->setContextProperty("global", new GlobalObject(&engine) );
     engine.rootContext()->setContextProperty("speed", QVariant::fromValue(Units::Speed()) );
-    engine.load(QUrl(QStringLiteral("qrc:/qml/main.qml")));
+    {
+        TRACE_SCOPE("QQmlApplicationEngine::load");
+        engine.load(QUrl(QStringLiteral("qrc:/qml/main.qml")));
+    }
+    // Lower the level of detail on the map while frames are slow, and charge
+    // frames to the rendering subsystem when profiling
+    if (!engine.rootObjects().isEmpty()) {
+        GlobalObject::renderBudget()->setWindow(qobject_cast<QQuickWindow*>(engine.rootObjects().constFirst()));
+        GlobalObject::profiler()->setWindow(qobject_cast<QQuickWindow*>(engine.rootObjects().constFirst()));
+    }
+
+#if defined(ENROUTE_TRACING)
+    // Record the time from process start until the first frame is on screen
+    if (!engine.rootObjects().isEmpty()) {
+        auto* window = qobject_cast<QQuickWindow*>(engine.rootObjects().constFirst());
+        if (window != nullptr) {
+            auto* context = new QObject(window);
+            QObject::connect(window, &QQuickWindow::frameSwapped, context, [context]() {
+                Tracer::record("First frame", 0, Tracer::elapsed());
+                context->deleteLater();
+            });
+        }
+    }
+#endif
 
     if (parser.isSet(screenshotOption)) {
         GlobalObject::demoRunner()->setEngine(&engine);
         QTimer::singleShot(1s, GlobalObject::demoRunner(), &DemoRunner::run);
     }
 
+    // Synthetic traffic around Freiburg, fed through the traffic thread like
+    // data from a real receiver
+    if (parser.isSet(trafficOption)) {
+        QGeoCoordinate center(48.0221, 7.8326, 240);
+        auto* trafficSimulator = new Traffic::TrafficDataSource_Simulate();
+        trafficSimulator->setCoordinate( {center.latitude(), center.longitude(), 1000} );
+        trafficSimulator->setBarometricHeight( Units::Distance::fromM(1000) );
+        trafficSimulator->setTT( Units::Angle::fromDEG(0) );
+        trafficSimulator->setGS( Units::Speed::fromKN(80) );
+        auto encoding = (parser.value(trafficEncodingOption) == u"gdl90") ? Traffic::TrafficDataSource_Simulate::Encoding::GDL90 : Traffic::TrafficDataSource_Simulate::Encoding::FLARM;
+        auto interval = std::chrono::milliseconds(qMax(50, parser.value(trafficIntervalOption).toInt()));
+        Traffic::TrafficScenario scenario(center, Traffic::TrafficScenario::Parameters::forCount(parser.value(trafficOption).toInt()));
+        trafficSimulator->startScenario(scenario, encoding, interval);
+        GlobalObject::trafficDataProvider()->addDataSource(trafficSimulator);
+        QMetaObject::invokeMethod(trafficSimulator, &Traffic::TrafficDataSource_Abstract::connectToTrafficReceiver);
+    }
+
     // Load GUI and enter event loop
     return QGuiApplication::exec();
 }
@@ -26,6 +26,7 @@
 #include "FlightRoute.h"
 #include "GlobalObject.h"
 #include "Settings.h"
+#include "geomaps/GeoMapProvider.h"
 #include "navigation/Navigator.h"
 
 
@@ -33,6 +34,8 @@ Navigation::FlightRoute::FlightRoute(QObject *parent)
     : QObject(parent)
 {
 
+    m_legModel = new LegModel(this);
+
     stdFileName = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)+"/flight route.geojson";
 
     // Load last flightRoute
@@ -43,6 +46,13 @@ Navigation::FlightRoute::FlightRoute(QObject *parent)
 
     connect(GlobalObject::navigator()->aircraft(), &Aircraft::valChanged, this, &Navigation::FlightRoute::summaryChanged);
     connect(GlobalObject::navigator()->wind(), &Weather::Wind::valChanged, this, &Navigation::FlightRoute::summaryChanged);
+
+    // The legs check for themselves whether their cached airspace crossings
+    // are still valid, so it suffices to notify QML
+    connect(this, &FlightRoute::waypointsChanged, this, &Navigation::FlightRoute::airspaceCrossingsChanged);
+    connect(GlobalObject::geoMapProvider(), &GeoMaps::GeoMapProvider::geoJSONChanged, this, &Navigation::FlightRoute::airspaceCrossingsChanged);
+    connect(GlobalObject::settings(), &Settings::hideUpperAirspacesChanged, this, &Navigation::FlightRoute::airspaceCrossingsChanged);
+    connect(GlobalObject::settings(), &Settings::hideGlidingSectorsChanged, this, &Navigation::FlightRoute::airspaceCrossingsChanged);
 }
 
 
@@ -133,22 +143,44 @@ auto Navigation::FlightRoute::lastIndexOf(const GeoMaps::Waypoint& waypoint) con
 }
 
 
+auto Navigation::FlightRoute::airspaceCrossings() const -> QVariantList
+{
+    QVariantList result;
+    for(int i=0; i<m_legs.size(); i++) {
+        const auto crossings = m_legs[i]->airspaceCrossings();
+        for(auto crossing : crossings) {
+            crossing.legIndex = i;
+            result.append(QVariant::fromValue(crossing));
+        }
+    }
+    return result;
+}
+
+
 auto Navigation::FlightRoute::geoPath() const -> QVariantList
 {
+    if (m_geoPath.generation == m_generation) {
+        return m_geoPath.list;
+    }
+    m_geoPath.generation = m_generation;
+    m_geoPath.list.clear();
+
     // Paranoid safety checks
     if (m_waypoints.size() < 2) {
-        return QVariantList();
+        return m_geoPath.list;
     }
 
     QVariantList result;
+    result.reserve(m_waypoints.size());
     for(const auto& _waypoint : m_waypoints) {
         if (!_waypoint.isValid()) {
-            return QVariantList();
+            return m_geoPath.list;
         }
         result.append(QVariant::fromValue(_waypoint.coordinate()));
     }
 
-    return result;
+    m_geoPath.list = result;
+    return m_geoPath.list;
 }
 
 
@@ -195,19 +227,19 @@ auto Navigation::FlightRoute::loadFromGeoJSON(QString fileName) -> QString
 
 auto Navigation::FlightRoute::midFieldWaypoints() const -> QVariantList
 {
-    QVariantList result;
-
-    if (m_waypoints.isEmpty()) {
-        return result;
+    if (m_midFieldWaypoints.generation == m_generation) {
+        return m_midFieldWaypoints.list;
     }
+    m_midFieldWaypoints.generation = m_generation;
+    m_midFieldWaypoints.list.clear();
 
-    foreach(auto wpt, m_waypoints) {
+    for(const auto& wpt : m_waypoints) {
         if (wpt.category() == "WP") {
-            result << QVariant::fromValue(wpt);
+            m_midFieldWaypoints.list << QVariant::fromValue(wpt);
         }
     }
 
-    return result;
+    return m_midFieldWaypoints.list;
 }
 
 
@@ -273,6 +305,12 @@ void Navigation::FlightRoute::reverse()
 }
 
 
+auto Navigation::FlightRoute::legModel() const -> QAbstractItemModel*
+{
+    return m_legModel;
+}
+
+
 auto Navigation::FlightRoute::legs() const -> QList<QObject*>
 {
     QList<QObject*> result;
@@ -372,6 +410,43 @@ auto Navigation::FlightRoute::suggestedFilename() const -> QString
 }
 
 
+auto Navigation::FlightRoute::suggestRoute(const GeoMaps::Waypoint& from, const GeoMaps::Waypoint& to, const QStringList& avoidedCategories, Units::Distance altitude) -> QString
+{
+    if (!from.isValid() || !to.isValid()) {
+        return tr("Start and destination of the route must be valid waypoints.");
+    }
+
+    auto route = m_routePlanner.suggestRoute(GlobalObject::geoMapProvider()->aviationData(), from.coordinate(), to.coordinate(), avoidedCategories, altitude);
+    if (route.size() < 2) {
+        return tr("No route was found that avoids the selected airspaces.");
+    }
+
+    m_waypoints.clear();
+    m_waypoints.append(from);
+    for(int i=1; i<route.size()-1; i++) {
+        m_waypoints.append(GeoMaps::Waypoint(route[i]));
+    }
+    m_waypoints.append(to);
+
+    updateLegs();
+    emit waypointsChanged();
+    return {};
+}
+
+
+auto Navigation::FlightRoute::suggestRouteAroundAirspaces(const QStringList& avoidedCategories, double altitudeInFT) -> QString
+{
+    if (m_waypoints.size() < 2) {
+        return tr("The route must have a start and a destination.");
+    }
+
+    // Copies, because suggestRoute() replaces m_waypoints
+    auto from = m_waypoints.first();
+    auto to = m_waypoints.last();
+    return suggestRoute(from, to, avoidedCategories, Units::Distance::fromFT(altitudeInFT));
+}
+
+
 auto Navigation::FlightRoute::summary() const -> QString {
 
     if (m_legs.empty()) {
@@ -445,24 +520,63 @@ auto Navigation::FlightRoute::toGeoJSON() const -> QByteArray
 
 void Navigation::FlightRoute::updateLegs()
 {
-    foreach(auto _leg, m_legs)
-        _leg->deleteLater();
-    m_legs.clear();
+    // Invalidate cached lists
+    m_generation++;
+
+    auto newSize = qMax(0, m_waypoints.size()-1);
+    auto matches = [this](int legIndex, int waypointIndex) {
+        return (m_legs.at(legIndex)->startPoint() == m_waypoints.at(waypointIndex))
+                && (m_legs.at(legIndex)->endPoint() == m_waypoints.at(waypointIndex+1));
+    };
+
+    // Find the legs at the beginning and at the end of the route that have not
+    // changed. Edits such as append, remove, move or rename change only a few
+    // legs in between.
+    int prefix = 0;
+    while ((prefix < m_legs.size()) && (prefix < newSize) && matches(prefix, prefix)) {
+        prefix++;
+    }
+    int suffix = 0;
+    while ((suffix < m_legs.size()-prefix) && (suffix < newSize-prefix) && matches(m_legs.size()-1-suffix, newSize-1-suffix)) {
+        suffix++;
+    }
+
+    auto removeCount = m_legs.size()-prefix-suffix;
+    if (removeCount > 0) {
+        m_legModel->beginRemoveRows(QModelIndex(), prefix, prefix+removeCount-1);
+        for(int i=prefix; i<prefix+removeCount; i++) {
+            m_legs.at(i)->deleteLater();
+        }
+        m_legs.remove(prefix, removeCount);
+        m_legModel->endRemoveRows();
+    }
 
-    for(int i=0; i<m_waypoints.size()-1; i++) {
-        m_legs.append(new Leg(m_waypoints.at(i), m_waypoints.at(i+1), GlobalObject::navigator()->aircraft(), GlobalObject::navigator()->wind(), this));
+    auto insertCount = newSize-prefix-suffix;
+    if (insertCount > 0) {
+        m_legModel->beginInsertRows(QModelIndex(), prefix, prefix+insertCount-1);
+        auto* aircraft = GlobalObject::navigator()->aircraft();
+        auto* wind = GlobalObject::navigator()->wind();
+        for(int i=prefix; i<prefix+insertCount; i++) {
+            m_legs.insert(i, new Leg(m_waypoints.at(i), m_waypoints.at(i+1), aircraft, wind, this));
+        }
+        m_legModel->endInsertRows();
     }
 }
 
 
 auto Navigation::FlightRoute::waypoints() const -> QVariantList
 {
-    QVariantList result;
+    if (m_waypointList.generation == m_generation) {
+        return m_waypointList.list;
+    }
+    m_waypointList.generation = m_generation;
+    m_waypointList.list.clear();
+    m_waypointList.list.reserve(m_waypoints.size());
 
-    foreach(auto wpt, m_waypoints) {
-        result << QVariant::fromValue(wpt);
+    for(const auto& wpt : m_waypoints) {
+        m_waypointList.list << QVariant::fromValue(wpt);
     }
 
-    return result;
+    return m_waypointList.list;
 }
 
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <QAbstractItemModel>
 #include <QGeoRectangle>
 #include <QJsonDocument>
 #include <QFile>
@@ -29,7 +30,10 @@
 
 #include "Aircraft.h"
 
+#include "geomaps/Airspace.h"
 #include "geomaps/Waypoint.h"
+#include "navigation/RoutePlanner.h"
+#include "units/Distance.h"
 #include "weather/Wind.h"
 
 namespace GeoMaps {
@@ -41,6 +45,39 @@ class Settings;
 
 namespace Navigation {
 
+/*! \brief Section of a flight route leg that lies inside an airspace */
+
+struct AirspaceCrossing
+{
+    Q_GADGET
+
+public:
+    /*! \brief Airspace */
+    Q_PROPERTY(GeoMaps::Airspace airspace MEMBER airspace CONSTANT)
+
+    /*! \brief Index of the leg in the flight route */
+    Q_PROPERTY(int legIndex MEMBER legIndex CONSTANT)
+
+    /*! \brief Distance from the start of the leg to the point of entry */
+    Q_PROPERTY(Units::Distance entryDistance MEMBER entryDistance CONSTANT)
+
+    /*! \brief Distance from the start of the leg to the point of exit */
+    Q_PROPERTY(Units::Distance exitDistance MEMBER exitDistance CONSTANT)
+
+    /*! \brief Member for the property with the same name */
+    GeoMaps::Airspace airspace;
+
+    /*! \brief Member for the property with the same name */
+    int legIndex {-1};
+
+    /*! \brief Member for the property with the same name */
+    Units::Distance entryDistance;
+
+    /*! \brief Member for the property with the same name */
+    Units::Distance exitDistance;
+};
+
+
 /*! \brief Intended flight route
  *
  * This class represents an intended flight route. In essence, this class is
@@ -59,6 +96,7 @@ class FlightRoute : public QObject
     Q_OBJECT
 
     class Leg;
+    class LegModel;
 
 public:
     /*! \brief Construct a flight route
@@ -219,6 +257,51 @@ public:
      */
     Q_INVOKABLE QString suggestedFilename() const;
 
+    /*! \brief Replaces the route by a route that avoids airspaces
+     *
+     * This method suggests a route from one waypoint to another that keeps
+     * clear of airspaces of the given categories, as computed by
+     * RoutePlanner, and replaces the current route by it. The route begins
+     * and ends with the given waypoints; all waypoints in between are generic
+     * waypoints. Airspaces that contain one of the two waypoints are not
+     * avoided.
+     *
+     * The planner caches its data between calls, so that planning again with
+     * a slightly different list of categories is fast. The method is meant
+     * to be called interactively, for instance whenever the user toggles a
+     * category.
+     *
+     * @param from Start of the route
+     *
+     * @param to Destination of the route
+     *
+     * @param avoidedCategories Categories of airspaces that are avoided, as
+     * in GeoMaps::Airspace::CAT
+     *
+     * @param altitude Altitude of the flight, above MSL. Only airspaces that
+     * begin below this altitude are avoided.
+     *
+     * @returns Empty string in case of success, human-readable, translated
+     * error message otherwise. In case of an error, the route is not changed.
+     */
+    Q_INVOKABLE QString suggestRoute(const GeoMaps::Waypoint& from, const GeoMaps::Waypoint& to, const QStringList& avoidedCategories, Units::Distance altitude);
+
+    /*! \brief Replaces the route by a route that avoids airspaces, between its first and last waypoint
+     *
+     * This method works like suggestRoute(), with the first and last waypoint
+     * of the current route as start and destination. It is meant to be
+     * called from QML.
+     *
+     * @param avoidedCategories Categories of airspaces that are avoided, as
+     * in GeoMaps::Airspace::CAT
+     *
+     * @param altitudeInFT Altitude of the flight, in feet above MSL
+     *
+     * @returns Empty string in case of success, human-readable, translated
+     * error message otherwise. In case of an error, the route is not changed.
+     */
+    Q_INVOKABLE QString suggestRouteAroundAirspaces(const QStringList& avoidedCategories, double altitudeInFT);
+
     /*! \brief Exports to route to GeoJSON
      *
      * This method serialises the current flight route as a GeoJSON
@@ -244,6 +327,25 @@ public:
     // PROPERTIES
     //
 
+    /*! \brief Airspaces crossed by the route
+     *
+     * This property holds a list of Navigation::AirspaceCrossing, sorted by
+     * leg and by entry distance, meant for drawing a vertical profile of the
+     * route. Lateral boundaries only are taken into account; the vertical
+     * limits can be read from the airspaces. Airspaces hidden by the user
+     * settings do not appear in the list.
+     *
+     * The crossings are computed and cached leg by leg, so that a change to
+     * the route only requires computation for the legs that were created.
+     */
+    Q_PROPERTY(QVariantList airspaceCrossings READ airspaceCrossings NOTIFY airspaceCrossingsChanged)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     * @returns Property airspaceCrossings
+     */
+    QVariantList airspaceCrossings() const;
+
     /*! \brief List of coordinates for the waypoints
      *
      * This property holds a list of coordinates of the waypoints, suitable for
@@ -284,6 +386,20 @@ public:
      */
     QList<QObject*> legs() const;
 
+    /*! \brief List model for the legs
+     *
+     * This property holds a list model with all legs in the route. In
+     * contrast to the property legs, the model reports changes of the route
+     * as insertions and removals of the affected legs only.
+     */
+    Q_PROPERTY(QAbstractItemModel* legModel READ legModel CONSTANT)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     * @returns Property legModel
+     */
+    QAbstractItemModel* legModel() const;
+
     /*! \brief Number of waypoints in the route */
     Q_PROPERTY(int size READ size NOTIFY waypointsChanged)
 
@@ -350,6 +466,9 @@ public slots:
     void reverse();
 
 signals:
+    /*! \brief Notification signal for the property with the same name */
+    void airspaceCrossingsChanged();
+
     /*! \brief Notification signal for the property with the same name */
     void waypointsChanged();
 
@@ -362,6 +481,10 @@ private slots:
     // route.
     void saveToStdLocation() { save(stdFileName); };
 
+    // Adjusts m_legs to m_waypoints. Legs that start and end at the same
+    // waypoints as before are kept, so that only the legs affected by a
+    // change are created or deleted. This method must be called whenever
+    // m_waypoints changes; it also invalidates the cached lists.
     void updateLegs();
 
 private:
@@ -379,10 +502,29 @@ private:
     QVector<GeoMaps::Waypoint> m_waypoints;
 
     QVector<Leg*> m_legs;
+    LegModel* m_legModel {nullptr};
+
+    // Cached return values of geoPath(), midFieldWaypoints() and
+    // waypoints(). A cached list is valid if its generation equals
+    // m_generation, which is incremented whenever m_waypoints changes.
+    struct CachedList {
+        quint64 generation {0};
+        QVariantList list;
+    };
+    quint64 m_generation {1};
+    mutable CachedList m_geoPath;
+    mutable CachedList m_midFieldWaypoints;
+    mutable CachedList m_waypointList;
+
+    // Planner used by suggestRoute(), which keeps its caches between calls
+    RoutePlanner m_routePlanner;
 
     QLocale myLocale;
 };
 
 }
 
+Q_DECLARE_METATYPE(Navigation::AirspaceCrossing)
+
 #include "navigation/FlightRoute_Leg.h"
+#include "navigation/FlightRoute_LegModel.h"
@@ -163,36 +163,64 @@ auto Navigation::FlightRoute::loadFromGpx(const QByteArray& data, GeoMaps::GeoMa
 
 auto Navigation::FlightRoute::loadFromGpx(QXmlStreamReader& xml, GeoMaps::GeoMapProvider *geoMapProvider) -> QString
 {
+    // Take one snapshot of the aviation data, and of the mid-field waypoints
+    // in the current route, for the whole import. Nearby waypoints are
+    // looked up in the spatial index of the snapshot.
+    std::shared_ptr<const GeoMaps::AviationData> aviationData;
+    QVector<GeoMaps::Waypoint> routeWaypoints;
+    if (geoMapProvider != nullptr) {
+        aviationData = geoMapProvider->aviationData();
+        for(const auto& variant : midFieldWaypoints()) {
+            auto wp = variant.value<GeoMaps::Waypoint>();
+            if (wp.isValid()) {
+                routeWaypoints.append(wp);
+            }
+        }
+    }
 
-    // collect all route points and track points and waypoints
-    //
-    QVector<GeoMaps::Waypoint> rtept;
-    QVector<GeoMaps::Waypoint> trkpt;
-    QVector<GeoMaps::Waypoint> wpt;
+    // We prefer rte over trk over wpt. This is a bit arbitrary but seems
+    // reasonable to me. Could be made configurable. Only the points of the
+    // most preferred kind found so far are kept; points of less preferred
+    // kinds are skipped without being parsed.
+    QVector<GeoMaps::Waypoint> source;
+    int sourcePriority = 0;
+    auto priority = [](const QStringRef& tag) {
+        if (tag == QLatin1String("rtept")) {
+            return 3;
+        }
+        if (tag == QLatin1String("trkpt")) {
+            return 2;
+        }
+        if (tag == QLatin1String("wpt")) {
+            return 1;
+        }
+        return 0;
+    };
 
     // lambda function to read a single gpx rtept, trkpt or wpt
     //
-    auto addPoint = [&] (const QString& tag, QVector<GeoMaps::Waypoint> &target) {
-
-        // capture rtept, trkpt or wpt
+    auto readPoint = [&] () -> GeoMaps::Waypoint {
 
         QXmlStreamAttributes attrs = xml.attributes();
         if (!attrs.hasAttribute("lon") || !attrs.hasAttribute("lat")) {
             qDebug() << "missing lat or lon attribute";
-            return;
+            xml.skipCurrentElement();
+            return {};
         }
 
         bool ok = false;
-        double lon = xml.attributes().value("lon").toFloat(&ok);
+        double lon = attrs.value("lon").toDouble(&ok);
         if (!ok) {
-            qDebug() << "Unable to convert lon to float: " << xml.attributes().value("lon");
-            return;
+            qDebug() << "Unable to convert lon to float: " << attrs.value("lon");
+            xml.skipCurrentElement();
+            return {};
         }
 
-        double lat = xml.attributes().value("lat").toFloat(&ok);
+        double lat = attrs.value("lat").toDouble(&ok);
         if (!ok) {
-            qDebug() << "Unable to convert lat to float: " << xml.attributes().value("lat");
-            return;
+            qDebug() << "Unable to convert lat to float: " << attrs.value("lat");
+            xml.skipCurrentElement();
+            return {};
         }
 
         QGeoCoordinate pos(lat, lon);
@@ -200,34 +228,25 @@ auto Navigation::FlightRoute::loadFromGpx(QXmlStreamReader& xml, GeoMaps::GeoMap
         QString name;
         QString desc;
         QString cmt;
-        while (!xml.atEnd() && !xml.hasError())
-        {
-            if (xml.readNext() == 0u) {
-                break;
-            }
-
-            QString xmlTag = xml.name().toString();
-
-            if (xml.isStartElement()) {
-
-                if (xmlTag == "ele") {
-                    QString alt_s = xml.readElementText(QXmlStreamReader::SkipChildElements);
-                    double alt = alt_s.toFloat(&ok);
-                    if (!ok) {
-                        qDebug() << "can't convert elevation to double: " << alt_s;
-                        return;
-                    }
-                    pos.setAltitude(alt);
-                } else if (xmlTag == "name") {
-                    name = xml.readElementText(QXmlStreamReader::SkipChildElements);
-                } else if (xmlTag == "desc") {
-                    desc = xml.readElementText(QXmlStreamReader::SkipChildElements);
-                } else if (xmlTag == "cmt") {
-                    cmt = xml.readElementText(QXmlStreamReader::SkipChildElements);
+        while (xml.readNextStartElement()) {
+            auto xmlTag = xml.name();
+            if (xmlTag == QLatin1String("ele")) {
+                auto alt_s = xml.readElementText(QXmlStreamReader::SkipChildElements);
+                double alt = alt_s.toDouble(&ok);
+                if (!ok) {
+                    qDebug() << "can't convert elevation to double: " << alt_s;
+                    xml.skipCurrentElement();
+                    return {};
                 }
-
-            }  else if (xml.isEndElement() && (xmlTag == tag)) {
-                break;
+                pos.setAltitude(alt);
+            } else if (xmlTag == QLatin1String("name")) {
+                name = xml.readElementText(QXmlStreamReader::SkipChildElements);
+            } else if (xmlTag == QLatin1String("desc")) {
+                desc = xml.readElementText(QXmlStreamReader::SkipChildElements);
+            } else if (xmlTag == QLatin1String("cmt")) {
+                cmt = xml.readElementText(QXmlStreamReader::SkipChildElements);
+            } else {
+                xml.skipCurrentElement();
             }
         }
 
@@ -239,28 +258,33 @@ auto Navigation::FlightRoute::loadFromGpx(QXmlStreamReader& xml, GeoMaps::GeoMap
             }
         }
 
-        // If a GeoMapProvider is available, check if there's a known waypoint like for example an airfield nearby.
-        // If we find a waypoint within the distance of 1/100° we use it instead
-        // of the coordinate which was just imported from gpx.
-        GeoMaps::Waypoint nearest;
-        if (geoMapProvider != nullptr) {
-            QGeoCoordinate distant_pos(lat + 0.01 /* about 1.11 km */, lon);
-            nearest = geoMapProvider->closestWaypoint(pos, distant_pos);
-        }
-
-        // Now create a waypoint, owned by this, and set its name
-        GeoMaps::Waypoint wpt;
-        if (!nearest.isValid()) {
-            wpt = GeoMaps::Waypoint(pos);
-        } else {
-            wpt = nearest;
+        // If aviation data is available, check if there's a known waypoint
+        // like for example an airfield nearby. If we find a waypoint within
+        // the distance of 1/100° we use it instead of the coordinate which
+        // was just imported from gpx.
+        GeoMaps::Waypoint wpt(pos);
+        if (aviationData) {
+            QGeoCoordinate flatPos(lat, lon);
+            auto maxDistance = flatPos.distanceTo(QGeoCoordinate(lat + 0.01 /* about 1.11 km */, lon));
+
+            auto nearest = aviationData->closestWaypoint(flatPos);
+            auto nearestDistance = nearest.isValid() ? flatPos.distanceTo(nearest.coordinate()) : qInf();
+            for(const auto& wp : routeWaypoints) {
+                auto distance = flatPos.distanceTo(wp.coordinate());
+                if (distance < nearestDistance) {
+                    nearest = wp;
+                    nearestDistance = distance;
+                }
+            }
+            if (nearestDistance <= maxDistance) {
+                wpt = nearest;
+            }
         }
 
         if (wpt.type() == "WP" && wpt.category() == "WP" && name.length() > 0) {
             wpt = wpt.renamed(name);
         }
-
-        target.append(wpt);
+        return wpt;
     }; // <<< lambda function to read a single gpx rtept, trkpt or wpt
 
     while (!xml.atEnd() && !xml.hasError())
@@ -269,29 +293,30 @@ auto Navigation::FlightRoute::loadFromGpx(QXmlStreamReader& xml, GeoMaps::GeoMap
         if (token == 0U) {
             break;
         }
+        if (!xml.isStartElement()) {
+            continue;
+        }
 
-        auto name = xml.name().toString();
+        auto pointPriority = priority(xml.name());
+        if (pointPriority == 0) {
+            continue;
+        }
+        if (pointPriority < sourcePriority) {
+            xml.skipCurrentElement();
+            continue;
+        }
+        if (pointPriority > sourcePriority) {
+            source.clear();
+            sourcePriority = pointPriority;
+        }
 
-        if (xml.isStartElement()) {
-            if (name == "rtept") {
-                addPoint("rtept", rtept);
-            } else if (name == "trkpt") {
-                addPoint("trkpt", trkpt);
-            } else if (name == "wpt") {
-                addPoint("wpt", wpt);
-            }
+        auto wpt = readPoint();
+        if (wpt.isValid()) {
+            source.append(wpt);
         }
     }
 
-    // prefer rte over trk over wpt
-    // this is a bit arbitrary but seems reasonable to me.
-    // Could be made configurable.
-    //
-    QVector<GeoMaps::Waypoint> &source = (rtept.length() > 0) ? rtept :
-                                                                (trkpt.length() > 0) ? trkpt :
-                                                                                       wpt;
-    if (source.length() == 0) {
-        // don't have to delete lists rtept, trkpt, wpt as they're empty
+    if (source.isEmpty()) {
         return tr("Error interpreting GPX file: no valid route found.");
     }
 
@@ -19,10 +19,14 @@
  ***************************************************************************/
 
 #include <QtGlobal>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 #include "FlightRoute_Leg.h"
 #include "GlobalObject.h"
 #include "Settings.h"
+#include "geomaps/GeoMapProvider.h"
 
 
 Navigation::FlightRoute::Leg::Leg(const GeoMaps::Waypoint& start, const GeoMaps::Waypoint& end, Aircraft *aircraft, Weather::Wind *wind, QObject* parent)
@@ -31,78 +35,128 @@ Navigation::FlightRoute::Leg::Leg(const GeoMaps::Waypoint& start, const GeoMaps:
     _start = start;
     _end   = end;
 
-    connect(_aircraft, &Aircraft::valChanged, this, &FlightRoute::Leg::valChanged);
-    connect(_wind, &Weather::Wind::valChanged, this, &FlightRoute::Leg::valChanged);
+    // Geometry of the leg. Start and end point never change, so this is
+    // computed only once.
+    if (isValid()) {
+        auto distanceInM = _start.coordinate().distanceTo( _end.coordinate() );
+        m_distance = Units::Distance::fromM(distanceInM);
+        if (distanceInM >= minLegLength) {
+            m_TC = Units::Angle::fromDEG( _start.coordinate().azimuthTo(_end.coordinate()) );
+        }
+    }
+    updateWindTriangle();
+
+    connect(_aircraft, &Aircraft::valChanged, this, &FlightRoute::Leg::onAircraftOrWindChanged);
+    connect(_wind, &Weather::Wind::valChanged, this, &FlightRoute::Leg::onAircraftOrWindChanged);
 }
 
 
-auto Navigation::FlightRoute::Leg::distance() const -> Units::Distance
+auto Navigation::FlightRoute::Leg::airspaceCrossings() const -> QVector<Navigation::AirspaceCrossing>
 {
-    // Paranoid safety checks
-    if (!isValid()) {
-        return {};
-    }
+    auto* geoMapProvider = GlobalObject::geoMapProvider();
 
-    return Units::Distance::fromM( _start.coordinate().distanceTo( _end.coordinate() ));
+    // Key 0 is never used, so that the cache starts out invalid
+    quint64 key = 4*(geoMapProvider->aviationData()->generation()+1);
+    if (Settings::hideUpperAirspacesStatic()) {
+        key += 2;
+    }
+    if (Settings::hideGlidingSectorsStatic()) {
+        key += 1;
+    }
+    if (key == m_airspaceCrossingsKey) {
+        return m_airspaceCrossings;
+    }
+    m_airspaceCrossingsKey = key;
+    m_airspaceCrossings.clear();
+    if (!isValid()) {
+        return m_airspaceCrossings;
+    }
+
+    auto start = _start.coordinate();
+    auto end = _end.coordinate();
+    auto candidates = geoMapProvider->airspacesInCorridor(QGeoPath({start, end}), Units::Distance::fromM(0.0));
+
+    std::vector<double> parameters;
+    std::vector<double> latitudes;
+    std::vector<double> longitudes;
+    for(const auto& airspace : candidates) {
+        const auto& polygon = airspace.flatPolygon();
+        if (polygon.isEmpty()) {
+            continue;
+        }
+
+        // The intersections with the boundary cut the leg into pieces that lie
+        // either inside or outside the airspace. Testing the midpoints of all
+        // pieces in one batch is more robust than counting intersections,
+        // which fails where the leg passes through a vertex.
+        parameters = polygon.intersections(start.latitude(), start.longitude(), end.latitude(), end.longitude());
+        parameters.insert(parameters.begin(), 0.0);
+        parameters.push_back(1.0);
+        auto pieces = parameters.size()-1;
+        latitudes.resize(pieces);
+        longitudes.resize(pieces);
+        for(std::size_t i=0; i<pieces; i++) {
+            auto t = (parameters[i]+parameters[i+1])/2.0;
+            latitudes[i] = start.latitude() + t*(end.latitude()-start.latitude());
+            longitudes[i] = start.longitude() + t*(end.longitude()-start.longitude());
+        }
+        auto inside = std::make_unique<bool[]>(pieces);
+        polygon.contains(latitudes.data(), longitudes.data(), static_cast<int>(pieces), inside.get());
+
+        // Merge consecutive pieces inside the airspace into one crossing
+        for(std::size_t i=0; i<pieces; i++) {
+            if (!inside[i] || (parameters[i+1] <= parameters[i])) {
+                continue;
+            }
+            auto entry = parameters[i];
+            while ((i+1 < pieces) && inside[i+1]) {
+                i++;
+            }
+            AirspaceCrossing crossing;
+            crossing.airspace = airspace;
+            crossing.entryDistance = Units::Distance::fromM(entry*m_distance.toM());
+            crossing.exitDistance = Units::Distance::fromM(parameters[i+1]*m_distance.toM());
+            m_airspaceCrossings.append(crossing);
+        }
+    }
+
+    std::sort(m_airspaceCrossings.begin(), m_airspaceCrossings.end(), [](const AirspaceCrossing& a, const AirspaceCrossing& b) {
+        return a.entryDistance.toM() < b.entryDistance.toM();
+    });
+    return m_airspaceCrossings;
 }
 
 
-auto Navigation::FlightRoute::Leg::Fuel() const -> double
+void Navigation::FlightRoute::Leg::onAircraftOrWindChanged()
 {
-    // This also checks for _aircraft and _wind to be non-nullptr
-    if (!hasDataForWindTriangle()) {
-        return qQNaN();
-    }
-
-    return _aircraft->fuelConsumptionInLPH()*Time().toH();
+    updateWindTriangle();
+    emit valChanged();
 }
 
 
-auto Navigation::FlightRoute::Leg::GS() const -> Units::Speed
+void Navigation::FlightRoute::Leg::updateWindTriangle()
 {
+    m_WCA = {};
+    m_GS = {};
+    m_fuel = qQNaN();
+
     // This also checks for _aircraft and _wind to be non-nullptr
     if (!hasDataForWindTriangle()) {
-        return {};
+        return;
     }
 
     auto TASInKN = _aircraft->cruiseSpeed().toKN();
     auto WSInKN  = _wind->windSpeed().toKN();
     auto WD      = _wind->windDirection();
 
+    // Law of sine for wind triangle
+    m_WCA = Units::Angle::asin(-(m_TC-WD).sin() *(WSInKN/TASInKN));
+
     // Law of cosine for wind triangle
     auto GSInKT = qSqrt( TASInKN*TASInKN + WSInKN*WSInKN - 2.0*TASInKN*WSInKN*(WD-TH()).cos() );
+    m_GS = Units::Speed::fromKN(GSInKT);
 
-    return Units::Speed::fromKN(GSInKT);
-}
-
-
-auto Navigation::FlightRoute::Leg::TC() const -> Units::Angle
-{
-    // Paranoid safety checks
-    if (!isValid()) {
-        return {};
-    }
-    if( _start.coordinate().distanceTo( _end.coordinate() ) < minLegLength ) {
-        return {};
-    }
-
-    return Units::Angle::fromDEG( _start.coordinate().azimuthTo(_end.coordinate()) );
-}
-
-
-auto Navigation::FlightRoute::Leg::WCA() const -> Units::Angle
-{
-    // This also checks for _aircraft and _wind to be non-nullptr
-    if (!hasDataForWindTriangle()) {
-        return {};
-    }
-
-    Units::Speed TAS = _aircraft->cruiseSpeed();
-    Units::Speed WS  = _wind->windSpeed();
-    Units::Angle WD  = _wind->windDirection();
-
-    // Law of sine for wind triangle
-    return Units::Angle::asin(-(TC()-WD).sin() *(WS/TAS));
+    m_fuel = _aircraft->fuelConsumptionInLPH()*Time().toH();
 }
 
 
@@ -25,6 +25,7 @@
 #include "FlightRoute.h"
 #include "units/Angle.h"
 #include "units/Distance.h"
+#include "units/Speed.h"
 #include "units/Time.h"
 
 namespace Navigation {
@@ -78,14 +79,22 @@ public:
         return _end;
     }
 
-    /*! \brief Length of the leg */
+    /*! \brief Length of the leg
+     *
+     *  The geometry of the leg is computed once, in the constructor. The
+     *  values that depend on aircraft and wind are recomputed whenever these
+     *  change. All getters only read cached values.
+     */
     Q_PROPERTY(Units::Distance distance READ distance CONSTANT)
 
     /*! \brief Getter function for property of the same name
    *
    * @returns Property distance
    */
-    Units::Distance distance() const;
+    Units::Distance distance() const
+    {
+        return m_distance;
+    }
 
     /*! \brief Fuel
    *
@@ -98,7 +107,10 @@ public:
    *
    * @returns Property Fuel
    */
-    double Fuel() const;
+    double Fuel() const
+    {
+        return m_fuel;
+    }
 
     /*! \brief Ground speed
    *
@@ -111,7 +123,10 @@ public:
    *
    * @returns Property GS
    */
-    Units::Speed GS() const;
+    Units::Speed GS() const
+    {
+        return m_GS;
+    }
 
     /*! \brief True course
    *
@@ -124,7 +139,10 @@ public:
    *
    * @returns Property TC
    */
-    Units::Angle TC() const;
+    Units::Angle TC() const
+    {
+        return m_TC;
+    }
 
     /*! \brief Time required for this leg.
    *
@@ -163,6 +181,16 @@ public:
    */
     QString description() const;
 
+    /*! \brief Airspaces crossed by the leg
+   *
+   * The result is computed on first use and cached until the aviation data or
+   * the settings for hiding airspaces change. The field legIndex of the
+   * crossings is not set.
+   *
+   * @returns Crossings, sorted by entry distance
+   */
+    QVector<Navigation::AirspaceCrossing> airspaceCrossings() const;
+
     /*! \brief Validity
    *
    * A leg is considered invalid of either start or endpoint are invalid.
@@ -175,18 +203,28 @@ public:
    *
    * @returns Wind correction angle, or NaN if a WCA cannot be computed
    */
-    Units::Angle WCA() const;
+    Units::Angle WCA() const
+    {
+        return m_WCA;
+    }
 
 signals:
     /*! \brief Notification signal */
     void valChanged();
 
+private slots:
+    // Recomputes the wind triangle and emits valChanged()
+    void onAircraftOrWindChanged();
+
 private:
     Q_DISABLE_COPY_MOVE(Leg)
 
     // Necessary data for computation of wind triangle?
     bool hasDataForWindTriangle() const;
 
+    // Computes m_WCA, m_GS and m_fuel from m_TC, the aircraft and the wind
+    void updateWindTriangle();
+
     // Helper function for creating the text in the flight route
     QString makeDescription(bool useMetricUnits) const;
 
@@ -197,6 +235,20 @@ private:
     GeoMaps::Waypoint _end;
     QPointer<Aircraft> _aircraft {nullptr};
     QPointer<Weather::Wind> _wind {nullptr};
+
+    // Geometry of the leg, computed in the constructor
+    Units::Distance m_distance {};
+    Units::Angle m_TC {};
+
+    // Wind triangle, computed whenever aircraft or wind change
+    Units::Angle m_WCA {};
+    Units::Speed m_GS {};
+    double m_fuel {qQNaN()};
+
+    // Cached return value of airspaceCrossings(), valid if m_airspaceCrossingsKey
+    // matches the aviation data generation and the settings for hiding airspaces
+    mutable QVector<Navigation::AirspaceCrossing> m_airspaceCrossings;
+    mutable quint64 m_airspaceCrossingsKey {0};
 };
 
 }
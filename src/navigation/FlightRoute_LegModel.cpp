@@ -0,0 +1,53 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "FlightRoute_LegModel.h"
+
+
+Navigation::FlightRoute::LegModel::LegModel(FlightRoute *route)
+    : QAbstractListModel(route), m_route(route)
+{
+}
+
+
+auto Navigation::FlightRoute::LegModel::data(const QModelIndex &index, int role) const -> QVariant
+{
+    // Paranoid safety checks
+    if (m_route.isNull() || !index.isValid() || (index.row() >= m_route->m_legs.size()) || (role != LegRole)) {
+        return {};
+    }
+
+    return QVariant::fromValue<QObject*>(m_route->m_legs.at(index.row()));
+}
+
+
+auto Navigation::FlightRoute::LegModel::roleNames() const -> QHash<int, QByteArray>
+{
+    return {{LegRole, "leg"}};
+}
+
+
+auto Navigation::FlightRoute::LegModel::rowCount(const QModelIndex &parent) const -> int
+{
+    if (m_route.isNull() || parent.isValid()) {
+        return 0;
+    }
+    return m_route->m_legs.size();
+}
@@ -0,0 +1,92 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QAbstractListModel>
+
+#include "FlightRoute.h"
+
+namespace Navigation {
+
+/*! \brief List model for the legs of a flight route
+ *
+ *  This class exposes the legs of a FlightRoute to QML views. The model has a
+ *  single role, "leg", which holds a pointer to the FlightRoute::Leg. When
+ *  the route changes, the FlightRoute creates and deletes only the legs that
+ *  are affected by the change, and reports the changes as row insertions and
+ *  removals. Views therefore need to update only the affected delegates.
+ */
+
+class FlightRoute::LegModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Roles of the model */
+    enum Roles {
+        LegRole = Qt::UserRole+1 /*!< Pointer to the leg */
+    };
+    Q_ENUM(Roles)
+
+    /*! \brief Constructs a model for a given flight route
+     *
+     * @param route Flight route, which is also used as the parent of the model
+     */
+    explicit LegModel(FlightRoute *route);
+
+    // Standard destructor
+    ~LegModel() override = default;
+
+    /*! \brief Implementation of QAbstractListModel::data
+     *
+     * @param index Index of the leg
+     *
+     * @param role Role, must be LegRole
+     *
+     * @returns Pointer to the leg, as a QObject*
+     */
+    QVariant data(const QModelIndex &index, int role = LegRole) const override;
+
+    /*! \brief Implementation of QAbstractListModel::roleNames
+     *
+     * @returns Role names
+     */
+    QHash<int, QByteArray> roleNames() const override;
+
+    /*! \brief Implementation of QAbstractListModel::rowCount
+     *
+     * @param parent Parent index, must be invalid
+     *
+     * @returns Number of legs
+     */
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+private:
+    Q_DISABLE_COPY_MOVE(LegModel)
+
+    // The flight route calls the protected methods that announce row
+    // insertions and removals
+    friend class FlightRoute;
+
+    QPointer<FlightRoute> m_route;
+};
+
+}
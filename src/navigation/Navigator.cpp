@@ -88,6 +88,8 @@ auto Navigation::Navigator::flightRoute() -> FlightRoute*
 
 void Navigation::Navigator::onPositionUpdated(const Positioning::PositionInfo& info)
 {
+    routeProgress()->update(info);
+
     Units::Speed GS;
 
     if (info.isValid()) {
@@ -114,6 +116,16 @@ void Navigation::Navigator::onPositionUpdated(const Positioning::PositionInfo& i
 }
 
 
+auto Navigation::Navigator::routeProgress() -> Navigation::RouteProgress*
+{
+    if (m_routeProgress.isNull()) {
+        m_routeProgress = new Navigation::RouteProgress(flightRoute(), this);
+        QQmlEngine::setObjectOwnership(m_routeProgress, QQmlEngine::CppOwnership);
+    }
+    return m_routeProgress;
+}
+
+
 void Navigation::Navigator::setIsInFlight(bool newIsInFlight)
 {
     if (m_isInFlight == newIsInFlight) {
@@ -23,6 +23,7 @@
 #include "FlightRoute.h"
 #include "navigation/Clock.h"
 #include "navigation/FlightRoute.h"
+#include "navigation/RouteProgress.h"
 #include "positioning/PositionInfo.h"
 
 
@@ -121,6 +122,20 @@ public:
         return m_isInFlight;
     }
 
+    /*! \brief Progress along the current flight route
+     *
+     *  The object returned here is owned by this class and must not be deleted.
+     *  QML ownership has been set to QQmlEngine::CppOwnership. It is updated
+     *  with every position fix.
+     */
+    Q_PROPERTY(Navigation::RouteProgress* routeProgress READ routeProgress CONSTANT)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property routeProgress
+     */
+    Navigation::RouteProgress* routeProgress();
+
     /*! \brief Current wind
      *
      *  The wind returned here is owned by this class and must not be deleted.
@@ -162,6 +177,7 @@ private:
     QPointer<Aircraft> m_aircraft {nullptr};
     QPointer<Clock> m_clock {nullptr};
     QPointer<FlightRoute> m_flightRoute {nullptr};
+    QPointer<RouteProgress> m_routeProgress {nullptr};
     QPointer<Weather::Wind> m_wind {nullptr};
 };
 
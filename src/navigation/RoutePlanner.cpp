@@ -0,0 +1,576 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QGeoRectangle>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include "Metrics.h"
+#include "Profiler.h"
+#include "navigation/RoutePlanner.h"
+
+
+namespace {
+
+// Point in the plane, in nautical miles
+struct Point {
+    double x;
+    double y;
+};
+
+// Twice the signed area of the triangle o, a, b. Positive if the triangle is
+// counter-clockwise.
+auto cross(const Point& o, const Point& a, const Point& b) -> double
+{
+    return (a.x-o.x)*(b.y-o.y) - (a.y-o.y)*(b.x-o.x);
+}
+
+auto distance(const Point& a, const Point& b) -> double
+{
+    return std::hypot(b.x-a.x, b.y-a.y);
+}
+
+// Equirectangular projection to a plane, in nautical miles
+struct Projection {
+    explicit Projection(const QGeoCoordinate& center)
+        : latitude0(center.latitude()),
+          longitude0(center.longitude()),
+          scale(60.0*std::cos(qDegreesToRadians(center.latitude())))
+    {
+    }
+
+    auto toPlane(double latitude, double longitude) const -> Point
+    {
+        return {(longitude-longitude0)*scale, (latitude-latitude0)*60.0};
+    }
+
+    void toGeo(const Point& point, double& latitude, double& longitude) const
+    {
+        latitude = latitude0 + point.y/60.0;
+        longitude = longitude0 + point.x/scale;
+    }
+
+    double latitude0;
+    double longitude0;
+    double scale;
+};
+
+// Convex hull, counter-clockwise and without collinear vertices, computed
+// with Andrew's monotone chain algorithm
+auto convexHull(std::vector<Point> points) -> std::vector<Point>
+{
+    std::sort(points.begin(), points.end(), [](const Point& a, const Point& b) {
+        return (a.x < b.x) || ((a.x == b.x) && (a.y < b.y));
+    });
+    points.erase(std::unique(points.begin(), points.end(), [](const Point& a, const Point& b) {
+        return (a.x == b.x) && (a.y == b.y);
+    }), points.end());
+    if (points.size() < 3) {
+        return points;
+    }
+
+    std::vector<Point> hull(2*points.size());
+    std::size_t k = 0;
+    for(const auto& point : points) {
+        while ((k >= 2) && (cross(hull[k-2], hull[k-1], point) <= 0.0)) {
+            k--;
+        }
+        hull[k++] = point;
+    }
+    for(auto i = points.size()-1, lower = k+1; i > 0; i--) {
+        while ((k >= lower) && (cross(hull[k-2], hull[k-1], points[i-1]) <= 0.0)) {
+            k--;
+        }
+        hull[k++] = points[i-1];
+    }
+    hull.resize(k-1);
+    return hull;
+}
+
+// Reduces a convex, counter-clockwise polygon to at most maxVertices
+// vertices. An edge is removed by extending its two neighbours until they
+// meet, so that the result contains the original polygon and is convex. The
+// edge whose removal adds the least area is removed first.
+void reduce(std::vector<Point>& polygon, std::size_t maxVertices)
+{
+    while (polygon.size() > maxVertices) {
+        auto size = polygon.size();
+        auto best = size;
+        auto bestArea = std::numeric_limits<double>::infinity();
+        Point bestPoint {0.0, 0.0};
+        for(std::size_t i=0; i<size; i++) {
+            const auto& p0 = polygon[(i+size-1)%size];
+            const auto& p1 = polygon[i];
+            const auto& p2 = polygon[(i+1)%size];
+            const auto& p3 = polygon[(i+2)%size];
+
+            // Intersection of the lines p0p1 and p3p2, which must lie beyond p1
+            auto d1x = p1.x-p0.x;
+            auto d1y = p1.y-p0.y;
+            auto d2x = p2.x-p3.x;
+            auto d2y = p2.y-p3.y;
+            auto denominator = d1x*d2y - d1y*d2x;
+            if (std::abs(denominator) < 1e-12) {
+                continue;
+            }
+            auto t = ((p3.x-p0.x)*d2y - (p3.y-p0.y)*d2x)/denominator;
+            if (t <= 1.0) {
+                continue;
+            }
+            Point point {p0.x+t*d1x, p0.y+t*d1y};
+            auto area = std::abs(cross(p1, p2, point));
+            if (area < bestArea) {
+                best = i;
+                bestArea = area;
+                bestPoint = point;
+            }
+        }
+        if (best == size) {
+            return;
+        }
+        polygon[best] = bestPoint;
+        polygon.erase(polygon.begin() + static_cast<std::ptrdiff_t>((best+1)%size));
+    }
+}
+
+// Enlarges a convex, counter-clockwise polygon by moving every edge outwards
+// by the given distance
+void enlarge(std::vector<Point>& polygon, double margin)
+{
+    auto size = polygon.size();
+    if (size < 3) {
+        return;
+    }
+
+    // Outward normals of the edges; edge i runs from vertex i to vertex i+1
+    std::vector<Point> normals(size);
+    for(std::size_t i=0; i<size; i++) {
+        const auto& p = polygon[i];
+        const auto& q = polygon[(i+1)%size];
+        auto length = distance(p, q);
+        normals[i] = {(q.y-p.y)/length, (p.x-q.x)/length};
+    }
+    for(std::size_t i=0; i<size; i++) {
+        const auto& n1 = normals[(i+size-1)%size];
+        const auto& n2 = normals[i];
+
+        // Limit the displacement of very sharp vertices
+        auto denominator = std::max(1.0 + n1.x*n2.x + n1.y*n2.y, 0.5);
+        polygon[i].x += margin*(n1.x+n2.x)/denominator;
+        polygon[i].y += margin*(n1.y+n2.y)/denominator;
+    }
+}
+
+// ID of vertex number vertex of the obstacle for airspace number index, used
+// as a key into the cache of visibility tests
+auto nodeID(int index, int vertex) -> quint32
+{
+    return static_cast<quint32>(index*Navigation::RoutePlanner::maxObstacleVertices + vertex);
+}
+
+auto edgeKey(quint32 id0, quint32 id1) -> quint64
+{
+    if (id0 > id1) {
+        std::swap(id0, id1);
+    }
+    return (static_cast<quint64>(id0) << 32) | id1;
+}
+
+// Node of the visibility graph of a single call. Nodes 0 and 1 are start and
+// destination, all others are vertices of an obstacle.
+struct Node {
+    Point point;
+    int obstacle;
+    int vertex;
+};
+
+// Obstacle of a single call, in the projection of the call. The vertices
+// are the nodes first, ..., first+count-1.
+struct PlaneObstacle {
+    int airspaceIndex;
+    int first;
+    int count;
+    double minX;
+    double minY;
+    double maxX;
+    double maxY;
+};
+
+} // namespace
+
+
+auto Navigation::RoutePlanner::computeObstacle(const GeoMaps::Airspace& airspace) -> Obstacle
+{
+    Obstacle result;
+    auto boundingBox = airspace.boundingBox();
+    if (!boundingBox.isValid()) {
+        return result;
+    }
+
+    // Work in a projection centered at the airspace, which is accurate for
+    // any airspace that is not absurdly large
+    Projection projection(boundingBox.center());
+    const auto path = airspace.polygon().path();
+    std::vector<Point> points;
+    points.reserve(path.size());
+    for(const auto& coordinate : path) {
+        points.push_back(projection.toPlane(coordinate.latitude(), coordinate.longitude()));
+    }
+
+    auto polygon = convexHull(points);
+    if (polygon.size() < 3) {
+        return result;
+    }
+    reduce(polygon, maxObstacleVertices);
+    enlarge(polygon, marginInNM);
+
+    result.latitudes.resize(polygon.size());
+    result.longitudes.resize(polygon.size());
+    for(std::size_t i=0; i<polygon.size(); i++) {
+        projection.toGeo(polygon[i], result.latitudes[i], result.longitudes[i]);
+    }
+    return result;
+}
+
+
+auto Navigation::RoutePlanner::obstacle(const GeoMaps::AviationData& aviationData, int index) -> const Obstacle&
+{
+    auto iterator = m_obstacles.find(index);
+    if (iterator == m_obstacles.end()) {
+        iterator = m_obstacles.insert(index, computeObstacle(aviationData.airspaces()[index]));
+    }
+    return iterator.value();
+}
+
+
+auto Navigation::RoutePlanner::suggestRoute(const std::shared_ptr<const GeoMaps::AviationData>& aviationData,
+                                            const QGeoCoordinate& from,
+                                            const QGeoCoordinate& to,
+                                            const QStringList& avoidedCategories,
+                                            Units::Distance altitude) -> QVector<QGeoCoordinate>
+{
+    METRICS_TIME_SCOPE("routePlanner/suggestRoute");
+    PROFILER_SCOPE(Profiler::AviationQueries);
+
+    if (!aviationData || !from.isValid() || !to.isValid()) {
+        return {};
+    }
+
+    // Invalidate caches if the aviation data has changed
+    if (aviationData->generation() != m_generation) {
+        m_generation = aviationData->generation();
+        m_obstacles.clear();
+        m_visibility.clear();
+        m_activeObstacles.clear();
+    }
+
+    // Bound the memory used by the visibility cache
+    if (m_visibility.size() > maxVisibilityCacheSize) {
+        m_visibility.clear();
+    }
+
+    // Projection and search area. The area is large enough to contain
+    // reasonable detours.
+    QGeoCoordinate center((from.latitude()+to.latitude())/2.0, (from.longitude()+to.longitude())/2.0);
+    Projection projection(center);
+    auto paddingInNM = qMax(30.0, 0.5*Units::Distance::fromM(from.distanceTo(to)).toNM());
+    auto latitudePadding = paddingInNM/60.0;
+    auto longitudePadding = paddingInNM/projection.scale;
+    QGeoRectangle searchArea(QGeoCoordinate(qMin(qMax(from.latitude(), to.latitude())+latitudePadding, 89.0),
+                                            qMin(from.longitude(), to.longitude())-longitudePadding),
+                             QGeoCoordinate(qMax(qMin(from.latitude(), to.latitude())-latitudePadding, -89.0),
+                                            qMax(from.longitude(), to.longitude())+longitudePadding));
+
+    GeoMaps::AirspaceFilter filter;
+    if (altitude.isFinite()) {
+        filter.topInFtMSL = altitude.toFeet();
+    }
+    auto candidates = aviationData->airspaceIndicesInRectangle(searchArea, filter);
+    std::sort(candidates.begin(), candidates.end());
+
+    // Build nodes and obstacles of this call
+    auto start = projection.toPlane(from.latitude(), from.longitude());
+    auto destination = projection.toPlane(to.latitude(), to.longitude());
+    std::vector<Node> nodes {{start, -1, 0}, {destination, -1, 0}};
+    std::vector<PlaneObstacle> obstacles;
+    QSet<int> activeObstacles;
+    for(auto index : candidates) {
+        if (!avoidedCategories.contains(aviationData->airspaces()[index].CAT())) {
+            continue;
+        }
+        const auto& geoObstacle = obstacle(*aviationData, index);
+        auto count = static_cast<int>(geoObstacle.latitudes.size());
+        if (count < 3) {
+            continue;
+        }
+
+        PlaneObstacle planeObstacle {index, static_cast<int>(nodes.size()), count,
+                    std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(),
+                    -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+        for(int i=0; i<count; i++) {
+            auto point = projection.toPlane(geoObstacle.latitudes[i], geoObstacle.longitudes[i]);
+            planeObstacle.minX = qMin(planeObstacle.minX, point.x);
+            planeObstacle.minY = qMin(planeObstacle.minY, point.y);
+            planeObstacle.maxX = qMax(planeObstacle.maxX, point.x);
+            planeObstacle.maxY = qMax(planeObstacle.maxY, point.y);
+            nodes.push_back({point, static_cast<int>(obstacles.size()), i});
+        }
+
+        // Obstacles that contain start or destination cannot be avoided
+        auto containsPoint = [&](const Point& point) {
+            for(int i=0; i<count; i++) {
+                const auto& p = nodes[planeObstacle.first+i].point;
+                const auto& q = nodes[planeObstacle.first+(i+1)%count].point;
+                if (cross(p, q, point) <= 0.0) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        if (containsPoint(start) || containsPoint(destination)) {
+            nodes.resize(planeObstacle.first);
+            continue;
+        }
+
+        obstacles.push_back(planeObstacle);
+        activeObstacles.insert(index);
+    }
+
+    // Free edges are known to be free only if they were tested against all
+    // obstacles of this call
+    for(auto index : activeObstacles) {
+        if (!m_activeObstacles.contains(index)) {
+            m_epoch++;
+            break;
+        }
+    }
+    m_activeObstacles = activeObstacles;
+
+    // Vertex number vertex of an obstacle
+    auto vertex = [&](const PlaneObstacle& planeObstacle, int i) -> const Point& {
+        return nodes[planeObstacle.first + (i+planeObstacle.count)%planeObstacle.count].point;
+    };
+
+    // Obstacle whose interior meets the segment ab, or -1 if there is none
+    const double tolerance = 1e-6;
+    auto blockingObstacle = [&](const Point& a, const Point& b) -> int {
+        auto minX = qMin(a.x, b.x);
+        auto minY = qMin(a.y, b.y);
+        auto maxX = qMax(a.x, b.x);
+        auto maxY = qMax(a.y, b.y);
+        auto length = distance(a, b);
+        for(std::size_t o=0; o<obstacles.size(); o++) {
+            const auto& planeObstacle = obstacles[o];
+            if ((planeObstacle.minX >= maxX) || (planeObstacle.maxX <= minX) ||
+                    (planeObstacle.minY >= maxY) || (planeObstacle.maxY <= minY)) {
+                continue;
+            }
+
+            // Cyrus-Beck clipping of the segment against the convex obstacle
+            auto tEnter = 0.0;
+            auto tExit = 1.0;
+            for(int i=0; (i<planeObstacle.count) && (tExit > tEnter); i++) {
+                const auto& p = vertex(planeObstacle, i);
+                const auto& q = vertex(planeObstacle, i+1);
+                // The segment a+t(b-a) lies on the inner side of the edge pq
+                // where numerator + t*denominator > 0
+                auto numerator = cross(p, q, a);
+                auto denominator = cross(p, q, b) - numerator;
+                if (std::abs(denominator) < 1e-12) {
+                    if (numerator <= tolerance) {
+                        tExit = tEnter;
+                    }
+                    continue;
+                }
+                auto t = -numerator/denominator;
+                if (denominator > 0.0) {
+                    tEnter = qMax(tEnter, t);
+                } else {
+                    tExit = qMin(tExit, t);
+                }
+            }
+            if ((tExit-tEnter)*length > tolerance) {
+                return static_cast<int>(o);
+            }
+        }
+        return -1;
+    };
+
+    // Vertices that lie inside another obstacle are not usable
+    std::vector<bool> usable(nodes.size(), true);
+    for(std::size_t n=2; n<nodes.size(); n++) {
+        const auto& point = nodes[n].point;
+        for(std::size_t o=0; o<obstacles.size(); o++) {
+            const auto& planeObstacle = obstacles[o];
+            if ((static_cast<int>(o) == nodes[n].obstacle) ||
+                    (point.x <= planeObstacle.minX) || (point.x >= planeObstacle.maxX) ||
+                    (point.y <= planeObstacle.minY) || (point.y >= planeObstacle.maxY)) {
+                continue;
+            }
+            auto inside = true;
+            for(int i=0; inside && (i<planeObstacle.count); i++) {
+                inside = cross(vertex(planeObstacle, i), vertex(planeObstacle, i+1), point) > tolerance;
+            }
+            if (inside) {
+                usable[n] = false;
+                break;
+            }
+        }
+    }
+
+    // The edge from node u to node v is a candidate for a shortest path only
+    // if the line uv is tangent to the obstacles at both ends
+    auto isTangentAt = [&](int u, int v) {
+        const auto& node = nodes[v];
+        if (node.obstacle < 0) {
+            return true;
+        }
+        const auto& planeObstacle = obstacles[node.obstacle];
+        auto previous = cross(nodes[u].point, node.point, vertex(planeObstacle, node.vertex-1));
+        auto next = cross(nodes[u].point, node.point, vertex(planeObstacle, node.vertex+1));
+        return previous*next >= 0.0;
+    };
+    auto isCandidate = [&](int u, int v) {
+        const auto& nodeU = nodes[u];
+        const auto& nodeV = nodes[v];
+        if ((nodeU.obstacle >= 0) && (nodeU.obstacle == nodeV.obstacle)) {
+            // Chords of a convex obstacle run through its interior
+            auto difference = (nodeU.vertex-nodeV.vertex+obstacles[nodeU.obstacle].count) % obstacles[nodeU.obstacle].count;
+            return (difference == 1) || (difference == obstacles[nodeU.obstacle].count-1);
+        }
+        return isTangentAt(u, v) && isTangentAt(v, u);
+    };
+
+    // Visibility test, using the cache for edges between obstacle vertices
+    auto isVisible = [&](int u, int v) {
+        const auto& nodeU = nodes[u];
+        const auto& nodeV = nodes[v];
+        if ((nodeU.obstacle < 0) || (nodeV.obstacle < 0)) {
+            return blockingObstacle(nodeU.point, nodeV.point) < 0;
+        }
+        auto key = edgeKey(nodeID(obstacles[nodeU.obstacle].airspaceIndex, nodeU.vertex),
+                           nodeID(obstacles[nodeV.obstacle].airspaceIndex, nodeV.vertex));
+        auto iterator = m_visibility.constFind(key);
+        if (iterator != m_visibility.constEnd()) {
+            const auto& visibility = iterator.value();
+            if (visibility.blocker >= 0) {
+                if (m_activeObstacles.contains(visibility.blocker)) {
+                    return false;
+                }
+            } else if (visibility.epoch == m_epoch) {
+                return true;
+            }
+        }
+        auto blocker = blockingObstacle(nodeU.point, nodeV.point);
+        m_visibility.insert(key, {(blocker < 0) ? -1 : obstacles[blocker].airspaceIndex, m_epoch});
+        return blocker < 0;
+    };
+
+    // A* search, in the variant of Lazy Theta*: edges are tested for
+    // visibility only when their end node is taken from the queue. If the
+    // edge turns out to be blocked, the node is reached from the best of the
+    // closed nodes that see it instead.
+    struct Entry {
+        double f;
+        double g;
+        int node;
+        int parent;
+        bool isValidated;
+        bool operator>(const Entry& other) const { return f > other.f; }
+    };
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue;
+    auto nodeCount = static_cast<int>(nodes.size());
+    std::vector<double> g(nodes.size(), std::numeric_limits<double>::infinity());
+    std::vector<double> queuedG(nodes.size(), std::numeric_limits<double>::infinity());
+    std::vector<int> parent(nodes.size(), -1);
+    std::vector<int> closed;
+    std::vector<bool> isClosed(nodes.size(), false);
+    queue.push({distance(start, destination), 0.0, 0, -1, true});
+    queuedG[0] = 0.0;
+    auto heuristic = [&](int n) { return distance(nodes[n].point, destination); };
+
+    while (!queue.empty()) {
+        auto entry = queue.top();
+        queue.pop();
+        if (isClosed[entry.node]) {
+            continue;
+        }
+
+        if (!entry.isValidated && !isVisible(entry.parent, entry.node)) {
+            // Find the best closed node that sees this node
+            std::vector<std::pair<double, int>> alternatives;
+            for(auto c : closed) {
+                if ((c != entry.parent) && isCandidate(c, entry.node)) {
+                    alternatives.emplace_back(g[c] + distance(nodes[c].point, nodes[entry.node].point), c);
+                }
+            }
+            std::sort(alternatives.begin(), alternatives.end());
+            queuedG[entry.node] = std::numeric_limits<double>::infinity();
+            for(const auto& alternative : alternatives) {
+                if (isVisible(alternative.second, entry.node)) {
+                    queuedG[entry.node] = alternative.first;
+                    queue.push({alternative.first+heuristic(entry.node), alternative.first, entry.node, alternative.second, true});
+                    break;
+                }
+            }
+            continue;
+        }
+
+        isClosed[entry.node] = true;
+        closed.push_back(entry.node);
+        g[entry.node] = entry.g;
+        parent[entry.node] = entry.parent;
+        if (entry.node == 1) {
+            break;
+        }
+
+        for(int v=1; v<nodeCount; v++) {
+            if (isClosed[v] || !usable[v] || !isCandidate(entry.node, v)) {
+                continue;
+            }
+            auto tentativeG = entry.g + distance(nodes[entry.node].point, nodes[v].point);
+            if (tentativeG >= queuedG[v]) {
+                continue;
+            }
+            queuedG[v] = tentativeG;
+            queue.push({tentativeG+heuristic(v), tentativeG, v, entry.node, false});
+        }
+    }
+
+    if (!isClosed[1]) {
+        return {};
+    }
+
+    // Reconstruct route
+    QVector<QGeoCoordinate> result;
+    for(auto n = parent[1]; n > 0; n = parent[n]) {
+        const auto& node = nodes[n];
+        const auto& geoObstacle = m_obstacles[obstacles[node.obstacle].airspaceIndex];
+        result.prepend(QGeoCoordinate(geoObstacle.latitudes[node.vertex], geoObstacle.longitudes[node.vertex]));
+    }
+    result.prepend(from);
+    result.append(to);
+    return result;
+}
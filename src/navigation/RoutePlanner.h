@@ -0,0 +1,142 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QGeoCoordinate>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+#include "geomaps/AviationData.h"
+#include "units/Distance.h"
+
+
+namespace Navigation {
+
+/*! \brief Suggests routes that avoid airspaces
+ *
+ * This class computes short routes between two points that keep clear of
+ * airspaces of selected categories. Every airspace is replaced by an
+ * obstacle: the convex hull of its lateral limits, reduced to at most
+ * maxObstacleVertices vertices and enlarged by marginInNM. The route is
+ * then found with A* on the visibility graph whose nodes are the vertices of
+ * the obstacles. Only edges that are tangent to the obstacles at both ends
+ * are considered, and the visibility of an edge is tested only when A*
+ * reaches it, so that the graph is never built in full.
+ *
+ * Obstacles and the results of visibility tests are cached between calls,
+ * for as long as the aviation data does not change. When the user changes
+ * the list of avoided categories and plans again, only edges whose status
+ * could have changed are tested again: edges that were blocked by an
+ * obstacle that is no longer avoided, and, if obstacles were added, edges
+ * that were free.
+ *
+ * Computations are done in a plane, with an equirectangular projection
+ * centered between start and destination. Because obstacles are convex,
+ * routes around lateral limits with deep indentations may be longer than
+ * necessary. Obstacles that contain the start or the destination are
+ * ignored, so that flights out of a control zone can be planned.
+ */
+
+class RoutePlanner
+{
+public:
+    /*! \brief Distance by which obstacles are enlarged, in nautical miles */
+    static constexpr double marginInNM = 1.0;
+
+    /*! \brief Maximal number of vertices of an obstacle */
+    static constexpr int maxObstacleVertices = 16;
+
+    /*! \brief Constructs a planner with empty caches */
+    RoutePlanner() = default;
+
+    /*! \brief Suggest a route
+     *
+     * @param aviationData Aviation data whose airspaces are avoided
+     *
+     * @param from Start of the route
+     *
+     * @param to Destination of the route
+     *
+     * @param avoidedCategories Categories of airspaces that are avoided, as
+     * in Airspace::CAT()
+     *
+     * @param altitude Altitude of the flight, above MSL. Only airspaces that
+     * begin below this altitude are avoided, see
+     * Airspace::verticalExtentInFtMSL().
+     *
+     * @returns Coordinates of the route, beginning with from and ending with
+     * to, or an empty vector if no route could be found
+     */
+    QVector<QGeoCoordinate> suggestRoute(const std::shared_ptr<const GeoMaps::AviationData>& aviationData,
+                                         const QGeoCoordinate& from,
+                                         const QGeoCoordinate& to,
+                                         const QStringList& avoidedCategories,
+                                         Units::Distance altitude);
+
+private:
+    Q_DISABLE_COPY_MOVE(RoutePlanner)
+
+    // Obstacle that replaces an airspace, as a convex polygon whose vertices
+    // are listed counter-clockwise
+    struct Obstacle {
+        std::vector<double> latitudes;
+        std::vector<double> longitudes;
+    };
+
+    // Obstacle for airspace number index, computed on first use
+    const Obstacle& obstacle(const GeoMaps::AviationData& aviationData, int index);
+
+    // Computes the obstacle for an airspace
+    static Obstacle computeObstacle(const GeoMaps::Airspace& airspace);
+
+    // Generation of the aviation data for which the caches are valid
+    quint64 m_generation {0};
+
+    // Obstacles, by index of the airspace
+    QHash<int, Obstacle> m_obstacles;
+
+    // Results of visibility tests between the vertices of obstacles. Keys are
+    // pairs of node IDs, see nodeID in the implementation. An edge is free if
+    // blocker is negative, otherwise it is blocked by the obstacle of airspace
+    // number blocker. A free edge is known to be free only if its epoch
+    // equals m_epoch, see m_activeObstacles.
+    struct Visibility {
+        qint32 blocker;
+        quint32 epoch;
+    };
+    QHash<quint64, Visibility> m_visibility;
+
+    // Maximal number of entries in m_visibility. The cache is cleared before
+    // a call to suggestRoute() if it has grown larger.
+    static constexpr int maxVisibilityCacheSize = 200000;
+
+    // Indices of the airspaces that were avoided in the last call. Whenever a
+    // call avoids an airspace that was not avoided in the last call, m_epoch
+    // is incremented, which invalidates all free edges.
+    QSet<int> m_activeObstacles;
+    quint32 m_epoch {0};
+};
+
+}
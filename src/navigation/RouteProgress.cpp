@@ -0,0 +1,183 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QtMath>
+
+#include "navigation/RouteProgress.h"
+
+
+namespace {
+
+// Mean radius of the earth, as used by QGeoCoordinate
+constexpr double earthRadiusInM = 6371007.2;
+
+}
+
+
+Navigation::RouteProgress::RouteProgress(FlightRoute *route, QObject *parent)
+    : QObject(parent), m_route(route)
+{
+    connect(m_route, &FlightRoute::waypointsChanged, this, &Navigation::RouteProgress::onRouteChanged);
+    onRouteChanged();
+}
+
+
+auto Navigation::RouteProgress::acquireLeg(const QGeoCoordinate& position) const -> int
+{
+    int result = -1;
+    double minDistance = qInf();
+    for(int i=0; i<static_cast<int>(m_legs.size()); i++) {
+        const auto& leg = m_legs[i];
+        auto projection = project(i, position);
+
+        double distance = qInf();
+        if (projection.alongTrackInM < 0.0) {
+            distance = position.distanceTo(leg.start);
+        } else if (projection.alongTrackInM > leg.lengthInM) {
+            distance = position.distanceTo(leg.end);
+        } else {
+            distance = qAbs(projection.crossTrackInM);
+        }
+        if (distance < minDistance) {
+            minDistance = distance;
+            result = i;
+        }
+    }
+    return result;
+}
+
+
+auto Navigation::RouteProgress::crossTrackError() const -> Units::Distance
+{
+    if (m_currentLeg < 0) {
+        return {};
+    }
+    return Units::Distance::fromM(m_projection.crossTrackInM);
+}
+
+
+auto Navigation::RouteProgress::distanceToWaypoint(int index) const -> Units::Distance
+{
+    // Paranoid safety checks
+    if ((m_currentLeg < 0) || (index <= m_currentLeg) || (index > static_cast<int>(m_legs.size()))) {
+        return {};
+    }
+
+    const auto& current = m_legs[m_currentLeg];
+    auto remainingOnCurrentLeg = qMax(0.0, current.lengthInM-m_projection.alongTrackInM);
+    return Units::Distance::fromM(remainingOnCurrentLeg + m_legs[index-1].cumulativeLengthInM - current.cumulativeLengthInM);
+}
+
+
+auto Navigation::RouteProgress::eta(int index) const -> QDateTime
+{
+    auto distance = distanceToWaypoint(index);
+    if (!distance.isFinite() || !m_groundSpeed.isFinite() || (m_groundSpeed.toKN() < minGroundSpeedInKN) || !m_timestamp.isValid()) {
+        return {};
+    }
+    return m_timestamp.addMSecs(qRound64(1000.0*distance.toM()/m_groundSpeed.toMPS()));
+}
+
+
+void Navigation::RouteProgress::onRouteChanged()
+{
+    m_legs.clear();
+    m_currentLeg = -1;
+
+    if (m_route.isNull()) {
+        emit progressChanged();
+        return;
+    }
+
+    QVector<QGeoCoordinate> coordinates;
+    for(const auto& variant : m_route->waypoints()) {
+        coordinates.append(variant.value<GeoMaps::Waypoint>().coordinate());
+    }
+
+    double cumulativeLengthInM = 0.0;
+    for(int i=0; i+1<coordinates.size(); i++) {
+        LegGeometry leg;
+        leg.start = coordinates[i];
+        leg.end = coordinates[i+1];
+        leg.courseInDEG = leg.start.azimuthTo(leg.end);
+        leg.lengthInM = leg.start.distanceTo(leg.end);
+        cumulativeLengthInM += leg.lengthInM;
+        leg.cumulativeLengthInM = cumulativeLengthInM;
+        m_legs.push_back(leg);
+    }
+    emit progressChanged();
+}
+
+
+auto Navigation::RouteProgress::project(int leg, const QGeoCoordinate& position) const -> Projection
+{
+    const auto& geometry = m_legs[leg];
+
+    // Angular distance from the start of the leg, and difference between the
+    // course of the leg and the bearing to the position
+    auto distance = geometry.start.distanceTo(position)/earthRadiusInM;
+    auto bearingDifference = qDegreesToRadians(geometry.start.azimuthTo(position)-geometry.courseInDEG);
+
+    Projection result;
+    auto crossTrack = qAsin(qSin(distance)*qSin(bearingDifference));
+    auto alongTrack = qAcos(qBound(-1.0, qCos(distance)/qCos(crossTrack), 1.0));
+    if (qCos(bearingDifference) < 0.0) {
+        alongTrack = -alongTrack;
+    }
+    result.alongTrackInM = alongTrack*earthRadiusInM;
+    result.crossTrackInM = crossTrack*earthRadiusInM;
+    return result;
+}
+
+
+void Navigation::RouteProgress::update(const Positioning::PositionInfo& info)
+{
+    if (!info.isValid() || m_legs.empty()) {
+        if (m_currentLeg >= 0) {
+            m_currentLeg = -1;
+            emit progressChanged();
+        }
+        return;
+    }
+
+    auto position = info.coordinate();
+    m_groundSpeed = info.groundSpeed();
+    m_timestamp = info.timestamp();
+
+    if (m_currentLeg < 0) {
+        m_currentLeg = acquireLeg(position);
+    }
+    m_projection = project(m_currentLeg, position);
+
+    // Switch to the next leg once the end of the current leg has been passed,
+    // or once the aircraft is closer to the next leg than to the current one
+    while (m_currentLeg+1 < static_cast<int>(m_legs.size())) {
+        auto next = project(m_currentLeg+1, position);
+        auto passedEnd = m_projection.alongTrackInM >= m_legs[m_currentLeg].lengthInM;
+        auto closerToNext = (next.alongTrackInM >= 0.0) && (qAbs(next.crossTrackInM) < qAbs(m_projection.crossTrackInM));
+        if (!passedEnd && !closerToNext) {
+            break;
+        }
+        m_currentLeg++;
+        m_projection = next;
+    }
+
+    emit progressChanged();
+}
@@ -0,0 +1,230 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QDateTime>
+#include <QGeoCoordinate>
+#include <QPointer>
+#include <vector>
+
+#include "navigation/FlightRoute.h"
+#include "positioning/PositionInfo.h"
+#include "units/Distance.h"
+
+
+namespace Navigation {
+
+/*! \brief Progress of the aircraft along the flight route
+ *
+ *  This class tracks the leg of the flight route that is currently flown,
+ *  the cross-track error, and the distance and estimated time of arrival to
+ *  each remaining waypoint of the route.
+ *
+ *  The geometry of the route, including the cumulative distances from the
+ *  start of the route to the end of every leg, is computed only when the
+ *  route changes. On each position fix, the position is projected onto the
+ *  current leg and onto the next leg only, so that an update takes constant
+ *  time, independently of the length of the route. Only when the current leg
+ *  is unknown, for instance after the route changed, are all legs searched.
+ *
+ *  Computations assume a spherical earth.
+ */
+
+class RouteProgress : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Standard constructor
+     *
+     * @param route Flight route whose progress is tracked
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit RouteProgress(FlightRoute *route, QObject *parent = nullptr);
+
+    // Standard destructor
+    ~RouteProgress() override = default;
+
+    //
+    // METHODS
+    //
+
+    /*! \brief Distance to a waypoint of the route
+     *
+     *  The distance is measured along the route.
+     *
+     *  @param index Index of the waypoint in the flight route
+     *
+     *  @returns Distance to the waypoint, or an invalid distance if the
+     *  current leg is unknown or the waypoint has already been passed
+     */
+    Q_INVOKABLE Units::Distance distanceToWaypoint(int index) const;
+
+    /*! \brief Estimated time of arrival at a waypoint of the route
+     *
+     *  The ETA is computed from the distance along the route and the current
+     *  ground speed.
+     *
+     *  @param index Index of the waypoint in the flight route
+     *
+     *  @returns ETA at the waypoint, or an invalid QDateTime if the ETA cannot
+     *  be computed
+     */
+    Q_INVOKABLE QDateTime eta(int index) const;
+
+    /*! \brief Update with a new position fix
+     *
+     *  @param info New position info
+     */
+    void update(const Positioning::PositionInfo& info);
+
+    //
+    // PROPERTIES
+    //
+
+    /*! \brief Index of the leg that is currently flown
+     *
+     *  This property holds the index of the current leg in the flight route,
+     *  or -1 if the current leg is unknown, for instance because the route has
+     *  fewer than two waypoints or because no position is known.
+     */
+    Q_PROPERTY(int currentLeg READ currentLeg NOTIFY progressChanged)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property currentLeg
+     */
+    int currentLeg() const
+    {
+        return m_currentLeg;
+    }
+
+    /*! \brief Cross-track error
+     *
+     *  This property holds the distance of the aircraft from the great circle
+     *  through the current leg. The distance is positive if the aircraft is
+     *  right of the course and negative if it is left. It is invalid if the
+     *  current leg is unknown.
+     */
+    Q_PROPERTY(Units::Distance crossTrackError READ crossTrackError NOTIFY progressChanged)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property crossTrackError
+     */
+    Units::Distance crossTrackError() const;
+
+    /*! \brief Distance to the end of the current leg */
+    Q_PROPERTY(Units::Distance distanceToNextWaypoint READ distanceToNextWaypoint NOTIFY progressChanged)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property distanceToNextWaypoint
+     */
+    Units::Distance distanceToNextWaypoint() const
+    {
+        return distanceToWaypoint(m_currentLeg+1);
+    }
+
+    /*! \brief Distance to the last waypoint of the route, measured along the route */
+    Q_PROPERTY(Units::Distance distanceToDestination READ distanceToDestination NOTIFY progressChanged)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property distanceToDestination
+     */
+    Units::Distance distanceToDestination() const
+    {
+        return distanceToWaypoint(static_cast<int>(m_legs.size()));
+    }
+
+    /*! \brief ETA at the end of the current leg */
+    Q_PROPERTY(QDateTime etaNextWaypoint READ etaNextWaypoint NOTIFY progressChanged)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property etaNextWaypoint
+     */
+    QDateTime etaNextWaypoint() const
+    {
+        return eta(m_currentLeg+1);
+    }
+
+    /*! \brief ETA at the last waypoint of the route */
+    Q_PROPERTY(QDateTime etaDestination READ etaDestination NOTIFY progressChanged)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property etaDestination
+     */
+    QDateTime etaDestination() const
+    {
+        return eta(static_cast<int>(m_legs.size()));
+    }
+
+signals:
+    /*! \brief Notifier signal for all properties */
+    void progressChanged();
+
+private slots:
+    // Recomputes the geometry of the route and forgets the current leg
+    void onRouteChanged();
+
+private:
+    Q_DISABLE_COPY_MOVE(RouteProgress)
+
+    // Geometry of one leg
+    struct LegGeometry {
+        QGeoCoordinate start;
+        QGeoCoordinate end;
+        double courseInDEG {0.0};
+        double lengthInM {0.0};
+        // Distance from the start of the route to the end of this leg
+        double cumulativeLengthInM {0.0};
+    };
+
+    // Position relative to a leg. The along-track distance is measured from
+    // the start of the leg; it is negative before the start.
+    struct Projection {
+        double alongTrackInM {qQNaN()};
+        double crossTrackInM {qQNaN()};
+    };
+
+    // Projects position onto the great circle through the leg
+    Projection project(int leg, const QGeoCoordinate& position) const;
+
+    // Finds the leg that is closest to position, searching all legs
+    int acquireLeg(const QGeoCoordinate& position) const;
+
+    // Ground speed below which no ETA is computed
+    static constexpr double minGroundSpeedInKN = 10.0;
+
+    QPointer<FlightRoute> m_route;
+    std::vector<LegGeometry> m_legs;
+
+    int m_currentLeg {-1};
+    Projection m_projection;
+    Units::Speed m_groundSpeed;
+    QDateTime m_timestamp;
+};
+
+}
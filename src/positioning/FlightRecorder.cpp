@@ -0,0 +1,478 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtEndian>
+#include <algorithm>
+
+#include "GlobalObject.h"
+#include "MobileAdaptor.h"
+#include "positioning/FlightRecorder.h"
+#include "positioning/PositionProvider.h"
+
+
+namespace {
+
+// Identifies the ring file, including the version of the file format
+const QByteArray fileMagic = QByteArrayLiteral("ENRFLT01");
+
+// Collects text in a buffer of moderate size and writes it to a device
+// whenever the buffer is full, so that exports never hold the whole file in
+// memory. All text written by the exporters is ASCII, so UTF-8 encoding is
+// fine for IGC as well.
+class ChunkWriter
+{
+public:
+    explicit ChunkWriter(QIODevice& device) : m_device(device)
+    {
+        m_buffer.reserve(chunkSize+1024);
+    }
+
+    void append(const QString& text)
+    {
+        m_buffer += text.toUtf8();
+        if (m_buffer.size() >= chunkSize) {
+            write();
+        }
+    }
+
+    // Writes the remaining text. Returns false if any write failed.
+    bool finish()
+    {
+        write();
+        return m_ok;
+    }
+
+private:
+    void write()
+    {
+        if (m_ok && !m_buffer.isEmpty()) {
+            m_ok = (m_device.write(m_buffer) == m_buffer.size());
+        }
+        m_buffer.clear();
+    }
+
+    static constexpr int chunkSize = 64*1024;
+
+    QIODevice& m_device;
+    QByteArray m_buffer;
+    bool m_ok {true};
+};
+
+}
+
+
+Positioning::FlightRecorder::FlightRecorder(QObject *parent) : QObject(parent)
+{
+    // A single writer thread guarantees that blocks are written in order
+    m_writerPool.setMaxThreadCount(1);
+    m_blockPayload.reserve(blockSize-blockHeaderSize);
+    openRingFile();
+
+    // Write the current block at regular intervals and when the app quits
+    m_flushTimer.setInterval(1min);
+    m_flushTimer.setSingleShot(false);
+    connect(&m_flushTimer, &QTimer::timeout, this, &Positioning::FlightRecorder::flush);
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &Positioning::FlightRecorder::flush);
+    m_flushTimer.start();
+
+    QTimer::singleShot(0, this, &Positioning::FlightRecorder::deferredInitialization);
+}
+
+
+Positioning::FlightRecorder::~FlightRecorder()
+{
+    flush();
+    m_writerPool.waitForDone();
+}
+
+
+void Positioning::FlightRecorder::deferredInitialization() const
+{
+    connect(GlobalObject::positionProvider(), &Positioning::PositionProvider::positionInfoChanged, this, &Positioning::FlightRecorder::onPositionUpdated);
+}
+
+
+void Positioning::FlightRecorder::appendVarint(QByteArray& block, qint64 value)
+{
+    auto zigzag = (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+    while (zigzag >= 0x80) {
+        block.append(static_cast<char>((zigzag & 0x7f) | 0x80));
+        zigzag >>= 7;
+    }
+    block.append(static_cast<char>(zigzag));
+}
+
+
+void Positioning::FlightRecorder::clear()
+{
+    m_writerPool.waitForDone();
+    QFile::remove(fileName());
+
+    m_blockPayload.clear();
+    m_fixCount = 0;
+    m_sequence = 1;
+    m_blockModified = false;
+    m_lastRecordingTime = QDateTime();
+    openRingFile();
+}
+
+
+auto Positioning::FlightRecorder::fileName() -> QString
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)+"/flightLog.dat";
+}
+
+
+void Positioning::FlightRecorder::flush()
+{
+    if (!m_blockModified) {
+        return;
+    }
+    m_blockModified = false;
+
+    QByteArray block(blockSize, 0);
+    auto* data = reinterpret_cast<uchar*>(block.data());
+    qToLittleEndian<quint32>(m_sequence, data);
+    qToLittleEndian<quint16>(static_cast<quint16>(m_blockPayload.size()), data+4);
+    qToLittleEndian<quint16>(m_fixCount, data+6);
+    qToLittleEndian<qint64>(m_firstFix.time, data+8);
+    qToLittleEndian<qint32>(m_firstFix.latitude, data+16);
+    qToLittleEndian<qint32>(m_firstFix.longitude, data+20);
+    qToLittleEndian<qint32>(m_firstFix.altitude, data+24);
+    block.replace(blockHeaderSize, m_blockPayload.size(), m_blockPayload);
+
+    auto offset = fileHeaderSize + static_cast<qint64>(m_sequence % slotCount)*blockSize;
+    QtConcurrent::run(&m_writerPool, [block, offset]() {
+        QFile file(fileName());
+        if (!file.open(QIODevice::ReadWrite)) {
+            return;
+        }
+        file.seek(offset);
+        file.write(block);
+    });
+}
+
+
+void Positioning::FlightRecorder::onPositionUpdated(const Positioning::PositionInfo& info)
+{
+    if (!info.isValid()) {
+        return;
+    }
+
+    // Record at most once per recordingInterval. If the clock jumps back, we
+    // record immediately.
+    auto timestamp = info.timestamp();
+    if (m_lastRecordingTime.isValid()) {
+        auto delta = m_lastRecordingTime.msecsTo(timestamp);
+        if ((delta >= 0) && (delta < std::chrono::milliseconds(recordingInterval).count())) {
+            return;
+        }
+    }
+    m_lastRecordingTime = timestamp;
+
+    Fix fix {};
+    fix.time = timestamp.toMSecsSinceEpoch();
+    fix.latitude = qRound(info.coordinate().latitude()*1e5);
+    fix.longitude = qRound(info.coordinate().longitude()*1e5);
+    auto altitude = info.trueAltitude();
+    fix.altitude = altitude.isFinite() ? qRound(altitude.toM()) : m_lastFix.altitude;
+
+    // Start a new block if the current block is full
+    if ((m_fixCount > 0) && (m_blockPayload.size()+maxFixSize > blockSize-blockHeaderSize)) {
+        flush();
+        m_sequence++;
+        m_blockPayload.clear();
+        m_fixCount = 0;
+    }
+
+    if (m_fixCount == 0) {
+        m_firstFix = fix;
+        m_lastFix = fix;
+    } else {
+        // Times are stored with a resolution of 0.1s. The time of the last
+        // fix is the decoded value, so that rounding errors do not add up.
+        auto lastTime = m_lastFix.time;
+        auto deciSeconds = qRound64(static_cast<double>(fix.time-lastTime)/100.0);
+        appendVarint(m_blockPayload, deciSeconds);
+        appendVarint(m_blockPayload, fix.latitude-m_lastFix.latitude);
+        appendVarint(m_blockPayload, fix.longitude-m_lastFix.longitude);
+        appendVarint(m_blockPayload, fix.altitude-m_lastFix.altitude);
+        m_lastFix = fix;
+        m_lastFix.time = lastTime + deciSeconds*100;
+    }
+    m_fixCount++;
+    m_blockModified = true;
+}
+
+
+void Positioning::FlightRecorder::openRingFile()
+{
+    QFile file(fileName());
+    if (file.open(QIODevice::ReadOnly)) {
+        auto header = file.read(fileHeaderSize);
+        if ((header.size() == fileHeaderSize)
+                && header.startsWith(fileMagic)
+                && (qFromLittleEndian<quint32>(header.constData()+8) == slotCount)
+                && (qFromLittleEndian<quint32>(header.constData()+12) == blockSize)
+                && (file.size() == fileHeaderSize + static_cast<qint64>(slotCount)*blockSize)) {
+
+            // Continue after the block with the highest sequence number
+            quint32 maxSequence = 0;
+            for(int slot=0; slot<slotCount; slot++) {
+                file.seek(fileHeaderSize + static_cast<qint64>(slot)*blockSize);
+                auto sequence = file.read(4);
+                if (sequence.size() == 4) {
+                    maxSequence = qMax(maxSequence, qFromLittleEndian<quint32>(sequence.constData()));
+                }
+            }
+            m_sequence = maxSequence+1;
+            return;
+        }
+        file.close();
+    }
+
+    // Create a new, empty ring file
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QByteArray header(fileHeaderSize, 0);
+    header.replace(0, fileMagic.size(), fileMagic);
+    qToLittleEndian<quint32>(slotCount, header.data()+8);
+    qToLittleEndian<quint32>(blockSize, header.data()+12);
+    file.write(header);
+    file.write(QByteArray(slotCount*blockSize, 0));
+    m_sequence = 1;
+}
+
+
+auto Positioning::FlightRecorder::readFixes() const -> QVector<Fix>
+{
+    QVector<Fix> result;
+
+    QFile file(fileName());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return result;
+    }
+    auto content = file.readAll();
+    if (content.size() != fileHeaderSize + slotCount*blockSize) {
+        return result;
+    }
+
+    // Find non-empty blocks and sort them by sequence number
+    QVector<QPair<quint32, int>> blocks;
+    for(int slot=0; slot<slotCount; slot++) {
+        auto offset = fileHeaderSize + slot*blockSize;
+        auto sequence = qFromLittleEndian<quint32>(content.constData()+offset);
+        if (sequence != 0) {
+            blocks.append({sequence, offset});
+        }
+    }
+    std::sort(blocks.begin(), blocks.end());
+
+    for(const auto& block : blocks) {
+        const auto* data = content.constData()+block.second;
+        auto payloadSize = qFromLittleEndian<quint16>(data+4);
+        auto fixCount = qFromLittleEndian<quint16>(data+6);
+        if ((fixCount == 0) || (payloadSize > blockSize-blockHeaderSize)) {
+            continue;
+        }
+
+        Fix fix {};
+        fix.time = qFromLittleEndian<qint64>(data+8);
+        fix.latitude = qFromLittleEndian<qint32>(data+16);
+        fix.longitude = qFromLittleEndian<qint32>(data+20);
+        fix.altitude = qFromLittleEndian<qint32>(data+24);
+        result.append(fix);
+
+        const auto* payload = data+blockHeaderSize;
+        const auto* end = payload+payloadSize;
+        for(int i=1; i<fixCount; i++) {
+            qint64 deciSeconds = 0;
+            qint64 dLatitude = 0;
+            qint64 dLongitude = 0;
+            qint64 dAltitude = 0;
+            if (!readVarint(payload, end, deciSeconds) || !readVarint(payload, end, dLatitude)
+                    || !readVarint(payload, end, dLongitude) || !readVarint(payload, end, dAltitude)) {
+                break;
+            }
+            fix.time += deciSeconds*100;
+            fix.latitude += static_cast<qint32>(dLatitude);
+            fix.longitude += static_cast<qint32>(dLongitude);
+            fix.altitude += static_cast<qint32>(dAltitude);
+            result.append(fix);
+        }
+    }
+    return result;
+}
+
+
+auto Positioning::FlightRecorder::readVarint(const char*& data, const char* end, qint64& value) -> bool
+{
+    quint64 zigzag = 0;
+    for(int shift=0; shift<64; shift+=7) {
+        if (data == end) {
+            return false;
+        }
+        auto byte = static_cast<quint8>(*data++);
+        zigzag |= static_cast<quint64>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            value = static_cast<qint64>(zigzag >> 1) ^ -static_cast<qint64>(zigzag & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+auto Positioning::FlightRecorder::toGpx() -> QByteArray
+{
+    QByteArray result;
+    QBuffer buffer(&result);
+    buffer.open(QIODevice::WriteOnly);
+    writeGpx(buffer);
+    return result;
+}
+
+
+auto Positioning::FlightRecorder::writeGpx(QIODevice& device) -> bool
+{
+    flush();
+    m_writerPool.waitForDone();
+    auto fixes = readFixes();
+    ChunkWriter out(device);
+
+    QString now = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    out.append(QString("<?xml version='1.0' encoding='UTF-8'?>\n"
+                       "<gpx version='1.1' creator='Enroute - https://akaflieg-freiburg.github.io/enroute'\n"
+                       "     xmlns='http://www.topografix.com/GPX/1/1'\n"
+                       "     xmlns:xsi='http://www.w3.org/2001/XMLSchema-instance'>\n"
+                       "  <metadata>\n"
+                       "    <name>Enroute " + now + "</name>\n"
+                       "    <time>" + now + "</time>\n"
+                       "  </metadata>\n"
+                       "  <trk>\n"
+                       "    <name>Enroute " + now + "</name>\n"));
+
+    // Start a new segment after gaps and when the clock jumps back
+    auto gap = std::chrono::milliseconds(segmentGap).count();
+    for(int i=0; i<fixes.size(); i++) {
+        const auto& fix = fixes[i];
+        auto startSegment = (i == 0) || (fix.time < fixes[i-1].time) || (fix.time-fixes[i-1].time > gap);
+        if (startSegment) {
+            if (i > 0) {
+                out.append("    </trkseg>\n");
+            }
+            out.append("    <trkseg>\n");
+        }
+        out.append("      <trkpt lat='" + QString::number(fix.latitude/1e5, 'f', 5) + "' lon='" + QString::number(fix.longitude/1e5, 'f', 5) + "'>\n"
+                   "        <ele>" + QString::number(fix.altitude) + "</ele>\n"
+                   "        <time>" + QDateTime::fromMSecsSinceEpoch(fix.time, Qt::UTC).toString(Qt::ISODateWithMs) + "</time>\n"
+                   "      </trkpt>\n");
+    }
+    if (!fixes.isEmpty()) {
+        out.append("    </trkseg>\n");
+    }
+    out.append("  </trk>\n"
+               "</gpx>\n");
+
+    return out.finish();
+}
+
+
+auto Positioning::FlightRecorder::exportGpx() -> QString
+{
+    return GlobalObject::mobileAdaptor()->exportContent([this](QIODevice& device) { return writeGpx(device); },
+                                                        QStringLiteral("application/gpx+xml"),
+                                                        QStringLiteral("enroute flight track"));
+}
+
+
+auto Positioning::FlightRecorder::viewGpx() -> QString
+{
+    return GlobalObject::mobileAdaptor()->viewContent([this](QIODevice& device) { return writeGpx(device); },
+                                                      QStringLiteral("application/gpx+xml"),
+                                                      QStringLiteral("FlightTrack-%1.gpx"));
+}
+
+
+auto Positioning::FlightRecorder::toIGC() -> QByteArray
+{
+    QByteArray result;
+    QBuffer buffer(&result);
+    buffer.open(QIODevice::WriteOnly);
+    writeIGC(buffer);
+    return result;
+}
+
+
+auto Positioning::FlightRecorder::writeIGC(QIODevice& device) -> bool
+{
+    flush();
+    m_writerPool.waitForDone();
+    auto fixes = readFixes();
+    ChunkWriter out(device);
+
+    // Formats a coordinate, given in units of 1e-5 degrees, as degrees and
+    // thousandths of minutes
+    auto formatAngle = [](qint32 value, int degreeDigits, char positive, char negative) {
+        qint64 absValue = qAbs(static_cast<qint64>(value));
+        auto degrees = absValue/100000;
+        auto milliMinutes = ((absValue%100000)*60000 + 50000)/100000;
+        if (milliMinutes == 60000) {
+            degrees++;
+            milliMinutes = 0;
+        }
+        return QString("%1%2%3").arg(degrees, degreeDigits, 10, QChar('0')).arg(milliMinutes, 5, 10, QChar('0')).arg(QChar(value < 0 ? negative : positive));
+    };
+
+    // Formats an altitude in meters with five characters
+    auto formatAltitude = [](qint32 value) {
+        value = qBound(-9999, value, 99999);
+        if (value < 0) {
+            return "-" + QString("%1").arg(-value, 4, 10, QChar('0'));
+        }
+        return QString("%1").arg(value, 5, 10, QChar('0'));
+    };
+
+    auto date = fixes.isEmpty() ? QDateTime::currentDateTimeUtc() : QDateTime::fromMSecsSinceEpoch(fixes.constFirst().time, Qt::UTC);
+    out.append(QString("AXXXEnroute Flight Navigation\r\n"
+                       "HFDTEDATE:" + date.toString("ddMMyy") + ",01\r\n"
+                       "HFPLTPILOTINCHARGE:\r\n"
+                       "HFGTYGLIDERTYPE:\r\n"
+                       "HFGIDGLIDERID:\r\n"
+                       "HFDTMGPSDATUM:WGS84\r\n"
+                       "HFFTYFRTYPE:Enroute Flight Navigation\r\n"
+                       "HFALGALTGPS:GEO\r\n"));
+    for(const auto& fix : fixes) {
+        out.append("B" + QDateTime::fromMSecsSinceEpoch(fix.time, Qt::UTC).toString("HHmmss")
+                   + formatAngle(fix.latitude, 2, 'N', 'S')
+                   + formatAngle(fix.longitude, 3, 'E', 'W')
+                   + "A00000" + formatAltitude(fix.altitude) + "\r\n");
+    }
+
+    return out.finish();
+}
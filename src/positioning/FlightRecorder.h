@@ -0,0 +1,205 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QDateTime>
+#include <QIODevice>
+#include <QThreadPool>
+#include <QTimer>
+
+#include "positioning/PositionInfo.h"
+
+
+namespace Positioning {
+
+/*! \brief Compact recorder for the flight track
+ *
+ *  This class records the position reported by the PositionProvider, at most
+ *  once per recordingInterval, and stores the fixes in a ring file of
+ *  fixed-size blocks. Each block holds a first fix in full, followed by the
+ *  differences between consecutive fixes, encoded as zig-zag varints. A fix
+ *  typically takes about six bytes, so that a day of eight hours at 1 Hz
+ *  fits into less than 200 kB. Once the ring is full, the oldest block is
+ *  overwritten.
+ *
+ *  Blocks are written by a background thread, whenever a block is full and
+ *  at regular intervals. The track can be exported in GPX or IGC format on
+ *  demand.
+ *
+ *  The methods in this class are reentrant, but not thread safe.
+ */
+
+class FlightRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Standard constructor
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit FlightRecorder(QObject *parent = nullptr);
+
+    /*! \brief Standard destructor
+     *
+     *  Writes the current block and waits for the background writer to finish.
+     */
+    ~FlightRecorder() override;
+
+    /*! \brief Minimal time between two recorded fixes */
+    static constexpr auto recordingInterval = 1s;
+
+    /*! \brief Delete the recorded track */
+    Q_INVOKABLE void clear();
+
+    /*! \brief Recorded track in GPX format
+     *
+     *  Fixes that are more than segmentGap apart are put into different track
+     *  segments.
+     *
+     *  @returns Track in GPX format, as a byte array containing UTF-8 encoded XML
+     */
+    Q_INVOKABLE QByteArray toGpx();
+
+    /*! \brief Write recorded track in GPX format
+     *
+     *  This method works like toGpx(), but writes the track to the device in
+     *  chunks, so that the complete file is never held in memory. It can be
+     *  used with the streaming variants of MobileAdaptor::exportContent() and
+     *  MobileAdaptor::viewContent().
+     *
+     *  @param device Device, open for writing
+     *
+     *  @returns False if writing to the device failed
+     */
+    bool writeGpx(QIODevice& device);
+
+    /*! \brief Export recorded track in GPX format to file or to file sending app
+     *
+     *  This method passes writeGpx() to the streaming variant of
+     *  MobileAdaptor::exportContent(), so that the track is written directly
+     *  to the file that is saved or shared.
+     *
+     *  @returns Empty string on success, the string "abort" on abort, and a translated error message otherwise
+     */
+    Q_INVOKABLE QString exportGpx();
+
+    /*! \brief View recorded track in GPX format in other app
+     *
+     *  This method passes writeGpx() to the streaming variant of
+     *  MobileAdaptor::viewContent().
+     *
+     *  @returns Empty string on success, a translated error message otherwise
+     */
+    Q_INVOKABLE QString viewGpx();
+
+    /*! \brief Recorded track in IGC format
+     *
+     *  The IGC file contains A, H and B records only. It is not signed and
+     *  therefore not suitable for competitions or badge claims.
+     *
+     *  @returns Track in IGC format
+     */
+    Q_INVOKABLE QByteArray toIGC();
+
+private slots:
+    // Intializations that are moved out of the constructor, in order to avoid
+    // nested uses of constructors in Global.
+    void deferredInitialization() const;
+
+    // Connected to the PositionProvider, in order to receive new data
+    void onPositionUpdated(const Positioning::PositionInfo& info);
+
+    // Hands the current block to the background writer
+    void flush();
+
+private:
+    Q_DISABLE_COPY_MOVE(FlightRecorder)
+
+    // Works like toIGC(), but writes the track to the device in chunks.
+    // Returns false if writing to the device failed.
+    bool writeIGC(QIODevice& device);
+
+    // Single fix, with coordinates in units of 1e-5 degrees and altitude in
+    // meters
+    struct Fix {
+        qint64 time;
+        qint32 latitude;
+        qint32 longitude;
+        qint32 altitude;
+    };
+
+    // Number of blocks in the ring file, size of one block and size of the
+    // block header
+    static constexpr int slotCount = 64;
+    static constexpr int blockSize = 4096;
+    static constexpr int blockHeaderSize = 28;
+
+    // Size of the file header
+    static constexpr int fileHeaderSize = 16;
+
+    // Maximal size of one encoded fix: four varints of at most 10 bytes each
+    static constexpr int maxFixSize = 40;
+
+    // Fixes that are further apart than this are put into different segments
+    static constexpr auto segmentGap = 60s;
+
+    // Reads all fixes from the ring file, in chronological order. This
+    // method must only be called while the background writer is idle.
+    QVector<Fix> readFixes() const;
+
+    // Scans the ring file for the highest sequence number, creates a new
+    // ring file if no valid file exists
+    void openRingFile();
+
+    // Appends a zig-zag varint to block
+    static void appendVarint(QByteArray& block, qint64 value);
+
+    // Reads a zig-zag varint from data, advances data. Returns false if
+    // the data ends before the varint.
+    static bool readVarint(const char*& data, const char* end, qint64& value);
+
+    // Name of the ring file
+    static QString fileName();
+
+    // Current block, without header, and data of the first and the last fix
+    // in the block
+    QByteArray m_blockPayload;
+    Fix m_firstFix {};
+    Fix m_lastFix {};
+    quint16 m_fixCount {0};
+
+    // Sequence number of the current block. Sequence numbers start at 1, the
+    // value 0 marks empty slots.
+    quint32 m_sequence {1};
+
+    // True if the current block contains fixes that have not been handed to
+    // the background writer
+    bool m_blockModified {false};
+
+    // Time of the last recorded fix
+    QDateTime m_lastRecordingTime;
+
+    QThreadPool m_writerPool;
+    QTimer m_flushTimer;
+};
+
+}
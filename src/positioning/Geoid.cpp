@@ -18,14 +18,18 @@
 
 #include <QDebug>
 #include <QFile>
+#include <QtConcurrent>
 #include <QtEndian>
 #include <QtMath>
+#include <cmath>
 
 #include "positioning/Geoid.h"
 
-// Static member variable
+// Static member variables
 
-QVector<qint16> Positioning::Geoid::egm {};
+std::vector<qint16> Positioning::Geoid::egm {};
+std::once_flag Positioning::Geoid::egmRead {};
+std::shared_ptr<const Positioning::GeoidRaster> Positioning::Geoid::highResolution {};
 
 
 // reading binary geoid data was carefully optimized for speed. We read the
@@ -67,12 +71,36 @@ void Positioning::Geoid::readEGM()
 
 }
 
-// 90 >= latitude >= -90
-//
-// we do a simple bilinear interpolation between the four surrounding data
-// points according to Numerical Recipies in C++ 3.6 "Interpolation in Two or
-// More Dimensions".
-//
+
+void Positioning::Geoid::ensureEGM()
+{
+    // This method is called from several threads, so make sure that the data
+    // is read exactly once. Threads that arrive while the data is read wait.
+    std::call_once(egmRead, readEGM);
+}
+
+
+auto Positioning::Geoid::preload() -> QFuture<void>
+{
+    return QtConcurrent::run(ensureEGM);
+}
+
+
+void Positioning::Geoid::setHighResolutionModel(std::shared_ptr<const GeoidRaster> model)
+{
+    if ((model != nullptr) && !model->isValid()) {
+        model = nullptr;
+    }
+    std::atomic_store(&highResolution, std::move(model));
+}
+
+
+auto Positioning::Geoid::highResolutionModel() -> std::shared_ptr<const GeoidRaster>
+{
+    return std::atomic_load(&highResolution);
+}
+
+
 auto Positioning::Geoid::separation(const QGeoCoordinate& coord) -> Units::Distance
 {
     // Paranoid safety checks
@@ -80,59 +108,71 @@ auto Positioning::Geoid::separation(const QGeoCoordinate& coord) -> Units::Dista
         return Units::Distance::fromM( qQNaN() );
     }
 
-    // Read EGM vector if this has not been done already
-    if (egm.empty()) {
-        readEGM();
-        if (egm.empty()) {
-            return Units::Distance::fromM( qQNaN() );
-        }
-    }
-
-    // Get lat/long
     auto latitude = coord.latitude();
     auto longitude = coord.longitude();
-    while (longitude < 0) {
-        longitude += 360.;
-    }
-
-    // coordinate transformation from lat/lon to the data file coordinate
-    // system.  The returning row and col are still reals (_not_ data index
-    // integers).  We do not care about cyclic overflows yet, col might > 1400.
-    //
-    auto row = []  (double lat) -> double { return (90 - lat) * 4; }; // [0; 720] from north to south
-    auto col = []  (double lon) -> double { return    lon     * 4; }; // [0; 1440[
+    double result = qQNaN();
+    separation(&latitude, &longitude, 1, &result);
+    return Units::Distance::fromM( result );
+}
 
-    // integer row north and south of latitude
-    //
-    int north = qFloor(row(latitude));
-    int south = (north + 1) < egm96_rows? (north + 1) : north;
 
-    // integer column west and east of latitude
-    //
-    int west = qFloor(col(longitude)) % egm96_cols;
-    int east = (west + 1) % egm96_cols;
+// 90 >= latitude >= -90
+//
+// we do a simple bilinear interpolation between the four surrounding data
+// points according to Numerical Recipies in C++ 3.6 "Interpolation in Two or
+// More Dimensions".
+//
+void Positioning::Geoid::separation(const double* latitudes, const double* longitudes, int count, double* result)
+{
+    auto model = std::atomic_load(&highResolution);
+    if (model != nullptr) {
+        model->separations(latitudes, longitudes, count, result);
+        return;
+    }
 
-    auto geoid = [&] (int row, int col) -> qreal
-    {
-        int idx = row * egm96_cols + col;
-        return idx >=0 && idx < egm96_size ? egm.at(idx) * 0.01 : 0.0;
-    };
-
-    // here we do a bilinear interpolation between the 4 neighbouring data
-    // points of the requested location.
-    //
-    double interpolated = 0;
-    double row_dist = row(latitude) - north;
-    double col_dist = col(longitude) - qFloor(col(longitude));
-    for (int irow : {north, south})
-    {
-        for (int icol : {west, east})
-        {
-            interpolated += geoid(irow, icol) * (1 - row_dist) * (1 - col_dist);
-            col_dist = 1 - col_dist;
+    ensureEGM();
+    if (egm.empty()) {
+        for(int i=0; i<count; i++) {
+            result[i] = qQNaN();
         }
-        row_dist = 1 - row_dist;
+        return;
     }
 
-    return Units::Distance::fromM( interpolated );
+    const auto* data = egm.data();
+    for(int i=0; i<count; i++) {
+        auto latitude = latitudes[i];
+        auto longitude = longitudes[i];
+
+        // Invalid coordinates are mapped to the grid origin, and the result
+        // is replaced by NAN at the end. This keeps the loop free of branches.
+        bool valid = (latitude >= -90.0) && (latitude <= 90.0) && (longitude >= -180.0) && (longitude <= 360.0);
+        latitude = valid ? latitude : 90.0;
+        longitude = valid ? longitude : 0.0;
+        longitude = (longitude < 0.0) ? longitude+360.0 : longitude;
+
+        // coordinate transformation from lat/lon to the data file coordinate
+        // system: rows [0; 720] from north to south, columns [0; 1440[
+        auto row = (90.0 - latitude) * 4.0;
+        auto col = longitude * 4.0;
+
+        // integer rows north and south, and integer columns west and east of
+        // the point
+        auto rowFloor = std::floor(row);
+        auto colFloor = std::floor(col);
+        auto north = static_cast<int>(rowFloor);
+        auto south = qMin(north+1, egm96_rows-1);
+        auto west = static_cast<int>(colFloor) % egm96_cols;
+        auto east = (west+1) % egm96_cols;
+
+        // here we do a bilinear interpolation between the 4 neighbouring data
+        // points of the requested location.
+        auto rowDist = row - rowFloor;
+        auto colDist = col - colFloor;
+        auto interpolated = data[north*egm96_cols+west] * (1.0-rowDist) * (1.0-colDist)
+                + data[north*egm96_cols+east] * (1.0-rowDist) * colDist
+                + data[south*egm96_cols+west] * rowDist * (1.0-colDist)
+                + data[south*egm96_cols+east] * rowDist * colDist;
+
+        result[i] = valid ? interpolated*0.01 : qQNaN();
+    }
 }
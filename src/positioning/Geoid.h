@@ -18,8 +18,13 @@
 
 #pragma once
 
+#include <QFuture>
 #include <QGeoCoordinate>
+#include <memory>
+#include <mutex>
+#include <vector>
 
+#include "positioning/GeoidRaster.h"
 #include "units/Distance.h"
 
 namespace Positioning {
@@ -44,6 +49,13 @@ namespace Positioning {
  * implementations yield the same numbers (within numerical precision).  The
  * comparison of the bilinear implementation here with the python's bicubic
  * interpolation showed a worldwide max deviation of about 1 m.
+ *
+ * The data is read on first use, unless preload() has been called before.
+ *
+ * Optionally, a high-resolution model in the format of GeoidRaster can be
+ * installed with setHighResolutionModel(). As long as such a model is
+ * installed, it is used instead of the 15' EGM96 grid, which remains
+ * available as a fallback. All methods of this class are thread-safe.
  */
 
 class Geoid
@@ -63,11 +75,66 @@ public:
      */
     static Units::Distance separation(const QGeoCoordinate& coord);
 
+    /*! \brief Geoidal separation for many points
+     *
+     * This method is meant for route and track processing. It computes the
+     * separation for all points in a single, branch-free loop that the
+     * compiler can vectorize.
+     *
+     * @param latitudes Latitudes of the points, in degrees
+     *
+     * @param longitudes Longitudes of the points, in degrees
+     *
+     * @param count Number of points
+     *
+     * @param result Array of size count. For every point, this method sets the
+     * corresponding entry to the geoidal separation in meters, or to NAN if
+     * the coordinate is invalid or if the geoid data cannot be read.
+     */
+    static void separation(const double* latitudes, const double* longitudes, int count, double* result);
+
+    /*! \brief Read geoid data in the background
+     *
+     * The geoid data is about 2 MB and takes a while to read. This method
+     * starts reading the data in a background thread, so that the first call
+     * to separation() does not stall the caller. Calls to separation() that
+     * happen while the data is read wait until reading is complete. Calling
+     * this method more than once does no harm.
+     *
+     * @returns Future that finishes once the data has been read
+     */
+    static QFuture<void> preload();
+
+    /*! \brief Install a high-resolution geoid model
+     *
+     * Calls to separation() that are running while the model is changed
+     * finish with the previous model, which is released thereafter.
+     *
+     * @param model Model to use instead of the EGM96 grid. Pass nullptr, or
+     * an invalid model, to fall back to EGM96.
+     */
+    static void setHighResolutionModel(std::shared_ptr<const GeoidRaster> model);
+
+    /*! \brief High-resolution geoid model
+     *
+     * @returns The model installed with setHighResolutionModel(), or nullptr
+     * if the EGM96 grid is used
+     */
+    static std::shared_ptr<const GeoidRaster> highResolutionModel();
+
 private:
     // Reads data into the vector egm
     static void readEGM();
 
-    static QVector<qint16> egm; // holds the data read from the binaray data file WW15MGH.DAC
+    // Calls readEGM() exactly once, and waits until the data has been read
+    static void ensureEGM();
+
+    static std::vector<qint16> egm; // holds the data read from the binaray data file WW15MGH.DAC
+    static std::once_flag egmRead;
+
+    // High-resolution model, or nullptr. Accessed with std::atomic_load and
+    // std::atomic_store only.
+    static std::shared_ptr<const GeoidRaster> highResolution;
 
     // https://earth-info.nga.mil/GandG/wgs84/gravitymod/egm96/binary/readme.txt
     // https://earth-info.nga.mil/GandG/wgs84/gravitymod/egm96/binary/binarygeoid.html
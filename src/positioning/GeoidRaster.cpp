@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QtEndian>
+#include <QtMath>
+
+#include "positioning/GeoidRaster.h"
+
+
+namespace {
+
+// Size of the header, before the table of tile offsets
+const qint64 headerSize = 16;
+
+auto readLayout(const uchar* data, DataManagement::TiledRaster::Layout& layout) -> bool
+{
+    layout.west = 0.0;
+    layout.north = 90.0;
+    layout.samplesPerDegree = qFromLittleEndian<quint32>(data+8);
+    layout.tileSize = qFromLittleEndian<quint32>(data+12);
+    if ((layout.samplesPerDegree > 3600) || (layout.tileSize == 0) || ((180*layout.samplesPerDegree) % layout.tileSize != 0)) {
+        return false;
+    }
+    layout.tileColumns = 360*layout.samplesPerDegree/layout.tileSize;
+    layout.tileRows = 180*layout.samplesPerDegree/layout.tileSize;
+    return true;
+}
+
+}
+
+
+Positioning::GeoidRaster::GeoidRaster(const QString& fileName)
+    : m_raster(fileName, "ENGD", headerSize, false, readLayout)
+{
+}
+
+
+void Positioning::GeoidRaster::separations(const double* latitudes, const double* longitudes, int count, double* result) const
+{
+    if (!isValid()) {
+        for(int i=0; i<count; i++) {
+            result[i] = qQNaN();
+        }
+        return;
+    }
+
+    auto samplesPerDegree = static_cast<double>(m_raster.layout().samplesPerDegree);
+    for(int i=0; i<count; i++) {
+        auto latitude = latitudes[i];
+        auto longitude = longitudes[i];
+
+        // Invalid coordinates are mapped to the grid origin, and the result
+        // is replaced by NAN at the end
+        bool valid = (latitude >= -90.0) && (latitude <= 90.0) && (longitude >= -180.0) && (longitude <= 360.0);
+        latitude = valid ? latitude : 90.0;
+        longitude = valid ? longitude : 0.0;
+        longitude = (longitude < 0.0) ? longitude+360.0 : longitude;
+
+        // Every tile is present, so the lookup cannot fail
+        DataManagement::TiledRaster::Cell cell;
+        m_raster.cell(longitude*samplesPerDegree, (90.0-latitude)*samplesPerDegree, cell);
+        result[i] = valid ? cell.interpolate()*0.01 : qQNaN();
+    }
+}
@@ -0,0 +1,104 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include "dataManagement/TiledRaster.h"
+
+
+namespace Positioning {
+
+/*! \brief Memory-mapped, tiled global geoid model
+ *
+ * This class reads geoid undulations of a high-resolution model, such as
+ * EGM2008 at 2.5 arc minutes, from a file in the tiled format of
+ * DataManagement::TiledRaster, with magic "ENGD" and the following header.
+ *
+ * | Offset | Type      | Content                                              |
+ * |--------|-----------|------------------------------------------------------|
+ * | 0      | char[4]   | Magic "ENGD"                                         |
+ * | 4      | quint32   | Format version, currently 1                          |
+ * | 8      | quint32   | Number of samples per degree                         |
+ * | 12     | quint32   | Number of cells along each edge of a tile            |
+ * | 16     | quint64[] | Offsets of the tiles in the file, row by row from the north |
+ *
+ * The model covers the whole globe. The samples of the north-western tile
+ * start at latitude 90° and longitude 0°, the tiles continue eastwards and
+ * southwards, and the neighbours of the easternmost tiles are the westernmost
+ * ones. The number of samples per degree times 180 must be a multiple of the
+ * tile size. Samples are undulations in centimeters. Every tile must be
+ * present.
+ *
+ * Once constructed, the instance is never modified. It can therefore be read
+ * from several threads at the same time.
+ */
+
+class GeoidRaster
+{
+public:
+    /*! \brief Maps a file
+     *
+     * @param fileName Name of a file in the format described above
+     */
+    explicit GeoidRaster(const QString& fileName);
+
+    /*! \brief Geoidal separation at many points
+     *
+     * This method interpolates bilinearly between the four samples that
+     * surround each point.
+     *
+     * @param latitudes Latitudes of the points, in degrees
+     *
+     * @param longitudes Longitudes of the points, in degrees, between -180
+     * and 360
+     *
+     * @param count Number of points
+     *
+     * @param result Array of size count. For every point, this method sets the
+     * corresponding entry to the geoidal separation in meters, or to NAN if
+     * the coordinate is invalid.
+     */
+    void separations(const double* latitudes, const double* longitudes, int count, double* result) const;
+
+    /*! \brief Name of the file
+     *
+     * @returns File name, as passed to the constructor
+     */
+    QString fileName() const
+    {
+        return m_raster.fileName();
+    }
+
+    /*! \brief Check if the file could be mapped and is well-formed
+     *
+     * @returns True if the model can be queried
+     */
+    bool isValid() const
+    {
+        return m_raster.isValid();
+    }
+
+private:
+    Q_DISABLE_COPY_MOVE(GeoidRaster)
+
+    DataManagement::TiledRaster m_raster;
+};
+
+};
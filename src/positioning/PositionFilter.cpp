@@ -0,0 +1,274 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QtMath>
+#include <cmath>
+
+#include "positioning/PositionFilter.h"
+
+
+namespace {
+
+// Meters per degree of latitude
+constexpr double metersPerDegree = 111319.49;
+
+// Variance of the acceleration, in m²/s⁴. Horizontally, this allows for turns
+// with standard rate at typical speeds of light aircraft.
+constexpr double horizontalAccelerationVariance = 4.0;
+constexpr double verticalAccelerationVariance = 1.0;
+
+// Default variances of measurements whose accuracy is not reported
+constexpr double defaultHorizontalVariance = 10.0*10.0;
+constexpr double defaultVerticalVariance = 15.0*15.0;
+constexpr double speedVariance = 0.5*0.5;
+
+// The filter is restarted if a measurement is farther than this from the
+// estimate, or older than this after the last measurement
+constexpr double maxInnovationInM = 1000.0;
+constexpr qint64 maxGapInMSecs = 10000;
+
+// Distance from the reference point, after which the local frame is moved
+constexpr double maxLocalDistanceInM = 10000.0;
+
+} // namespace
+
+
+void Positioning::PositionFilter::Axis::initialize(double newPosition, double positionVariance, double newVelocity, double velocityVariance)
+{
+    position = newPosition;
+    velocity = newVelocity;
+    P00 = positionVariance;
+    P01 = 0.0;
+    P11 = velocityVariance;
+}
+
+
+void Positioning::PositionFilter::Axis::predict(double dt, double accelerationVariance)
+{
+    position += velocity*dt;
+    P00 += dt*(2.0*P01 + dt*P11) + accelerationVariance*dt*dt*dt*dt/4.0;
+    P01 += dt*P11 + accelerationVariance*dt*dt*dt/2.0;
+    P11 += accelerationVariance*dt*dt;
+}
+
+
+void Positioning::PositionFilter::Axis::updatePosition(double measurement, double variance)
+{
+    auto S = P00 + variance;
+    auto K0 = P00/S;
+    auto K1 = P01/S;
+    auto innovation = measurement - position;
+    position += K0*innovation;
+    velocity += K1*innovation;
+    P11 -= K1*P01;
+    P01 -= K0*P01;
+    P00 -= K0*P00;
+}
+
+
+void Positioning::PositionFilter::Axis::updateVelocity(double measurement, double variance)
+{
+    auto S = P11 + variance;
+    auto K0 = P01/S;
+    auto K1 = P11/S;
+    auto innovation = measurement - velocity;
+    position += K0*innovation;
+    velocity += K1*innovation;
+    P00 -= K0*P01;
+    P01 -= K0*P11;
+    P11 -= K1*P11;
+}
+
+
+auto Positioning::PositionFilter::addMeasurement(const Positioning::PositionInfo& info) -> bool
+{
+    auto timestamp = info.timestamp();
+    auto coordinate = info.coordinate();
+
+    if (!m_initialized || !m_time.isValid() || !timestamp.isValid() || (m_time.msecsTo(timestamp) > maxGapInMSecs)) {
+        initialize(info);
+        return true;
+    }
+
+    // Bring the state to the time of the measurement. Measurements that are
+    // older than the state are applied to the state as it is.
+    auto dt = qMax(qint64(0), m_time.msecsTo(timestamp))/1000.0;
+    m_north.predict(dt, horizontalAccelerationVariance);
+    m_east.predict(dt, horizontalAccelerationVariance);
+    if (m_hasAltitude) {
+        m_up.predict(dt, verticalAccelerationVariance);
+    }
+    if (dt > 0.0) {
+        m_time = timestamp;
+    }
+
+    // Position
+    double north = 0.0;
+    double east = 0.0;
+    toLocal(coordinate, north, east);
+    if (std::hypot(north-m_north.position, east-m_east.position) > maxInnovationInM) {
+        initialize(info);
+        return true;
+    }
+    auto horizontalAccuracy = info.positionErrorEstimate().toM();
+    auto horizontalVariance = (horizontalAccuracy > 0.0) ? horizontalAccuracy*horizontalAccuracy : defaultHorizontalVariance;
+    m_north.updatePosition(north, horizontalVariance);
+    m_east.updatePosition(east, horizontalVariance);
+
+    // Horizontal velocity
+    auto groundSpeed = info.groundSpeed().toMPS();
+    auto track = info.direction().toDEG();
+    if (qIsFinite(groundSpeed) && qIsFinite(track)) {
+        m_north.updateVelocity(groundSpeed*qCos(qDegreesToRadians(track)), speedVariance);
+        m_east.updateVelocity(groundSpeed*qSin(qDegreesToRadians(track)), speedVariance);
+    }
+
+    // Altitude and vertical speed
+    if (coordinate.type() == QGeoCoordinate::Coordinate3D) {
+        auto verticalAccuracy = info.trueAltitudeErrorEstimate().toM();
+        auto verticalVariance = (verticalAccuracy > 0.0) ? verticalAccuracy*verticalAccuracy : defaultVerticalVariance;
+        auto verticalSpeed = info.verticalSpeed().toMPS();
+        if (!m_hasAltitude) {
+            m_up.initialize(coordinate.altitude(), verticalVariance, qIsFinite(verticalSpeed) ? verticalSpeed : 0.0, qIsFinite(verticalSpeed) ? speedVariance : 25.0);
+            m_hasAltitude = true;
+        } else {
+            m_up.updatePosition(coordinate.altitude(), verticalVariance);
+            if (qIsFinite(verticalSpeed)) {
+                m_up.updateVelocity(verticalSpeed, speedVariance);
+            }
+        }
+    }
+
+    // Move the local frame, so that the flat-earth approximation stays good
+    if (std::hypot(m_north.position, m_east.position) > maxLocalDistanceInM) {
+        auto newReference = fromLocal(m_north.position, m_east.position);
+        m_reference = newReference;
+        m_cosReferenceLatitude = qCos(qDegreesToRadians(m_reference.latitude()));
+        m_north.position = 0.0;
+        m_east.position = 0.0;
+    }
+
+    m_lastMeasurement = info;
+    return false;
+}
+
+
+auto Positioning::PositionFilter::estimate(const QDateTime& time) const -> Positioning::PositionInfo
+{
+    if (!m_initialized) {
+        return {};
+    }
+
+    auto dt = qBound(qint64(0), m_time.msecsTo(time), qint64(std::chrono::milliseconds(maxExtrapolationTime).count()))/1000.0;
+    auto north = m_north;
+    auto east = m_east;
+    auto up = m_up;
+    north.predict(dt, horizontalAccelerationVariance);
+    east.predict(dt, horizontalAccelerationVariance);
+
+    auto coordinate = fromLocal(north.position, east.position);
+    if (m_hasAltitude) {
+        up.predict(dt, verticalAccelerationVariance);
+        coordinate.setAltitude(up.position);
+    }
+    Positioning::PositionInfo result(coordinate, time);
+
+    auto groundSpeed = std::hypot(north.velocity, east.velocity);
+    result.setGroundSpeed(Units::Speed::fromMPS(groundSpeed));
+    auto track = qRadiansToDegrees(std::atan2(east.velocity, north.velocity));
+    if (groundSpeed < 0.5) {
+        // Track is not meaningful at very low speed
+        track = m_lastMeasurement.direction().toDEG();
+    }
+    if (qIsFinite(track)) {
+        result.setDirection(Units::Angle::fromDEG((track < 0.0) ? track+360.0 : track));
+    }
+    result.setPositionErrorEstimate(Units::Distance::fromM(std::sqrt(qMax(north.P00, east.P00))));
+    if (m_hasAltitude) {
+        result.setVerticalSpeed(Units::Speed::fromMPS(up.velocity));
+        result.setTrueAltitudeErrorEstimate(Units::Distance::fromM(std::sqrt(up.P00)));
+    }
+    result.setVariation(m_lastMeasurement.variation());
+    return result;
+}
+
+
+void Positioning::PositionFilter::initialize(const Positioning::PositionInfo& info)
+{
+    auto coordinate = info.coordinate();
+    m_reference = QGeoCoordinate(coordinate.latitude(), coordinate.longitude());
+    m_cosReferenceLatitude = qCos(qDegreesToRadians(m_reference.latitude()));
+    m_time = info.timestamp().isValid() ? info.timestamp() : QDateTime::currentDateTimeUtc();
+
+    auto horizontalAccuracy = info.positionErrorEstimate().toM();
+    auto horizontalVariance = (horizontalAccuracy > 0.0) ? horizontalAccuracy*horizontalAccuracy : defaultHorizontalVariance;
+    auto groundSpeed = info.groundSpeed().toMPS();
+    auto track = info.direction().toDEG();
+    if (qIsFinite(groundSpeed) && qIsFinite(track)) {
+        m_north.initialize(0.0, horizontalVariance, groundSpeed*qCos(qDegreesToRadians(track)), speedVariance);
+        m_east.initialize(0.0, horizontalVariance, groundSpeed*qSin(qDegreesToRadians(track)), speedVariance);
+    } else {
+        // Velocity unknown: start at rest, with a large uncertainty
+        m_north.initialize(0.0, horizontalVariance, 0.0, 100.0);
+        m_east.initialize(0.0, horizontalVariance, 0.0, 100.0);
+    }
+
+    m_hasAltitude = (coordinate.type() == QGeoCoordinate::Coordinate3D);
+    if (m_hasAltitude) {
+        auto verticalAccuracy = info.trueAltitudeErrorEstimate().toM();
+        auto verticalVariance = (verticalAccuracy > 0.0) ? verticalAccuracy*verticalAccuracy : defaultVerticalVariance;
+        auto verticalSpeed = info.verticalSpeed().toMPS();
+        m_up.initialize(coordinate.altitude(), verticalVariance, qIsFinite(verticalSpeed) ? verticalSpeed : 0.0, qIsFinite(verticalSpeed) ? speedVariance : 25.0);
+    }
+
+    m_lastMeasurement = info;
+    m_initialized = true;
+}
+
+
+void Positioning::PositionFilter::toLocal(const QGeoCoordinate& coordinate, double& north, double& east) const
+{
+    auto deltaLongitude = coordinate.longitude()-m_reference.longitude();
+    if (deltaLongitude > 180.0) {
+        deltaLongitude -= 360.0;
+    }
+    if (deltaLongitude < -180.0) {
+        deltaLongitude += 360.0;
+    }
+    north = (coordinate.latitude()-m_reference.latitude())*metersPerDegree;
+    east = deltaLongitude*metersPerDegree*m_cosReferenceLatitude;
+}
+
+
+auto Positioning::PositionFilter::fromLocal(double north, double east) const -> QGeoCoordinate
+{
+    auto latitude = qBound(-90.0, m_reference.latitude() + north/metersPerDegree, 90.0);
+    auto longitude = m_reference.longitude();
+    if (m_cosReferenceLatitude > 1e-6) {
+        longitude += east/(metersPerDegree*m_cosReferenceLatitude);
+    }
+    if (longitude > 180.0) {
+        longitude -= 360.0;
+    }
+    if (longitude < -180.0) {
+        longitude += 360.0;
+    }
+    return {latitude, longitude};
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QDateTime>
+
+#include "positioning/PositionInfo.h"
+
+
+namespace Positioning {
+
+/*! \brief Constant-velocity Kalman filter for position data
+ *
+ *  This class fuses position reports from several sources, such as the
+ *  built-in satellite receiver and a traffic receiver, that arrive at
+ *  different rates. The filter estimates position and velocity in a local
+ *  north/east/up frame, with one independent two-state filter per axis.
+ *  Positions and velocities (ground speed, track and vertical speed) are used
+ *  individually as measurements, weighted by the accuracy that the source
+ *  reports.
+ *
+ *  The filter can be evaluated at any time. Evaluating it at the current time
+ *  compensates for the latency of the sources.
+ */
+
+class PositionFilter
+{
+public:
+    /*! \brief Add a measurement
+     *
+     *  Measurements must be valid. They should arrive roughly in the order of
+     *  their timestamps; measurements that are older than the current state
+     *  are applied to the current state. If the measurement is far off the
+     *  current estimate, or if there have been no measurements for a while,
+     *  the filter is restarted from the measurement.
+     *
+     *  @param info Position info
+     *
+     *  @returns True if the filter was (re)started
+     */
+    bool addMeasurement(const Positioning::PositionInfo& info);
+
+    /*! \brief Estimated position
+     *
+     *  @param time Time for which the position is estimated. The estimate is
+     *  extrapolated for at most maxExtrapolationTime beyond the latest
+     *  measurement.
+     *
+     *  @returns Estimated position info, with timestamp time, or an invalid
+     *  position info if there were no measurements since the last reset
+     */
+    Positioning::PositionInfo estimate(const QDateTime& time) const;
+
+    /*! \brief Forget all measurements */
+    void reset()
+    {
+        m_initialized = false;
+    }
+
+    /*! \brief Maximal time span for extrapolation */
+    static constexpr auto maxExtrapolationTime = 5s;
+
+private:
+    // Position and velocity along one axis, with covariance matrix
+    struct Axis {
+        double position {0.0};
+        double velocity {0.0};
+        double P00 {0.0};
+        double P01 {0.0};
+        double P11 {0.0};
+
+        void initialize(double position, double positionVariance, double velocity, double velocityVariance);
+        void predict(double dt, double accelerationVariance);
+        void updatePosition(double measurement, double variance);
+        void updateVelocity(double measurement, double variance);
+    };
+
+    // Restarts the filter from the measurement
+    void initialize(const Positioning::PositionInfo& info);
+
+    // Converts between coordinates and the local frame
+    void toLocal(const QGeoCoordinate& coordinate, double& north, double& east) const;
+    QGeoCoordinate fromLocal(double north, double east) const;
+
+    bool m_initialized {false};
+    bool m_hasAltitude {false};
+
+    // Origin of the local frame, cosine of its latitude, and time of the state
+    QGeoCoordinate m_reference;
+    double m_cosReferenceLatitude {1.0};
+    QDateTime m_time;
+
+    Axis m_north;
+    Axis m_east;
+    Axis m_up;
+
+    // Latest measurement, used for attributes that are not estimated
+    Positioning::PositionInfo m_lastMeasurement;
+};
+
+}
@@ -18,120 +18,234 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+
 #include "positioning/PositionInfo.h"
 
 
 Positioning::PositionInfo::PositionInfo(const QGeoPositionInfo &info)
+    : PositionInfo(info.coordinate(), info.timestamp())
 {
-    m_positionInfo = info;
+    auto copyAttribute = [&](QGeoPositionInfo::Attribute attribute, Field field, double& member) {
+        if (info.hasAttribute(attribute)) {
+            set(field, member, info.attribute(attribute));
+        }
+    };
+    copyAttribute(QGeoPositionInfo::GroundSpeed, GroundSpeed, m_groundSpeed);
+    copyAttribute(QGeoPositionInfo::Direction, Direction, m_direction);
+    copyAttribute(QGeoPositionInfo::VerticalSpeed, VerticalSpeed, m_verticalSpeed);
+    copyAttribute(QGeoPositionInfo::HorizontalAccuracy, HorizontalAccuracy, m_horizontalAccuracy);
+    copyAttribute(QGeoPositionInfo::VerticalAccuracy, VerticalAccuracy, m_verticalAccuracy);
+    copyAttribute(QGeoPositionInfo::MagneticVariation, MagneticVariation, m_magneticVariation);
 }
 
 
-auto Positioning::PositionInfo::groundSpeed() const -> Units::Speed
+Positioning::PositionInfo::PositionInfo(const QGeoCoordinate &coordinate, const QDateTime &timestamp)
+{
+    if (coordinate.isValid()) {
+        m_latitude = coordinate.latitude();
+        m_longitude = coordinate.longitude();
+        m_fields |= Coordinate;
+        if (coordinate.type() == QGeoCoordinate::Coordinate3D) {
+            m_altitude = coordinate.altitude();
+            m_fields |= Altitude;
+        }
+    }
+    if (timestamp.isValid()) {
+        m_timestamp = timestamp.toMSecsSinceEpoch();
+        m_fields |= Timestamp;
+    }
+}
+
+
+auto Positioning::PositionInfo::coordinate() const -> QGeoCoordinate
 {
-    if (!m_positionInfo.isValid()) {
+    if ((m_fields & Coordinate) == 0) {
         return {};
     }
-    if (!m_positionInfo.hasAttribute(QGeoPositionInfo::GroundSpeed)) {
+    if ((m_fields & Altitude) == 0) {
+        return {m_latitude, m_longitude};
+    }
+    return {m_latitude, m_longitude, m_altitude};
+}
+
+
+auto Positioning::PositionInfo::direction() const -> Units::Angle
+{
+    if (!has(Direction)) {
         return {};
     }
+    return Units::Angle::fromDEG(m_direction);
+}
 
-    return Units::Speed::fromMPS(m_positionInfo.attribute(QGeoPositionInfo::GroundSpeed));
+
+auto Positioning::PositionInfo::groundSpeed() const -> Units::Speed
+{
+    if (!has(GroundSpeed)) {
+        return {};
+    }
+    return Units::Speed::fromMPS(m_groundSpeed);
 }
 
 
 auto Positioning::PositionInfo::isValid() const -> bool
 {
-    if (!m_positionInfo.isValid()) {
+    if (!has(Coordinate)) {
         return false;
     }
-
-    auto expiry = m_positionInfo.timestamp().addMSecs( std::chrono::milliseconds(lifetime).count() );
-    return expiry >= QDateTime::currentDateTime();
+    return m_timestamp + std::chrono::milliseconds(lifetime).count() >= QDateTime::currentMSecsSinceEpoch();
 }
 
 
 auto Positioning::PositionInfo::positionErrorEstimate() const -> Units::Distance
 {
-    if (!m_positionInfo.isValid()) {
+    if (!has(HorizontalAccuracy)) {
         return {};
     }
-    if (!m_positionInfo.hasAttribute(QGeoPositionInfo::HorizontalAccuracy)) {
+    return Units::Distance::fromM(m_horizontalAccuracy);
+}
+
+
+auto Positioning::PositionInfo::timestamp() const -> QDateTime
+{
+    if ((m_fields & Timestamp) == 0) {
         return {};
     }
-
-    return Units::Distance::fromM(m_positionInfo.attribute(QGeoPositionInfo::HorizontalAccuracy));
+    return QDateTime::fromMSecsSinceEpoch(m_timestamp, Qt::UTC);
 }
 
 
 auto Positioning::PositionInfo::trueAltitude() const -> Units::Distance
 {
-    if (!m_positionInfo.isValid()) {
-        return {};
-    }
-    if (m_positionInfo.coordinate().type() != QGeoCoordinate::Coordinate3D) {
+    if (!has(Altitude)) {
         return {};
     }
-
-    return Units::Distance::fromM(m_positionInfo.coordinate().altitude());
-
+    return Units::Distance::fromM(m_altitude);
 }
 
 
 auto Positioning::PositionInfo::trueAltitudeErrorEstimate() const -> Units::Distance
 {
-    if (!m_positionInfo.isValid()) {
-        return {};
-    }
-    if (!m_positionInfo.hasAttribute(QGeoPositionInfo::VerticalAccuracy)) {
+    if (!has(VerticalAccuracy)) {
         return {};
     }
-
-    return Units::Distance::fromM(m_positionInfo.attribute(QGeoPositionInfo::VerticalAccuracy));
+    return Units::Distance::fromM(m_verticalAccuracy);
 }
 
 
 auto Positioning::PositionInfo::trueTrack() const -> Units::Angle
 {
-    if (!m_positionInfo.isValid()) {
-        return {};
-    }
     if (!groundSpeed().isFinite()) {
         return {};
     }
     if (groundSpeed().toKN() < 4) {
         return {};
     }
-    if (!m_positionInfo.hasAttribute(QGeoPositionInfo::Direction)) {
-        return {};
-    }
-
-    return Units::Angle::fromDEG(m_positionInfo.attribute(QGeoPositionInfo::Direction));
+    return direction();
 }
 
 
 auto Positioning::PositionInfo::variation() const -> Units::Angle
 {
-    if (!m_positionInfo.isValid()) {
-        return {};
-    }
-    if (!m_positionInfo.hasAttribute(QGeoPositionInfo::MagneticVariation)) {
+    if (!has(MagneticVariation)) {
         return {};
     }
-
-    return Units::Angle::fromDEG(m_positionInfo.attribute(QGeoPositionInfo::MagneticVariation));
+    return Units::Angle::fromDEG(m_magneticVariation);
 }
 
 
 auto Positioning::PositionInfo::verticalSpeed() const -> Units::Speed
 {
-    if (!m_positionInfo.isValid()) {
-        return {};
-    }
-    if (!m_positionInfo.hasAttribute(QGeoPositionInfo::VerticalSpeed)) {
+    if (!has(VerticalSpeed)) {
         return {};
     }
+    return Units::Speed::fromMPS(m_verticalSpeed);
+}
+
+
+void Positioning::PositionInfo::setDirection(Units::Angle direction)
+{
+    set(Direction, m_direction, direction.toDEG());
+}
+
+
+void Positioning::PositionInfo::setGroundSpeed(Units::Speed groundSpeed)
+{
+    set(GroundSpeed, m_groundSpeed, groundSpeed.toMPS());
+}
+
+
+void Positioning::PositionInfo::setPositionErrorEstimate(Units::Distance error)
+{
+    set(HorizontalAccuracy, m_horizontalAccuracy, error.toM());
+}
+
+
+void Positioning::PositionInfo::setTrueAltitude(Units::Distance altitude)
+{
+    set(Altitude, m_altitude, altitude.toM());
+}
+
+
+void Positioning::PositionInfo::setTrueAltitudeErrorEstimate(Units::Distance error)
+{
+    set(VerticalAccuracy, m_verticalAccuracy, error.toM());
+}
+
+
+void Positioning::PositionInfo::setVariation(Units::Angle variation)
+{
+    set(MagneticVariation, m_magneticVariation, variation.toDEG());
+}
+
+
+void Positioning::PositionInfo::setVerticalSpeed(Units::Speed verticalSpeed)
+{
+    set(VerticalSpeed, m_verticalSpeed, verticalSpeed.toMPS());
+}
 
-    return Units::Speed::fromMPS(m_positionInfo.attribute(QGeoPositionInfo::VerticalSpeed));
+
+auto Positioning::PositionInfo::operator==(const Positioning::PositionInfo &rhs) const -> bool
+{
+    // Unknown fields are always zero, so that they can be compared as well
+    return (m_fields == rhs.m_fields)
+           && (m_latitude == rhs.m_latitude)
+           && (m_longitude == rhs.m_longitude)
+           && (m_altitude == rhs.m_altitude)
+           && (m_timestamp == rhs.m_timestamp)
+           && (m_groundSpeed == rhs.m_groundSpeed)
+           && (m_direction == rhs.m_direction)
+           && (m_verticalSpeed == rhs.m_verticalSpeed)
+           && (m_horizontalAccuracy == rhs.m_horizontalAccuracy)
+           && (m_verticalAccuracy == rhs.m_verticalAccuracy)
+           && (m_magneticVariation == rhs.m_magneticVariation);
+}
+
+
+Positioning::PositionInfo::operator QGeoPositionInfo() const
+{
+    QGeoPositionInfo result(coordinate(), timestamp());
+    auto copyAttribute = [&](QGeoPositionInfo::Attribute attribute, Field field, double member) {
+        if ((m_fields & field) != 0) {
+            result.setAttribute(attribute, member);
+        }
+    };
+    copyAttribute(QGeoPositionInfo::GroundSpeed, GroundSpeed, m_groundSpeed);
+    copyAttribute(QGeoPositionInfo::Direction, Direction, m_direction);
+    copyAttribute(QGeoPositionInfo::VerticalSpeed, VerticalSpeed, m_verticalSpeed);
+    copyAttribute(QGeoPositionInfo::HorizontalAccuracy, HorizontalAccuracy, m_horizontalAccuracy);
+    copyAttribute(QGeoPositionInfo::VerticalAccuracy, VerticalAccuracy, m_verticalAccuracy);
+    copyAttribute(QGeoPositionInfo::MagneticVariation, MagneticVariation, m_magneticVariation);
+    return result;
 }
 
+
+void Positioning::PositionInfo::set(Field field, double& member, double value)
+{
+    if (qIsFinite(value)) {
+        member = value;
+        m_fields |= field;
+    } else {
+        member = 0.0;
+        m_fields &= static_cast<quint16>(~field);
+    }
+}
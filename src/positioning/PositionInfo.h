@@ -34,10 +34,17 @@ namespace Positioning {
 
 /*! \brief Geographic position
  *
- *  This class is a thin wrapper around QGeoPositionInfo. It exports the data
- *  from QGeoPositionInfo in a way that can be read from QML. In addition to
- *  QGeoPositionInfo, the class also contains information about the pressure
- *  altitude.
+ *  This class holds a geographic position, together with ground speed,
+ *  direction, vertical speed, error estimates and magnetic variation, and
+ *  exports these data in a way that can be read from QML.
+ *
+ *  Position data is produced at high rates by the satellite receiver, by
+ *  traffic data sources and by every traffic factor. The class therefore
+ *  stores all data in fixed fields, with a bitmask that records which of the
+ *  fields are known, and copying an instance costs no more than copying a
+ *  few numbers. QGeoPositionInfo, which stores its attributes in a QHash
+ *  behind a shared pointer, is used only where data comes from or goes to Qt
+ *  Positioning.
  */
 
 class PositionInfo
@@ -54,6 +61,19 @@ public:
      */
     explicit PositionInfo(const QGeoPositionInfo &info);
 
+    /*! \brief Constructor
+     *
+     * Constructs a position info without ground speed, direction, vertical
+     * speed, error estimates or magnetic variation. These can be added with
+     * the setter methods.
+     *
+     * @param coordinate Coordinate. If the coordinate contains altitude
+     * information, this refers to true altitude.
+     *
+     * @param timestamp Time of the position fix
+     */
+    PositionInfo(const QGeoCoordinate &coordinate, const QDateTime &timestamp);
+
     /*! \brief Coordinate
      *
      *  If the coordinate contains altitude information, this refers to
@@ -61,10 +81,16 @@ public:
      *
      *  @returns Coordinate
      */
-    Q_INVOKABLE QGeoCoordinate coordinate() const
-    {
-        return m_positionInfo.coordinate();
-    }
+    Q_INVOKABLE QGeoCoordinate coordinate() const;
+
+    /*! \brief Direction of movement
+     *
+     *  Unlike trueTrack(), this method returns the direction as reported,
+     *  even at low ground speed.
+     *
+     *  @returns Direction or NaN if unknown.
+     */
+    Units::Angle direction() const;
 
     /*! \brief Ground speed
      *
@@ -74,8 +100,8 @@ public:
 
     /*! \brief Validity
      *
-     *  @returns True if the underlying QGeoPositionInfo is valid and if
-     *  its age is less then PositionInfo::lifetime.
+     *  @returns True if coordinate and timestamp are valid and if the age
+     *  is less then PositionInfo::lifetime.
      */
     Q_INVOKABLE bool isValid() const;
 
@@ -85,6 +111,12 @@ public:
      */
     Q_INVOKABLE Units::Distance positionErrorEstimate() const;
 
+    /*! \brief Time of the position fix
+     *
+     *  @returns Timestamp, in UTC, or an invalid QDateTime if unknown
+     */
+    Q_INVOKABLE QDateTime timestamp() const;
+
     /*! \brief True Altitude
      *
      *  @returns True altitude with geoid correction taken into account or NaN
@@ -116,22 +148,69 @@ public:
      */
     Q_INVOKABLE Units::Speed verticalSpeed() const;
 
+    /*! \brief Set direction of movement
+     *
+     *  @param direction Direction. If the value is not finite, the direction
+     *  becomes unknown.
+     */
+    void setDirection(Units::Angle direction);
+
+    /*! \brief Set ground speed
+     *
+     *  @param groundSpeed Ground speed. If the value is not finite, the ground
+     *  speed becomes unknown.
+     */
+    void setGroundSpeed(Units::Speed groundSpeed);
+
+    /*! \brief Set position error estimate
+     *
+     *  @param error Error estimate. If the value is not finite, the error
+     *  estimate becomes unknown.
+     */
+    void setPositionErrorEstimate(Units::Distance error);
+
+    /*! \brief Set true altitude
+     *
+     *  @param altitude True altitude. If the value is not finite, the altitude
+     *  becomes unknown.
+     */
+    void setTrueAltitude(Units::Distance altitude);
+
+    /*! \brief Set true altitude error estimate
+     *
+     *  @param error Error estimate. If the value is not finite, the error
+     *  estimate becomes unknown.
+     */
+    void setTrueAltitudeErrorEstimate(Units::Distance error);
+
+    /*! \brief Set magnetic variation
+     *
+     *  @param variation Magnetic variation. If the value is not finite, the
+     *  variation becomes unknown.
+     */
+    void setVariation(Units::Angle variation);
+
+    /*! \brief Set vertical speed
+     *
+     *  @param verticalSpeed Vertical speed. If the value is not finite, the
+     *  vertical speed becomes unknown.
+     */
+    void setVerticalSpeed(Units::Speed verticalSpeed);
+
     /*! \brief Comparison: equal
      *
      *  @param rhs Right hand side of the comparison
      *
      *  @returns Result of the comparison
      */
-    Q_INVOKABLE auto operator==(const Positioning::PositionInfo &rhs) const
-    {
-        return (m_positionInfo == rhs.m_positionInfo);
-    }
+    Q_INVOKABLE bool operator==(const Positioning::PositionInfo &rhs) const;
 
-    /*! \brief Conversion */
-    operator QGeoPositionInfo() const
-    {
-        return m_positionInfo;
-    }
+    /*! \brief Conversion
+     *
+     *  This conversion constructs a QGeoPositionInfo and should only be used
+     *  where data is handed over to Qt Positioning.
+     */
+    operator QGeoPositionInfo() const;
 
     /*! \brief Liftetime of geographic positioning information
      *
@@ -142,7 +221,42 @@ public:
 
 
 private:
-    QGeoPositionInfo m_positionInfo {};
+    // Bits of m_fields, one for each field that is known
+    enum Field : quint16 {
+        Coordinate = 0x001,
+        Altitude = 0x002,
+        Timestamp = 0x004,
+        GroundSpeed = 0x008,
+        Direction = 0x010,
+        VerticalSpeed = 0x020,
+        HorizontalAccuracy = 0x040,
+        VerticalAccuracy = 0x080,
+        MagneticVariation = 0x100
+    };
+
+    // Checks if coordinate, timestamp and the given field are known
+    bool has(Field field) const
+    {
+        auto mask = Coordinate|Timestamp|field;
+        return (m_fields & mask) == mask;
+    }
+
+    // Sets a field, or marks it unknown if value is not finite
+    void set(Field field, double& member, double value);
+
+    // Values in degrees, meters, seconds and milliseconds since epoch.
+    // Fields whose bit is not set in m_fields are zero.
+    double m_latitude {0.0};
+    double m_longitude {0.0};
+    double m_altitude {0.0};
+    qint64 m_timestamp {0};
+    double m_groundSpeed {0.0};
+    double m_direction {0.0};
+    double m_verticalSpeed {0.0};
+    double m_horizontalAccuracy {0.0};
+    double m_verticalAccuracy {0.0};
+    double m_magneticVariation {0.0};
+    quint16 m_fields {0};
 };
 
 }
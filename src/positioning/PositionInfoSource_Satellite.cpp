@@ -27,7 +27,7 @@ Positioning::PositionInfoSource_Satellite::PositionInfoSource_Satellite(QObject
     source = QGeoPositionInfoSource::createDefaultSource(this);
     if (source != nullptr) {
         source->setPreferredPositioningMethods(QGeoPositionInfoSource::AllPositioningMethods);
-        source->setUpdateInterval(1000);
+        source->setUpdateInterval(static_cast<int>(m_updateInterval.count()));
 
         QString sName = source->sourceName();
         if (sName.isEmpty()) {
@@ -47,6 +47,32 @@ Positioning::PositionInfoSource_Satellite::PositionInfoSource_Satellite(QObject
 }
 
 
+void Positioning::PositionInfoSource_Satellite::setPaused(bool paused)
+{
+    if ((source == nullptr) || (paused == m_paused)) {
+        return;
+    }
+    m_paused = paused;
+
+    if (m_paused) {
+        source->stopUpdates();
+    } else {
+        source->startUpdates();
+    }
+    updateStatusString();
+}
+
+
+void Positioning::PositionInfoSource_Satellite::setUpdateInterval(std::chrono::milliseconds interval)
+{
+    if ((source == nullptr) || (interval == m_updateInterval)) {
+        return;
+    }
+    m_updateInterval = interval;
+    source->setUpdateInterval(static_cast<int>(m_updateInterval.count()));
+}
+
+
 void Positioning::PositionInfoSource_Satellite::updateStatusString()
 {
     if (source == nullptr) {
@@ -54,6 +80,11 @@ void Positioning::PositionInfoSource_Satellite::updateStatusString()
         return;
     }
 
+    if (m_paused) {
+        setStatusString( tr("Paused, position provided by traffic receiver") );
+        return;
+    }
+
     auto sourceStatus = source->error();
 
     if (sourceStatus == QGeoPositionInfoSource::AccessError) {
@@ -33,6 +33,10 @@ namespace Positioning {
  *  This class is a thin wrapper around QGeoPositionInfoSource. It constructs a
  *  default QGeoPositionInfoSource and forwards the data provided by that source
  *  via the PositionInfoSource_Abstract interface that it implements.
+ *
+ *  The update interval of the underlying source can be changed, and the
+ *  source can be paused, in order to save energy when the satellite receiver
+ *  adds no information.
  */
 
 class PositionInfoSource_Satellite : public PositionInfoSource_Abstract
@@ -46,6 +50,26 @@ public:
      */
     explicit PositionInfoSource_Satellite(QObject *parent = nullptr);
 
+    /*! \brief Default update interval */
+    static constexpr auto defaultUpdateInterval = 1s;
+
+    /*! \brief Pause or resume the underlying source
+     *
+     *  While paused, the underlying QGeoPositionInfoSource is stopped and no
+     *  position info arrives. Nothing happens if the state does not change.
+     *
+     *  @param paused True if the source shall be paused
+     */
+    void setPaused(bool paused);
+
+    /*! \brief Set update interval of the underlying source
+     *
+     *  Nothing happens if the interval does not change.
+     *
+     *  @param interval Update interval
+     */
+    void setUpdateInterval(std::chrono::milliseconds interval);
+
 private slots:
     void onPositionUpdated(const QGeoPositionInfo &info);
 
@@ -55,6 +79,8 @@ private:
     Q_DISABLE_COPY_MOVE(PositionInfoSource_Satellite)
 
     QPointer<QGeoPositionInfoSource> source {nullptr};
+    std::chrono::milliseconds m_updateInterval {defaultUpdateInterval};
+    bool m_paused {false};
 };
 
 }
@@ -19,25 +19,30 @@
  ***************************************************************************/
 
 #include <QApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QSaveFile>
 #include <QSettings>
+#include <QStandardPaths>
 
 #include "GlobalObject.h"
+#include "InitScheduler.h"
+#include "dataManagement/DataManager.h"
+#include "navigation/Navigator.h"
+#include "positioning/Geoid.h"
 #include "positioning/PositionProvider.h"
 #include "traffic/TrafficDataProvider.h"
 
 
+// Static member variables
+
+SeqLock<Positioning::PositionProvider::LastValid> Positioning::PositionProvider::s_lastValid {};
+
+
 Positioning::PositionProvider::PositionProvider(QObject *parent) : PositionInfoSource_Abstract(parent)
 {
     // Restore the last valid coordiante and track
-    QSettings settings;
-    QGeoCoordinate tmp;
-    tmp.setLatitude(settings.value(QStringLiteral("PositionProvider/lastValidLatitude"), m_lastValidCoordinate.latitude()).toDouble());
-    tmp.setLongitude(settings.value(QStringLiteral("PositionProvider/lastValidLongitude"), m_lastValidCoordinate.longitude()).toDouble());
-    tmp.setAltitude(settings.value(QStringLiteral("PositionProvider/lastValidAltitude"), m_lastValidCoordinate.altitude()).toDouble());
-    if ((tmp.type() == QGeoCoordinate::Coordinate2D) || (tmp.type() == QGeoCoordinate::Coordinate3D)) {
-        m_lastValidCoordinate = tmp;
-    }
-    m_lastValidTT = Units::Angle::fromDEG( qBound(0, settings.value(QStringLiteral("PositionProvider/lastValidTrack"), 0).toInt(), 359) );
+    loadPositionAndTrack();
 
     // Wire up satellite source
     connect(&satelliteSource, &Positioning::PositionInfoSource_Satellite::positionInfoChanged, this, &PositionProvider::onPositionUpdated);
@@ -50,12 +55,31 @@ Positioning::PositionProvider::PositionProvider(QObject *parent) : PositionInfoS
     // Wire up traffic data provider source
     QTimer::singleShot(0, this, &Positioning::PositionProvider::deferredInitialization);
 
-    // Save position at regular intervals
+    // Publish fused positions at a fixed rate
+    m_publishTimer.setInterval(publishInterval);
+    m_publishTimer.setSingleShot(false);
+    connect(&m_publishTimer, &QTimer::timeout, this, &Positioning::PositionProvider::publishPosition);
+
+    // Resume the satellite source when the traffic receiver stops sending fixes
+    m_trafficFixWatchdog.setInterval(trafficFixTimeout);
+    m_trafficFixWatchdog.setSingleShot(true);
+    connect(&m_trafficFixWatchdog, &QTimer::timeout, this, [this]() {
+        m_trafficFixesTimer.invalidate();
+        updateSatelliteUpdateInterval();
+    });
+
+    // Save position at regular intervals, when the app is paused and when
+    // the app quits. Nothing is written if nothing has changed.
     auto* saveTimer = new QTimer(this);
-    saveTimer->setInterval(1min + 57s);
+    saveTimer->setInterval(5min);
     saveTimer->setSingleShot(false);
     connect(saveTimer, &QTimer::timeout, this, &Positioning::PositionProvider::savePositionAndTrack);
     connect(qApp, &QApplication::aboutToQuit, this, &Positioning::PositionProvider::savePositionAndTrack);
+    connect(qApp, &QGuiApplication::applicationStateChanged, this, [this](Qt::ApplicationState state) {
+        if (state != Qt::ApplicationActive) {
+            savePositionAndTrack();
+        }
+    });
     saveTimer->start();
 
     // Update properties
@@ -64,42 +88,121 @@ Positioning::PositionProvider::PositionProvider(QObject *parent) : PositionInfoS
 
 
 
-void Positioning::PositionProvider::deferredInitialization() const
+void Positioning::PositionProvider::deferredInitialization()
 {
+    // Read geoid data in the background, before the first position arrives
+    GlobalObject::initScheduler()->addTask("geoid", {}, []() { return Geoid::preload(); });
+    connect(GlobalObject::dataManager()->geoidModels(), &DataManagement::DownloadableGroupWatcher::downloadablesWithFileChanged, this, &PositionProvider::setGeoidModels);
+    setGeoidModels(GlobalObject::dataManager()->geoidModels()->downloadablesWithFile());
 
     connect(GlobalObject::trafficDataProvider(), &Traffic::TrafficDataProvider::positionInfoChanged, this, &PositionProvider::onPositionUpdated);
     connect(GlobalObject::trafficDataProvider(), &Traffic::TrafficDataProvider::pressureAltitudeChanged, this, &PositionProvider::onPressureAltitudeUpdated);
+    connect(GlobalObject::navigator(), &Navigation::Navigator::isInFlightChanged, this, &PositionProvider::updateSatelliteUpdateInterval);
+
+}
+
+
+void Positioning::PositionProvider::onGeoidModelAboutToChange(const QString& localFileName)
+{
+    auto model = Geoid::highResolutionModel();
+    if ((model != nullptr) && (model->fileName() == localFileName)) {
+        Geoid::setHighResolutionModel(nullptr);
+    }
+}
+
+
+void Positioning::PositionProvider::setGeoidModels(const QVector<QPointer<DataManagement::Downloadable>>& downloadables)
+{
+    auto current = Geoid::highResolutionModel();
+    std::shared_ptr<const GeoidRaster> newModel;
+    for(const auto& downloadable : downloadables) {
+        if (downloadable.isNull()) {
+            continue;
+        }
+        connect(downloadable, &DataManagement::Downloadable::aboutToChangeFile, this, &Positioning::PositionProvider::onGeoidModelAboutToChange, Qt::UniqueConnection);
+        if (newModel != nullptr) {
+            continue;
+        }
+
+        auto fileName = downloadable->fileName();
+        if ((current != nullptr) && (current->fileName() == fileName)) {
+            newModel = current;
+            continue;
+        }
+        auto model = std::make_shared<const GeoidRaster>(fileName);
+        if (!model->isValid()) {
+            qWarning() << "Geoid model" << fileName << "is invalid";
+            continue;
+        }
+        newModel = model;
+    }
+    Geoid::setHighResolutionModel(newModel);
+}
+
 
+auto Positioning::PositionProvider::addMeasurement(const Positioning::PositionInfo& info, QDateTime& lastTimestamp) -> bool
+{
+    if (!info.isValid()) {
+        return false;
+    }
+    auto timestamp = info.timestamp();
+    if (timestamp == lastTimestamp) {
+        return false;
+    }
+    lastTimestamp = timestamp;
+    return m_positionFilter.addMeasurement(info);
 }
 
 
 void Positioning::PositionProvider::onPositionUpdated()
 {
     // This method is called if one of our providers has a new position info.
-    // We go through the list of providers in order of preference, to find the first one
-    // that has a valid position info available for us.
-    PositionInfo info;
+    // New position infos of all providers are fed into the filter. The source
+    // name is taken from the first provider, in order of preference, that has
+    // a valid position info.
+    PositionInfo trafficInfo;
     QString source;
 
     // Priority #1: Traffic data provider
     auto* trafficDataProvider = GlobalObject::trafficDataProvider();
     if (trafficDataProvider != nullptr) {
-        info = trafficDataProvider->positionInfo();
+        trafficInfo = trafficDataProvider->positionInfo();
         source = trafficDataProvider->sourceName();
     }
 
     // Priority #2: Built-in sat receiver
-    if (!info.isValid()) {
-        info = satelliteSource.positionInfo();
+    auto satelliteInfo = satelliteSource.positionInfo();
+    if (!trafficInfo.isValid()) {
         source = satelliteSource.sourceName();
     }
-
-    // Set new info
-    setPositionInfo(info);
-    setLastValidCoordinate(info.coordinate());
-    setLastValidTT(info.trueTrack());
     setSourceName(source);
-    updateStatusString();
+
+    // If no provider has a valid position info, then neither do we
+    if (!trafficInfo.isValid() && !satelliteInfo.isValid()) {
+        m_positionFilter.reset();
+        m_publishTimer.stop();
+        setPositionInfo({});
+        updateStatusString();
+        return;
+    }
+
+    // Feed filter. If the filter has been (re)started, publish right away.
+    auto previousTrafficTimestamp = m_lastTrafficTimestamp;
+    bool restarted = addMeasurement(satelliteInfo, m_lastSatelliteTimestamp);
+    restarted = addMeasurement(trafficInfo, m_lastTrafficTimestamp) || restarted;
+    if (restarted || !m_publishTimer.isActive()) {
+        m_publishTimer.start();
+        publishPosition();
+    }
+
+    // Keep track of the fixes that arrive from the traffic receiver
+    if (m_lastTrafficTimestamp != previousTrafficTimestamp) {
+        if (!m_trafficFixWatchdog.isActive()) {
+            m_trafficFixesTimer.start();
+        }
+        m_trafficFixWatchdog.start();
+    }
+    updateSatelliteUpdateInterval();
 }
 
 
@@ -127,16 +230,89 @@ void Positioning::PositionProvider::onPressureAltitudeUpdated()
 }
 
 
+void Positioning::PositionProvider::publishPosition()
+{
+    auto info = m_positionFilter.estimate(QDateTime::currentDateTimeUtc());
+    if (!info.isValid()) {
+        return;
+    }
+
+    setPositionInfo(info);
+    setLastValidCoordinate(info.coordinate());
+    setLastValidTT(info.trueTrack());
+    updateStatusString();
+}
+
+
+auto Positioning::PositionProvider::positionFileName() -> QString
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)+"/lastPosition.dat";
+}
+
+
+void Positioning::PositionProvider::loadPositionAndTrack()
+{
+    double latitude = m_lastValidCoordinate.latitude();
+    double longitude = m_lastValidCoordinate.longitude();
+    double altitude = m_lastValidCoordinate.altitude();
+    double track = 0.0;
+
+    QFile file(positionFileName());
+    if (file.open(QIODevice::ReadOnly)) {
+        QDataStream inputStream(&file);
+        inputStream.setVersion(QDataStream::Qt_5_15);
+        quint32 magic = 0;
+        quint32 version = 0;
+        inputStream >> magic >> version;
+        if ((magic == positionFileMagic) && (version == 1)) {
+            inputStream >> latitude >> longitude >> altitude >> track;
+        }
+        if (inputStream.status() != QDataStream::Ok) {
+            latitude = m_lastValidCoordinate.latitude();
+            longitude = m_lastValidCoordinate.longitude();
+            altitude = m_lastValidCoordinate.altitude();
+            track = 0.0;
+        }
+    } else {
+        // Older versions of the app stored the values in QSettings
+        QSettings settings;
+        latitude = settings.value(QStringLiteral("PositionProvider/lastValidLatitude"), latitude).toDouble();
+        longitude = settings.value(QStringLiteral("PositionProvider/lastValidLongitude"), longitude).toDouble();
+        altitude = settings.value(QStringLiteral("PositionProvider/lastValidAltitude"), altitude).toDouble();
+        track = settings.value(QStringLiteral("PositionProvider/lastValidTrack"), 0.0).toDouble();
+        settings.remove(QStringLiteral("PositionProvider"));
+        m_positionAndTrackModified = true;
+    }
+
+    QGeoCoordinate tmp(latitude, longitude, altitude);
+    if ((tmp.type() == QGeoCoordinate::Coordinate2D) || (tmp.type() == QGeoCoordinate::Coordinate3D)) {
+        m_lastValidCoordinate = tmp;
+    }
+    m_lastValidTT = Units::Angle::fromDEG( qBound(0, qRound(track), 359) );
+    publishLastValid();
+}
+
+
 void Positioning::PositionProvider::savePositionAndTrack()
 {
-    // Save the last valid coordinate
-    QSettings settings;
-    settings.setValue(QStringLiteral("PositionProvider/lastValidLatitude"), m_lastValidCoordinate.latitude());
-    settings.setValue(QStringLiteral("PositionProvider/lastValidLongitude"), m_lastValidCoordinate.longitude());
-    settings.setValue(QStringLiteral("PositionProvider/lastValidAltitude"), m_lastValidCoordinate.altitude());
+    if (!m_positionAndTrackModified) {
+        return;
+    }
 
-    // Save the last valid track
-    settings.setValue(QStringLiteral("PositionProvider/lastValidTrack"), m_lastValidTT.toDEG());
+    // Write the last valid coordinate and track as a single record
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    QSaveFile file(positionFileName());
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream outputStream(&file);
+    outputStream.setVersion(QDataStream::Qt_5_15);
+    outputStream << positionFileMagic << static_cast<quint32>(1);
+    outputStream << m_lastValidCoordinate.latitude() << m_lastValidCoordinate.longitude() << m_lastValidCoordinate.altitude();
+    outputStream << m_lastValidTT.toDEG();
+    if (file.commit()) {
+        m_positionAndTrackModified = false;
+    }
 }
 
 
@@ -149,6 +325,8 @@ void Positioning::PositionProvider::setLastValidCoordinate(const QGeoCoordinate
         return;
     }
     m_lastValidCoordinate = newCoordinate;
+    m_positionAndTrackModified = true;
+    publishLastValid();
     emit lastValidCoordinateChanged(m_lastValidCoordinate);
 }
 
@@ -162,27 +340,56 @@ void Positioning::PositionProvider::setLastValidTT(Units::Angle newTT)
         return;
     }
     m_lastValidTT = newTT;
+    m_positionAndTrackModified = true;
+    publishLastValid();
     emit lastValidTTChanged(m_lastValidTT);
 }
 
 
+void Positioning::PositionProvider::publishLastValid()
+{
+    LastValid lastValid;
+    lastValid.latitude = m_lastValidCoordinate.latitude();
+    lastValid.longitude = m_lastValidCoordinate.longitude();
+    lastValid.altitude = m_lastValidCoordinate.altitude();
+    lastValid.trackInDEG = m_lastValidTT.toDEG();
+    s_lastValid.store(lastValid);
+}
+
+
 auto Positioning::PositionProvider::lastValidCoordinate() -> QGeoCoordinate
 {
-    auto *positionProvider = GlobalObject::positionProvider();
-    if (positionProvider == nullptr) {
-        return {};
-    }
-    return positionProvider->m_lastValidCoordinate;
+    auto lastValid = s_lastValid.load();
+    return {lastValid.latitude, lastValid.longitude, lastValid.altitude};
 }
 
 
 auto Positioning::PositionProvider::lastValidTT() -> Units::Angle
 {
-    auto *positionProvider = GlobalObject::positionProvider();
-    if (positionProvider == nullptr) {
-        return {};
+    return Units::Angle::fromDEG(s_lastValid.load().trackInDEG);
+}
+
+
+void Positioning::PositionProvider::updateSatelliteUpdateInterval()
+{
+    // The satellite source adds no information while the traffic receiver
+    // steadily delivers fixes
+    if (m_trafficFixesTimer.isValid() && (m_trafficFixesTimer.elapsed() >= std::chrono::milliseconds(trafficFixesBeforePause).count())) {
+        satelliteSource.setPaused(true);
+        return;
+    }
+    satelliteSource.setPaused(false);
+
+    // While parked, a low update rate suffices
+    auto* navigator = GlobalObject::navigator();
+    auto groundSpeed = positionInfo().groundSpeed();
+    auto parked = (navigator != nullptr) && !navigator->isInFlight()
+            && groundSpeed.isFinite() && (groundSpeed.toKN() < maxParkedSpeedInKT);
+    if (parked) {
+        satelliteSource.setUpdateInterval(parkedUpdateInterval);
+    } else {
+        satelliteSource.setUpdateInterval(PositionInfoSource_Satellite::defaultUpdateInterval);
     }
-    return positionProvider->m_lastValidTT;
 }
 
 
@@ -20,6 +20,11 @@
 
 #pragma once
 
+#include <QElapsedTimer>
+
+#include "SeqLock.h"
+#include "dataManagement/Downloadable.h"
+#include "positioning/PositionFilter.h"
 #include "positioning/PositionInfoSource_Abstract.h"
 #include "positioning/PositionInfoSource_Satellite.h"
 
@@ -29,14 +34,23 @@ namespace Positioning {
 /*! \brief Central Position Provider
  *
  *  This class collects position data from the various sources (satellite,
- *  network, traffic receiver, …)  chooses the best available source and exposes
- *  the data to QML and other parts of the program.
+ *  network, traffic receiver, …) and exposes the data to QML and other parts
+ *  of the program. The positions of all sources are fused by a
+ *  PositionFilter. The fused position is published at a fixed rate, once per
+ *  publishInterval, extrapolated to the time of publication.
+ *
+ *  To save energy, the built-in satellite receiver is paused while a traffic
+ *  receiver steadily delivers position fixes, and runs at a reduced rate
+ *  while the aircraft is parked.
  *
  *  There exists one static instance of this class, which can be accessed via
  *  the method globalInstance().  No other instance of this class should be
  *  used.
  *
- *  The methods in this class are reentrant, but not thread safe.
+ *  The methods in this class are reentrant, but not thread safe. The only
+ *  exceptions are the static methods lastValidCoordinate() and lastValidTT(),
+ *  which can be called from any thread. They read a copy of the values that
+ *  is published through a SeqLock, without locks and without queued signals.
  */
 
 class PositionProvider : public PositionInfoSource_Abstract
@@ -54,8 +68,9 @@ public:
      *
      *  This property holds the last valid coordinate known.  At the first
      *  start, this property is set to the location Freiburg Airport, EDTF.  The
-     *  value is stored in a QSetting at destruction, and restored in the
-     *  construction.
+     *  value is stored in a file at regular intervals, when the app is paused
+     *  and when the app quits, and restored in the construction. The getter
+     *  can be called from any thread.
      */
     Q_PROPERTY(QGeoCoordinate lastValidCoordinate READ lastValidCoordinate NOTIFY lastValidCoordinateChanged)
 
@@ -69,7 +84,8 @@ public:
      *
      *  This property holds the last valid true track known.  At the first
      *  start, this property is set to 0°.  The value is stored in a QSetting at
-     *  destruction, and restored in the construction.
+     *  destruction, and restored in the construction. The getter can be called
+     *  from any thread.
      */
     Q_PROPERTY(Units::Angle lastValidTT READ lastValidTT NOTIFY lastValidTTChanged)
 
@@ -79,6 +95,20 @@ public:
      */
     static Units::Angle lastValidTT();
 
+    /*! \brief Version of lastValidCoordinate and lastValidTT
+     *
+     *  This method can be called from any thread. Readers on other threads
+     *  that keep a copy of lastValidCoordinate can use it to update the copy
+     *  only after it has changed.
+     *
+     *  @returns Even number that changes whenever lastValidCoordinate or
+     *  lastValidTT changes
+     */
+    static quint32 lastValidVersion()
+    {
+        return s_lastValid.version();
+    }
+
 signals:
     /*! \brief Notifier signal */
     void lastValidTTChanged(Units::Angle);
@@ -89,7 +119,14 @@ signals:
 private slots:   
     // Intializations that are moved out of the constructor, in order to avoid
     // nested uses of constructors in Global.
-    void deferredInitialization() const;
+    void deferredInitialization();
+
+    // Falls back to EGM96 before the Downloadable changes the file of the
+    // high-resolution geoid model
+    void onGeoidModelAboutToChange(const QString& localFileName);
+
+    // Installs the first valid high-resolution geoid model of the DataManager
+    void setGeoidModels(const QVector<QPointer<DataManagement::Downloadable>>& downloadables);
 
     // Connected to sources, in order to receive new data
     void onPositionUpdated();
@@ -97,7 +134,8 @@ private slots:
     // Connected to sources, in order to receive new data
     void onPressureAltitudeUpdated();
 
-    // Saves last valid position and track
+    // Saves last valid position and track, if they have changed since the
+    // last save
     void savePositionAndTrack();
 
     // Setter method for property with the same name
@@ -109,6 +147,14 @@ private slots:
     // Setter method for property with the same name
     void updateStatusString();
 
+    // Publishes the current estimate of m_positionFilter
+    void publishPosition();
+
+    // Pauses, resumes or slows down the satellite source, depending on
+    // whether the traffic receiver delivers fixes, on the flight status and
+    // on the ground speed
+    void updateSatelliteUpdateInterval();
+
 private:
     Q_DISABLE_COPY_MOVE(PositionProvider)
 
@@ -122,10 +168,57 @@ private:
     static constexpr double EDTF_lon = 7.832583;
     static constexpr double EDTF_ele = 244;
 
+    // Interval between two publications of the fused position
+    static constexpr auto publishInterval = 500ms;
+
+    // Aircraft is considered parked if it is not flying and slower than this
+    static constexpr double maxParkedSpeedInKT = 2.0;
+    // Update interval of the satellite source while parked
+    static constexpr auto parkedUpdateInterval = 5s;
+    // The satellite source is paused once the traffic receiver has delivered
+    // fixes for this long, and resumed if no fix arrives for trafficFixTimeout
+    static constexpr auto trafficFixesBeforePause = 10s;
+    static constexpr auto trafficFixTimeout = 3s;
+
+    // Adds info to the filter, unless it is invalid or has the same timestamp
+    // as lastTimestamp. Returns true if the filter was (re)started.
+    bool addMeasurement(const Positioning::PositionInfo& info, QDateTime& lastTimestamp);
+
+    // Restores last valid position and track
+    void loadPositionAndTrack();
+
+    // Name of the file that holds last valid position and track, and the
+    // magic number that identifies the file
+    static QString positionFileName();
+    static constexpr quint32 positionFileMagic = 0x504f5331;
+
     PositionInfoSource_Satellite satelliteSource;
 
+    PositionFilter m_positionFilter;
+    QTimer m_publishTimer;
+    QDateTime m_lastSatelliteTimestamp;
+    QDateTime m_lastTrafficTimestamp;
+
+    // Running while the traffic receiver steadily delivers fixes
+    QElapsedTimer m_trafficFixesTimer;
+    QTimer m_trafficFixWatchdog;
+
     QGeoCoordinate m_lastValidCoordinate {EDTF_lat, EDTF_lon, EDTF_ele};
     Units::Angle m_lastValidTT {};
+    bool m_positionAndTrackModified {false};
+
+    // Copy of m_lastValidCoordinate and m_lastValidTT, for readers on other
+    // threads. Written by publishLastValid() on the GUI thread only.
+    struct LastValid {
+        double latitude {EDTF_lat};
+        double longitude {EDTF_lon};
+        double altitude {EDTF_ele};
+        double trackInDEG {qQNaN()};
+    };
+    static SeqLock<LastValid> s_lastValid;
+
+    // Stores m_lastValidCoordinate and m_lastValidTT in s_lastValid
+    void publishLastValid();
 };
 
 }
@@ -42,8 +42,8 @@ Dialog {
         id: waypointDelegate
 
         WordWrappingItemDelegate {
-            text: model.modelData.twoLineTitle
-            icon.source: model.modelData.icon
+            text: model.twoLineTitle
+            icon.source: "image://icons" + model.icon
 
             width: wpList.width
 
@@ -78,9 +78,9 @@ Dialog {
             focus: true
 
             onAccepted: {
-                if (wpList.model.length > 0) {
+                if (wpList.model.size() > 0) {
                     global.mobileAdaptor().vibrateBrief()
-                    global.navigator().flightRoute.append(wpList.model[0])
+                    global.navigator().flightRoute.append(wpList.model.waypoint(0))
                     close()
                 }
             }
@@ -95,7 +95,7 @@ Dialog {
             clip: true
 
 
-            model: global.geoMapProvider().filteredWaypointObjects(textInput.displayText)
+            model: global.geoMapProvider().filteredWaypointModel(textInput.displayText)
             delegate: waypointDelegate
             ScrollIndicator.vertical: ScrollIndicator {}
 
@@ -299,7 +299,7 @@ Dialog {
             Layout.fillWidth: true
 
             Icon {
-                source: waypoint.icon
+                source: "image://icons" + waypoint.icon
             }
 
             Label {
@@ -58,7 +58,7 @@ Dialog {
             id: headX
             Layout.fillWidth: true
 
-            Icon { source: (weatherStation !== null) ? weatherStation.icon : "/icons/waypoints/WP.svg" }
+            Icon { source: "image://icons" + ((weatherStation !== null) ? weatherStation.icon : "/icons/waypoints/WP.svg") }
 
             Label {
                 text: (weatherStation !== null) ? weatherStation.extendedName : ""
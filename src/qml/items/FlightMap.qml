@@ -37,12 +37,17 @@ Map {
     */
     property real pixelPer10km: 0.0
 
-    /*! \brief Name of a GeoJSON file containing airspace and waypoint information */
-    property string geoJSON
-    
     /*! \brief Width of thick lines around airspaces, such as class D */
     property real airspaceLineWidth: 7.0
 
+    /*! \brief Level of detail
+
+    This read-only property is lowered by the RenderBudget while frames are
+    slow. Label layers of minor importance are hidden at ReducedDetail, all
+    airspace labels are hidden at MinimalDetail.
+    */
+    readonly property int detailLevel: global.renderBudget().detailLevel
+
     /*
     * Handle changes in zoom level
     */
@@ -66,19 +71,27 @@ Map {
     
     /*************************************
      * Aviation Data
+     *
+     * The source "aviationData" is defined in the style file, see
+     * GeoMapProvider::styleFileURL. It serves the aviation maps as vector
+     * tiles, with a single layer called "aviationData".
      *************************************/
-    
-    MapParameter {
-        type: "source"
-        
-        property string name: "aviationData"
-        property string sourceType: "geojson"
-        property string data: flightMap.geoJSON
-    }
 
     /*************************************
      * Airspaces
+     *
+     * The aviation data always contains all airspaces. Gliding sectors and
+     * upper airspaces are hidden by layer visibility and layer filters, so
+     * that changing the settings does not require a reload of the data.
      *************************************/
+
+    // Extends the filter of an airspace layer, so that features marked as
+    // "UPPER" are hidden if the user chose to hide upper airspaces
+    function airspaceFilter(filter) {
+        if (!global.settings().hideUpperAirspaces)
+            return filter
+        return ["all", filter, ["!=", ["get", "UPPER"], true]]
+    }
     
     MapParameter {
         type: "image"
@@ -98,9 +111,15 @@ Map {
         property string name: "FIS"
         property string layerType: "line"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "FIS"]
+        property string sourceLayer: "aviationData"
         property int maxzoom: 10
     }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "FIS"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "FIS"])
+    }
 
     MapParameter {
         type: "paint"
@@ -119,8 +138,15 @@ Map {
         property string name: "glidingSector"
         property string layerType: "fill"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["==", ["get", "CAT"], "GLD"]
     }
+    MapParameter {
+        type: "layout"
+
+        property string layer: "glidingSector"
+        property string visibility: global.settings().hideGlidingSectors ? "none" : "visible"
+    }
     MapParameter {
         type: "paint"
         property string layer: "glidingSector"
@@ -134,8 +160,15 @@ Map {
         property string name: "glidingSectorOutlines"
         property string layerType: "line"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["==", ["get", "CAT"], "GLD"]
     }
+    MapParameter {
+        type: "layout"
+
+        property string layer: "glidingSectorOutlines"
+        property string visibility: global.settings().hideGlidingSectors ? "none" : "visible"
+    }
     MapParameter {
         type: "paint"
         property string layer: "glidingSectorOutlines"
@@ -150,12 +183,19 @@ Map {
         property string name: "glidingSectorLabels"
         property string layerType: "symbol"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["==", ["get", "CAT"], "GLD"]
         property int minzoom: 10
     }
     MapParameter {
         type: "layout"
 
+        property string layer: "glidingSectorLabels"
+        property string visibility: (global.settings().hideGlidingSectors || (detailLevel >= RenderBudget.MinimalDetail)) ? "none" : "visible"
+    }
+    MapParameter {
+        type: "layout"
+
         property string layer: "glidingSectorLabels"
         property var textField: ["get", "NAM"]
         property real textSize: 12
@@ -175,7 +215,13 @@ Map {
         property string name: "RMZ"
         property string layerType: "fill"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "RMZ"]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "RMZ"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "RMZ"])
     }
     
     MapParameter {
@@ -191,7 +237,13 @@ Map {
         property string name: "RMZoutline"
         property string layerType: "line"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "RMZ"]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "RMZoutline"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "RMZ"])
     }
     
     MapParameter {
@@ -208,9 +260,21 @@ Map {
         property string name: "RMZLabels"
         property string layerType: "symbol"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "RMZ"]
+        property string sourceLayer: "aviationData"
         property int minzoom: 10
     }
+    MapParameter {
+        type: "layout"
+
+        property string layer: "RMZLabels"
+        property string visibility: (detailLevel >= RenderBudget.MinimalDetail) ? "none" : "visible"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "RMZLabels"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "RMZ"])
+    }
     
     MapParameter {
         type: "layout"
@@ -234,7 +298,13 @@ Map {
         property string name: "TMZ"
         property string layerType: "line"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "TMZ"]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "TMZ"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "TMZ"])
     }
     
     MapParameter {
@@ -256,7 +326,13 @@ Map {
         property string name: "PJE"
         property string layerType: "line"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "PJE"]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "PJE"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "PJE"])
     }
     
     MapParameter {
@@ -278,7 +354,13 @@ Map {
         property string name: "ABCDOutlines"
         property string layerType: "line"
         property string source: "aviationData"
-        property var filter: ["any", ["==", ["get", "CAT"], "A"], ["==", ["get", "CAT"], "B"], ["==", ["get", "CAT"], "C"], ["==", ["get", "CAT"], "D"]]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "ABCDOutlines"
+        property var filter: airspaceFilter(["any", ["==", ["get", "CAT"], "A"], ["==", ["get", "CAT"], "B"], ["==", ["get", "CAT"], "C"], ["==", ["get", "CAT"], "D"]])
     }
     
     MapParameter {
@@ -294,7 +376,13 @@ Map {
         property string name: "ABCDs"
         property string layerType: "line"
         property string source: "aviationData"
-        property var filter: ["any", ["==", ["get", "CAT"], "A"], ["==", ["get", "CAT"], "B"], ["==", ["get", "CAT"], "C"], ["==", ["get", "CAT"], "D"]]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "ABCDs"
+        property var filter: airspaceFilter(["any", ["==", ["get", "CAT"], "A"], ["==", ["get", "CAT"], "B"], ["==", ["get", "CAT"], "C"], ["==", ["get", "CAT"], "D"]])
     }
     
     MapParameter {
@@ -317,7 +405,13 @@ Map {
         property string name: "controlZones"
         property string layerType: "fill"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "CTR"]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "controlZones"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "CTR"])
     }
     MapParameter {
         type: "paint"
@@ -332,7 +426,13 @@ Map {
         property string name: "controlZoneOutlines"
         property string layerType: "line"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "CTR"]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "controlZoneOutlines"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "CTR"])
     }
     MapParameter {
         type: "paint"
@@ -347,12 +447,24 @@ Map {
         property string name: "controlZoneLabels"
         property string layerType: "symbol"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "CTR"]
+        property string sourceLayer: "aviationData"
         property int minzoom: 10
     }
     MapParameter {
         type: "layout"
 
+        property string layer: "controlZoneLabels"
+        property string visibility: (detailLevel >= RenderBudget.MinimalDetail) ? "none" : "visible"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "controlZoneLabels"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "CTR"])
+    }
+    MapParameter {
+        type: "layout"
+
         property string layer: "controlZoneLabels"
         property var textField: ["get", "NAM"]
         property real textSize: 12
@@ -372,7 +484,13 @@ Map {
         property string name: "natureReserveAreas"
         property string layerType: "line"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "NRA"]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "natureReserveAreas"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "NRA"])
     }
     MapParameter {
         type: "paint"
@@ -389,7 +507,13 @@ Map {
         property string name: "natureReserveAreaOutlines"
         property string layerType: "line"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "NRA"]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "natureReserveAreaOutlines"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "NRA"])
     }
     MapParameter {
         type: "paint"
@@ -405,12 +529,24 @@ Map {
         property string name: "natureReserveAreaLabels"
         property string layerType: "symbol"
         property string source: "aviationData"
-        property var filter: ["==", ["get", "CAT"], "NRA"]
+        property string sourceLayer: "aviationData"
         property int minzoom: 10
     }
     MapParameter {
         type: "layout"
 
+        property string layer: "natureReserveAreaLabels"
+        property string visibility: (detailLevel >= RenderBudget.ReducedDetail) ? "none" : "visible"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "natureReserveAreaLabels"
+        property var filter: airspaceFilter(["==", ["get", "CAT"], "NRA"])
+    }
+    MapParameter {
+        type: "layout"
+
         property string layer: "natureReserveAreaLabels"
         property var textField: ["get", "NAM"]
         property real textSize: 12
@@ -430,7 +566,13 @@ Map {
         property string name: "dangerZones"
         property string layerType: "line"
         property string source: "aviationData"
-        property var filter: ["any", ["==", ["get", "CAT"], "DNG"], ["==", ["get", "CAT"], "R"], ["==", ["get", "CAT"], "P"]]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "dangerZones"
+        property var filter: airspaceFilter(["any", ["==", ["get", "CAT"], "DNG"], ["==", ["get", "CAT"], "R"], ["==", ["get", "CAT"], "P"]])
     }
     
     MapParameter {
@@ -448,7 +590,13 @@ Map {
         property string name: "dangerZoneOutlines"
         property string layerType: "line"
         property string source: "aviationData"
-        property var filter: ["any", ["==", ["get", "CAT"], "DNG"], ["==", ["get", "CAT"], "R"], ["==", ["get", "CAT"], "P"]]
+        property string sourceLayer: "aviationData"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "dangerZoneOutlines"
+        property var filter: airspaceFilter(["any", ["==", ["get", "CAT"], "DNG"], ["==", ["get", "CAT"], "R"], ["==", ["get", "CAT"], "P"]])
     }
     
     MapParameter {
@@ -465,9 +613,21 @@ Map {
         property string name: "dangerZoneLabels"
         property string layerType: "symbol"
         property string source: "aviationData"
-        property var filter: ["any", ["==", ["get", "CAT"], "R"], ["==", ["get", "CAT"], "P"]]
+        property string sourceLayer: "aviationData"
         property int minzoom: 10
     }
+    MapParameter {
+        type: "layout"
+
+        property string layer: "dangerZoneLabels"
+        property string visibility: (detailLevel >= RenderBudget.MinimalDetail) ? "none" : "visible"
+    }
+    MapParameter {
+        type: "filter"
+
+        property string layer: "dangerZoneLabels"
+        property var filter: airspaceFilter(["any", ["==", ["get", "CAT"], "R"], ["==", ["get", "CAT"], "P"]])
+    }
     MapParameter {
         type: "paint"
         property string layer: "dangerZoneLabels"
@@ -497,6 +657,7 @@ Map {
         property string name: "PRC_DEP"
         property string layerType: "line"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["all", ["==", ["get", "CAT"], "PRC"], ["==", ["get", "USE"], "DEP"]]
         property int minzoom: 10
     }
@@ -514,6 +675,7 @@ Map {
         property string name: "PRC_ARR"
         property string layerType: "line"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["all", ["==", ["get", "CAT"], "PRC"], ["==", ["get", "USE"], "ARR"]]
         property int minzoom: 10
     }
@@ -531,6 +693,7 @@ Map {
         property string name: "PRC_OTH"
         property string layerType: "line"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["all", ["==", ["get", "CAT"], "PRC"], ["!=", ["get", "USE"], "ARR"], ["!=", ["get", "USE"], "DEP"]]
         property int minzoom: 10
     }
@@ -549,6 +712,7 @@ Map {
         property string name: "PRCLabels"
         property string layerType: "symbol"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["all", ["==", ["get", "CAT"], "PRC"], ["!=", ["get", "USE"], "TFC"]]
         property int minzoom: 10
     }
@@ -573,6 +737,7 @@ Map {
         property string name: "TFCLabels"
         property string layerType: "symbol"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["all", ["==", ["get", "CAT"], "PRC"], ["==", ["get", "USE"], "TFC"]]
         property int minzoom: 10
     }
@@ -721,9 +886,16 @@ Map {
         property string name: "optionalText"
         property string layerType: "symbol"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["==", ["get", "TYP"], "NAV"]
     }
     
+    MapParameter {
+        type: "layout"
+
+        property string layer: "optionalText"
+        property string visibility: (detailLevel >= RenderBudget.ReducedDetail) ? "none" : "visible"
+    }
     MapParameter {
         type: "layout"
 
@@ -751,6 +923,7 @@ Map {
         property string name: "WPs"
         property string layerType: "symbol"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["any", ["==", ["get", "CAT"], "AD-GLD"], ["==", ["get", "CAT"], "AD-INOP"], ["==", ["get", "CAT"], "AD-UL"], ["==", ["get", "CAT"], "AD-WATER"]]
     }
 
@@ -782,6 +955,7 @@ Map {
         property string name: "RPs"
         property string layerType: "symbol"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property int minzoom: 8
         property var filter: ["any", ["==", ["get", "CAT"], "RP"], ["==", ["get", "CAT"], "MRP"]]
     }
@@ -814,6 +988,7 @@ Map {
         property string name: "AD-GRASS"
         property string layerType: "symbol"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["any", ["==", ["get", "CAT"], "AD-GRASS"], ["==", ["get", "CAT"], "AD-MIL-GRASS"]]
     }
     
@@ -847,6 +1022,7 @@ Map {
         property string name: "NavAidIcons"
         property string layerType: "symbol"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["==", ["get", "TYP"], "NAV"]
     }
     
@@ -868,6 +1044,7 @@ Map {
         property string name: "AD-PAVED"
         property string layerType: "symbol"
         property string source: "aviationData"
+        property string sourceLayer: "aviationData"
         property var filter: ["any", ["==", ["get", "CAT"], "AD"], ["==", ["get", "CAT"], "AD-PAVED"], ["==", ["get", "CAT"], "AD-MIL"], ["==", ["get", "CAT"], "AD-MIL-PAVED"]]
     }
     
@@ -39,6 +39,7 @@ Item {
         fillMode: Image.PreserveAspectFit
         visible: false
         source: parent.source
+        sourceSize: Qt.size(width, height)
     }
 
     ColorOverlay {
@@ -54,7 +54,6 @@ Item {
 
         anchors.fill: parent
 
-        geoJSON: global.geoMapProvider().geoJSON
         copyrightsVisible: false // We have our own copyrights notice
 
         property bool followGPS: true
@@ -355,15 +354,27 @@ Item {
             opacity: (flightMap.zoomLevel < 11.0) ? 1.0 : 0.3
         }
 
-        MapItemView { // Traffic opponents
+        MapItemView { // Trails of traffic opponents
             model: global.trafficDataProvider().trafficObjects4QML
             delegate: Component {
-                Traffic {
-                    trafficInfo: model.modelData
+                MapPolyline {
+                    line.width: 2
+                    line.color: model.modelData.color
+                    path: model.modelData.trail
+                    opacity: 0.5
+                    visible: model.modelData.valid
                 }
             }
         }
 
+        TrafficLayer { // Traffic opponents, drawn in one batch
+            anchors.fill: parent
+
+            map: flightMap
+            bearing: flightMap.bearing
+            pixelPer10km: flightMap.pixelPer10km
+        }
+
         MapItemView {
             id: midFieldWaypoints
             model: global.navigator().flightRoute.midFieldWaypoints
@@ -32,10 +32,27 @@ MapQuickItem {
     property real distFromCenter: 0.5*Math.sqrt(lbl.width*lbl.width + lbl.height*lbl.height) + 36
     property real t: trafficInfo.positionInfo.trueTrack().isFinite() ? 2*Math.PI*(trafficInfo.positionInfo.trueTrack()-flightMap.bearing)/360.0 : 0
 
-    coordinate: trafficInfo.positionInfo.coordinate().isValid ? trafficInfo.positionInfo.coordinate() : global.positionProvider().lastValidCoordinate
+    // Moving traffic is extrapolated at the frame rate of the display
+    property date now: new Date()
+    property bool extrapolate: trafficInfo.valid && (trafficInfo.positionInfo.groundSpeed().toMPS() > 1) && trafficInfo.positionInfo.trueTrack().isFinite()
+
+    coordinate: {
+        if (!trafficInfo.positionInfo.coordinate().isValid)
+            return global.positionProvider().lastValidCoordinate
+        if (extrapolate)
+            return trafficInfo.extrapolatedCoordinate(now)
+        return trafficInfo.positionInfo.coordinate()
+    }
     Behavior on coordinate {
         CoordinateAnimation { duration: 1000 }
-        enabled: trafficInfo.animate
+        enabled: trafficInfo.animate && !trafficLabel.extrapolate
+    }
+
+    Timer {
+        interval: 16
+        repeat: true
+        running: trafficLabel.extrapolate
+        onTriggered: trafficLabel.now = new Date()
     }
 
     visible: trafficInfo.valid
@@ -197,6 +197,44 @@ ApplicationWindow {
                             }
                         }
 
+                        ItemDelegate {
+                            text: qsTr("Export Flight Track")
+                            icon.source: "/icons/material/ic_send.svg"
+                            Layout.fillWidth: true
+
+                            onClicked: {
+                                global.mobileAdaptor().vibrateBrief()
+                                libraryMenu.close()
+                                drawer.close()
+                                var errorString = global.flightRecorder().exportGpx()
+                                if (errorString === "abort") {
+                                    toast.doToast(qsTr("Aborted"))
+                                    return
+                                }
+                                if (errorString !== "") {
+                                    toast.doToast(errorString)
+                                    return
+                                }
+                                toast.doToast(qsTr("Flight track exported"))
+                            }
+                        }
+
+                        ItemDelegate {
+                            text: qsTr("Open Flight Track in Other App")
+                            icon.source: "/icons/material/ic_open_in_new.svg"
+                            Layout.fillWidth: true
+
+                            onClicked: {
+                                global.mobileAdaptor().vibrateBrief()
+                                libraryMenu.close()
+                                drawer.close()
+                                var errorString = global.flightRecorder().viewGpx()
+                                if (errorString !== "") {
+                                    toast.doToast(errorString)
+                                }
+                            }
+                        }
+
                     }
 
                 }
@@ -322,6 +360,42 @@ ApplicationWindow {
                                 drawer.close()
                             }
                         }
+
+                        ItemDelegate { // Diagnostics
+                            text: qsTr("Diagnostics")
+                            icon.source: "/icons/material/ic_speed.svg"
+
+                            onClicked: {
+                                global.mobileAdaptor().vibrateBrief()
+                                stackView.pop()
+                                stackView.push("pages/Diagnostics.qml")
+                                aboutMenu.close()
+                                drawer.close()
+                            }
+                        }
+
+                        ItemDelegate { // Startup trace, only in builds with tracing
+                            text: qsTr("Export Startup Trace")
+                            icon.source: "/icons/material/ic_info_outline.svg"
+                            visible: global.tracer().enabled
+                            height: visible ? implicitHeight : 0
+
+                            onClicked: {
+                                global.mobileAdaptor().vibrateBrief()
+                                aboutMenu.close()
+                                drawer.close()
+                                var errorString = global.mobileAdaptor().exportContent(global.tracer().toChromeTrace(), "application/json", "enroute startup trace")
+                                if (errorString === "abort") {
+                                    toast.doToast(qsTr("Aborted"))
+                                    return
+                                }
+                                if (errorString !== "") {
+                                    toast.doToast(errorString)
+                                    return
+                                }
+                                toast.doToast(qsTr("Startup trace exported"))
+                            }
+                        }
                     }
 
                 }
@@ -32,6 +32,10 @@ Page {
 
     title: qsTr("Map and Data Library")
 
+    // Downloadable objects for maps that are not installed are only created
+    // when the map manager is opened
+    Component.onCompleted: global.dataManager().loadFullCatalogue()
+
     Component {
         id: sectionHeading
 
@@ -0,0 +1,218 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+import QtQuick.Controls.Material 2.15
+import QtQuick.Layouts 1.15
+
+import "../items"
+
+Page {
+    id: pg
+    title: qsTr("Diagnostics")
+
+    header: StandardHeader {}
+
+    // Current values of all metrics, refreshed every second. The rates of
+    // the counters are computed by the metrics registry between two calls.
+    property var metrics: global.metrics().snapshot()
+
+    // Cost breakdown of the profiling mode, refreshed together with the
+    // metrics
+    property var breakdown: global.profiler().breakdown()
+    property var threads: global.profiler().threads()
+
+    Timer {
+        interval: 1000
+        repeat: true
+        running: true
+        onTriggered: {
+            pg.metrics = global.metrics().snapshot()
+            pg.breakdown = global.profiler().breakdown()
+            pg.threads = global.profiler().threads()
+        }
+    }
+
+    function describeCost(cost) {
+        var result = qsTr("%1 s CPU per hour, %2 % of total").arg(cost.cpuSecondsPerHour.toFixed(1)).arg(cost.share.toFixed(1))
+        if (cost.wakeupsPerHour >= 0)
+            result += ", " + qsTr("%1 wakeups per hour").arg(cost.wakeupsPerHour.toFixed(0))
+        return result
+    }
+
+    function describe(metric) {
+        if (metric.type === "counter")
+            return qsTr("%1 total, %2 per second").arg(metric.value).arg(metric.rate.toFixed(1))
+        if (metric.type === "gauge")
+            return metric.value.toString()
+        if (metric.count === 0)
+            return qsTr("No data")
+        return qsTr("%1 ×, mean %2 µs, p50 ≤ %3 µs, p90 ≤ %4 µs, p99 ≤ %5 µs")
+            .arg(metric.count).arg(metric.mean.toFixed(0)).arg(metric.p50).arg(metric.p90).arg(metric.p99)
+    }
+
+    ListView {
+        id: lv
+
+        anchors.fill: parent
+        clip: true
+
+        model: pg.metrics
+
+        header: ColumnLayout {
+            width: lv.width
+
+            SwitchDelegate {
+                Layout.fillWidth: true
+                text: qsTr("Profiling") + (
+                          global.profiler().enabled ? (
+                                                          `<br><font color="#606060" size="2">`
+                                                          + qsTr("Averages over %1 min, per hour of use").arg(Math.floor(global.profiler().elapsedSeconds()/60))
+                                                          + `</font>`
+                                                          ) : (
+                                                          `<br><font color="#606060" size="2">`
+                                                          + qsTr("Attribute CPU time and wakeups to subsystems")
+                                                          + `</font>`
+                                                          )
+                          )
+                checked: global.profiler().enabled
+                onToggled: {
+                    global.mobileAdaptor().vibrateBrief()
+                    global.profiler().enabled = checked
+                    pg.breakdown = global.profiler().breakdown()
+                    pg.threads = global.profiler().threads()
+                }
+            }
+
+            Repeater {
+                model: pg.breakdown
+
+                delegate: ItemDelegate {
+                    Layout.fillWidth: true
+
+                    contentItem: ColumnLayout {
+                        Label {
+                            Layout.fillWidth: true
+                            text: modelData.name
+                            font.bold: true
+                            elide: Label.ElideRight
+                        }
+                        Label {
+                            Layout.fillWidth: true
+                            text: pg.describeCost(modelData)
+                            wrapMode: Text.Wrap
+                        }
+                    }
+                }
+            }
+
+            Label {
+                Layout.fillWidth: true
+                Layout.leftMargin: Qt.application.font.pixelSize
+                Layout.topMargin: Qt.application.font.pixelSize
+                visible: pg.threads.length > 0
+                text: qsTr("Threads")
+                font.pixelSize: Qt.application.font.pixelSize*1.2
+                font.bold: true
+                color: Material.accent
+            }
+
+            Repeater {
+                model: pg.threads
+
+                delegate: ItemDelegate {
+                    Layout.fillWidth: true
+
+                    contentItem: ColumnLayout {
+                        Label {
+                            Layout.fillWidth: true
+                            text: modelData.name
+                            font.bold: true
+                            elide: Label.ElideRight
+                        }
+                        Label {
+                            Layout.fillWidth: true
+                            text: qsTr("%1 s CPU per hour").arg(modelData.cpuSecondsPerHour.toFixed(1))
+                            wrapMode: Text.Wrap
+                        }
+                    }
+                }
+            }
+        }
+
+        delegate: ItemDelegate {
+            width: lv.width
+
+            contentItem: ColumnLayout {
+                Label {
+                    Layout.fillWidth: true
+                    text: modelData.name
+                    font.bold: true
+                    elide: Label.ElideRight
+                }
+                Label {
+                    Layout.fillWidth: true
+                    text: pg.describe(modelData)
+                    wrapMode: Text.Wrap
+                }
+            }
+        }
+
+        Label {
+            anchors.fill: parent
+            anchors.margins: Qt.application.font.pixelSize*2
+            visible: lv.count === 0
+
+            horizontalAlignment: Text.AlignHCenter
+            verticalAlignment: Text.AlignVCenter
+            wrapMode: Text.Wrap
+            text: qsTr("No metrics have been recorded yet.")
+        }
+    }
+
+    footer: Pane {
+        width: parent.width
+        Material.elevation: 3
+
+        ToolButton {
+            anchors.centerIn: parent
+            Material.foreground: Material.accent
+
+            text: qsTr("Export as JSON")
+            icon.source: "/icons/material/ic_send.svg"
+
+            onClicked: {
+                global.mobileAdaptor().vibrateBrief()
+                var errorString = global.mobileAdaptor().exportContent(global.metrics().toJSON(), "application/json", "enroute diagnostics")
+                if (errorString === "abort") {
+                    toast.doToast(qsTr("Aborted"))
+                    return
+                }
+                if (errorString !== "") {
+                    toast.doToast(errorString)
+                    return
+                }
+                toast.doToast(qsTr("Diagnostics exported"))
+            }
+        }
+    }
+
+} // Page
@@ -42,7 +42,7 @@ Page {
             property int index: -1
 
             WordWrappingItemDelegate {
-                icon.source: waypoint.icon
+                icon.source: "image://icons" + waypoint.icon
                 Layout.fillWidth: true
                 text: waypoint.twoLineTitle
 
@@ -344,6 +344,17 @@ Page {
 
                 }
 
+                MenuItem {
+                    text: qsTr("Route around airspaces …")
+                    enabled: (global.navigator().flightRoute.size > 1) && (sv.currentIndex === 0)
+
+                    onTriggered: {
+                        global.mobileAdaptor().vibrateBrief()
+                        highlighted = false
+                        suggestRouteDialog.open()
+                    }
+                }
+
                 MenuItem {
                     text: qsTr("Reverse")
                     enabled: (global.navigator().flightRoute.size > 0) && (sv.currentIndex === 0)
@@ -356,11 +367,46 @@ Page {
                     }
                 }
 
+                MenuSeparator { }
+
+                MenuItem {
+                    text: global.geoMapProvider().flightBriefing.preparing ? qsTr("Preparing offline briefing …") : qsTr("Prepare offline briefing")
+                    enabled: (global.navigator().flightRoute.size > 1) && !global.geoMapProvider().flightBriefing.preparing
+
+                    onTriggered: {
+                        global.mobileAdaptor().vibrateBrief()
+                        highlighted = false
+                        global.geoMapProvider().flightBriefing.prepareFlight()
+                    }
+                }
+
+                MenuItem {
+                    text: qsTr("Discard offline briefing")
+                    enabled: (global.geoMapProvider().flightBriefing.description !== "") && !global.geoMapProvider().flightBriefing.preparing
+
+                    onTriggered: {
+                        global.mobileAdaptor().vibrateBrief()
+                        highlighted = false
+                        global.geoMapProvider().flightBriefing.discard()
+                        toast.doToast(qsTr("Offline briefing discarded"))
+                    }
+                }
+
             }
         }
 
     }
 
+    Connections {
+        target: global.geoMapProvider().flightBriefing
+        function onPrepared() {
+            toast.doToast(global.geoMapProvider().flightBriefing.description)
+        }
+        function onError(message) {
+            toast.doToast(message)
+        }
+    }
+
     TabBar {
         id: bar
         anchors.top: parent.top
@@ -415,29 +461,47 @@ Page {
                     id: co
                     width: parent.width
 
-                    Connections {
-                        target: global.navigator().flightRoute
-                        function onWaypointsChanged() {
-                            co.createItems()
+                    // First waypoint
+                    Loader {
+                        Layout.fillWidth: true
+
+                        active: global.navigator().flightRoute.size > 0
+                        sourceComponent: waypointComponent
+                        onLoaded: {
+                            item.waypoint = Qt.binding(function() { return global.navigator().flightRoute.waypoints[0] })
+                            item.index = 0
                         }
                     }
 
-                    Component.onCompleted: co.createItems()
+                    // Leg descriptions, each followed by the end point of the leg.
+                    // The model reports changes of the route as insertions and
+                    // removals, so only the affected delegates are re-created.
+                    Repeater {
+                        model: global.navigator().flightRoute.legModel
+
+                        delegate: ColumnLayout {
+                            id: legDelegate
+
+                            property var legObject: model.leg
+                            property int legIndex: index
 
-                    function createItems() {
-                        // Delete old text items
-                        co.children = {}
+                            Layout.fillWidth: true
 
-                        if (global.navigator().flightRoute.size > 0) {
-                            // Create first waypointComponent
-                            waypointComponent.createObject(co, {waypoint: global.navigator().flightRoute.waypoints[0], index: 0});
+                            Loader {
+                                Layout.fillWidth: true
 
-                            // Create leg description items
-                            var legs = global.navigator().flightRoute.legs
-                            var j
-                            for (j=0; j<legs.length; j++) {
-                                legComponent.createObject(co, {leg: legs[j]});
-                                waypointComponent.createObject(co, {waypoint: legs[j].endPoint, index: j+1});
+                                sourceComponent: legComponent
+                                onLoaded: item.leg = legDelegate.legObject
+                            }
+
+                            Loader {
+                                Layout.fillWidth: true
+
+                                sourceComponent: waypointComponent
+                                onLoaded: {
+                                    item.waypoint = legDelegate.legObject.endPoint
+                                    item.index = Qt.binding(function() { return legDelegate.legIndex+1 })
+                                }
                             }
                         }
                     }
@@ -826,6 +890,96 @@ Page {
         }
     }
 
+    Dialog {
+        id: suggestRouteDialog
+
+        // Center in Overlay.overlay, see clearDialog
+        parent: Overlay.overlay
+        x: (parent.width-width)/2.0
+        y: (parent.height-height)/2.0
+
+        title: qsTr("Route around airspaces")
+        standardButtons: Dialog.Cancel | Dialog.Ok
+        modal: true
+
+        // Width is chosen so that the dialog does not cover the parent in full, height is automatic
+        width: Math.min(parent.width-Qt.application.font.pixelSize, 40*Qt.application.font.pixelSize)
+        height: Math.min(parent.height-Qt.application.font.pixelSize, implicitHeight)
+
+        ColumnLayout {
+            width: suggestRouteDialog.availableWidth
+
+            Label {
+                Layout.fillWidth: true
+
+                text: qsTr("The route between start and destination is replaced by a route that avoids airspaces of the selected categories which begin below the given altitude.")
+                wrapMode: Text.Wrap
+                textFormat: Text.StyledText
+            }
+
+            Repeater {
+                id: categoryRepeater
+
+                model: [
+                    {category: "CTR", name: qsTr("Control zones")},
+                    {category: "C", name: qsTr("Airspace C")},
+                    {category: "D", name: qsTr("Airspace D")},
+                    {category: "P", name: qsTr("Prohibited areas")},
+                    {category: "R", name: qsTr("Restricted areas")},
+                    {category: "DNG", name: qsTr("Danger areas")},
+                    {category: "TMZ", name: qsTr("Transponder mandatory zones")},
+                    {category: "RMZ", name: qsTr("Radio mandatory zones")}
+                ]
+
+                CheckBox {
+                    property string category: modelData.category
+
+                    text: modelData.name
+                    checked: (category !== "TMZ") && (category !== "RMZ")
+                }
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+
+                Label { text: qsTr("Altitude") }
+
+                TextField {
+                    id: suggestRouteAltitude
+
+                    Layout.fillWidth: true
+                    text: "3500"
+                    inputMethodHints: Qt.ImhDigitsOnly
+                    validator: IntValidator {
+                        bottom: 0
+                        top: 20000
+                    }
+                }
+
+                Label { text: qsTr("ft MSL") }
+            }
+        }
+
+        onAccepted: {
+            global.mobileAdaptor().vibrateBrief()
+            var categories = []
+            for (var i = 0; i < categoryRepeater.count; i++) {
+                if (categoryRepeater.itemAt(i).checked)
+                    categories.push(categoryRepeater.itemAt(i).category)
+            }
+            var errorString = global.navigator().flightRoute.suggestRouteAroundAirspaces(categories, Number(suggestRouteAltitude.text))
+            if (errorString !== "") {
+                toast.doToast(errorString)
+                return
+            }
+            toast.doToast(qsTr("Flight route replaced"))
+        }
+        onRejected: {
+            global.mobileAdaptor().vibrateBrief()
+            close()
+        }
+    }
+
     Loader {
         id: dlgLoader
         anchors.fill: parent
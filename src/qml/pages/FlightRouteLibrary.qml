@@ -135,7 +135,7 @@ Page {
                 id: iDel
                 Layout.fillWidth: true
 
-                text: modelData
+                text: modelData + "<br><font size='2'>" + global.librarian().flightRouteSummary(modelData) + "</font>"
                 icon.source: "/icons/material/ic_directions.svg"
 
                 onClicked: {
@@ -353,6 +353,11 @@ Page {
         textInput.text = cache
     }
 
+    Connections {
+        target: global.librarian()
+        function onFlightRoutesChanged() { page.reloadFlightRouteList() }
+    }
+
     Dialog {
         id: fileError
 
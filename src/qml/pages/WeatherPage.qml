@@ -133,32 +133,32 @@ Page {
             // Background color according to METAR/FAA flight category
             Rectangle {
                 anchors.fill: parent
-                color: model.modelData.hasMETAR ? model.modelData.metar.flightCategoryColor : "transparent"
+                color: model.flightCategoryColor
                 opacity: 0.2
             }
 
             WordWrappingItemDelegate {
                 id: idel
                 text: {
-                    var result = model.modelData.twoLineTitle
+                    var result = model.twoLineTitle
 
-                    var wayTo  = model.modelData.wayTo(global.positionProvider().positionInfo.coordinate(), global.settings().useMetricUnits)
+                    var wayTo  = stationList.model.wayTo(index, global.positionProvider().positionInfo.coordinate(), global.settings().useMetricUnits)
                     if (wayTo !== "")
                         result = result + "<br>" + wayTo
 
-                    if (model.modelData.hasMETAR)
-                        result = result + "<br>" + model.modelData.metar.summary
+                    if (model.summary !== "")
+                        result = result + "<br>" + model.summary
 
                     return result
                 }
-                icon.source: model.modelData.icon
+                icon.source: "image://icons" + model.icon
                 icon.color: "transparent"
 
                 width: parent.width
 
                 onClicked: {
                     global.mobileAdaptor().vibrateBrief()
-                    weatherReport.weatherStation = model.modelData
+                    weatherReport.weatherStation = global.weatherDataProvider().findWeatherStation(model.ICAOCode)
                     weatherReport.open()
                 }
             }
@@ -0,0 +1,262 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "traffic/ConflictPredictor.h"
+
+
+namespace {
+
+// Mean earth radius in meters
+constexpr double earthRadiusInM = 6371000.0;
+
+// Scalar helper: value in SI units, or zero if the value is not finite
+auto finiteOrZero(double value) -> double
+{
+    return std::isfinite(value) ? value : 0.0;
+}
+
+}
+
+
+// Member functions
+
+Traffic::ConflictPredictor::ConflictPredictor(QObject* parent) : QObject(parent)
+{
+    qRegisterMetaType<QVector<Traffic::ConflictPrediction>>();
+    qRegisterMetaType<Traffic::Warning>();
+
+    m_clock.start();
+    m_timer.setInterval(predictionInterval);
+    connect(&m_timer, &QTimer::timeout, this, &Traffic::ConflictPredictor::predict);
+}
+
+
+void Traffic::ConflictPredictor::addReports(const Positioning::PositionInfo& ownship, const QVector<Traffic::TrafficReport>& reports)
+{
+    auto now = m_clock.elapsed();
+    m_ownship = ownship;
+    m_ownshipTime = now;
+
+    foreach(auto report, reports) {
+        if (report.kind != TrafficReport::FactorWithPosition) {
+            continue;
+        }
+        const auto& pInfo = report.positionInfo;
+        auto coordinate = pInfo.coordinate();
+        if (!coordinate.isValid()) {
+            continue;
+        }
+
+        // Find target, or append a new one
+        auto i = m_indices.value(report.ID, m_IDs.size());
+        if (i == m_IDs.size()) {
+            m_indices.insert(report.ID, i);
+            m_IDs.push_back(report.ID);
+            m_times.push_back(0);
+            m_latitudes.push_back(0.0);
+            m_longitudes.push_back(0.0);
+            m_vDists.push_back(0.0);
+            m_vxs.push_back(0.0);
+            m_vys.push_back(0.0);
+            m_vzs.push_back(0.0);
+        }
+
+        auto groundSpeed = finiteOrZero(pInfo.groundSpeed().toMPS());
+        auto track = finiteOrZero(pInfo.trueTrack().toRAD());
+        m_times[i] = now;
+        m_latitudes[i] = qDegreesToRadians(coordinate.latitude());
+        m_longitudes[i] = qDegreesToRadians(coordinate.longitude());
+        m_vDists[i] = report.vDist.toM();
+        m_vxs[i] = groundSpeed*std::sin(track);
+        m_vys[i] = groundSpeed*std::cos(track);
+        m_vzs[i] = finiteOrZero(pInfo.verticalSpeed().toMPS());
+    }
+
+    if (!m_IDs.empty() && !m_timer.isActive()) {
+        m_timer.start();
+    }
+}
+
+
+void Traffic::ConflictPredictor::predict()
+{
+    auto now = m_clock.elapsed();
+
+    // Forget targets that have not been reported for a long time
+    auto maxAge = std::chrono::duration_cast<std::chrono::milliseconds>(Positioning::PositionInfo::lifetime).count();
+    for(auto i = m_IDs.size(); i-- > 0; ) {
+        if (now-m_times[i] > maxAge) {
+            removeTarget(i);
+        }
+    }
+    if (m_IDs.empty()) {
+        m_timer.stop();
+        emit conflictsPredicted({}, {});
+        return;
+    }
+
+    // Without a current position of ownship, there is nothing to predict
+    auto ownCoordinate = m_ownship.coordinate();
+    if (!m_ownship.isValid() || !ownCoordinate.isValid() || (now-m_ownshipTime > maxAge)) {
+        emit conflictsPredicted({}, {});
+        return;
+    }
+    auto ownGroundSpeed = finiteOrZero(m_ownship.groundSpeed().toMPS());
+    auto ownTrack = m_ownship.trueTrack();
+    auto ownVx = ownGroundSpeed*std::sin(finiteOrZero(ownTrack.toRAD()));
+    auto ownVy = ownGroundSpeed*std::cos(finiteOrZero(ownTrack.toRAD()));
+    auto ownVz = finiteOrZero(m_ownship.verticalSpeed().toMPS());
+    auto ownLatitude = qDegreesToRadians(ownCoordinate.latitude());
+    auto ownLongitude = qDegreesToRadians(ownCoordinate.longitude());
+    auto ownAge = static_cast<double>(now-m_ownshipTime)/1000.0;
+    auto lookAheadInS = lookAhead.toS();
+    auto cosLatitude = std::cos(ownLatitude);
+
+    // Single pass over all targets. Positions are projected to a plane that
+    // is tangent to the earth at the position of ownship, and extrapolated
+    // to the current time.
+    auto size = m_IDs.size();
+    m_tcpas.resize(size);
+    m_hDistsAtCPA.resize(size);
+    m_vDistsAtCPA.resize(size);
+    m_bearings.resize(size);
+    m_hDists.resize(size);
+    for(std::size_t i=0; i<size; i++) {
+        auto age = static_cast<double>(now-m_times[i])/1000.0;
+        auto x = (m_longitudes[i]-ownLongitude)*cosLatitude*earthRadiusInM + m_vxs[i]*age - ownVx*ownAge;
+        auto y = (m_latitudes[i]-ownLatitude)*earthRadiusInM + m_vys[i]*age - ownVy*ownAge;
+        auto z = m_vDists[i] + (m_vzs[i]-ownVz)*age;
+        auto vx = m_vxs[i]-ownVx;
+        auto vy = m_vys[i]-ownVy;
+        auto vz = m_vzs[i]-ownVz;
+
+        auto vv = vx*vx + vy*vy;
+        auto tcpa = (vv > 0.0) ? -(x*vx + y*vy)/vv : 0.0;
+        tcpa = std::clamp(tcpa, 0.0, lookAheadInS);
+        auto xAtCPA = x + vx*tcpa;
+        auto yAtCPA = y + vy*tcpa;
+
+        m_tcpas[i] = tcpa;
+        m_hDistsAtCPA[i] = std::sqrt(xAtCPA*xAtCPA + yAtCPA*yAtCPA);
+        m_vDistsAtCPA[i] = z + vz*tcpa;
+        m_hDists[i] = std::sqrt(x*x + y*y);
+        m_bearings[i] = std::atan2(x, y);
+    }
+
+    // Collect conflicts and find the most severe one
+    QVector<Traffic::ConflictPrediction> conflicts;
+    Traffic::Warning warning;
+    auto mostSevere = std::numeric_limits<std::size_t>::max();
+    for(std::size_t i=0; i<size; i++) {
+        if (m_hDistsAtCPA[i] >= protectedRadius.toM()) {
+            continue;
+        }
+
+        // If the altitude of the target is unknown, the vertical test cannot
+        // be applied. Such targets are only considered while they approach,
+        // and their alarm level is capped below.
+        auto altitudeKnown = std::isfinite(m_vDistsAtCPA[i]);
+        if (altitudeKnown && (qAbs(m_vDistsAtCPA[i]) >= protectedHeight.toM())) {
+            continue;
+        }
+        if (!altitudeKnown && (m_tcpas[i] <= 0.0)) {
+            continue;
+        }
+
+        // Alarm levels, as defined by FLARM. Conflicts at the end of the
+        // look-ahead interval are cut off by the clamp above and ignored.
+        auto tcpa = m_tcpas[i];
+        int alarmLevel = 0;
+        if (tcpa <= 8.0) {
+            alarmLevel = 3;
+        } else if (tcpa <= 12.0) {
+            alarmLevel = 2;
+        } else if (tcpa < lookAheadInS) {
+            alarmLevel = 1;
+        } else {
+            continue;
+        }
+        if (!altitudeKnown) {
+            alarmLevel = qMin(alarmLevel, maxAlarmLevelWithoutAltitude);
+        }
+
+        Traffic::ConflictPrediction conflict;
+        conflict.ID = m_IDs[i];
+        conflict.alarmLevel = alarmLevel;
+        conflict.tcpa = Units::Time::fromS(tcpa);
+        conflict.hDistAtCPA = Units::Distance::fromM(m_hDistsAtCPA[i]);
+        conflict.vDistAtCPA = Units::Distance::fromM(m_vDistsAtCPA[i]);
+        conflicts << conflict;
+
+        if ((mostSevere == std::numeric_limits<std::size_t>::max())
+                || (alarmLevel > conflicts[0].alarmLevel)
+                || ((alarmLevel == conflicts[0].alarmLevel) && (tcpa < m_tcpas[mostSevere]))) {
+            mostSevere = i;
+            std::swap(conflicts.first(), conflicts.last());
+        }
+    }
+
+    // The most severe conflict has been moved to the front of the list
+    if (!conflicts.isEmpty()) {
+        auto relativeBearing = Units::Angle::nan();
+        if (ownTrack.isFinite() && (ownGroundSpeed > 0.0)) {
+            relativeBearing = Units::Angle::fromRAD(m_bearings[mostSevere]) - ownTrack;
+        }
+        warning = Traffic::Warning(conflicts[0].alarmLevel,
+                                   relativeBearing,
+                                   2, // Aircraft alarm
+                                   Units::Distance::fromM(m_vDists[mostSevere]),
+                                   Units::Distance::fromM(m_hDists[mostSevere]));
+    }
+    emit conflictsPredicted(conflicts, warning);
+}
+
+
+void Traffic::ConflictPredictor::removeTarget(std::size_t i)
+{
+    auto last = m_IDs.size()-1;
+    m_indices.remove(m_IDs[i]);
+    if (i != last) {
+        m_indices.insert(m_IDs[last], i);
+    }
+    m_IDs[i] = m_IDs[last];
+    m_times[i] = m_times[last];
+    m_latitudes[i] = m_latitudes[last];
+    m_longitudes[i] = m_longitudes[last];
+    m_vDists[i] = m_vDists[last];
+    m_vxs[i] = m_vxs[last];
+    m_vys[i] = m_vys[last];
+    m_vzs[i] = m_vzs[last];
+
+    m_IDs.pop_back();
+    m_times.pop_back();
+    m_latitudes.pop_back();
+    m_longitudes.pop_back();
+    m_vDists.pop_back();
+    m_vxs.pop_back();
+    m_vys.pop_back();
+    m_vzs.pop_back();
+}
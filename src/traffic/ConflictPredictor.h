@@ -0,0 +1,184 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QTimer>
+#include <chrono>
+#include <vector>
+
+#include "positioning/PositionInfo.h"
+#include "traffic/TargetID.h"
+#include "traffic/TrafficReport.h"
+#include "traffic/Warning.h"
+#include "units/Time.h"
+
+using namespace std::chrono_literals;
+
+
+namespace Traffic {
+
+/*! \brief Predicted closest point of approach of a traffic target */
+
+struct ConflictPrediction
+{
+    /*! \brief Identity of the traffic */
+    TargetID ID;
+
+    /*! \brief Alarm level, with the same meaning as in Traffic::Warning */
+    int alarmLevel {0};
+
+    /*! \brief Time to the closest point of approach */
+    Units::Time tcpa;
+
+    /*! \brief Horizontal distance at the closest point of approach */
+    Units::Distance hDistAtCPA;
+
+    /*! \brief Vertical distance at the closest point of approach
+     *
+     *  This is NaN if the altitude of the traffic is unknown.
+     */
+    Units::Distance vDistAtCPA;
+};
+
+
+/*! \brief Conflict prediction for traffic targets
+ *
+ *  Traffic receivers that implement FLARM report an alarm level for some of
+ *  the traffic, but ADS-B traffic and traffic reported via GDL90 or XGPS
+ *  comes without any alarm level. This class predicts the closest point of
+ *  approach (CPA) and the time to it (TCPA) for all traffic targets whose
+ *  position is known. It assumes that ownship and traffic keep their current
+ *  velocities, and assigns alarm levels with the meaning used by FLARM.
+ *
+ *  The class is meant to live in the traffic thread of the
+ *  TrafficDataProvider. Traffic reports are fed in with addReports(). Once per
+ *  predictionInterval, the class extrapolates the state of all targets and
+ *  computes CPA and TCPA in a single pass over flat arrays, which the compiler
+ *  can vectorize. The results are published with the signal
+ *  conflictsPredicted().
+ */
+
+class ConflictPredictor : public QObject {
+    Q_OBJECT
+
+public:
+    /*! \brief Default constructor
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit ConflictPredictor(QObject* parent = nullptr);
+
+    // Standard destructor
+    ~ConflictPredictor() override = default;
+
+    /*! \brief Time between two predictions */
+    static constexpr auto predictionInterval = 1s;
+
+    /*! \brief Traffic whose closest point of approach is farther in the future is not considered a conflict */
+    static constexpr Units::Time lookAhead = Units::Time::fromS(18.0);
+
+    /*! \brief Traffic that passes closer than this horizontal distance is considered a conflict */
+    static constexpr Units::Distance protectedRadius = Units::Distance::fromM(500.0);
+
+    /*! \brief Traffic that passes closer than this vertical distance is considered a conflict */
+    static constexpr Units::Distance protectedHeight = Units::Distance::fromM(150.0);
+
+    /*! \brief Highest alarm level assigned to traffic whose altitude is unknown
+     *
+     *  Without altitude, the vertical test cannot be applied. Such traffic is
+     *  only considered while it approaches ownship, and never raises more
+     *  than a low-level alarm.
+     */
+    static constexpr int maxAlarmLevelWithoutAltitude = 1;
+
+public slots:
+    /*! \brief Update the state of ownship and traffic
+     *
+     *  Reports whose kind is not TrafficReport::FactorWithPosition are
+     *  ignored. Targets that have not been reported for longer than
+     *  Positioning::PositionInfo::lifetime are forgotten.
+     *
+     *  @param ownship Current position info of ownship
+     *
+     *  @param reports Latest traffic reports
+     */
+    void addReports(const Positioning::PositionInfo& ownship, const QVector<Traffic::TrafficReport>& reports);
+
+signals:
+    /*! \brief Result of a prediction
+     *
+     *  This signal is emitted once per predictionInterval while traffic is
+     *  known.
+     *
+     *  @param conflicts Predictions for all targets whose alarm level is
+     *  positive. The list is empty if there is no conflict.
+     *
+     *  @param warning Traffic warning for the most severe conflict, or an
+     *  invalid warning if there is no conflict
+     */
+    void conflictsPredicted(const QVector<Traffic::ConflictPrediction>& conflicts, const Traffic::Warning& warning);
+
+private slots:
+    // Runs one prediction over all targets
+    void predict();
+
+private:
+    Q_DISABLE_COPY_MOVE(ConflictPredictor)
+
+    // Removes target i, by moving the last target into its place
+    void removeTarget(std::size_t i);
+
+    QTimer m_timer {this};
+    QElapsedTimer m_clock;
+
+    // State of ownship, and time when it was set, in ms of m_clock
+    Positioning::PositionInfo m_ownship;
+    qint64 m_ownshipTime {0};
+
+    // State of the targets, as structure of arrays, and index of every
+    // target by ID. Positions are in
+    // radians, velocities in meters per second, with x pointing east and y
+    // pointing north. The vertical position is the vertical distance to
+    // ownship, as reported by the receiver, in meters, or NaN if unknown.
+    QHash<TargetID, std::size_t> m_indices;
+    std::vector<TargetID> m_IDs;
+    std::vector<qint64> m_times;
+    std::vector<double> m_latitudes;
+    std::vector<double> m_longitudes;
+    std::vector<double> m_vDists;
+    std::vector<double> m_vxs;
+    std::vector<double> m_vys;
+    std::vector<double> m_vzs;
+
+    // Scratch arrays for the results of predict()
+    std::vector<double> m_tcpas;
+    std::vector<double> m_hDistsAtCPA;
+    std::vector<double> m_vDistsAtCPA;
+    std::vector<double> m_bearings;
+    std::vector<double> m_hDists;
+};
+
+}
+
+Q_DECLARE_METATYPE(Traffic::ConflictPrediction)
@@ -0,0 +1,212 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <array>
+#include <optional>
+#include <vector>
+
+#include "Metrics.h"
+#include "positioning/PositionProvider.h"
+#include "traffic/DecoderBenchmark.h"
+#include "traffic/TrafficDataSource_Abstract.h"
+#include "traffic/TrafficScenario.h"
+
+
+std::atomic<quint64> Traffic::DecoderBenchmark::allocations {0};
+
+
+namespace {
+
+// Number of targets, number of snapshots of the traffic situation and number
+// of passes over each corpus
+const int numTargets = 100;
+const int numSnapshots = 200;
+const int numPasses = 20;
+
+// Seed for the random number generator
+const quint32 seed = 4711;
+
+// Kinds of data understood by the decoders
+enum class Encoding {
+    FLARM,
+    GDL90,
+    XGPS
+};
+
+// One unit of input, as handed to the decoder by the traffic data sources: a
+// FLARM/NMEA sentence, a GDL90 datagram with many frames, or an XGPS string
+struct Input {
+    Encoding encoding;
+    QByteArray data;
+};
+using Corpus = std::vector<Input>;
+
+// Traffic data source whose decoders are called directly
+class BenchmarkSource : public Traffic::TrafficDataSource_Abstract
+{
+public:
+    QString sourceName() const override
+    {
+        return QStringLiteral("Benchmark");
+    }
+
+    void connectToTrafficReceiver() override {}
+    void disconnectFromTrafficReceiver() override {}
+
+    void process(const Input& input)
+    {
+        switch(input.encoding) {
+        case Encoding::FLARM:
+            processFLARMSentence(std::string_view(input.data.constData(), static_cast<std::size_t>(input.data.size())));
+            break;
+        case Encoding::GDL90:
+            processGDLData(input.data);
+            break;
+        case Encoding::XGPS:
+            processXGPSString(input.data);
+            break;
+        }
+    }
+};
+
+// Ownship, 600 m above the position that the decoders use as ownship position
+// when no position is known
+auto ownship() -> Positioning::PositionInfo
+{
+    auto coordinate = Positioning::PositionProvider::lastValidCoordinate();
+    coordinate.setAltitude(coordinate.altitude()+600.0);
+    Positioning::PositionInfo result(coordinate, QDateTime::currentDateTimeUtc());
+    result.setGroundSpeed(Units::Speed::fromMPS(30.0));
+    result.setDirection(Units::Angle::fromDEG(90.0));
+    return result;
+}
+
+// Appends one snapshot of the traffic situation in the given encoding
+void appendSnapshot(Corpus& corpus, const Traffic::TrafficScenario& scenario, QRandomGenerator& generator, Encoding encoding, double seconds)
+{
+    auto own = ownship();
+    switch(encoding) {
+    case Encoding::FLARM: {
+        auto sentences = scenario.toFLARM(own, seconds);
+        int start = 0;
+        while (start < sentences.size()) {
+            auto end = sentences.indexOf('\n', start);
+            if (end < 0) {
+                end = sentences.size()-1;
+            }
+            corpus.push_back({Encoding::FLARM, sentences.mid(start, end-start+1)});
+            start = end+1;
+        }
+        break;
+    }
+    case Encoding::GDL90:
+        corpus.push_back({Encoding::GDL90, scenario.toGDL90(own, own.trueAltitude(), seconds)});
+        break;
+    case Encoding::XGPS: {
+        // TrafficScenario has no XGPS encoding; the targets are placed at
+        // random around ownship instead
+        auto coordinate = own.coordinate();
+        corpus.push_back({Encoding::XGPS,
+                          QStringLiteral("XGPSBenchmark,%1,%2,%3,90.0,30.0").arg(coordinate.longitude(), 0, 'f', 6).arg(coordinate.latitude(), 0, 'f', 6).arg(coordinate.altitude(), 0, 'f', 1).toLatin1()});
+        for(int i=0; i<numTargets; i++) {
+            auto target = coordinate.atDistanceAndAzimuth(generator.bounded(10000.0), generator.bounded(360.0));
+            corpus.push_back({Encoding::XGPS,
+                              QStringLiteral("XTRAFFICBenchmark,%1,%2,%3,%4,%5,1,%6,%7,D-%8")
+                              .arg(1000000+i)
+                              .arg(target.latitude(), 0, 'f', 6)
+                              .arg(target.longitude(), 0, 'f', 6)
+                              .arg(1000.0+generator.bounded(5000.0), 0, 'f', 0)
+                              .arg(generator.bounded(1000.0)-500.0, 0, 'f', 0)
+                              .arg(generator.bounded(360.0), 0, 'f', 0)
+                              .arg(60.0+generator.bounded(100.0), 0, 'f', 0)
+                              .arg(1000+i).toLatin1()});
+        }
+        break;
+    }
+    }
+}
+
+// Corpus with numSnapshots snapshots. If encoding is not set, the snapshots
+// cycle through all encodings.
+auto makeCorpus(std::optional<Encoding> encoding) -> Corpus
+{
+    auto center = Positioning::PositionProvider::lastValidCoordinate();
+    auto parameters = Traffic::TrafficScenario::Parameters::forCount(numTargets);
+    parameters.seed = seed;
+    Traffic::TrafficScenario scenario(center, parameters);
+    QRandomGenerator generator(seed);
+
+    Corpus corpus;
+    const std::array<Encoding, 3> encodings {Encoding::FLARM, Encoding::GDL90, Encoding::XGPS};
+    for(int i=0; i<numSnapshots; i++) {
+        appendSnapshot(corpus, scenario, generator, encoding.value_or(encodings[static_cast<std::size_t>(i)%encodings.size()]), i);
+    }
+    return corpus;
+}
+
+// Feeds the corpus numPasses times to the decoders and writes messages per
+// second, time per message and allocations per message to out. A first pass,
+// which is not measured, registers the metrics and fills the caches of the
+// decoders.
+void measure(QTextStream& out, const QString& name, const Corpus& corpus)
+{
+    BenchmarkSource source;
+    for(const auto& input : corpus) {
+        source.process(input);
+    }
+
+    auto* messagesMetric = Metrics::counter(QStringLiteral("traffic/%1/messages").arg(source.sourceName()));
+    auto messagesBefore = messagesMetric->value();
+    auto allocationsBefore = Traffic::DecoderBenchmark::allocations.load();
+    QElapsedTimer timer;
+    timer.start();
+    for(int pass=0; pass<numPasses; pass++) {
+        for(const auto& input : corpus) {
+            source.process(input);
+        }
+    }
+    auto nsecs = qMax(timer.nsecsElapsed(), qint64(1));
+    auto allocations = Traffic::DecoderBenchmark::allocations.load() - allocationsBefore;
+    auto messages = qMax(messagesMetric->value() - messagesBefore, quint64(1));
+
+    out << QStringLiteral("%1: %2 messages, %3 messages/s, %4 ns/message, %5 allocations/message")
+           .arg(name)
+           .arg(messages)
+           .arg(qRound64(static_cast<double>(messages)*1e9/static_cast<double>(nsecs)))
+           .arg(static_cast<double>(nsecs)/static_cast<double>(messages), 0, 'f', 0)
+           .arg(static_cast<double>(allocations)/static_cast<double>(messages), 0, 'f', 2)
+        << Qt::endl;
+}
+
+}
+
+
+auto Traffic::DecoderBenchmark::run() -> int
+{
+    QTextStream out(stdout);
+    measure(out, QStringLiteral("FLARM"), makeCorpus(Encoding::FLARM));
+    measure(out, QStringLiteral("GDL90"), makeCorpus(Encoding::GDL90));
+    measure(out, QStringLiteral("XGPS"), makeCorpus(Encoding::XGPS));
+    measure(out, QStringLiteral("Mixed"), makeCorpus({}));
+    return 0;
+}
@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+
+
+namespace Traffic {
+
+/*! \brief Measures the throughput of the traffic data decoders
+ *
+ * This class feeds synthetic traffic to the decoders of
+ * TrafficDataSource_Abstract and writes the number of messages decoded per
+ * second, the time and the number of heap allocations per message to stdout.
+ * There are four corpora: FLARM/NMEA sentences, GDL90 datagrams, XGPS strings
+ * and a mix of the three, all describing the same kind of traffic situation.
+ * Messages are counted where the decoders count them for the metrics
+ * "traffic/<sourceName>/messages"; for GDL90, this is the number of frames
+ * with valid CRC that are interpreted.
+ *
+ * The benchmark is built as a separate executable, enroute-traffic-benchmark,
+ * which replaces the global operator new in order to count heap allocations.
+ * It is not part of the app. The random data is generated with a fixed seed,
+ * so that the results of different runs can be compared.
+ */
+
+class DecoderBenchmark
+{
+public:
+    /*! \brief Run the benchmark
+     *
+     * @returns Exit code for the application, zero on success
+     */
+    static int run();
+
+    /*! \brief Number of heap allocations
+     *
+     * The replacement of operator new in enroute-traffic-benchmark increments
+     * this number on every allocation.
+     */
+    static std::atomic<quint64> allocations;
+};
+
+};
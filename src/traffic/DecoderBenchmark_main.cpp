@@ -0,0 +1,58 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QCoreApplication>
+#include <cstdlib>
+#include <new>
+
+#include "traffic/DecoderBenchmark.h"
+
+
+// Replacements of the global operator new and delete that count the heap
+// allocations for Traffic::DecoderBenchmark. The array, nothrow and sized
+// forms of the standard library forward to these.
+
+auto operator new(std::size_t size) -> void*
+{
+    Traffic::DecoderBenchmark::allocations.fetch_add(1, std::memory_order_relaxed);
+    auto* result = std::malloc(size == 0 ? 1 : size);
+    if (result == nullptr) {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t /*size*/) noexcept
+{
+    std::free(pointer);
+}
+
+
+auto main(int argc, char *argv[]) -> int
+{
+    // Timers of the traffic data sources need an application object
+    QCoreApplication app(argc, argv);
+    return Traffic::DecoderBenchmark::run();
+}
@@ -19,8 +19,17 @@
  ***************************************************************************/
 
 #include <QCoreApplication>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <cstring>
+#include <utility>
 
 #include "GlobalObject.h"
+#include "InitScheduler.h"
+#include "Metrics.h"
+#include "MobileAdaptor.h"
+#include "Tracer.h"
 #include "dataManagement/DataManager.h"
 #include "traffic/FlarmnetDB.h"
 
@@ -37,10 +46,149 @@ void Traffic::FlarmnetDB::clearCache()
 }
 
 
+// Format of the database file: one header line, followed by entries of
+// lineSize bytes each. Every entry consists of a six-digit hexadecimal Flarm
+// ID, a space, and the registration, padded with spaces.
+namespace {
+
+constexpr qint64 lineSize = 24;
+constexpr qint64 keySize = 6;
+constexpr qint64 valueOffset = 7;
+constexpr qint64 valueSize = 16;
+
+// Parses a six-digit hexadecimal Flarm ID. Returns false if the key is not
+// of this form.
+auto parseFlarmID(const char* key, qint64 size, quint32& flarmID) -> bool
+{
+    if (size != keySize) {
+        return false;
+    }
+    flarmID = 0;
+    for(qint64 i=0; i<size; i++) {
+        auto character = key[i];
+        quint32 digit = 0;
+        if ((character >= '0') && (character <= '9')) {
+            digit = character-'0';
+        } else if ((character >= 'A') && (character <= 'F')) {
+            digit = character-'A'+10;
+        } else if ((character >= 'a') && (character <= 'f')) {
+            digit = character-'a'+10;
+        } else {
+            return false;
+        }
+        flarmID = (flarmID << 4) | digit;
+    }
+    return true;
+}
+
+}
+
+
+Traffic::FlarmnetDB::MappedDatabase::MappedDatabase(std::shared_ptr<const DataManagement::MappedFile> file)
+    : m_file(std::move(file)), m_data(m_file->data()), m_size(m_file->size())
+{
+    if (m_data == nullptr) {
+        return;
+    }
+
+    // Skip header line
+    auto* header = static_cast<const uchar*>(std::memchr(m_data, '\n', m_size));
+    if (header == nullptr) {
+        return;
+    }
+    qint64 firstEntry = header-m_data+1;
+
+    // Build index. The line break of the last entry is optional.
+    auto numEntries = (m_size-firstEntry+1)/lineSize;
+    m_index.reserve(numEntries);
+    for(qint64 entry=0; entry<numEntries; entry++) {
+        auto offset = firstEntry + entry*lineSize;
+        quint32 flarmID = 0;
+        if (parseFlarmID(reinterpret_cast<const char*>(m_data+offset), keySize, flarmID)) {
+            m_index.push_back({flarmID, static_cast<quint32>(offset)});
+        }
+    }
+    std::sort(m_index.begin(), m_index.end());
+}
+
+
+auto Traffic::FlarmnetDB::MappedDatabase::lookup(quint32 flarmID) const -> QString
+{
+    auto entry = std::lower_bound(m_index.cbegin(), m_index.cend(), IndexEntry{flarmID, 0});
+    if ((entry == m_index.cend()) || (entry->flarmID != flarmID)) {
+        return {};
+    }
+
+    // The last entry of the file might lack the line break
+    auto start = entry->offset + valueOffset;
+    auto length = qMin(valueSize, m_size-start);
+    if (length <= 0) {
+        return {};
+    }
+    return QString::fromLatin1(reinterpret_cast<const char*>(m_data+start), static_cast<int>(length)).simplified();
+}
+
+
+void Traffic::FlarmnetDB::mapDatabase()
+{
+    unmapDatabase();
+    if (flarmnetDBDownloadable == nullptr) {
+        return;
+    }
+
+    // Mapping the file is cheap, but building the index takes a while
+    auto file = flarmnetDBDownloadable->mapFile();
+    auto generation = m_mappingGeneration;
+    auto* watcher = new QFutureWatcher<std::shared_ptr<const MappedDatabase>>(this);
+    connect(watcher, &QFutureWatcher<std::shared_ptr<const MappedDatabase>>::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+
+        // Ignore results if the database has been unmapped in the meantime
+        if (generation != m_mappingGeneration) {
+            return;
+        }
+        m_database = watcher->result();
+        clearCache();
+    });
+    auto future = QtConcurrent::run([file]() { return std::make_shared<const MappedDatabase>(file); });
+    watcher->setFuture(future);
+    m_mappingFuture = future;
+}
+
+
+void Traffic::FlarmnetDB::releaseMemory()
+{
+    static auto* releasedMetric = Metrics::counter(QStringLiteral("memory/flarmnetDB/bytesReleased"));
+
+    // Estimate the memory held by the cache
+    qint64 size = 0;
+    foreach(auto key, m_cache.keys()) {
+        size += qint64(sizeof(quint32)+sizeof(QString)) + m_cache.object(key)->size()*qint64(sizeof(QChar));
+    }
+    clearCache();
+    releasedMetric->add(size);
+}
+
+
+void Traffic::FlarmnetDB::unmapDatabase()
+{
+    m_mappingGeneration++;
+    m_database.reset();
+    clearCache();
+}
+
+
 void Traffic::FlarmnetDB::deferredInitialization()
 {
+    TRACE_SCOPE("FlarmnetDB::deferredInitialization");
     connect(GlobalObject::dataManager()->databases(), &DataManagement::DownloadableGroupWatcher::downloadablesChanged, this, &Traffic::FlarmnetDB::findFlarmnetDBDownloadable);
-    findFlarmnetDBDownloadable();
+    connect(GlobalObject::mobileAdaptor(), &MobileAdaptor::memoryLow, this, &Traffic::FlarmnetDB::releaseMemory);
+
+    // The databases are known once the catalogue has been read
+    GlobalObject::initScheduler()->addTask("flarmnetDB", {"catalogue"}, [this]() {
+        findFlarmnetDBDownloadable();
+        return m_mappingFuture;
+    });
 }
 
 
@@ -65,12 +213,14 @@ void Traffic::FlarmnetDB::findFlarmnetDBDownloadable()
     }
 
     if (flarmnetDBDownloadable != nullptr) {
-        disconnect(flarmnetDBDownloadable, &DataManagement::Downloadable::fileContentChanged, this, &Traffic::FlarmnetDB::clearCache);
+        disconnect(flarmnetDBDownloadable, &DataManagement::Downloadable::aboutToChangeFile, this, &Traffic::FlarmnetDB::unmapDatabase);
+        disconnect(flarmnetDBDownloadable, &DataManagement::Downloadable::fileContentChanged, this, &Traffic::FlarmnetDB::mapDatabase);
     }
 
     flarmnetDBDownloadable = newFlarmnetDBDownloadable;
     if (flarmnetDBDownloadable != nullptr) {
-        connect(flarmnetDBDownloadable, &DataManagement::Downloadable::fileContentChanged, this, &Traffic::FlarmnetDB::clearCache);
+        connect(flarmnetDBDownloadable, &DataManagement::Downloadable::aboutToChangeFile, this, &Traffic::FlarmnetDB::unmapDatabase);
+        connect(flarmnetDBDownloadable, &DataManagement::Downloadable::fileContentChanged, this, &Traffic::FlarmnetDB::mapDatabase);
 
         // Create an empty file, if no file exists. We set the FileModificationTime
         // to a point in the past, so that it will automatically be updated at the
@@ -84,83 +234,67 @@ void Traffic::FlarmnetDB::findFlarmnetDBDownloadable()
         }
 
     }
-    clearCache();
+    mapDatabase();
 
 }
 
 
-auto Traffic::FlarmnetDB::getRegistration(const QString& key) -> QString
+auto Traffic::FlarmnetDB::getRegistration(Traffic::TargetID ID) -> QString
 {
-    if (key.contains("!")) {
-        auto result = key.section('!', -1, -1);
-        return result;
+    if ((ID.addressType() != TargetID::ICAO) && (ID.addressType() != TargetID::FLARM)) {
+        return {};
     }
+    auto flarmID = ID.address();
 
     // Check if key exists in the cache
-    auto* cachedValue = m_cache[key];
+    auto* cachedValue = m_cache[flarmID];
     if (cachedValue != nullptr) {
         return *cachedValue;
     }
 
-    auto result = getRegistrationFromFile(key);
-    m_cache.insert(key, new QString(result));
+    QString result;
+    if (m_database != nullptr) {
+        result = m_database->lookup(flarmID);
+    }
+    m_cache.insert(flarmID, new QString(result));
     return result;
 }
 
 
-auto Traffic::FlarmnetDB::getRegistrationFromFile(const QString& key) -> QString
+auto Traffic::FlarmnetDB::getRegistrationAsync(Traffic::TargetID ID) -> QString
 {
-
-    // If not in the cache, try to find the values in the file.
-    if (flarmnetDBDownloadable == nullptr) {
+    if ((ID.addressType() != TargetID::ICAO) && (ID.addressType() != TargetID::FLARM)) {
         return {};
     }
+    auto flarmID = ID.address();
 
-    QFile dataFile(flarmnetDBDownloadable->fileName());
-    if (!dataFile.open(QIODevice::ReadOnly)) {
-        dataFile.open(QIODevice::WriteOnly);
-        dataFile.write(tr("Placeholder file.").toLatin1());
-        dataFile.flush();
-        dataFile.setFileTime(QDateTime( QDate(2021, 8, 21), QTime(13, 0)), QFileDevice::FileModificationTime);
+    // Check if key exists in the cache
+    auto* cachedValue = m_cache[flarmID];
+    if (cachedValue != nullptr) {
+        return *cachedValue;
+    }
+    if ((m_database == nullptr) || m_pendingLookups.contains(flarmID)) {
         return {};
     }
-    dataFile.readLine();
-
-    // Now to a binary search in the file
-    qint64 lineSize   = 24;
-    qint64 firstEntry = dataFile.pos();
-    qint64 numEntries = (dataFile.size()-firstEntry)/lineSize;
-
-    auto getKey = [firstEntry, lineSize](QFile& dataFile, qint64 entry) {
-        dataFile.seek(firstEntry + entry*lineSize);
-        return QString::fromLatin1(dataFile.readLine(6));
-    };
-    auto getVal = [firstEntry, lineSize](QFile& dataFile, qint64 entry) {
-        dataFile.seek(firstEntry + entry*lineSize + 7);
-        return QString::fromLatin1(dataFile.readLine(16)).simplified();
-    };
-
-    qint64 startIndex = 0;
-    qint64 endIndex   = numEntries-1;
-    do{
-        if (getKey(dataFile, startIndex) == key) {
-            auto value = getVal(dataFile, startIndex);
-            return value;
-        }
-        if (getKey(dataFile, endIndex) == key) {
-            auto value = getVal(dataFile, endIndex);
-            return value;
-        }
-        qint64 midIndex = (startIndex + endIndex)/2;
-        if (midIndex == startIndex) {
-            return {};
+
+    // Start lookup in background thread. The lambda holds a reference to the
+    // database, so that it remains mapped until the lookup is done.
+    m_pendingLookups.insert(flarmID);
+    auto* watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, database=m_database, flarmID, ID]() {
+        watcher->deleteLater();
+        m_pendingLookups.remove(flarmID);
+
+        // Ignore results from outdated databases
+        if (database != m_database) {
+            return;
         }
-        if (getKey(dataFile, endIndex) > key) {
-            endIndex = midIndex;
-        } else {
-            startIndex = midIndex;
+        auto result = watcher->result();
+        m_cache.insert(flarmID, new QString(result));
+        if (!result.isEmpty()) {
+            emit registrationFound(ID, result);
         }
-    }while(startIndex != endIndex);
-
+    });
+    watcher->setFuture(QtConcurrent::run([database=m_database, flarmID]() { return database->lookup(flarmID); }));
     return {};
 }
@@ -21,9 +21,15 @@
 #pragma once
 
 #include <QCache>
+#include <QFile>
+#include <QFuture>
 #include <QObject>
+#include <QSet>
+#include <memory>
+#include <vector>
 
 #include "dataManagement/Downloadable.h"
+#include "traffic/TargetID.h"
 
 namespace Traffic {
 
@@ -33,6 +39,12 @@ namespace Traffic {
  *  This simple class provides access to a Flarmnet database, which is in
  *  essence a glorified QHash<QString, QString>, where keys are Flarm IDs and
  *  values are aircraft registration strings.
+ *
+ *  The database file is memory-mapped once, when it is attached, and indexed
+ *  by a sorted array of the 24-bit Flarm IDs. The index is built in a
+ *  background thread; until it is ready, lookups find nothing. Lookups never
+ *  touch the disk. For code paths that must never block, getRegistrationAsync()
+ *  performs lookups in a background thread.
  */
 class FlarmnetDB : public QObject {
     Q_OBJECT
@@ -52,14 +64,42 @@ public:
     // Methods
     //
 
-    /*! \brief Find password for a given key
+    /*! \brief Find registration for a given target
      *
-     *  @param key FlarmID to look up
+     *  @param ID Target to look up. The database lists FLARM radio addresses,
+     *  which are often identical to the ICAO address of the aircraft. Targets
+     *  whose address is neither an ICAO nor a FLARM address are never found.
      *
      *  @returns Aircraft registration, or an empty string if the database does
-     *  not contain the key
+     *  not contain the target
      */
-    Q_INVOKABLE QString getRegistration(const QString& key);
+    Q_INVOKABLE QString getRegistration(Traffic::TargetID ID);
+
+    /*! \brief Find registration for a given target, without blocking
+     *
+     *  If the registration for the target is already known, it is returned
+     *  immediately. Otherwise, this method starts a lookup in a background
+     *  thread and returns an empty string. Once the lookup completes, the
+     *  signal registrationFound() is emitted.
+     *
+     *  @param ID Target to look up, as in getRegistration()
+     *
+     *  @returns Aircraft registration, or an empty string if the database does
+     *  not contain the target or if the registration is not yet known
+     */
+    QString getRegistrationAsync(Traffic::TargetID ID);
+
+signals:
+    /*! \brief Result of getRegistrationAsync()
+     *
+     *  This signal is emitted when a lookup started by getRegistrationAsync()
+     *  has found a registration for the target.
+     *
+     *  @param ID Target that was looked up
+     *
+     *  @param registration Aircraft registration
+     */
+    void registrationFound(Traffic::TargetID ID, const QString& registration);
 
 private slots:
     // The title says everything
@@ -71,12 +111,60 @@ private slots:
     // The title says everything
     void findFlarmnetDBDownloadable();
 
+    // Maps the database file into memory and starts building the index in a
+    // background thread. Once the index is ready, the database is used and
+    // the cache is cleared.
+    void mapDatabase();
+
+    // Clears the cache, when the platform reports that memory runs low
+    void releaseMemory();
+
+    // Releases the database file
+    void unmapDatabase();
+
 private:
-    QString getRegistrationFromFile(const QString& key);
+    // Memory-mapped database file, together with an index sorted by Flarm
+    // ID. Once constructed, instances are never modified, so that they can
+    // be shared with lookups that run in background threads. The file is
+    // unmapped when the last reference to the instance is released.
+    class MappedDatabase {
+    public:
+        explicit MappedDatabase(std::shared_ptr<const DataManagement::MappedFile> file);
+        Q_DISABLE_COPY_MOVE(MappedDatabase)
+
+        QString lookup(quint32 flarmID) const;
+
+    private:
+        struct IndexEntry {
+            quint32 flarmID;
+            quint32 offset;
+
+            bool operator<(const IndexEntry& rhs) const
+            {
+                return flarmID < rhs.flarmID;
+            }
+        };
+
+        std::shared_ptr<const DataManagement::MappedFile> m_file;
+        const uchar* m_data {nullptr};
+        qint64 m_size {0};
+        std::vector<IndexEntry> m_index;
+    };
 
     QPointer<DataManagement::Downloadable> flarmnetDBDownloadable;
 
-    QCache<QString, QString> m_cache {};
+    std::shared_ptr<const MappedDatabase> m_database;
+
+    // Future of the last call to mapDatabase(), and a counter that is
+    // increased whenever the database is unmapped, so that results of
+    // outdated mapping operations can be ignored
+    QFuture<void> m_mappingFuture;
+    quint64 m_mappingGeneration {0};
+
+    // Registrations, by Flarm ID, and Flarm IDs for which a background
+    // lookup is running
+    QCache<quint32, QString> m_cache {};
+    QSet<quint32> m_pendingLookups;
 };
 
 }
@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+
+
+namespace Traffic {
+
+/*! \brief Lookup table for the CRC-16-CCITT used by GDL90
+ *
+ * Entry i is the CRC of the byte i, for the polynomial 0x1021. The table is
+ * computed at compile time.
+ */
+inline constexpr auto gdl90CRCTable = []() {
+    std::array<quint16, 256> table {};
+    for(int i=0; i<256; i++) {
+        auto crc = static_cast<quint16>(i << 8);
+        for(int bit=0; bit<8; bit++) {
+            crc = ((crc & 0x8000U) != 0) ? static_cast<quint16>((crc << 1U) ^ 0x1021U) : static_cast<quint16>(crc << 1U);
+        }
+        table[static_cast<std::size_t>(i)] = crc;
+    }
+    return table;
+}();
+
+/*! \brief Feed one byte into the CRC of a GDL90 message
+ *
+ * GDL90 computes the CRC over the message ID and the message data, before
+ * escape characters are inserted, starting with the value zero. The CRC is
+ * sent after the message, least significant byte first.
+ *
+ * @param crc CRC of the preceding bytes, or zero for the first byte
+ *
+ * @param byte Next byte of the message
+ *
+ * @returns CRC of the message up to and including byte
+ */
+constexpr quint16 gdl90CRCUpdate(quint16 crc, quint8 byte)
+{
+    return gdl90CRCTable[crc >> 8U] ^ static_cast<quint16>(crc << 8U) ^ byte;
+}
+
+}
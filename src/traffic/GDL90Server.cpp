@@ -0,0 +1,369 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QHash>
+#include <QNetworkInterface>
+#include <QSettings>
+#include <QTime>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+#include "positioning/Geoid.h"
+#include "traffic/GDL90CRC.h"
+#include "traffic/GDL90Server.h"
+
+
+namespace {
+
+// Message IDs
+constexpr quint8 heartbeatID = 0;
+constexpr quint8 ownshipReportID = 10;
+constexpr quint8 ownshipGeometricAltitudeID = 11;
+constexpr quint8 trafficReportID = 20;
+
+// Size of ownship and traffic reports, including the message ID
+constexpr int reportSize = 28;
+
+// UDP ports where the TrafficDataProvider listens for traffic data
+constexpr std::array<quint16, 2> trafficDataPorts {4000, 49002};
+
+// Checks if datagrams sent to the client would reach the traffic data
+// sources of this app, which would then receive their own output
+auto receivesOwnOutput(const QHostAddress& address, quint16 port) -> bool
+{
+    if (std::find(trafficDataPorts.begin(), trafficDataPorts.end(), port) == trafficDataPorts.end()) {
+        return false;
+    }
+    if (address.isLoopback() || address.isBroadcast() || QNetworkInterface::allAddresses().contains(address)) {
+        return true;
+    }
+    foreach(const auto& networkInterface, QNetworkInterface::allInterfaces()) {
+        foreach(const auto& entry, networkInterface.addressEntries()) {
+            if (entry.broadcast() == address) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// GDL90 address type, as a function of the kind of address
+auto gdl90AddressType(Traffic::TargetID::AddressType type) -> quint8
+{
+    switch(type) {
+    case Traffic::TargetID::ICAO:
+        return 0; // ADS-B with ICAO address
+    default:
+        return 1; // ADS-B with self-assigned address
+    }
+}
+
+// Navigation Accuracy Category for Position, as a function of the estimated
+// position error
+auto navigationAccuracyCategory(Units::Distance error) -> quint8
+{
+    if (!error.isFinite()) {
+        return 0;
+    }
+    const std::array<std::pair<Units::Distance, quint8>, 11> categories {{
+        {Units::Distance::fromM(3.0), 11},
+        {Units::Distance::fromM(10.0), 10},
+        {Units::Distance::fromM(30.0), 9},
+        {Units::Distance::fromNM(0.05), 8},
+        {Units::Distance::fromNM(0.1), 7},
+        {Units::Distance::fromNM(0.3), 6},
+        {Units::Distance::fromNM(0.5), 5},
+        {Units::Distance::fromNM(1.0), 4},
+        {Units::Distance::fromNM(2.0), 3},
+        {Units::Distance::fromNM(4.0), 2},
+        {Units::Distance::fromNM(10.0), 1},
+    }};
+    for(const auto& [bound, category] : categories) {
+        if (error.toM() < bound.toM()) {
+            return category;
+        }
+    }
+    return 0;
+}
+
+// Emitter category, as a function of the aircraft type
+auto emitterCategory(Traffic::TrafficFactor_Abstract::AircraftType type) -> quint8
+{
+    switch(type) {
+    case Traffic::TrafficFactor_Abstract::Aircraft:
+        return 1;
+    case Traffic::TrafficFactor_Abstract::Jet:
+        return 6;
+    case Traffic::TrafficFactor_Abstract::Copter:
+        return 7;
+    case Traffic::TrafficFactor_Abstract::Glider:
+        return 9;
+    case Traffic::TrafficFactor_Abstract::Airship:
+    case Traffic::TrafficFactor_Abstract::Balloon:
+        return 10;
+    case Traffic::TrafficFactor_Abstract::Skydiver:
+        return 11;
+    case Traffic::TrafficFactor_Abstract::HangGlider:
+    case Traffic::TrafficFactor_Abstract::Paraglider:
+        return 12;
+    case Traffic::TrafficFactor_Abstract::Drone:
+        return 14;
+    case Traffic::TrafficFactor_Abstract::StaticObstacle:
+        return 19;
+    default:
+        return 0;
+    }
+}
+
+// Latitude or longitude as 24-bit signed integer, in semicircles
+void writeAngle(quint8* out, double angleInDEG)
+{
+    auto value = static_cast<qint32>(std::lround(angleInDEG*0x800000/180.0));
+    value = qBound(-0x800000, value, 0x7FFFFF);
+    out[0] = static_cast<quint8>(value >> 16);
+    out[1] = static_cast<quint8>(value >> 8);
+    out[2] = static_cast<quint8>(value);
+}
+
+} // namespace
+
+
+Traffic::GDL90Server::GDL90Server(QObject* parent)
+    : QObject(parent)
+{
+    QSettings settings;
+    foreach(auto entry, settings.value(QStringLiteral("GDL90Server/clients")).toList()) {
+        auto map = entry.toMap();
+        QHostAddress address(map.value(QStringLiteral("address")).toString());
+        auto port = map.value(QStringLiteral("port")).toUInt();
+        if (!address.isNull() && (port > 0) && (port <= 0xFFFF) && !receivesOwnOutput(address, static_cast<quint16>(port))) {
+            m_clients.push_back({address, static_cast<quint16>(port)});
+        }
+    }
+
+    // Heartbeat, two ownship messages and a few dozen traffic reports, with
+    // room for escape characters
+    m_buffer.reserve(4096);
+}
+
+
+auto Traffic::GDL90Server::addClient(const QString& address, quint16 port) -> bool
+{
+    QHostAddress hostAddress(address);
+    if (hostAddress.isNull() || (port == 0) || receivesOwnOutput(hostAddress, port)) {
+        return false;
+    }
+    for(const auto& client : m_clients) {
+        if ((client.address == hostAddress) && (client.port == port)) {
+            return true;
+        }
+    }
+    m_clients.push_back({hostAddress, port});
+    saveClients();
+    emit clientsChanged();
+    return true;
+}
+
+
+void Traffic::GDL90Server::appendFrame(const quint8* message, int size)
+{
+    quint16 crc = 0;
+    for(int i=0; i<size; i++) {
+        crc = Traffic::gdl90CRCUpdate(crc, message[i]);
+    }
+
+    auto appendEscaped = [this](quint8 byte) {
+        if ((byte == 0x7e) || (byte == 0x7d)) {
+            m_buffer.push_back(static_cast<char>(0x7d));
+            byte ^= 0x20U;
+        }
+        m_buffer.push_back(static_cast<char>(byte));
+    };
+    m_buffer.push_back(static_cast<char>(0x7e));
+    for(int i=0; i<size; i++) {
+        appendEscaped(message[i]);
+    }
+    appendEscaped(static_cast<quint8>(crc & 0xFFU));
+    appendEscaped(static_cast<quint8>(crc >> 8U));
+    m_buffer.push_back(static_cast<char>(0x7e));
+}
+
+
+void Traffic::GDL90Server::appendReport(quint8 messageID, quint8 alertStatus, Traffic::TargetID ID, const Positioning::PositionInfo& info, Units::Distance pressureAltitude, quint8 emitterCategory, const QString& callSign)
+{
+    std::array<quint8, reportSize> message {};
+    message[0] = messageID;
+
+    // Alert status, address type, address
+    auto address = ID.address();
+    message[1] = static_cast<quint8>((alertStatus << 4U) | gdl90AddressType(ID.addressType()));
+    message[2] = static_cast<quint8>(address >> 16U);
+    message[3] = static_cast<quint8>(address >> 8U);
+    message[4] = static_cast<quint8>(address);
+
+    // Position
+    auto coordinate = info.coordinate();
+    writeAngle(&message[5], coordinate.latitude());
+    writeAngle(&message[8], coordinate.longitude());
+
+    // Pressure altitude, in steps of 25ft with an offset of -1000ft, and
+    // miscellaneous indicators: airborne, updated report, track type
+    quint32 altitude = 0xFFF;
+    if (pressureAltitude.isFinite()) {
+        altitude = static_cast<quint32>(qBound(0L, std::lround((pressureAltitude.toFeet()+1000.0)/25.0), 0xFFEL));
+    }
+    auto track = info.trueTrack();
+    quint8 miscellaneous = 0x08U | (track.isFinite() ? 0x01U : 0x00U);
+    message[11] = static_cast<quint8>(altitude >> 4U);
+    message[12] = static_cast<quint8>(((altitude & 0x0FU) << 4U) | miscellaneous);
+
+    // Integrity and accuracy. The Navigation Integrity Category is reported
+    // equal to the accuracy category.
+    auto accuracy = navigationAccuracyCategory(info.positionErrorEstimate());
+    message[13] = static_cast<quint8>((accuracy << 4U) | accuracy);
+
+    // Horizontal velocity in knots, vertical velocity in steps of 64fpm
+    quint32 horizontalVelocity = 0xFFF;
+    auto groundSpeed = info.groundSpeed();
+    if (groundSpeed.isFinite()) {
+        horizontalVelocity = static_cast<quint32>(qBound(0L, std::lround(groundSpeed.toKN()), 0xFFEL));
+    }
+    quint32 verticalVelocity = 0x800;
+    auto verticalSpeed = info.verticalSpeed();
+    if (verticalSpeed.isFinite()) {
+        verticalVelocity = static_cast<quint32>(qBound(-510L, std::lround(verticalSpeed.toFPM()/64.0), 510L)) & 0xFFFU;
+    }
+    message[14] = static_cast<quint8>(horizontalVelocity >> 4U);
+    message[15] = static_cast<quint8>(((horizontalVelocity & 0x0FU) << 4U) | (verticalVelocity >> 8U));
+    message[16] = static_cast<quint8>(verticalVelocity);
+
+    // Track, emitter category
+    if (track.isFinite()) {
+        message[17] = static_cast<quint8>(std::lround(track.toDEG()*256.0/360.0) & 0xFF);
+    }
+    message[18] = emitterCategory;
+
+    // Call sign, eight characters padded with spaces; priority code zero
+    for(int i=0; i<8; i++) {
+        auto character = (i < callSign.size()) ? callSign.at(i).toUpper().toLatin1() : ' ';
+        message[19+i] = static_cast<quint8>(((character >= '0') && (character <= '9')) || ((character >= 'A') && (character <= 'Z')) ? character : ' ');
+    }
+
+    appendFrame(message.data(), reportSize);
+}
+
+
+void Traffic::GDL90Server::broadcast(const Positioning::PositionInfo& ownship, Units::Distance ownshipPressureAltitude, const QList<Traffic::TrafficFactor_WithPosition*>& traffic)
+{
+    if (m_clients.empty()) {
+        return;
+    }
+    m_buffer.clear();
+
+    // Heartbeat: GPS position valid, UAT initialized, UTC timing valid, time
+    // in seconds since midnight UTC
+    auto seconds = static_cast<quint32>(QTime(0, 0).secsTo(QDateTime::currentDateTimeUtc().time()));
+    const std::array<quint8, 7> heartbeat {
+        heartbeatID,
+        static_cast<quint8>((ownship.isValid() ? 0x80U : 0x00U) | 0x01U),
+        static_cast<quint8>(((seconds >> 16U) << 7U) | 0x01U),
+        static_cast<quint8>(seconds),
+        static_cast<quint8>(seconds >> 8U),
+        0,
+        0
+    };
+    appendFrame(heartbeat.data(), static_cast<int>(heartbeat.size()));
+
+    // Ownship report and geometric altitude, as height above the ellipsoid
+    // in steps of 5ft; vertical figure of merit unknown
+    if (ownship.isValid()) {
+        appendReport(ownshipReportID, 0, Traffic::TargetID(0, Traffic::TargetID::ICAO), ownship, ownshipPressureAltitude, 1, {});
+
+        auto altitude = ownship.trueAltitude();
+        auto separation = Positioning::Geoid::separation(ownship.coordinate());
+        if (altitude.isFinite() && separation.isFinite()) {
+            auto value = static_cast<qint32>(qBound(-32768L, std::lround((altitude+separation).toFeet()/5.0), 32767L));
+            const std::array<quint8, 5> geometricAltitude {
+                ownshipGeometricAltitudeID,
+                static_cast<quint8>(value >> 8),
+                static_cast<quint8>(value),
+                0x7F,
+                0xFF
+            };
+            appendFrame(geometricAltitude.data(), static_cast<int>(geometricAltitude.size()));
+        }
+    }
+
+    // Traffic reports. Targets without ID get an address derived from the
+    // object, which is stable for as long as the object shows the target.
+    foreach(auto* target, traffic) {
+        if ((target == nullptr) || !target->valid()) {
+            continue;
+        }
+        auto ID = target->ID().isValid() ? target->ID() : Traffic::TargetID(static_cast<quint32>(qHash(target)), Traffic::TargetID::Anonymous);
+        Units::Distance pressureAltitude;
+        if (ownshipPressureAltitude.isFinite() && target->vDist().isFinite()) {
+            pressureAltitude = ownshipPressureAltitude+target->vDist();
+        }
+        appendReport(trafficReportID, (target->alarmLevel() > 0) ? 1 : 0, ID, target->positionInfo(), pressureAltitude, emitterCategory(target->type()), target->callSign());
+    }
+
+    // One encoded datagram for all clients
+    for(const auto& client : m_clients) {
+        m_socket.writeDatagram(m_buffer.data(), static_cast<qint64>(m_buffer.size()), client.address, client.port);
+    }
+}
+
+
+auto Traffic::GDL90Server::clients() const -> QStringList
+{
+    QStringList result;
+    for(const auto& client : m_clients) {
+        result << QStringLiteral("%1:%2").arg(client.address.toString()).arg(client.port);
+    }
+    return result;
+}
+
+
+void Traffic::GDL90Server::removeClient(const QString& address, quint16 port)
+{
+    QHostAddress hostAddress(address);
+    auto oldSize = m_clients.size();
+    m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(), [&](const Client& client) {
+        return (client.address == hostAddress) && (client.port == port);
+    }), m_clients.end());
+    if (m_clients.size() != oldSize) {
+        saveClients();
+        emit clientsChanged();
+    }
+}
+
+
+void Traffic::GDL90Server::saveClients() const
+{
+    QVariantList entries;
+    for(const auto& client : m_clients) {
+        entries.append(QVariantMap {{QStringLiteral("address"), client.address.toString()}, {QStringLiteral("port"), client.port}});
+    }
+    QSettings settings;
+    settings.setValue(QStringLiteral("GDL90Server/clients"), entries);
+}
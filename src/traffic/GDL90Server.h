@@ -0,0 +1,167 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QHostAddress>
+#include <QObject>
+#include <QUdpSocket>
+#include <vector>
+
+#include "positioning/PositionInfo.h"
+#include "traffic/TargetID.h"
+#include "traffic/TrafficFactor_WithPosition.h"
+#include "units/Distance.h"
+
+
+namespace Traffic {
+
+/*! \brief GDL90 output for other cockpit apps
+ *
+ *  This class re-broadcasts the ownship position and the fused traffic in
+ *  GDL90 format, following the "GDL 90 Data Interface Specification" and the
+ *  "ForeFlight GDL90 Extended Specification", so that other apps (for
+ *  instance, an EFB running on the same tablet) can display the traffic seen
+ *  by this app. The output is sent by UDP to all registered clients. Clients
+ *  are stored in QSettings.
+ *
+ *  Once per call to broadcast(), the class encodes one heartbeat, one ownship
+ *  report, one ownship geometric altitude message and one traffic report for
+ *  every valid traffic object into a single buffer that is reused from call
+ *  to call. The same buffer is then sent to every client, as one datagram.
+ *  Nothing is encoded while there are no clients.
+ *
+ *  Clients on this device (or broadcast addresses) that listen on a port
+ *  where a traffic data source of this app listens are rejected, because the
+ *  app would receive its own output.
+ */
+
+class GDL90Server : public QObject {
+    Q_OBJECT
+
+public:
+    /*! \brief Default constructor
+     *
+     *  @param parent The standard QObject parent pointer
+     */
+    explicit GDL90Server(QObject* parent = nullptr);
+
+    // Standard destructor
+    ~GDL90Server() override = default;
+
+
+    //
+    // Properties
+    //
+
+    /*! \brief Registered clients
+     *
+     *  This property holds the registered clients, as human-readable strings
+     *  of the form "address:port".
+     */
+    Q_PROPERTY(QStringList clients READ clients NOTIFY clientsChanged)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     *  @returns Property clients
+     */
+    QStringList clients() const;
+
+    /*! \brief Check if there are clients
+     *
+     *  @returns True if at least one client is registered
+     */
+    bool hasClients() const
+    {
+        return !m_clients.empty();
+    }
+
+
+    //
+    // Methods
+    //
+
+    /*! \brief Register a client
+     *
+     *  @param address IPv4 or IPv6 address of the client
+     *
+     *  @param port UDP port of the client. The GDL90 standard port is 4000.
+     *
+     *  @returns False if the address cannot be parsed, or if the client
+     *  would feed the output back into the traffic data sources of this app.
+     *  Adding a client that is already registered does nothing and returns
+     *  true.
+     */
+    Q_INVOKABLE bool addClient(const QString& address, quint16 port);
+
+    /*! \brief Unregister a client
+     *
+     *  @param address Address of the client, as passed to addClient()
+     *
+     *  @param port UDP port of the client
+     */
+    Q_INVOKABLE void removeClient(const QString& address, quint16 port);
+
+    /*! \brief Encode the current state and send it to all clients
+     *
+     *  This method is meant to be called once per second.
+     *
+     *  @param ownship Position info of ownship
+     *
+     *  @param ownshipPressureAltitude Pressure altitude of ownship. The
+     *  pressure altitudes of traffic are computed from this value and from
+     *  the vertical distances of the traffic objects. If the value is NaN, the
+     *  pressure altitudes are reported as unknown.
+     *
+     *  @param traffic Traffic objects. Invalid objects are ignored.
+     */
+    void broadcast(const Positioning::PositionInfo& ownship, Units::Distance ownshipPressureAltitude, const QList<Traffic::TrafficFactor_WithPosition*>& traffic);
+
+signals:
+    /*! \brief Notification signal for the property with the same name */
+    void clientsChanged();
+
+private:
+    Q_DISABLE_COPY_MOVE(GDL90Server)
+
+    // Appends a framed message, with CRC and escape characters, to m_buffer.
+    // The message starts with the message ID.
+    void appendFrame(const quint8* message, int size);
+
+    // Appends an ownship or traffic report, with the layout common to both
+    void appendReport(quint8 messageID, quint8 alertStatus, Traffic::TargetID ID, const Positioning::PositionInfo& info, Units::Distance pressureAltitude, quint8 emitterCategory, const QString& callSign);
+
+    // Writes the list of clients to QSettings
+    void saveClients() const;
+
+    struct Client {
+        QHostAddress address;
+        quint16 port;
+    };
+    std::vector<Client> m_clients;
+
+    QUdpSocket m_socket;
+
+    // Encoded output of the last call to broadcast(). The capacity is kept
+    // from call to call.
+    std::vector<char> m_buffer;
+};
+
+}
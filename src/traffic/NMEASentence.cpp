@@ -0,0 +1,244 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <QtNumeric>
+#include <limits>
+
+#include "traffic/NMEASentence.h"
+
+
+// Static Helper functions
+
+auto hexDigit(char character) -> int
+{
+    if ((character >= '0') && (character <= '9')) {
+        return character-'0';
+    }
+    if ((character >= 'A') && (character <= 'F')) {
+        return character-'A'+10;
+    }
+    if ((character >= 'a') && (character <= 'f')) {
+        return character-'a'+10;
+    }
+    return -1;
+}
+
+
+// Member functions
+
+auto Traffic::NMEASentence::parse(std::string_view sentence) -> bool
+{
+    m_data = sentence.data();
+    m_numFields = 0;
+    m_type = 0;
+    m_checksumError = false;
+
+    // Strip trailing whitespace and line breaks
+    while (!sentence.empty() && (static_cast<quint8>(sentence.back()) <= ' ')) {
+        sentence.remove_suffix(1);
+    }
+
+    // Check framing: "$" + payload + "*" + two hex digits
+    auto size = sentence.size();
+    if ((size < 4) || (size > std::numeric_limits<quint16>::max())) {
+        return false;
+    }
+    if ((sentence[0] != '$') || (sentence[size-3] != '*')) {
+        return false;
+    }
+    auto high = hexDigit(sentence[size-2]);
+    auto low = hexDigit(sentence[size-1]);
+    if ((high < 0) || (low < 0)) {
+        return false;
+    }
+
+    // Compute checksum and split into fields in one pass
+    quint8 checksum = 0;
+    quint16 fieldStart = 1;
+    for(std::size_t i=1; i<size-3; i++) {
+        auto character = sentence[i];
+        if (character == '*') {
+            return false;
+        }
+        checksum ^= static_cast<quint8>(character);
+        if (character == ',') {
+            if (m_numFields == maxFields) {
+                return false;
+            }
+            m_fields[m_numFields++] = {fieldStart, static_cast<quint16>(i-fieldStart)};
+            fieldStart = static_cast<quint16>(i+1);
+        }
+    }
+    if (m_numFields == maxFields) {
+        return false;
+    }
+    m_fields[m_numFields++] = {fieldStart, static_cast<quint16>(size-3-fieldStart)};
+
+    if (checksum != high*16+low) {
+        m_numFields = 0;
+        m_checksumError = true;
+        return false;
+    }
+
+    m_type = tag(std::string_view(m_data+m_fields[0].start, m_fields[0].length));
+    return true;
+}
+
+
+auto Traffic::NMEASentence::split(std::string_view data) -> bool
+{
+    m_data = data.data();
+    m_numFields = 0;
+    m_type = 0;
+    m_checksumError = false;
+
+    // Strip trailing whitespace and line breaks
+    while (!data.empty() && (static_cast<quint8>(data.back()) <= ' ')) {
+        data.remove_suffix(1);
+    }
+    if (data.empty() || (data.size() > std::numeric_limits<quint16>::max())) {
+        return false;
+    }
+
+    quint16 fieldStart = 0;
+    for(std::size_t i=0; i<data.size(); i++) {
+        if (data[i] == ',') {
+            if (m_numFields == maxFields) {
+                m_numFields = 0;
+                return false;
+            }
+            m_fields[m_numFields++] = {fieldStart, static_cast<quint16>(i-fieldStart)};
+            fieldStart = static_cast<quint16>(i+1);
+        }
+    }
+    if (m_numFields == maxFields) {
+        m_numFields = 0;
+        return false;
+    }
+    m_fields[m_numFields++] = {fieldStart, static_cast<quint16>(data.size()-fieldStart)};
+
+    m_type = tag(std::string_view(m_data+m_fields[0].start, m_fields[0].length));
+    return true;
+}
+
+
+auto Traffic::NMEASentence::operator[](int index) const -> std::string_view
+{
+    if ((index < 0) || (index+1 >= m_numFields)) {
+        return {};
+    }
+    auto field = m_fields[index+1];
+    return {m_data+field.start, field.length};
+}
+
+
+auto Traffic::NMEASentence::toDouble(std::string_view field, bool* ok) -> double
+{
+    if (ok != nullptr) {
+        *ok = false;
+    }
+
+    bool negative = false;
+    if (!field.empty() && ((field[0] == '-') || (field[0] == '+'))) {
+        negative = (field[0] == '-');
+        field.remove_prefix(1);
+    }
+    if (field.empty()) {
+        return qQNaN();
+    }
+
+    // Mantissa as an integer, to avoid accumulating rounding errors
+    quint64 mantissa = 0;
+    int decimals = 0;
+    int digits = 0;
+    bool seenPoint = false;
+    for(auto character : field) {
+        if (character == '.') {
+            if (seenPoint) {
+                return qQNaN();
+            }
+            seenPoint = true;
+            continue;
+        }
+        if ((character < '0') || (character > '9')) {
+            return qQNaN();
+        }
+        // Digits beyond the precision of a double are ignored
+        if (digits < 18) {
+            mantissa = mantissa*10 + static_cast<quint64>(character-'0');
+            digits++;
+            if (seenPoint) {
+                decimals++;
+            }
+        } else if (!seenPoint) {
+            decimals--;
+        }
+    }
+    if (digits == 0) {
+        return qQNaN();
+    }
+
+    static constexpr double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                             1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    auto result = static_cast<double>(mantissa);
+    while (decimals < 0) {
+        auto step = qMin(-decimals, 18);
+        result *= powersOfTen[step];
+        decimals += step;
+    }
+    result /= powersOfTen[decimals];
+
+    if (ok != nullptr) {
+        *ok = true;
+    }
+    return negative ? -result : result;
+}
+
+
+auto Traffic::NMEASentence::toInt(std::string_view field, bool* ok, int base) -> int
+{
+    if (ok != nullptr) {
+        *ok = false;
+    }
+
+    bool negative = false;
+    if (!field.empty() && ((field[0] == '-') || (field[0] == '+'))) {
+        negative = (field[0] == '-');
+        field.remove_prefix(1);
+    }
+    if (field.empty() || ((base != 10) && (base != 16)) || (field.size() > (base == 16 ? 7U : 9U))) {
+        return 0;
+    }
+
+    int result = 0;
+    for(auto character : field) {
+        auto digit = hexDigit(character);
+        if ((digit < 0) || (digit >= base)) {
+            return 0;
+        }
+        result = result*base + digit;
+    }
+
+    if (ok != nullptr) {
+        *ok = true;
+    }
+    return negative ? -result : result;
+}
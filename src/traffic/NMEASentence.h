@@ -0,0 +1,209 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QString>
+#include <string_view>
+
+
+namespace Traffic {
+
+/*! \brief Tokenizer for NMEA sentences
+ *
+ * This class splits an NMEA sentence such as
+ * "$PFLAA,0,1587,1588,40,1,AA1237,225,,37,-1.6,1*7F" into fields, after
+ * validating the checksum. The class does not copy the sentence and does not
+ * allocate memory: fields are views into the data passed to parse(), which
+ * must therefore stay alive as long as the fields are used. The method split()
+ * tokenizes comma-separated data without NMEA framing, such as the XGPS
+ * strings sent by flight simulators.
+ */
+
+class NMEASentence
+{
+public:
+    /*! \brief Maximal number of fields, including the sentence type */
+    static constexpr int maxFields = 32;
+
+    /*! \brief Tag identifying a sentence type
+     *
+     * @param type Sentence type, such as "PFLAA"
+     *
+     * @returns The five characters of the type, packed into an integer that
+     * can be used in switch statements
+     */
+    static constexpr auto tag(std::string_view type) -> quint64
+    {
+        quint64 result = 0;
+        for(auto character : type.substr(0, 5)) {
+            result = (result << 8) | static_cast<quint8>(character);
+        }
+        return result;
+    }
+
+    /*! \brief Parse a sentence
+     *
+     * The sentence must start with a dollar sign and end with an asterisk
+     * followed by two hexadecimal digits that match the checksum. Trailing
+     * whitespace and line breaks are ignored.
+     *
+     * @param sentence Sentence to parse
+     *
+     * @returns True if the sentence is valid. If false is returned, the
+     * sentence has no fields and type() returns 0.
+     */
+    bool parse(std::string_view sentence);
+
+    /*! \brief Split comma-separated data into fields
+     *
+     * Unlike parse(), this method does not expect a dollar sign or a
+     * checksum. The first field is treated as the sentence type. Trailing
+     * whitespace and line breaks are ignored.
+     *
+     * @param data Data to split
+     *
+     * @returns True if the data could be split. If false is returned, there
+     * are no fields and type() returns 0.
+     */
+    bool split(std::string_view data);
+
+    /*! \brief Check if the last call to parse() failed because of the checksum
+     *
+     * @returns True if the sentence was framed correctly, but the checksum
+     * did not match
+     */
+    bool hasChecksumError() const
+    {
+        return m_checksumError;
+    }
+
+    /*! \brief Tag of the sentence type
+     *
+     * @returns Tag of the first field, as computed by tag()
+     */
+    quint64 type() const
+    {
+        return m_type;
+    }
+
+    /*! \brief Number of arguments
+     *
+     * @returns Number of fields that follow the sentence type
+     */
+    int size() const
+    {
+        return m_numFields > 0 ? m_numFields-1 : 0;
+    }
+
+    /*! \brief Argument
+     *
+     * @param index Index of the argument; 0 is the first field after the
+     * sentence type
+     *
+     * @returns The argument, or an empty view if there is no argument with
+     * the given index
+     */
+    std::string_view operator[](int index) const;
+
+    /*! \brief Argument, converted to double
+     *
+     * Accepts numbers of the form "-12.345", as used in NMEA sentences, but
+     * no exponents.
+     *
+     * @param index Index of the argument
+     *
+     * @param ok If not nullptr, set to true if the argument is a valid number
+     *
+     * @returns The number, or NaN if the argument is not a number
+     */
+    double toDouble(int index, bool* ok = nullptr) const
+    {
+        return toDouble(operator[](index), ok);
+    }
+
+    /*! \brief Argument, converted to integer
+     *
+     * @param index Index of the argument
+     *
+     * @param ok If not nullptr, set to true if the argument is a valid number
+     *
+     * @param base Base, either 10 or 16
+     *
+     * @returns The number, or 0 if the argument is not a number
+     */
+    int toInt(int index, bool* ok = nullptr, int base = 10) const
+    {
+        return toInt(operator[](index), ok, base);
+    }
+
+    /*! \brief Argument, converted to QString
+     *
+     * This method allocates memory and should only be used for arguments
+     * that are passed on to code outside of the parser.
+     *
+     * @param index Index of the argument
+     *
+     * @returns The argument
+     */
+    QString toString(int index) const
+    {
+        auto field = operator[](index);
+        return QString::fromLatin1(field.data(), static_cast<int>(field.size()));
+    }
+
+    /*! \brief Convert string to double
+     *
+     * @param field String, as described in the non-static method
+     *
+     * @param ok If not nullptr, set to true if the string is a valid number
+     *
+     * @returns The number, or NaN if the string is not a number
+     */
+    static double toDouble(std::string_view field, bool* ok = nullptr);
+
+    /*! \brief Convert string to integer
+     *
+     * @param field String
+     *
+     * @param ok If not nullptr, set to true if the string is a valid number
+     *
+     * @param base Base, either 10 or 16
+     *
+     * @returns The number, or 0 if the string is not a number
+     */
+    static int toInt(std::string_view field, bool* ok = nullptr, int base = 10);
+
+private:
+    // Start and length of the fields, relative to m_data
+    struct Field {
+        quint16 start;
+        quint16 length;
+    };
+
+    const char* m_data {nullptr};
+    Field m_fields[maxFields] {};
+    int m_numFields {0};
+    quint64 m_type {0};
+    bool m_checksumError {false};
+};
+
+};
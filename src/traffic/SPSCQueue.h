@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+
+namespace Traffic {
+
+/*! \brief Lock-free queue for one producer and one consumer
+ *
+ * This class implements a bounded ring buffer that can be used to hand data
+ * from one thread to another without locks. At any time, at most one thread
+ * may call push(), and at most one (possibly different) thread may call
+ * pop().
+ *
+ * @tparam T Type of the elements. This type must be default-constructible and
+ * move-assignable.
+ *
+ * @tparam capacity Maximal number of elements in the queue. This must be a
+ * power of two.
+ */
+
+template<typename T, std::size_t capacity>
+class SPSCQueue
+{
+    static_assert((capacity > 0) && ((capacity & (capacity-1)) == 0), "Capacity must be a power of two");
+
+public:
+    /*! \brief Append element
+     *
+     * This method must only be called from the producer thread.
+     *
+     * @param value Element to append
+     *
+     * @returns False if the queue is full. In this case, value is dropped.
+     */
+    bool push(T&& value)
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == capacity) {
+            return false;
+        }
+        m_slots[tail & (capacity-1)] = std::move(value);
+        m_tail.store(tail+1, std::memory_order_release);
+        return true;
+    }
+
+    /*! \brief Take first element
+     *
+     * This method must only be called from the consumer thread.
+     *
+     * @param value If the queue is not empty, the first element is moved here
+     *
+     * @returns False if the queue is empty
+     */
+    bool pop(T& value)
+    {
+        auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(m_slots[head & (capacity-1)]);
+        m_head.store(head+1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // Producer and consumer index live on different cache lines, so that the
+    // two threads do not compete for the same line
+    alignas(64) std::atomic<std::size_t> m_head {0};
+    alignas(64) std::atomic<std::size_t> m_tail {0};
+    std::array<T, capacity> m_slots {};
+};
+
+};
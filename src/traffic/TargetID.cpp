@@ -18,52 +18,36 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-import QtLocation 5.15
-import QtPositioning 5.15
-import QtQuick 2.15
+#include "traffic/TargetID.h"
 
 
-MapQuickItem {
-    id: traffic1MapItem
-
-    property var trafficInfo: ({})
-
-    coordinate: trafficInfo.positionInfo.coordinate()
-    Behavior on coordinate {
-        CoordinateAnimation { duration: 1000 }
-        enabled: trafficInfo.animate
-    }
-
-    visible: trafficInfo.valid
-
-    Connections {
-        // This is a workaround against a bug in Qt 5.15.2.  The position of the MapQuickItem
-        // is not updated when the height of the map changes. It does get updated when the
-        // width of the map changes. We use the undocumented method polishAndUpdate() here.
-        target: flightMap
-        function onHeightChanged() { traffic1MapItem.polishAndUpdate() }
+auto Traffic::TargetID::fromHex(std::string_view hex, AddressType addressType) -> TargetID
+{
+    if (hex.empty() || (hex.size() > 6)) {
+        return {};
     }
-
-    sourceItem: Item {
-        rotation: trafficInfo.positionInfo.trueTrack().isFinite() ? trafficInfo.positionInfo.trueTrack().toDEG()-flightMap.bearing : 0
-
-        FlightVector {
-            width: 3
-            groundSpeedInMetersPerSecond: trafficInfo.positionInfo.groundSpeed().toMPS()
-            visible: (groundSpeedInMetersPerSecond > 5) && (trafficInfo.positionInfo.trueTrack().isFinite())
-            opacity: 0.8
+    quint32 address = 0;
+    for(auto character : hex) {
+        quint32 digit = 0;
+        if ((character >= '0') && (character <= '9')) {
+            digit = character-'0';
+        } else if ((character >= 'A') && (character <= 'F')) {
+            digit = character-'A'+10;
+        } else if ((character >= 'a') && (character <= 'f')) {
+            digit = character-'a'+10;
+        } else {
+            return {};
         }
+        address = (address << 4U) | digit;
+    }
+    return {address, addressType};
+}
 
-        Image {
-            id: image
-
-            x: -width/2.0
-            y: -height/2.0
-
-            source: trafficInfo.icon
 
-            sourceSize.width: 30
-            sourceSize.height: 30
-        }
+auto Traffic::TargetID::toString() const -> QString
+{
+    if (!isValid()) {
+        return {};
     }
+    return QString::number(address(), 16).rightJustified(6, '0').toUpper();
 }
@@ -0,0 +1,159 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QMetaType>
+#include <QString>
+#include <string_view>
+
+
+namespace Traffic {
+
+/*! \brief Identity of a traffic target
+ *
+ *  Traffic receivers identify targets by a 24-bit address, together with the
+ *  kind of address. This class stores both in a single 32-bit integer, so
+ *  that identities can be compared and hashed without touching strings.
+ *  Strings are only generated for display, by toString().
+ *
+ *  Addresses of different kinds never compare equal. ICAO addresses reported
+ *  by a FLARM device and by an ADS-B receiver, however, do, so that targets
+ *  seen by both devices are recognized as the same.
+ */
+
+class TargetID
+{
+    Q_GADGET
+
+public:
+    /*! \brief Kind of address */
+    enum AddressType : quint8 {
+        None,     /*!< No address; the target cannot be identified */
+        ICAO,     /*!< ICAO 24-bit aircraft address */
+        FLARM,    /*!< Address assigned by FLARM */
+        Anonymous /*!< Random, self-assigned or otherwise temporary address */
+    };
+    Q_ENUM(AddressType)
+
+    /*! \brief Constructs an invalid identity */
+    constexpr TargetID() = default;
+
+    /*! \brief Constructs an identity
+     *
+     *  @param address Address. Only the lower 24 bits are used.
+     *
+     *  @param addressType Kind of address
+     */
+    constexpr TargetID(quint32 address, AddressType addressType)
+        : m_key((static_cast<quint32>(addressType) << 24U) | (address & 0xFFFFFFU))
+    {
+    }
+
+    /*! \brief Constructs an identity from hexadecimal digits
+     *
+     *  @param hex Up to six hexadecimal digits, as used by FLARM and in
+     *  GDL90 documentation
+     *
+     *  @param addressType Kind of address
+     *
+     *  @returns The identity, or an invalid identity if hex is empty or not a
+     *  hexadecimal number of at most six digits
+     */
+    static TargetID fromHex(std::string_view hex, AddressType addressType);
+
+    /*! \brief Address
+     *
+     *  @returns The 24-bit address
+     */
+    constexpr quint32 address() const
+    {
+        return m_key & 0xFFFFFFU;
+    }
+
+    /*! \brief Kind of address
+     *
+     *  @returns Kind of address
+     */
+    constexpr AddressType addressType() const
+    {
+        return static_cast<AddressType>(m_key >> 24U);
+    }
+
+    /*! \brief Check if the target can be identified
+     *
+     *  @returns True if the address type is not None
+     */
+    Q_INVOKABLE constexpr bool isValid() const
+    {
+        return addressType() != None;
+    }
+
+    /*! \brief Address and address type, packed into an integer
+     *
+     *  @returns Integer that is unique for every identity
+     */
+    constexpr quint32 key() const
+    {
+        return m_key;
+    }
+
+    /*! \brief Address, for display
+     *
+     *  @returns Six uppercase hexadecimal digits, or an empty string if the
+     *  identity is invalid
+     */
+    Q_INVOKABLE QString toString() const;
+
+    /*! \brief Comparison */
+    constexpr bool operator==(TargetID other) const
+    {
+        return m_key == other.m_key;
+    }
+
+    /*! \brief Comparison */
+    constexpr bool operator!=(TargetID other) const
+    {
+        return m_key != other.m_key;
+    }
+
+private:
+    quint32 m_key {0};
+};
+
+
+/*! \brief Hash function for TargetID
+ *
+ *  @param targetID Identity
+ *
+ *  @param seed Seed
+ *
+ *  @returns Hash value
+ */
+inline uint qHash(TargetID targetID, uint seed = 0) noexcept
+{
+    return ::qHash(targetID.key(), seed);
+}
+
+}
+
+Q_DECLARE_METATYPE(Traffic::TargetID)
+Q_DECLARE_TYPEINFO(Traffic::TargetID, Q_PRIMITIVE_TYPE);
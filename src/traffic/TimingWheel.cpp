@@ -0,0 +1,145 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "traffic/TimingWheel.h"
+
+
+void Traffic::TimingWheel::Timeout::start(std::chrono::milliseconds delay)
+{
+    // An idle timeout binds to the wheel of the current thread
+    if (!isActive() && (m_expiredIndex < 0)) {
+        m_wheel = TimingWheel::forCurrentThread();
+    }
+    Q_ASSERT(m_wheel == TimingWheel::forCurrentThread());
+
+    m_wheel->unlink(this);
+    m_wheel->link(this, delay);
+}
+
+
+void Traffic::TimingWheel::Timeout::stop()
+{
+    if (m_wheel == nullptr) {
+        return;
+    }
+    m_wheel->unlink(this);
+}
+
+
+auto Traffic::TimingWheel::forCurrentThread() -> TimingWheel*
+{
+    thread_local auto* wheel = new TimingWheel();
+    return wheel;
+}
+
+
+Traffic::TimingWheel::TimingWheel()
+{
+    m_tickTimer.setInterval(tick);
+    m_tickTimer.setTimerType(Qt::CoarseTimer);
+    QObject::connect(&m_tickTimer, &QTimer::timeout, &m_tickTimer, [this]() { advance(); });
+}
+
+
+void Traffic::TimingWheel::link(Timeout* timeout, std::chrono::milliseconds delay)
+{
+    // Number of ticks until expiry. The next tick may come at any time within
+    // the current tick interval, so one tick is added, in order to never fire
+    // early.
+    auto ticks = static_cast<int>(qMax(std::chrono::milliseconds::rep(0), (delay.count()+tick.count()-1)/tick.count()))+1;
+
+    auto slot = (m_currentSlot+ticks) % slotCount;
+    timeout->m_slot = slot;
+    timeout->m_rounds = (ticks-1)/slotCount;
+    timeout->m_previous = nullptr;
+    timeout->m_next = m_slots[slot];
+    if (m_slots[slot] != nullptr) {
+        m_slots[slot]->m_previous = timeout;
+    }
+    m_slots[slot] = timeout;
+
+    m_linkedCount++;
+    if (!m_tickTimer.isActive()) {
+        m_tickTimer.start();
+    }
+}
+
+
+void Traffic::TimingWheel::unlink(Timeout* timeout)
+{
+    if (timeout->m_expiredIndex >= 0) {
+        m_expired[timeout->m_expiredIndex] = nullptr;
+        timeout->m_expiredIndex = -1;
+    }
+    if (timeout->m_slot < 0) {
+        return;
+    }
+
+    if (timeout->m_previous != nullptr) {
+        timeout->m_previous->m_next = timeout->m_next;
+    } else {
+        m_slots[timeout->m_slot] = timeout->m_next;
+    }
+    if (timeout->m_next != nullptr) {
+        timeout->m_next->m_previous = timeout->m_previous;
+    }
+    timeout->m_previous = nullptr;
+    timeout->m_next = nullptr;
+    timeout->m_slot = -1;
+    m_linkedCount--;
+}
+
+
+void Traffic::TimingWheel::advance()
+{
+    m_currentSlot = (m_currentSlot+1) % slotCount;
+
+    // Collect expired timeouts first and call the callbacks afterwards, so
+    // that callbacks can freely start, stop or delete timeouts
+    auto* timeout = m_slots[m_currentSlot];
+    while (timeout != nullptr) {
+        auto* next = timeout->m_next;
+        if (timeout->m_rounds > 0) {
+            timeout->m_rounds--;
+        } else {
+            unlink(timeout);
+            timeout->m_expiredIndex = m_expired.size();
+            m_expired.append(timeout);
+        }
+        timeout = next;
+    }
+
+    for(int i=0; i<m_expired.size(); i++) {
+        auto* expired = m_expired[i];
+        if (expired == nullptr) {
+            continue;
+        }
+        m_expired[i] = nullptr;
+        expired->m_expiredIndex = -1;
+        if (expired->m_callback) {
+            expired->m_callback();
+        }
+    }
+    m_expired.clear();
+
+    if (m_linkedCount == 0) {
+        m_tickTimer.stop();
+    }
+}
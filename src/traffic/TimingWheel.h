@@ -0,0 +1,155 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QTimer>
+#include <QVector>
+#include <array>
+#include <chrono>
+#include <functional>
+
+using namespace std::chrono_literals;
+
+
+namespace Traffic {
+
+/*! \brief Shared timer for many coarse timeouts
+ *
+ *  Traffic factors expire if they are not refreshed, and traffic data sources
+ *  track whether heartbeat and altitude data are recent. These timeouts are
+ *  re-armed with every message that arrives. With one QTimer per timeout,
+ *  every message costs a timer-list operation in the Qt event dispatcher.
+ *
+ *  This class implements a hashed timing wheel instead: an array of slots,
+ *  each holding an intrusive list of timeouts, advanced by a single QTimer
+ *  that ticks every 250 ms. Starting, re-starting and stopping a timeout are
+ *  O(1) list operations that never touch the event dispatcher. Timeouts that
+ *  are longer than one revolution of the wheel carry a round counter. The
+ *  wheel's QTimer only runs while at least one timeout is active.
+ *
+ *  There is one wheel per thread. Timeouts never fire early, but up to one
+ *  tick late, which is irrelevant for lifetimes of several seconds.
+ */
+
+class TimingWheel
+{
+public:
+    /*! \brief Resolution of the wheel */
+    static constexpr auto tick = 250ms;
+
+    /*! \brief Number of slots; one revolution of the wheel takes 16 s */
+    static constexpr int slotCount = 64;
+
+    /*! \brief Single-shot timeout, managed by the wheel of its thread
+     *
+     *  The interface resembles that of a single-shot QTimer. As with QTimer,
+     *  an instance must only be used from one thread. The instance binds to
+     *  the wheel of the thread where it is first started; in order to move it
+     *  to a different thread, stop it first.
+     */
+    class Timeout
+    {
+    public:
+        /*! \brief Constructs an inactive timeout
+         *
+         *  @param callback Function called when the timeout expires, or an
+         *  empty function if nothing needs to be done. Timeouts without
+         *  callback are useful for checking whether data is recent, with
+         *  isActive().
+         */
+        explicit Timeout(std::function<void()> callback = {}) : m_callback(std::move(callback)) {}
+
+        /*! \brief Destructor, stops the timeout */
+        ~Timeout()
+        {
+            stop();
+        }
+
+        /*! \brief Start or re-start the timeout
+         *
+         *  @param delay Time until the timeout expires
+         */
+        void start(std::chrono::milliseconds delay);
+
+        /*! \brief Stop the timeout, if active */
+        void stop();
+
+        /*! \brief Check if the timeout is active
+         *
+         *  @returns True if the timeout has been started and has neither
+         *  expired nor been stopped
+         */
+        bool isActive() const
+        {
+            return m_slot >= 0;
+        }
+
+    private:
+        Q_DISABLE_COPY_MOVE(Timeout)
+        friend class TimingWheel;
+
+        TimingWheel* m_wheel {nullptr};
+        Timeout* m_previous {nullptr};
+        Timeout* m_next {nullptr};
+        int m_slot {-1};
+        int m_rounds {0};
+        int m_expiredIndex {-1};
+        std::function<void()> m_callback;
+    };
+
+    /*! \brief Wheel of the current thread
+     *
+     *  The wheel is created on first use. It must be used from this thread
+     *  only, and it lives until the end of the program.
+     *
+     *  @returns Wheel of the current thread
+     */
+    static TimingWheel* forCurrentThread();
+
+private:
+    Q_DISABLE_COPY_MOVE(TimingWheel)
+
+    TimingWheel();
+    ~TimingWheel() = default;
+
+    // Insert timeout, which must not be linked, into the slot for the delay
+    void link(Timeout* timeout, std::chrono::milliseconds delay);
+
+    // Remove timeout from its slot and from the list of expired timeouts
+    void unlink(Timeout* timeout);
+
+    // Move to the next slot, fire expired timeouts
+    void advance();
+
+    // Heads of the intrusive lists, one for each slot
+    std::array<Timeout*, slotCount> m_slots {};
+    int m_currentSlot {0};
+    int m_linkedCount {0};
+
+    // Timeouts that expired in the current tick and whose callbacks have not
+    // been called yet. Entries are set to nullptr if the timeout is stopped or
+    // re-started by a callback before it is fired.
+    QVector<Timeout*> m_expired;
+
+    QTimer m_tickTimer;
+};
+
+}
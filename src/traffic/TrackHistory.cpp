@@ -0,0 +1,96 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <cmath>
+#include <limits>
+
+#include "traffic/TrackHistory.h"
+
+
+void Traffic::TrackHistory::append(const QGeoCoordinate& coordinate)
+{
+    if (!coordinate.isValid()) {
+        return;
+    }
+    auto latitude = static_cast<qint32>(std::lround(coordinate.latitude()/resolution));
+    auto longitude = static_cast<qint32>(std::lround(coordinate.longitude()/resolution));
+
+    if (m_size > 0) {
+        auto deltaLatitude = latitude-m_lastLatitude;
+        auto deltaLongitude = longitude-m_lastLongitude;
+        if ((deltaLatitude == 0) && (deltaLongitude == 0)) {
+            return;
+        }
+
+        // Restart the history if the delta cannot be stored. This happens if
+        // reports are missing for a long time, or at the date line.
+        constexpr auto maxDelta = std::numeric_limits<qint16>::max();
+        if ((std::abs(deltaLatitude) > maxDelta) || (std::abs(deltaLongitude) > maxDelta)) {
+            m_size = 0;
+        } else {
+            // Remove oldest position if the history is full
+            if (m_size == capacity) {
+                m_begin = (m_begin+1) % capacity;
+                m_firstLatitude += m_latitudeDeltas[m_begin];
+                m_firstLongitude += m_longitudeDeltas[m_begin];
+                m_size--;
+            }
+
+            auto index = (m_begin+m_size) % capacity;
+            m_latitudeDeltas[index] = static_cast<qint16>(deltaLatitude);
+            m_longitudeDeltas[index] = static_cast<qint16>(deltaLongitude);
+            m_size++;
+            m_lastLatitude = latitude;
+            m_lastLongitude = longitude;
+            return;
+        }
+    }
+
+    m_begin = 0;
+    m_size = 1;
+    m_firstLatitude = latitude;
+    m_firstLongitude = longitude;
+    m_lastLatitude = latitude;
+    m_lastLongitude = longitude;
+}
+
+
+auto Traffic::TrackHistory::toGeoPath(int maxSize) const -> QGeoPath
+{
+    auto skipped = qMax(0, m_size-maxSize);
+    QList<QGeoCoordinate> coordinates;
+    coordinates.reserve(m_size-skipped);
+
+    // The positions are stored as differences, so the skipped positions are
+    // decoded, but not returned
+    auto latitude = m_firstLatitude;
+    auto longitude = m_firstLongitude;
+    for(int i=0; i<m_size; i++) {
+        if (i > 0) {
+            auto index = (m_begin+i) % capacity;
+            latitude += m_latitudeDeltas[index];
+            longitude += m_longitudeDeltas[index];
+        }
+        if (i >= skipped) {
+            coordinates << QGeoCoordinate(latitude*resolution, longitude*resolution);
+        }
+    }
+    return QGeoPath(coordinates);
+}
@@ -0,0 +1,100 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QGeoPath>
+#include <array>
+
+
+namespace Traffic {
+
+/*! \brief Short history of the positions of a traffic target
+ *
+ * This class stores the most recent positions of a traffic target in a ring
+ * buffer of fixed capacity. Coordinates are quantized to resolution and
+ * stored as 16-bit differences to the previous position, so that a full
+ * history needs less than 300 bytes and appending a position never
+ * allocates memory. If the difference to the previous position does not fit
+ * into 16 bits, the history is restarted.
+ */
+
+class TrackHistory
+{
+public:
+    /*! \brief Maximal number of positions */
+    static constexpr int capacity = 64;
+
+    /*! \brief Resolution of the stored coordinates, in degrees (about 1m) */
+    static constexpr double resolution = 1e-5;
+
+    /*! \brief Append a position
+     *
+     * If the history is full, the oldest position is removed. Invalid
+     * coordinates, and coordinates that equal the latest position after
+     * quantization, are ignored.
+     *
+     * @param coordinate Position to append
+     */
+    void append(const QGeoCoordinate& coordinate);
+
+    /*! \brief Remove all positions */
+    void clear()
+    {
+        m_size = 0;
+    }
+
+    /*! \brief Number of positions
+     *
+     * @returns Number of positions in the history
+     */
+    int size() const
+    {
+        return m_size;
+    }
+
+    /*! \brief Positions, as a path
+     *
+     * @param maxSize Maximal number of positions. If the history holds more
+     * positions, only the latest ones are returned.
+     *
+     * @returns Path from the oldest to the latest position, suitable for use
+     * as the path of a MapPolyline
+     */
+    QGeoPath toGeoPath(int maxSize=capacity) const;
+
+private:
+    // Coordinate differences to the previous position, in units of
+    // resolution. The entries of the oldest position are not used.
+    std::array<qint16, capacity> m_latitudeDeltas {};
+    std::array<qint16, capacity> m_longitudeDeltas {};
+
+    // Oldest and latest position, in units of resolution
+    qint32 m_firstLatitude {0};
+    qint32 m_firstLongitude {0};
+    qint32 m_lastLatitude {0};
+    qint32 m_lastLongitude {0};
+
+    // Index of the oldest position, and number of positions
+    int m_begin {0};
+    int m_size {0};
+};
+
+};
@@ -19,31 +19,59 @@
  ***************************************************************************/
 
 #include <QApplication>
+#include <QDebug>
 #include <QQmlEngine>
+#include <QRandomGenerator>
+#include <QSettings>
 #include <chrono>
+#include <limits>
 
 #include "GlobalObject.h"
+#include "Metrics.h"
 #include "MobileAdaptor.h"
+#include "Profiler.h"
+#include "Settings.h"
+#include "Tracer.h"
+#include "positioning/PositionProvider.h"
+#include "traffic/FlarmnetDB.h"
+#include "traffic/PasswordDB.h"
 #include "traffic/TrafficDataProvider.h"
 #include "traffic/TrafficDataSource_File.h"
 #include "traffic/TrafficDataSource_Tcp.h"
 #include "traffic/TrafficDataSource_Udp.h"
+#include "ui/RenderBudget.h"
 
 using namespace std::chrono_literals;
 
 
 // Member functions
 
-Traffic::TrafficDataProvider::TrafficDataProvider(QObject *parent) : Positioning::PositionInfoSource_Abstract(parent) {
+auto Traffic::TrafficDataProvider::PriorityKey::operator<(const PriorityKey& rhs) const -> bool
+{
+    // Invalid objects have lowest priority
+    if (valid != rhs.valid) {
+        return !valid;
+    }
 
-    // Create traffic objects
-    int numTrafficObjects = 20;
-    m_trafficObjects.reserve(numTrafficObjects);
-    for(int i = 0; i<numTrafficObjects; i++) {
-        auto *trafficObject = new Traffic::TrafficFactor_WithPosition(this);
-        QQmlEngine::setObjectOwnership(trafficObject, QQmlEngine::CppOwnership);
-        m_trafficObjects.append( trafficObject );
+    // Then objects of lower alarm level
+    if (alarmLevel != rhs.alarmLevel) {
+        return alarmLevel < rhs.alarmLevel;
+    }
+
+    // Then objects that are farther away
+    if (hDistInM != rhs.hDistInM) {
+        return hDistInM > rhs.hDistInM;
     }
+
+    return object < rhs.object;
+}
+
+
+Traffic::TrafficDataProvider::TrafficDataProvider(QObject *parent) : Positioning::PositionInfoSource_Abstract(parent) {
+
+    // Create traffic objects. The number is adjusted to the settings in
+    // deferredInitialization().
+    setMaxTrafficObjects(20);
     m_trafficObjectWithoutPosition = new Traffic::TrafficFactor_DistanceOnly(this);
     QQmlEngine::setObjectOwnership(m_trafficObjectWithoutPosition, QQmlEngine::CppOwnership);
 
@@ -54,11 +82,43 @@ Traffic::TrafficDataProvider::TrafficDataProvider(QObject *parent) : Positioning
     m_WarningTimer.setSingleShot(true);
     connect(&m_WarningTimer, &QTimer::timeout, this, &Traffic::TrafficDataProvider::resetWarning);
 
+    // Setup coalescing of traffic reports
+    m_flushTimer.setInterval(updateInterval);
+    m_flushTimer.setSingleShot(true);
+    connect(&m_flushTimer, &QTimer::timeout, this, &Traffic::TrafficDataProvider::flushPendingFactors);
+    m_fusionClock.start();
+
     // Setup ForeFlight Broadcases
     foreFlightBroadcastTimer.setInterval(5s);
     connect(&foreFlightBroadcastTimer, &QTimer::timeout, this, &Traffic::TrafficDataProvider::foreFlightBroadcast);
     foreFlightBroadcastTimer.start();
 
+    // Setup GDL90 output, which runs only while clients are registered
+    m_gdl90Timer.setInterval(1s);
+    connect(&m_gdl90Timer, &QTimer::timeout, this, [this]() {
+        m_gdl90Server.broadcast(GlobalObject::positionProvider()->positionInfo(), pressureAltitude(), m_trafficObjects);
+    });
+    auto updateGDL90Timer = [this]() {
+        if (m_gdl90Server.hasClients()) {
+            m_gdl90Timer.start();
+        } else {
+            m_gdl90Timer.stop();
+        }
+    };
+    connect(&m_gdl90Server, &Traffic::GDL90Server::clientsChanged, this, updateGDL90Timer);
+    updateGDL90Timer();
+
+    // Start thread for the traffic data sources
+    m_trafficThread.setObjectName("Traffic data sources");
+    Profiler::watchThread(&m_trafficThread);
+    m_trafficThread.start();
+
+    // Conflict prediction
+    m_conflictPredictor = new Traffic::ConflictPredictor();
+    m_conflictPredictor->moveToThread(&m_trafficThread);
+    connect(&m_trafficThread, &QThread::finished, m_conflictPredictor, &QObject::deleteLater);
+    connect(m_conflictPredictor, &Traffic::ConflictPredictor::conflictsPredicted, this, &Traffic::TrafficDataProvider::onConflictsPredicted);
+
     // Real data sources in order of preference, preferred sources first
     addDataSource( new Traffic::TrafficDataSource_Tcp("192.168.1.1", 2000, this));
     addDataSource( new Traffic::TrafficDataSource_Tcp("192.168.10.1", 2000, this) );
@@ -70,68 +130,184 @@ Traffic::TrafficDataProvider::TrafficDataProvider(QObject *parent) : Positioning
     connect(this, &Traffic::TrafficDataProvider::pressureAltitudeChanged, this, &Traffic::TrafficDataProvider::updateStatusString);
     connect(this, &Traffic::TrafficDataProvider::receivingHeartbeatChanged, this, &Traffic::TrafficDataProvider::updateStatusString);
 
-    // Connect timer. Try to (re)connect after 2s, and then again every five minutes.
+    // Connect timer. Try to (re)connect after 2s, and then again whenever the
+    // back-off of a source expires.
     QTimer::singleShot(2s, this, &Traffic::TrafficDataProvider::connectToTrafficReceiver);
-    connect(&reconnectionTimer, &QTimer::timeout, this, &Traffic::TrafficDataProvider::connectToTrafficReceiver);
-    reconnectionTimer.setInterval(5min);
-    reconnectionTimer.setSingleShot(false);
-    reconnectionTimer.start();
+    connect(&reconnectionTimer, &QTimer::timeout, this, &Traffic::TrafficDataProvider::reconnect);
+    reconnectionTimer.setSingleShot(true);
 
     // Try to (re)connect whenever the network situation changes
     QTimer::singleShot(0, this, &Traffic::TrafficDataProvider::deferredInitialization);
 
     // Clean up
-    connect(qApp, &QApplication::aboutToQuit, this, &Traffic::TrafficDataProvider::clearDataSources);
+    connect(qApp, &QApplication::aboutToQuit, this, &Traffic::TrafficDataProvider::shutDown);
+}
+
+
+Traffic::TrafficDataProvider::~TrafficDataProvider()
+{
+    shutDown();
 }
 
 
 void Traffic::TrafficDataProvider::clearDataSources()
 {
+    stopRecording();
     foreach(auto dataSource, m_dataSources) {
         if (dataSource.isNull()) {
             continue;
         }
         dataSource->disconnect();
-        delete dataSource;
+
+        // Sources in the traffic thread are deleted there
+        if (dataSource->thread() == &m_trafficThread) {
+            dataSource->deleteLater();
+        } else {
+            delete dataSource;
+        }
     }
     m_dataSources.clear();
+    m_sourceStatus.clear();
+    m_fusedTargets.clear();
+    m_currentSource = nullptr;
+}
+
+
+void Traffic::TrafficDataProvider::shutDown()
+{
+    clearDataSources();
+
+    // Pending deletions in the traffic thread are carried out when the
+    // thread finishes
+    m_trafficThread.quit();
+    m_trafficThread.wait();
 }
 
 
-void Traffic::TrafficDataProvider::addDataSource(Traffic::TrafficDataSource_Abstract* source)
+void Traffic::TrafficDataProvider::addDataSource(Traffic::TrafficDataSource_Abstract* source, bool moveToTrafficThread)
 {
 
     Q_ASSERT( source != nullptr );
 
-    source->setParent(this);
+    // Cache the status of the source, which cannot be read anymore once the
+    // source lives in the traffic thread
+    SourceStatus status;
+    status.sourceName = source->sourceName();
+    status.connectivityStatus = source->connectivityStatus();
+    status.errorString = source->errorString();
+    status.receivingHeartbeat = source->receivingHeartbeat();
+    status.trafficReceiverRuntimeError = source->trafficReceiverRuntimeError();
+    status.trafficReceiverSelfTestError = source->trafficReceiverSelfTestError();
+    m_sourceStatus.insert(source, status);
+
+    source->setRecorder(m_recorder);
+    if (moveToTrafficThread) {
+        source->setParent(nullptr);
+        source->moveToThread(&m_trafficThread);
+        connect(&m_trafficThread, &QThread::finished, source, &QObject::deleteLater);
+    } else {
+        source->setParent(this);
+    }
     m_dataSources << source;
-    connect(source, &Traffic::TrafficDataSource_Abstract::connectivityStatusChanged, this, &Traffic::TrafficDataProvider::updateStatusString);
-    connect(source, &Traffic::TrafficDataSource_Abstract::errorStringChanged, this, &Traffic::TrafficDataProvider::updateStatusString);
-    connect(source, &Traffic::TrafficDataSource_Abstract::passwordRequest, this, &Traffic::TrafficDataProvider::passwordRequest);
-    connect(source, &Traffic::TrafficDataSource_Abstract::passwordStorageRequest, this, &Traffic::TrafficDataProvider::passwordStorageRequest);
-    connect(source, &Traffic::TrafficDataSource_Abstract::receivingHeartbeatChanged, this, &Traffic::TrafficDataProvider::updateStatusString);
-    connect(source, &Traffic::TrafficDataSource_Abstract::receivingHeartbeatChanged, this, &Traffic::TrafficDataProvider::onSourceHeartbeatChanged);
-    connect(source, &Traffic::TrafficDataSource_Abstract::trafficReceiverRuntimeErrorChanged, this, &Traffic::TrafficDataProvider::onTrafficReceiverRuntimeError);
-    connect(source, &Traffic::TrafficDataSource_Abstract::trafficReceiverSelfTestErrorChanged, this, &Traffic::TrafficDataProvider::onTrafficReceiverSelfTestError);
+
+    // Status
+    connect(source, &Traffic::TrafficDataSource_Abstract::connectivityStatusChanged, this, [this, source](const QString& newStatus) {
+        m_sourceStatus[source].connectivityStatus = newStatus;
+        updateStatusString();
+    });
+    connect(source, &Traffic::TrafficDataSource_Abstract::errorStringChanged, this, [this, source](const QString& newError) {
+        m_sourceStatus[source].errorString = newError;
+        updateStatusString();
+    });
+    connect(source, &Traffic::TrafficDataSource_Abstract::receivingHeartbeatChanged, this, [this, source](bool newHeartbeat) {
+        auto& status = m_sourceStatus[source];
+        status.receivingHeartbeat = newHeartbeat;
+
+        // A source that receives a heartbeat is remembered for the current
+        // Wi-Fi network. A source that loses its heartbeat is retried soon.
+        status.failedAttempts = 0;
+        status.nextAttempt = QDeadlineTimer(0);
+        if (newHeartbeat) {
+            QSettings settings;
+            auto sourcesBySSID = settings.value(QStringLiteral("TrafficDataProvider/sourcesBySSID")).toMap();
+            sourcesBySSID.insert(MobileAdaptor::getSSID(), status.sourceName);
+            settings.setValue(QStringLiteral("TrafficDataProvider/sourcesBySSID"), sourcesBySSID);
+        } else {
+            reconnectionTimer.start(1s);
+        }
+        updateStatusString();
+        onSourceHeartbeatChanged();
+    });
+    connect(source, &Traffic::TrafficDataSource_Abstract::trafficReceiverRuntimeErrorChanged, this, [this, source](const QString& message) {
+        m_sourceStatus[source].trafficReceiverRuntimeError = message;
+        onTrafficReceiverRuntimeError(message);
+    });
+    connect(source, &Traffic::TrafficDataSource_Abstract::trafficReceiverSelfTestErrorChanged, this, [this, source](const QString& message) {
+        m_sourceStatus[source].trafficReceiverSelfTestError = message;
+        onTrafficReceiverSelfTestError(message);
+    });
+
+    // Passwords
+    connect(source, &Traffic::TrafficDataSource_Abstract::passwordRequest, this, [this, source](const QString& SSID) {
+        auto* passwordDB = GlobalObject::passwordDB();
+        if (!passwordDB->contains(SSID)) {
+            emit passwordRequest(SSID);
+            return;
+        }
+        auto password = passwordDB->getPassword(SSID);
+        QMetaObject::invokeMethod(source, [source, SSID, password]() { source->setPassword(SSID, password); });
+    });
+    connect(source, &Traffic::TrafficDataSource_Abstract::passwordStorageRequest, this, [this](const QString& SSID, const QString& password) {
+        auto* passwordDB = GlobalObject::passwordDB();
+        if (!passwordDB->contains(SSID) || (passwordDB->getPassword(SSID) != password)) {
+            emit passwordStorageRequest(SSID, password);
+        }
+    });
+    connect(source, &Traffic::TrafficDataSource_Abstract::passwordRejected, this, [](const QString& SSID) {
+        GlobalObject::passwordDB()->removePassword(SSID);
+    });
+
+    // Traffic data
+    connect(source, &Traffic::TrafficDataSource_Abstract::reportsAvailable, this, [this, source]() { processReports(source); });
 
 }
 
 
 void Traffic::TrafficDataProvider::connectToTrafficReceiver()
 {
-    foreach(auto dataSource, m_dataSources) {
-        if (dataSource.isNull()) {
-            continue;
-        }
-        dataSource->connectToTrafficReceiver();
+    // Start afresh, giving the source that last worked on this network a
+    // head start
+    auto* preferred = preferredSource();
+    for(auto it = m_sourceStatus.begin(); it != m_sourceStatus.end(); ++it) {
+        it->failedAttempts = 0;
+        it->nextAttempt = ((preferred == nullptr) || (it.key() == preferred)) ? QDeadlineTimer(0) : QDeadlineTimer(preferredSourceHeadStart);
     }
+    reconnect();
 }
 
 
-void Traffic::TrafficDataProvider::deferredInitialization() const
+void Traffic::TrafficDataProvider::deferredInitialization()
 {
+    TRACE_SCOPE("TrafficDataProvider::deferredInitialization");
     // Try to (re)connect whenever the network situation changes
     connect(GlobalObject::mobileAdaptor(), &MobileAdaptor::wifiConnected, this, &Traffic::TrafficDataProvider::connectToTrafficReceiver);
+
+    // Number of traffic objects
+    setMaxTrafficObjects(GlobalObject::settings()->maxTrafficObjects());
+    connect(GlobalObject::settings(), &Settings::maxTrafficObjectsChanged, this, [this]() {
+        setMaxTrafficObjects(GlobalObject::settings()->maxTrafficObjects());
+    });
+
+    // Shorter trails while frames are slow
+    connect(GlobalObject::renderBudget(), &Ui::RenderBudget::detailLevelChanged, this, [this]() {
+        auto trailLength = GlobalObject::renderBudget()->trailLength();
+        for(auto* trafficObject : qAsConst(m_trafficObjects)) {
+            trafficObject->setTrailLength(trailLength);
+        }
+    });
+
+    // Fill in call signs that were not known when the traffic was reported
+    connect(GlobalObject::flarmnetDB(), &Traffic::FlarmnetDB::registrationFound, this, &Traffic::TrafficDataProvider::onRegistrationFound);
 }
 
 
@@ -141,7 +317,7 @@ void Traffic::TrafficDataProvider::disconnectFromTrafficReceiver()
         if (dataSource.isNull()) {
             continue;
         }
-        dataSource->disconnectFromTrafficReceiver();
+        QMetaObject::invokeMethod(dataSource, &Traffic::TrafficDataSource_Abstract::disconnectFromTrafficReceiver);
     }
 }
 
@@ -152,11 +328,43 @@ void Traffic::TrafficDataProvider::foreFlightBroadcast()
 }
 
 
+void Traffic::TrafficDataProvider::onConflictsPredicted(const QVector<Traffic::ConflictPrediction>& conflicts, const Traffic::Warning& warning)
+{
+    m_predictedAlarmLevels.clear();
+    foreach(auto conflict, conflicts) {
+        m_predictedAlarmLevels.insert(conflict.ID, conflict.alarmLevel);
+
+        // Raise the alarm level of the traffic object right away. It is
+        // recomputed with the next report of the traffic.
+        auto* target = m_trafficObjectsByID.value(conflict.ID, nullptr);
+        if ((target != nullptr) && target->valid() && (target->alarmLevel() < conflict.alarmLevel)) {
+            target->setAlarmLevel(conflict.alarmLevel);
+            updateTrafficObjectIndex(target);
+        }
+    }
+
+    m_predictedWarning = warning;
+    updateWarning();
+}
+
+
+void Traffic::TrafficDataProvider::onRegistrationFound(Traffic::TargetID ID, const QString& registration)
+{
+    auto* target = m_trafficObjectsByID.value(ID, nullptr);
+    if ((target != nullptr) && target->callSign().isEmpty()) {
+        target->setCallSign(registration);
+    }
+    if ((m_trafficObjectWithoutPosition->ID() == ID) && m_trafficObjectWithoutPosition->callSign().isEmpty()) {
+        m_trafficObjectWithoutPosition->setCallSign(registration);
+    }
+}
+
+
 void Traffic::TrafficDataProvider::onSourceHeartbeatChanged()
 {
     // If we have a current source, if the current source has a heartbeat and if the current source is a TCP source, then we simply stick with it.
     if ((qobject_cast<Traffic::TrafficDataSource_Tcp*>(m_currentSource) != nullptr)
-            && m_currentSource->receivingHeartbeat() ) {
+            && m_sourceStatus.value(m_currentSource).receivingHeartbeat ) {
         emit setReceivingHeartbeat(true);
         return;
     }
@@ -168,7 +376,7 @@ void Traffic::TrafficDataProvider::onSourceHeartbeatChanged()
             continue;
         }
 
-        if (source->receivingHeartbeat()) {
+        if (m_sourceStatus.value(source).receivingHeartbeat) {
             heartbeatDataSource = source;
             break;
         }
@@ -180,43 +388,19 @@ void Traffic::TrafficDataProvider::onSourceHeartbeatChanged()
         // Disconnect old m_currentSource
         if (!m_currentSource.isNull()) {
             disconnect(m_currentSource, &Traffic::TrafficDataSource_Abstract::pressureAltitudeUpdated, this, &Traffic::TrafficDataProvider::setPressureAltitude);
-            disconnect(m_currentSource, &Traffic::TrafficDataSource_Abstract::factorWithoutPosition, this, &Traffic::TrafficDataProvider::onTrafficFactorWithoutPosition);
-            disconnect(m_currentSource, &Traffic::TrafficDataSource_Abstract::factorWithPosition, this, &Traffic::TrafficDataProvider::onTrafficFactorWithPosition);
             disconnect(m_currentSource, &Traffic::TrafficDataSource_Abstract::positionUpdated, this, &Traffic::TrafficDataProvider::setPositionInfo);
-            disconnect(m_currentSource, &Traffic::TrafficDataSource_Abstract::warning, this, &Traffic::TrafficDataProvider::setWarning);
         }
 
-        // Update m_currentsource
+        // Update m_currentsource. Sources of lower priority stay connected,
+        // because their traffic is fused with the traffic of the current
+        // source.
         m_currentSource = heartbeatDataSource;
 
+        // If there is a new m_currentSource, then setup Qt connections. Sources
+        // that have lost their heartbeat are retried by reconnect().
         if (!m_currentSource.isNull()) {
-            // If there is a new m_currentSource, then setup Qt connections and
-            // disconnect all sources of lower priority from the traffic receivers.
             connect(m_currentSource, &Traffic::TrafficDataSource_Abstract::pressureAltitudeUpdated, this, &Traffic::TrafficDataProvider::setPressureAltitude);
-            connect(m_currentSource, &Traffic::TrafficDataSource_Abstract::factorWithoutPosition, this, &Traffic::TrafficDataProvider::onTrafficFactorWithoutPosition);
-            connect(m_currentSource, &Traffic::TrafficDataSource_Abstract::factorWithPosition, this, &Traffic::TrafficDataProvider::onTrafficFactorWithPosition);
             connect(m_currentSource, &Traffic::TrafficDataSource_Abstract::positionUpdated, this, &Traffic::TrafficDataProvider::setPositionInfo);
-            connect(m_currentSource, &Traffic::TrafficDataSource_Abstract::warning, this, &Traffic::TrafficDataProvider::setWarning);
-
-            // Disconnect from traffic receiver
-            bool doDisconnect = false;
-            foreach(auto source, m_dataSources) {
-                if ( source.isNull() ) {
-                    continue;
-                }
-                if (source == m_currentSource) {
-                    doDisconnect = true;
-                    continue;
-                }
-                if (doDisconnect) {
-                    source->disconnectFromTrafficReceiver();
-                }
-            }
-
-        } else {
-            // If there is no m_currentSource, then try in 1sek to (re)connect to any
-            // traffic receiver out there.
-            QTimer::singleShot(1s, this, &Traffic::TrafficDataProvider::connectToTrafficReceiver);
         }
 
 
@@ -226,7 +410,7 @@ void Traffic::TrafficDataProvider::onSourceHeartbeatChanged()
     if (m_currentSource.isNull()) {
         setReceivingHeartbeat(false);
     } else {
-        setReceivingHeartbeat(m_currentSource->receivingHeartbeat());
+        setReceivingHeartbeat(m_sourceStatus.value(m_currentSource).receivingHeartbeat);
     }
 }
 
@@ -263,19 +447,21 @@ void Traffic::TrafficDataProvider::onTrafficFactorWithPosition(const Traffic::Tr
 
 
     // Check if the traffic is one of the known factors.
-    foreach(auto target, m_trafficObjects) {
-        if (factor.ID() == target->ID()) {
-            // If traffic is too far away, delete the entry. Otherwise, replace the entry by the factor.
-            if (farAway) {
-                target->setAnimate(false);
-                target->copyFrom(TrafficFactor_WithPosition());
-            } else {
-                target->setAnimate(true);
-                target->copyFrom(factor);
-                target->startLiveTime();
-            }
-            return;
+    auto* target = m_trafficObjectsByID.value(factor.ID(), nullptr);
+    if (target != nullptr) {
+        // If traffic is too far away, delete the entry. Otherwise, replace the entry by the factor.
+        if (farAway) {
+            target->setAnimate(false);
+            target->copyFrom(TrafficFactor_WithPosition());
+            updateTrackHistory(target, true);
+        } else {
+            target->setAnimate(true);
+            target->copyFrom(factor);
+            target->startLiveTime();
+            updateTrackHistory(target, false);
         }
+        updateTrafficObjectIndex(target);
+        return;
     }
 
     // If traffic is too far away, ignore the factor.
@@ -283,16 +469,16 @@ void Traffic::TrafficDataProvider::onTrafficFactorWithPosition(const Traffic::Tr
         return;
     }
 
-    auto *lowestPriObject = m_trafficObjects.at(0);
-    foreach(auto target, m_trafficObjects) {
-        if (lowestPriObject->hasHigherPriorityThan(*target)) {
-            lowestPriObject = target;
-        }
+    if (m_trafficObjectsByPriority.empty()) {
+        return;
     }
+    auto *lowestPriObject = m_trafficObjectsByPriority.begin()->object;
     if (factor.hasHigherPriorityThan(*lowestPriObject)) {
         lowestPriObject->setAnimate(false);
         lowestPriObject->copyFrom(factor);
         lowestPriObject->startLiveTime();
+        updateTrackHistory(lowestPriObject, true);
+        updateTrafficObjectIndex(lowestPriObject);
     }
 
 }
@@ -307,7 +493,7 @@ void Traffic::TrafficDataProvider::onTrafficReceiverRuntimeError(const QString&
         if (dataSource.isNull()) {
             continue;
         }
-        result = dataSource->trafficReceiverRuntimeError();
+        result = m_sourceStatus.value(dataSource).trafficReceiverRuntimeError;
         if (!result.isEmpty()) {
             break;
         }
@@ -330,7 +516,7 @@ void Traffic::TrafficDataProvider::onTrafficReceiverSelfTestError(const QString&
         if (dataSource.isNull()) {
             continue;
         }
-        result = dataSource->trafficReceiverSelfTestError();
+        result = m_sourceStatus.value(dataSource).trafficReceiverSelfTestError;
         if (!result.isEmpty()) {
             break;
         }
@@ -344,9 +530,283 @@ void Traffic::TrafficDataProvider::onTrafficReceiverSelfTestError(const QString&
 }
 
 
+auto Traffic::TrafficDataProvider::acceptReport(Traffic::TrafficDataSource_Abstract* source, Traffic::TargetID ID) -> bool
+{
+    // Reports without ID cannot be fused; they are used if they come from the
+    // current source
+    if (!ID.isValid()) {
+        return source == m_currentSource;
+    }
+
+    auto now = m_fusionClock.elapsed();
+    auto fusedTarget = m_fusedTargets.find(ID);
+    if (fusedTarget == m_fusedTargets.end()) {
+        m_fusedTargets.insert(ID, {source, now});
+        return true;
+    }
+
+    // Take over the target if the source is the one that already follows the
+    // target, if the target has not been updated for a while, or if the source
+    // has higher priority. Sources are listed in order of priority.
+    if ((fusedTarget->source != source)
+            && (now-fusedTarget->lastUpdate < sourceHoldTime.count())
+            && (m_dataSources.indexOf(source) > m_dataSources.indexOf(fusedTarget->source))) {
+        return false;
+    }
+    fusedTarget->source = source;
+    fusedTarget->lastUpdate = now;
+    return true;
+}
+
+
+void Traffic::TrafficDataProvider::processReports(Traffic::TrafficDataSource_Abstract* source)
+{
+    // Sources removed by clearDataSources() may have notified us before
+    // their removal
+    if (!m_sourceStatus.contains(source)) {
+        return;
+    }
+
+    // Reports of sources that do not receive heartbeat are discarded
+    bool isLive = m_sourceStatus.value(source).receivingHeartbeat;
+
+    Traffic::TrafficReport report;
+    while (source->takeReport(report)) {
+        if (!isLive) {
+            continue;
+        }
+
+        switch(report.kind) {
+        case Traffic::TrafficReport::FactorWithPosition:
+            if (acceptReport(source, report.ID)) {
+                m_pendingFactors.insert(report.ID, report);
+            }
+            break;
+        case Traffic::TrafficReport::FactorWithoutPosition:
+            if (acceptReport(source, report.ID)) {
+                m_pendingFactorsDistanceOnly.insert(report.ID, report);
+            }
+            break;
+        case Traffic::TrafficReport::TrafficWarning:
+            // Warnings are taken from the current source only
+            if (source != m_currentSource) {
+                break;
+            }
+            m_reportedWarning = report.warning;
+            if (m_reportedWarning.alarmLevel() > -1) {
+                m_WarningTimer.start();
+            }
+            updateWarning();
+            break;
+        }
+    }
+
+    if (!m_flushTimer.isActive() && (!m_pendingFactors.isEmpty() || !m_pendingFactorsDistanceOnly.isEmpty())) {
+        m_flushTimer.start();
+    }
+}
+
+
+void Traffic::TrafficDataProvider::flushPendingFactors()
+{
+    // Latency between decoding and the traffic factors. Remember the
+    // earliest reception time, until the data is on screen.
+    static auto* providerLatencyMetric = Metrics::histogram(QStringLiteral("traffic/latency/provider"));
+    auto flushedAt = Metrics::now();
+    auto recordLatency = [&](const Traffic::TrafficReport& report) {
+        providerLatencyMetric->record((flushedAt-report.decodedAt)/1000);
+        if ((m_undisplayedReceivedAt == 0) || (report.receivedAt < m_undisplayedReceivedAt)) {
+            m_undisplayedReceivedAt = report.receivedAt;
+        }
+    };
+    for(const auto& report : qAsConst(m_pendingFactors)) {
+        recordLatency(report);
+    }
+    for(const auto& report : qAsConst(m_pendingFactorsDistanceOnly)) {
+        recordLatency(report);
+    }
+    if ((m_undisplayedFlushedAt == 0) && (m_undisplayedReceivedAt != 0)) {
+        m_undisplayedFlushedAt = flushedAt;
+    }
+
+    // Find the window that shows the traffic. This is done here, because the
+    // window does not yet exist when this object is constructed.
+    if (m_window.isNull()) {
+        foreach(auto* window, QGuiApplication::topLevelWindows()) {
+            auto* quickWindow = qobject_cast<QQuickWindow*>(window);
+            if (quickWindow != nullptr) {
+                m_window = quickWindow;
+                connect(quickWindow, &QQuickWindow::frameSwapped, this, &Traffic::TrafficDataProvider::onFrameSwapped);
+                break;
+            }
+        }
+    }
+
+    // Feed conflict prediction
+    if (!m_pendingFactors.isEmpty() && !m_conflictPredictor.isNull()) {
+        auto ownship = GlobalObject::positionProvider()->positionInfo();
+        auto reports = m_pendingFactors.values().toVector();
+        auto* predictor = m_conflictPredictor.data();
+        QMetaObject::invokeMethod(predictor, [predictor, ownship, reports]() { predictor->addReports(ownship, reports); });
+    }
+
+    // Call signs are looked up only here, once per target and flush. Call
+    // signs that are not yet known are set in onRegistrationFound().
+    auto* flarmnetDB = GlobalObject::flarmnetDB();
+    for(auto& report : m_pendingFactors) {
+        if (report.callSign.isEmpty()) {
+            report.callSign = flarmnetDB->getRegistrationAsync(report.ID);
+        }
+        report.alarmLevel = qMax(report.alarmLevel, m_predictedAlarmLevels.value(report.ID, 0));
+        report.copyTo(m_incomingFactor);
+        onTrafficFactorWithPosition(m_incomingFactor);
+    }
+    m_pendingFactors.clear();
+
+    for(auto& report : m_pendingFactorsDistanceOnly) {
+        if (report.callSign.isEmpty()) {
+            report.callSign = flarmnetDB->getRegistrationAsync(report.ID);
+        }
+        report.copyTo(m_incomingFactorDistanceOnly);
+        onTrafficFactorWithoutPosition(m_incomingFactorDistanceOnly);
+    }
+    m_pendingFactorsDistanceOnly.clear();
+
+    // Forget targets that have not been updated for a while
+    auto now = m_fusionClock.elapsed();
+    for(auto it = m_fusedTargets.begin(); it != m_fusedTargets.end(); ) {
+        if (now-it->lastUpdate > sourceHoldTime.count()) {
+            it = m_fusedTargets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+
+void Traffic::TrafficDataProvider::onFrameSwapped()
+{
+    if (m_undisplayedFlushedAt == 0) {
+        return;
+    }
+
+    static auto* displayLatencyMetric = Metrics::histogram(QStringLiteral("traffic/latency/display"));
+    static auto* totalLatencyMetric = Metrics::histogram(QStringLiteral("traffic/latency/total"));
+    static auto* slowFramesMetric = Metrics::counter(QStringLiteral("traffic/latency/slowFrames"));
+
+    auto displayedAt = Metrics::now();
+    auto totalLatency = displayedAt-m_undisplayedReceivedAt;
+    displayLatencyMetric->record((displayedAt-m_undisplayedFlushedAt)/1000);
+    totalLatencyMetric->record(totalLatency/1000);
+    if (totalLatency > std::chrono::nanoseconds(latencyThreshold).count()) {
+        slowFramesMetric->add();
+    }
+
+    m_undisplayedReceivedAt = 0;
+    m_undisplayedFlushedAt = 0;
+}
+
+
+auto Traffic::TrafficDataProvider::preferredSource() const -> Traffic::TrafficDataSource_Abstract*
+{
+    QSettings settings;
+    auto sourceName = settings.value(QStringLiteral("TrafficDataProvider/sourcesBySSID")).toMap().value(MobileAdaptor::getSSID()).toString();
+    if (sourceName.isEmpty()) {
+        return nullptr;
+    }
+    foreach(auto source, m_dataSources) {
+        if (!source.isNull() && (m_sourceStatus.value(source).sourceName == sourceName)) {
+            return source;
+        }
+    }
+    return nullptr;
+}
+
+
+void Traffic::TrafficDataProvider::reconnect()
+{
+    qint64 nextAttemptMS = -1;
+    foreach(auto dataSource, m_dataSources) {
+        if (dataSource.isNull()) {
+            continue;
+        }
+        auto& status = m_sourceStatus[dataSource];
+        if (status.receivingHeartbeat) {
+            continue;
+        }
+        if (status.nextAttempt.hasExpired()) {
+            QMetaObject::invokeMethod(dataSource, &Traffic::TrafficDataSource_Abstract::connectToTrafficReceiver);
+
+            // The attempt counts as failed until the source reports a heartbeat
+            status.failedAttempts++;
+            auto delayMS = qMin(initialReconnectionDelay.count() << qMin(status.failedAttempts-1, 16), maxReconnectionDelay.count());
+            status.nextAttempt = QDeadlineTimer(qRound64(delayMS*(0.75+QRandomGenerator::global()->bounded(0.5))));
+        }
+        auto remainingMS = status.nextAttempt.remainingTime();
+        if ((nextAttemptMS < 0) || (remainingMS < nextAttemptMS)) {
+            nextAttemptMS = remainingMS;
+        }
+    }
+
+    if (nextAttemptMS < 0) {
+        reconnectionTimer.stop();
+    } else {
+        reconnectionTimer.start(static_cast<int>(nextAttemptMS));
+    }
+}
+
+
 void Traffic::TrafficDataProvider::resetWarning()
 {
-    setWarning( Traffic::Warning() );
+    m_reportedWarning = Traffic::Warning();
+    updateWarning();
+}
+
+
+void Traffic::TrafficDataProvider::setMaxTrafficObjects(int maxTrafficObjects)
+{
+    maxTrafficObjects = qMax(maxTrafficObjects, 1);
+    if (maxTrafficObjects == m_trafficObjects.size()) {
+        return;
+    }
+
+    // Create new traffic objects
+    QList<Traffic::TrafficFactor_WithPosition*> deletedObjects;
+    while (m_trafficObjects.size() < maxTrafficObjects) {
+        auto *trafficObject = new Traffic::TrafficFactor_WithPosition(this);
+        QQmlEngine::setObjectOwnership(trafficObject, QQmlEngine::CppOwnership);
+        m_trafficObjects.append( trafficObject );
+        trafficObject->setTrackHistory(&m_trackHistories[trafficObject]);
+        trafficObject->setTrailLength(GlobalObject::renderBudget()->trailLength());
+
+        // Traffic objects become invalid when their lifetime expires
+        connect(trafficObject, &Traffic::TrafficFactor_Abstract::validChanged, this, [this, trafficObject]() {
+            updateTrafficObjectIndex(trafficObject);
+        });
+        updateTrafficObjectIndex(trafficObject);
+    }
+
+    // Delete traffic objects of lowest priority
+    while (m_trafficObjects.size() > maxTrafficObjects) {
+        auto key = *m_trafficObjectsByPriority.begin();
+        m_trafficObjectsByPriority.erase(m_trafficObjectsByPriority.begin());
+        m_trafficObjectPriorityKeys.remove(key.object);
+        if (m_trafficObjectsByID.value(key.ID) == key.object) {
+            m_trafficObjectsByID.remove(key.ID);
+        }
+        m_trafficObjects.removeOne(key.object);
+        key.object->disconnect(this);
+        key.object->setTrackHistory(nullptr);
+        m_trackHistories.erase(key.object);
+        deletedObjects << key.object;
+    }
+
+    emit trafficObjects4QMLChanged();
+
+    // Objects are deleted only after QML has been told that they are gone
+    foreach(auto* deletedObject, deletedObjects) {
+        deletedObject->deleteLater();
+    }
 }
 
 
@@ -356,7 +816,7 @@ void Traffic::TrafficDataProvider::setPassword(const QString& SSID, const QStrin
         if (dataSource.isNull()) {
             continue;
         }
-        dataSource->setPassword(SSID, password);
+        QMetaObject::invokeMethod(dataSource, [dataSource, SSID, password]() { dataSource->setPassword(SSID, password); });
     }
 
 }
@@ -374,10 +834,6 @@ void Traffic::TrafficDataProvider::setReceivingHeartbeat(bool newReceivingHeartb
 
 void Traffic::TrafficDataProvider::setWarning(const Traffic::Warning& warning)
 {
-    if (warning.alarmLevel() > -1) {
-        m_WarningTimer.start();
-    }
-
     if (m_Warning == warning) {
         return;
     }
@@ -387,12 +843,53 @@ void Traffic::TrafficDataProvider::setWarning(const Traffic::Warning& warning)
 }
 
 
+void Traffic::TrafficDataProvider::startRecording(const QString& fileName)
+{
+    stopRecording();
+    m_recorder = std::make_shared<Traffic::TrafficDataRecorder>(fileName);
+    foreach(auto dataSource, m_dataSources) {
+        if (dataSource.isNull()) {
+            continue;
+        }
+        QMetaObject::invokeMethod(dataSource, [dataSource, recorder=m_recorder]() { dataSource->setRecorder(recorder); });
+    }
+}
+
+
+void Traffic::TrafficDataProvider::stopRecording()
+{
+    if (!m_recorder) {
+        return;
+    }
+    if (m_recorder->droppedRecords() > 0) {
+        qWarning() << "TrafficDataProvider: recording dropped" << m_recorder->droppedRecords() << "records";
+    }
+    m_recorder.reset();
+    foreach(auto dataSource, m_dataSources) {
+        if (dataSource.isNull()) {
+            continue;
+        }
+        QMetaObject::invokeMethod(dataSource, [dataSource]() { dataSource->setRecorder(nullptr); });
+    }
+}
+
+
+void Traffic::TrafficDataProvider::updateWarning()
+{
+    if (m_predictedWarning.alarmLevel() > m_reportedWarning.alarmLevel()) {
+        setWarning(m_predictedWarning);
+    } else {
+        setWarning(m_reportedWarning);
+    }
+}
+
+
 void Traffic::TrafficDataProvider::updateStatusString()
 {
     if (receivingHeartbeat()) {
         QString result;
         if (!m_currentSource.isNull()) {
-            result += QString("<p>%1</p><ul style='margin-left:-25px;'>").arg(m_currentSource->sourceName());
+            result += QString("<p>%1</p><ul style='margin-left:-25px;'>").arg(m_sourceStatus.value(m_currentSource).sourceName);
         }
         result += QString("<li>%1</li>").arg(tr("Receiving heartbeat."));
         if (positionInfo().isValid()) {
@@ -412,10 +909,11 @@ void Traffic::TrafficDataProvider::updateStatusString()
             continue;
         }
 
+        auto status = m_sourceStatus.value(source);
         result += "<li>";
-        result += source->sourceName() + ": " + source->connectivityStatus();
-        if (!source->errorString().isEmpty()) {
-            result += " " + source->errorString();
+        result += status.sourceName + ": " + status.connectivityStatus;
+        if (!status.errorString.isEmpty()) {
+            result += " " + status.errorString;
         }
         result += "</li>";
     }
@@ -423,3 +921,44 @@ void Traffic::TrafficDataProvider::updateStatusString()
 
     setStatusString(result);
 }
+
+
+void Traffic::TrafficDataProvider::updateTrackHistory(Traffic::TrafficFactor_WithPosition* object, bool newTarget)
+{
+    auto trackHistory = m_trackHistories.find(object);
+    if (trackHistory == m_trackHistories.end()) {
+        return;
+    }
+    if (newTarget) {
+        trackHistory->second.clear();
+    }
+    trackHistory->second.append(object->positionInfo().coordinate());
+    emit object->trailChanged();
+}
+
+
+void Traffic::TrafficDataProvider::updateTrafficObjectIndex(Traffic::TrafficFactor_WithPosition* object)
+{
+    // Remove old entries
+    auto oldKey = m_trafficObjectPriorityKeys.find(object);
+    if (oldKey != m_trafficObjectPriorityKeys.end()) {
+        m_trafficObjectsByPriority.erase(oldKey.value());
+        if (m_trafficObjectsByID.value(oldKey->ID) == object) {
+            m_trafficObjectsByID.remove(oldKey->ID);
+        }
+    }
+
+    // Compute new key. Distances that are not known are treated as infinite,
+    // so that the ordering of keys is well-defined.
+    auto hDistInM = object->hDist().toM();
+    if (!qIsFinite(hDistInM)) {
+        hDistInM = std::numeric_limits<double>::infinity();
+    }
+    PriorityKey key {object->valid(), object->alarmLevel(), hDistInM, object, object->ID()};
+
+    m_trafficObjectPriorityKeys.insert(object, key);
+    m_trafficObjectsByPriority.insert(key);
+    if (key.ID.isValid()) {
+        m_trafficObjectsByID.insert(key.ID, object);
+    }
+}
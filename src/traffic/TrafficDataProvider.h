@@ -20,11 +20,21 @@
 
 #pragma once
 
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QNetworkDatagram>
 #include <QQmlListProperty>
+#include <QQuickWindow>
+#include <QThread>
 #include <QUdpSocket>
+#include <chrono>
+#include <set>
+#include <unordered_map>
 
 #include "positioning/PositionInfoSource_Abstract.h"
+#include "traffic/ConflictPredictor.h"
+#include "traffic/GDL90Server.h"
 #include "traffic/Warning.h"
 #include "traffic/TrafficFactor_DistanceOnly.h"
 #include "traffic/TrafficFactor_WithPosition.h"
@@ -35,14 +45,42 @@ namespace Traffic {
 /*! \brief Traffic receiver
  *
  *  This class manages multiple TrafficDataSources. It combines the data
- *  streams, and passes data from the most relevant (if any) traffic data source
- *  on to the consumers of this class.
+ *  streams, and passes the data on to the consumers of this class. Traffic is
+ *  fused from all sources that receive heartbeat messages: targets are
+ *  identified by their ICAO/FLARM address, and every target is followed by
+ *  one source at a time. Another source takes over only if it has higher
+ *  priority, or if the source that follows the target has not reported it
+ *  for sourceHoldTime. Position data and traffic warnings are taken from the
+ *  most relevant source only.
  *
  *  By default, it watches the following data channels:
  *
  *  - TCP connection to 192.168.1.1, port 2000
  *  - TCP connection to 192.168.10.1, port 2000
  *
+ *  The traffic data sources are run in a dedicated thread, so that decoding of
+ *  the data streams does not compete with the GUI. The sources hand decoded
+ *  traffic data over as TrafficReport, which this class copies into its traffic
+ *  factors in the main thread. All database lookups (Flarmnet, passwords) are
+ *  done here.
+ *
+ *  Traffic receivers report every target about once per second, but busy
+ *  receivers send many reports in short bursts. To avoid that every report
+ *  triggers property changes and QML binding updates, reports are collected
+ *  and only the latest report of every target is copied into the traffic
+ *  factors, at most once per updateInterval.
+ *
+ *  A ConflictPredictor, running in the traffic thread, predicts the closest
+ *  point of approach of all traffic. Predicted alarm levels raise the alarm
+ *  levels reported by the receiver (which are zero for ADS-B traffic). A
+ *  predicted warning is shown when it is more severe than the warning that
+ *  the receiver reports.
+ *
+ *  For every traffic object, this class keeps a TrackHistory, which is
+ *  shown as a trail on the moving map. Track histories are allocated together
+ *  with the traffic objects, so that memory stays bounded and updates do not
+ *  allocate memory.
+ *
  *  This class also acts as a PositionInfoSource, and passes position data (that
  *  some traffic receivers provide) on to the the consumers of this class.
  *
@@ -61,6 +99,9 @@ public:
      */
     explicit TrafficDataProvider(QObject *parent = nullptr);
 
+    // Standard destructor
+    ~TrafficDataProvider() override;
+
     //
     // Methods
     //
@@ -71,17 +112,63 @@ public:
      *  typically a simulator source used for debugging purposes. The
      *  TrafficDataProvider takes ownership of the source.
      *
+     *  By default, the source is moved to the traffic thread. Methods of the
+     *  source must then no longer be called directly; use
+     *  QMetaObject::invokeMethod instead.
+     *
      *  @param source New TrafficDataSource that is to be added.
+     *
+     *  @param moveToTrafficThread If false, the source remains in the thread of
+     *  this TrafficDataProvider. This is useful for sources that are controlled
+     *  directly from the GUI thread, such as the simulator of the DemoRunner.
      */
-    void addDataSource(Traffic::TrafficDataSource_Abstract* source);
+    void addDataSource(Traffic::TrafficDataSource_Abstract* source, bool moveToTrafficThread=true);
 
-    /*! \brief Clear all data sources */
+    /*! \brief Clear all data sources
+     *
+     *  Sources in the traffic thread are deleted there, shortly after this
+     *  method returns. The traffic thread keeps running, so that new sources
+     *  can be added with addDataSource(). The thread is stopped only when the
+     *  application quits, or when this TrafficDataProvider is destructed.
+     */
     void clearDataSources();
 
+    /*! \brief Start recording the raw data streams of all traffic receivers
+     *
+     *  The recording can be replayed with TrafficDataSource_File. If a
+     *  recording is already running, it is stopped first.
+     *
+     *  @param fileName Name of the file. An existing file is overwritten.
+     */
+    Q_INVOKABLE void startRecording(const QString& fileName);
+
+    /*! \brief Stop recording
+     *
+     *  The file is closed once all data sources have released the recorder.
+     */
+    Q_INVOKABLE void stopRecording();
+
     //
     // Properties
     //
 
+    /*! \brief GDL90 output
+     *
+     *  This property holds the GDL90Server that re-broadcasts the ownship
+     *  position and the fused traffic to other apps, once per second while
+     *  clients are registered.
+     */
+    Q_PROPERTY(Traffic::GDL90Server* gdl90Server READ gdl90Server CONSTANT)
+
+    /*! \brief Getter method for property with the same name
+     *
+     *  @returns Property gdl90Server
+     */
+    Traffic::GDL90Server* gdl90Server()
+    {
+        return &m_gdl90Server;
+    }
+
     /*! \brief Heartbeat indicator
      *
      *  When active, traffic receivers send regular heartbeat messages. These
@@ -106,9 +193,10 @@ public:
      *  QQmlListProperty for better cooperation with QML. Note that only the
      *  valid items in this list pertain to actual traffic. Invalid items should
      *  be ignored. The list is not sorted in any way. The items themselves are
-     *  owned by this class.
+     *  owned by this class. The length of the list is given by the setting
+     *  Settings::maxTrafficObjects.
      */
-    Q_PROPERTY(QQmlListProperty<Traffic::TrafficFactor_WithPosition> trafficObjects4QML READ trafficObjects4QML CONSTANT)
+    Q_PROPERTY(QQmlListProperty<Traffic::TrafficFactor_WithPosition> trafficObjects4QML READ trafficObjects4QML NOTIFY trafficObjects4QMLChanged)
 
     /*! \brief Getter method for property with the same name
      *
@@ -119,6 +207,15 @@ public:
         return QQmlListProperty(this, &m_trafficObjects);
     }
 
+    /*! \brief Traffic objects whose position is known
+     *
+     *  @returns The same list as trafficObjects4QML, for use in C++
+     */
+    QList<Traffic::TrafficFactor_WithPosition*> trafficObjects() const
+    {
+        return m_trafficObjects;
+    }
+
     /*! \brief Most relevant traffic object whose position is not known
      *
      *  This property holds a pointer to the most relevant traffic object whose
@@ -203,6 +300,52 @@ public:
      */
     static constexpr Units::Distance maxHorizontalDistance = Units::Distance::fromNM(20.0);
 
+    /*! \brief Minimal time between two updates of the traffic factors
+     *
+     *  Traffic reports that arrive within this interval are coalesced, so
+     *  that the traffic factors are updated at most once per interval. The
+     *  interval corresponds to a frame rate of 25 frames per second.
+     */
+    static constexpr std::chrono::milliseconds updateInterval {40};
+
+    /*! \brief Time after which another source may take over a target
+     *
+     *  If a target is reported by several sources, reports of the source that
+     *  has most recently followed the target are preferred. Reports of sources
+     *  of lower priority are used only once the target has not been updated
+     *  for this time.
+     */
+    static constexpr std::chrono::milliseconds sourceHoldTime {3000};
+
+    /*! \brief Latency above which a frame is considered slow
+     *
+     *  If more time passes between the reception of traffic data and the
+     *  first frame that shows the data, the counter
+     *  "traffic/latency/slowFrames" is increased.
+     */
+    static constexpr std::chrono::milliseconds latencyThreshold {250};
+
+    /*! \brief Delay before the second attempt to connect to a source
+     *
+     *  Sources that do not report a heartbeat are tried again with
+     *  exponential back-off. The delay doubles with every failed attempt, up
+     *  to maxReconnectionDelay. To keep sources from waking the radio in
+     *  lockstep, every delay is varied randomly by up to 25%. The back-off is
+     *  reset whenever the network changes.
+     */
+    static constexpr std::chrono::milliseconds initialReconnectionDelay = std::chrono::seconds(10);
+
+    /*! \brief Maximal delay between two attempts to connect to a source */
+    static constexpr std::chrono::milliseconds maxReconnectionDelay = std::chrono::minutes(30);
+
+    /*! \brief Head start of the source that last worked on the current Wi-Fi network
+     *
+     *  When connecting afresh, the source that last received a heartbeat on
+     *  the current Wi-Fi network is tried first. The other sources are tried
+     *  after this delay.
+     */
+    static constexpr std::chrono::milliseconds preferredSourceHeadStart = std::chrono::seconds(3);
+
 signals:
     /*! \brief Password request
      *
@@ -224,6 +367,9 @@ signals:
     /*! \brief Notifier signal */
     void receivingHeartbeatChanged(bool);
 
+    /*! \brief Notifier signal */
+    void trafficObjects4QMLChanged();
+
     /*! \brief Notifier signal */
     void trafficReceiverRuntimeErrorChanged(QString message);
 
@@ -239,7 +385,9 @@ public slots:
      * If this class is connected to a traffic receiver, this method does
      * nothing.  Otherwise, it stops any ongoing connection attempt and starts a
      * new attempt to connect to a potential receiver, via all available
-     * channels simultaneously.
+     * channels. The back-off of all channels is reset. If a channel has
+     * received a heartbeat on the current Wi-Fi network before, it is tried
+     * first, and all others after preferredSourceHeadStart.
      */
     void connectToTrafficReceiver();
 
@@ -264,15 +412,26 @@ public slots:
 private slots:   
     // Intializations that are moved out of the constructor, in order to avoid
     // nested uses of constructors in Global.
-    void deferredInitialization() const;
+    void deferredInitialization();
 
     // Sends out foreflight broadcast message See
     // https://www.foreflight.com/connect/spec/
     void foreFlightBroadcast();
 
+    // Called when the ConflictPredictor has finished a prediction
+    void onConflictsPredicted(const QVector<Traffic::ConflictPrediction>& conflicts, const Traffic::Warning& warning);
+
+    // Called when FlarmnetDB has found a registration that was not known when
+    // the traffic was reported
+    void onRegistrationFound(Traffic::TargetID ID, const QString& registration);
+
     // Called if one of the sources indicates a heartbeat change
     void onSourceHeartbeatChanged();
 
+    // Tries to connect all sources without heartbeat whose back-off has
+    // expired, and restarts reconnectionTimer for the next attempt
+    void reconnect();
+
     // Called if one of the sources reports traffic (position unknown)
     void onTrafficFactorWithPosition(const Traffic::TrafficFactor_WithPosition& factor);
 
@@ -285,7 +444,8 @@ private slots:
     // Called if one of the sources reports or clears an error string
     void onTrafficReceiverRuntimeError(const QString& msg);
 
-    // Resetter method
+    // Resets m_reportedWarning. Called when the receiver has not reported a
+    // warning for a while.
     void resetWarning();
 
     // Setter method
@@ -294,32 +454,158 @@ private slots:
     // Setter method
     void setWarning(const Traffic::Warning& warning);
 
+    // Sets the property warning to the more severe of m_reportedWarning and
+    // m_predictedWarning
+    void updateWarning();
+
     // Updates the property statusString that is inherited from
     // Positioning::PositionInfoSource_Abstract
     void updateStatusString();
 
 private:
+    // Properties of a data source, as last reported by the source. Sources
+    // live in the traffic thread, so their properties cannot be read
+    // directly.
+    struct SourceStatus {
+        QString sourceName;
+        QString connectivityStatus;
+        QString errorString;
+        bool receivingHeartbeat {false};
+        QString trafficReceiverRuntimeError;
+        QString trafficReceiverSelfTestError;
+
+        // Back-off for connection attempts
+        int failedAttempts {0};
+        QDeadlineTimer nextAttempt {0};
+    };
+
+    // Clears all data sources and stops the traffic thread
+    void shutDown();
+
+    // Source that last received a heartbeat on the current Wi-Fi network, as
+    // stored in QSettings, or nullptr if none
+    Traffic::TrafficDataSource_Abstract* preferredSource() const;
+
+    // Source that last updated a target, and time of the update, in
+    // milliseconds of m_fusionClock
+    struct FusedTarget {
+        Traffic::TrafficDataSource_Abstract* source {nullptr};
+        qint64 lastUpdate {0};
+    };
+
+    // Checks if a report of the source for the given target should be used,
+    // and updates m_fusedTargets accordingly
+    bool acceptReport(Traffic::TrafficDataSource_Abstract* source, Traffic::TargetID ID);
+
+    // Takes all reports from the source. Warnings are applied immediately,
+    // traffic factors are coalesced in m_pendingFactors and
+    // m_pendingFactorsDistanceOnly.
+    void processReports(Traffic::TrafficDataSource_Abstract* source);
+
+    // Copies the coalesced traffic reports into the traffic factors
+    void flushPendingFactors();
+
+    // Records the latency of the traffic data shown in the frame that has
+    // just been drawn
+    void onFrameSwapped();
+
+    // Priority of a traffic object, as computed by
+    // TrafficFactor_Abstract::hasHigherPriorityThan, together with the ID under
+    // which the object is indexed. Keys are ordered by increasing priority.
+    struct PriorityKey {
+        bool valid;
+        int alarmLevel;
+        double hDistInM;
+        Traffic::TrafficFactor_WithPosition* object;
+        Traffic::TargetID ID;
+
+        bool operator<(const PriorityKey& rhs) const;
+    };
+
+    // Changes the number of traffic objects. Objects of lowest priority are
+    // deleted first.
+    void setMaxTrafficObjects(int maxTrafficObjects);
+
+    // Updates the track history of a traffic object. If newTarget is true,
+    // the object now shows another target and the history is restarted.
+    void updateTrackHistory(Traffic::TrafficFactor_WithPosition* object, bool newTarget);
+
+    // Re-computes the ID index and priority key of the traffic object. This
+    // method must be called whenever the ID or the priority of the object
+    // changes.
+    void updateTrafficObjectIndex(Traffic::TrafficFactor_WithPosition* object);
+
     // UDP Socket for ForeFlight Broadcast messages.
     // See https://www.foreflight.com/connect/spec/
     QNetworkDatagram foreFlightBroadcastDatagram {R"({"App":"Enroute Flight Navigation","GDL90":{"port":4000}})", QHostAddress::Broadcast, 63093};
     QUdpSocket foreFlightBroadcastSocket;
     QTimer foreFlightBroadcastTimer;
 
-    // Targets
+    // GDL90 output, and the timer that triggers it
+    Traffic::GDL90Server m_gdl90Server;
+    QTimer m_gdl90Timer;
+
+    // Targets. The ID index and the priority keys are maintained by
+    // updateTrafficObjectIndex(), they allow to find the target with a given
+    // ID, and the target of lowest priority, without scanning all targets.
     QList<Traffic::TrafficFactor_WithPosition *> m_trafficObjects;
+    QHash<Traffic::TargetID, Traffic::TrafficFactor_WithPosition*> m_trafficObjectsByID;
+    QHash<Traffic::TrafficFactor_WithPosition*, PriorityKey> m_trafficObjectPriorityKeys;
+    std::set<PriorityKey> m_trafficObjectsByPriority;
+
+    // Track histories of the targets. The map is node-based, so pointers to
+    // the track histories remain valid while targets are added or removed.
+    std::unordered_map<Traffic::TrafficFactor_WithPosition*, Traffic::TrackHistory> m_trackHistories;
     QPointer<Traffic::TrafficFactor_DistanceOnly> m_trafficObjectWithoutPosition;
 
-    // TrafficData Sources
+    // TrafficData Sources, the thread in which they run, and their status
     QList<QPointer<Traffic::TrafficDataSource_Abstract>> m_dataSources;
     QPointer<Traffic::TrafficDataSource_Abstract> m_currentSource;
-
-    // Property cache
+    QThread m_trafficThread;
+    QHash<Traffic::TrafficDataSource_Abstract*, SourceStatus> m_sourceStatus;
+    std::shared_ptr<Traffic::TrafficDataRecorder> m_recorder;
+
+    // Latest traffic reports of all targets that were reported since the last
+    // run of flushPendingFactors(), by ID, and a timer that triggers the next
+    // run
+    QHash<Traffic::TargetID, Traffic::TrafficReport> m_pendingFactors;
+    QHash<Traffic::TargetID, Traffic::TrafficReport> m_pendingFactorsDistanceOnly;
+    QTimer m_flushTimer;
+
+    // Latency measurement. Reports carry the time of reception and the time
+    // of decoding. The earliest reception time and the time of the first
+    // flush since the last frame are kept until the next frame has been
+    // drawn in m_window, where the latencies are recorded in the metrics
+    // "traffic/latency/...". A value of zero means that no reports are
+    // waiting to be shown.
+    QPointer<QQuickWindow> m_window;
+    qint64 m_undisplayedReceivedAt {0};
+    qint64 m_undisplayedFlushedAt {0};
+
+    // Fusion of traffic from several sources, by target ID
+    QHash<Traffic::TargetID, FusedTarget> m_fusedTargets;
+    QElapsedTimer m_fusionClock;
+
+    // Scratch objects, used to hand traffic reports to
+    // onTrafficFactorWithPosition() and onTrafficFactorWithoutPosition()
+    Traffic::TrafficFactor_WithPosition m_incomingFactor;
+    Traffic::TrafficFactor_DistanceOnly m_incomingFactorDistanceOnly;
+
+    // Conflict prediction, running in the traffic thread, and the alarm
+    // levels of the latest prediction, by ID
+    QPointer<Traffic::ConflictPredictor> m_conflictPredictor;
+    QHash<Traffic::TargetID, int> m_predictedAlarmLevels;
+
+    // Property cache. The warning is the more severe of the warning reported
+    // by the current source and the predicted warning.
+    Traffic::Warning m_reportedWarning;
+    Traffic::Warning m_predictedWarning;
     Traffic::Warning m_Warning;
     QTimer m_WarningTimer;
     QString m_trafficReceiverRuntimeError {};
     QString m_trafficReceiverSelfTestError {};
 
-    // Reconnect
+    // Reconnect. The timer fires when the back-off of the next source expires.
     QTimer reconnectionTimer;
 
     // Property Cache
@@ -0,0 +1,146 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <QDebug>
+#include <QFile>
+#include <QtEndian>
+#include <chrono>
+#include <cstring>
+
+#include "traffic/TrafficDataRecorder.h"
+
+using namespace std::chrono_literals;
+
+
+// Member functions
+
+Traffic::TrafficDataRecorder::TrafficDataRecorder(const QString& fileName) :
+    m_fileName(fileName), m_buffer(new char[capacity])
+{
+    m_clock.start();
+    m_writer = std::thread(&Traffic::TrafficDataRecorder::writerLoop, this);
+}
+
+
+Traffic::TrafficDataRecorder::~TrafficDataRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_one();
+    m_writer.join();
+}
+
+
+void Traffic::TrafficDataRecorder::append(Channel channel, const char* data, qint64 size)
+{
+    auto time = static_cast<quint32>(m_clock.elapsed());
+
+    while (size > 0) {
+        auto chunkSize = static_cast<quint16>(qMin(size, qint64(0xFFFF)));
+        std::size_t recordSize = recordHeaderSize+chunkSize;
+
+        // Reserve space in the ring buffer
+        auto head = m_reserved.load(std::memory_order_relaxed);
+        do {
+            auto tail = m_tail.load(std::memory_order_acquire);
+            if (capacity-(head-tail) < recordSize) {
+                m_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        } while (!m_reserved.compare_exchange_weak(head, head+recordSize, std::memory_order_relaxed));
+
+        char header[recordHeaderSize];
+        qToLittleEndian<quint32>(time, header);
+        header[4] = static_cast<char>(channel);
+        header[5] = 0;
+        qToLittleEndian<quint16>(chunkSize, header+6);
+        copyIn(head, header, recordHeaderSize);
+        copyIn(head+recordHeaderSize, data, chunkSize);
+
+        // Publish the record, once all records reserved before it are
+        // published. Producers only wait for each other while they copy.
+        while (m_head.load(std::memory_order_acquire) != head) {
+            std::this_thread::yield();
+        }
+        m_head.store(head+recordSize, std::memory_order_release);
+
+        data += chunkSize;
+        size -= chunkSize;
+    }
+}
+
+
+auto Traffic::TrafficDataRecorder::containsRecording(const QString& fileName) -> bool
+{
+    QFile inFile(fileName);
+    if (!inFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    auto magic = inFile.read(sizeof(fileMagic));
+    return (magic.size() == sizeof(fileMagic)) && (std::memcmp(magic.constData(), fileMagic, sizeof(fileMagic)) == 0);
+}
+
+
+void Traffic::TrafficDataRecorder::copyIn(std::size_t position, const char* data, std::size_t size)
+{
+    auto offset = position & (capacity-1);
+    auto firstPart = qMin(size, capacity-offset);
+    std::memcpy(m_buffer.get()+offset, data, firstPart);
+    std::memcpy(m_buffer.get(), data+firstPart, size-firstPart);
+}
+
+
+void Traffic::TrafficDataRecorder::writerLoop()
+{
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "TrafficDataRecorder: cannot open" << m_fileName;
+    } else {
+        file.write(fileMagic, sizeof(fileMagic));
+    }
+
+    bool stop = false;
+    while (!stop) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait_for(lock, 200ms, [this]() { return m_stop; });
+            stop = m_stop;
+        }
+
+        // Write everything that is in the ring buffer, in at most two parts
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        auto head = m_head.load(std::memory_order_acquire);
+        while (tail != head) {
+            auto offset = tail & (capacity-1);
+            auto size = qMin(head-tail, capacity-offset);
+            if (file.isOpen()) {
+                file.write(m_buffer.get()+offset, static_cast<qint64>(size));
+            }
+            tail += size;
+        }
+        m_tail.store(tail, std::memory_order_release);
+        if (file.isOpen()) {
+            file.flush();
+        }
+    }
+}
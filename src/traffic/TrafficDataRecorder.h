@@ -0,0 +1,145 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+namespace Traffic {
+
+/*! \brief Recorder for raw data streams of traffic receivers
+ *
+ *  This class records the data that traffic receivers send, with time
+ *  stamps, to reproduce problems found in the field. Recordings can be
+ *  replayed with TrafficDataSource_File.
+ *
+ *  Data is appended with append(), which only copies the data into a
+ *  preallocated ring buffer and never locks, allocates or touches the disk.
+ *  If the ring buffer is full, data is dropped. A background thread writes
+ *  the ring buffer to the file.
+ *
+ *  The method append() is thread-safe. Most traffic data sources run in the
+ *  traffic thread of the TrafficDataProvider, but some, like the simulator
+ *  used by the DemoRunner, live in the GUI thread and share the recorder.
+ *
+ *  The file starts with the eight bytes of fileMagic, followed by records.
+ *  Every record consists of an eight-byte header and the data. The header
+ *  contains the time since the start of the recording in milliseconds
+ *  (32 bit), the channel (8 bit), one reserved byte and the size of the data
+ *  (16 bit). All numbers are little-endian.
+ */
+
+class TrafficDataRecorder
+{
+public:
+    /*! \brief Kind of data */
+    enum Channel : quint8 {
+        Stream = 0,  /*!< Part of a text stream with FLARM/NMEA sentences, as received via TCP */
+        Datagram = 1 /*!< Complete datagram with GDL90 or XGPS data, as received via UDP */
+    };
+
+    /*! \brief First bytes of every recording */
+    static constexpr char fileMagic[8] = {'E', 'N', 'R', 'T', 'R', 'E', 'C', '1'};
+
+    /*! \brief Size of the record header */
+    static constexpr int recordHeaderSize = 8;
+
+    /*! \brief Starts a recording
+     *
+     *  @param fileName Name of the file. An existing file is overwritten.
+     */
+    explicit TrafficDataRecorder(const QString& fileName);
+
+    /*! \brief Stops the recording
+     *
+     *  The destructor writes all data that is still in the ring buffer and
+     *  closes the file.
+     */
+    ~TrafficDataRecorder();
+
+    /*! \brief Append data
+     *
+     *  Data that is larger than 65535 bytes is split into several records.
+     *
+     *  @param channel Kind of data
+     *
+     *  @param data Pointer to the data
+     *
+     *  @param size Size of the data
+     */
+    void append(Channel channel, const char* data, qint64 size);
+
+    /*! \brief Reads file and checks if the file contains a recording
+     *
+     *  @param fileName Name of the file to be checked
+     *
+     *  @returns True if the file starts with fileMagic
+     */
+    static bool containsRecording(const QString& fileName);
+
+    /*! \brief Number of records dropped because the ring buffer was full
+     *
+     *  @returns Number of dropped records
+     */
+    quint64 droppedRecords() const
+    {
+        return m_droppedRecords.load(std::memory_order_relaxed);
+    }
+
+private:
+    Q_DISABLE_COPY_MOVE(TrafficDataRecorder)
+
+    // Capacity of the ring buffer, in bytes. This must be a power of two.
+    static constexpr std::size_t capacity = 1U << 22U;
+
+    // Copies bytes into the ring buffer, starting at the given position
+    void copyIn(std::size_t position, const char* data, std::size_t size);
+
+    // Body of the writer thread
+    void writerLoop();
+
+    QString m_fileName;
+    QElapsedTimer m_clock;
+
+    // Ring buffer. Producers reserve space by advancing m_reserved and
+    // publish records, in the order of reservation, by advancing m_head. The
+    // writer thread advances m_tail. All count bytes and grow monotonically.
+    std::unique_ptr<char[]> m_buffer;
+    alignas(64) std::atomic<std::size_t> m_reserved {0};
+    alignas(64) std::atomic<std::size_t> m_head {0};
+    alignas(64) std::atomic<std::size_t> m_tail {0};
+    std::atomic<quint64> m_droppedRecords {0};
+
+    // Writer thread
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    bool m_stop {false};
+    std::thread m_writer;
+};
+
+}
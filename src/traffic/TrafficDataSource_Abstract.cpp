@@ -18,28 +18,50 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-#include <QQmlEngine>
-
+#include "positioning/PositionProvider.h"
 #include "traffic/TrafficDataSource_Abstract.h"
 
 
 // Member functions
 
 Traffic::TrafficDataSource_Abstract::TrafficDataSource_Abstract(QObject *parent) : QObject(parent) {
+}
 
-    QQmlEngine::setObjectOwnership(&m_factor, QQmlEngine::CppOwnership);
 
-    // Setup heartbeat timer
-    m_heartbeatTimer.setSingleShot(true);
-    m_heartbeatTimer.setInterval(5s);
-    connect(&m_heartbeatTimer, &QTimer::timeout, this, &Traffic::TrafficDataSource_Abstract::resetReceivingHeartbeat);
+void Traffic::TrafficDataSource_Abstract::countMessage(bool checksumValid)
+{
+    if (m_messagesMetric == nullptr) {
+        m_messagesMetric = Metrics::counter("traffic/"+sourceName()+"/messages");
+        m_checksumFailuresMetric = Metrics::counter("traffic/"+sourceName()+"/checksumFailures");
+    }
+    if (checksumValid) {
+        m_messagesMetric->add();
+    } else {
+        m_checksumFailuresMetric->add();
+    }
+}
 
-    // Setup other times
-    m_pressureAltitudeTimer.setInterval(5s);
-    m_pressureAltitudeTimer.setSingleShot(true);
-    m_trueAltitudeTimer.setInterval(5s);
-    m_trueAltitudeTimer.setSingleShot(true);
 
+void Traffic::TrafficDataSource_Abstract::publishReport(Traffic::TrafficReport&& report)
+{
+    // Sources that do not read from sockets, such as the simulator, have no
+    // time of reception. For those, decoding takes no time.
+    static auto* decodeLatencyMetric = Metrics::histogram(QStringLiteral("traffic/latency/decode"));
+    report.decodedAt = Metrics::now();
+    report.receivedAt = (m_receiveTimestamp != 0) ? m_receiveTimestamp : report.decodedAt;
+    decodeLatencyMetric->record((report.decodedAt-report.receivedAt)/1000);
+
+    if (!m_reports.push(std::move(report))) {
+        return;
+    }
+
+    // Emit reportsAvailable() unless a signal is already pending. The fence
+    // pairs with the one in takeReport(): either the consumer sees the new
+    // report, or we see that the flag has been cleared.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!m_reportsNotified.exchange(true)) {
+        emit reportsAvailable();
+    }
 }
 
 
@@ -68,7 +90,7 @@ void Traffic::TrafficDataSource_Abstract::setErrorString(const QString& newError
 void Traffic::TrafficDataSource_Abstract::setReceivingHeartbeat(bool newReceivingHeartbeat)
 {
     if (newReceivingHeartbeat) {
-        m_heartbeatTimer.start();
+        m_heartbeatTimer.start(heartbeatTimeout);
     } else {
         m_heartbeatTimer.stop();
     }
@@ -78,6 +100,13 @@ void Traffic::TrafficDataSource_Abstract::setReceivingHeartbeat(bool newReceivin
     }
     m_hasHeartbeat = newReceivingHeartbeat;
     emit receivingHeartbeatChanged(m_hasHeartbeat);
+
+    // Forget the last PFLAU sentence, so that the first sentence after the
+    // heartbeat returns is interpreted in full
+    if (!m_hasHeartbeat) {
+        m_lastPFLAUStatusSize = 0;
+        m_lastPFLAUWarningSize = 0;
+    }
 }
 
 
@@ -107,3 +136,29 @@ void Traffic::TrafficDataSource_Abstract::setTrafficReceiverSelfTestError(const
     m_trafficReceiverSelfTestError = newErrorString;
     emit trafficReceiverSelfTestErrorChanged(newErrorString);
 }
+
+
+auto Traffic::TrafficDataSource_Abstract::takeReport(Traffic::TrafficReport& report) -> bool
+{
+    if (m_reports.pop(report)) {
+        return true;
+    }
+
+    // The queue is empty. Clear the flag, so that the next report triggers a
+    // new signal, and check again for reports that were added in the meantime.
+    m_reportsNotified.store(false);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return m_reports.pop(report);
+}
+
+
+auto Traffic::TrafficDataSource_Abstract::ownshipCoordinate() const -> const QGeoCoordinate&
+{
+    auto version = Positioning::PositionProvider::lastValidVersion();
+    if (version != m_ownshipCoordinateVersion)
+    {
+        m_ownshipCoordinate = Positioning::PositionProvider::lastValidCoordinate();
+        m_ownshipCoordinateVersion = version;
+    }
+    return m_ownshipCoordinate;
+}
@@ -20,10 +20,19 @@
 
 #pragma once
 
+#include <QElapsedTimer>
+#include <QTimer>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string_view>
+
+#include "Metrics.h"
 #include "positioning/PositionInfo.h"
-#include "traffic/TrafficFactor_DistanceOnly.h"
-#include "traffic/TrafficFactor_WithPosition.h"
-#include "traffic/Warning.h"
+#include "traffic/SPSCQueue.h"
+#include "traffic/TimingWheel.h"
+#include "traffic/TrafficDataRecorder.h"
+#include "traffic/TrafficReport.h"
 
 
 namespace Traffic {
@@ -32,9 +41,16 @@ namespace Traffic {
  *
  *  This is an abstract base class for all classes that connect to a traffic
  *  receiver.  In addition to the properties listed below, the class also emits
- *  imporant data via the signals barometricAltitudeUpdated,
- *  factorWithoutPosition, factorWithPosition and warning. It contains methods
- *  to interpret FLARM and GDL90 data streams.
+ *  imporant data via the signals barometricAltitudeUpdated and positionUpdated.
+ *  Traffic factors and warnings are stored as TrafficReport in a lock-free
+ *  queue, and can be retrieved with takeReport(). It contains methods to
+ *  interpret FLARM and GDL90 data streams.
+ *
+ *  Traffic data sources are typically moved to a dedicated I/O thread by the
+ *  TrafficDataProvider, so that decoding does not compete with the GUI. For
+ *  that reason, implementations must not access any of the GlobalObjects.
+ *  The coordinate of ownship is read with ownshipCoordinate(), which is
+ *  thread-safe.
  */
 class TrafficDataSource_Abstract : public QObject {
     Q_OBJECT
@@ -49,6 +65,18 @@ public:
     // Standard destructor
     ~TrafficDataSource_Abstract() override = default;
 
+    /*! \brief Take the oldest traffic report from the queue
+     *
+     *  Whenever the signal reportsAvailable() is emitted, the consumer must
+     *  call this method until it returns false. This method must always be
+     *  called from the same thread, typically the main thread.
+     *
+     *  @param report If the queue is not empty, the oldest report is moved here
+     *
+     *  @returns False if the queue is empty
+     */
+    bool takeReport(Traffic::TrafficReport& report);
+
     //
     // Properties
     //
@@ -170,24 +198,6 @@ signals:
     /*! \brief Notifier signal */
     void errorStringChanged(QString newError);
 
-    /*! \brief Traffic factor without position
-     *
-     *  This signal is emitted when the traffic receiver informs this class
-     *  about traffic whose position is not known.
-     *
-     *  \param factor Traffic factor.
-     */
-    void factorWithoutPosition(const Traffic::TrafficFactor_DistanceOnly &factor);
-
-    /*! \brief Traffic factor with position
-     *
-     *  This signal is emitted when the traffic receiver informs this class
-     *  about traffic whose position is known.
-     *
-     *  \param factor Traffic factor.
-     */
-    void factorWithPosition(const Traffic::TrafficFactor_WithPosition& factor);
-
     /* \brief Password request
      *
      *  This signal is emitted whenever the traffic receiver asks for a
@@ -197,6 +207,16 @@ signals:
      */
     void passwordRequest(const QString& SSID);
 
+    /* \brief Password rejected
+     *
+     *  This signal is emitted whenever the traffic receiver has rejected a
+     *  password stored in the database. The password should be removed from
+     *  the database.
+     *
+     *  @param SSID Name of the WiFi network that is currently in use.
+     */
+    void passwordRejected(const QString& SSID);
+
     /* \brief Password storage request
      *
      *  This signal is emitted whenever the traffic receiver has successfully
@@ -225,6 +245,13 @@ signals:
     /*! \brief Notifier signal */
     void receivingHeartbeatChanged(bool);
 
+    /*! \brief Traffic reports available
+     *
+     *  This signal is emitted when traffic reports have been added to an empty
+     *  queue; it is not emitted again before takeReport() has returned false.
+     */
+    void reportsAvailable();
+
     /*! \brief Notifier signal */
     void trafficReceiverRuntimeErrorChanged(const QString& message);
 
@@ -258,17 +285,6 @@ signals:
      */
     void trafficReceiverSwVersion(QString result);
 
-    /*! \brief Traffic warning
-     *
-     *  This signal is emitted when the traffic receiver issues a traffic
-     *  warning. An invalid warning (i.e. a warning with alarm level = -1) is
-     *  emitted to indicate that the last warning is no longer active and should
-     *  be disregarded.
-     *
-     *  \param warning Traffic warning.
-     */
-    void warning(const Traffic::Warning& warning);
-
 public slots:
     /*! \brief Start attempt to connect to traffic receiver
      *
@@ -301,29 +317,95 @@ public slots:
         Q_UNUSED(password)
     }
 
+    /*! \brief Set recorder for the raw data stream
+     *
+     *  Implementations that receive data from a traffic receiver pass the raw
+     *  data to the recorder, if one is set.
+     *
+     *  @param recorder Recorder, or nullptr to stop recording
+     */
+    void setRecorder(std::shared_ptr<Traffic::TrafficDataRecorder> recorder)
+    {
+        m_recorder = std::move(recorder);
+    }
+
 protected:
+    /*! \brief Append a traffic report to the queue
+     *
+     *  This method is called by implementations whenever a traffic factor or
+     *  a traffic warning has been decoded. If the queue is full, the report is
+     *  dropped. The method sets the timestamps of the report and records the
+     *  time spent between reception and decoding in the metric
+     *  "traffic/latency/decode".
+     *
+     *  @param report Traffic report
+     */
+    void publishReport(Traffic::TrafficReport&& report);
+
+    /*! \brief Set time of reception
+     *
+     *  Implementations that read from a socket call this method whenever new
+     *  data arrives, before the data is processed. The time is used as
+     *  reception time for all reports published until the next call.
+     *
+     *  @param timestamp Time of reception, as returned by Metrics::now()
+     */
+    void setReceiveTimestamp(qint64 timestamp)
+    {
+        m_receiveTimestamp = timestamp;
+    }
+
+    /*! \brief Coordinate of ownship
+     *
+     *  The coordinate is used to compute the positions of traffic factors that
+     *  are reported relative to ownship. This method reads
+     *  PositionProvider::lastValidCoordinate() without locks, and converts it
+     *  only when it has changed, so that it is cheap to call for every report.
+     *
+     *  @returns Last valid coordinate of ownship
+     */
+    const QGeoCoordinate& ownshipCoordinate() const;
+
+    /*! \brief Pass raw data to the recorder, if one is set
+     *
+     *  @param channel Kind of data
+     *
+     *  @param data Pointer to the data
+     *
+     *  @param size Size of the data
+     */
+    void record(Traffic::TrafficDataRecorder::Channel channel, const char* data, qint64 size)
+    {
+        if (m_recorder) {
+            m_recorder->append(channel, data, size);
+        }
+    }
+
     /*! \brief Process one FLARM/NMEA sentence
      *
      *  This method expects exactly one line containing a valid FLARM/NMEA
      *  sentence. This is a string typically looks like
      *  "$PFLAA,0,1587,1588,40,1,AA1237,225,,37,-1.6,1*7F".  The method
      *  interprets the string and updates the properties and emits signals as
-     *  appropriate. Invalid strings are silently ignored.
+     *  appropriate. Invalid strings are silently ignored. Trailing line breaks
+     *  are allowed. The sentence is tokenized in place, without copying.
      *
-     *  @param sentence A QString containing a FLARM/NMEA sentence.
+     *  @param sentence A FLARM/NMEA sentence, in Latin-1 encoding
      */
-    void processFLARMSentence(QString sentence);
+    void processFLARMSentence(std::string_view sentence);
 
-    /*! \brief Process one GDL90 message
+    /*! \brief Process GDL90 data
      *
-     *  This method expects exactly one GDL90 message, including starting and
-     *  trailing 0x7e bytes.  The method interprets the string and updates the
-     *  properties and emits signals as appropriate. Invalid messages are
-     *  silently ignored.
+     *  This method expects one or more GDL90 messages, separated by 0x7e flag
+     *  bytes, as found in the datagrams sent by GDL90 traffic receivers. For
+     *  every message, the method decodes the escape characters, checks the
+     *  CRC, interprets the message and updates the properties and emits
+     *  signals as appropriate. All of this is done in a single pass over the
+     *  data. Invalid messages are silently ignored.
      *
-     *  @param message A QByteArray containing a GDL90 message.
+     *  @param data A QByteArray containing GDL90 messages.
      */
-    void processGDLMessage(const QByteArray& message);
+    void processGDLData(const QByteArray& data);
 
     /*! \brief Process one XGPS string
      *
@@ -378,34 +460,86 @@ protected:
     void setTrafficReceiverSelfTestError(const QString& newErrorString);
 
 private:
+    // Counts a message in the metrics "traffic/<sourceName>/messages" or
+    // "traffic/<sourceName>/checksumFailures". The counters are looked up on
+    // first use, because sourceName() cannot be called in the constructor.
+    void countMessage(bool checksumValid);
+
+    // Interprets one decoded GDL90 frame, starting with the message ID and
+    // without the CRC
+    void processGDLFrame(const quint8* frame, int frameSize);
+
+    // Checks if the raw fields of a PFLAU sentence differ from the fields
+    // stored in cache, and stores them
+    static bool fieldsChanged(std::string_view fields, std::array<char, 64>& cache, std::size_t& cacheSize);
+
+    // Raw fields of the last PFLAU sentence: the receiver status (TX, GPS,
+    // power) and the warning (alarm level to horizontal distance). They are
+    // used to detect changes before anything is constructed.
+    std::array<char, 64> m_lastPFLAUStatus {};
+    std::size_t m_lastPFLAUStatusSize {0};
+    std::array<char, 64> m_lastPFLAUWarning {};
+    std::size_t m_lastPFLAUWarningSize {0};
+
+    // Unchanged warnings are published again after this interval, so that
+    // the TrafficDataProvider does not reset the warning
+    static constexpr auto warningRefreshInterval = 5s;
+    QElapsedTimer m_warningRefreshTimer;
+
+    // Time of reception, as set by setReceiveTimestamp()
+    qint64 m_receiveTimestamp {0};
+
+    // Metrics, set by countMessage()
+    Metrics::Counter* m_messagesMetric {nullptr};
+    Metrics::Counter* m_checksumFailuresMetric {nullptr};
+
+    // Scratch buffer for processGDLData(). The longest GDL90 message, the
+    // uplink data message, has 436 bytes.
+    std::array<quint8, 512> m_gdlFrame {};
+
     // Property caches
     QString m_connectivityStatus {};
     QString m_errorString {};
     QString m_trafficReceiverRuntimeError {};
     QString m_trafficReceiverSelfTestError {};
 
+    // Time after which heartbeat and altitude information are considered lost
+    static constexpr auto heartbeatTimeout = 5s;
+    static constexpr auto altitudeTimeout = 5s;
+
     // True altitude of own aircraft. We store these values because the
     // necessary information to compile a PositionInfo class does not always
     // come in one piece.  Whenever a valid altitude is set, the timer should be
     // started. The timer can then be used to check if the altitude information
     // is recent enough to be used. Whenever an invalid altitude is set, the
-    // timer should be stopped.
+    // timer should be stopped. Timers of this class are re-started with
+    // almost every message and therefore use the shared timing wheel.
     Units::Distance m_trueAltitude;
     Units::Distance m_trueAltitudeFOM; // Fig. of Merit
-    QTimer m_trueAltitudeTimer;
+    TimingWheel::Timeout m_trueAltitudeTimer;
 
     // Pressure altitude of own aircraft. See the member m_trueAltitude for a
     // description how the timer should be used.
     Units::Distance m_pressureAltitude;
-    QTimer m_pressureAltitudeTimer;
+    TimingWheel::Timeout m_pressureAltitudeTimer;
 
     // Heartbeat timer
-    QTimer m_heartbeatTimer;
+    TimingWheel::Timeout m_heartbeatTimer {[this]() { resetReceivingHeartbeat(); }};
     bool m_hasHeartbeat {false};
 
-    // Targets
-    Traffic::TrafficFactor_WithPosition m_factor;
-    Traffic::TrafficFactor_DistanceOnly m_factorDistanceOnly;
+    // Queue of decoded traffic reports, and flag that is set while a
+    // reportsAvailable() signal is pending
+    SPSCQueue<Traffic::TrafficReport, 256> m_reports;
+    std::atomic<bool> m_reportsNotified {false};
+
+    // Recorder for the raw data stream, set with setRecorder()
+    std::shared_ptr<Traffic::TrafficDataRecorder> m_recorder;
+
+    // Copy of PositionProvider::lastValidCoordinate(), returned by
+    // ownshipCoordinate(), and the version it was made from. The initial
+    // version is odd, so that the first call always reads the coordinate.
+    mutable QGeoCoordinate m_ownshipCoordinate;
+    mutable quint32 m_ownshipCoordinateVersion {1};
 };
 
 }
@@ -18,7 +18,6 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-#include "GlobalObject.h"
 #include "MobileAdaptor.h"
 #include "traffic/TrafficDataSource_AbstractSocket.h"
 
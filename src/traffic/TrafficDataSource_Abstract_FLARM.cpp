@@ -18,39 +18,67 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-#include "GlobalObject.h"
-#include "MobileAdaptor.h"
-#include "positioning/PositionProvider.h"
-#include "traffic/FlarmnetDB.h"
+#include <algorithm>
+
+#include "Profiler.h"
+#include "traffic/NMEASentence.h"
 #include "traffic/TrafficDataSource_Abstract.h"
 
 
 // Static Helper functions
 
-auto interpretNMEALatLong(const QString& A, const QString& B) -> qreal
+auto interpretNMEALatLong(std::string_view A, std::string_view B, std::size_t degreeDigits) -> qreal
 {
     bool ok1 = false;
     bool ok2 = false;
-    qreal result = A.leftRef(2).toDouble(&ok1) + A.midRef(2).toDouble(&ok2)/60.0;
+    qreal result = Traffic::NMEASentence::toDouble(A.substr(0, degreeDigits), &ok1)
+            + Traffic::NMEASentence::toDouble(A.substr(qMin(degreeDigits, A.size())), &ok2)/60.0;
     if (!ok1 || !ok2) {
         return qQNaN();
     }
 
-    if ((B == u"S") || (B == u"W")) {
+    if ((B == "S") || (B == "W")) {
         result *= -1.0;
     }
     return result;
 }
 
-auto interpretNMEATime(const QString& timeString) -> QDateTime
+auto interpretFLARMTargetID(std::string_view IDType, std::string_view ID, QString& callSign) -> Traffic::TargetID
 {
-    auto HH = timeString.mid(0,2);
-    auto MM = timeString.mid(2,2);
-    auto SS = timeString.mid(4,2);
-    auto MS = timeString.mid(6);
-    QTime time(HH.toInt(), MM.toInt(), SS.toInt());
-    if (MS.isEmpty()) {
-        time = time.addMSecs(qRound(MS.toDouble()*1000.0));
+    // Some devices append the call sign to the ID, in the form "ID!CALLSIGN"
+    auto separator = ID.find('!');
+    if (separator != std::string_view::npos) {
+        auto suffix = ID.substr(separator+1);
+        callSign = QString::fromLatin1(suffix.data(), static_cast<int>(suffix.size()));
+        ID = ID.substr(0, separator);
+    }
+
+    auto addressType = Traffic::TargetID::Anonymous;
+    if (IDType == "1") {
+        addressType = Traffic::TargetID::ICAO;
+    } else if (IDType == "2") {
+        addressType = Traffic::TargetID::FLARM;
+    }
+    return Traffic::TargetID::fromHex(ID, addressType);
+}
+
+auto interpretNMEATime(std::string_view timeString) -> QDateTime
+{
+    if (timeString.size() < 6) {
+        return {};
+    }
+    auto HH = Traffic::NMEASentence::toInt(timeString.substr(0,2));
+    auto MM = Traffic::NMEASentence::toInt(timeString.substr(2,2));
+    auto SS = Traffic::NMEASentence::toInt(timeString.substr(4,2));
+    auto MS = timeString.substr(6);
+    QTime time(HH, MM, SS);
+    if (!MS.empty()) {
+        // MS is of the form ".sss"
+        bool ok = false;
+        auto fraction = Traffic::NMEASentence::toDouble(MS, &ok);
+        if (ok) {
+            time = time.addMSecs(qRound(fraction*1000.0));
+        }
     }
     auto dateTime = QDateTime::currentDateTimeUtc();
     dateTime.setTime(time);
@@ -60,51 +88,46 @@ auto interpretNMEATime(const QString& timeString) -> QDateTime
 
 // Member functions
 
-void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
+auto Traffic::TrafficDataSource_Abstract::fieldsChanged(std::string_view fields, std::array<char, 64>& cache, std::size_t& cacheSize) -> bool
 {
-    if (sentence.isEmpty()) {
-        return;
+    if (std::string_view(cache.data(), cacheSize) == fields) {
+        return false;
     }
 
-    // Check that line starts with a dollar sign
-    if (sentence.isEmpty()) {
-        return;
+    // Fields that do not fit into the cache are never considered unchanged
+    if (fields.size() > cache.size()) {
+        cacheSize = 0;
+        return true;
     }
-    if (sentence[0] != QStringLiteral("$")) {
-        return;
-    }
-    sentence = sentence.mid(1);
+    std::copy(fields.begin(), fields.end(), cache.begin());
+    cacheSize = fields.size();
+    return true;
+}
 
-    // Check the NMEA checksum
-    auto pieces = sentence.split(QStringLiteral("*"));
-    if (pieces.length() != 2) {
-        return;
-    }
-    sentence = pieces[0];
-    auto checksum = pieces[1].toInt(nullptr, 16);
-    quint8 myChecksum = 0;
-    for(auto && i : sentence) {
-        myChecksum ^= static_cast<quint8>(i.toLatin1());
-    }
-    if (checksum != myChecksum) {
-        return;
-    }
 
-    // Split the message into pieces
-    auto arguments = sentence.split(QStringLiteral(","));
-    if (arguments.isEmpty()) {
+void Traffic::TrafficDataSource_Abstract::processFLARMSentence(std::string_view sentence)
+{
+    PROFILER_SCOPE(Profiler::TrafficDecode);
+    // Check framing and NMEA checksum, split the message into pieces
+    NMEASentence arguments;
+    if (!arguments.parse(sentence)) {
+        if (arguments.hasChecksumError()) {
+            countMessage(false);
+        }
         return;
     }
-    auto messageType = arguments.takeFirst();
+    countMessage(true);
 
+    switch(arguments.type()) {
     // NMEA GPS 3D-fix data
-    if (messageType == u"GPGGA") {
-        if (arguments.length() < 9) {
+    case NMEASentence::tag("GPGGA"):
+    {
+        if (arguments.size() < 9) {
             return;
         }
 
         // Quality check
-        if (arguments[5] == u"0") {
+        if (arguments[5] == "0") {
             return;
         }
 
@@ -116,7 +139,7 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
 
         // Get coordinate
         bool ok = false;
-        auto alt = arguments[8].toDouble(&ok);
+        auto alt = arguments.toDouble(8, &ok);
         if (!ok) {
             m_trueAltitude = {};
             m_trueAltitudeFOM = {};
@@ -126,18 +149,19 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
 
         m_trueAltitude = Units::Distance::fromM(alt);
         m_trueAltitudeFOM = {};
-        m_trueAltitudeTimer.start();
+        m_trueAltitudeTimer.start(altitudeTimeout);
         return;
     }
 
     // Recommended minimum specific GPS/Transit data
-    if (messageType == u"GPRMC") {
-        if (arguments.length() < 8) {
+    case NMEASentence::tag("GPRMC"):
+    {
+        if (arguments.size() < 8) {
             return;
         }
 
         // Quality check
-        if (arguments[1] != u"A") {
+        if (arguments[1] != "A") {
             return;
         }
 
@@ -148,24 +172,8 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         }
 
         // Get coordinate
-        bool ok1 = false;
-        bool ok2 = false;
-        auto lat = arguments[2].leftRef(2).toDouble(&ok1) + arguments[2].midRef(2).toDouble(&ok2)/60.0;
-        if (!ok1 || !ok2) {
-            return;
-        }
-        if (arguments[3] == u"S") {
-            lat *= -1.0;
-        }
-
-        auto lon = arguments[4].leftRef(3).toDouble(&ok1) + arguments[4].midRef(3).toDouble(&ok2)/60.0;
-        if (!ok1 || !ok2) {
-            return;
-        }
-        if (arguments[5] == u"W") {
-            lon *= -1.0;
-        }
-
+        auto lat = interpretNMEALatLong(arguments[2], arguments[3], 2);
+        auto lon = interpretNMEALatLong(arguments[4], arguments[5], 3);
         QGeoCoordinate coordinate(lat, lon);
         if (!coordinate.isValid()) {
             return;
@@ -173,34 +181,28 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         if (m_trueAltitudeTimer.isActive()) {
             coordinate.setAltitude(m_trueAltitude.toM());
         }
-        QGeoPositionInfo pInfo(coordinate, QDateTime::currentDateTimeUtc());
+        Positioning::PositionInfo pInfo(coordinate, QDateTime::currentDateTimeUtc());
 
         // Ground speed
         bool ok = false;
-        auto groundSpeed = Units::Speed::fromKN(arguments[6].toDouble(&ok));
-        if (!ok) {
-            groundSpeed = Units::Speed::fromKN(qQNaN());
-        }
-        if (groundSpeed.isFinite()) {
-            pInfo.setAttribute(QGeoPositionInfo::GroundSpeed, groundSpeed.toMPS() );
+        auto groundSpeed = Units::Speed::fromKN(arguments.toDouble(6, &ok));
+        if (ok) {
+            pInfo.setGroundSpeed(groundSpeed);
         }
 
         // Track
-        auto TT = arguments[7].toDouble(&ok);
-        if (!ok) {
-            TT = qQNaN();
-        }
-        if (TT != qQNaN()) {
-            pInfo.setAttribute(QGeoPositionInfo::Direction, TT );
+        auto TT = arguments.toDouble(7, &ok);
+        if (ok) {
+            pInfo.setDirection(Units::Angle::fromDEG(TT));
         }
 
-        emit positionUpdated( Positioning::PositionInfo(pInfo));
+        emit positionUpdated(pInfo);
         return;
     }
 
     // Data on other proximate aircraft
-    if (messageType == u"PFLAA") {
-
+    case NMEASentence::tag("PFLAA"):
+    {
         // Helper variable
         bool ok = false;
 
@@ -209,7 +211,7 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         //
 
         // Alarm level is mandatory
-        auto alarmLevel = arguments[0].toInt(&ok);
+        auto alarmLevel = arguments.toInt(0, &ok);
         if (!ok) {
             return;
         }
@@ -219,59 +221,60 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
 
         // Relative vertical information is optional
         // Vertical distance is optional
-        auto vDist = Units::Distance::fromM(arguments[3].toDouble(&ok));
+        auto vDist = Units::Distance::fromM(arguments.toDouble(3, &ok));
         if (!ok) {
             vDist = Units::Distance::fromM(qQNaN());
         }
 
         // Target type is optional
         Traffic::TrafficFactor_Abstract::AircraftType type = Traffic::TrafficFactor_Abstract::unknown;
-        {
-            auto targetType = arguments[10];
-            if (targetType == u"1") {
+        if (arguments[10].size() == 1) {
+            switch(arguments[10][0]) {
+            case '1':
                 type = Traffic::TrafficFactor_Abstract::Glider;
-            }
-            if (targetType == u"2") {
+                break;
+            case '2':
                 type = Traffic::TrafficFactor_Abstract::TowPlane;
-            }
-            if (targetType == u"3") {
+                break;
+            case '3':
                 type = Traffic::TrafficFactor_Abstract::Copter;
-            }
-            if (targetType == u"4") {
+                break;
+            case '4':
                 type = Traffic::TrafficFactor_Abstract::Skydiver;
-            }
-            if (targetType == u"5") {
+                break;
+            case '5':
+            case '8':
                 type = Traffic::TrafficFactor_Abstract::Aircraft;
-            }
-            if (targetType == u"6") {
+                break;
+            case '6':
                 type = Traffic::TrafficFactor_Abstract::HangGlider;
-            }
-            if (targetType == u"7") {
+                break;
+            case '7':
                 type = Traffic::TrafficFactor_Abstract::Paraglider;
-            }
-            if (targetType == u"8") {
-                type = Traffic::TrafficFactor_Abstract::Aircraft;
-            }
-            if (targetType == u"9") {
+                break;
+            case '9':
                 type = Traffic::TrafficFactor_Abstract::Jet;
-            }
-            if (targetType == u"B") {
+                break;
+            case 'B':
                 type = Traffic::TrafficFactor_Abstract::Balloon;
-            }
-            if (targetType == u"C") {
+                break;
+            case 'C':
                 type = Traffic::TrafficFactor_Abstract::Airship;
-            }
-            if (targetType == u"D") {
+                break;
+            case 'D':
                 type = Traffic::TrafficFactor_Abstract::Drone;
-            }
-            if (targetType == u"F") {
+                break;
+            case 'F':
                 type = Traffic::TrafficFactor_Abstract::StaticObstacle;
+                break;
+            default:
+                break;
             }
         }
 
         // Ground speed it optimal. If ground speed is zero that means:
         // target is on the ground. Ignore these targets, unless they are known static obstacles!
-        auto groundSpeedInMPS = arguments[8].toDouble(&ok);
+        auto groundSpeedInMPS = arguments.toDouble(8, &ok);
         if (!ok) {
             groundSpeedInMPS = qQNaN();
         }
@@ -280,40 +283,28 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         }
 
 
-        // Target ID is optional
-        auto targetID = arguments[5];
-
-
         //
         // Handle non-directional targets
         //
-        if (arguments[2] == u"") {
+        if (arguments[2].empty()) {
             // Horizontal distance is mandatory
-            auto hDist = Units::Distance::fromM(arguments[1].toDouble(&ok));
+            auto hDist = Units::Distance::fromM(arguments.toDouble(1, &ok));
             if (!ok) {
                 return;
             }
 
-            // Construct a PositionInfo object that contains additional information (such as ground speed, if available)
-            QGeoPositionInfo pInfo(QGeoCoordinate(), QDateTime::currentDateTimeUtc());
-            auto targetGS = arguments[8].toDouble(&ok);
-            if (ok) {
-                pInfo.setAttribute(QGeoPositionInfo::GroundSpeed, targetGS);
-            }
-            auto targetVS = arguments[9].toDouble(&ok);
-            if (ok) {
-                pInfo.setAttribute(QGeoPositionInfo::VerticalSpeed, targetVS);
-            }
-
-            m_factorDistanceOnly.setAlarmLevel(alarmLevel);
-            m_factorDistanceOnly.setCallSign( GlobalObject::flarmnetDB()->getRegistration(targetID) );
-            m_factorDistanceOnly.setCoordinate(Positioning::PositionProvider::lastValidCoordinate());
-            m_factorDistanceOnly.setID(targetID);
-            m_factorDistanceOnly.setHDist(hDist);
-            m_factorDistanceOnly.setType(type);
-            m_factorDistanceOnly.setVDist(vDist);
-            m_factorDistanceOnly.startLiveTime();
-            emit factorWithoutPosition(m_factorDistanceOnly);
+            // Target ID is optional. Unless the device appends it to the ID,
+            // the call sign is left empty; TrafficDataProvider looks it up in
+            // the Flarmnet database.
+            TrafficReport report;
+            report.ID = interpretFLARMTargetID(arguments[4], arguments[5], report.callSign);
+            report.kind = TrafficReport::FactorWithoutPosition;
+            report.alarmLevel = alarmLevel;
+            report.coordinate = ownshipCoordinate();
+            report.hDist = hDist;
+            report.type = type;
+            report.vDist = vDist;
+            publishReport(std::move(report));
             return;
         }
 
@@ -322,16 +313,16 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         //
 
         // As a first step, we obtain the target's coordinate. We take our own coordinate as a starting point.
-        auto targetCoordinate = Positioning::PositionProvider::lastValidCoordinate();
+        auto targetCoordinate = ownshipCoordinate();
         if (!targetCoordinate.isValid()) {
             return;
         }
-        auto relativeNorth = arguments[1].toDouble(&ok);
+        auto relativeNorth = arguments.toDouble(1, &ok);
         if (!ok) {
             return;
         }
         targetCoordinate = targetCoordinate.atDistanceAndAzimuth(relativeNorth, 0);
-        auto relativeEast = arguments[2].toDouble(&ok);
+        auto relativeEast = arguments.toDouble(2, &ok);
         if (!ok) {
             return;
         }
@@ -342,36 +333,39 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         auto hDist = Units::Distance::fromM(sqrt(relativeNorth*relativeNorth+relativeEast*relativeEast));
 
         // Construct a PositionInfo object that contains additional information (such as ground speed, if available)
-        QGeoPositionInfo pInfo(targetCoordinate, QDateTime::currentDateTimeUtc());
-        auto targetTT = arguments[6].toInt(&ok);
+        Positioning::PositionInfo pInfo(targetCoordinate, QDateTime::currentDateTimeUtc());
+        auto targetTT = arguments.toInt(6, &ok);
         if (ok) {
-            pInfo.setAttribute(QGeoPositionInfo::Direction, targetTT);
+            pInfo.setDirection(Units::Angle::fromDEG(targetTT));
         }
-        auto targetGS = arguments[8].toDouble(&ok);
+        auto targetGS = arguments.toDouble(8, &ok);
         if (ok) {
-            pInfo.setAttribute(QGeoPositionInfo::GroundSpeed, targetGS);
+            pInfo.setGroundSpeed(Units::Speed::fromMPS(targetGS));
         }
-        auto targetVS = arguments[9].toDouble(&ok);
+        auto targetVS = arguments.toDouble(9, &ok);
         if (ok) {
-            pInfo.setAttribute(QGeoPositionInfo::VerticalSpeed, targetVS);
-        }
-
-        // Construct a traffic object
-        m_factor.setAlarmLevel(alarmLevel);
-        m_factor.setCallSign( GlobalObject::flarmnetDB()->getRegistration(targetID) );
-        m_factor.setHDist(hDist);
-        m_factor.setID(targetID);
-        m_factor.setPositionInfo(pInfo);
-        m_factor.setType(type);
-        m_factor.setVDist(vDist);
-        m_factor.startLiveTime();
-        emit factorWithPosition(m_factor);
+            pInfo.setVerticalSpeed(Units::Speed::fromMPS(targetVS));
+        }
+
+        // Construct a traffic report. Unless the device appends it to the ID,
+        // the call sign is left empty; TrafficDataProvider looks it up in the
+        // Flarmnet database.
+        TrafficReport report;
+        report.ID = interpretFLARMTargetID(arguments[4], arguments[5], report.callSign);
+        report.kind = TrafficReport::FactorWithPosition;
+        report.alarmLevel = alarmLevel;
+        report.hDist = hDist;
+        report.positionInfo = pInfo;
+        report.type = type;
+        report.vDist = vDist;
+        publishReport(std::move(report));
         return;
     }
 
     // Self-test result and errors codes
-    if (messageType == u"PFLAE") {
-        if (arguments.length() < 3) {
+    case NMEASentence::tag("PFLAE"):
+    {
+        if (arguments.size() < 3) {
             return;
         }
 
@@ -379,218 +373,254 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         auto errorCode = arguments[2];
 
         QStringList results;
-        if (severity == u"0") {
+        if (severity == "0") {
             results << tr("No Error");
         }
-        if (severity == u"1") {
+        if (severity == "1") {
             results << tr("Normal Operation");
         }
-        if (severity == u"2") {
+        if (severity == "2") {
             results << tr("Reduced Functionality");
         }
-        if (severity == u"3") {
+        if (severity == "3") {
             results << tr("Device INOP");
         }
 
-        if (!errorCode.isEmpty()) {
-            results << tr("Error code: %1").arg(errorCode);
+        if (!errorCode.empty()) {
+            results << tr("Error code: %1").arg(arguments.toString(2));
         }
-        if (errorCode == u"11") {
+        if (errorCode == "11") {
             results << tr("Firmware expired");
         }
-        if (errorCode == u"12") {
+        if (errorCode == "12") {
             results << tr("Firmware update error");
         }
-        if (errorCode == u"21") {
+        if (errorCode == "21") {
             results << tr("Power (Voltage < 8V)");
         }
-        if (errorCode == u"22") {
+        if (errorCode == "22") {
             results << tr("UI error");
         }
-        if (errorCode == u"23") {
+        if (errorCode == "23") {
             results << tr("Audio error");
         }
-        if (errorCode == u"24") {
+        if (errorCode == "24") {
             results << tr("ADC error");
         }
-        if (errorCode == u"25") {
+        if (errorCode == "25") {
             results << tr("SD card error");
         }
-        if (errorCode == u"26") {
+        if (errorCode == "26") {
             results << tr("USB error");
         }
-        if (errorCode == u"27") {
+        if (errorCode == "27") {
             results << tr("LED error");
         }
-        if (errorCode == u"28") {
+        if (errorCode == "28") {
             results << tr("EEPROM error");
         }
-        if (errorCode == u"29") {
+        if (errorCode == "29") {
             results << tr("General hardware error");
         }
-        if (errorCode == u"2A") {
+        if (errorCode == "2A") {
             results << tr("Transponder receiver Mode-C/S/ADS-B unserviceable");
         }
-        if (errorCode == u"2B") {
+        if (errorCode == "2B") {
             results << tr("EEPROM error");
         }
-        if (errorCode == u"2C") {
+        if (errorCode == "2C") {
             results << tr("GPIO error");
         }
-        if (errorCode == u"31") {
+        if (errorCode == "31") {
             results << tr("GPS communication");
         }
-        if (errorCode == u"32") {
+        if (errorCode == "32") {
             results << tr("Configuration of GPS module");
         }
-        if (errorCode == u"33") {
+        if (errorCode == "33") {
             results << tr("GPS antenna");
         }
-        if (errorCode == u"41") {
+        if (errorCode == "41") {
             results << tr("RF communication");
         }
-        if (errorCode == u"42") {
+        if (errorCode == "42") {
             results << tr("Another FLARM device with the same Radio ID is being received. Alarms are suppressed for the relevant device.");
         }
-        if (errorCode == u"43") {
+        if (errorCode == "43") {
             results << tr("Wrong ICAO 24-bit address or radio ID");
         }
-        if (errorCode == u"51") {
+        if (errorCode == "51") {
             results << tr("Communication");
         }
-        if (errorCode == u"61") {
+        if (errorCode == "61") {
             results << tr("Flash memory");
         }
-        if (errorCode == u"71") {
+        if (errorCode == "71") {
             results << tr("Pressure sensor");
         }
-        if (errorCode == u"81") {
+        if (errorCode == "81") {
             results << tr("Obstacle database (e.g. incorrect file type)");
         }
-        if (errorCode == u"82") {
+        if (errorCode == "82") {
             results << tr("Obstacle database expired.");
         }
-        if (errorCode == u"91") {
+        if (errorCode == "91") {
             results << tr("Flight recorder");
         }
-        if (errorCode == u"93") {
+        if (errorCode == "93") {
             results << tr("Engine-noise recording not possible");
         }
-        if (errorCode == u"94") {
+        if (errorCode == "94") {
             results << tr("Range analyzer");
         }
-        if (errorCode == u"A1") {
+        if (errorCode == "A1") {
             results << tr("Configuration error, e.g. while reading flarmcfg.txt from SD/USB.");
         }
-        if (errorCode == u"B1") {
+        if (errorCode == "B1") {
             results << tr("Invalid obstacle database license (e.g. wrong serial number)");
         }
-        if (errorCode == u"B2") {
+        if (errorCode == "B2") {
             results << tr("Invalid IGC feature license");
         }
-        if (errorCode == u"B3") {
+        if (errorCode == "B3") {
             results << tr("Invalid AUD feature license");
         }
-        if (errorCode == u"B4") {
+        if (errorCode == "B4") {
             results << tr("Invalid ENL feature license");
         }
-        if (errorCode == u"B5") {
+        if (errorCode == "B5") {
             results << tr("Invalid RFB feature license");
         }
-        if (errorCode == u"B6") {
+        if (errorCode == "B6") {
             results << tr("Invalid TIS feature license");
         }
-        if (errorCode == u"100") {
+        if (errorCode == "100") {
             results << tr("Generic error");
         }
-        if (errorCode == u"101") {
+        if (errorCode == "101") {
             results << tr("Flash File System error");
         }
-        if (errorCode == u"110") {
+        if (errorCode == "110") {
             results << tr("Failure updating firmware of external display");
         }
-        if (errorCode == u"120") {
+        if (errorCode == "120") {
             results << tr("Device is operated outside the designated region. The device does not work.");
         }
         auto result = results.join(QStringLiteral(" • "));
 
         // Emit results of self-test
-        if ((severity == u"2") || (severity == u"3")) {
+        if ((severity == "2") || (severity == "3")) {
             setTrafficReceiverSelfTestError(result);
         }
         return;
     }
 
     // Debug Information -- Ignore
-    if (messageType == u"PFLAS") {
+    case NMEASentence::tag("PFLAS"):
         return;
-    }
 
     // FLARM Heartbeat
-    if (messageType == u"PFLAU") {
+    case NMEASentence::tag("PFLAU"):
+    {
+        static auto* receivedMetric = Metrics::counter(QStringLiteral("traffic/flarm/pflauReceived"));
+        static auto* publishedMetric = Metrics::counter(QStringLiteral("traffic/flarm/warningsPublished"));
+
         // Heartbeat received.
         setReceivingHeartbeat(true);
 
-        if (arguments.length() < 9) {
+        if (arguments.size() < 9) {
             return;
         }
+        receivedMetric->add();
+
+        // Fields are contiguous in the sentence, so ranges of fields can be
+        // compared with the cached raw fields of the last sentence
+        auto fieldRange = [&arguments](int first, int last) {
+            auto begin = arguments[first].data();
+            auto end = arguments[last].data()+arguments[last].size();
+            return std::string_view(begin, static_cast<std::size_t>(end-begin));
+        };
 
         // Handle runtime errors
-        QStringList results;
-        // auto RX = arguments[0];
-        auto TX = arguments[1];
-        if (TX == "0") {
-            results += tr("No FLARM transmission");
-        }
-        auto GPS = arguments[2];
-        if (GPS == "0") {
-            results += tr("No GPS reception");
+        if (fieldsChanged(fieldRange(1, 3), m_lastPFLAUStatus, m_lastPFLAUStatusSize)) {
+            QStringList results;
+            // auto RX = arguments[0];
+            auto TX = arguments[1];
+            if (TX == "0") {
+                results += tr("No FLARM transmission");
+            }
+            auto GPS = arguments[2];
+            if (GPS == "0") {
+                results += tr("No GPS reception");
+            }
+            auto Power = arguments[3];
+            if (Power == "0") {
+                results += tr("Under- or Overvoltage");
+            }
+            setTrafficReceiverRuntimeError(results.isEmpty() ? QString() : results.join(QStringLiteral(" • ")));
         }
-        auto Power = arguments[3];
-        if (Power == "0") {
-            results += tr("Under- or Overvoltage");
+
+        // Unchanged warnings are only published once in a while
+        if (!fieldsChanged(fieldRange(4, 8), m_lastPFLAUWarning, m_lastPFLAUWarningSize)
+                && m_warningRefreshTimer.isValid()
+                && !m_warningRefreshTimer.hasExpired(std::chrono::milliseconds(warningRefreshInterval).count())) {
+            return;
         }
-        setTrafficReceiverRuntimeError(results.join(" • "));
+        m_warningRefreshTimer.start();
+        publishedMetric->add();
 
-        auto AlarmLevel = arguments[4];
-        auto RelativeBearing = arguments[5];
-        auto AlarmType = arguments[6];
-        auto RelativeVertical = arguments[7];
-        auto RelativeDistance = arguments[8];
+        // Alarm level and alarm type are -1 unless they have one of the
+        // values documented by FLARM
+        bool ok = false;
+        auto alarmLevel = arguments.toInt(4, &ok);
+        if (!ok || (arguments[4].size() != 1) || (alarmLevel < 0) || (alarmLevel > 3)) {
+            alarmLevel = -1;
+        }
+        auto alarmType = arguments.toInt(6, &ok);
+        if (!ok || (arguments[6].size() != 1) || (alarmType < 2) || (alarmType > 4)) {
+            alarmType = -1;
+        }
+        auto relativeBearing = Units::Angle::fromDEG(arguments.toDouble(5));
+        auto vDist = Units::Distance::fromM(arguments.toDouble(7));
+        auto hDist = Units::Distance::fromM(arguments.toDouble(8));
 
-        auto wrning = Traffic::Warning(AlarmLevel, RelativeBearing, AlarmType, RelativeVertical, RelativeDistance);
-        emit warning(wrning);
+        TrafficReport report;
+        report.kind = TrafficReport::TrafficWarning;
+        report.warning = Traffic::Warning(alarmLevel, relativeBearing, alarmType, vDist, hDist);
+        publishReport(std::move(report));
 
         return;
     }
 
     // Version information
-    if (messageType == u"PFLAV") {
-        if (arguments.length() < 4) {
+    case NMEASentence::tag("PFLAV"):
+    {
+        if (arguments.size() < 4) {
             return;
         }
 
-        emit trafficReceiverHwVersion(arguments[1]);
-        emit trafficReceiverSwVersion(arguments[2]);
-        emit trafficReceiverObVersion(arguments[3]);
+        emit trafficReceiverHwVersion(arguments.toString(1));
+        emit trafficReceiverSwVersion(arguments.toString(2));
+        emit trafficReceiverObVersion(arguments.toString(3));
 
 
         return;
     }
 
     // Garmin's barometric altitude
-    if (messageType == u"PGRMZ") {
-        if (arguments.length() < 2) {
+    case NMEASentence::tag("PGRMZ"):
+    {
+        if (arguments.size() < 2) {
             return;
         }
 
         // Quality check
-        if (arguments[1] != u"F") {
+        if (arguments[1] != "F") {
             return;
         }
 
         bool ok = false;
-        auto barometricAlt = Units::Distance::fromFT(arguments[0].toDouble(&ok));
+        auto barometricAlt = Units::Distance::fromFT(arguments.toDouble(0, &ok));
         if (!ok) {
             return;
         }
@@ -601,4 +631,8 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         emit pressureAltitudeUpdated(barometricAlt);
         return;
     }
+
+    default:
+        return;
+    }
 }
@@ -18,59 +18,25 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-#include <array>
-
-#include "GlobalObject.h"
+#include "Profiler.h"
 #include "positioning/Geoid.h"
-#include "positioning/PositionProvider.h"
+#include "traffic/GDL90CRC.h"
 #include "traffic/TrafficDataSource_Abstract.h"
 
-const std::array<quint16, 256> Crc16Table =
-{ 0, 4129, 8258, 12387, 16516, 20645, 24774, 28903, 33032, 37161,
-  41290, 45419, 49548, 53677, 57806, 61935, 4657, 528, 12915,
-  8786, 21173, 17044, 29431, 25302, 37689, 33560, 45947, 41818,
-  54205, 50076, 62463, 58334, 9314, 13379, 1056, 5121, 25830,
-  29895, 17572, 21637, 42346, 46411, 34088, 38153, 58862, 62927,
-  50604, 54669, 13907, 9842, 5649, 1584, 30423, 26358, 22165,
-  18100, 46939, 42874, 38681, 34616, 63455, 59390, 55197, 51132,
-  18628, 22757, 26758, 30887, 2112, 6241, 10242, 14371, 51660,
-  55789, 59790, 63919, 35144, 39273, 43274, 47403, 23285, 19156,
-  31415, 27286, 6769, 2640, 14899, 10770, 56317, 52188, 64447,
-  60318, 39801, 35672, 47931, 43802, 27814, 31879, 19684, 23749,
-  11298, 15363, 3168, 7233, 60846, 64911, 52716, 56781, 44330,
-  48395, 36200, 40265, 32407, 28342, 24277, 20212, 15891, 11826,
-  7761, 3696, 65439, 61374, 57309, 53244, 48923, 44858, 40793,
-  36728, 37256, 33193, 45514, 41451, 53516, 49453, 61774, 57711,
-  4224, 161, 12482, 8419, 20484, 16421, 28742, 24679, 33721,
-  37784, 41979, 46042, 49981, 54044, 58239, 62302, 689, 4752,
-  8947, 13010, 16949, 21012, 25207, 29270, 46570, 42443, 38312,
-  34185, 62830, 58703, 54572, 50445, 13538, 9411, 5280, 1153,
-  29798, 25671, 21540, 17413, 42971, 47098, 34713, 38840, 59231,
-  63358, 50973, 55100, 9939, 14066, 1681, 5808, 26199, 30326,
-  17941, 22068, 55628, 51565, 63758, 59695, 39368, 35305, 47498,
-  43435, 22596, 18533, 30726, 26663, 6336, 2273, 14466, 10403,
-  52093, 56156, 60223, 64286, 35833, 39896, 43963, 48026, 19061,
-  23124, 27191, 31254, 2801, 6864, 10931, 14994, 64814, 60687,
-  56684, 52557, 48554, 44427, 40424, 36297, 31782, 27655, 23652,
-  19525, 15522, 11395, 7392, 3265, 61215, 65342, 53085, 57212,
-  44955, 49082, 36825, 40952, 28183, 32310, 20053, 24180, 11923,
-  16050, 3793, 7920 };
-
-
 // Static Helper functions
 
 
-auto pInfoFromOwnshipReport(const QByteArray &decodedData) -> QGeoPositionInfo
+auto pInfoFromOwnshipReport(const quint8* decodedData, int length) -> Positioning::PositionInfo
 {
     // Check message size
-    if (decodedData.length() != 27) {
+    if (length != 27) {
         return {};
     }
 
     // Find latitude
-    auto la0 = static_cast<quint8>(decodedData.at(4));
-    auto la1 = static_cast<quint8>(decodedData.at(5));
-    auto la2 = static_cast<quint8>(decodedData.at(6));
+    auto la0 = decodedData[4];
+    auto la1 = decodedData[5];
+    auto la2 = decodedData[6];
     qint32 laInt = (la0 << 16) + (la1 << 8) + la2;
     if (laInt > 8388607) {
         laInt -= 16777216;
@@ -78,9 +44,9 @@ auto pInfoFromOwnshipReport(const QByteArray &decodedData) -> QGeoPositionInfo
     double lat = (180.0/0x800000)*laInt;
 
     // Find longitude
-    auto ln0 = static_cast<quint8>(decodedData.at(7));
-    auto ln1 = static_cast<quint8>(decodedData.at(8));
-    auto ln2 = static_cast<quint8>(decodedData.at(9));
+    auto ln0 = decodedData[7];
+    auto ln1 = decodedData[8];
+    auto ln2 = decodedData[9];
     qint32 lnInt = (ln0 << 16) + (ln1 << 8) + ln2;
     if (lnInt > 8388607) {
         lnInt -= 16777216;
@@ -92,71 +58,75 @@ auto pInfoFromOwnshipReport(const QByteArray &decodedData) -> QGeoPositionInfo
     if (!coordinate.isValid()) {
         return {};
     }
-    QGeoPositionInfo pInfo(coordinate, QDateTime::currentDateTimeUtc());
+    Positioning::PositionInfo pInfo(coordinate, QDateTime::currentDateTimeUtc());
 
     // Find Navigation Accuracy Category for Position
-    auto a = static_cast<quint8>(decodedData.at(12)) & 0x0FU;
+    auto a = decodedData[12] & 0x0FU;
     switch (a) {
     case 1:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(10.0).toM() );
+        pInfo.setPositionErrorEstimate(Units::Distance::fromNM(10.0));
         break;
     case 2:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(4.0).toM() );
+        pInfo.setPositionErrorEstimate(Units::Distance::fromNM(4.0));
         break;
     case 3:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(2.0).toM() );
+        pInfo.setPositionErrorEstimate(Units::Distance::fromNM(2.0));
         break;
     case 4:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(1.0).toM() );
+        pInfo.setPositionErrorEstimate(Units::Distance::fromNM(1.0));
         break;
     case 5:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(0.5).toM() );
+        pInfo.setPositionErrorEstimate(Units::Distance::fromNM(0.5));
         break;
     case 6:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(0.3).toM() );
+        pInfo.setPositionErrorEstimate(Units::Distance::fromNM(0.3));
         break;
     case 7:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(0.1).toM() );
+        pInfo.setPositionErrorEstimate(Units::Distance::fromNM(0.1));
         break;
     case 8:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(0.05).toM() );
+        pInfo.setPositionErrorEstimate(Units::Distance::fromNM(0.05));
         break;
     case 9:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, 30.0 );
+        pInfo.setPositionErrorEstimate(Units::Distance::fromM(30.0));
         break;
     case 10:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, 10.0 );
+        pInfo.setPositionErrorEstimate(Units::Distance::fromM(10.0));
         break;
     case 11:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, 3.0 );
+        pInfo.setPositionErrorEstimate(Units::Distance::fromM(3.0));
         break;
     default:
         break;
     }
 
     // Find horizontal speed if available
-    auto hh0 = static_cast<quint8>(decodedData.at(13));
-    auto hh1 = static_cast<quint8>(decodedData.at(14));
+    auto hh0 = decodedData[13];
+    auto hh1 = decodedData[14];
     quint32 hhTmp = (hh0 << 4) + (hh1 >> 4);
     if (hhTmp != 0xFFF) {
         Units::Speed hSpeed = Units::Speed::fromKN(hhTmp);
-        pInfo.setAttribute(QGeoPositionInfo::GroundSpeed, hSpeed.toMPS() );
+        pInfo.setGroundSpeed(hSpeed);
     }
 
-    // Find vertical speed if available
-    auto vv0 = static_cast<quint8>(decodedData.at(14)) & 0x0FU;
-    auto vv1 = static_cast<quint8>(decodedData.at(15));
-    quint32 vvTmp = (vv0 << 8) + vv1;
-    if (vvTmp != 0xFFF) {
+    // Find vertical speed if available. The value is a signed 12-bit
+    // integer, 0x800 means that no information is available
+    auto vv0 = decodedData[14] & 0x0FU;
+    auto vv1 = decodedData[15];
+    qint32 vvTmp = (vv0 << 8) + vv1;
+    if (vvTmp != 0x800) {
+        if (vvTmp > 2047) {
+            vvTmp -= 4096;
+        }
         Units::Speed vSpeed = Units::Speed::fromFPM(vvTmp*64.0);
-        pInfo.setAttribute(QGeoPositionInfo::VerticalSpeed, vSpeed.toMPS() );
+        pInfo.setVerticalSpeed(vSpeed);
     }
 
     // Find true track if available
-    auto mm0 = static_cast<quint8>(decodedData.at(11)) & 0x03U;
+    auto mm0 = decodedData[11] & 0x03U;
     if (mm0 == 1)  {
-        auto tt = static_cast<quint8>(decodedData.at(16));
-        pInfo.setAttribute(QGeoPositionInfo::Direction, tt*360.0/256.0 );
+        auto tt = decodedData[16];
+        pInfo.setDirection(Units::Angle::fromDEG(tt*360.0/256.0));
     }
 
     return pInfo;
@@ -165,66 +135,75 @@ auto pInfoFromOwnshipReport(const QByteArray &decodedData) -> QGeoPositionInfo
 
 // Member functions
 
-void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& rawMessage)
+void Traffic::TrafficDataSource_Abstract::processGDLData(const QByteArray& data)
 {
-
-    //
-    // Do some trivial consistency checks
-    //
-
-    if (rawMessage.size() < 3) {
-        return;
-    }
-
-
-    //
-    // Escape character decoding.
-    //
-    QByteArray message;
-    {
-        message.reserve(rawMessage.size());
-        bool isEscaped = false;
-        foreach(auto byte, rawMessage) {
-            if (byte == 0x7d) {
-                isEscaped = true;
-                continue;
+    PROFILER_SCOPE(Profiler::TrafficDecode);
+    // Framing, escape character decoding and CRC computation are done in one
+    // pass over the data. The decoded frame is kept in m_gdlFrame. The CRC
+    // covers all bytes of the frame except for the trailing two bytes, which
+    // contain the CRC itself. Bytes are therefore fed into the CRC two bytes
+    // after they have been decoded.
+    int size = 0;
+    quint16 crc = 0;
+    bool isEscaped = false;
+    bool isOverlong = false;
+
+    auto finishFrame = [&]() {
+        if ((size >= 3) && !isEscaped && !isOverlong) {
+            auto savedCRC = static_cast<quint16>(m_gdlFrame[size-2] | (m_gdlFrame[size-1] << 8U));
+            if (crc == savedCRC) {
+                countMessage(true);
+                processGDLFrame(m_gdlFrame.data(), size-2);
+            } else {
+                countMessage(false);
             }
-            if (isEscaped) {
-                message.append( static_cast<char>(static_cast<quint8>(byte) ^ static_cast<quint8>('\x20')) );
-                isEscaped = false;
-                continue;
-            }
-            message.append(byte);
         }
-        if (isEscaped) {
-            return;
+        size = 0;
+        crc = 0;
+        isEscaped = false;
+        isOverlong = false;
+    };
+
+    for(auto byte : data) {
+        auto value = static_cast<quint8>(byte);
+
+        // Flag byte: end of the current frame, start of the next
+        if (value == 0x7e) {
+            finishFrame();
+            continue;
         }
-    }
 
-
-    //
-    // CRC Checksum verification
-    //
-    {
-        quint16 crc = 0;
-        foreach(auto byte, message.chopped(2)) {
-            crc = Crc16Table.at(crc >> 8U) ^ (crc << 8U) ^ static_cast<quint8>(byte);
+        // Escape character decoding
+        if (value == 0x7d) {
+            isEscaped = true;
+            continue;
+        }
+        if (isEscaped) {
+            value ^= 0x20U;
+            isEscaped = false;
         }
 
-        // Extract CRC checksum from data
-        quint16 savedCRC = 0;
-        savedCRC += static_cast<quint8>( message.at(message.size()-1) );
-        savedCRC = (savedCRC << 8U) + static_cast<quint8>( message.at(message.size()-2) );
-        if (crc != savedCRC) {
-            return;
+        if (size == static_cast<int>(m_gdlFrame.size())) {
+            isOverlong = true;
+            continue;
         }
+        if (size >= 2) {
+            crc = gdl90CRCUpdate(crc, m_gdlFrame[size-2]);
+        }
+        m_gdlFrame[size++] = value;
     }
 
+    // Data that does not end with a flag byte
+    finishFrame();
+}
+
 
-    // Extract Message ID, cut off Message ID and checksum from decodedData
-    auto messageID = static_cast<quint8>( message.at(0) );
-    message.chop(2);
-    message = message.mid(1);
+void Traffic::TrafficDataSource_Abstract::processGDLFrame(const quint8* frame, int frameSize)
+{
+    // Extract Message ID, cut off Message ID from frame
+    auto messageID = frame[0];
+    const quint8* message = frame+1;
+    auto messageSize = frameSize-1;
 
 
     //
@@ -233,13 +212,13 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
 
     // Heartbeat message
     if (messageID == 0) {
-        if (message.length() < 3) {
+        if (messageSize < 3) {
             return;
         }
 
         // Handle runtime errors
         QStringList results;
-        auto status = static_cast<quint8>(message.at(0));
+        auto status = message[0];
         if ((status & 1<<7) == 0) {
             results += tr("No GPS reception");
         }
@@ -249,7 +228,7 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
         if ((status & 1<<3) != 0) {
             results += tr("GPS Battery low voltage");
         }
-        setTrafficReceiverRuntimeError(results.join(" • "));
+        setTrafficReceiverRuntimeError(results.isEmpty() ? QString() : results.join(QStringLiteral(" • ")));
 
         setReceivingHeartbeat(true);
         return;
@@ -259,26 +238,24 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
     if (messageID == 10) {
 
         // Get position info w/o altitude information
-        auto pInfo = pInfoFromOwnshipReport(message);
+        auto pInfo = pInfoFromOwnshipReport(message, messageSize);
         if (!pInfo.isValid()) {
             return;
         }
 
         // Copy true altitude into pInfo, if known
         if (m_trueAltitudeTimer.isActive()) {
-            auto coordinate = pInfo.coordinate();
-            coordinate.setAltitude(m_trueAltitude.toM());
-            pInfo.setCoordinate(coordinate);
-            pInfo.setAttribute(QGeoPositionInfo::VerticalAccuracy, m_trueAltitudeFOM.toM() );
+            pInfo.setTrueAltitude(m_trueAltitude);
+            pInfo.setTrueAltitudeErrorEstimate(m_trueAltitudeFOM);
         }
 
         // Find pressure altitude and update information if need be
-        auto dd0 = static_cast<quint8>(message.at(10));
-        auto dd1 = static_cast<quint8>(message.at(11));
+        auto dd0 = message[10];
+        auto dd1 = message[11];
         quint32 ddTmp = (dd0 << 4) + (dd1 >> 4);
         if (ddTmp != 0xFFF) {
             m_pressureAltitude = Units::Distance::fromFT(25.0*ddTmp - 1000.0);
-            m_pressureAltitudeTimer.start();
+            m_pressureAltitudeTimer.start(altitudeTimeout);
         } else {
             m_pressureAltitude = Units::Distance::fromM( qQNaN() );
             m_pressureAltitudeTimer.stop();
@@ -286,31 +263,35 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
         emit pressureAltitudeUpdated(m_pressureAltitude);
 
         // Update position information and continue
-        emit positionUpdated( Positioning::PositionInfo(pInfo) );
+        emit positionUpdated(pInfo);
         return;
     }
 
     // Ownship geometric altitude
     if (messageID == 11) {
+        if (messageSize < 4) {
+            return;
+        }
+
         // Find geometric alt and apply geoid correction
-        auto dd0 = static_cast<quint8>(message.at(0));
-        auto dd1 = static_cast<quint8>(message.at(1));
+        auto dd0 = message[0];
+        auto dd1 = message[1];
         qint32 ddInt = (dd0 << 8) + dd1;
         if (ddInt > 32767) {
             ddInt -= 65536;
         }
         m_trueAltitude = Units::Distance::fromFT(ddInt*5.0);
-        auto geoidCorrection = Positioning::Geoid::separation( Positioning::PositionProvider::lastValidCoordinate() );
+        auto geoidCorrection = Positioning::Geoid::separation(ownshipCoordinate());
         if (geoidCorrection.isFinite()) {
             m_trueAltitude = m_trueAltitude-geoidCorrection;
         }
 
         // Find geometric figure of merit
-        auto vm0 = static_cast<quint8>(message.at(2)) & 0x7FU;
-        auto vm1 = static_cast<quint8>(message.at(3));
+        auto vm0 = message[2] & 0x7FU;
+        auto vm1 = message[3];
         auto vmInt = (vm0 << 8) + vm1;
         m_trueAltitudeFOM = Units::Distance::fromM(vmInt);
-        m_trueAltitudeTimer.start();
+        m_trueAltitudeTimer.start(altitudeTimeout);
 
 
     }
@@ -319,24 +300,25 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
     if (messageID == 20) {
 
         // Get position info w/o altitude information
-        auto pInfo = pInfoFromOwnshipReport(message);
+        auto pInfo = pInfoFromOwnshipReport(message, messageSize);
         if (!pInfo.isValid()) {
             return;
         }
 
-        // Get ID
-        auto id0 = static_cast<quint8>(message.at(0)) & 0x0FU;
-        auto id1 = static_cast<quint8>(message.at(1));
-        auto id2 = static_cast<quint8>(message.at(2));
-        auto id3 = static_cast<quint8>(message.at(3));
-        auto id = QString::number(id0, 16) + QString::number(id1, 16) + QString::number(id2, 16) + QString::number(id3, 16);
+        // Get ID. Address types 0 (ADS-B) and 2 (TIS-B) carry the ICAO
+        // address of the aircraft, so that targets seen by a FLARM and by an
+        // ADS-B receiver get the same ID. All other address types are
+        // self-assigned or ground-assigned track numbers.
+        auto address = (quint32(message[1]) << 16) | (quint32(message[2]) << 8) | quint32(message[3]);
+        auto addressType = message[0] & 0x0F;
+        Traffic::TargetID id(address, ((addressType == 0) || (addressType == 2)) ? Traffic::TargetID::ICAO : Traffic::TargetID::Anonymous);
 
         // Alert
-        auto s0 = static_cast<quint8>(message.at(0)) >> 4;
+        auto s0 = message[0] >> 4;
         auto alert = (s0 == 1) ? 1 : 0;
 
         // Traffic type
-        auto ee = static_cast<quint8>(message.at(17));
+        auto ee = message[17];
         auto type = Traffic::TrafficFactor_Abstract::unknown;
         switch(ee) {
         case 1:
@@ -375,8 +357,8 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
         // a recent pressure altitude reading for owncraft exists.
         Units::Distance vDist {};
         if (m_pressureAltitudeTimer.isActive()) {
-            auto dd0 = static_cast<quint8>(message.at(10));
-            auto dd1 = static_cast<quint8>(message.at(11));
+            auto dd0 = message[10];
+            auto dd1 = message[11];
             quint32 ddTmp = (dd0 << 4) + (dd1 >> 4);
             if (ddTmp != 0xFFF) {
                 auto trafficPressureAltitude = Units::Distance::fromFT(25.0*ddTmp - 1000.0);
@@ -385,9 +367,7 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
                 // Compute true altitude of traffic if possible
                 if (m_trueAltitudeTimer.isActive()) {
                     auto trafficTrueAltitude = m_trueAltitude + vDist;
-                    auto coordinate = pInfo.coordinate();
-                    coordinate.setAltitude(trafficTrueAltitude.toM());
-                    pInfo.setCoordinate(coordinate);
+                    pInfo.setTrueAltitude(trafficTrueAltitude);
                 }
             }
         }
@@ -395,40 +375,31 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
         // Compute horizontal distance to traffic if our own position
         // is known.
         Units::Distance hDist {};
-        auto* positionProviderPtr = GlobalObject::positionProvider();
-        if (positionProviderPtr != nullptr) {
-            auto ownShipCoordinate = positionProviderPtr->positionInfo().coordinate();
-            auto trafficCoordinate = pInfo.coordinate();
-            if (ownShipCoordinate.isValid() && trafficCoordinate.isValid()) {
-                hDist = Units::Distance::fromM( ownShipCoordinate.distanceTo(trafficCoordinate) );
-            }
+        auto trafficCoordinate = pInfo.coordinate();
+        const auto& ownship = ownshipCoordinate();
+        if (ownship.isValid() && trafficCoordinate.isValid()) {
+            hDist = Units::Distance::fromM( ownship.distanceTo(trafficCoordinate) );
         }
 
         // Callsign of traffic
-        auto callSign = QString::fromLatin1(message.mid(18,8)).simplified();
+        auto callSign = QString::fromLatin1(reinterpret_cast<const char*>(message+18), 8).simplified();
 
         // Expose data
+        TrafficReport report;
+        report.alarmLevel = alert;
+        report.callSign = callSign;
+        report.hDist = hDist;
+        report.ID = id;
+        report.type = type;
+        report.vDist = vDist;
         if ((callSign.compare("MODE S", Qt::CaseInsensitive) == 0) || (callSign.compare("MODE-S", Qt::CaseInsensitive) == 0)) {
-            m_factorDistanceOnly.setAlarmLevel(alert);
-            m_factorDistanceOnly.setCallSign(callSign);
-            m_factorDistanceOnly.setCoordinate(Positioning::PositionProvider::lastValidCoordinate());
-            m_factorDistanceOnly.setHDist(hDist);
-            m_factorDistanceOnly.setID(id);
-            m_factorDistanceOnly.setType(type);
-            m_factorDistanceOnly.setVDist(vDist);
-            m_factorDistanceOnly.startLiveTime();
-            emit factorWithoutPosition(m_factorDistanceOnly);
+            report.kind = TrafficReport::FactorWithoutPosition;
+            report.coordinate = ownship;
         } else {
-            m_factor.setAlarmLevel(alert);
-            m_factor.setCallSign(callSign);
-            m_factor.setHDist(hDist);
-            m_factor.setID(id);
-            m_factor.setPositionInfo(pInfo);
-            m_factor.setType(type);
-            m_factor.setVDist(vDist);
-            m_factor.startLiveTime();
-            emit factorWithPosition(m_factor);
+            report.kind = TrafficReport::FactorWithPosition;
+            report.positionInfo = pInfo;
         }
+        publishReport(std::move(report));
     }
 
 }
@@ -18,8 +18,8 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-#include "GlobalObject.h"
-#include "positioning/PositionProvider.h"
+#include "Profiler.h"
+#include "traffic/NMEASentence.h"
 #include "traffic/TrafficDataSource_Abstract.h"
 
 
@@ -27,6 +27,15 @@
 
 void Traffic::TrafficDataSource_Abstract::processXGPSString(const QByteArray& data)
 {
+    PROFILER_SCOPE(Profiler::TrafficDecode);
+    // Split into fields. The fields are views into data; nothing is copied
+    // until the report is constructed.
+    NMEASentence fields;
+    if (!fields.split(std::string_view(data.constData(), static_cast<std::size_t>(data.size())))) {
+        return;
+    }
+    countMessage(true);
+
 
     //
     // Handle the various message types
@@ -34,42 +43,39 @@ void Traffic::TrafficDataSource_Abstract::processXGPSString(const QByteArray& da
 
     // Ownship report, serves also as heartbeat message
     if (data.startsWith("XGPS")) {
-
-        QString str = QString::fromLatin1(data);
-        QStringList list = str.split(QLatin1Char(','));
-        if (list.size() != 6) {
+        if (fields.size() != 5) {
             return;
         }
 
         bool ok = false;
-        double lon = list[1].toDouble(&ok);
+        double lon = fields.toDouble(0, &ok);
         if (!ok) {
             return;
         }
-        double lat = list[2].toDouble(&ok);
+        double lat = fields.toDouble(1, &ok);
         if (!ok) {
             return;
         }
-        double alt = list[3].toDouble(&ok);
+        double alt = fields.toDouble(2, &ok);
         if (!ok) {
             return;
         }
-        double tt = list[4].toDouble(&ok);
+        double tt = fields.toDouble(3, &ok);
         if (!ok) {
             return;
         }
-        double gs = list[5].toDouble(&ok);
+        double gs = fields.toDouble(4, &ok);
         if (!ok) {
             return;
         }
 
-        QGeoPositionInfo _geoPos(QGeoCoordinate(lat, lon, alt), QDateTime::currentDateTimeUtc());
-        _geoPos.setAttribute(QGeoPositionInfo::Direction, tt);
-        _geoPos.setAttribute(QGeoPositionInfo::GroundSpeed, gs);
+        Positioning::PositionInfo _geoPos(QGeoCoordinate(lat, lon, alt), QDateTime::currentDateTimeUtc());
+        _geoPos.setDirection(Units::Angle::fromDEG(tt));
+        _geoPos.setGroundSpeed(Units::Speed::fromMPS(gs));
 
         // Update position information and continue
         if (_geoPos.isValid()) {
-            emit positionUpdated( Positioning::PositionInfo(_geoPos) );
+            emit positionUpdated(_geoPos);
             setReceivingHeartbeat(true);
         }
 
@@ -79,75 +85,79 @@ void Traffic::TrafficDataSource_Abstract::processXGPSString(const QByteArray& da
 
     // Traffic report
     if (data.startsWith("XTRA")) {
-
-        QString str = QString::fromLatin1(data);
-        QStringList list = str.split(QLatin1Char(','));
-        if (list.size() != 10) {
+        if (fields.size() != 9) {
             return;
         }
 
         bool ok = false;
-        QString targetID = list[1];
-        double lat = list[2].toDouble(&ok);
+        double lat = fields.toDouble(1, &ok);
         if (!ok) {
             return;
         }
-        double lon = list[3].toDouble(&ok);
+        double lon = fields.toDouble(2, &ok);
         if (!ok) {
             return;
         }
-        auto alt = Units::Distance::fromFT(list[4].toDouble(&ok));
+        auto alt = Units::Distance::fromFT(fields.toDouble(3, &ok));
         if (!ok) {
             return;
         }
-        auto vSpeed = Units::Speed::fromFPM(list[5].toDouble(&ok));
+        auto vSpeed = Units::Speed::fromFPM(fields.toDouble(4, &ok));
         if (!ok) {
             return;
         }
-        double tt = list[7].toDouble(&ok);
+        double tt = fields.toDouble(6, &ok);
         if (!ok) {
             return;
         }
-        auto hSpeed = Units::Speed::fromKN(list[8].toDouble(&ok));
+        auto hSpeed = Units::Speed::fromKN(fields.toDouble(7, &ok));
         if (!ok) {
             return;
         }
-        auto callsign = list[9].simplified();
 
-        auto trafficCoordinate = QGeoCoordinate(lat, lon, alt.toM());
-        if (!trafficCoordinate.isValid()) {
-            return;
-        }
-        QGeoPositionInfo geoPositionInfo(trafficCoordinate, QDateTime::currentDateTimeUtc());
-        geoPositionInfo.setAttribute(QGeoPositionInfo::VerticalSpeed, vSpeed.toMPS());
-        geoPositionInfo.setAttribute(QGeoPositionInfo::Direction, tt);
-        geoPositionInfo.setAttribute(QGeoPositionInfo::GroundSpeed, hSpeed.toMPS());
-        if (!geoPositionInfo.isValid()) {
+        // Validate coordinates before anything is allocated
+        if ((lat < -90.0) || (lat > 90.0) || (lon < -180.0) || (lon > 180.0)) {
             return;
         }
+        auto trafficCoordinate = QGeoCoordinate(lat, lon, alt.toM());
 
         // Compute horizontal and vertical distance to traffic if our own position
         // is known.
         Units::Distance hDist {};
         Units::Distance vDist {};
-        auto* positionProviderPtr = GlobalObject::positionProvider();
-        if (positionProviderPtr != nullptr) {
-            auto ownShipCoordinate = positionProviderPtr->positionInfo().coordinate();
-            if (ownShipCoordinate.isValid()) {
-                hDist = Units::Distance::fromM( ownShipCoordinate.distanceTo(trafficCoordinate) );
-                vDist = alt - Units::Distance::fromM(ownShipCoordinate.altitude());
-            }
-        }
-
-        m_factor.setAlarmLevel(0);
-        m_factor.setCallSign(callsign);
-        m_factor.setHDist(hDist);
-        m_factor.setID(targetID);
-        m_factor.setPositionInfo(geoPositionInfo);
-        m_factor.setType(Traffic::TrafficFactor_Abstract::unknown);
-        m_factor.setVDist(vDist);
-        m_factor.startLiveTime();
-        emit factorWithPosition(m_factor);
+        const auto& ownship = ownshipCoordinate();
+        if (ownship.isValid()) {
+            hDist = Units::Distance::fromM( ownship.distanceTo(trafficCoordinate) );
+            vDist = alt - Units::Distance::fromM(ownship.altitude());
+        }
+
+        // Strip whitespace from the call sign
+        auto callSign = fields[8];
+        while (!callSign.empty() && (static_cast<quint8>(callSign.front()) <= ' ')) {
+            callSign.remove_prefix(1);
+        }
+        while (!callSign.empty() && (static_cast<quint8>(callSign.back()) <= ' ')) {
+            callSign.remove_suffix(1);
+        }
+
+        // The ICAO address is given as a decimal number
+        auto address = fields.toInt(0, &ok);
+
+        TrafficReport report;
+        report.kind = TrafficReport::FactorWithPosition;
+        report.alarmLevel = 0;
+        report.callSign = QString::fromLatin1(callSign.data(), static_cast<int>(callSign.size()));
+        report.hDist = hDist;
+        if (ok && (address >= 0) && (address <= 0xFFFFFF)) {
+            report.ID = Traffic::TargetID(static_cast<quint32>(address), Traffic::TargetID::ICAO);
+        }
+        report.positionInfo = Positioning::PositionInfo(trafficCoordinate, QDateTime::currentDateTimeUtc());
+        report.positionInfo.setVerticalSpeed(vSpeed);
+        report.positionInfo.setDirection(Units::Angle::fromDEG(tt));
+        report.positionInfo.setGroundSpeed(hSpeed);
+        report.type = Traffic::TrafficFactor_Abstract::unknown;
+        report.vDist = vDist;
+        publishReport(std::move(report));
         return;
     }
 
@@ -18,6 +18,9 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include <QtEndian>
+#include <QtNumeric>
+
 #include "traffic/TrafficDataSource_File.h"
 
 
@@ -26,7 +29,24 @@
 Traffic::TrafficDataSource_File::TrafficDataSource_File(const QString& fileName, QObject *parent) :
     TrafficDataSource_Abstract(parent), simulatorFile(fileName) {
 
-    connect(&simulatorTimer, &QTimer::timeout, this, &Traffic::TrafficDataSource_File::readFromSimulatorStream);
+    connect(&simulatorTimer, &QTimer::timeout, this, [this]() {
+        // When replaying as fast as possible, process several entries per
+        // timer event
+        auto count = qIsInf(m_timeScale) ? batchSize : 1;
+        for(int i=0; (i<count) && simulatorFile.isOpen(); i++) {
+            switch(m_format) {
+            case FLARMText:
+                readFromSimulatorStream();
+                break;
+            case GDL90Capture:
+                readFromGDL90Capture();
+                break;
+            case Recording:
+                readFromRecording();
+                break;
+            }
+        }
+    });
 
     // Initially, set properties
     updateProperties();
@@ -45,12 +65,33 @@ void Traffic::TrafficDataSource_File::connectToTrafficReceiver()
 
     // Open the file
     simulatorFile.unsetError();
+    m_format = FLARMText;
+    if (TrafficDataRecorder::containsRecording(simulatorFile.fileName())) {
+        m_format = Recording;
+    } else if (containsGDL90Data(simulatorFile.fileName())) {
+        m_format = GDL90Capture;
+    }
     if (simulatorFile.open(QIODevice::ReadOnly)) {
-        simulatorTextStream.setDevice(&simulatorFile);
-        simulatorTextStream.setCodec("ISO 8859-1");
-        lastPayload = QString();
-        lastTime = 0;
-        readFromSimulatorStream();
+        if (m_format != FLARMText) {
+            m_mappedSize = simulatorFile.size();
+            m_mappedData = simulatorFile.map(0, m_mappedSize);
+            m_mappedPosition = 0;
+            m_recordedLine.clear();
+            if (m_mappedData == nullptr) {
+                simulatorFile.close();
+            } else if (m_format == GDL90Capture) {
+                readFromGDL90Capture();
+            } else {
+                m_mappedPosition = sizeof(TrafficDataRecorder::fileMagic);
+                readFromRecording();
+            }
+        } else {
+            simulatorTextStream.setDevice(&simulatorFile);
+            simulatorTextStream.setCodec("ISO 8859-1");
+            lastPayload = QByteArray();
+            lastTime = 0;
+            readFromSimulatorStream();
+        }
     }
 
     // Update properties
@@ -86,9 +127,30 @@ auto Traffic::TrafficDataSource_File::containsFLARMSimulationData(const QString&
 }
 
 
+auto Traffic::TrafficDataSource_File::containsGDL90Data(const QString& fileName) -> bool
+{
+    QFile inFile(fileName);
+
+    if (!inFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // A GDL90 capture starts with a flag byte, and its frames are short. We
+    // check that the first 1024 bytes contain at least ten flag bytes, and no
+    // line breaks of text files.
+    auto data = inFile.read(1024);
+    if (data.isEmpty() || (static_cast<quint8>(data[0]) != 0x7e)) {
+        return false;
+    }
+    return (data.count(static_cast<char>(0x7e)) >= 10) && !data.contains('\n');
+}
+
+
 void Traffic::TrafficDataSource_File::disconnectFromTrafficReceiver()
 {
-    // Stop any simulation that might be running
+    // Stop any simulation that might be running. Closing the file also
+    // unmaps a GDL90 capture.
+    m_mappedData = nullptr;
     simulatorFile.close();
     simulatorTimer.stop();
 
@@ -106,7 +168,7 @@ void Traffic::TrafficDataSource_File::readFromSimulatorStream()
     }
 
     if (!lastPayload.isEmpty()) {
-        processFLARMSentence(lastPayload);
+        processFLARMSentence(std::string_view(lastPayload.constData(), static_cast<std::size_t>(lastPayload.size())));
     }
 
     // Read line
@@ -122,18 +184,113 @@ void Traffic::TrafficDataSource_File::readFromSimulatorStream()
         return;
     }
     auto time = tuple[0].toInt();
-    lastPayload = tuple[1];
+    lastPayload = tuple[1].toLatin1();
 
-    if (lastTime == 0) {
+    if ((lastTime == 0) || qIsInf(m_timeScale)) {
         simulatorTimer.setInterval(0);
     } else {
-        simulatorTimer.setInterval(time-lastTime);
+        simulatorTimer.setInterval(qRound((time-lastTime)/m_timeScale));
     }
     simulatorTimer.start();
     lastTime = time;
 }
 
 
+void Traffic::TrafficDataSource_File::readFromGDL90Capture()
+{
+    if ((m_mappedData == nullptr) || (m_mappedPosition >= m_mappedSize)) {
+        disconnectFromTrafficReceiver();
+        return;
+    }
+
+    // Find the start of the next heartbeat message after the current
+    // position. Escaped data never contains flag bytes, so a flag byte that
+    // is followed by message ID 0 always starts a heartbeat.
+    auto end = m_mappedPosition+1;
+    while ((end+1 < m_mappedSize) && !((m_mappedData[end] == 0x7e) && (m_mappedData[end+1] == 0x00))) {
+        end++;
+    }
+    if (end+1 >= m_mappedSize) {
+        end = m_mappedSize;
+    }
+
+    auto data = QByteArray::fromRawData(reinterpret_cast<const char*>(m_mappedData+m_mappedPosition), static_cast<int>(end-m_mappedPosition));
+    m_mappedPosition = end;
+    processGDLData(data);
+
+    // Heartbeats are sent once per second
+    if (qIsInf(m_timeScale)) {
+        simulatorTimer.setInterval(0);
+    } else {
+        simulatorTimer.setInterval(qRound(1000.0/m_timeScale));
+    }
+    simulatorTimer.start();
+}
+
+
+void Traffic::TrafficDataSource_File::readFromRecording()
+{
+    auto headerSize = TrafficDataRecorder::recordHeaderSize;
+    if ((m_mappedData == nullptr) || (m_mappedPosition+headerSize > m_mappedSize)) {
+        disconnectFromTrafficReceiver();
+        return;
+    }
+
+    // Read record
+    const auto* header = m_mappedData+m_mappedPosition;
+    auto time = qFromLittleEndian<quint32>(header);
+    auto channel = header[4];
+    auto size = qFromLittleEndian<quint16>(header+6);
+    if (m_mappedPosition+headerSize+size > m_mappedSize) {
+        disconnectFromTrafficReceiver();
+        return;
+    }
+    auto data = QByteArray::fromRawData(reinterpret_cast<const char*>(header+headerSize), size);
+    m_mappedPosition += headerSize+size;
+
+    // Process record
+    if (channel == TrafficDataRecorder::Datagram) {
+        if (data.startsWith("XGPS") || data.startsWith("XTRA")) {
+            processXGPSString(data);
+        } else {
+            processGDLData(data);
+        }
+        m_replayedEntries++;
+    } else {
+        // Text stream data might contain several lines, or parts of lines
+        m_recordedLine += data;
+        int start = 0;
+        int end = 0;
+        while ((end = m_recordedLine.indexOf('\n', start)) >= 0) {
+            processFLARMSentence(std::string_view(m_recordedLine.constData()+start, static_cast<std::size_t>(end-start+1)));
+            m_replayedEntries++;
+            start = end+1;
+        }
+        m_recordedLine.remove(0, start);
+    }
+    m_replayedBytes += size;
+
+    // Set timer for the next record
+    simulatorTimer.setInterval(0);
+    if (!qIsInf(m_timeScale) && (m_mappedPosition+headerSize <= m_mappedSize)) {
+        auto nextTime = qFromLittleEndian<quint32>(m_mappedData+m_mappedPosition);
+        if (nextTime > time) {
+            simulatorTimer.setInterval(qRound((nextTime-time)/m_timeScale));
+        }
+    }
+    simulatorTimer.start();
+}
+
+
+void Traffic::TrafficDataSource_File::setTimeScale(double timeScale)
+{
+    if (!(timeScale > 0.0)) {
+        return;
+    }
+    m_timeScale = timeScale;
+}
+
+
 void Traffic::TrafficDataSource_File::updateProperties()
 {
     // Set new value: connectivityStatus
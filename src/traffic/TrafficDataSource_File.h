@@ -22,16 +22,30 @@
 
 #include <QFile>
 #include <QTextStream>
+#include <limits>
 
 #include "traffic/TrafficDataSource_Abstract.h"
 
 
 namespace Traffic {
 
-/*! \brief Traffic receiver: Simulator file with FLARM/NMEA sentences
+/*! \brief Traffic receiver: Simulator file with FLARM/NMEA sentences or GDL90 data
  *
- *  For testing purposes, this class connects to a simulator file with time
- *  stamps and FLARM/NMEA sentences, as provided by FLARM Inc.
+ *  For testing purposes, this class connects to a simulator file and replays
+ *  its content. Two formats are supported.
+ *
+ *  - Text files with time stamps and FLARM/NMEA sentences, as provided by
+ *    FLARM Inc.
+ *
+ *  - Binary captures of GDL90 data streams, as received on UDP port 4000.
+ *    These files contain the raw byte stream, with flag bytes and escape
+ *    characters. Replay is paced by the heartbeat messages, which GDL90
+ *    devices send once per second.
+ *
+ *  - Recordings written by TrafficDataRecorder.
+ *
+ *  By default, files are replayed in real time. For regression and
+ *  throughput tests, replay can be accelerated with setTimeScale().
  */
 class TrafficDataSource_File : public TrafficDataSource_Abstract {
     Q_OBJECT
@@ -56,6 +70,17 @@ public:
      */
     static bool containsFLARMSimulationData(const QString& fileName);
 
+    /*! \brief Reads file and checks if the file contains a GDL90 capture
+     *
+     *  @param fileName Name of the file to be checked
+     *
+     *  @returns True if the file is likely to contain GDL90 data
+     */
+    static bool containsGDL90Data(const QString& fileName);
+
+    /*! \brief Time scale for replay at maximal speed */
+    static constexpr double asFastAsPossible = std::numeric_limits<double>::infinity();
+
     /*! \brief Getter function for the property with the same name
      *
      *  This method implements the pure virtual method declared by its
@@ -68,6 +93,15 @@ public:
         return tr("Simulator file %1").arg(simulatorFile.fileName());
     }
 
+    /*! \brief Time scale of the replay
+     *
+     *  @returns Factor by which replay is faster than real time
+     */
+    double timeScale() const
+    {
+        return m_timeScale;
+    }
+
 public slots:
     /*! \brief Start attempt to connect to traffic receiver
      *
@@ -83,12 +117,29 @@ public slots:
      */
     void disconnectFromTrafficReceiver() override;
 
+    /*! \brief Set time scale of the replay
+     *
+     *  @param timeScale Factor by which replay is faster than real time, such
+     *  as 2.0 or 10.0. Use asFastAsPossible to replay without any delay.
+     *  Values that are not positive are ignored.
+     */
+    void setTimeScale(double timeScale);
+
 private slots:
     // Read one line from the simulator file's text stream and passes the string
     // on to processFLARMMessage.  Sets up a timer to read the next line in due
     // time.
     void readFromSimulatorStream();
 
+    // Passes GDL90 data up to the next heartbeat message on to
+    // processGDLData. Sets up a timer to read the next data in due time.
+    void readFromGDL90Capture();
+
+    // Passes one record of a recording on to processFLARMSentence,
+    // processGDLData or processXGPSString. Sets up a timer to read the next
+    // record in due time.
+    void readFromRecording();
+
     // Update the properties "errorString" and "connectivityStatus".
     void updateProperties();
 
@@ -96,11 +147,36 @@ private:
     QTextStream textStream;
 
     // Simulator related members
-    QFile simulatorFile;
+    QFile simulatorFile {this};
     QTextStream simulatorTextStream;
-    QTimer simulatorTimer;
+    QTimer simulatorTimer {this};
     int lastTime {0};
-    QString lastPayload;
+    QByteArray lastPayload;
+
+    // Replay speed
+    double m_timeScale {1.0};
+
+    // Format of the file
+    enum Format {
+        FLARMText,
+        GDL90Capture,
+        Recording
+    };
+    Format m_format {FLARMText};
+
+    // GDL90 capture or recording, mapped into memory, and position of the
+    // next data to be processed
+    const uchar* m_mappedData {nullptr};
+    qint64 m_mappedSize {0};
+    qint64 m_mappedPosition {0};
+
+    // Text stream data of a recording that does not yet form a complete line
+    QByteArray m_recordedLine;
+
+    // Number of entries processed per timer event when replaying as fast as
+    // possible. Larger numbers mean less overhead, smaller numbers keep the
+    // thread responsive.
+    static constexpr int batchSize = 1000;
 };
 
 }
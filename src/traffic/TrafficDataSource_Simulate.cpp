@@ -30,6 +30,7 @@ Traffic::TrafficDataSource_Simulate::TrafficDataSource_Simulate(QObject *parent)
     simulatorTimer.setInterval(1s);
     simulatorTimer.setSingleShot(false);
     connect(&simulatorTimer, &QTimer::timeout, this, &Traffic::TrafficDataSource_Simulate::sendSimulatorData);
+    connect(&scenarioTimer, &QTimer::timeout, this, &Traffic::TrafficDataSource_Simulate::sendScenarioData);
 
     // Initially, set properties
     TrafficDataSource_Simulate::disconnectFromTrafficReceiver();
@@ -45,6 +46,9 @@ void Traffic::TrafficDataSource_Simulate::connectToTrafficReceiver()
 
     setConnectivityStatus( tr("Connected.") );
     simulatorTimer.start();
+    if (scenario) {
+        scenarioTimer.start();
+    }
 }
 
 
@@ -53,15 +57,25 @@ void Traffic::TrafficDataSource_Simulate::disconnectFromTrafficReceiver()
     setConnectivityStatus( tr("Not connected.") );
     setReceivingHeartbeat(false);
     simulatorTimer.stop();
+    scenarioTimer.stop();
+}
+
+
+auto Traffic::TrafficDataSource_Simulate::ownshipPositionInfo() const -> Positioning::PositionInfo
+{
+    Positioning::PositionInfo result(ownshipCoordinate, QDateTime::currentDateTimeUtc());
+    result.setGroundSpeed(ownshipGS);
+    result.setDirection(ownshipTT);
+    return result;
 }
 
 
 void Traffic::TrafficDataSource_Simulate::sendSimulatorData()
 {
 
-    geoInfo.setTimestamp( QDateTime::currentDateTimeUtc() );
-    if (geoInfo.isValid()) {
-        emit positionUpdated( Positioning::PositionInfo(geoInfo) );
+    auto pInfo = ownshipPositionInfo();
+    if (pInfo.isValid()) {
+        emit positionUpdated(pInfo);
         setReceivingHeartbeat(true);
     } else {
         setReceivingHeartbeat(false);
@@ -74,13 +88,68 @@ void Traffic::TrafficDataSource_Simulate::sendSimulatorData()
 
         trafficFactor->startLiveTime();
         if (trafficFactor->valid()) {
-            emit factorWithPosition(*trafficFactor);
+            publishReport(TrafficReport::fromFactor(*trafficFactor));
         }
     }
 
     if (!trafficFactor_DistanceOnly.isNull()) {
-        emit factorWithoutPosition(*trafficFactor_DistanceOnly);
+        publishReport(TrafficReport::fromFactor(*trafficFactor_DistanceOnly));
     }
 
     pressureAltitudeUpdated(barometricHeight);
 }
+
+
+void Traffic::TrafficDataSource_Simulate::startScenario(const Traffic::TrafficScenario& newScenario, Encoding encoding, std::chrono::milliseconds interval)
+{
+    scenario = newScenario;
+    scenarioEncoding = encoding;
+    scenarioClock.start();
+    scenarioTimer.setInterval(interval);
+    if (simulatorTimer.isActive()) {
+        scenarioTimer.start();
+    }
+}
+
+
+void Traffic::TrafficDataSource_Simulate::stopScenario()
+{
+    scenarioTimer.stop();
+    scenario.reset();
+}
+
+
+void Traffic::TrafficDataSource_Simulate::sendScenarioData()
+{
+    if (!scenario || !ownshipCoordinate.isValid()) {
+        return;
+    }
+
+    // Relative altitudes need a true altitude of ownship
+    auto ownship = ownshipPositionInfo();
+    if (!ownship.trueAltitude().isFinite()) {
+        ownship.setTrueAltitude(barometricHeight.isFinite() ? barometricHeight : Units::Distance::fromM(0.0));
+    }
+    auto seconds = static_cast<double>(scenarioClock.elapsed())/1000.0;
+
+    setReceiveTimestamp(Metrics::now());
+    if (scenarioEncoding == Encoding::GDL90) {
+        auto pressureAltitude = barometricHeight.isFinite() ? barometricHeight : ownship.trueAltitude();
+        auto data = scenario->toGDL90(ownship, pressureAltitude, seconds);
+        record(Traffic::TrafficDataRecorder::Datagram, data.constData(), data.size());
+        processGDLData(data);
+        return;
+    }
+
+    auto data = scenario->toFLARM(ownship, seconds);
+    record(Traffic::TrafficDataRecorder::Stream, data.constData(), data.size());
+    int start = 0;
+    while (start < data.size()) {
+        auto end = data.indexOf('\n', start);
+        if (end < 0) {
+            end = data.size()-1;
+        }
+        processFLARMSentence(std::string_view(data.constData()+start, static_cast<std::size_t>(end-start+1)));
+        start = end+1;
+    }
+}
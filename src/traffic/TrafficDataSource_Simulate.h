@@ -20,10 +20,13 @@
 
 #pragma once
 
-#include <QGeoPositionInfo>
+#include <QGeoCoordinate>
 #include <QPointer>
+#include <chrono>
+#include <optional>
 
 #include "traffic/TrafficDataSource_Abstract.h"
+#include "traffic/TrafficScenario.h"
 
 
 namespace Traffic {
@@ -31,11 +34,21 @@ namespace Traffic {
 /*! \brief Traffic receiver: Simulator that provides constant data
  *
  *  For testing purposes, this class provides constant traffic data.
+ *
+ *  For load tests, the class can also play a TrafficScenario. The scenario
+ *  is encoded as FLARM/NMEA sentences or as GDL90 messages, and the bytes are
+ *  fed into the same parsers that process data from real traffic receivers.
  */
 class TrafficDataSource_Simulate : public TrafficDataSource_Abstract {
     Q_OBJECT
 
 public:
+    /*! \brief Encoding of scenario data */
+    enum class Encoding {
+        FLARM, /*!< FLARM/NMEA sentences */
+        GDL90  /*!< GDL90 messages */
+    };
+
     /*! \brief Default constructor
      *
      *  @param parent The standard QObject parent pointer
@@ -87,7 +100,7 @@ public slots:
      */
     void setCoordinate(const QGeoCoordinate& coordinate)
     {
-        geoInfo.setCoordinate(coordinate);
+        ownshipCoordinate = coordinate;
     }
 
     /*! \brief Set speed that is to be reported by this class as the ground speed of ownship
@@ -96,7 +109,7 @@ public slots:
      */
     void setGS(Units::Speed GS)
     {
-        geoInfo.setAttribute(QGeoPositionInfo::GroundSpeed, GS.toMPS());
+        ownshipGS = GS;
     }
 
     /*! \brief Set angle that is to be reported by this class as the true track of ownship
@@ -105,7 +118,7 @@ public slots:
      */
     void setTT(Units::Angle TT)
     {
-        geoInfo.setAttribute(QGeoPositionInfo::Direction, TT.toDEG());
+        ownshipTT = TT;
     }
 
     /*! \brief Set traffic factor (distance only) that is to be reported by this class
@@ -140,19 +153,51 @@ public slots:
         trafficFactors.clear();
     }
 
+    /*! \brief Start playing a traffic scenario
+     *
+     *  The scenario is played relative to the coordinate and barometric height
+     *  of ownship that have been set with setCoordinate() and
+     *  setBarometricHeight(). Data is only sent while the simulator is
+     *  connected. A scenario that is already playing is replaced.
+     *
+     *  @param scenario Scenario
+     *
+     *  @param encoding Encoding of the data passed to the parsers
+     *
+     *  @param interval Time between two updates of the scenario
+     */
+    void startScenario(const Traffic::TrafficScenario& scenario, Encoding encoding, std::chrono::milliseconds interval);
+
+    /*! \brief Stop playing the traffic scenario */
+    void stopScenario();
+
 private slots:
     // Send out simulated data. This slot will be called once per second once
     // connectToTrafficReceiver() has been called
     void sendSimulatorData();
 
+    // Encode the scenario and pass the data to the parsers. This slot will be
+    // called by scenarioTimer, at the interval set in startScenario()
+    void sendScenarioData();
+
 private:
+    // Position info of ownship, with the current time as timestamp
+    Positioning::PositionInfo ownshipPositionInfo() const;
 
     // Simulator related members
-    QTimer simulatorTimer;
-    QGeoPositionInfo geoInfo;
+    QTimer simulatorTimer {this};
+    QGeoCoordinate ownshipCoordinate;
+    Units::Speed ownshipGS;
+    Units::Angle ownshipTT;
     Units::Distance barometricHeight;
     QVector<QPointer<TrafficFactor_WithPosition>> trafficFactors;
     QPointer<TrafficFactor_DistanceOnly> trafficFactor_DistanceOnly;
+
+    // Scenario related members
+    std::optional<TrafficScenario> scenario;
+    Encoding scenarioEncoding {Encoding::FLARM};
+    QTimer scenarioTimer {this};
+    QElapsedTimer scenarioClock;
 };
 
 }
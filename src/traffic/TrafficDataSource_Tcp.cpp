@@ -18,9 +18,9 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-#include "GlobalObject.h"
+#include <cstring>
+
 #include "MobileAdaptor.h"
-#include "traffic/PasswordDB.h"
 #include "traffic/TrafficDataSource_Tcp.h"
 
 // Member functions
@@ -34,10 +34,6 @@ Traffic::TrafficDataSource_Tcp::TrafficDataSource_Tcp(QString hostName, quint16
     connect(&m_socket, &QTcpSocket::stateChanged, this, &Traffic::TrafficDataSource_Tcp::onStateChanged);
     connect(&m_socket, &QAbstractSocket::disconnected, this, &Traffic::TrafficDataSource_Tcp::connectToTrafficReceiver, Qt::ConnectionType::QueuedConnection);
 
-    // Set up text stream
-    m_textStream.setDevice(&m_socket);
-    m_textStream.setCodec("ISO 8859-1");
-
     //
     // Initialize properties
     //
@@ -71,7 +67,8 @@ void Traffic::TrafficDataSource_Tcp::connectToTrafficReceiver()
     m_socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
     m_socket.setSocketOption(QAbstractSocket::KeepAliveOption, 1);
     m_socket.connectToHost(m_hostName, m_port);
-    m_textStream.setDevice(&m_socket);
+    m_framingBufferSize = 0;
+    m_discardingLine = false;
 
     // Update properties
     onStateChanged(m_socket.state());
@@ -96,27 +93,71 @@ void Traffic::TrafficDataSource_Tcp::disconnectFromTrafficReceiver()
 
 void Traffic::TrafficDataSource_Tcp::onReadyRead()
 {
-
-    QString sentence;
-    while( m_textStream.readLineInto(&sentence) ) {
-
-        // Check if the TCP connection asks for a password
-        if (sentence.startsWith("PASS?")) {
-            passwordRequest_Status = waitingForPassword;
-            passwordRequest_SSID = MobileAdaptor::getSSID();
-            auto* passwordDB = GlobalObject::passwordDB();
-            if (passwordDB->contains(passwordRequest_SSID)) {
-                setPassword(passwordRequest_SSID, passwordDB->getPassword(passwordRequest_SSID));
-            } else {
-                emit passwordRequest(passwordRequest_SSID);
+    setReceiveTimestamp(Metrics::now());
+
+    // Data is read into a fixed buffer and split into lines there, so that no
+    // memory is allocated while the traffic receiver floods us with sentences
+    while (true) {
+        auto* buffer = m_framingBuffer.data();
+        auto length = m_socket.read(buffer+m_framingBufferSize, static_cast<qint64>(m_framingBuffer.size())-m_framingBufferSize);
+        if (length <= 0) {
+            break;
+        }
+        record(Traffic::TrafficDataRecorder::Stream, buffer+m_framingBufferSize, length);
+        auto* end = buffer+m_framingBufferSize+length;
+
+        // Process all complete lines
+        auto* lineStart = buffer;
+        const void* lineBreak = nullptr;
+        while ((lineBreak = std::memchr(lineStart, '\n', static_cast<std::size_t>(end-lineStart))) != nullptr) {
+            auto* lineEnd = static_cast<const char*>(lineBreak)+1;
+            std::string_view sentence(lineStart, static_cast<std::size_t>(lineEnd-lineStart));
+            lineStart = buffer+(lineEnd-buffer);
+
+            // Skip the remainder of overlong lines, up to and including the
+            // line break
+            if (m_discardingLine) {
+                m_discardingLine = false;
+                continue;
+            }
+            if (sentence.size() > maxLineLength) {
+                continue;
             }
-            continue;
+            processLine(sentence);
         }
 
-        // Process FLARM sentence
-        processFLARMSentence(sentence);
+        // Keep the start of an incomplete line for the next round. Lines that
+        // are too long to be valid sentences are discarded.
+        m_framingBufferSize = end-lineStart;
+        if (m_discardingLine || (m_framingBufferSize > static_cast<qint64>(maxLineLength))) {
+            m_discardingLine = true;
+            m_framingBufferSize = 0;
+        } else {
+            std::memmove(buffer, lineStart, static_cast<std::size_t>(m_framingBufferSize));
+        }
+    }
+
+    // Some receivers do not terminate the password prompt with a line break.
+    // Handle it right away, instead of waiting for the rest of the line.
+    if ((m_framingBufferSize >= 5) && (std::string_view(m_framingBuffer.data(), 5) == "PASS?")) {
+        processLine(std::string_view(m_framingBuffer.data(), static_cast<std::size_t>(m_framingBufferSize)));
+        m_framingBufferSize = 0;
+    }
+}
+
+
+void Traffic::TrafficDataSource_Tcp::processLine(std::string_view sentence)
+{
+    // Check if the TCP connection asks for a password
+    if (sentence.substr(0, 5) == "PASS?") {
+        passwordRequest_Status = waitingForPassword;
+        passwordRequest_SSID = MobileAdaptor::getSSID();
+        emit passwordRequest(passwordRequest_SSID);
+        return;
     }
 
+    // Process FLARM sentence
+    processFLARMSentence(sentence);
 }
 
 
@@ -146,12 +187,9 @@ void Traffic::TrafficDataSource_Tcp::setPassword(const QString& SSID, const QStr
     // In this case, accept the password immediately and issue a password storage request
     // if appropriate
     if (receivingHeartbeat()) {
-        // emit a password storage request if appropriate
-        auto* passwordDB = GlobalObject::passwordDB();
-        if (!passwordDB->contains(passwordRequest_SSID) ||
-            (passwordDB->getPassword(passwordRequest_SSID) != passwordRequest_password)) {
-            emit passwordStorageRequest(passwordRequest_SSID, passwordRequest_password);
-        }
+        // emit a password storage request. The receiver checks if the
+        // password is already in the database.
+        emit passwordStorageRequest(passwordRequest_SSID, passwordRequest_password);
         return;
     }
 
@@ -177,8 +215,8 @@ void Traffic::TrafficDataSource_Tcp::sendPassword_internal()
     connect(this, &Traffic::TrafficDataSource_Abstract::receivingHeartbeatChanged, this, &Traffic::TrafficDataSource_Tcp::updatePasswordStatusOnHeartbeatChange);
     connect(&m_socket, &QTcpSocket::disconnected, this, &Traffic::TrafficDataSource_Tcp::updatePasswordStatusOnDisconnected);
 
-    m_textStream << passwordRequest_password+"\n";
-    m_textStream.flush();
+    m_socket.write(passwordRequest_password.toLatin1()+"\n");
+    m_socket.flush();
     passwordRequest_Status = waitingForDevice;
 
 }
@@ -191,8 +229,8 @@ void Traffic::TrafficDataSource_Tcp::updatePasswordStatusOnDisconnected()
         return;
     }
 
-    // Remove password from database
-    GlobalObject::passwordDB()->removePassword(passwordRequest_SSID);
+    // Ask for removal of the password from the database
+    emit passwordRejected(passwordRequest_SSID);
 
     // Schedule reconnection in 500ms
     QTimer::singleShot(500ms, this, &Traffic::TrafficDataSource_Tcp::connectToTrafficReceiver);
@@ -213,12 +251,9 @@ void Traffic::TrafficDataSource_Tcp::updatePasswordStatusOnHeartbeatChange(bool
         return;
     }
 
-    // emit a password storage request if appropriate
-    auto* passwordDB = GlobalObject::passwordDB();
-    if (!passwordDB->contains(passwordRequest_SSID) ||
-        (passwordDB->getPassword(passwordRequest_SSID) != passwordRequest_password)) {
-        emit passwordStorageRequest(passwordRequest_SSID, passwordRequest_password);
-    }
+    // emit a password storage request. The receiver checks if the password
+    // is already in the database.
+    emit passwordStorageRequest(passwordRequest_SSID, passwordRequest_password);
 
     resetPasswordLifecycle();
 }
@@ -22,6 +22,7 @@
 
 #include <QPointer>
 #include <QTcpSocket>
+#include <array>
 
 #include "traffic/TrafficDataSource_AbstractSocket.h"
 
@@ -124,8 +125,24 @@ private slots:
     void updatePasswordStatusOnHeartbeatChange(bool newHeartbeat);
 
 private:
-    QTcpSocket m_socket;
-    QTextStream m_textStream;
+    // Handles one line of data, including the line break
+    void processLine(std::string_view sentence);
+
+    QTcpSocket m_socket {this};
+
+    // Framing buffer for incoming data. Data is read from the socket in large
+    // chunks and split into lines in place. The first m_framingBufferSize
+    // bytes hold data that does not yet form a complete line. NMEA sentences
+    // are at most 82 characters long; FLARM sentences are somewhat longer.
+    std::array<char, 4096> m_framingBuffer {};
+    qint64 m_framingBufferSize {0};
+
+    // Lines longer than this are not valid sentences
+    static constexpr std::size_t maxLineLength = 256;
+
+    // True while the remainder of an overlong line is skipped
+    bool m_discardingLine {false};
+
     QString m_hostName;
     quint16 m_port;
 
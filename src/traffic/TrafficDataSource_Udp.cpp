@@ -20,7 +20,10 @@
 
 #include <QNetworkDatagram>
 
-#include "positioning/PositionProvider.h"
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+#include <cerrno>
+#endif
+
 #include "traffic/TrafficDataSource_Udp.h"
 
 
@@ -89,39 +92,115 @@ void Traffic::TrafficDataSource_Udp::disconnectFromTrafficReceiver()
 }
 
 
+auto Traffic::TrafficDataSource_Udp::isDuplicate(const QByteArray& data) -> bool
+{
+    auto currentDatagramHash = qHash(data);
+    if (receivedDatagramHashSet.contains(currentDatagramHash)) {
+        return true;
+    }
+
+    // Forget the oldest hash once the circular array is full
+    if (numReceivedDatagramHashes == receivedDatagramHashes.size()) {
+        receivedDatagramHashSet.remove(receivedDatagramHashes[nextHashIndex]);
+    } else {
+        numReceivedDatagramHashes++;
+    }
+    receivedDatagramHashes[nextHashIndex] = currentDatagramHash;
+    receivedDatagramHashSet.insert(currentDatagramHash);
+    nextHashIndex = (nextHashIndex+1) % receivedDatagramHashes.size();
+    return false;
+}
+
+
 void Traffic::TrafficDataSource_Udp::onReadyRead()
 {
     // Paranoid safety checks
     if (m_socket.isNull()) {
         return;
     }
+    setReceiveTimestamp(Metrics::now());
+
+    // Read datagrams. The first datagram is always read via QUdpSocket, so
+    // that the socket re-arms its read notification. On Linux and Android,
+    // the rest of a burst is then drained with recvmmsg.
+    while (!m_socket.isNull() && m_socket->hasPendingDatagrams()) {
+        processDatagram(m_socket->receiveDatagram().data());
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+        receiveBatch();
+#endif
+    }
 
-    // Read datagrams
-    while (m_socket->hasPendingDatagrams()) {
-        QByteArray data = m_socket->receiveDatagram().data();
+}
 
-        // Return immediately if the datagram has already been received.
-        auto currentDatagramHash = qHash(data);
-        foreach(auto hash, receivedDatagramHashes) {
-            if (hash == currentDatagramHash) {
-                return;
+
+void Traffic::TrafficDataSource_Udp::processDatagram(const QByteArray& data)
+{
+    record(Traffic::TrafficDataRecorder::Datagram, data.constData(), data.size());
+
+    // Ignore datagrams that have already been received.
+    if (data.isEmpty() || isDuplicate(data)) {
+        return;
+    }
+
+    // Process datagrams, depending on content type
+    if (data.startsWith("XGPS") || data.startsWith("XTRA")) {
+        processXGPSString(data);
+    } else {
+        processGDLData(data);
+    }
+}
+
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+void Traffic::TrafficDataSource_Udp::receiveBatch()
+{
+    if (!m_batchReceive || m_socket.isNull()) {
+        return;
+    }
+    auto socketDescriptor = static_cast<int>(m_socket->socketDescriptor());
+    if (socketDescriptor < 0) {
+        return;
+    }
+
+    if (!m_batchBuffers) {
+        m_batchBuffers = std::make_unique<BatchBuffers>();
+    }
+    auto& buffers = *m_batchBuffers;
+
+    forever {
+        for(int i=0; i<batchSize; i++) {
+            buffers.iovecs[i].iov_base = buffers.data[i].data();
+            buffers.iovecs[i].iov_len = maxDatagramSize;
+            buffers.headers[i] = {};
+            buffers.headers[i].msg_hdr.msg_iov = &buffers.iovecs[i];
+            buffers.headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        auto count = recvmmsg(socketDescriptor, buffers.headers.data(), batchSize, MSG_DONTWAIT, nullptr);
+        if (count < 0) {
+            if (errno == ENOSYS) {
+                m_batchReceive = false;
             }
+            return;
         }
-        receivedDatagramHashes[nextHashIndex] = currentDatagramHash;
-        nextHashIndex = (nextHashIndex+1) % receivedDatagramHashes.size();
-
-        // Process datagrams, depending on content type
-        if (data.startsWith("XGPS") || data.startsWith("XTRA")) {
-            processXGPSString(data);
-        } else {
-            // Split data into raw messages
-            foreach(auto rawMessage, data.split(0x7e)) {
-                if (!rawMessage.isEmpty()) {
-                    processGDLMessage(rawMessage);
-                }
+
+        for(int i=0; i<count; i++) {
+            // Truncated datagrams are dropped, as QUdpSocket would do
+            if ((buffers.headers[i].msg_hdr.msg_flags & MSG_TRUNC) != 0) {
+                continue;
             }
+            auto size = static_cast<int>(buffers.headers[i].msg_len);
+            processDatagram(QByteArray::fromRawData(buffers.data[i].data(), size));
 
+            // Processing might have closed the socket
+            if (m_socket.isNull()) {
+                return;
+            }
         }
-    }
 
+        if (count < batchSize) {
+            return;
+        }
+    }
 }
+#endif
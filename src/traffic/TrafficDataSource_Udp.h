@@ -22,8 +22,16 @@
 
 
 #include <QPointer>
+#include <QSet>
 #include <QUdpSocket>
 
+#include <array>
+#include <memory>
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+#include <sys/socket.h>
+#endif
+
 #include "traffic/TrafficDataSource_AbstractSocket.h"
 
 
@@ -83,23 +91,56 @@ public slots:
 
 private slots:
     // Read messages from the socket datagrams and passes the messages on to
-    // processGDLMessage
+    // processGDLData
     void onReadyRead();
 
 private:
+    // Checks if the datagram has been received before, and remembers its hash
+    // if not
+    bool isDuplicate(const QByteArray& data);
+
+    // Passes a datagram on to processGDLData or processXGPSString, unless it
+    // is a duplicate
+    void processDatagram(const QByteArray& data);
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+    // Reads all datagrams pending on the socket with as few calls to recvmmsg
+    // as possible, and passes them on to processDatagram
+    void receiveBatch();
+
+    // Number of datagrams read with one call to recvmmsg, and maximal size of
+    // a datagram
+    static constexpr int batchSize = 16;
+    static constexpr int maxDatagramSize = 2048;
+
+    // Buffers for receiveBatch(), allocated on first use
+    struct BatchBuffers {
+        std::array<std::array<char, maxDatagramSize>, batchSize> data;
+        std::array<iovec, batchSize> iovecs;
+        std::array<mmsghdr, batchSize> headers;
+    };
+    std::unique_ptr<BatchBuffers> m_batchBuffers;
+
+    // Set to false if the kernel does not support recvmmsg
+    bool m_batchReceive {true};
+#endif
+
     QPointer<QUdpSocket> m_socket;
     quint16 m_port;
 
     // We use this vector to store the last 512 datatgram hashes in a circular
     // array. This is used to sort out doubly sent datagrams. The nextHashIndex
-    // points to the next vector entry that will be re-written.
-    QVector<uint> receivedDatagramHashes {512, 0};
+    // points to the next vector entry that will be re-written. The set
+    // contains the same hashes, for lookup in constant time.
+    QVector<uint> receivedDatagramHashes = QVector<uint>(512, 0);
+    QSet<uint> receivedDatagramHashSet;
     int nextHashIndex {0};
+    int numReceivedDatagramHashes {0};
 
     // GPS altitude of owncraft
     Units::Distance m_trueAltitude;
     Units::Distance m_trueAltitude_FOM;
-    QTimer m_trueAltitudeTimer;
+    QTimer m_trueAltitudeTimer {this};
 
 };
 
@@ -26,28 +26,28 @@
 Traffic::TrafficFactor_Abstract::TrafficFactor_Abstract(QObject* parent) : QObject(parent)
 {  
 
-    lifeTimeCounter.setSingleShot(true);
-    lifeTimeCounter.setInterval(lifeTime);
-
     // Bindings for property color
     connect(this, &Traffic::TrafficFactor_Abstract::alarmLevelChanged, this, &Traffic::TrafficFactor_Abstract::colorChanged);
 
     // Bindings for property description
-    connect(this, &Traffic::TrafficFactor_Abstract::callSignChanged, this, &Traffic::TrafficFactor_Abstract::dispatchUpdateDescription);
-    connect(this, &Traffic::TrafficFactor_Abstract::typeChanged, this, &Traffic::TrafficFactor_Abstract::dispatchUpdateDescription);
-    connect(this, &Traffic::TrafficFactor_Abstract::vDistChanged, this, &Traffic::TrafficFactor_Abstract::dispatchUpdateDescription);
+    connect(this, &Traffic::TrafficFactor_Abstract::callSignChanged, this, &Traffic::TrafficFactor_Abstract::invalidateDescription);
+    connect(this, &Traffic::TrafficFactor_Abstract::typeChanged, this, &Traffic::TrafficFactor_Abstract::invalidateDescription);
+    connect(this, &Traffic::TrafficFactor_Abstract::vDistChanged, this, &Traffic::TrafficFactor_Abstract::invalidateDescription);
 
     // Bindings for property valid
-    connect(&lifeTimeCounter, &QTimer::timeout, this, &Traffic::TrafficFactor_Abstract::dispatchUpdateValid);
     connect(this, &Traffic::TrafficFactor_Abstract::alarmLevelChanged, this, &Traffic::TrafficFactor_Abstract::dispatchUpdateValid);
     connect(this, &Traffic::TrafficFactor_Abstract::hDistChanged, this, &Traffic::TrafficFactor_Abstract::dispatchUpdateValid);
 
 }
 
 
-void Traffic::TrafficFactor_Abstract::dispatchUpdateDescription()
+void Traffic::TrafficFactor_Abstract::invalidateDescription()
 {
-    updateDescription();
+    if (m_descriptionDirty) {
+        return;
+    }
+    m_descriptionDirty = true;
+    emit descriptionChanged();
 }
 
 
@@ -87,13 +87,13 @@ auto Traffic::TrafficFactor_Abstract::hasHigherPriorityThan(const TrafficFactor_
 void Traffic::TrafficFactor_Abstract::startLiveTime()
 {
 
-    lifeTimeCounter.start();
+    lifeTimeCounter.start(lifeTime);
     updateValid();
 
 }
 
 
-void Traffic::TrafficFactor_Abstract::updateDescription()
+auto Traffic::TrafficFactor_Abstract::computeDescription() const -> QString
 {
     QStringList results;
 
@@ -153,13 +153,7 @@ void Traffic::TrafficFactor_Abstract::updateDescription()
         results << vDist().toString(Settings::useMetricUnitsStatic(), true, true);
     }
 
-    // Set property value
-    auto newDescription = results.join(u"<br>");
-    if (m_description == newDescription) {
-        return;
-    }
-    m_description = newDescription;
-    emit descriptionChanged();
+    return results.join(u"<br>");
 }
 
 
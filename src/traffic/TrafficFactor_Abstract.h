@@ -21,8 +21,10 @@
 #pragma once
 
 #include <chrono>
-#include <QTimer>
+#include <QObject>
 
+#include "traffic/TargetID.h"
+#include "traffic/TimingWheel.h"
 #include "units/Distance.h"
 
 using namespace std::chrono_literals;
@@ -102,7 +104,7 @@ public:
         setID(other.ID());
         setType(other.type());
         setVDist(other.vDist());
-        updateDescription();
+        invalidateDescription();
     }
 
     /*! \brief Estimates if this traffic object has higher priority than other
@@ -274,6 +276,9 @@ public:
      *  This method holds a human-readable, translated description of the
      *  traffic. This is a rich-text string of the form "Glider<br>+15 0m" or
      *  "Airship<br>Position unknown<br>-45 ft".
+     *
+     *  Most descriptions are never shown, so the description is computed only
+     *  when it is read for the first time after a change of the traffic data.
      */
     Q_PROPERTY(QString description READ description NOTIFY descriptionChanged)
 
@@ -283,6 +288,10 @@ public:
      */
     QString description() const
     {
+        if (m_descriptionDirty) {
+            m_description = computeDescription();
+            m_descriptionDirty = false;
+        }
         return m_description;
     }
 
@@ -317,19 +326,20 @@ public:
         emit hDistChanged();
     }
 
-    /*! \brief Identifier string of the traffic
+    /*! \brief Identity of the traffic
      *
-     *  This property holds an identifier string for the traffic, as assigned by
-     *  the FLARM device that reported the traffic. This can be the FLARM ID, or
-     *  an empty string if no meaningful ID can be assigned.
+     *  This property holds the address of the traffic, as reported by the
+     *  traffic receiver, together with the kind of address. It is invalid if
+     *  no meaningful identity can be assigned. Use TargetID::toString() to
+     *  display the address.
      */
-    Q_PROPERTY(QString ID READ ID WRITE setID NOTIFY IDChanged)
+    Q_PROPERTY(Traffic::TargetID ID READ ID WRITE setID NOTIFY IDChanged)
 
     /*! \brief Getter method for property with the same name
      *
      *  @returns Property ID
      */
-    QString ID() const
+    TargetID ID() const
     {
         return m_ID;
     }
@@ -338,7 +348,7 @@ public:
      *
      *  @param newID Property ID
      */
-    void setID(const QString& newID) {
+    void setID(TargetID newID) {
         if (m_ID == newID) {
             return;
         }
@@ -455,12 +465,17 @@ protected:
     void dispatchUpdateValid();
     bool m_valid {false};
 
-    // Setter function for the property "description". This function is virtual and must not be
-    // called or accessed from the constructor. For this reason, we have a special function
-    // "dispatchUpdateDescription", which whose address is already known to the constructor.
-    virtual void updateDescription();
-    void dispatchUpdateDescription();
-    QString m_description {};
+    // Computes the property "description". This function is virtual and is
+    // called only from the getter, once the description is needed.
+    virtual QString computeDescription() const;
+
+    // Marks the description as outdated, and emits descriptionChanged() if
+    // the description has been read since the last change. Implementors of
+    // this class must bind this to the notifier signals of all the properties
+    // that the description depends on.
+    void invalidateDescription();
+    mutable QString m_description {};
+    mutable bool m_descriptionDirty {true};
 
 private:
     //
@@ -471,13 +486,14 @@ private:
     QString m_callSign {};
     QString m_color {QStringLiteral("red")};
     Units::Distance m_hDist;
-    QString m_ID;
+    TargetID m_ID;
     AircraftType m_type {AircraftType::unknown};
     Units::Distance m_vDist;
 
     // Timer for timeout. Traffic objects become invalid if their data has not been
-    // refreshed for longer than timeout.
-    QTimer lifeTimeCounter;
+    // refreshed for longer than timeout. The timeout is re-started with every
+    // report, so it uses the shared timing wheel instead of a QTimer.
+    TimingWheel::Timeout lifeTimeCounter {[this]() { dispatchUpdateValid(); }};
 };
 
 }
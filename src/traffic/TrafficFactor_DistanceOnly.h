@@ -65,7 +65,7 @@ public:
     void copyFrom(const TrafficFactor_DistanceOnly& other)
     {
         setCoordinate(other.coordinate());
-        TrafficFactor_Abstract::copyFrom(other); // This will also call updateDescription
+        TrafficFactor_Abstract::copyFrom(other); // This will also invalidate the description
     }
 
 
@@ -18,17 +18,34 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include <array>
 
 #include "Settings.h"
 #include "positioning/PositionProvider.h"
 #include "traffic/TrafficFactor_WithPosition.h"
 
 
+namespace {
+
+// Icon paths, shared by all traffic factors. The table is indexed by
+// 3*moving+color, where color is 0 for green, 1 for yellow and 2 for red.
+const std::array<QString, Traffic::TrafficFactor_WithPosition::numIcons> iconPaths {
+    QStringLiteral("/icons/traffic-noDirection-green.svg"),
+    QStringLiteral("/icons/traffic-noDirection-yellow.svg"),
+    QStringLiteral("/icons/traffic-noDirection-red.svg"),
+    QStringLiteral("/icons/traffic-withDirection-green.svg"),
+    QStringLiteral("/icons/traffic-withDirection-yellow.svg"),
+    QStringLiteral("/icons/traffic-withDirection-red.svg")
+};
+
+} // namespace
+
+
 Traffic::TrafficFactor_WithPosition::TrafficFactor_WithPosition(QObject *parent) : TrafficFactor_Abstract(parent)
 {  
 
     // Bindings for property description
-    connect(this, &Traffic::TrafficFactor_WithPosition::positionInfoChanged, this, &Traffic::TrafficFactor_WithPosition::dispatchUpdateDescription);
+    connect(this, &Traffic::TrafficFactor_WithPosition::positionInfoChanged, this, &Traffic::TrafficFactor_WithPosition::invalidateDescription);
 
     // Bindings for property icon
     connect(this, &Traffic::TrafficFactor_Abstract::colorChanged, this, &Traffic::TrafficFactor_WithPosition::updateIcon);
@@ -40,7 +57,7 @@ Traffic::TrafficFactor_WithPosition::TrafficFactor_WithPosition(QObject *parent)
 }
 
 
-void Traffic::TrafficFactor_WithPosition::setPositionInfo(const QGeoPositionInfo& newPositionInfo)
+void Traffic::TrafficFactor_WithPosition::setPositionInfo(const Positioning::PositionInfo& newPositionInfo)
 {
 
     if (m_positionInfo == newPositionInfo) {
@@ -52,7 +69,7 @@ void Traffic::TrafficFactor_WithPosition::setPositionInfo(const QGeoPositionInfo
 }
 
 
-void Traffic::TrafficFactor_WithPosition::updateDescription()
+auto Traffic::TrafficFactor_WithPosition::computeDescription() const -> QString
 {
     QStringList results;
 
@@ -108,7 +125,7 @@ void Traffic::TrafficFactor_WithPosition::updateDescription()
 
     if (vDist().isFinite()) {
         auto result = vDist().toString(Settings::useMetricUnitsStatic(), true, true);
-        auto climbRateMPS = m_positionInfo.attribute(QGeoPositionInfo::VerticalSpeed);
+        auto climbRateMPS = m_positionInfo.verticalSpeed().toMPS();
         if ( qIsFinite(climbRateMPS) ) {
             if (climbRateMPS < -1.0) {
                 result += " ↘";
@@ -123,33 +140,69 @@ void Traffic::TrafficFactor_WithPosition::updateDescription()
         results << result;
     }
 
-    // Set property value
-    auto newDescription = results.join(u"<br>");
-    if (m_description == newDescription) {
-        return;
+    return results.join(u"<br>");
+}
+
+
+auto Traffic::TrafficFactor_WithPosition::extrapolatedCoordinate(const QDateTime& time) const -> QGeoCoordinate
+{
+    auto coordinate = m_positionInfo.coordinate();
+    auto groundSpeedMPS = m_positionInfo.groundSpeed().toMPS();
+    auto trackDEG = m_positionInfo.direction().toDEG();
+    if (!coordinate.isValid() || !qIsFinite(groundSpeedMPS) || !qIsFinite(trackDEG)) {
+        return coordinate;
+    }
+    auto climbRateMPS = m_positionInfo.verticalSpeed().toMPS();
+    if (!qIsFinite(climbRateMPS)) {
+        climbRateMPS = 0.0;
+    }
+
+    auto msecs = qBound(qint64(0), m_positionInfo.timestamp().msecsTo(time), qint64(std::chrono::milliseconds(maxExtrapolationTime).count()));
+    if (msecs == 0) {
+        return coordinate;
     }
-    m_description = newDescription;
-    emit descriptionChanged();
+    auto seconds = msecs/1000.0;
+    return coordinate.atDistanceAndAzimuth(groundSpeedMPS*seconds, trackDEG, climbRateMPS*seconds);
+}
+
 
+auto Traffic::TrafficFactor_WithPosition::icon() const -> QString
+{
+    return iconPaths[m_iconIndex];
+}
+
+
+auto Traffic::TrafficFactor_WithPosition::iconPath(int index) -> QString
+{
+    return iconPaths.at(index);
 }
 
 
 void Traffic::TrafficFactor_WithPosition::updateIcon()
 {
-    // BaseType
-    QString baseType = QStringLiteral("noDirection");
-    if (m_positionInfo.hasAttribute(QGeoPositionInfo::GroundSpeed) && m_positionInfo.hasAttribute(QGeoPositionInfo::Direction)) {
-        auto GS = Units::Speed::fromMPS( m_positionInfo.attribute(QGeoPositionInfo::GroundSpeed) );
+    // Movement
+    int moving = 0;
+    if (m_positionInfo.direction().isFinite()) {
+        auto GS = m_positionInfo.groundSpeed();
         if (GS.isFinite() && (GS.toKN() > 4)) {
-            baseType = QStringLiteral("withDirection");
+            moving = 1;
         }
     }
 
-    auto newIcon = "/icons/traffic-"+baseType+"-"+color()+".svg";
-    if (m_icon == newIcon) {
+    // Color, as in color()
+    int colorIndex = 2;
+    if (alarmLevel() == 0) {
+        colorIndex = 0;
+    }
+    if (alarmLevel() == 1) {
+        colorIndex = 1;
+    }
+
+    auto newIconIndex = 3*moving+colorIndex;
+    if (m_iconIndex == newIconIndex) {
         return;
     }
-    m_icon = newIcon;
+    m_iconIndex = newIconIndex;
     emit iconChanged();
 }
 
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "positioning/PositionInfo.h"
+#include "traffic/TrackHistory.h"
 #include "traffic/TrafficFactor_Abstract.h"
 
 
@@ -64,10 +65,40 @@ public:
     void copyFrom(const TrafficFactor_WithPosition& other)
     {
         setPositionInfo(other.positionInfo());
-        TrafficFactor_Abstract::copyFrom(other); // This will also call updateDescription
+        TrafficFactor_Abstract::copyFrom(other); // This will also invalidate the description
     }
 
 
+    /*! \brief Extrapolated position of the traffic
+     *
+     *  Traffic receivers report positions about once per second. To move
+     *  traffic smoothly at the frame rate of the display, the GUI can use this
+     *  method, which extrapolates the last reported position using ground
+     *  speed, track and climb rate. Extrapolation stops after
+     *  maxExtrapolationTime.
+     *
+     *  @param time Time for which the position is computed
+     *
+     *  @returns Extrapolated coordinate. If ground speed or track are unknown,
+     *  the reported coordinate is returned.
+     */
+    Q_INVOKABLE QGeoCoordinate extrapolatedCoordinate(const QDateTime& time) const;
+
+    /*! \brief Maximal time span for extrapolating positions */
+    static constexpr auto maxExtrapolationTime = 3s;
+
+    /*! \brief Number of different icons */
+    static constexpr int numIcons = 6;
+
+    /*! \brief Path of an icon
+     *
+     *  @param index Index of the icon, between 0 and numIcons-1
+     *
+     *  @returns Path of the icon, in the resource system
+     */
+    static QString iconPath(int index);
+
+
     //
     // PROPERTIES
     //
@@ -83,9 +114,16 @@ public:
      *
      *  @returns Property icon
      */
-    QString icon() const
+    QString icon() const;
+
+    /*! \brief Index of the icon
+     *
+     *  @returns Index of the icon that is returned by icon(), for use with
+     *  iconPath()
+     */
+    int iconIndex() const
     {
-        return m_icon;
+        return m_iconIndex;
     }
 
     /*! \brief PositionInfo of the traffic */
@@ -97,7 +135,7 @@ public:
      */
     Positioning::PositionInfo positionInfo() const
     {
-        return Positioning::PositionInfo(m_positionInfo);
+        return m_positionInfo;
     }
 
     /*! \brief Setter function for property with the same name
@@ -106,7 +144,54 @@ public:
      *
      *  @param newPositionInfo Property positionInfo
      */
-    void setPositionInfo(const QGeoPositionInfo& newPositionInfo);
+    void setPositionInfo(const Positioning::PositionInfo& newPositionInfo);
+
+    /*! \brief Recent positions of the traffic
+     *
+     *  This property holds the recent positions of the traffic, as stored in
+     *  the track history that has been set with setTrackHistory(), or an empty
+     *  path if no track history has been set. The path holds no more than
+     *  trailLength positions.
+     */
+    Q_PROPERTY(QGeoPath trail READ trail NOTIFY trailChanged)
+
+    /*! \brief Getter method for property with the same name
+     *
+     *  @returns Property trail
+     */
+    QGeoPath trail() const
+    {
+        if (m_trackHistory == nullptr) {
+            return {};
+        }
+        return m_trackHistory->toGeoPath(m_trailLength);
+    }
+
+    /*! \brief Set maximal number of positions in the trail
+     *
+     *  @param trailLength Maximal number of positions in the property trail
+     */
+    void setTrailLength(int trailLength)
+    {
+        if (trailLength == m_trailLength) {
+            return;
+        }
+        m_trailLength = trailLength;
+        emit trailChanged();
+    }
+
+    /*! \brief Set track history
+     *
+     *  @param trackHistory Track history that is used for the property trail.
+     *  The track history is owned and updated by the caller, which must emit
+     *  trailChanged() whenever it changes, and must call this method with a
+     *  nullptr before the track history is deleted.
+     */
+    void setTrackHistory(const Traffic::TrackHistory* trackHistory)
+    {
+        m_trackHistory = trackHistory;
+        emit trailChanged();
+    }
 
 
 signals:
@@ -116,12 +201,15 @@ signals:
     /*! \brief Notifier signal */
     void positionInfoChanged();
 
+    /*! \brief Notifier signal */
+    void trailChanged();
+
 
 protected:
     // See documentation in base class
-    virtual void updateDescription() override;
+    virtual QString computeDescription() const override;
 
-    // Updates property icon
+    // Updates m_iconIndex, and emits iconChanged() if the icon changes
     void updateIcon();
 
 private:
@@ -132,8 +220,11 @@ private:
     //
     // Property values
     //
-    QString m_icon;
-    QGeoPositionInfo m_positionInfo;
+    // Index of the icon in the table of icon paths
+    int m_iconIndex {0};
+    Positioning::PositionInfo m_positionInfo;
+    const Traffic::TrackHistory* m_trackHistory {nullptr};
+    int m_trailLength {Traffic::TrackHistory::capacity};
     Units::Distance m_vDist;
     Units::Distance m_hDist;
 
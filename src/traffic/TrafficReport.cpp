@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "traffic/TrafficReport.h"
+
+
+// Static methods
+
+auto Traffic::TrafficReport::fromFactor(const TrafficFactor_WithPosition& factor) -> TrafficReport
+{
+    TrafficReport result;
+    result.kind = FactorWithPosition;
+    result.alarmLevel = factor.alarmLevel();
+    result.callSign = factor.callSign();
+    result.hDist = factor.hDist();
+    result.ID = factor.ID();
+    result.type = factor.type();
+    result.vDist = factor.vDist();
+    result.positionInfo = factor.positionInfo();
+    return result;
+}
+
+
+auto Traffic::TrafficReport::fromFactor(const TrafficFactor_DistanceOnly& factor) -> TrafficReport
+{
+    TrafficReport result;
+    result.kind = FactorWithoutPosition;
+    result.alarmLevel = factor.alarmLevel();
+    result.callSign = factor.callSign();
+    result.hDist = factor.hDist();
+    result.ID = factor.ID();
+    result.type = factor.type();
+    result.vDist = factor.vDist();
+    result.coordinate = factor.coordinate();
+    return result;
+}
+
+
+// Member functions
+
+void Traffic::TrafficReport::copyTo(TrafficFactor_WithPosition& factor) const
+{
+    factor.setAlarmLevel(alarmLevel);
+    factor.setCallSign(callSign);
+    factor.setHDist(hDist);
+    factor.setID(ID);
+    factor.setPositionInfo(positionInfo);
+    factor.setType(type);
+    factor.setVDist(vDist);
+    factor.startLiveTime();
+}
+
+
+void Traffic::TrafficReport::copyTo(TrafficFactor_DistanceOnly& factor) const
+{
+    factor.setAlarmLevel(alarmLevel);
+    factor.setCallSign(callSign);
+    factor.setCoordinate(coordinate);
+    factor.setHDist(hDist);
+    factor.setID(ID);
+    factor.setType(type);
+    factor.setVDist(vDist);
+    factor.startLiveTime();
+}
@@ -0,0 +1,121 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include "positioning/PositionInfo.h"
+#include "traffic/TrafficFactor_DistanceOnly.h"
+#include "traffic/TrafficFactor_WithPosition.h"
+#include "traffic/Warning.h"
+
+
+namespace Traffic {
+
+/*! \brief Decoded traffic data, as handed from a traffic data source to the TrafficDataProvider
+ *
+ *  Traffic data sources decode the data streams of traffic receivers in a
+ *  dedicated I/O thread, where the QObject-based traffic factors cannot be
+ *  used. Decoded data is therefore stored in this plain struct and passed to
+ *  the TrafficDataProvider in the main thread, which copies it into its
+ *  traffic factors.
+ */
+
+struct TrafficReport
+{
+    /*! \brief Kind of data */
+    enum Kind : quint8 {
+        FactorWithPosition,    /*!< Traffic factor whose position is known */
+        FactorWithoutPosition, /*!< Traffic factor where only the distance is known */
+        TrafficWarning         /*!< Traffic warning */
+    };
+
+    /*! \brief Construct report from a traffic factor
+     *
+     *  @param factor Traffic factor
+     *
+     *  @returns Report that carries the data of the factor
+     */
+    static TrafficReport fromFactor(const TrafficFactor_WithPosition& factor);
+
+    /*! \brief Construct report from a traffic factor
+     *
+     *  @param factor Traffic factor
+     *
+     *  @returns Report that carries the data of the factor
+     */
+    static TrafficReport fromFactor(const TrafficFactor_DistanceOnly& factor);
+
+    /*! \brief Copy data into a traffic factor
+     *
+     *  This method sets all properties of the factor that are carried by the
+     *  report and starts the lifetime of the factor.
+     *
+     *  @param factor Traffic factor
+     */
+    void copyTo(TrafficFactor_WithPosition& factor) const;
+
+    /*! \brief Copy data into a traffic factor
+     *
+     *  This method sets all properties of the factor that are carried by the
+     *  report and starts the lifetime of the factor.
+     *
+     *  @param factor Traffic factor
+     */
+    void copyTo(TrafficFactor_DistanceOnly& factor) const;
+
+    /*! \brief Kind of data */
+    Kind kind {FactorWithPosition};
+
+    /*! \brief Alarm level, as in TrafficFactor_Abstract */
+    int alarmLevel {0};
+
+    /*! \brief Call sign. If empty, the TrafficDataProvider looks it up in the FlarmnetDB */
+    QString callSign;
+
+    /*! \brief Horizontal distance to ownship */
+    Units::Distance hDist;
+
+    /*! \brief Identity of the traffic */
+    TargetID ID;
+
+    /*! \brief Type of the traffic */
+    TrafficFactor_Abstract::AircraftType type {TrafficFactor_Abstract::unknown};
+
+    /*! \brief Vertical distance to ownship */
+    Units::Distance vDist;
+
+    /*! \brief Position info, for kind FactorWithPosition */
+    Positioning::PositionInfo positionInfo;
+
+    /*! \brief Coordinate of ownship, for kind FactorWithoutPosition */
+    QGeoCoordinate coordinate;
+
+    /*! \brief Warning, for kind TrafficWarning */
+    Traffic::Warning warning;
+
+    /*! \brief Time when the data arrived at the socket, as returned by Metrics::now() */
+    qint64 receivedAt {0};
+
+    /*! \brief Time when the data was decoded, as returned by Metrics::now() */
+    qint64 decodedAt {0};
+};
+
+};
@@ -0,0 +1,372 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QDateTime>
+#include <QtMath>
+#include <cmath>
+#include <random>
+
+#include "traffic/GDL90CRC.h"
+#include "traffic/TrafficScenario.h"
+#include "units/Speed.h"
+
+
+namespace {
+
+// Length of one degree of latitude, in meters
+constexpr double metersPerDegreeLatitude = 111320.0;
+
+// Remainder of a division, in the range [0, b)
+auto positiveModulo(double a, double b) -> double
+{
+    auto result = std::fmod(a, b);
+    return (result < 0.0) ? result+b : result;
+}
+
+// Appends an NMEA sentence, adding framing and checksum
+void appendNMEA(QByteArray& out, const QByteArray& body)
+{
+    quint8 checksum = 0;
+    for(auto character : body) {
+        checksum ^= static_cast<quint8>(character);
+    }
+    out += '$';
+    out += body;
+    out += '*';
+    out += QByteArray::number(checksum, 16).rightJustified(2, '0').toUpper();
+    out += "\r\n";
+}
+
+// Appends a GDL90 message, adding CRC, escape characters and flag bytes
+void appendGDL90Frame(QByteArray& out, QByteArray message)
+{
+    quint16 crc = 0;
+    for(auto character : message) {
+        crc = Traffic::gdl90CRCUpdate(crc, static_cast<quint8>(character));
+    }
+    message += static_cast<char>(crc & 0xFFU);
+    message += static_cast<char>(crc >> 8U);
+
+    out += static_cast<char>(0x7e);
+    for(auto character : message) {
+        auto value = static_cast<quint8>(character);
+        if ((value == 0x7e) || (value == 0x7d)) {
+            out += static_cast<char>(0x7d);
+            value ^= 0x20U;
+        }
+        out += static_cast<char>(value);
+    }
+    out += static_cast<char>(0x7e);
+}
+
+// GDL90 ownship or traffic report. Speeds that are NaN are reported as
+// unknown.
+auto gdl90Report(quint8 messageID, quint32 address, const QGeoCoordinate& coordinate, double pressureAltitudeInFT,
+                 double trackInDEG, double groundSpeedInKN, double verticalSpeedInFPM, quint8 emitterCategory, const QByteArray& callSign) -> QByteArray
+{
+    QByteArray message(28, 0);
+    auto* data = reinterpret_cast<quint8*>(message.data());
+    data[0] = messageID;
+    data[2] = (address >> 16U) & 0xFFU;
+    data[3] = (address >> 8U) & 0xFFU;
+    data[4] = address & 0xFFU;
+
+    auto latitude = static_cast<quint32>(qRound(coordinate.latitude()*0x800000/180.0)) & 0xFFFFFFU;
+    data[5] = latitude >> 16U;
+    data[6] = (latitude >> 8U) & 0xFFU;
+    data[7] = latitude & 0xFFU;
+    auto longitude = static_cast<quint32>(qRound(coordinate.longitude()*0x800000/180.0)) & 0xFFFFFFU;
+    data[8] = longitude >> 16U;
+    data[9] = (longitude >> 8U) & 0xFFU;
+    data[10] = longitude & 0xFFU;
+
+    // Pressure altitude, and miscellaneous indicators: airborne, with true
+    // track if known
+    auto altitude = static_cast<quint32>(qBound(0, qRound((pressureAltitudeInFT+1000.0)/25.0), 0xFFE));
+    data[11] = altitude >> 4U;
+    data[12] = ((altitude & 0x0FU) << 4U) | (qIsFinite(trackInDEG) ? 0x09U : 0x08U);
+
+    // Integrity and accuracy: NIC 8, NACp 9 (30 m)
+    data[13] = 0x89;
+
+    quint32 horizontalVelocity = qIsFinite(groundSpeedInKN) ? static_cast<quint32>(qBound(0, qRound(groundSpeedInKN), 0xFFE)) : 0xFFFU;
+    quint32 verticalVelocity = qIsFinite(verticalSpeedInFPM) ? static_cast<quint32>(qBound(-510, qRound(verticalSpeedInFPM/64.0), 510)) & 0xFFFU : 0x800U;
+    data[14] = horizontalVelocity >> 4U;
+    data[15] = ((horizontalVelocity & 0x0FU) << 4U) | (verticalVelocity >> 8U);
+    data[16] = verticalVelocity & 0xFFU;
+    data[17] = qIsFinite(trackInDEG) ? static_cast<quint8>(qRound(positiveModulo(trackInDEG, 360.0)*256.0/360.0) & 0xFF) : 0;
+    data[18] = emitterCategory;
+
+    auto paddedCallSign = callSign.leftJustified(8, ' ', true);
+    for(int i=0; i<8; i++) {
+        data[19+i] = static_cast<quint8>(paddedCallSign.at(i));
+    }
+    return message;
+}
+
+}
+
+
+auto Traffic::TrafficScenario::Parameters::forCount(int count) -> Parameters
+{
+    Parameters result;
+    result.numberOfGaggles = count/(2*result.gaggleSize);
+    result.numberOfCircuits = count/6;
+    result.numberOfCrossings = qMax(0, count - result.numberOfGaggles*result.gaggleSize - result.numberOfCircuits);
+    return result;
+}
+
+
+Traffic::TrafficScenario::TrafficScenario(const QGeoCoordinate& center, const Parameters& parameters)
+    : m_center(center)
+{
+    if (!qIsFinite(m_center.altitude())) {
+        m_center.setAltitude(0.0);
+    }
+    m_metersPerDegreeLongitude = metersPerDegreeLatitude*qCos(qDegreesToRadians(m_center.latitude()));
+    m_areaRadius = parameters.radius.toM();
+
+    std::mt19937 generator(parameters.seed);
+    auto uniform = [&generator](double min, double max) {
+        return std::uniform_real_distribution<double>(min, max)(generator);
+    };
+    // Random point in a disk around the center, uniformly distributed
+    auto randomPoint = [&](double radius, double& x, double& y) {
+        auto r = radius*std::sqrt(uniform(0.0, 1.0));
+        auto angle = uniform(0.0, 2.0*M_PI);
+        x = r*std::sin(angle);
+        y = r*std::cos(angle);
+    };
+    quint32 nextAddress = 0xDD0000;
+
+    // Gaggles. All thermals drift with the same wind.
+    auto windDirection = uniform(0.0, 2.0*M_PI);
+    auto windSpeed = uniform(2.0, 8.0);
+    for(int gaggle=0; gaggle<parameters.numberOfGaggles; gaggle++) {
+        double x = 0.0;
+        double y = 0.0;
+        randomPoint(0.7*m_areaRadius, x, y);
+        auto direction = (uniform(0.0, 1.0) < 0.5) ? -1.0 : 1.0;
+        auto climbRate = uniform(1.0, 3.0);
+        for(int i=0; i<parameters.gaggleSize; i++) {
+            Target target;
+            target.address = nextAddress++;
+            target.motion = Thermal;
+            target.isGlider = true;
+            target.x = x;
+            target.y = y;
+            target.driftX = windSpeed*std::sin(windDirection);
+            target.driftY = windSpeed*std::cos(windDirection);
+            target.radius = uniform(80.0, 150.0);
+            target.speed = direction*uniform(22.0, 28.0);
+            target.phase = uniform(0.0, 2.0*M_PI);
+            target.altitude = 600.0 + 60.0*i;
+            target.altitudeBand = 1200.0;
+            target.climbRate = climbRate*uniform(0.8, 1.2);
+            m_targets.append(target);
+        }
+    }
+
+    // Circuits, with about four aircraft per airfield
+    QVector<Target> airfields((parameters.numberOfCircuits+3)/4);
+    for(auto& airfield : airfields) {
+        randomPoint(0.8*m_areaRadius, airfield.x, airfield.y);
+        airfield.trackInRad = uniform(0.0, M_PI);
+    }
+    for(int i=0; i<parameters.numberOfCircuits; i++) {
+        Target target = airfields[i % airfields.size()];
+        target.address = nextAddress++;
+        target.motion = Circuit;
+        target.halfLength = 1200.0;
+        target.halfWidth = 600.0;
+        target.speed = uniform(40.0, 50.0);
+        target.phase = uniform(0.0, 4.0*(target.halfLength+target.halfWidth));
+        target.altitude = 300.0;
+        m_targets.append(target);
+    }
+
+    // Crossing traffic
+    for(int i=0; i<parameters.numberOfCrossings; i++) {
+        Target target;
+        target.address = nextAddress++;
+        target.motion = Crossing;
+        randomPoint(m_areaRadius, target.x, target.y);
+        target.trackInRad = uniform(0.0, 2.0*M_PI);
+        target.speed = uniform(45.0, 130.0);
+        target.phase = uniform(0.0, 2.0*m_areaRadius);
+        target.altitude = uniform(500.0, 3000.0);
+        m_targets.append(target);
+    }
+}
+
+
+auto Traffic::TrafficScenario::state(const Target& target, double seconds) const -> State
+{
+    State result {};
+
+    switch(target.motion) {
+    case Thermal:
+    {
+        // The thermal drifts with the wind and re-enters the area on the
+        // opposite side once it has left
+        auto centerX = positiveModulo(target.x + target.driftX*seconds + m_areaRadius, 2.0*m_areaRadius) - m_areaRadius;
+        auto centerY = positiveModulo(target.y + target.driftY*seconds + m_areaRadius, 2.0*m_areaRadius) - m_areaRadius;
+        auto angle = target.phase + target.speed/target.radius*seconds;
+        result.x = centerX + target.radius*std::cos(angle);
+        result.y = centerY + target.radius*std::sin(angle);
+        auto velocityX = -target.speed*std::sin(angle) + target.driftX;
+        auto velocityY = target.speed*std::cos(angle) + target.driftY;
+        result.track = qRadiansToDegrees(std::atan2(velocityX, velocityY));
+        result.groundSpeed = std::hypot(velocityX, velocityY);
+        result.altitude = target.altitude + positiveModulo(target.climbRate*seconds + 100.0*target.phase, target.altitudeBand);
+        result.verticalSpeed = target.climbRate;
+        break;
+    }
+
+    case Circuit:
+    {
+        // Position along the perimeter of the rectangle, in coordinates along
+        // (u) and across (v) the runway
+        auto length = 2.0*target.halfLength;
+        auto width = 2.0*target.halfWidth;
+        auto s = positiveModulo(target.phase + target.speed*seconds, 2.0*(length+width));
+        double u = 0.0;
+        double v = 0.0;
+        double directionU = 0.0;
+        double directionV = 0.0;
+        if (s < length) {
+            u = -target.halfLength + s;
+            v = -target.halfWidth;
+            directionU = 1.0;
+        } else if (s < length+width) {
+            u = target.halfLength;
+            v = -target.halfWidth + (s-length);
+            directionV = 1.0;
+        } else if (s < 2.0*length+width) {
+            u = target.halfLength - (s-length-width);
+            v = target.halfWidth;
+            directionU = -1.0;
+        } else {
+            u = -target.halfLength;
+            v = target.halfWidth - (s-2.0*length-width);
+            directionV = -1.0;
+        }
+        auto sinTrack = std::sin(target.trackInRad);
+        auto cosTrack = std::cos(target.trackInRad);
+        result.x = target.x + u*sinTrack + v*cosTrack;
+        result.y = target.y + u*cosTrack - v*sinTrack;
+        result.track = qRadiansToDegrees(std::atan2(directionU*sinTrack + directionV*cosTrack, directionU*cosTrack - directionV*sinTrack));
+        result.groundSpeed = target.speed;
+        result.altitude = target.altitude;
+        result.verticalSpeed = 0.0;
+        break;
+    }
+
+    case Crossing:
+    {
+        auto s = positiveModulo(target.phase + target.speed*seconds, 2.0*m_areaRadius) - m_areaRadius;
+        result.x = target.x + s*std::sin(target.trackInRad);
+        result.y = target.y + s*std::cos(target.trackInRad);
+        result.track = qRadiansToDegrees(target.trackInRad);
+        result.groundSpeed = target.speed;
+        result.altitude = target.altitude;
+        result.verticalSpeed = 0.0;
+        break;
+    }
+    }
+
+    result.track = positiveModulo(result.track, 360.0);
+    return result;
+}
+
+
+auto Traffic::TrafficScenario::toCoordinate(double x, double y, double altitude) const -> QGeoCoordinate
+{
+    return {m_center.latitude() + y/metersPerDegreeLatitude,
+            m_center.longitude() + x/m_metersPerDegreeLongitude,
+            m_center.altitude() + altitude};
+}
+
+
+auto Traffic::TrafficScenario::toFLARM(const Positioning::PositionInfo& ownship, double seconds) const -> QByteArray
+{
+    auto ownshipCoordinate = ownship.coordinate();
+
+    QByteArray result;
+    result.reserve(60*(m_targets.size()+1));
+    for(const auto& target : m_targets) {
+        auto targetState = state(target, seconds);
+        auto coordinate = toCoordinate(targetState.x, targetState.y, targetState.altitude);
+        auto relativeNorth = (coordinate.latitude()-ownshipCoordinate.latitude())*metersPerDegreeLatitude;
+        auto relativeEast = (coordinate.longitude()-ownshipCoordinate.longitude())*m_metersPerDegreeLongitude;
+        auto relativeVertical = coordinate.altitude()-ownshipCoordinate.altitude();
+
+        appendNMEA(result, "PFLAA,0,"
+                   + QByteArray::number(qRound(relativeNorth)) + ","
+                   + QByteArray::number(qRound(relativeEast)) + ","
+                   + QByteArray::number(qRound(relativeVertical)) + ",2,"
+                   + QByteArray::number(target.address, 16).toUpper() + ","
+                   + QByteArray::number(qRound(targetState.track) % 360) + ",,"
+                   + QByteArray::number(qRound(targetState.groundSpeed)) + ","
+                   + QByteArray::number(targetState.verticalSpeed, 'f', 1) + ","
+                   + (target.isGlider ? "1" : "8"));
+    }
+    appendNMEA(result, "PFLAU," + QByteArray::number(qMin(m_targets.size(), 99)) + ",1,2,1,0,,0,,");
+    return result;
+}
+
+
+auto Traffic::TrafficScenario::toGDL90(const Positioning::PositionInfo& ownship, Units::Distance ownshipPressureAltitude, double seconds) const -> QByteArray
+{
+    auto ownshipCoordinate = ownship.coordinate();
+
+    QByteArray result;
+    result.reserve(32*(m_targets.size()+2));
+
+    // Heartbeat: GPS position valid, device initialized, UTC timing, time of
+    // day in seconds
+    auto secondsOfDay = static_cast<quint32>(QDateTime::currentDateTimeUtc().time().msecsSinceStartOfDay()/1000);
+    QByteArray heartbeat(7, 0);
+    heartbeat[0] = 0;
+    heartbeat[1] = static_cast<char>(0x81);
+    heartbeat[2] = static_cast<char>(((secondsOfDay >> 16U) << 7U) | 0x01U);
+    heartbeat[3] = static_cast<char>(secondsOfDay & 0xFFU);
+    heartbeat[4] = static_cast<char>((secondsOfDay >> 8U) & 0xFFU);
+    appendGDL90Frame(result, heartbeat);
+
+    appendGDL90Frame(result, gdl90Report(10, 0, ownshipCoordinate, ownshipPressureAltitude.toFeet(),
+                                         ownship.direction().toDEG(),
+                                         ownship.groundSpeed().toKN(),
+                                         ownship.verticalSpeed().toFPM(),
+                                         1, "OWNSHIP"));
+
+    for(const auto& target : m_targets) {
+        auto targetState = state(target, seconds);
+        auto coordinate = toCoordinate(targetState.x, targetState.y, targetState.altitude);
+        auto pressureAltitude = ownshipPressureAltitude + Units::Distance::fromM(coordinate.altitude()-ownshipCoordinate.altitude());
+        appendGDL90Frame(result, gdl90Report(20, target.address, coordinate, pressureAltitude.toFeet(),
+                                             targetState.track,
+                                             Units::Speed::fromMPS(targetState.groundSpeed).toKN(),
+                                             Units::Speed::fromMPS(targetState.verticalSpeed).toFPM(),
+                                             target.isGlider ? 9 : 1,
+                                             "SIM" + QByteArray::number(target.address & 0xFFFFU, 16).toUpper()));
+    }
+    return result;
+}
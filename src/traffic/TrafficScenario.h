@@ -0,0 +1,200 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QByteArray>
+#include <QGeoCoordinate>
+#include <QVector>
+
+#include "positioning/PositionInfo.h"
+#include "units/Distance.h"
+
+
+namespace Traffic {
+
+/*! \brief Synthetic traffic for load tests
+ *
+ *  This class generates a configurable number of aircraft that move around a
+ *  center point, and encodes their positions at any given time as the byte
+ *  stream that a traffic receiver would send. Three kinds of traffic are
+ *  generated.
+ *
+ *  - Gaggles of gliders, circling in thermals that drift with the wind. The
+ *    gliders of one gaggle are stacked in altitude and climb together.
+ *
+ *  - Aircraft flying rectangular traffic circuits around airfields near the
+ *    center.
+ *
+ *  - Crossing traffic, flying straight lines through the area at various
+ *    altitudes and speeds. Aircraft that leave the area re-enter on the
+ *    opposite side.
+ *
+ *  The scenario is deterministic: the same parameters always produce the same
+ *  traffic. Targets are described by closed-form functions of the time, so
+ *  that evaluating the scenario costs the same at every instant, for any
+ *  number of targets.
+ */
+
+class TrafficScenario
+{
+public:
+    /*! \brief Parameters of a scenario */
+    struct Parameters {
+        /*! \brief Number of gaggles */
+        int numberOfGaggles {0};
+
+        /*! \brief Number of gliders in each gaggle */
+        int gaggleSize {8};
+
+        /*! \brief Number of aircraft in traffic circuits */
+        int numberOfCircuits {0};
+
+        /*! \brief Number of aircraft crossing the area */
+        int numberOfCrossings {0};
+
+        /*! \brief Radius of the area, measured from the center */
+        Units::Distance radius {Units::Distance::fromNM(10)};
+
+        /*! \brief Seed for the random number generator */
+        quint32 seed {1};
+
+        /*! \brief Parameters for a given total number of targets
+         *
+         *  About half of the targets are put into gaggles of eight, a sixth
+         *  flies circuits and the rest crosses the area.
+         *
+         *  @param count Total number of targets
+         *
+         *  @returns Parameters
+         */
+        static Parameters forCount(int count);
+    };
+
+    /*! \brief Constructs a scenario
+     *
+     *  @param center Center of the area. The altitude of the coordinate is
+     *  taken as the elevation of the terrain; if the coordinate has no
+     *  altitude, sea level is assumed.
+     *
+     *  @param parameters Parameters of the scenario
+     */
+    TrafficScenario(const QGeoCoordinate& center, const Parameters& parameters);
+
+    /*! \brief Number of targets
+     *
+     *  @returns Number of targets in the scenario
+     */
+    int size() const
+    {
+        return m_targets.size();
+    }
+
+    /*! \brief Encode the traffic situation as FLARM/NMEA sentences
+     *
+     *  This method generates one PFLAA sentence for every target, with
+     *  positions relative to ownship, and a final PFLAU sentence.
+     *
+     *  @param ownship Position of ownship. The altitude of the coordinate must
+     *  be set.
+     *
+     *  @param seconds Time since the start of the scenario
+     *
+     *  @returns NMEA sentences, each terminated by CR/LF
+     */
+    QByteArray toFLARM(const Positioning::PositionInfo& ownship, double seconds) const;
+
+    /*! \brief Encode the traffic situation as GDL90 messages
+     *
+     *  This method generates a heartbeat, an ownship report and one traffic
+     *  report for every target, each framed by flag bytes, with escape
+     *  characters and CRC, as sent by GDL90 receivers in one UDP datagram.
+     *  Pressure altitudes of the targets are computed so that their altitude
+     *  difference to ownship matches the geometric one.
+     *
+     *  @param ownship Position of ownship. The altitude of the coordinate must
+     *  be set.
+     *
+     *  @param ownshipPressureAltitude Pressure altitude of ownship
+     *
+     *  @param seconds Time since the start of the scenario
+     *
+     *  @returns GDL90 data
+     */
+    QByteArray toGDL90(const Positioning::PositionInfo& ownship, Units::Distance ownshipPressureAltitude, double seconds) const;
+
+private:
+    // Kind of motion
+    enum Motion : quint8 {
+        Thermal,
+        Circuit,
+        Crossing
+    };
+
+    // One target. Positions are given in meters east and north of the
+    // center, altitudes in meters above the terrain.
+    struct Target {
+        quint32 address {0};
+        Motion motion {Crossing};
+        bool isGlider {false};
+
+        // Thermals: center at time 0, drift, radius, speed (negative for
+        // circling clockwise) and phase, altitude band and climb rate. Circuits: center, half-lengths of the
+        // sides, speed and phase along the perimeter. Crossings: reference
+        // point, track, speed and phase along the track.
+        double x {0.0};
+        double y {0.0};
+        double driftX {0.0};
+        double driftY {0.0};
+        double radius {0.0};
+        double halfWidth {0.0};
+        double halfLength {0.0};
+        double trackInRad {0.0};
+        double speed {0.0};
+        double phase {0.0};
+        double altitude {0.0};
+        double altitudeBand {0.0};
+        double climbRate {0.0};
+    };
+
+    // State of a target at a given time. Positions in meters east and north
+    // of the center, altitude in meters above the terrain, track in degrees,
+    // speeds in meters per second
+    struct State {
+        double x;
+        double y;
+        double altitude;
+        double track;
+        double groundSpeed;
+        double verticalSpeed;
+    };
+
+    State state(const Target& target, double seconds) const;
+
+    // Converts a position relative to the center to a coordinate
+    QGeoCoordinate toCoordinate(double x, double y, double altitude) const;
+
+    QGeoCoordinate m_center;
+    double m_metersPerDegreeLongitude {0.0};
+    double m_areaRadius {0.0};
+    QVector<Target> m_targets;
+};
+
+}
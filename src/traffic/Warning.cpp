@@ -24,67 +24,6 @@
 #include "traffic/Warning.h"
 
 
-Traffic::Warning::Warning(
-        const QString& AlarmLevel,
-        const QString& RelativeBearing,
-        const QString& AlarmType,
-        const QString& RelativeVertical,
-        const QString& RelativeDistance)
-{  
-
-    // Alarm level
-    if (AlarmLevel == "0") {
-        m_alarmLevel = 0;
-    }
-    if (AlarmLevel == "1") {
-        m_alarmLevel = 1;
-    }
-    if (AlarmLevel == "2") {
-        m_alarmLevel = 2;
-    }
-    if (AlarmLevel == "3") {
-        m_alarmLevel = 3;
-    }
-
-    // Alarm Type
-    if (AlarmType == "2") {
-        m_alarmType = 2;
-    }
-    if (AlarmType == "3") {
-        m_alarmType = 3;
-    }
-    if (AlarmType == "4") {
-        m_alarmType = 4;
-    }
-
-    // hDist
-    bool ok = false;
-    auto hDistM = RelativeDistance.toDouble(&ok);
-    if (ok) {
-        m_hDist = Units::Distance::fromM(hDistM);
-    } else {
-        m_hDist = Units::Distance::fromM(qQNaN());
-    }
-
-    // Relative Bearing
-    auto rb = RelativeBearing.toDouble(&ok);
-    if (ok) {
-        m_relativeBearing = Units::Angle::fromDEG(rb);
-    } else {
-        m_relativeBearing = Units::Angle::fromRAD(qQNaN());
-    }
-
-    // vDist
-    auto vDistM = RelativeVertical.toDouble(&ok);
-    if (ok) {
-        m_vDist = Units::Distance::fromM(vDistM);
-    } else {
-        m_vDist = Units::Distance::fromM(qQNaN());
-    }
-
-}
-
-
 auto Traffic::Warning::description() const -> QString
 {
     QStringList result;
@@ -25,6 +25,7 @@
 
 namespace Traffic {
 
+class ConflictPredictor;
 class TrafficDataSource_Abstract;
 
 /*! \brief Traffic warning
@@ -40,6 +41,7 @@ class TrafficDataSource_Abstract;
 class Warning {
     Q_GADGET
 
+    friend ConflictPredictor;
     friend TrafficDataSource_Abstract;
 
 public:
@@ -139,11 +141,18 @@ public:
 
 private:
     // Private constructor, only to be used by TrafficDataSource_Abstract
-    explicit Warning(const QString& AlarmLevel,
-                     const QString& RelativeBearing,
-                     const QString& AlarmType,
-                     const QString& RelativeVertical,
-                     const QString& RelativeDistance);
+    explicit Warning(int alarmLevel,
+                     Units::Angle relativeBearing,
+                     int alarmType,
+                     Units::Distance vDist,
+                     Units::Distance hDist)
+        : m_alarmLevel(alarmLevel),
+          m_alarmType(alarmType),
+          m_hDist(hDist),
+          m_relativeBearing(relativeBearing),
+          m_vDist(vDist)
+    {
+    }
 
     // Property values
     int m_alarmLevel {-1};
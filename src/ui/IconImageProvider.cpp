@@ -0,0 +1,152 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QPainter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QSvgRenderer>
+
+#include "IconImageProvider.h"
+#include "Metrics.h"
+
+
+namespace {
+
+// Size of an icon of the given natural size, scaled to the requested size as
+// described in IconImageProvider::requestImage()
+auto scaledSize(QSize size, const QSize& requestedSize) -> QSize
+{
+    if ((requestedSize.width() <= 0) && (requestedSize.height() <= 0)) {
+        return size;
+    }
+    if (requestedSize.width() <= 0) {
+        return {qRound(size.width()*qreal(requestedSize.height())/size.height()), requestedSize.height()};
+    }
+    if (requestedSize.height() <= 0) {
+        return {requestedSize.width(), qRound(size.height()*qreal(requestedSize.width())/size.width())};
+    }
+    size.scale(requestedSize, Qt::KeepAspectRatio);
+    return size;
+}
+
+}
+
+
+Ui::IconImageProvider::IconImageProvider()
+    : QQuickImageProvider(QQuickImageProvider::Image),
+      m_cacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)+"/icons")
+{
+    QDir().mkpath(m_cacheDirectory);
+}
+
+
+auto Ui::IconImageProvider::requestImage(const QString& id, QSize* size, const QSize& requestedSize) -> QImage
+{
+    static auto* requestsMetric = Metrics::counter(QStringLiteral("icons/requests"));
+    static auto* cacheMissesMetric = Metrics::counter(QStringLiteral("icons/cacheMisses"));
+    requestsMetric->add();
+
+    auto key = QStringLiteral("%1@%2x%3").arg(id).arg(requestedSize.width()).arg(requestedSize.height());
+    QImage image;
+    {
+        QMutexLocker locker(&m_mutex);
+        image = m_images.value(key);
+    }
+
+    if (image.isNull()) {
+        QFile file(":/"+id);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return {};
+        }
+
+        // Rasterize outside of the lock, so that several icons can be
+        // rendered at the same time. If two threads render the same icon,
+        // both get the same result.
+        image = rasterize(file.readAll(), id, requestedSize);
+        if (image.isNull()) {
+            return {};
+        }
+        cacheMissesMetric->add();
+
+        QMutexLocker locker(&m_mutex);
+        m_images.insert(key, image);
+    }
+
+    if (size != nullptr) {
+        *size = image.size();
+    }
+    return image;
+}
+
+
+auto Ui::IconImageProvider::rasterize(const QByteArray& iconData, const QString& id, const QSize& requestedSize) const -> QImage
+{
+    // Look into the disk cache first
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(iconData);
+    hash.addData(QByteArray::number(requestedSize.width()));
+    hash.addData("x");
+    hash.addData(QByteArray::number(requestedSize.height()));
+    auto cacheFileName = m_cacheDirectory+"/"+hash.result().toHex()+".png";
+
+    QImage image(cacheFileName);
+    if (!image.isNull()) {
+        return image;
+    }
+
+    // Render the icon
+    if (id.endsWith(u".svg", Qt::CaseInsensitive)) {
+        QSvgRenderer renderer(iconData);
+        if (!renderer.isValid()) {
+            return {};
+        }
+        if (renderer.defaultSize().isEmpty()) {
+            return {};
+        }
+        auto targetSize = scaledSize(renderer.defaultSize(), requestedSize);
+        if (targetSize.isEmpty()) {
+            return {};
+        }
+        image = QImage(targetSize, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        renderer.render(&painter);
+    } else {
+        image = QImage::fromData(iconData);
+        if (image.isNull()) {
+            return {};
+        }
+        auto targetSize = scaledSize(image.size(), requestedSize);
+        if (targetSize != image.size()) {
+            image = image.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+    }
+
+    // Write to the disk cache. QSaveFile ensures that other threads never
+    // read partially written files.
+    QSaveFile cacheFile(cacheFileName);
+    if (cacheFile.open(QIODevice::WriteOnly) && image.save(&cacheFile, "PNG")) {
+        cacheFile.commit();
+    }
+    return image;
+}
@@ -0,0 +1,89 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QQuickImageProvider>
+
+
+namespace Ui {
+
+/*! \brief Image provider that serves icons rasterized from SVG files
+ *
+ *  This image provider serves the icons of the app, such as the icons of
+ *  waypoints and traffic opponents. Icons are requested by URLs of the form
+ *  "image://icons/icons/waypoints/AD.svg", where the part after
+ *  "image://icons/" is the path of the icon in the Qt resource system.
+ *
+ *  Every icon is rasterized only once for every size requested. Qt Quick
+ *  passes the size multiplied by the device pixel ratio, so that there is a
+ *  separate image for every pixel ratio. Rasterized icons are kept in memory
+ *  and in a disk cache, so that icons need not be rendered again after the
+ *  app restarts. The images in the disk cache are identified by a hash of
+ *  the icon file and the size, so that they are never outdated.
+ *
+ *  The images are small, so that the Qt Quick scene graph packs them into
+ *  its shared texture atlas. List views and maps therefore draw icons from a
+ *  single texture and never render SVG files while scrolling.
+ *
+ *  This class is thread safe.
+ */
+
+class IconImageProvider : public QQuickImageProvider
+{
+public:
+    /*! \brief Standard constructor */
+    IconImageProvider();
+
+    /*! \brief Standard destructor */
+    ~IconImageProvider() override = default;
+
+    /*! \brief Serve an icon
+     *
+     *  @param id Path of the icon in the Qt resource system, without the
+     *  leading ":/"
+     *
+     *  @param size If not nullptr, the size of the image is stored here
+     *
+     *  @param requestedSize Size of the image, in physical pixels. If one of
+     *  the dimensions is zero, the aspect ratio of the icon is kept. If the
+     *  size is invalid, the image has the size of the icon file.
+     *
+     *  @returns Rasterized icon, or a null image if the icon cannot be found
+     */
+    QImage requestImage(const QString& id, QSize* size, const QSize& requestedSize) override;
+
+private:
+    Q_DISABLE_COPY_MOVE(IconImageProvider)
+
+    // Rasterizes the icon, reading from or writing to the disk cache
+    QImage rasterize(const QByteArray& iconData, const QString& id, const QSize& requestedSize) const;
+
+    // Directory of the disk cache
+    QString m_cacheDirectory;
+
+    // Rasterized icons, by id and size
+    QMutex m_mutex;
+    QHash<QString, QImage> m_images;
+};
+
+};
@@ -0,0 +1,132 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <chrono>
+
+#include "Metrics.h"
+#include "traffic/TrackHistory.h"
+#include "ui/RenderBudget.h"
+
+using namespace std::chrono_literals;
+
+
+Ui::RenderBudget::RenderBudget(QObject* parent)
+    : GlobalObject(parent)
+{
+    m_evaluationTimer.setInterval(1s);
+    connect(&m_evaluationTimer, &QTimer::timeout, this, &Ui::RenderBudget::evaluate);
+}
+
+
+auto Ui::RenderBudget::trailLength() const -> int
+{
+    switch(m_detailLevel) {
+    case FullDetail:
+        return Traffic::TrackHistory::capacity;
+    case ReducedDetail:
+        return Traffic::TrackHistory::capacity/4;
+    case MinimalDetail:
+        return Traffic::TrackHistory::capacity/16;
+    }
+    return Traffic::TrackHistory::capacity;
+}
+
+
+void Ui::RenderBudget::setWindow(QQuickWindow* window)
+{
+    if (window == m_window) {
+        return;
+    }
+    disconnect(m_frameSwappedConnection);
+    m_window = window;
+    setDetailLevel(FullDetail);
+    m_fastSeconds = 0;
+    if (m_window.isNull()) {
+        m_evaluationTimer.stop();
+        return;
+    }
+
+    // With the threaded render loop, frameSwapped() is emitted on the render
+    // thread. The frame is timed right there, not when a queued signal
+    // arrives on the GUI thread.
+    m_frameTimer.invalidate();
+    m_frames = 0;
+    m_slowFrames = 0;
+    m_frameSwappedConnection = connect(window, &QQuickWindow::frameSwapped, this, &Ui::RenderBudget::onFrameSwapped, Qt::DirectConnection);
+    m_evaluationTimer.start();
+}
+
+
+void Ui::RenderBudget::onFrameSwapped()
+{
+    if (!m_frameTimer.isValid()) {
+        m_frameTimer.start();
+        return;
+    }
+    auto frameTime = m_frameTimer.restart();
+    if (frameTime > idleGapInMS) {
+        return;
+    }
+    m_frames.fetch_add(1, std::memory_order_relaxed);
+    if (frameTime > frameBudgetInMS) {
+        m_slowFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+void Ui::RenderBudget::evaluate()
+{
+    auto frames = m_frames.exchange(0, std::memory_order_relaxed);
+    auto slowFrames = m_slowFrames.exchange(0, std::memory_order_relaxed);
+
+    // Under pressure, lower detail right away. A few frames are not enough to
+    // tell; they happen when the map only moves a little.
+    if ((frames >= 10) && (3*slowFrames > frames)) {
+        m_fastSeconds = 0;
+        if (m_detailLevel != MinimalDetail) {
+            setDetailLevel(static_cast<DetailLevel>(m_detailLevel+1));
+        }
+        return;
+    }
+
+    // Raise detail only after a while with headroom, or with an idle window,
+    // so that the level does not oscillate
+    if (20*slowFrames > frames) {
+        m_fastSeconds = 0;
+        return;
+    }
+    m_fastSeconds++;
+    if ((m_fastSeconds >= recoveryTimeInS) && (m_detailLevel != FullDetail)) {
+        m_fastSeconds = 0;
+        setDetailLevel(static_cast<DetailLevel>(m_detailLevel-1));
+    }
+}
+
+
+void Ui::RenderBudget::setDetailLevel(DetailLevel newDetailLevel)
+{
+    if (newDetailLevel == m_detailLevel) {
+        return;
+    }
+    m_detailLevel = newDetailLevel;
+    static auto* detailLevelMetric = Metrics::gauge(QStringLiteral("render/detailLevel"));
+    detailLevelMetric->set(m_detailLevel);
+    emit detailLevelChanged();
+}
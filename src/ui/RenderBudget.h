@@ -0,0 +1,163 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QQuickWindow>
+#include <QTimer>
+#include <atomic>
+
+#include "GlobalObject.h"
+
+
+namespace Ui {
+
+/*! \brief Lowers the level of detail on the map while frames are slow
+ *
+ * This class watches the frame times of a QQuickWindow. Whenever more than a
+ * third of the frames in a second take longer than frameBudget, it lowers the
+ * property detailLevel by one step. Once frames have been fast for
+ * recoveryTime, or the window has been idle, detailLevel is raised again by
+ * one step. Consumers of the property lower their detail as follows.
+ *
+ * - The moving map hides label layers of minor importance at ReducedDetail,
+ *   and all airspace labels at MinimalDetail.
+ *
+ * - Aviation data tiles are cut from coarser simplifications of the
+ *   airspace geometry, see simplificationReduction(). Because this reloads
+ *   the map style, the GeoMapProvider holds every simplification for a while.
+ *
+ * - Traffic trails are shortened, see trailLength().
+ *
+ * Frame times are measured on the render thread, with a few atomic writes
+ * per frame. All other methods run on the GUI thread.
+ */
+
+class RenderBudget : public GlobalObject
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Level of detail */
+    enum DetailLevel {
+        FullDetail = 0,    /*!< Everything is shown */
+        ReducedDetail = 1, /*!< Minor labels hidden, coarser geometry, shorter trails */
+        MinimalDetail = 2  /*!< All airspace labels hidden, coarsest geometry, short trails */
+    };
+    Q_ENUM(DetailLevel)
+
+    /*! \brief Frames that take longer than this are considered slow */
+    static constexpr qint64 frameBudgetInMS = 40;
+
+    /*! \brief Time with fast frames before detail is raised again */
+    static constexpr int recoveryTimeInS = 5;
+
+    /*! \brief Standard constructor
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit RenderBudget(QObject* parent = nullptr);
+
+    /*! \brief Standard destructor */
+    ~RenderBudget() override = default;
+
+
+    //
+    // Properties
+    //
+
+    /*! \brief Current level of detail */
+    Q_PROPERTY(DetailLevel detailLevel READ detailLevel NOTIFY detailLevelChanged)
+
+    /*! \brief Getter function for the property with the same name
+     *
+     * @returns Property detailLevel
+     */
+    DetailLevel detailLevel() const
+    {
+        return m_detailLevel;
+    }
+
+
+    //
+    // Methods
+    //
+
+    /*! \brief Set window whose frames are watched
+     *
+     * @param window Window that shows the moving map. The detail level is
+     * reset to FullDetail.
+     */
+    void setWindow(QQuickWindow* window);
+
+    /*! \brief Number of zoom levels by which the airspace geometry is coarsened
+     *
+     * @returns Number of zoom levels, for use with AviationData::vectorTile()
+     */
+    int simplificationReduction() const
+    {
+        return 2*static_cast<int>(m_detailLevel);
+    }
+
+    /*! \brief Maximal number of positions in traffic trails
+     *
+     * @returns Number of positions, for use with
+     * TrafficFactor_WithPosition::setTrailLength()
+     */
+    int trailLength() const;
+
+signals:
+    /*! \brief Notifier signal */
+    void detailLevelChanged();
+
+private:
+    Q_DISABLE_COPY_MOVE(RenderBudget)
+
+    // Called on the render thread, after every frame
+    void onFrameSwapped();
+
+    // Called once per second, on the GUI thread
+    void evaluate();
+
+    // Setter function for the property with the same name
+    void setDetailLevel(DetailLevel newDetailLevel);
+
+    // Gaps between frames that are longer than this are idle time
+    static constexpr qint64 idleGapInMS = 250;
+
+    QPointer<QQuickWindow> m_window;
+    QMetaObject::Connection m_frameSwappedConnection;
+    QTimer m_evaluationTimer;
+
+    // Used on the render thread only
+    QElapsedTimer m_frameTimer;
+
+    // Written on the render thread, read and reset on the GUI thread
+    std::atomic<int> m_frames {0};
+    std::atomic<int> m_slowFrames {0};
+
+    // Used on the GUI thread only
+    DetailLevel m_detailLevel {FullDetail};
+    int m_fastSeconds {0};
+};
+
+};
@@ -18,7 +18,14 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include <QGuiApplication>
 #include <QPainter>
+#include <QQuickWindow>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QSGImageNode>
+#include <QSGRectangleNode>
+#include <QtMath>
 #include <cmath>
 
 #include "GlobalObject.h"
@@ -26,21 +33,129 @@
 #include "Settings.h"
 
 
-Ui::ScaleQuickItem::ScaleQuickItem(QQuickItem *parent)
-    : QQuickPaintedItem(parent)
+namespace {
+
+// Root node of the scale. The child nodes are created once and updated in
+// place.
+class ScaleNode : public QSGNode
+{
+public:
+    explicit ScaleNode(QQuickWindow* window)
+    {
+        background = window->createRectangleNode();
+        background->setColor(QColor(0xff, 0xff, 0xff, 0xe0));
+        appendChildNode(background);
+
+        whiteLines = createLineNode(Qt::white);
+        appendChildNode(whiteLines);
+        blackLines = createLineNode(Qt::black);
+        appendChildNode(blackLines);
+
+        label = window->createImageNode();
+        label->setOwnsTexture(true);
+        appendChildNode(label);
+    }
+
+    QSGRectangleNode* background {nullptr};
+    QSGGeometryNode* whiteLines {nullptr};
+    QSGGeometryNode* blackLines {nullptr};
+    QSGImageNode* label {nullptr};
+
+    // Text and orientation of the texture currently shown by label
+    QString labelText;
+    bool labelVertical {false};
+    qreal labelDevicePixelRatio {0.0};
+
+private:
+    static QSGGeometryNode* createLineNode(const QColor& color)
+    {
+        auto* node = new QSGGeometryNode();
+        auto* geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+        geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        node->setGeometry(geometry);
+        auto* material = new QSGFlatColorMaterial();
+        material->setColor(color);
+        node->setMaterial(material);
+        node->setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+        return node;
+    }
+};
+
+// Sets the geometry of a line node. All lines of the scale are horizontal or
+// vertical, so that every line is drawn as a rectangle, with square caps as
+// in QPainter.
+void setLines(QSGGeometryNode* node, const QVector<QLineF>& lines, qreal penWidth)
 {
+    auto* geometry = node->geometry();
+    geometry->allocate(6*lines.size());
+    auto* vertices = geometry->vertexDataAsPoint2D();
+    auto halfWidth = penWidth/2.0;
+    foreach(auto line, lines) {
+        auto left = static_cast<float>(qMin(line.x1(), line.x2())-halfWidth);
+        auto right = static_cast<float>(qMax(line.x1(), line.x2())+halfWidth);
+        auto top = static_cast<float>(qMin(line.y1(), line.y2())-halfWidth);
+        auto bottom = static_cast<float>(qMax(line.y1(), line.y2())+halfWidth);
+        vertices[0].set(left, top);
+        vertices[1].set(right, top);
+        vertices[2].set(left, bottom);
+        vertices[3].set(right, top);
+        vertices[4].set(right, bottom);
+        vertices[5].set(left, bottom);
+        vertices += 6;
+    }
+    node->markDirty(QSGNode::DirtyGeometry);
+}
+
+}
 
+
+Ui::ScaleQuickItem::ScaleQuickItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(QQuickItem::ItemHasContents);
     connect(GlobalObject::settings(), &Settings::useMetricUnitsChanged, this, &QQuickItem::update);
-    setRenderTarget(QQuickPaintedItem::FramebufferObject);
 
+    // Set font to somewhat smaller than standard size.
+    _font = QGuiApplication::font();
+    if (_font.pointSizeF() > 0.0) {
+        _font.setPointSizeF(_font.pointSizeF()*0.8);
+    } else {
+        _font.setPixelSize(qRound(_font.pixelSize()*0.8));
+    }
+    _fontMetrics = QFontMetricsF(_font);
 }
 
 
-void Ui::ScaleQuickItem::paint(QPainter *painter)
+auto Ui::ScaleQuickItem::labelImage(const QString& text, qreal devicePixelRatio) const -> QImage
 {
+    auto textWidth = qCeil(_fontMetrics.horizontalAdvance(text));
+    auto textHeight = qCeil(_fontMetrics.height());
+    QImage image(qCeil(textWidth*devicePixelRatio), qCeil(textHeight*devicePixelRatio), QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(devicePixelRatio);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setFont(_font);
+    painter.setPen(Qt::black);
+    painter.drawText(QPointF(0.0, _fontMetrics.ascent()), text);
+    painter.end();
+
+    if (_vertical) {
+        image = image.transformed(QTransform().rotate(-90.0));
+        image.setDevicePixelRatio(devicePixelRatio);
+    }
+    return image;
+}
+
+
+auto Ui::ScaleQuickItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) -> QSGNode*
+{
+    Q_UNUSED(data)
+
     // Safety check. Continue only if data provided is sane
-    if (_pixelPer10km < 20) {
-        return;
+    if ((_pixelPer10km < 20) || (window() == nullptr)) {
+        delete oldNode;
+        return nullptr;
     }
 
     // Pre-compute a few numbers that will be used when drawing
@@ -52,79 +167,79 @@ void Ui::ScaleQuickItem::paint(QPainter *painter)
     qreal sizeOfScaleInUnit   = floor(scaleSizeInUnit/ScaleUnitInUnit)*ScaleUnitInUnit;
     int   sizeOfScaleInPix    = qRound(sizeOfScaleInUnit*pixelPerUnit);
 
-    // Compute size of text. Set font to somewhat smaller than standard size.
-    QFont font = painter->font();
-    if (font.pointSizeF() > 0.0) {
-        font.setPointSizeF(font.pointSizeF()*0.8);
-    } else {
-        font.setPixelSize(qRound(font.pixelSize()*0.8));
-    }
-    painter->setFont(font);
+    // Compute size of text. The width is computed only when the text changes.
     QString text = QString(_useMetricUnits ? QString("%1 km") : QString("%1 nm")).arg(sizeOfScaleInUnit);
-    int textWidth  = painter->fontMetrics().horizontalAdvance(text);
-    int textHeight = painter->fontMetrics().height();
+    if (text != _labelText) {
+        _labelText = text;
+        _labelWidth = _fontMetrics.horizontalAdvance(text);
+    }
+    auto textWidth  = _labelWidth;
+    auto textHeight = _fontMetrics.height();
 
     // Draw only if width() or height() is large enough
     if (_vertical) {
         if (height() < textWidth*1.5) {
-            return;
+            delete oldNode;
+            return nullptr;
         }
     } else {
         if (width() < textWidth*1.5) {
-            return;
+            delete oldNode;
+            return nullptr;
         }
     }
 
+    auto* node = static_cast<ScaleNode*>(oldNode);
+    if (node == nullptr) {
+        node = new ScaleNode(window());
+    }
+
     // Coordinates for the left/top point of the scale
     int baseX = _vertical ? 8 : qRound((width()-sizeOfScaleInPix)/2.0);
     int baseY = _vertical ? qRound((height()-sizeOfScaleInPix)/2.0) : qRound(height()) - 8 ;
 
-    // Draw underlying white, slightly tranparent rectangle
-    painter->fillRect(0, 0, static_cast<int>(width()), static_cast<int>(height()), QColor(0xff, 0xff, 0xff, 0xe0));
+    // Underlying white, slightly tranparent rectangle
+    node->background->setRect(0, 0, width(), height());
 
-    // Draw scale
+    // Scale, first in white and then in black
+    QVector<QLineF> lines;
     if (_vertical) {
-        painter->setPen(QPen(Qt::white, 2));
-        painter->drawLine(baseX, baseY, baseX, baseY+sizeOfScaleInPix);
-        painter->drawLine(baseX+3, baseY, baseX-3, baseY);
-        painter->drawLine(baseX+3, baseY+sizeOfScaleInPix, baseX-3, baseY+sizeOfScaleInPix);
+        lines.append(QLineF(baseX, baseY, baseX, baseY+sizeOfScaleInPix));
+        lines.append(QLineF(baseX+3, baseY, baseX-3, baseY));
+        lines.append(QLineF(baseX+3, baseY+sizeOfScaleInPix, baseX-3, baseY+sizeOfScaleInPix));
         for(int i=1; i*ScaleUnitInUnit<sizeOfScaleInUnit; i+= 1) {
-            painter->drawLine(baseX, baseY + i*sizeOfUnitInPix, baseX-3, baseY + i*sizeOfUnitInPix);
+            lines.append(QLineF(baseX, baseY + i*sizeOfUnitInPix, baseX-3, baseY + i*sizeOfUnitInPix));
         }
-
-        painter->setPen(QPen(Qt::black, 1));
-        painter->drawLine(baseX, baseY, baseX, baseY+sizeOfScaleInPix);
-        painter->drawLine(baseX+3, baseY, baseX-3, baseY);
-        painter->drawLine(baseX+3, baseY+sizeOfScaleInPix, baseX-3, baseY+sizeOfScaleInPix);
-        for(int i=1; i*ScaleUnitInUnit<sizeOfScaleInUnit; i+= 1) {
-            painter->drawLine(baseX, baseY + i*sizeOfUnitInPix, baseX-3, baseY + i*sizeOfUnitInPix);
-        }
-
-        // Draw text
-        painter->rotate(-90.0);
-        painter->drawText(-qRound(height()/2.0)-textWidth/2, baseX+textHeight, text);
     } else {
-        painter->setPen(QPen(Qt::white, 2));
-        painter->drawLine(baseX, baseY, baseX+sizeOfScaleInPix, baseY);
-        painter->drawLine(baseX, baseY+3, baseX, baseY-3);
-        painter->drawLine(baseX+sizeOfScaleInPix, baseY+3, baseX+sizeOfScaleInPix, baseY-3);
-        for(int i=1; i*ScaleUnitInUnit<sizeOfScaleInUnit; i+= 1) {
-            painter->drawLine(baseX + i*sizeOfUnitInPix, baseY, baseX + i*sizeOfUnitInPix, baseY+3);
-        }
-
-        painter->setPen(QPen(Qt::black, 1));
-        painter->drawLine(baseX, baseY, baseX+sizeOfScaleInPix, baseY);
-        painter->drawLine(baseX, baseY+3, baseX, baseY-3);
-        painter->drawLine(baseX+sizeOfScaleInPix, baseY+3, baseX+sizeOfScaleInPix, baseY-3);
+        lines.append(QLineF(baseX, baseY, baseX+sizeOfScaleInPix, baseY));
+        lines.append(QLineF(baseX, baseY+3, baseX, baseY-3));
+        lines.append(QLineF(baseX+sizeOfScaleInPix, baseY+3, baseX+sizeOfScaleInPix, baseY-3));
         for(int i=1; i*ScaleUnitInUnit<sizeOfScaleInUnit; i+= 1) {
-            painter->drawLine(baseX + i*sizeOfUnitInPix, baseY, baseX + i*sizeOfUnitInPix, baseY+3);
+            lines.append(QLineF(baseX + i*sizeOfUnitInPix, baseY, baseX + i*sizeOfUnitInPix, baseY+3));
         }
-
-        // Draw text
-        painter->drawText(baseX+sizeOfScaleInPix/2-textWidth/2, baseY-5, text);
     }
+    setLines(node->whiteLines, lines, 2.0);
+    setLines(node->blackLines, lines, 1.0);
 
+    // Label. The texture is renewed only if the text, the orientation or the
+    // device pixel ratio have changed.
+    auto devicePixelRatio = window()->effectiveDevicePixelRatio();
+    if ((node->labelText != text) || (node->labelVertical != _vertical) || !qFuzzyCompare(node->labelDevicePixelRatio, devicePixelRatio)) {
+        node->label->setTexture(window()->createTextureFromImage(labelImage(text, devicePixelRatio)));
+        node->labelText = text;
+        node->labelVertical = _vertical;
+        node->labelDevicePixelRatio = devicePixelRatio;
+    }
+    auto labelSize = QSizeF(node->label->texture()->textureSize())/devicePixelRatio;
+    if (_vertical) {
+        // The text runs upwards, with its baseline at x = baseX+textHeight
+        node->label->setRect(QRectF(baseX+textHeight-_fontMetrics.ascent(), height()/2.0-textWidth/2.0, labelSize.width(), labelSize.height()));
+    } else {
+        // The baseline of the text is at y = baseY-5
+        node->label->setRect(QRectF(baseX+sizeOfScaleInPix/2.0-textWidth/2.0, baseY-5-_fontMetrics.ascent(), labelSize.width(), labelSize.height()));
+    }
 
+    return node;
 }
 
 
@@ -20,7 +20,9 @@
 
 #pragma once
 
-#include <QtQuick/QQuickPaintedItem>
+#include <QFont>
+#include <QFontMetricsF>
+#include <QtQuick/QQuickItem>
 
 namespace Ui {
 
@@ -31,10 +33,15 @@ namespace Ui {
  *  map.  To use this class, export it to QML, add it to your view and make sure
  *  that the property pixelPer10km get set accordingly.
  *
+ *  The scale is drawn with scene graph nodes that are kept between frames.
+ *  Changes of pixelPer10km only update a few vertices. The label is
+ *  rasterized into a texture only when its text changes, which happens
+ *  rarely while zooming.
+ *
  *  The methods of this class are re-entrant, but not thread safe.
  */
 
-class ScaleQuickItem : public QQuickPaintedItem
+class ScaleQuickItem : public QQuickItem
 {
   Q_OBJECT
 
@@ -62,11 +69,15 @@ public:
 
   /*! \brief Determines whether the scale should use km or nm */
 
-  /*! \brief Re-implemented from QQuickPaintedItem to implement painting
+  /*! \brief Re-implemented from QQuickItem to implement painting
+   *
+   *  @param oldNode Node returned by the previous call, or nullptr
+   *
+   *  @param data Unused
    *
-   *  @param painter Pointer to the QPainter used for painting
+   *  @returns Root node of the scale, or nullptr if nothing is to be drawn
    */
-  void paint(QPainter *painter) override;
+  QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
 
   /*! \brief Determines whether the scale should be drawn vertically or horizontally
    *
@@ -99,8 +110,19 @@ signals:
 private:
   Q_DISABLE_COPY_MOVE(ScaleQuickItem)
 
+  // Renders the label into an image, at the given device pixel ratio
+  QImage labelImage(const QString& text, qreal devicePixelRatio) const;
+
   qreal _pixelPer10km {0.0};
   bool _vertical {false};
+
+  // Font of the label and its metrics, computed once
+  QFont _font;
+  QFontMetricsF _fontMetrics {_font};
+
+  // Text of the label, and its width in pixels
+  QString _labelText;
+  qreal _labelWidth {0.0};
 };
 
 }
@@ -0,0 +1,310 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QPainter>
+#include <QQuickWindow>
+#include <QSGGeometryNode>
+#include <QSGTextureMaterial>
+#include <QSvgRenderer>
+#include <QtMath>
+
+#include "GlobalObject.h"
+#include "TrafficQuickItem.h"
+#include "traffic/TrafficDataProvider.h"
+
+
+namespace {
+
+// Size of a traffic icon, in device independent pixels
+const qreal iconSize = 30.0;
+
+// Width of the flight vector, in device independent pixels
+const qreal vectorWidth = 3.0;
+
+// Node that draws all traffic opponents. The node owns the texture atlas.
+class TrafficNode : public QSGGeometryNode
+{
+public:
+    TrafficNode()
+    {
+        auto* geometry = new QSGGeometry(QSGGeometry::defaultAttributes_TexturedPoint2D(), 0);
+        geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        geometry->setVertexDataPattern(QSGGeometry::DynamicPattern);
+        setGeometry(geometry);
+        auto* material = new QSGTextureMaterial();
+        material->setFiltering(QSGTexture::Linear);
+        setMaterial(material);
+        setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+    }
+
+    ~TrafficNode() override
+    {
+        delete texture;
+    }
+
+    Q_DISABLE_COPY_MOVE(TrafficNode)
+
+    QSGTexture* texture {nullptr};
+    qreal devicePixelRatio {0.0};
+};
+
+// Appends two triangles for a rectangle, given in the coordinates of a
+// sprite that is rotated by the given sine and cosine around its position
+void appendQuad(QSGGeometry::TexturedPoint2D*& vertices, QPointF position, qreal sine, qreal cosine, const QRectF& rect, const QRectF& textureRect)
+{
+    auto vertex = [&](qreal x, qreal y, qreal u, qreal v) {
+        vertices->set(static_cast<float>(position.x() + x*cosine - y*sine),
+                      static_cast<float>(position.y() + x*sine + y*cosine),
+                      static_cast<float>(u),
+                      static_cast<float>(v));
+        vertices++;
+    };
+    vertex(rect.left(), rect.top(), textureRect.left(), textureRect.top());
+    vertex(rect.right(), rect.top(), textureRect.right(), textureRect.top());
+    vertex(rect.left(), rect.bottom(), textureRect.left(), textureRect.bottom());
+    vertex(rect.right(), rect.top(), textureRect.right(), textureRect.top());
+    vertex(rect.right(), rect.bottom(), textureRect.right(), textureRect.bottom());
+    vertex(rect.left(), rect.bottom(), textureRect.left(), textureRect.bottom());
+}
+
+}
+
+
+Ui::TrafficQuickItem::TrafficQuickItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(QQuickItem::ItemHasContents);
+
+    // Moving traffic is extrapolated at the frame rate of the display
+    _extrapolationTimer.setInterval(16);
+    connect(&_extrapolationTimer, &QTimer::timeout, this, &Ui::TrafficQuickItem::scheduleUpdate);
+
+    connect(this, &QQuickItem::widthChanged, this, &Ui::TrafficQuickItem::scheduleUpdate);
+    connect(this, &QQuickItem::heightChanged, this, &Ui::TrafficQuickItem::scheduleUpdate);
+    connect(GlobalObject::trafficDataProvider(), &Traffic::TrafficDataProvider::trafficObjects4QMLChanged, this, &Ui::TrafficQuickItem::updateTrafficObjects);
+    updateTrafficObjects();
+}
+
+
+auto Ui::TrafficQuickItem::iconAtlas(qreal devicePixelRatio) -> QImage
+{
+    auto cellSize = qCeil(iconSize*devicePixelRatio);
+    QImage atlas((Traffic::TrafficFactor_WithPosition::numIcons+1)*cellSize, cellSize, QImage::Format_ARGB32_Premultiplied);
+    atlas.fill(Qt::transparent);
+
+    QPainter painter(&atlas);
+    for(int i=0; i<Traffic::TrafficFactor_WithPosition::numIcons; i++) {
+        QSvgRenderer renderer(":"+Traffic::TrafficFactor_WithPosition::iconPath(i));
+        renderer.render(&painter, QRectF(i*cellSize, 0, cellSize, cellSize));
+    }
+    auto left = Traffic::TrafficFactor_WithPosition::numIcons*cellSize;
+    painter.fillRect(left, 0, cellSize/2, cellSize, Qt::black);
+    painter.fillRect(left+cellSize/2, 0, cellSize-cellSize/2, cellSize, Qt::white);
+    painter.end();
+
+    return atlas;
+}
+
+
+void Ui::TrafficQuickItem::scheduleUpdate()
+{
+    polish();
+    update();
+}
+
+
+void Ui::TrafficQuickItem::setBearing(qreal newBearing)
+{
+    if (qFuzzyCompare(_bearing, newBearing)) {
+        return;
+    }
+
+    _bearing = newBearing;
+    scheduleUpdate();
+    emit bearingChanged();
+}
+
+
+void Ui::TrafficQuickItem::setMap(QQuickItem* newMap)
+{
+    if (_map == newMap) {
+        return;
+    }
+
+    if (_map != nullptr) {
+        _map->disconnect(this);
+    }
+    _map = newMap;
+    if (_map != nullptr) {
+        // The Map item of QtLocation is not public C++ API, so its signals
+        // are connected by name
+        connect(_map, SIGNAL(centerChanged(QGeoCoordinate)), this, SLOT(scheduleUpdate()));
+        connect(_map, SIGNAL(zoomLevelChanged(qreal)), this, SLOT(scheduleUpdate()));
+        connect(_map, SIGNAL(bearingChanged(qreal)), this, SLOT(scheduleUpdate()));
+        connect(_map, &QQuickItem::widthChanged, this, &Ui::TrafficQuickItem::scheduleUpdate);
+        connect(_map, &QQuickItem::heightChanged, this, &Ui::TrafficQuickItem::scheduleUpdate);
+    }
+    scheduleUpdate();
+    emit mapChanged();
+}
+
+
+void Ui::TrafficQuickItem::setPixelPer10km(qreal newPixelPer10km)
+{
+    if (qFuzzyCompare(_pixelPer10km, newPixelPer10km)) {
+        return;
+    }
+
+    _pixelPer10km = newPixelPer10km;
+    scheduleUpdate();
+    emit pixelPer10kmChanged();
+}
+
+
+auto Ui::TrafficQuickItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) -> QSGNode*
+{
+    Q_UNUSED(data)
+
+    if (window() == nullptr) {
+        delete oldNode;
+        return nullptr;
+    }
+
+    auto* node = static_cast<TrafficNode*>(oldNode);
+    if (node == nullptr) {
+        node = new TrafficNode();
+    }
+
+    // Rasterize the icons only if the device pixel ratio changes
+    auto devicePixelRatio = window()->effectiveDevicePixelRatio();
+    if ((node->texture == nullptr) || !qFuzzyCompare(node->devicePixelRatio, devicePixelRatio)) {
+        delete node->texture;
+        node->texture = window()->createTextureFromImage(iconAtlas(devicePixelRatio));
+        node->devicePixelRatio = devicePixelRatio;
+        static_cast<QSGTextureMaterial*>(node->material())->setTexture(node->texture);
+        node->markDirty(QSGNode::DirtyMaterial);
+    }
+
+    // Texture coordinates of the icons, and of the black and white areas
+    // used for the flight vectors
+    const qreal cellWidth = 1.0/(Traffic::TrafficFactor_WithPosition::numIcons+1);
+    const qreal vectorCell = Traffic::TrafficFactor_WithPosition::numIcons*cellWidth;
+    const QRectF black(vectorCell+0.25*cellWidth, 0.5, 0.0, 0.0);
+    const QRectF white(vectorCell+0.75*cellWidth, 0.5, 0.0, 0.0);
+
+    // Every sprite uses one quad for the icon, and three quads for the
+    // flight vector, if any
+    int numQuads = 0;
+    foreach(const auto& sprite, _sprites) {
+        numQuads += (sprite.vectorLength > 0.0) ? 4 : 1;
+    }
+    auto* geometry = node->geometry();
+    geometry->allocate(6*numQuads);
+    auto* vertices = geometry->vertexDataAsTexturedPoint2D();
+    foreach(const auto& sprite, _sprites) {
+        auto sine = qSin(qDegreesToRadians(sprite.rotation));
+        auto cosine = qCos(qDegreesToRadians(sprite.rotation));
+
+        // Flight vector, pointing along the track, with white stripes for the
+        // second and fourth minute
+        if (sprite.vectorLength > 0.0) {
+            auto length = sprite.vectorLength;
+            appendQuad(vertices, sprite.position, sine, cosine, QRectF(-vectorWidth/2.0, -length, vectorWidth, length), black);
+            appendQuad(vertices, sprite.position, sine, cosine, QRectF(-vectorWidth/2.0+1.0, -4.0*length/5.0, vectorWidth-2.0, length/5.0), white);
+            appendQuad(vertices, sprite.position, sine, cosine, QRectF(-vectorWidth/2.0+1.0, -2.0*length/5.0, vectorWidth-2.0, length/5.0), white);
+        }
+
+        // Icon
+        QRectF iconRect(sprite.iconIndex*cellWidth, 0.0, cellWidth, 1.0);
+        appendQuad(vertices, sprite.position, sine, cosine, QRectF(-iconSize/2.0, -iconSize/2.0, iconSize, iconSize), iconRect);
+    }
+    node->markDirty(QSGNode::DirtyGeometry);
+
+    return node;
+}
+
+
+void Ui::TrafficQuickItem::updatePolish()
+{
+    _sprites.clear();
+    if (_map == nullptr) {
+        _extrapolationTimer.stop();
+        return;
+    }
+
+    auto now = QDateTime::currentDateTimeUtc();
+    bool extrapolating = false;
+    foreach(const auto& trafficObject, _trafficObjects) {
+        if (trafficObject.isNull() || !trafficObject->valid()) {
+            continue;
+        }
+
+        auto positionInfo = trafficObject->positionInfo();
+        auto groundSpeed = positionInfo.groundSpeed();
+        auto track = positionInfo.trueTrack();
+        auto moving = groundSpeed.isFinite() && (groundSpeed.toMPS() > 1) && track.isFinite();
+        extrapolating = extrapolating || moving;
+        auto coordinate = moving ? trafficObject->extrapolatedCoordinate(now) : positionInfo.coordinate();
+
+        QPointF point;
+        if (!QMetaObject::invokeMethod(_map, "fromCoordinate", Q_RETURN_ARG(QPointF, point), Q_ARG(QGeoCoordinate, coordinate), Q_ARG(bool, false))) {
+            continue;
+        }
+        if (!qIsFinite(point.x()) || !qIsFinite(point.y())) {
+            continue;
+        }
+
+        Sprite sprite;
+        sprite.position = _map->mapToItem(this, point);
+        sprite.rotation = track.isFinite() ? track.toDEG()-_bearing : 0.0;
+        sprite.iconIndex = trafficObject->iconIndex();
+        if (groundSpeed.isFinite() && (groundSpeed.toMPS() > 5) && track.isFinite()) {
+            sprite.vectorLength = _pixelPer10km*(5*60*groundSpeed.toMPS())/10000.0;
+        }
+        _sprites.append(sprite);
+    }
+
+    if (extrapolating) {
+        if (!_extrapolationTimer.isActive()) {
+            _extrapolationTimer.start();
+        }
+    } else {
+        _extrapolationTimer.stop();
+    }
+}
+
+
+void Ui::TrafficQuickItem::updateTrafficObjects()
+{
+    foreach(const auto& trafficObject, _trafficObjects) {
+        if (!trafficObject.isNull()) {
+            trafficObject->disconnect(this);
+        }
+    }
+    _trafficObjects.clear();
+
+    foreach(auto* trafficObject, GlobalObject::trafficDataProvider()->trafficObjects()) {
+        _trafficObjects.append(trafficObject);
+        connect(trafficObject, &Traffic::TrafficFactor_WithPosition::iconChanged, this, &Ui::TrafficQuickItem::scheduleUpdate);
+        connect(trafficObject, &Traffic::TrafficFactor_WithPosition::positionInfoChanged, this, &Ui::TrafficQuickItem::scheduleUpdate);
+        connect(trafficObject, &Traffic::TrafficFactor_Abstract::validChanged, this, &Ui::TrafficQuickItem::scheduleUpdate);
+    }
+    scheduleUpdate();
+}
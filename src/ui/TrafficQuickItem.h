@@ -0,0 +1,178 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QPointer>
+#include <QTimer>
+#include <QtQuick/QQuickItem>
+
+#include "traffic/TrafficFactor_WithPosition.h"
+
+namespace Ui {
+
+/*! \brief QML Class that draws all traffic opponents in one batch
+ *
+ *  This class implements a QML item that draws the icons and flight vectors
+ *  of all valid traffic objects of the TrafficDataProvider. The item is meant
+ *  to cover a map, which must be set via the property map. All icons are
+ *  rasterized once into a texture atlas, and all traffic opponents are drawn
+ *  from one vertex buffer with a single scene graph node. The cost of drawing
+ *  therefore does not grow with the number of traffic opponents.
+ *
+ *  Positions are computed in updatePolish(), on the GUI thread, using the
+ *  method fromCoordinate() of the map. Moving traffic is extrapolated at the
+ *  frame rate of the display.
+ *
+ *  The methods of this class are re-entrant, but not thread safe.
+ */
+
+class TrafficQuickItem : public QQuickItem
+{
+  Q_OBJECT
+
+public:
+  /*! \brief Standard constructor
+   *
+   *  @param parent The standard QObject parent pointer
+   */
+  explicit TrafficQuickItem(QQuickItem *parent = nullptr);
+
+  /*! \brief Bearing of the map, in degrees */
+  Q_PROPERTY(qreal bearing READ bearing WRITE setBearing NOTIFY bearingChanged)
+
+  /*! \brief Getter function for the property with the same name
+   *
+   *  @returns Property bearing
+   */
+  qreal bearing() const {return _bearing;}
+
+  /*! \brief Setter function for the property with the same name
+   *
+   *  @param newBearing Property bearing
+   */
+  void setBearing(qreal newBearing);
+
+  /*! \brief Map on which the traffic is drawn
+   *
+   *  This must be a QML Map item. The positions of the traffic opponents are
+   *  computed with its method fromCoordinate().
+   */
+  Q_PROPERTY(QQuickItem* map READ map WRITE setMap NOTIFY mapChanged)
+
+  /*! \brief Getter function for the property with the same name
+   *
+   *  @returns Property map
+   */
+  QQuickItem* map() const {return _map;}
+
+  /*! \brief Setter function for the property with the same name
+   *
+   *  @param newMap Property map
+   */
+  void setMap(QQuickItem* newMap);
+
+  /*! \brief Number of pixel that represent a distance of 10km on the map */
+  Q_PROPERTY(qreal pixelPer10km READ pixelPer10km WRITE setPixelPer10km NOTIFY pixelPer10kmChanged)
+
+  /*! \brief Getter function for the property with the same name
+   *
+   *  @returns Property pixelPer10km
+   */
+  qreal pixelPer10km() const {return _pixelPer10km;}
+
+  /*! \brief Setter function for the property with the same name
+   *
+   *  @param newPixelPer10km Property pixelPer10km
+   */
+  void setPixelPer10km(qreal newPixelPer10km);
+
+  /*! \brief Re-implemented from QQuickItem to compute positions
+   *
+   *  This method computes the positions of all traffic opponents, in item
+   *  coordinates.
+   */
+  void updatePolish() override;
+
+  /*! \brief Re-implemented from QQuickItem to implement painting
+   *
+   *  @param oldNode Node returned by the previous call, or nullptr
+   *
+   *  @param data Unused
+   *
+   *  @returns Node that draws all traffic opponents
+   */
+  QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
+
+signals:
+  /*! \brief Notification signal for property with the same name */
+  void bearingChanged();
+
+  /*! \brief Notification signal for property with the same name */
+  void mapChanged();
+
+  /*! \brief Notification signal for property with the same name */
+  void pixelPer10kmChanged();
+
+private slots:
+  // Schedules computation of the positions and redrawing
+  void scheduleUpdate();
+
+  // Connects to the traffic objects of the TrafficDataProvider
+  void updateTrafficObjects();
+
+private:
+  Q_DISABLE_COPY_MOVE(TrafficQuickItem)
+
+  // Traffic opponent, as drawn on the screen
+  struct Sprite {
+    // Position in item coordinates
+    QPointF position;
+
+    // Rotation in degrees, clockwise
+    qreal rotation {0.0};
+
+    // Index of the icon, as in TrafficFactor_WithPosition::iconIndex()
+    int iconIndex {0};
+
+    // Length of the flight vector in pixels, or 0.0 if no vector is drawn
+    qreal vectorLength {0.0};
+  };
+
+  // Rasterizes all icons into one atlas, at the given device pixel ratio.
+  // The atlas has one cell per icon, followed by a cell that contains a black
+  // and a white area, used for the flight vectors.
+  static QImage iconAtlas(qreal devicePixelRatio);
+
+  qreal _bearing {0.0};
+  QPointer<QQuickItem> _map;
+  qreal _pixelPer10km {0.0};
+
+  // Traffic objects whose signals are connected to scheduleUpdate()
+  QList<QPointer<Traffic::TrafficFactor_WithPosition>> _trafficObjects;
+
+  // Sprites computed by updatePolish(), used by updatePaintNode()
+  QVector<Sprite> _sprites;
+
+  // Triggers extrapolation of moving traffic at the frame rate of the display
+  QTimer _extrapolationTimer;
+};
+
+}
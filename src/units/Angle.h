@@ -22,6 +22,8 @@
 
 #include <QtMath>
 #include <QObject>
+#include <limits>
+#include <type_traits>
 
 /*! \brief Conversion between units used in aviation
  *
@@ -47,7 +49,7 @@ namespace Units {
          *
          * @returns Angle
          */
-        Q_INVOKABLE static Units::Angle fromRAD(double angleInRAD)
+        Q_INVOKABLE static constexpr Units::Angle fromRAD(double angleInRAD)
         {
             Angle result;
             result.m_angleInRAD = angleInRAD;
@@ -60,7 +62,7 @@ namespace Units {
          *
          * @returns Angle
          */
-        Q_INVOKABLE static Units::Angle fromDEG(double angleInDEG)
+        Q_INVOKABLE static constexpr Units::Angle fromDEG(double angleInDEG)
         {
             Angle result;
             result.m_angleInRAD = qDegreesToRadians(angleInDEG);
@@ -71,7 +73,7 @@ namespace Units {
          *
          * @returns Invalid Angle
          */
-        Q_INVOKABLE static Units::Angle nan()
+        Q_INVOKABLE static constexpr Units::Angle nan()
         {
             return {};
         }
@@ -91,7 +93,7 @@ namespace Units {
          *
          * @returns Sum of the two angles
          */
-        Q_INVOKABLE Units::Angle operator+(Units::Angle rhs)
+        Q_INVOKABLE constexpr Units::Angle operator+(Units::Angle rhs) const
         {
             Angle result;
             result.m_angleInRAD = m_angleInRAD + rhs.m_angleInRAD;
@@ -104,7 +106,7 @@ namespace Units {
          *
          * @returns Difference of the two angles
          */
-        Q_INVOKABLE Units::Angle operator-(Units::Angle rhs)
+        Q_INVOKABLE constexpr Units::Angle operator-(Units::Angle rhs) const
         {
             Angle result;
             result.m_angleInRAD = m_angleInRAD - rhs.m_angleInRAD;
@@ -117,7 +119,7 @@ namespace Units {
          *
          *  @returns Result of the comparison
          */
-        Q_INVOKABLE auto operator==(Units::Angle rhs) const
+        Q_INVOKABLE constexpr auto operator==(Units::Angle rhs) const
         {
             return m_angleInRAD == rhs.m_angleInRAD;
         }
@@ -128,7 +130,7 @@ namespace Units {
          *
          *  @returns Result of the comparison
          */
-        Q_INVOKABLE auto operator!=(Units::Angle rhs) const
+        Q_INVOKABLE constexpr auto operator!=(Units::Angle rhs) const
         {
             return m_angleInRAD != rhs.m_angleInRAD;
         }
@@ -189,16 +191,21 @@ namespace Units {
          *
          * @returns Angle, as a number in radian
          */
-        Q_INVOKABLE double toRAD() const
+        Q_INVOKABLE constexpr double toRAD() const
         {
             return m_angleInRAD;
         }
 
     private:
         // Angle in Radians
-        double m_angleInRAD{qQNaN()};
+        double m_angleInRAD{std::numeric_limits<double>::quiet_NaN()};
     };
 };
 
+// Containers may move angles with memcpy, but must construct them, so that
+// new elements are NaN. The same holds for the other classes in Units.
+static_assert(std::is_trivially_copyable<Units::Angle>::value, "Units::Angle must be trivially copyable");
+Q_DECLARE_TYPEINFO(Units::Angle, Q_MOVABLE_TYPE);
+
 // Declare meta types
 Q_DECLARE_METATYPE(Units::Angle)
@@ -0,0 +1,164 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QtMath>
+#include <vector>
+
+#include "units/Angle.h"
+#include "units/Benchmark.h"
+#include "units/Distance.h"
+#include "units/Speed.h"
+#include "units/Time.h"
+
+
+namespace {
+
+// Number of samples and number of passes over the samples
+const int numSamples = 100000;
+const int numPasses = 100;
+
+// Seed for the random number generator
+const quint32 seed = 4711;
+
+// The conversions must be evaluated at compile time
+static_assert(Units::Distance::fromFT(1.0).toM() == 0.3048);
+static_assert(Units::Speed::fromKN(Units::Speed::KN_per_MPS).toMPS() == 1.0);
+static_assert((Units::Distance::fromNM(1.0)+Units::Distance::fromKM(1.0)).toM() == 2852.0);
+static_assert((Units::Angle::fromRAD(1.0)-Units::Angle::fromRAD(0.5)).toRAD() == 0.5);
+
+// Input data, as it arrives from a traffic receiver or from the flight route
+struct Samples {
+    std::vector<double> altitudeInFT;
+    std::vector<double> distanceInM;
+    std::vector<double> directionInDEG;
+    std::vector<double> speedInKN;
+    std::vector<double> windDirectionInDEG;
+    std::vector<double> windSpeedInKN;
+};
+
+auto makeSamples() -> Samples
+{
+    QRandomGenerator generator(seed);
+    Samples samples;
+    for(int i=0; i<numSamples; i++) {
+        samples.altitudeInFT.push_back(generator.bounded(20000.0));
+        samples.distanceInM.push_back(generator.bounded(100000.0));
+        samples.directionInDEG.push_back(generator.bounded(360.0));
+        samples.speedInKN.push_back(80.0+generator.bounded(100.0));
+        samples.windDirectionInDEG.push_back(generator.bounded(360.0));
+        samples.windSpeedInKN.push_back(generator.bounded(40.0));
+    }
+    return samples;
+}
+
+// Conversions done by the traffic data decoders
+auto decodeWithUnits(const Samples& samples) -> double
+{
+    double sum = 0.0;
+    for(int i=0; i<numSamples; i++) {
+        auto altitude = Units::Distance::fromFT(samples.altitudeInFT[i]);
+        auto speed = Units::Speed::fromKN(samples.speedInKN[i]);
+        auto direction = Units::Angle::fromDEG(samples.directionInDEG[i]);
+        sum += altitude.toM() + speed.toMPS() + direction.toRAD();
+    }
+    return sum;
+}
+
+auto decodeWithDoubles(const Samples& samples) -> double
+{
+    double sum = 0.0;
+    for(int i=0; i<numSamples; i++) {
+        auto altitudeInM = samples.altitudeInFT[i]*0.3048;
+        auto speedInMPS = samples.speedInKN[i]/Units::Speed::KN_per_MPS;
+        auto directionInRAD = qDegreesToRadians(samples.directionInDEG[i]);
+        sum += altitudeInM + speedInMPS + directionInRAD;
+    }
+    return sum;
+}
+
+// Wind triangle and flight time, as in Navigation::FlightRoute::Leg
+auto legWithUnits(const Samples& samples) -> double
+{
+    double sum = 0.0;
+    for(int i=0; i<numSamples; i++) {
+        auto TC = Units::Angle::fromDEG(samples.directionInDEG[i]);
+        auto WD = Units::Angle::fromDEG(samples.windDirectionInDEG[i]);
+        auto TASInKN = Units::Speed::fromKN(samples.speedInKN[i]).toKN();
+        auto WSInKN = Units::Speed::fromKN(samples.windSpeedInKN[i]).toKN();
+
+        auto WCA = Units::Angle::asin(-(TC-WD).sin()*(WSInKN/TASInKN));
+        auto GSInKN = qSqrt(TASInKN*TASInKN + WSInKN*WSInKN - 2.0*TASInKN*WSInKN*(WD-(TC+WCA)).cos());
+        auto time = Units::Distance::fromM(samples.distanceInM[i])/Units::Speed::fromKN(GSInKN);
+        sum += time.toH();
+    }
+    return sum;
+}
+
+auto legWithDoubles(const Samples& samples) -> double
+{
+    double sum = 0.0;
+    for(int i=0; i<numSamples; i++) {
+        auto TC = qDegreesToRadians(samples.directionInDEG[i]);
+        auto WD = qDegreesToRadians(samples.windDirectionInDEG[i]);
+        auto TASInKN = samples.speedInKN[i];
+        auto WSInKN = samples.windSpeedInKN[i];
+
+        auto WCA = std::asin(-std::sin(TC-WD)*(WSInKN/TASInKN));
+        auto GSInKN = qSqrt(TASInKN*TASInKN + WSInKN*WSInKN - 2.0*TASInKN*WSInKN*std::cos(WD-(TC+WCA)));
+        if (qFuzzyIsNull(GSInKN)) {
+            continue;
+        }
+        sum += samples.distanceInM[i]/(GSInKN/Units::Speed::KN_per_MPS)/3600.0;
+    }
+    return sum;
+}
+
+// Runs the function numPasses times and returns the running time in ms. The
+// result of the function is added to checksum, so that the compiler cannot
+// remove the computation.
+auto measure(double (*function)(const Samples&), const Samples& samples, double& checksum) -> qint64
+{
+    QElapsedTimer timer;
+    timer.start();
+    for(int pass=0; pass<numPasses; pass++) {
+        checksum += function(samples);
+    }
+    return timer.elapsed();
+}
+
+}
+
+
+auto Units::Benchmark::run() -> int
+{
+    QTextStream out(stdout);
+    auto samples = makeSamples();
+    double checksum = 0.0;
+
+    out << QStringLiteral("Decoder conversions, units: %1 ms").arg(measure(decodeWithUnits, samples, checksum)) << Qt::endl;
+    out << QStringLiteral("Decoder conversions, doubles: %1 ms").arg(measure(decodeWithDoubles, samples, checksum)) << Qt::endl;
+    out << QStringLiteral("Leg wind triangle, units: %1 ms").arg(measure(legWithUnits, samples, checksum)) << Qt::endl;
+    out << QStringLiteral("Leg wind triangle, doubles: %1 ms").arg(measure(legWithDoubles, samples, checksum)) << Qt::endl;
+    out << QStringLiteral("Checksum: %1").arg(checksum) << Qt::endl;
+    return 0;
+}
@@ -0,0 +1,47 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+
+namespace Units {
+
+/*! \brief Compares computations with units to computations with plain doubles
+ *
+ * This class runs the same computations twice, once with the classes of the
+ * Units namespace and once with plain doubles, and writes the running times
+ * to stdout. The computations are the conversions done by the traffic data
+ * decoders and the wind triangle computed by Navigation::FlightRoute::Leg.
+ * Since all conversions of the Units classes are inline, both variants should
+ * take the same time. The benchmark is built as the separate executable
+ * "enroute-units-benchmark", which is not built by default.
+ */
+
+class Benchmark
+{
+public:
+    /*! \brief Run the benchmark
+     *
+     * @returns Exit code for the application, zero on success
+     */
+    static int run();
+};
+
+};
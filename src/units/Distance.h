@@ -22,6 +22,8 @@
 
 #include <QtMath>
 #include <QObject>
+#include <limits>
+#include <type_traits>
 
 
 namespace Units {
@@ -80,7 +82,7 @@ namespace Units {
          *
          * @returns distance
          */
-        static Distance fromFT(double distanceInFT)
+        static constexpr Distance fromFT(double distanceInFT)
         {
             Distance result;
             result.m_distanceInM = distanceInFT * MetersPerFeet;
@@ -93,7 +95,7 @@ namespace Units {
          *
          * @returns reference to this distance
          */
-        Q_INVOKABLE Units::Distance &operator+=(Units::Distance other)
+        Q_INVOKABLE constexpr Units::Distance &operator+=(Units::Distance other)
         {
             m_distanceInM += other.m_distanceInM;
             return *this;
@@ -112,7 +114,7 @@ namespace Units {
          *
          * @returns True is the distance is negative
          */
-        Q_INVOKABLE bool isNegative() const
+        Q_INVOKABLE constexpr bool isNegative() const
         {
             return m_distanceInM < 0.0;
         }
@@ -123,7 +125,7 @@ namespace Units {
          *
          *  @returns Result of the addition
          */
-        Q_INVOKABLE auto operator+(Units::Distance rhs) const -> Units::Distance
+        Q_INVOKABLE constexpr auto operator+(Units::Distance rhs) const -> Units::Distance
         {
             return fromM(m_distanceInM + rhs.m_distanceInM);
         }
@@ -134,7 +136,7 @@ namespace Units {
          *
          *  @returns Result of the subtraction
          */
-        Q_INVOKABLE auto operator-(Units::Distance rhs) const -> Units::Distance
+        Q_INVOKABLE constexpr auto operator-(Units::Distance rhs) const -> Units::Distance
         {
             return fromM(m_distanceInM - rhs.m_distanceInM);
         }
@@ -145,7 +147,7 @@ namespace Units {
          *
          *  @returns Result of the comparison
          */
-        Q_INVOKABLE auto operator<(Units::Distance rhs) const
+        Q_INVOKABLE constexpr auto operator<(Units::Distance rhs) const
         {
             return m_distanceInM < rhs.m_distanceInM;
         }
@@ -156,7 +158,7 @@ namespace Units {
          *
          *  @returns Result of the comparison
          */
-        Q_INVOKABLE auto operator>(Units::Distance rhs) const
+        Q_INVOKABLE constexpr auto operator>(Units::Distance rhs) const
         {
             return m_distanceInM > rhs.m_distanceInM;
         }
@@ -167,7 +169,7 @@ namespace Units {
          *
          *  @returns Result of the comparison
          */
-        Q_INVOKABLE auto operator!=(Units::Distance rhs) const
+        Q_INVOKABLE constexpr auto operator!=(Units::Distance rhs) const
         {
             return m_distanceInM != rhs.m_distanceInM;
         }
@@ -178,7 +180,7 @@ namespace Units {
          *
          *  @returns Result of the comparison
          */
-        Q_INVOKABLE auto operator==(Units::Distance rhs) const
+        Q_INVOKABLE constexpr auto operator==(Units::Distance rhs) const
         {
             return m_distanceInM == rhs.m_distanceInM;
         }
@@ -187,7 +189,7 @@ namespace Units {
          *
          * @returns distance in nautical miles
          */
-        Q_INVOKABLE double toNM() const
+        Q_INVOKABLE constexpr double toNM() const
         {
             return m_distanceInM / MetersPerNauticalMile;
         }
@@ -196,7 +198,7 @@ namespace Units {
          *
          * @returns distance in meters
          */
-        Q_INVOKABLE double toM() const
+        Q_INVOKABLE constexpr double toM() const
         {
             return m_distanceInM;
         }
@@ -205,7 +207,7 @@ namespace Units {
          *
          * @returns distance in meters
          */
-        Q_INVOKABLE double toKM() const
+        Q_INVOKABLE constexpr double toKM() const
         {
             return m_distanceInM / 1000.;
         }
@@ -214,7 +216,7 @@ namespace Units {
          *
          * @returns distance in feet
          */
-        Q_INVOKABLE double toFeet() const
+        Q_INVOKABLE constexpr double toFeet() const
         {
             return m_distanceInM / MetersPerFeet;
         }
@@ -248,5 +250,8 @@ namespace Units {
 };
 
 
+static_assert(std::is_trivially_copyable<Units::Distance>::value, "Units::Distance must be trivially copyable");
+Q_DECLARE_TYPEINFO(Units::Distance, Q_MOVABLE_TYPE);
+
 // Declare meta types
 Q_DECLARE_METATYPE(Units::Distance)
@@ -23,6 +23,8 @@
 #include <QDataStream>
 #include <QtMath>
 #include <QObject>
+#include <limits>
+#include <type_traits>
 
 namespace Units {
 
@@ -100,7 +102,7 @@ namespace Units {
          *
          * @returns True is the distance is negative
          */
-        Q_INVOKABLE bool isNegative() const
+        Q_INVOKABLE constexpr bool isNegative() const
         {
             return _speedInMPS < 0.0;
         }
@@ -111,7 +113,7 @@ namespace Units {
          *
          * @returns Quotient as a dimension-less number
          */
-        Q_INVOKABLE double operator/(Units::Speed rhs)
+        Q_INVOKABLE double operator/(Units::Speed rhs) const
         {
             if (qFuzzyIsNull(rhs._speedInMPS))
                 return qQNaN();
@@ -124,7 +126,7 @@ namespace Units {
          *
          *  @returns Result of the comparison
          */
-        Q_INVOKABLE bool operator==(Units::Speed rhs) const
+        Q_INVOKABLE constexpr bool operator==(Units::Speed rhs) const
         {
             return _speedInMPS == rhs._speedInMPS;
         }
@@ -135,7 +137,7 @@ namespace Units {
          *
          *  @returns Result of the comparison
          */
-        Q_INVOKABLE bool operator!=(Units::Speed rhs) const
+        Q_INVOKABLE constexpr bool operator!=(Units::Speed rhs) const
         {
             return _speedInMPS != rhs._speedInMPS;
         }
@@ -146,7 +148,7 @@ namespace Units {
          *
          *  @returns Result of the comparison
          */
-        Q_INVOKABLE bool operator<(Units::Speed rhs) const
+        Q_INVOKABLE constexpr bool operator<(Units::Speed rhs) const
         {
             return _speedInMPS < rhs._speedInMPS;
         }
@@ -157,7 +159,7 @@ namespace Units {
          *
          *  @returns Result of the comparison
          */
-        Q_INVOKABLE bool operator>(Units::Speed rhs) const
+        Q_INVOKABLE constexpr bool operator>(Units::Speed rhs) const
         {
             return _speedInMPS > rhs._speedInMPS;
         }
@@ -166,7 +168,7 @@ namespace Units {
          *
          * @returns Speed in feet per minute
          */
-        Q_INVOKABLE double toFPM() const
+        Q_INVOKABLE constexpr double toFPM() const
         {
             return _speedInMPS * FPM_per_MPS;
         }
@@ -175,7 +177,7 @@ namespace Units {
          *
          * @returns speed in meters per second
          */
-        Q_INVOKABLE double toMPS() const
+        Q_INVOKABLE constexpr double toMPS() const
         {
             return _speedInMPS;
         }
@@ -184,7 +186,7 @@ namespace Units {
          *
          * @returns speed in knots (=Nautical miles per hour)
          */
-        Q_INVOKABLE double toKN() const
+        Q_INVOKABLE constexpr double toKN() const
         {
             return _speedInMPS * KN_per_MPS;
         }
@@ -193,7 +195,7 @@ namespace Units {
          *
          * @returns speed in knots (=Nautical miles per hour)
          */
-        Q_INVOKABLE double toKMH() const
+        Q_INVOKABLE constexpr double toKMH() const
         {
             return _speedInMPS * KMH_per_MPS;
         }
@@ -249,5 +251,8 @@ QDataStream &operator<<(QDataStream &out, Units::Speed speed);
 QDataStream &operator>>(QDataStream &in, Units::Speed &speed);
 
 
+static_assert(std::is_trivially_copyable<Units::Speed>::value, "Units::Speed must be trivially copyable");
+Q_DECLARE_TYPEINFO(Units::Speed, Q_MOVABLE_TYPE);
+
 // Declare meta types
 Q_DECLARE_METATYPE(Units::Speed)
@@ -22,6 +22,8 @@
 
 #include <QtMath>
 #include <QObject>
+#include <limits>
+#include <type_traits>
 
 #include "units/Distance.h"
 #include "units/Speed.h"
@@ -44,7 +46,7 @@ namespace Units {
          *
          * @returns time
          */
-        static Time fromS(double timeInS) {
+        static constexpr Time fromS(double timeInS) {
             Time result;
             result._timeInS = timeInS;
             return result;
@@ -63,7 +65,7 @@ namespace Units {
          *
          * @returns True is the time is negative
          */
-        Q_INVOKABLE bool isNegative() const
+        Q_INVOKABLE constexpr bool isNegative() const
         {
             return _timeInS < 0.0;
         }
@@ -74,7 +76,7 @@ namespace Units {
          *
          * @returns reference to this time
          */
-        Q_INVOKABLE Units::Time &operator+=(Units::Time other)
+        Q_INVOKABLE constexpr Units::Time &operator+=(Units::Time other)
         {
             _timeInS += other._timeInS;
             return *this;
@@ -84,7 +86,7 @@ namespace Units {
          *
          * @return time in seconds
          */
-        Q_INVOKABLE double toS() const
+        Q_INVOKABLE constexpr double toS() const
         {
             return _timeInS;
         }
@@ -93,7 +95,7 @@ namespace Units {
          *
          * @return time in minutes
          */
-        Q_INVOKABLE double toM() const
+        Q_INVOKABLE constexpr double toM() const
         {
             return _timeInS / Seconds_per_Minute;
         }
@@ -102,7 +104,7 @@ namespace Units {
          *
          * @return time in hours
          */
-        Q_INVOKABLE double toH() const
+        Q_INVOKABLE constexpr double toH() const
         {
             return _timeInS / Seconds_per_Hour;
         }
@@ -118,7 +120,7 @@ namespace Units {
         static constexpr double Seconds_per_Hour = 60.0 * 60.0;
 
         // Speed in meters per second
-        double _timeInS{qQNaN()};
+        double _timeInS{std::numeric_limits<double>::quiet_NaN()};
     };
 };
 
@@ -139,5 +141,8 @@ namespace Units {
 }
 
 
+static_assert(std::is_trivially_copyable<Units::Time>::value, "Units::Time must be trivially copyable");
+Q_DECLARE_TYPEINFO(Units::Time, Q_MOVABLE_TYPE);
+
 // Declare meta types
 Q_DECLARE_METATYPE(Units::Time)
@@ -25,6 +25,8 @@
 
 
 #include <QDebug>
+#include <QHash>
+#include <QMutex>
 #include <QTimeZone>
 #include <gsl/gsl>
 
@@ -35,22 +37,114 @@
 #include "weather/Decoder.h"
 
 
-Weather::Decoder::Decoder(QObject *parent)
+namespace {
+
+// Table of translated strings for the values of one enum. The decoder calls
+// the …ToString methods for every group of every report, and each call to
+// tr() looks up the translators. The table computes the string of a value
+// only once, and again only after the translators have been changed. Lookups
+// are thread-safe.
+template<typename Enum>
+class TranslationTable
+{
+public:
+    QString lookup(Enum value, QString (*translate)(Enum))
+    {
+        QMutexLocker locker(&m_mutex);
+
+        auto generation = Settings::translatorGenerationStatic();
+        if (generation != m_generation) {
+            m_strings.clear();
+            m_generation = generation;
+        }
+
+        auto key = static_cast<int>(value);
+        auto iterator = m_strings.constFind(key);
+        if (iterator == m_strings.constEnd()) {
+            iterator = m_strings.insert(key, translate(value));
+        }
+        return *iterator;
+    }
+
+private:
+    QMutex m_mutex;
+    QHash<int, QString> m_strings;
+    int m_generation {-1};
+};
+
+} // namespace
+
+
+Weather::Decoder::Decoder(QObject *parent, bool watchGlobalObjects)
     : QObject(parent)
 {
-    // Re-parse the text whenever the date changes
-    connect(GlobalObject::navigator()->clock(), &Navigation::Clock::dateChanged, this, &Weather::Decoder::parse);
+    if (!watchGlobalObjects) {
+        return;
+    }
+
+    // Re-generate texts whenever the date changes
+    connect(GlobalObject::navigator()->clock(), &Navigation::Clock::dateChanged, this, &Weather::Decoder::invalidateDecodedText);
+
+    // Re-generate texts whenever the preferred unit system changes
+    connect(GlobalObject::settings(), &Settings::useMetricUnitsChanged, this, &Weather::Decoder::invalidateDecodedText);
+}
+
+
+auto Weather::Decoder::decode(const QString& rawText, QDate referenceDate) -> Decoded
+{
+    Decoder decoder(nullptr, false);
+    decoder._rawText = rawText;
+    decoder._referenceDate = referenceDate;
+    decoder.parse();
+    decoder.readCurrentWeather();
+
+    return {decoder._metadata, decoder._currentWeather};
+}
 
-    // Re-parse whenever the preferred unit system changes
-    connect(GlobalObject::settings(), &Settings::useMetricUnitsChanged, this, &Weather::Decoder::parse);
+
+auto Weather::Decoder::currentWeather() const -> QString
+{
+    if (!_currentWeatherValid) {
+        // The visitor methods of metaf are not const. Computing the current
+        // weather does, however, not change any observable state of this
+        // object.
+        auto* self = const_cast<Weather::Decoder*>(this);
+        self->ensureParsed();
+        self->readCurrentWeather();
+    }
+    return _currentWeather;
 }
 
 
-auto Weather::Decoder::messageType() const -> QString
+auto Weather::Decoder::decodedText() const -> QString
 {
-    switch(parseResult.reportMetadata.type) {
+    if (!_decodedTextValid) {
+        // See currentWeather()
+        auto* self = const_cast<Weather::Decoder*>(this);
+        self->ensureParsed();
+        self->generateDecodedText();
+    }
+    return _decodedText;
+}
+
+
+auto Weather::Decoder::releaseDecodedText() -> qint64
+{
+    if (!_decodedTextValid) {
+        return 0;
+    }
+    auto size = _decodedText.size()*qint64(sizeof(QChar));
+    _decodedTextValid = false;
+    _decodedText = QString();
+    return size;
+}
+
+
+auto Weather::Decoder::messageType(const Metadata& metadata) -> QString
+{
+    switch(metadata.type) {
     case ReportType::METAR:
-        if (parseResult.reportMetadata.isSpeci) {
+        if (metadata.isSpeci) {
             return "METAR/SPECI";
         }
         return "METAR";
@@ -72,32 +166,117 @@ void Weather::Decoder::setRawText(const QString& rawText, QDate referenceDate)
     _rawText = rawText;
     emit rawTextChanged();
     parse();
+    invalidateDecodedText();
 }
 
 
-void Weather::Decoder::parse()
+void Weather::Decoder::setRawText(const QString& rawText, QDate referenceDate, Metadata metadata)
 {
-    auto oldDecodedText = _decodedText;
+    if ((_rawText == rawText) && (_referenceDate == referenceDate)) {
+        return;
+    }
+
+    _referenceDate = referenceDate;
+    _rawText = rawText;
+    _metadata = metadata;
+    _parsed = false;
+    parseResult = {};
+    emit rawTextChanged();
+    invalidateDecodedText();
+}
 
+
+void Weather::Decoder::parse()
+{
     parseResult = metaf::Parser::parse(_rawText.toStdString());
-    QStringList decodedStrings;
-    decodedStrings.reserve(64);
-    QString listStart = "<ul style=\"margin-left:-25px;\">";
-    QString listEnd = "</ul>";
+    _parsed = true;
+    _metadata = {parseResult.reportMetadata.type, parseResult.reportMetadata.isSpeci, parseResult.reportMetadata.error != metaf::ReportError::NONE};
+}
+
+
+void Weather::Decoder::ensureParsed()
+{
+    if (!_parsed) {
+        parse();
+    }
+}
+
+
+void Weather::Decoder::invalidateDecodedText()
+{
+    // The current weather is computed again when it is next read
+    _currentWeatherValid = false;
+    _currentWeather.clear();
+
+    // If the decoded text has never been read, then nobody needs to be told
+    // that it changed
+    if (!_decodedTextValid) {
+        return;
+    }
+    _decodedTextValid = false;
+    _decodedText.clear();
+    emit decodedTextChanged();
+}
+
+
+void Weather::Decoder::readCurrentWeather()
+{
+    _currentWeather.clear();
     for (const auto &groupInfo : parseResult.groups) {
-        auto decodedString = visit(groupInfo);
-        if (decodedString.contains("<strong>")) {
-            decodedStrings << listEnd+"<li>"+decodedString+"</li>"+listStart;
+        if (groupInfo.reportPart != ReportPart::METAR) {
+            continue;
         }
-        else {
-            decodedStrings << "<li>"+decodedString+"</li>";
+        const auto* group = std::get_if<metaf::WeatherGroup>(&groupInfo.group);
+        if ((group == nullptr) || !group->isValid()) {
+            continue;
         }
+
+        QStringList phenomenaList;
+        phenomenaList.reserve(8);
+        for (const auto p : group->weatherPhenomena()) {
+            phenomenaList << Weather::Decoder::explainWeatherPhenomena(p);
+        }
+        _currentWeather = phenomenaList.join(" • ");
     }
-    _decodedText = listStart+decodedStrings.join("\n")+listEnd+"<br>";
+    _currentWeatherValid = true;
+}
+
+
+void Weather::Decoder::generateDecodedText()
+{
+    const QLatin1String listStart("<ul style=\"margin-left:-25px;\">");
+    const QLatin1String listEnd("</ul>");
+
+    // The decoded text of a group is typically more than ten times longer than its
+    // raw text; reserve enough to avoid reallocations
+    _decodedText.clear();
+    _decodedText.reserve(16*_rawText.size()+256);
+    _decodedText += listStart;
+    bool first = true;
+    for (const auto &groupInfo : parseResult.groups) {
+        if (!first) {
+            _decodedText += QLatin1Char('\n');
+        }
+        first = false;
 
-    if (_decodedText != oldDecodedText) {
-        emit decodedTextChanged();
+        auto decodedString = visit(groupInfo);
+        if (decodedString.contains(QLatin1String("<strong>"))) {
+            _decodedText += listEnd;
+            _decodedText += QLatin1String("<li>");
+            _decodedText += decodedString;
+            _decodedText += QLatin1String("</li>");
+            _decodedText += listStart;
+        }
+        else {
+            _decodedText += QLatin1String("<li>");
+            _decodedText += decodedString;
+            _decodedText += QLatin1String("</li>");
+        }
     }
+    _decodedText += listEnd;
+    _decodedText += QLatin1String("<br>");
+    _decodedText.squeeze();
+    _decodedTextValid = true;
 }
 
 
@@ -366,7 +545,7 @@ auto Weather::Decoder::explainSpeed(metaf::Speed speed) -> QString {
         return tr("not reported");
     }
 
-    if (GlobalObject::settings()->useMetricUnits()) {
+    if (Settings::useMetricUnitsStatic()) {
         const auto s = speed.toUnit(metaf::Speed::Unit::KILOMETERS_PER_HOUR);
         if (s.has_value()) {
             return QString("%1 km/h").arg(qRound(*s));
@@ -539,626 +718,674 @@ auto Weather::Decoder::explainWeatherPhenomena(const metaf::WeatherPhenomena & w
 
 auto Weather::Decoder::brakingActionToString(metaf::SurfaceFriction::BrakingAction brakingAction) -> QString
 {
-    switch(brakingAction) {
-    case metaf::SurfaceFriction::BrakingAction::NONE:
-        return tr("not reported");
+    static TranslationTable<metaf::SurfaceFriction::BrakingAction> table;
+    return table.lookup(brakingAction, [](metaf::SurfaceFriction::BrakingAction value) -> QString {
+        switch(value) {
+        case metaf::SurfaceFriction::BrakingAction::NONE:
+            return tr("not reported");
 
-    case metaf::SurfaceFriction::BrakingAction::POOR:
-        return tr("poor (friction coefficient 0.0 to 0.25)");
+        case metaf::SurfaceFriction::BrakingAction::POOR:
+            return tr("poor (friction coefficient 0.0 to 0.25)");
 
-    case metaf::SurfaceFriction::BrakingAction::MEDIUM_POOR:
-        return tr("medium/poor (friction coefficient 0.26 to 0.29)");
+        case metaf::SurfaceFriction::BrakingAction::MEDIUM_POOR:
+            return tr("medium/poor (friction coefficient 0.26 to 0.29)");
 
-    case metaf::SurfaceFriction::BrakingAction::MEDIUM:
-        return tr("medium (friction coefficient 0.30 to 0.35)");
+        case metaf::SurfaceFriction::BrakingAction::MEDIUM:
+            return tr("medium (friction coefficient 0.30 to 0.35)");
 
-    case metaf::SurfaceFriction::BrakingAction::MEDIUM_GOOD:
-        return tr("medium/good (friction coefficient 0.36 to 0.40)");
+        case metaf::SurfaceFriction::BrakingAction::MEDIUM_GOOD:
+            return tr("medium/good (friction coefficient 0.36 to 0.40)");
 
-    case metaf::SurfaceFriction::BrakingAction::GOOD:
-        return tr("good (friction coefficient 0.40 to 1.00)");
-    }
-    return QString();
+        case metaf::SurfaceFriction::BrakingAction::GOOD:
+            return tr("good (friction coefficient 0.40 to 1.00)");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::cardinalDirectionToString(metaf::Direction::Cardinal cardinal) -> QString
 {
-    switch(cardinal) {
-    case metaf::Direction::Cardinal::NOT_REPORTED:
-        return tr("not reported");
+    static TranslationTable<metaf::Direction::Cardinal> table;
+    return table.lookup(cardinal, [](metaf::Direction::Cardinal value) -> QString {
+        switch(value) {
+        case metaf::Direction::Cardinal::NOT_REPORTED:
+            return tr("not reported");
 
-    case metaf::Direction::Cardinal::N:
-        return tr("north");
+        case metaf::Direction::Cardinal::N:
+            return tr("north");
 
-    case metaf::Direction::Cardinal::S:
-        return tr("south");
+        case metaf::Direction::Cardinal::S:
+            return tr("south");
 
-    case metaf::Direction::Cardinal::W:
-        return tr("west");
+        case metaf::Direction::Cardinal::W:
+            return tr("west");
 
-    case metaf::Direction::Cardinal::E:
-        return tr("east");
+        case metaf::Direction::Cardinal::E:
+            return tr("east");
 
-    case metaf::Direction::Cardinal::NW:
-        return tr("northwest");
+        case metaf::Direction::Cardinal::NW:
+            return tr("northwest");
 
-    case metaf::Direction::Cardinal::NE:
-        return tr("northeast");
+        case metaf::Direction::Cardinal::NE:
+            return tr("northeast");
 
-    case metaf::Direction::Cardinal::SW:
-        return tr("southwest");
+        case metaf::Direction::Cardinal::SW:
+            return tr("southwest");
 
-    case metaf::Direction::Cardinal::SE:
-        return tr("southeast");
+        case metaf::Direction::Cardinal::SE:
+            return tr("southeast");
 
-    case metaf::Direction::Cardinal::TRUE_N:
-        return tr("true north");
+        case metaf::Direction::Cardinal::TRUE_N:
+            return tr("true north");
 
-    case metaf::Direction::Cardinal::TRUE_W:
-        return tr("true west");
+        case metaf::Direction::Cardinal::TRUE_W:
+            return tr("true west");
 
-    case metaf::Direction::Cardinal::TRUE_S:
-        return tr("true south");
+        case metaf::Direction::Cardinal::TRUE_S:
+            return tr("true south");
 
-    case metaf::Direction::Cardinal::TRUE_E:
-        return tr("true east");
+        case metaf::Direction::Cardinal::TRUE_E:
+            return tr("true east");
 
-    case metaf::Direction::Cardinal::NDV:
-        return tr("no directional variations");
+        case metaf::Direction::Cardinal::NDV:
+            return tr("no directional variations");
 
-    case metaf::Direction::Cardinal::VRB:
-        return "variable";
+        case metaf::Direction::Cardinal::VRB:
+            return "variable";
 
-    case metaf::Direction::Cardinal::OHD:
-        return "overhead";
+        case metaf::Direction::Cardinal::OHD:
+            return "overhead";
 
-    case metaf::Direction::Cardinal::ALQDS:
-        return "all quadrants (in all directions)";
+        case metaf::Direction::Cardinal::ALQDS:
+            return "all quadrants (in all directions)";
 
-    case metaf::Direction::Cardinal::UNKNOWN:
-        return "unknown direction";
-    }
-    return QString();
+        case metaf::Direction::Cardinal::UNKNOWN:
+            return "unknown direction";
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::cloudAmountToString(metaf::CloudGroup::Amount amount) -> QString
 {
-    switch (amount) {
-    case metaf::CloudGroup::Amount::NOT_REPORTED:
-        return tr("Cloud amount not reported");
+    static TranslationTable<metaf::CloudGroup::Amount> table;
+    return table.lookup(amount, [](metaf::CloudGroup::Amount value) -> QString {
+        switch(value) {
+        case metaf::CloudGroup::Amount::NOT_REPORTED:
+            return tr("Cloud amount not reported");
 
-    case metaf::CloudGroup::Amount::NSC:
-        return tr("No significant cloud");
+        case metaf::CloudGroup::Amount::NSC:
+            return tr("No significant cloud");
 
-    case metaf::CloudGroup::Amount::NCD:
-        return tr("No cloud detected");
+        case metaf::CloudGroup::Amount::NCD:
+            return tr("No cloud detected");
 
-    case metaf::CloudGroup::Amount::NONE_CLR:
-    case metaf::CloudGroup::Amount::NONE_SKC:
-        return tr("Clear sky");
+        case metaf::CloudGroup::Amount::NONE_CLR:
+        case metaf::CloudGroup::Amount::NONE_SKC:
+            return tr("Clear sky");
 
-    case metaf::CloudGroup::Amount::FEW:
-        return tr("Few clouds");
+        case metaf::CloudGroup::Amount::FEW:
+            return tr("Few clouds");
 
-    case metaf::CloudGroup::Amount::SCATTERED:
-        return tr("Scattered clouds");
+        case metaf::CloudGroup::Amount::SCATTERED:
+            return tr("Scattered clouds");
 
-    case metaf::CloudGroup::Amount::BROKEN:
-        return tr("Broken clouds");
+        case metaf::CloudGroup::Amount::BROKEN:
+            return tr("Broken clouds");
 
-    case metaf::CloudGroup::Amount::OVERCAST:
-        return tr("Overcast clouds");
+        case metaf::CloudGroup::Amount::OVERCAST:
+            return tr("Overcast clouds");
 
-    case metaf::CloudGroup::Amount::OBSCURED:
-        return tr("Sky obscured");
+        case metaf::CloudGroup::Amount::OBSCURED:
+            return tr("Sky obscured");
 
-    case metaf::CloudGroup::Amount::VARIABLE_FEW_SCATTERED:
-        return tr("Few -- scattered clouds");
+        case metaf::CloudGroup::Amount::VARIABLE_FEW_SCATTERED:
+            return tr("Few -- scattered clouds");
 
-    case metaf::CloudGroup::Amount::VARIABLE_SCATTERED_BROKEN:
-        return tr("Scattered -- broken clouds");
+        case metaf::CloudGroup::Amount::VARIABLE_SCATTERED_BROKEN:
+            return tr("Scattered -- broken clouds");
 
-    case metaf::CloudGroup::Amount::VARIABLE_BROKEN_OVERCAST:
-        return tr("Broken -- overcast clouds");
-    }
-    return QString();
+        case metaf::CloudGroup::Amount::VARIABLE_BROKEN_OVERCAST:
+            return tr("Broken -- overcast clouds");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::cloudHighLayerToString(metaf::LowMidHighCloudGroup::HighLayer highLayer) -> QString
 {
-    switch(highLayer) {
-    case metaf::LowMidHighCloudGroup::HighLayer::NONE:
-        return tr("No high-layer clouds");
+    static TranslationTable<metaf::LowMidHighCloudGroup::HighLayer> table;
+    return table.lookup(highLayer, [](metaf::LowMidHighCloudGroup::HighLayer value) -> QString {
+        switch(value) {
+        case metaf::LowMidHighCloudGroup::HighLayer::NONE:
+            return tr("No high-layer clouds");
 
-    case metaf::LowMidHighCloudGroup::HighLayer::CI_FIB_CI_UNC:
-        return tr("Cirrus fibratus or Cirrus uncinus");
+        case metaf::LowMidHighCloudGroup::HighLayer::CI_FIB_CI_UNC:
+            return tr("Cirrus fibratus or Cirrus uncinus");
 
-    case metaf::LowMidHighCloudGroup::HighLayer::CI_SPI_CI_CAS_CI_FLO:
-        return tr("Cirrus spissatus or Cirrus castellanus or Cirrus floccus");
+        case metaf::LowMidHighCloudGroup::HighLayer::CI_SPI_CI_CAS_CI_FLO:
+            return tr("Cirrus spissatus or Cirrus castellanus or Cirrus floccus");
 
-    case metaf::LowMidHighCloudGroup::HighLayer::CI_SPI_CBGEN:
-        return tr("Cirrus spissatus cumulonimbogenitus");
+        case metaf::LowMidHighCloudGroup::HighLayer::CI_SPI_CBGEN:
+            return tr("Cirrus spissatus cumulonimbogenitus");
 
-    case metaf::LowMidHighCloudGroup::HighLayer::CI_FIB_CI_UNC_SPREADING:
-        return tr("Cirrus uncinus or Cirrus fibratus progressively invading the sky");
+        case metaf::LowMidHighCloudGroup::HighLayer::CI_FIB_CI_UNC_SPREADING:
+            return tr("Cirrus uncinus or Cirrus fibratus progressively invading the sky");
 
-    case metaf::LowMidHighCloudGroup::HighLayer::CI_CS_LOW_ABOVE_HORIZON:
-        return tr("Cirrus or Cirrostratus progressively invading the sky, but the continuous veil does not reach 45° above the horizon");
+        case metaf::LowMidHighCloudGroup::HighLayer::CI_CS_LOW_ABOVE_HORIZON:
+            return tr("Cirrus or Cirrostratus progressively invading the sky, but the continuous veil does not reach 45° above the horizon");
 
-    case metaf::LowMidHighCloudGroup::HighLayer::CI_CS_HIGH_ABOVE_HORIZON:
-        return tr("Cirrus or Cirrostratus progressively invading the sky, the continuous veil extends more than 45° above the horizon, without the sky being totally covered");
+        case metaf::LowMidHighCloudGroup::HighLayer::CI_CS_HIGH_ABOVE_HORIZON:
+            return tr("Cirrus or Cirrostratus progressively invading the sky, the continuous veil extends more than 45° above the horizon, without the sky being totally covered");
 
-    case metaf::LowMidHighCloudGroup::HighLayer::CS_NEB_CS_FIB_COVERING_ENTIRE_SKY:
-        return tr("Cirrostratus nebulosus or Cirrostratus fibratus covering the whole sky");
+        case metaf::LowMidHighCloudGroup::HighLayer::CS_NEB_CS_FIB_COVERING_ENTIRE_SKY:
+            return tr("Cirrostratus nebulosus or Cirrostratus fibratus covering the whole sky");
 
-    case metaf::LowMidHighCloudGroup::HighLayer::CS:
-        return tr("Cirrostratus that is not invading the sky and that does not completely cover the whole sky");
+        case metaf::LowMidHighCloudGroup::HighLayer::CS:
+            return tr("Cirrostratus that is not invading the sky and that does not completely cover the whole sky");
 
-    case metaf::LowMidHighCloudGroup::HighLayer::CC:
-        return tr("Cirrocumulus alone");
+        case metaf::LowMidHighCloudGroup::HighLayer::CC:
+            return tr("Cirrocumulus alone");
 
-    case metaf::LowMidHighCloudGroup::HighLayer::NOT_OBSERVABLE:
-        return tr("Clouds are not observable");
-    }
-    return QString();
+        case metaf::LowMidHighCloudGroup::HighLayer::NOT_OBSERVABLE:
+            return tr("Clouds are not observable");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::cloudLowLayerToString(metaf::LowMidHighCloudGroup::LowLayer lowLayer) -> QString
 {
-    switch(lowLayer) {
-    case metaf::LowMidHighCloudGroup::LowLayer::NONE:
-        return tr("No low layer clouds");
+    static TranslationTable<metaf::LowMidHighCloudGroup::LowLayer> table;
+    return table.lookup(lowLayer, [](metaf::LowMidHighCloudGroup::LowLayer value) -> QString {
+        switch(value) {
+        case metaf::LowMidHighCloudGroup::LowLayer::NONE:
+            return tr("No low layer clouds");
 
-    case metaf::LowMidHighCloudGroup::LowLayer::CU_HU_CU_FR:
-        return tr("Cumulus humilis or Cumulus fractus");
+        case metaf::LowMidHighCloudGroup::LowLayer::CU_HU_CU_FR:
+            return tr("Cumulus humilis or Cumulus fractus");
 
-    case metaf::LowMidHighCloudGroup::LowLayer::CU_MED_CU_CON:
-        return tr("Cumulus clouds with moderate or significant vertical extent");
+        case metaf::LowMidHighCloudGroup::LowLayer::CU_MED_CU_CON:
+            return tr("Cumulus clouds with moderate or significant vertical extent");
 
-    case metaf::LowMidHighCloudGroup::LowLayer::CB_CAL:
-        return tr("Cumulonimbus calvus");
+        case metaf::LowMidHighCloudGroup::LowLayer::CB_CAL:
+            return tr("Cumulonimbus calvus");
 
-    case metaf::LowMidHighCloudGroup::LowLayer::SC_CUGEN:
-        return tr("Stratocumulus cumulogenitus");
+        case metaf::LowMidHighCloudGroup::LowLayer::SC_CUGEN:
+            return tr("Stratocumulus cumulogenitus");
 
-    case metaf::LowMidHighCloudGroup::LowLayer::SC_NON_CUGEN:
-        return tr("Stratocumulus non-cumulogenitus");
+        case metaf::LowMidHighCloudGroup::LowLayer::SC_NON_CUGEN:
+            return tr("Stratocumulus non-cumulogenitus");
 
-    case metaf::LowMidHighCloudGroup::LowLayer::ST_NEB_ST_FR:
-        return tr("Stratus nebulosus or Stratus fractus");
+        case metaf::LowMidHighCloudGroup::LowLayer::ST_NEB_ST_FR:
+            return tr("Stratus nebulosus or Stratus fractus");
 
-    case metaf::LowMidHighCloudGroup::LowLayer::ST_FR_CU_FR_PANNUS:
-        return tr("Stratus fractus or Cumulus fractus");
+        case metaf::LowMidHighCloudGroup::LowLayer::ST_FR_CU_FR_PANNUS:
+            return tr("Stratus fractus or Cumulus fractus");
 
-    case metaf::LowMidHighCloudGroup::LowLayer::CU_SC_NON_CUGEN_DIFFERENT_LEVELS:
-        return tr("Cumulus and Stratocumulus with bases at different levels");
+        case metaf::LowMidHighCloudGroup::LowLayer::CU_SC_NON_CUGEN_DIFFERENT_LEVELS:
+            return tr("Cumulus and Stratocumulus with bases at different levels");
 
-    case metaf::LowMidHighCloudGroup::LowLayer::CB_CAP:
-        return "Cumulonimbus capillatus or Cumulonimbus capillatus incus)";
+        case metaf::LowMidHighCloudGroup::LowLayer::CB_CAP:
+            return "Cumulonimbus capillatus or Cumulonimbus capillatus incus)";
 
-    case metaf::LowMidHighCloudGroup::LowLayer::NOT_OBSERVABLE:
-        return tr("Clouds are not observable due to fog, blowing dust or sand, or other similar phenomena");
-    }
-    return QString();
+        case metaf::LowMidHighCloudGroup::LowLayer::NOT_OBSERVABLE:
+            return tr("Clouds are not observable due to fog, blowing dust or sand, or other similar phenomena");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::cloudMidLayerToString(metaf::LowMidHighCloudGroup::MidLayer midLayer) -> QString
 {
-    switch(midLayer) {
-    case metaf::LowMidHighCloudGroup::MidLayer::NONE:
-        return tr("No mid-layer clouds");
+    static TranslationTable<metaf::LowMidHighCloudGroup::MidLayer> table;
+    return table.lookup(midLayer, [](metaf::LowMidHighCloudGroup::MidLayer value) -> QString {
+        switch(value) {
+        case metaf::LowMidHighCloudGroup::MidLayer::NONE:
+            return tr("No mid-layer clouds");
 
-    case metaf::LowMidHighCloudGroup::MidLayer::AS_TR:
-        return tr("Altostratus translucidus");
+        case metaf::LowMidHighCloudGroup::MidLayer::AS_TR:
+            return tr("Altostratus translucidus");
 
-    case metaf::LowMidHighCloudGroup::MidLayer::AS_OP_NS:
-        return tr("Altostratus opacus or Nimbostratus");
+        case metaf::LowMidHighCloudGroup::MidLayer::AS_OP_NS:
+            return tr("Altostratus opacus or Nimbostratus");
 
-    case metaf::LowMidHighCloudGroup::MidLayer::AC_TR:
-        return tr("Altocumulus translucidus at a single level");
+        case metaf::LowMidHighCloudGroup::MidLayer::AC_TR:
+            return tr("Altocumulus translucidus at a single level");
 
-    case metaf::LowMidHighCloudGroup::MidLayer::AC_TR_LEN_PATCHES:
-        return tr("Patches of Altocumulus translucidus");
+        case metaf::LowMidHighCloudGroup::MidLayer::AC_TR_LEN_PATCHES:
+            return tr("Patches of Altocumulus translucidus");
 
-    case metaf::LowMidHighCloudGroup::MidLayer::AC_TR_AC_OP_SPREADING:
-        return tr("Altocumulus translucidus in bands");
+        case metaf::LowMidHighCloudGroup::MidLayer::AC_TR_AC_OP_SPREADING:
+            return tr("Altocumulus translucidus in bands");
 
-    case metaf::LowMidHighCloudGroup::MidLayer::AC_CUGEN_AC_CBGEN:
-        return tr("Altocumulus cumulogenitus or Altocumulus cumulonimbogenitus");
+        case metaf::LowMidHighCloudGroup::MidLayer::AC_CUGEN_AC_CBGEN:
+            return tr("Altocumulus cumulogenitus or Altocumulus cumulonimbogenitus");
 
-    case metaf::LowMidHighCloudGroup::MidLayer::AC_DU_AC_OP_AC_WITH_AS_OR_NS:
-        return tr("Altocumulus duplicatus, or Altocumulus opacus in a single layer");
+        case metaf::LowMidHighCloudGroup::MidLayer::AC_DU_AC_OP_AC_WITH_AS_OR_NS:
+            return tr("Altocumulus duplicatus, or Altocumulus opacus in a single layer");
 
-    case metaf::LowMidHighCloudGroup::MidLayer::AC_CAS_AC_FLO:
-        return tr("Altocumulus castellanus or Altocumulus floccus");
+        case metaf::LowMidHighCloudGroup::MidLayer::AC_CAS_AC_FLO:
+            return tr("Altocumulus castellanus or Altocumulus floccus");
 
-    case metaf::LowMidHighCloudGroup::MidLayer::AC_OF_CHAOTIC_SKY:
-        return tr("Broken cloud sheets of ill-defined species or varieties");
+        case metaf::LowMidHighCloudGroup::MidLayer::AC_OF_CHAOTIC_SKY:
+            return tr("Broken cloud sheets of ill-defined species or varieties");
 
-    case metaf::LowMidHighCloudGroup::MidLayer::NOT_OBSERVABLE:
-        return tr("Clouds are not observable");
-    }
-    return QString();
+        case metaf::LowMidHighCloudGroup::MidLayer::NOT_OBSERVABLE:
+            return tr("Clouds are not observable");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::cloudTypeToString(metaf::CloudType::Type type) -> QString
 {
-    switch(type) {
-    case metaf::CloudType::Type::NOT_REPORTED:
-        return tr("unknown cloud type");
+    static TranslationTable<metaf::CloudType::Type> table;
+    return table.lookup(type, [](metaf::CloudType::Type value) -> QString {
+        switch(value) {
+        case metaf::CloudType::Type::NOT_REPORTED:
+            return tr("unknown cloud type");
 
-    case metaf::CloudType::Type::CUMULONIMBUS:
-        return tr("cumulonimbus");
+        case metaf::CloudType::Type::CUMULONIMBUS:
+            return tr("cumulonimbus");
 
-    case metaf::CloudType::Type::TOWERING_CUMULUS:
-        return tr("towering cumulus");
+        case metaf::CloudType::Type::TOWERING_CUMULUS:
+            return tr("towering cumulus");
 
-    case metaf::CloudType::Type::CUMULUS:
-        return tr("cumulus");
+        case metaf::CloudType::Type::CUMULUS:
+            return tr("cumulus");
 
-    case metaf::CloudType::Type::CUMULUS_FRACTUS:
-        return tr("cumulus fractus");
+        case metaf::CloudType::Type::CUMULUS_FRACTUS:
+            return tr("cumulus fractus");
 
-    case metaf::CloudType::Type::STRATOCUMULUS:
-        return tr("stratocumulus");
+        case metaf::CloudType::Type::STRATOCUMULUS:
+            return tr("stratocumulus");
 
-    case metaf::CloudType::Type::NIMBOSTRATUS:
-        return tr("nimbostratus");
+        case metaf::CloudType::Type::NIMBOSTRATUS:
+            return tr("nimbostratus");
 
-    case metaf::CloudType::Type::STRATUS:
-        return tr("stratus");
+        case metaf::CloudType::Type::STRATUS:
+            return tr("stratus");
 
-    case metaf::CloudType::Type::STRATUS_FRACTUS:
-        return tr("stratus fractus");
+        case metaf::CloudType::Type::STRATUS_FRACTUS:
+            return tr("stratus fractus");
 
-    case metaf::CloudType::Type::ALTOSTRATUS:
-        return tr("altostratus");
+        case metaf::CloudType::Type::ALTOSTRATUS:
+            return tr("altostratus");
 
-    case metaf::CloudType::Type::ALTOCUMULUS:
-        return tr("altocumulus");
+        case metaf::CloudType::Type::ALTOCUMULUS:
+            return tr("altocumulus");
 
-    case metaf::CloudType::Type::ALTOCUMULUS_CASTELLANUS:
-        return tr("altocumulus castellanus");
+        case metaf::CloudType::Type::ALTOCUMULUS_CASTELLANUS:
+            return tr("altocumulus castellanus");
 
-    case metaf::CloudType::Type::CIRRUS:
-        return tr("cirrus");
+        case metaf::CloudType::Type::CIRRUS:
+            return tr("cirrus");
 
-    case metaf::CloudType::Type::CIRROSTRATUS:
-        return tr("cirrostratus");
+        case metaf::CloudType::Type::CIRROSTRATUS:
+            return tr("cirrostratus");
 
-    case metaf::CloudType::Type::CIRROCUMULUS:
-        return tr("cirrocumulus");
+        case metaf::CloudType::Type::CIRROCUMULUS:
+            return tr("cirrocumulus");
 
-    case metaf::CloudType::Type::BLOWING_SNOW:
-        return tr("blowing snow");
+        case metaf::CloudType::Type::BLOWING_SNOW:
+            return tr("blowing snow");
 
-    case metaf::CloudType::Type::BLOWING_DUST:
-        return tr("blowing dust");
+        case metaf::CloudType::Type::BLOWING_DUST:
+            return tr("blowing dust");
 
-    case metaf::CloudType::Type::BLOWING_SAND:
-        return tr("blowing sand");
+        case metaf::CloudType::Type::BLOWING_SAND:
+            return tr("blowing sand");
 
-    case metaf::CloudType::Type::ICE_CRYSTALS:
-        return tr("ice crystals");
+        case metaf::CloudType::Type::ICE_CRYSTALS:
+            return tr("ice crystals");
 
-    case metaf::CloudType::Type::RAIN:
-        return tr("rain");
+        case metaf::CloudType::Type::RAIN:
+            return tr("rain");
 
-    case metaf::CloudType::Type::DRIZZLE:
-        return tr("drizzle");
+        case metaf::CloudType::Type::DRIZZLE:
+            return tr("drizzle");
 
-    case metaf::CloudType::Type::SNOW:
-        return tr("snow");
+        case metaf::CloudType::Type::SNOW:
+            return tr("snow");
 
-    case metaf::CloudType::Type::ICE_PELLETS:
-        return tr("ice pellets");
+        case metaf::CloudType::Type::ICE_PELLETS:
+            return tr("ice pellets");
 
-    case metaf::CloudType::Type::SMOKE:
-        return tr("smoke");
+        case metaf::CloudType::Type::SMOKE:
+            return tr("smoke");
 
-    case metaf::CloudType::Type::FOG:
-        return tr("fog");
+        case metaf::CloudType::Type::FOG:
+            return tr("fog");
 
-    case metaf::CloudType::Type::MIST:
-        return tr("mist");
+        case metaf::CloudType::Type::MIST:
+            return tr("mist");
 
-    case metaf::CloudType::Type::HAZE:
-        return tr("haze");
+        case metaf::CloudType::Type::HAZE:
+            return tr("haze");
 
-    case metaf::CloudType::Type::VOLCANIC_ASH:
-        return tr("volcanic ash");
-    }
-    return QString();
+        case metaf::CloudType::Type::VOLCANIC_ASH:
+            return tr("volcanic ash");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::convectiveTypeToString(metaf::CloudGroup::ConvectiveType type) -> QString
 {
-    switch (type) {
-    case metaf::CloudGroup::ConvectiveType::NONE:
-        return QString();
+    static TranslationTable<metaf::CloudGroup::ConvectiveType> table;
+    return table.lookup(type, [](metaf::CloudGroup::ConvectiveType value) -> QString {
+        switch(value) {
+        case metaf::CloudGroup::ConvectiveType::NONE:
+            return QString();
 
-    case metaf::CloudGroup::ConvectiveType::NOT_REPORTED:
-        return tr("not reported");
+        case metaf::CloudGroup::ConvectiveType::NOT_REPORTED:
+            return tr("not reported");
 
-    case metaf::CloudGroup::ConvectiveType::TOWERING_CUMULUS:
-        return tr("towering cumulus");
+        case metaf::CloudGroup::ConvectiveType::TOWERING_CUMULUS:
+            return tr("towering cumulus");
 
-    case metaf::CloudGroup::ConvectiveType::CUMULONIMBUS:
-        return tr("cumulonimbus");
-    }
-    return QString();
+        case metaf::CloudGroup::ConvectiveType::CUMULONIMBUS:
+            return tr("cumulonimbus");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::distanceMilesFractionToString(metaf::Distance::MilesFraction f) -> QString
 {
-    switch (f) {
-    case metaf::Distance::MilesFraction::NONE:
-        return "";
+    static TranslationTable<metaf::Distance::MilesFraction> table;
+    return table.lookup(f, [](metaf::Distance::MilesFraction value) -> QString {
+        switch(value) {
+        case metaf::Distance::MilesFraction::NONE:
+            return "";
 
-    case metaf::Distance::MilesFraction::F_1_16:
-        return "1/16";
+        case metaf::Distance::MilesFraction::F_1_16:
+            return "1/16";
 
-    case metaf::Distance::MilesFraction::F_1_8:
-        return "1/8";
+        case metaf::Distance::MilesFraction::F_1_8:
+            return "1/8";
 
-    case metaf::Distance::MilesFraction::F_3_16:
-        return "3/16";
+        case metaf::Distance::MilesFraction::F_3_16:
+            return "3/16";
 
-    case metaf::Distance::MilesFraction::F_1_4:
-        return "1/4";
+        case metaf::Distance::MilesFraction::F_1_4:
+            return "1/4";
 
-    case metaf::Distance::MilesFraction::F_5_16:
-        return "5/16";
+        case metaf::Distance::MilesFraction::F_5_16:
+            return "5/16";
 
-    case metaf::Distance::MilesFraction::F_3_8:
-        return "3/8";
+        case metaf::Distance::MilesFraction::F_3_8:
+            return "3/8";
 
-    case metaf::Distance::MilesFraction::F_1_2:
-        return "1/2";
+        case metaf::Distance::MilesFraction::F_1_2:
+            return "1/2";
 
-    case metaf::Distance::MilesFraction::F_5_8:
-        return "5/8";
+        case metaf::Distance::MilesFraction::F_5_8:
+            return "5/8";
 
-    case metaf::Distance::MilesFraction::F_3_4:
-        return "3/4";
+        case metaf::Distance::MilesFraction::F_3_4:
+            return "3/4";
 
-    case metaf::Distance::MilesFraction::F_7_8:
-        return "7/8";
-    }
-    return QString();
+        case metaf::Distance::MilesFraction::F_7_8:
+            return "7/8";
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::distanceUnitToString(metaf::Distance::Unit unit) -> QString
 {
-    switch (unit) {
-    case metaf::Distance::Unit::METERS:
-        return "m";
+    static TranslationTable<metaf::Distance::Unit> table;
+    return table.lookup(unit, [](metaf::Distance::Unit value) -> QString {
+        switch(value) {
+        case metaf::Distance::Unit::METERS:
+            return "m";
 
-    case metaf::Distance::Unit::STATUTE_MILES:
-        return tr("statute miles");
+        case metaf::Distance::Unit::STATUTE_MILES:
+            return tr("statute miles");
 
-    case metaf::Distance::Unit::FEET:
-        return "ft";
-    }
-    return QString();
+        case metaf::Distance::Unit::FEET:
+            return "ft";
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::layerForecastGroupTypeToString(metaf::LayerForecastGroup::Type type) -> QString
 {
-    switch(type) {
-    case metaf::LayerForecastGroup::Type::ICING_TRACE_OR_NONE:
-        return tr("Trace icing or no icing");
+    static TranslationTable<metaf::LayerForecastGroup::Type> table;
+    return table.lookup(type, [](metaf::LayerForecastGroup::Type value) -> QString {
+        switch(value) {
+        case metaf::LayerForecastGroup::Type::ICING_TRACE_OR_NONE:
+            return tr("Trace icing or no icing");
 
-    case metaf::LayerForecastGroup::Type::ICING_LIGHT_MIXED:
-        return tr("Light mixed icing");
+        case metaf::LayerForecastGroup::Type::ICING_LIGHT_MIXED:
+            return tr("Light mixed icing");
 
-    case metaf::LayerForecastGroup::Type::ICING_LIGHT_RIME_IN_CLOUD:
-        return tr("Light rime icing in cloud");
+        case metaf::LayerForecastGroup::Type::ICING_LIGHT_RIME_IN_CLOUD:
+            return tr("Light rime icing in cloud");
 
-    case metaf::LayerForecastGroup::Type::ICING_LIGHT_CLEAR_IN_PRECIPITATION:
-        return tr("Light clear icing in precipitation");
+        case metaf::LayerForecastGroup::Type::ICING_LIGHT_CLEAR_IN_PRECIPITATION:
+            return tr("Light clear icing in precipitation");
 
-    case metaf::LayerForecastGroup::Type::ICING_MODERATE_MIXED:
-        return tr("Moderate mixed icing");
+        case metaf::LayerForecastGroup::Type::ICING_MODERATE_MIXED:
+            return tr("Moderate mixed icing");
 
-    case metaf::LayerForecastGroup::Type::ICING_MODERATE_RIME_IN_CLOUD:
-        return tr("Moderate rime icing in cloud");
+        case metaf::LayerForecastGroup::Type::ICING_MODERATE_RIME_IN_CLOUD:
+            return tr("Moderate rime icing in cloud");
 
-    case metaf::LayerForecastGroup::Type::ICING_MODERATE_CLEAR_IN_PRECIPITATION:
-        return tr("Moderate clear icing in precipitation");
+        case metaf::LayerForecastGroup::Type::ICING_MODERATE_CLEAR_IN_PRECIPITATION:
+            return tr("Moderate clear icing in precipitation");
 
-    case metaf::LayerForecastGroup::Type::ICING_SEVERE_MIXED:
-        return tr("Severe mixed icing");
+        case metaf::LayerForecastGroup::Type::ICING_SEVERE_MIXED:
+            return tr("Severe mixed icing");
 
-    case metaf::LayerForecastGroup::Type::ICING_SEVERE_RIME_IN_CLOUD:
-        return tr("Severe rime icing in cloud");
+        case metaf::LayerForecastGroup::Type::ICING_SEVERE_RIME_IN_CLOUD:
+            return tr("Severe rime icing in cloud");
 
-    case metaf::LayerForecastGroup::Type::ICING_SEVERE_CLEAR_IN_PRECIPITATION:
-        return tr("Severe clear icing in precipitation");
+        case metaf::LayerForecastGroup::Type::ICING_SEVERE_CLEAR_IN_PRECIPITATION:
+            return tr("Severe clear icing in precipitation");
 
-    case metaf::LayerForecastGroup::Type::TURBULENCE_NONE:
-        return tr("No turbulence");
+        case metaf::LayerForecastGroup::Type::TURBULENCE_NONE:
+            return tr("No turbulence");
 
-    case metaf::LayerForecastGroup::Type::TURBULENCE_LIGHT:
-        return tr("Light turbulence");
+        case metaf::LayerForecastGroup::Type::TURBULENCE_LIGHT:
+            return tr("Light turbulence");
 
-    case metaf::LayerForecastGroup::Type::TURBULENCE_MODERATE_IN_CLEAR_AIR_OCCASIONAL:
-        return tr("Occasional moderate turbulence in clear air");
+        case metaf::LayerForecastGroup::Type::TURBULENCE_MODERATE_IN_CLEAR_AIR_OCCASIONAL:
+            return tr("Occasional moderate turbulence in clear air");
 
-    case metaf::LayerForecastGroup::Type::TURBULENCE_MODERATE_IN_CLEAR_AIR_FREQUENT:
-        return tr("Frequent moderate turbulence in clear air");
+        case metaf::LayerForecastGroup::Type::TURBULENCE_MODERATE_IN_CLEAR_AIR_FREQUENT:
+            return tr("Frequent moderate turbulence in clear air");
 
-    case metaf::LayerForecastGroup::Type::TURBULENCE_MODERATE_IN_CLOUD_OCCASIONAL:
-        return tr("Occasional moderate turbulence in cloud");
+        case metaf::LayerForecastGroup::Type::TURBULENCE_MODERATE_IN_CLOUD_OCCASIONAL:
+            return tr("Occasional moderate turbulence in cloud");
 
-    case metaf::LayerForecastGroup::Type::TURBULENCE_MODERATE_IN_CLOUD_FREQUENT:
-        return tr("Frequent moderate turbulence in cloud");
+        case metaf::LayerForecastGroup::Type::TURBULENCE_MODERATE_IN_CLOUD_FREQUENT:
+            return tr("Frequent moderate turbulence in cloud");
 
-    case metaf::LayerForecastGroup::Type::TURBULENCE_SEVERE_IN_CLEAR_AIR_OCCASIONAL:
-        return tr("Occasional severe turbulence in clear air");
+        case metaf::LayerForecastGroup::Type::TURBULENCE_SEVERE_IN_CLEAR_AIR_OCCASIONAL:
+            return tr("Occasional severe turbulence in clear air");
 
-    case metaf::LayerForecastGroup::Type::TURBULENCE_SEVERE_IN_CLEAR_AIR_FREQUENT:
-        return tr("Frequent severe turbulence in clear air");
+        case metaf::LayerForecastGroup::Type::TURBULENCE_SEVERE_IN_CLEAR_AIR_FREQUENT:
+            return tr("Frequent severe turbulence in clear air");
 
-    case metaf::LayerForecastGroup::Type::TURBULENCE_SEVERE_IN_CLOUD_OCCASIONAL:
-        return tr("Occasional severe turbulence in cloud");
+        case metaf::LayerForecastGroup::Type::TURBULENCE_SEVERE_IN_CLOUD_OCCASIONAL:
+            return tr("Occasional severe turbulence in cloud");
 
-    case metaf::LayerForecastGroup::Type::TURBULENCE_SEVERE_IN_CLOUD_FREQUENT:
-        return tr("Frequent severe turbulence in cloud");
+        case metaf::LayerForecastGroup::Type::TURBULENCE_SEVERE_IN_CLOUD_FREQUENT:
+            return tr("Frequent severe turbulence in cloud");
 
-    case metaf::LayerForecastGroup::Type::TURBULENCE_EXTREME:
-        return tr("Extreme turbulence");
-    }
-    return QString();
+        case metaf::LayerForecastGroup::Type::TURBULENCE_EXTREME:
+            return tr("Extreme turbulence");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::pressureTendencyTrendToString(metaf::PressureTendencyGroup::Trend trend) -> QString
 {
-    switch(trend) {
-    case metaf::PressureTendencyGroup::Trend::NOT_REPORTED:
-        return tr("not reported");
+    static TranslationTable<metaf::PressureTendencyGroup::Trend> table;
+    return table.lookup(trend, [](metaf::PressureTendencyGroup::Trend value) -> QString {
+        switch(value) {
+        case metaf::PressureTendencyGroup::Trend::NOT_REPORTED:
+            return tr("not reported");
 
-    case metaf::PressureTendencyGroup::Trend::HIGHER:
-        return tr("higher than");
+        case metaf::PressureTendencyGroup::Trend::HIGHER:
+            return tr("higher than");
 
-    case metaf::PressureTendencyGroup::Trend::HIGHER_OR_SAME:
-        return tr("higher or the same as");
+        case metaf::PressureTendencyGroup::Trend::HIGHER_OR_SAME:
+            return tr("higher or the same as");
 
-    case metaf::PressureTendencyGroup::Trend::SAME:
-        return tr("same as");
+        case metaf::PressureTendencyGroup::Trend::SAME:
+            return tr("same as");
 
-    case metaf::PressureTendencyGroup::Trend::LOWER_OR_SAME:
-        return tr("lower or the same as");
+        case metaf::PressureTendencyGroup::Trend::LOWER_OR_SAME:
+            return tr("lower or the same as");
 
-    case metaf::PressureTendencyGroup::Trend::LOWER:
-        return tr("lower than");
-    }
-    return QString();
+        case metaf::PressureTendencyGroup::Trend::LOWER:
+            return tr("lower than");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::pressureTendencyTypeToString(metaf::PressureTendencyGroup::Type type) -> QString
 {
-    switch(type) {
-    case metaf::PressureTendencyGroup::Type::INCREASING_THEN_DECREASING:
-        return tr("increasing, then decreasing");
+    static TranslationTable<metaf::PressureTendencyGroup::Type> table;
+    return table.lookup(type, [](metaf::PressureTendencyGroup::Type value) -> QString {
+        switch(value) {
+        case metaf::PressureTendencyGroup::Type::INCREASING_THEN_DECREASING:
+            return tr("increasing, then decreasing");
 
-    case metaf::PressureTendencyGroup::Type::INCREASING_MORE_SLOWLY:
-        return tr("increasing more slowly");
+        case metaf::PressureTendencyGroup::Type::INCREASING_MORE_SLOWLY:
+            return tr("increasing more slowly");
 
-    case metaf::PressureTendencyGroup::Type::INCREASING:
-        return tr("increasing");
+        case metaf::PressureTendencyGroup::Type::INCREASING:
+            return tr("increasing");
 
-    case metaf::PressureTendencyGroup::Type::INCREASING_MORE_RAPIDLY:
-        return tr("increasing more rapidly");
+        case metaf::PressureTendencyGroup::Type::INCREASING_MORE_RAPIDLY:
+            return tr("increasing more rapidly");
 
-    case metaf::PressureTendencyGroup::Type::STEADY:
-        return tr("steady");
+        case metaf::PressureTendencyGroup::Type::STEADY:
+            return tr("steady");
 
-    case metaf::PressureTendencyGroup::Type::DECREASING_THEN_INCREASING:
-        return tr("decreasing, then increasing");
+        case metaf::PressureTendencyGroup::Type::DECREASING_THEN_INCREASING:
+            return tr("decreasing, then increasing");
 
-    case metaf::PressureTendencyGroup::Type::DECREASING_MORE_SLOWLY:
-        return tr("decreasing more slowly");
+        case metaf::PressureTendencyGroup::Type::DECREASING_MORE_SLOWLY:
+            return tr("decreasing more slowly");
 
-    case metaf::PressureTendencyGroup::Type::DECREASING:
-        return tr("decreasing");
+        case metaf::PressureTendencyGroup::Type::DECREASING:
+            return tr("decreasing");
 
-    case metaf::PressureTendencyGroup::Type::DECREASING_MORE_RAPIDLY:
-        return tr("decreasing more rapidly");
+        case metaf::PressureTendencyGroup::Type::DECREASING_MORE_RAPIDLY:
+            return tr("decreasing more rapidly");
 
-    case metaf::PressureTendencyGroup::Type::NOT_REPORTED:
-        return tr("not reported");
+        case metaf::PressureTendencyGroup::Type::NOT_REPORTED:
+            return tr("not reported");
 
-    case metaf::PressureTendencyGroup::Type::RISING_RAPIDLY:
-        return tr("rising rapidly");
+        case metaf::PressureTendencyGroup::Type::RISING_RAPIDLY:
+            return tr("rising rapidly");
 
-    case metaf::PressureTendencyGroup::Type::FALLING_RAPIDLY:
-        return tr("falling rapidly");
-    }
-    return QString();
+        case metaf::PressureTendencyGroup::Type::FALLING_RAPIDLY:
+            return tr("falling rapidly");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::probabilityToString(metaf::TrendGroup::Probability prob) -> QString
 {
-    switch (prob) {
-    case metaf::TrendGroup::Probability::PROB_30:
-        return tr("Probability 30%");
+    static TranslationTable<metaf::TrendGroup::Probability> table;
+    return table.lookup(prob, [](metaf::TrendGroup::Probability value) -> QString {
+        switch(value) {
+        case metaf::TrendGroup::Probability::PROB_30:
+            return tr("Probability 30%");
 
-    case metaf::TrendGroup::Probability::PROB_40:
-        return tr("Probability 40%");
+        case metaf::TrendGroup::Probability::PROB_40:
+            return tr("Probability 40%");
 
-    case metaf::TrendGroup::Probability::NONE:
+        case metaf::TrendGroup::Probability::NONE:
+            return QString();
+        }
         return QString();
-    }
-    return QString();
+    });
 }
 
 auto Weather::Decoder::runwayStateDepositsToString(metaf::RunwayStateGroup::Deposits deposits) -> QString
 {
-    switch(deposits) {
-    case metaf::RunwayStateGroup::Deposits::NOT_REPORTED:
-        return tr("not reported");
+    static TranslationTable<metaf::RunwayStateGroup::Deposits> table;
+    return table.lookup(deposits, [](metaf::RunwayStateGroup::Deposits value) -> QString {
+        switch(value) {
+        case metaf::RunwayStateGroup::Deposits::NOT_REPORTED:
+            return tr("not reported");
 
-    case metaf::RunwayStateGroup::Deposits::CLEAR_AND_DRY:
-        return tr("clear and dry");
+        case metaf::RunwayStateGroup::Deposits::CLEAR_AND_DRY:
+            return tr("clear and dry");
 
-    case metaf::RunwayStateGroup::Deposits::DAMP:
-        return tr("damp");
+        case metaf::RunwayStateGroup::Deposits::DAMP:
+            return tr("damp");
 
-    case metaf::RunwayStateGroup::Deposits::WET_AND_WATER_PATCHES:
-        return tr("wet and water patches");
+        case metaf::RunwayStateGroup::Deposits::WET_AND_WATER_PATCHES:
+            return tr("wet and water patches");
 
-    case metaf::RunwayStateGroup::Deposits::RIME_AND_FROST_COVERED:
-        return tr("rime and frost covered");
+        case metaf::RunwayStateGroup::Deposits::RIME_AND_FROST_COVERED:
+            return tr("rime and frost covered");
 
-    case metaf::RunwayStateGroup::Deposits::DRY_SNOW:
-        return tr("dry snow");
+        case metaf::RunwayStateGroup::Deposits::DRY_SNOW:
+            return tr("dry snow");
 
-    case metaf::RunwayStateGroup::Deposits::WET_SNOW:
-        return tr("wet snow");
+        case metaf::RunwayStateGroup::Deposits::WET_SNOW:
+            return tr("wet snow");
 
-    case metaf::RunwayStateGroup::Deposits::SLUSH:
-        return tr("slush");
+        case metaf::RunwayStateGroup::Deposits::SLUSH:
+            return tr("slush");
 
-    case metaf::RunwayStateGroup::Deposits::ICE:
-        return tr("ice");
+        case metaf::RunwayStateGroup::Deposits::ICE:
+            return tr("ice");
 
-    case metaf::RunwayStateGroup::Deposits::COMPACTED_OR_ROLLED_SNOW:
-        return tr("compacted or rolled snow");
+        case metaf::RunwayStateGroup::Deposits::COMPACTED_OR_ROLLED_SNOW:
+            return tr("compacted or rolled snow");
 
-    case metaf::RunwayStateGroup::Deposits::FROZEN_RUTS_OR_RIDGES:
-        return tr("frozen ruts or ridges");
-    }
-    return QString();
+        case metaf::RunwayStateGroup::Deposits::FROZEN_RUTS_OR_RIDGES:
+            return tr("frozen ruts or ridges");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::runwayStateExtentToString(metaf::RunwayStateGroup::Extent extent) -> QString
 {
-    switch(extent) {
-    case metaf::RunwayStateGroup::Extent::NOT_REPORTED:
-    case metaf::RunwayStateGroup::Extent::RESERVED_3:
-    case metaf::RunwayStateGroup::Extent::RESERVED_4:
-    case metaf::RunwayStateGroup::Extent::RESERVED_6:
-    case metaf::RunwayStateGroup::Extent::RESERVED_7:
-    case metaf::RunwayStateGroup::Extent::RESERVED_8:
-        return tr("not reported");
+    static TranslationTable<metaf::RunwayStateGroup::Extent> table;
+    return table.lookup(extent, [](metaf::RunwayStateGroup::Extent value) -> QString {
+        switch(value) {
+        case metaf::RunwayStateGroup::Extent::NOT_REPORTED:
+        case metaf::RunwayStateGroup::Extent::RESERVED_3:
+        case metaf::RunwayStateGroup::Extent::RESERVED_4:
+        case metaf::RunwayStateGroup::Extent::RESERVED_6:
+        case metaf::RunwayStateGroup::Extent::RESERVED_7:
+        case metaf::RunwayStateGroup::Extent::RESERVED_8:
+            return tr("not reported");
 
-    case metaf::RunwayStateGroup::Extent::NONE:
-        return tr("none");
+        case metaf::RunwayStateGroup::Extent::NONE:
+            return tr("none");
 
-    case metaf::RunwayStateGroup::Extent::LESS_THAN_10_PERCENT:
-        return QString("< 10%");
+        case metaf::RunwayStateGroup::Extent::LESS_THAN_10_PERCENT:
+            return QString("< 10%");
 
-    case metaf::RunwayStateGroup::Extent::FROM_11_TO_25_PERCENT:
-        return QString("11% -- 25%");
+        case metaf::RunwayStateGroup::Extent::FROM_11_TO_25_PERCENT:
+            return QString("11% -- 25%");
 
-    case metaf::RunwayStateGroup::Extent::FROM_26_TO_50_PERCENT:
-        return QString("26% -- 50%");
+        case metaf::RunwayStateGroup::Extent::FROM_26_TO_50_PERCENT:
+            return QString("26% -- 50%");
 
-    case metaf::RunwayStateGroup::Extent::MORE_THAN_51_PERCENT:
-        return QString(">51%");
-    }
-    return QString();
+        case metaf::RunwayStateGroup::Extent::MORE_THAN_51_PERCENT:
+            return QString(">51%");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::specialWeatherPhenomenaToString(const metaf::WeatherPhenomena & wp) -> QString
@@ -1797,197 +2024,212 @@ auto Weather::Decoder::specialWeatherPhenomenaToString(const metaf::WeatherPheno
 
 auto Weather::Decoder::stateOfSeaSurfaceToString(metaf::WaveHeight::StateOfSurface stateOfSurface) -> QString
 {
-    switch(stateOfSurface) {
-    case metaf::WaveHeight::StateOfSurface::NOT_REPORTED:
-        return tr("not reported");
+    static TranslationTable<metaf::WaveHeight::StateOfSurface> table;
+    return table.lookup(stateOfSurface, [](metaf::WaveHeight::StateOfSurface value) -> QString {
+        switch(value) {
+        case metaf::WaveHeight::StateOfSurface::NOT_REPORTED:
+            return tr("not reported");
 
-    case metaf::WaveHeight::StateOfSurface::CALM_GLASSY:
-        return tr("calm (glassy), no waves");
+        case metaf::WaveHeight::StateOfSurface::CALM_GLASSY:
+            return tr("calm (glassy), no waves");
 
-    case metaf::WaveHeight::StateOfSurface::CALM_RIPPLED:
-        return tr("calm (rippled), wave height <0.1 meters");
+        case metaf::WaveHeight::StateOfSurface::CALM_RIPPLED:
+            return tr("calm (rippled), wave height <0.1 meters");
 
-    case metaf::WaveHeight::StateOfSurface::SMOOTH:
-        return tr("smooth, wave height 0.1 to 0.5 meters");
+        case metaf::WaveHeight::StateOfSurface::SMOOTH:
+            return tr("smooth, wave height 0.1 to 0.5 meters");
 
-    case metaf::WaveHeight::StateOfSurface::SLIGHT:
-        return tr("slight, wave height 0.5 to 1.25 meters");
+        case metaf::WaveHeight::StateOfSurface::SLIGHT:
+            return tr("slight, wave height 0.5 to 1.25 meters");
 
-    case metaf::WaveHeight::StateOfSurface::MODERATE:
-        return tr("moderate, wave height 1.25 to 2.5 meters");
+        case metaf::WaveHeight::StateOfSurface::MODERATE:
+            return tr("moderate, wave height 1.25 to 2.5 meters");
 
-    case metaf::WaveHeight::StateOfSurface::ROUGH:
-        return tr("rough, wave height 2.5 to 4 meters");
+        case metaf::WaveHeight::StateOfSurface::ROUGH:
+            return tr("rough, wave height 2.5 to 4 meters");
 
-    case metaf::WaveHeight::StateOfSurface::VERY_ROUGH:
-        return tr("very rough, wave height 4 to 6 meters");
+        case metaf::WaveHeight::StateOfSurface::VERY_ROUGH:
+            return tr("very rough, wave height 4 to 6 meters");
 
-    case metaf::WaveHeight::StateOfSurface::HIGH:
-        return tr("high, wave height 6 to 9 meters");
+        case metaf::WaveHeight::StateOfSurface::HIGH:
+            return tr("high, wave height 6 to 9 meters");
 
-    case metaf::WaveHeight::StateOfSurface::VERY_HIGH:
-        return tr("very high, wave height 9 to 14 meters");
+        case metaf::WaveHeight::StateOfSurface::VERY_HIGH:
+            return tr("very high, wave height 9 to 14 meters");
 
-    case metaf::WaveHeight::StateOfSurface::PHENOMENAL:
-        return tr("phenomenal, wave height >14 meters");
-    }
-    return QString();
+        case metaf::WaveHeight::StateOfSurface::PHENOMENAL:
+            return tr("phenomenal, wave height >14 meters");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::visTrendToString(metaf::VisibilityGroup::Trend trend) -> QString
 {
-    switch(trend) {
-    case metaf::VisibilityGroup::Trend::NONE:
-        return QString();
+    static TranslationTable<metaf::VisibilityGroup::Trend> table;
+    return table.lookup(trend, [](metaf::VisibilityGroup::Trend value) -> QString {
+        switch(value) {
+        case metaf::VisibilityGroup::Trend::NONE:
+            return QString();
 
-    case metaf::VisibilityGroup::Trend::NOT_REPORTED:
-        return tr("not reported");
+        case metaf::VisibilityGroup::Trend::NOT_REPORTED:
+            return tr("not reported");
 
-    case metaf::VisibilityGroup::Trend::UPWARD:
-        //: visibility trend
-        return tr("upward");
+        case metaf::VisibilityGroup::Trend::UPWARD:
+            //: visibility trend
+            return tr("upward");
 
-    case metaf::VisibilityGroup::Trend::NEUTRAL:
-        //: visibility trend
-        return tr("neutral");
+        case metaf::VisibilityGroup::Trend::NEUTRAL:
+            //: visibility trend
+            return tr("neutral");
 
-    case metaf::VisibilityGroup::Trend::DOWNWARD:
-        //: visibility trend
-        return tr("downward");
-    }
-    return QString();
+        case metaf::VisibilityGroup::Trend::DOWNWARD:
+            //: visibility trend
+            return tr("downward");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::weatherPhenomenaDescriptorToString(metaf::WeatherPhenomena::Descriptor descriptor) -> QString
 {
-    switch(descriptor) {
-    case metaf::WeatherPhenomena::Descriptor::NONE:
-        return QString();
+    static TranslationTable<metaf::WeatherPhenomena::Descriptor> table;
+    return table.lookup(descriptor, [](metaf::WeatherPhenomena::Descriptor value) -> QString {
+        switch(value) {
+        case metaf::WeatherPhenomena::Descriptor::NONE:
+            return QString();
 
-    case metaf::WeatherPhenomena::Descriptor::SHALLOW:
-        return tr("shallow");
+        case metaf::WeatherPhenomena::Descriptor::SHALLOW:
+            return tr("shallow");
 
-    case metaf::WeatherPhenomena::Descriptor::PARTIAL:
-        return tr("partial");
+        case metaf::WeatherPhenomena::Descriptor::PARTIAL:
+            return tr("partial");
 
-    case metaf::WeatherPhenomena::Descriptor::PATCHES:
-        return tr("patches");
+        case metaf::WeatherPhenomena::Descriptor::PATCHES:
+            return tr("patches");
 
-    case metaf::WeatherPhenomena::Descriptor::LOW_DRIFTING:
-        return tr("low drifting");
+        case metaf::WeatherPhenomena::Descriptor::LOW_DRIFTING:
+            return tr("low drifting");
 
-    case metaf::WeatherPhenomena::Descriptor::BLOWING:
-        return tr("blowing");
+        case metaf::WeatherPhenomena::Descriptor::BLOWING:
+            return tr("blowing");
 
-    case metaf::WeatherPhenomena::Descriptor::SHOWERS:
-        return tr("showers");
+        case metaf::WeatherPhenomena::Descriptor::SHOWERS:
+            return tr("showers");
 
-    case metaf::WeatherPhenomena::Descriptor::THUNDERSTORM:
-        return tr("thunderstorm");
+        case metaf::WeatherPhenomena::Descriptor::THUNDERSTORM:
+            return tr("thunderstorm");
 
-    case metaf::WeatherPhenomena::Descriptor::FREEZING:
-        return tr("freezing");
-    }
-    return QString();
+        case metaf::WeatherPhenomena::Descriptor::FREEZING:
+            return tr("freezing");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::weatherPhenomenaQualifierToString(metaf::WeatherPhenomena::Qualifier qualifier) -> QString
 {
-    switch (qualifier) {
-    case metaf::WeatherPhenomena::Qualifier::NONE:
-        return QString();
+    static TranslationTable<metaf::WeatherPhenomena::Qualifier> table;
+    return table.lookup(qualifier, [](metaf::WeatherPhenomena::Qualifier value) -> QString {
+        switch(value) {
+        case metaf::WeatherPhenomena::Qualifier::NONE:
+            return QString();
 
-    case metaf::WeatherPhenomena::Qualifier::RECENT:
-        return QString("recent");
+        case metaf::WeatherPhenomena::Qualifier::RECENT:
+            return QString("recent");
 
-    case metaf::WeatherPhenomena::Qualifier::VICINITY:
-        return QString("in vicinity");
+        case metaf::WeatherPhenomena::Qualifier::VICINITY:
+            return QString("in vicinity");
 
-    case metaf::WeatherPhenomena::Qualifier::LIGHT:
-        return tr("light");
+        case metaf::WeatherPhenomena::Qualifier::LIGHT:
+            return tr("light");
 
-    case metaf::WeatherPhenomena::Qualifier::MODERATE:
-        return tr("moderate");
+        case metaf::WeatherPhenomena::Qualifier::MODERATE:
+            return tr("moderate");
 
-    case metaf::WeatherPhenomena::Qualifier::HEAVY:
-        return tr("heavy");
-    }
-    return QString();
+        case metaf::WeatherPhenomena::Qualifier::HEAVY:
+            return tr("heavy");
+        }
+        return QString();
+    });
 }
 
 auto Weather::Decoder::weatherPhenomenaWeatherToString(metaf::WeatherPhenomena::Weather weather) -> QString
 {
-    switch (weather) {
-    case metaf::WeatherPhenomena::Weather::NOT_REPORTED:
-        return QString();
+    static TranslationTable<metaf::WeatherPhenomena::Weather> table;
+    return table.lookup(weather, [](metaf::WeatherPhenomena::Weather value) -> QString {
+        switch(value) {
+        case metaf::WeatherPhenomena::Weather::NOT_REPORTED:
+            return QString();
 
-    case metaf::WeatherPhenomena::Weather::DRIZZLE:
-        return tr("drizzle");
+        case metaf::WeatherPhenomena::Weather::DRIZZLE:
+            return tr("drizzle");
 
-    case metaf::WeatherPhenomena::Weather::RAIN:
-        return tr("rain");
+        case metaf::WeatherPhenomena::Weather::RAIN:
+            return tr("rain");
 
-    case metaf::WeatherPhenomena::Weather::SNOW:
-        return tr("snow");
+        case metaf::WeatherPhenomena::Weather::SNOW:
+            return tr("snow");
 
-    case metaf::WeatherPhenomena::Weather::SNOW_GRAINS:
-        return tr("snow grains");
+        case metaf::WeatherPhenomena::Weather::SNOW_GRAINS:
+            return tr("snow grains");
 
-    case metaf::WeatherPhenomena::Weather::ICE_CRYSTALS:
-        return tr("ice crystals");
+        case metaf::WeatherPhenomena::Weather::ICE_CRYSTALS:
+            return tr("ice crystals");
 
-    case metaf::WeatherPhenomena::Weather::ICE_PELLETS:
-        return tr("ice pellets");
+        case metaf::WeatherPhenomena::Weather::ICE_PELLETS:
+            return tr("ice pellets");
 
-    case metaf::WeatherPhenomena::Weather::HAIL:
-        return tr("hail");
+        case metaf::WeatherPhenomena::Weather::HAIL:
+            return tr("hail");
 
-    case metaf::WeatherPhenomena::Weather::SMALL_HAIL:
-        return tr("small hail");
+        case metaf::WeatherPhenomena::Weather::SMALL_HAIL:
+            return tr("small hail");
 
-    case metaf::WeatherPhenomena::Weather::UNDETERMINED:
-        return tr("undetermined precipitation");
+        case metaf::WeatherPhenomena::Weather::UNDETERMINED:
+            return tr("undetermined precipitation");
 
-    case metaf::WeatherPhenomena::Weather::MIST:
-        return tr("mist");
+        case metaf::WeatherPhenomena::Weather::MIST:
+            return tr("mist");
 
-    case metaf::WeatherPhenomena::Weather::FOG:
-        return tr("fog");
+        case metaf::WeatherPhenomena::Weather::FOG:
+            return tr("fog");
 
-    case metaf::WeatherPhenomena::Weather::SMOKE:
-        return tr("smoke");
+        case metaf::WeatherPhenomena::Weather::SMOKE:
+            return tr("smoke");
 
-    case metaf::WeatherPhenomena::Weather::VOLCANIC_ASH:
-        return tr("volcanic ash");
+        case metaf::WeatherPhenomena::Weather::VOLCANIC_ASH:
+            return tr("volcanic ash");
 
-    case metaf::WeatherPhenomena::Weather::DUST:
-        return tr("dust");
+        case metaf::WeatherPhenomena::Weather::DUST:
+            return tr("dust");
 
-    case metaf::WeatherPhenomena::Weather::SAND:
-        return tr("sand");
+        case metaf::WeatherPhenomena::Weather::SAND:
+            return tr("sand");
 
-    case metaf::WeatherPhenomena::Weather::HAZE:
-        return tr("haze");
+        case metaf::WeatherPhenomena::Weather::HAZE:
+            return tr("haze");
 
-    case metaf::WeatherPhenomena::Weather::SPRAY:
-        return tr("spray");
+        case metaf::WeatherPhenomena::Weather::SPRAY:
+            return tr("spray");
 
-    case metaf::WeatherPhenomena::Weather::DUST_WHIRLS:
-        return tr("dust or sand whirls");
+        case metaf::WeatherPhenomena::Weather::DUST_WHIRLS:
+            return tr("dust or sand whirls");
 
-    case metaf::WeatherPhenomena::Weather::SQUALLS:
-        return tr("squalls");
+        case metaf::WeatherPhenomena::Weather::SQUALLS:
+            return tr("squalls");
 
-    case metaf::WeatherPhenomena::Weather::FUNNEL_CLOUD:
-        return tr("funnel cloud");
+        case metaf::WeatherPhenomena::Weather::FUNNEL_CLOUD:
+            return tr("funnel cloud");
 
-    case metaf::WeatherPhenomena::Weather::SANDSTORM:
-        return tr("sand storm");
+        case metaf::WeatherPhenomena::Weather::SANDSTORM:
+            return tr("sand storm");
 
-    case metaf::WeatherPhenomena::Weather::DUSTSTORM:
-        return tr("dust storm");
-    }
-    return QString();
+        case metaf::WeatherPhenomena::Weather::DUSTSTORM:
+            return tr("dust storm");
+        }
+        return QString();
+    });
 }
 
 
@@ -2954,7 +3196,7 @@ auto Weather::Decoder::visitVisibilityGroup(const VisibilityGroup & group, Repor
     return QString();
 }
 
-auto Weather::Decoder::visitWeatherGroup(const WeatherGroup & group, ReportPart part, const std::string & /*rawString*/) -> QString
+auto Weather::Decoder::visitWeatherGroup(const WeatherGroup & group, ReportPart /*reportPart*/, const std::string & /*rawString*/) -> QString
 {
     if (!group.isValid()) {
         return tr("Invalid data");
@@ -2968,11 +3210,6 @@ auto Weather::Decoder::visitWeatherGroup(const WeatherGroup & group, ReportPart
     }
     auto phenomenaString = phenomenaList.join(" • ");
 
-    // If this is a METAR, then save the current weather
-    if (part == ReportPart::METAR) {
-        _currentWeather = phenomenaString;
-    }
-
     switch (group.type()) {
     case metaf::WeatherGroup::Type::CURRENT:
         return phenomenaString; // tr("Current weather: %1").arg(phenomenaString);
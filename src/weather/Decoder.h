@@ -44,6 +44,53 @@ class Decoder : public QObject, private metaf::Visitor<QString> {
     Q_OBJECT
 
 public:
+    /*! \brief Information about a METAR/TAF message
+     *
+     * This plain value type holds information that is known once the message
+     * has been parsed. It is stored together with the raw text, so that
+     * messages need not be parsed again before they are shown in full.
+     */
+    struct Metadata {
+        /*! \brief Type of the message */
+        metaf::ReportType type {metaf::ReportType::UNKNOWN};
+
+        /*! \brief Indicates if a METAR is a SPECI */
+        bool isSpeci {false};
+
+        /*! \brief Indicates if the parser found an error */
+        bool hasParseError {false};
+    };
+
+    /*! \brief Result of decoding a METAR/TAF message
+     *
+     * This plain value type holds the cheap results of the decoder: metadata
+     * and current weather. Values can be computed in any thread, by the method
+     * decode(). Neither the parse tree nor the human-readable text are part
+     * of this struct; the Decoder parses the message again and generates the
+     * text only when the property decodedText is first read.
+     */
+    struct Decoded {
+        /*! \brief Metadata of the message */
+        Metadata metadata;
+
+        /*! \brief Current weather, as in the property currentWeather */
+        QString currentWeather;
+    };
+
+    /*! \brief Decode a METAR/TAF message
+     *
+     * This method parses a message without constructing a
+     * Decoder that is connected to the global objects of the app. It is
+     * thread-safe and is meant to be run in a worker thread.
+     *
+     * @param rawText Raw METAR/TAF message
+     *
+     * @param referenceDate Reference date, as in setRawText()
+     *
+     * @returns Decoded message
+     */
+    static Decoded decode(const QString& rawText, QDate referenceDate);
+
     /*! \brief Description of the current weather
      *
      * For METAR messages, this property holds a description of the current weather
@@ -56,10 +103,7 @@ public:
      *
      * @returns Property currentWeather
      */
-    QString currentWeather() const
-    {
-        return _currentWeather;
-    }
+    QString currentWeather() const;
 
     /*! \brief Decoded text of the METAR/TAF message
      *
@@ -67,6 +111,9 @@ public:
      * rich text string.  The text might change in responde to changes in
      * user settings, and might also change by midnight (the text uses words such
      * as 'tomorrow' whose meaning changes at the end of the day).
+     *
+     * The text is expensive to generate and most reports are never shown in
+     * full. It is therefore generated only when this property is first read.
      */
     Q_PROPERTY(QString decodedText READ decodedText NOTIFY decodedTextChanged)
 
@@ -74,10 +121,18 @@ public:
      *
      * @returns Property decodedText
      */
-    QString decodedText() const
-    {
-        return _decodedText;
-    }
+    QString decodedText() const;
+
+    /*! \brief Release the decoded text
+     *
+     * This method frees the memory used by the decoded text. The text is
+     * generated again when the property decodedText is next read. The signal
+     * decodedTextChanged() is not emitted, because the value of the property
+     * does not change.
+     *
+     * @returns Number of bytes released
+     */
+    qint64 releaseDecodedText();
 
     /*! \brief Message Type
      *
@@ -89,7 +144,18 @@ public:
      *
      * @returns Property currentWeather
      */
-    QString messageType() const;
+    QString messageType() const
+    {
+        return messageType(_metadata);
+    }
+
+    /*! \brief Message type, for a message that has not been loaded into a Decoder
+     *
+     * @param metadata Metadata of the message
+     *
+     * @returns A string of the form "METAR", "TAF" or "METAR/SPECI"
+     */
+    static QString messageType(const Metadata& metadata);
 
     /*! \brief Raw text of the METAR/TAF message */
     Q_PROPERTY(QString rawText READ rawText NOTIFY rawTextChanged)
@@ -112,24 +178,48 @@ signals:
 
 protected:
     // This constructor creates a Decoder instance.  You need to set the raw text before this class can be useful.
-    explicit Decoder(QObject *parent = nullptr);
+    // Unless watchGlobalObjects is false, the current weather is computed again and the decoded text is discarded
+    // whenever the date or the preferred unit system changes.
+    explicit Decoder(QObject *parent = nullptr, bool watchGlobalObjects = true);
 
     // Sets the raw METAR/TAF message and starts processing. Since METAR/TAF messages specify points in time only by "day of month" and "time",
     // the decoder needs to know the month and year. Set this reference date to any date between in the interval [issue date, issue date + 28 days]
     void setRawText(const QString& rawText, QDate referenceDate);
 
+    // Returns metadata of the message, as set by one of the setter methods
+    Metadata metadata() const
+    {
+        return _metadata;
+    }
+
+    // Sets the raw METAR/TAF message and metadata, as computed earlier. The message will only be parsed when
+    // the current weather or decoded text are first read.
+    void setRawText(const QString& rawText, QDate referenceDate, Metadata metadata);
+
     // Indicates if the parser was able to read the text without error. If an error occurs, the decoded will
     // still be available, but is probably incomplete
     bool hasParseError() const
     {
-        return (parseResult.reportMetadata.error != metaf::ReportError::NONE);
+        return _metadata.hasParseError;
     }
 
 private slots:
-    // This slot does the actual parsing
-    void parse();
+    // Discards the current weather and the decoded text, which will be generated again when needed
+    void invalidateDecodedText();
 
 private:
+    // This method does the actual parsing, and sets parseResult and _metadata
+    void parse();
+
+    // Calls parse() unless the message has already been parsed
+    void ensureParsed();
+
+    // Computes _currentWeather from parseResult. This is cheap, because only weather groups are visited.
+    void readCurrentWeather();
+
+    // Generates _decodedText from parseResult, by visiting all groups
+    void generateDecodedText();
+
     // Explanation functions
     static QString explainCloudType(const metaf::CloudType ct);
     static QString explainDirection(metaf::Direction direction, bool trueCardinalDirections=true);
@@ -197,20 +287,26 @@ private:
 
     // Cached data
 
-    // Decoded text generated by last run of parser
+    // Decoded text, generated on demand. The text is valid only if _decodedTextValid is true.
     QString _decodedText;
+    bool _decodedTextValid {false};
 
     // Raw text, as set with setRawText(…)
     QString _rawText;
 
-    // Current weather, as read from METAR
+    // Current weather, as read from METAR. The text is valid only if _currentWeatherValid is true.
     QString _currentWeather;
+    bool _currentWeatherValid {false};
 
     // Reference date, as set with setRawText(…)
     QDate _referenceDate;
 
-    // Result of the parser
+    // Metadata of the message
+    Metadata _metadata;
+
+    // Result of the parser. The result is valid only if _parsed is true.
     ParseResult parseResult;
+    bool _parsed {false};
 };
 
 }
@@ -18,6 +18,8 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include <utility>
+
 #include "GlobalObject.h"
 #include "Settings.h"
 #include "navigation/Clock.h"
@@ -32,46 +34,49 @@ Weather::METAR::METAR(QObject *parent)
 }
 
 
-Weather::METAR::METAR(QXmlStreamReader &xml, QObject *parent)
-    : Weather::Decoder(parent)
+auto Weather::METAR::readXML(QXmlStreamReader &xml) -> Data
 {
+    Data data;
 
     while (true) {
         xml.readNextStartElement();
+        if (xml.atEnd() || xml.hasError()) {
+            break;
+        }
         QString name = xml.name().toString();
 
         // Read Station_ID
         if (xml.isStartElement() && name == "station_id") {
-            _ICAOCode = xml.readElementText();
+            data.ICAOCode = xml.readElementText();
             continue;
         }
 
         // Read location
         if (xml.isStartElement() && name == "latitude") {
-            _location.setLatitude(xml.readElementText().toDouble());
+            data.location.setLatitude(xml.readElementText().toDouble());
             continue;
         }
         if (xml.isStartElement() && name == "longitude") {
-            _location.setLongitude(xml.readElementText().toDouble());
+            data.location.setLongitude(xml.readElementText().toDouble());
             continue;
         }
         if (xml.isStartElement() && name == "elevation_m") {
-            _location.setAltitude(xml.readElementText().toDouble());
+            data.location.setAltitude(xml.readElementText().toDouble());
             continue;
         }
 
         // Read raw text
         if (xml.isStartElement() && name == "raw_text") {
-            _raw_text = xml.readElementText();
+            data.rawText = xml.readElementText();
             continue;
         }
 
         // QNH
         if (xml.isStartElement() && name == "altim_in_hg") {
             auto content = xml.readElementText();
-            _qnh = qRound(content.toDouble() * 33.86);
-            if ((_qnh < 800) || (_qnh > 1200)) {
-                _qnh = 0;
+            data.qnh = qRound(content.toDouble() * 33.86);
+            if ((data.qnh < 800) || (data.qnh > 1200)) {
+                data.qnh = 0;
             }
             continue;
         }
@@ -79,23 +84,23 @@ Weather::METAR::METAR(QXmlStreamReader &xml, QObject *parent)
         // Wind
         if (xml.isStartElement() && name == "wind_speed_kt") {
             auto content = xml.readElementText();
-            _wind = Units::Speed::fromKN(content.toDouble());
+            data.wind = Units::Speed::fromKN(content.toDouble());
             continue;
         }
 
         // Gust
         if (xml.isStartElement() && name == "wind_gust_kt") {
             auto content = xml.readElementText();
-            _gust = Units::Speed::fromKN(content.toDouble());
+            data.gust = Units::Speed::fromKN(content.toDouble());
             continue;
         }
 
         // QNH
         if (xml.isStartElement() && name == "altim_in_hg") {
             auto content = xml.readElementText();
-            _qnh = qRound(content.toDouble() * 33.86);
-            if ((_qnh < 800) || (_qnh > 1200)) {
-                _qnh = 0;
+            data.qnh = qRound(content.toDouble() * 33.86);
+            if ((data.qnh < 800) || (data.qnh > 1200)) {
+                data.qnh = 0;
             }
             continue;
         }
@@ -103,7 +108,7 @@ Weather::METAR::METAR(QXmlStreamReader &xml, QObject *parent)
         // Observation Time
         if (xml.isStartElement() && name == "observation_time") {
             auto content = xml.readElementText();
-            _observationTime = QDateTime::fromString(content, Qt::ISODate);
+            data.observationTime = QDateTime::fromString(content, Qt::ISODate);
             continue;
         }
 
@@ -111,16 +116,16 @@ Weather::METAR::METAR(QXmlStreamReader &xml, QObject *parent)
         if (xml.isStartElement() && name == "flight_category") {
             auto content = xml.readElementText();
             if (content == "VFR") {
-                _flightCategory = VFR;
+                data.flightCategory = VFR;
             }
             if (content == "MVFR") {
-                _flightCategory = MVFR;
+                data.flightCategory = MVFR;
             }
             if (content == "IFR") {
-                _flightCategory = IFR;
+                data.flightCategory = IFR;
             }
             if (content == "LIFR") {
-                _flightCategory = LIFR;
+                data.flightCategory = LIFR;
             }
             continue;
         }
@@ -132,55 +137,91 @@ Weather::METAR::METAR(QXmlStreamReader &xml, QObject *parent)
         xml.skipCurrentElement();
     }
 
-    // Interpret the METAR message
-    setRawText(_raw_text, _observationTime.date());
-    setupSignals();
+    return data;
 }
 
 
-Weather::METAR::METAR(QDataStream &inputStream, QObject *parent)
-    : Weather::Decoder(parent)
+void Weather::METAR::decode(Data &data)
+{
+    auto decoded = Decoder::decode(data.rawText, data.observationTime.date());
+    data.metadata = decoded.metadata;
+    data.currentWeather = decoded.currentWeather;
+}
+
+
+auto Weather::METAR::read(QDataStream &inputStream) -> Data
+{
+    Data data;
+    inputStream >> data.flightCategory;
+    inputStream >> data.ICAOCode;
+    inputStream >> data.location;
+    inputStream >> data.observationTime;
+    inputStream >> data.qnh;
+    inputStream >> data.rawText;
+    inputStream >> data.wind;
+    inputStream >> data.gust;
+    quint8 type = 0;
+    inputStream >> type;
+    inputStream >> data.metadata.isSpeci;
+    inputStream >> data.metadata.hasParseError;
+    data.metadata.type = static_cast<metaf::ReportType>(type);
+    inputStream >> data.currentWeather;
+    return data;
+}
+
+
+void Weather::METAR::write(QDataStream &out, const Data &data)
 {
-    inputStream >> _flightCategory;
-    inputStream >> _ICAOCode;
-    inputStream >> _location;
-    inputStream >> _observationTime;
-    inputStream >> _qnh;
-    inputStream >> _raw_text;
-    inputStream >> _wind;
-    inputStream >> _gust;
-
-    // Interpret the METAR message
-    setRawText(_raw_text, _observationTime.date());
+    out << data.flightCategory;
+    out << data.ICAOCode;
+    out << data.location;
+    out << data.observationTime;
+    out << data.qnh;
+    out << data.rawText;
+    out << data.wind;
+    out << data.gust;
+    out << static_cast<quint8>(data.metadata.type);
+    out << data.metadata.isSpeci;
+    out << data.metadata.hasParseError;
+    out << data.currentWeather;
+}
+
+
+Weather::METAR::METAR(Data data, QObject *parent)
+    : Weather::Decoder(parent),
+      _data(std::move(data))
+{
+    // Set the METAR message. It will be parsed only when needed.
+    setRawText(_data.rawText, _data.observationTime.date(), _data.metadata);
     setupSignals();
 }
 
 
-auto Weather::METAR::expiration() const -> QDateTime
+auto Weather::METAR::Data::expiration() const -> QDateTime
 {
-    if (_raw_text.contains("NOSIG")) {
-        return _observationTime.addSecs(3*60*60);
+    if (rawText.contains("NOSIG")) {
+        return observationTime.addSecs(3*60*60);
     }
-    return _observationTime.addSecs(1.5*60*60);
+    return observationTime.addSecs(1.5*60*60);
 }
 
 
-auto Weather::METAR::flightCategoryColor() const -> QString
+auto Weather::METAR::Data::flightCategoryColor() const -> QString
 {
-    if (_flightCategory == VFR) {
+    if (flightCategory == VFR) {
         return "green";
     }
-    if (_flightCategory == MVFR) {
+    if (flightCategory == MVFR) {
         return "yellow";
     }
-    if ((_flightCategory == IFR) || (_flightCategory == LIFR)) {
+    if ((flightCategory == IFR) || (flightCategory == LIFR)) {
         return "red";
     }
     return "transparent";
 }
 
 
-auto Weather::METAR::isExpired() const -> bool
+auto Weather::METAR::Data::isExpired() const -> bool
 {
     auto exp = expiration();
     if (!exp.isValid()) {
@@ -190,18 +231,18 @@ auto Weather::METAR::isExpired() const -> bool
 }
 
 
-auto Weather::METAR::isValid() const -> bool
+auto Weather::METAR::Data::isValid() const -> bool
 {
-    if (!_location.isValid()) {
+    if (!location.isValid()) {
         return false;
     }
-    if (!_observationTime.isValid()) {
+    if (!observationTime.isValid()) {
         return false;
     }
-    if (_ICAOCode.isEmpty()) {
+    if (ICAOCode.isEmpty()) {
         return false;
     }
-    if (hasParseError()) {
+    if (metadata.hasParseError) {
         return false;
     }
 
@@ -211,11 +252,11 @@ auto Weather::METAR::isValid() const -> bool
 
 auto Weather::METAR::relativeObservationTime() const -> QString
 {
-    if (!_observationTime.isValid()) {
+    if (!_data.observationTime.isValid()) {
         return QString();
     }
 
-    return Navigation::Clock::describeTimeDifference(_observationTime);
+    return Navigation::Clock::describeTimeDifference(_data.observationTime);
 }
 
 
@@ -229,60 +270,46 @@ void Weather::METAR::setupSignals() const
 }
 
 
-auto Weather::METAR::summary() const -> QString {
+auto Weather::METAR::Data::summary() const -> QString {
 
     QStringList resultList;
 
-    switch (_flightCategory) {
+    switch (flightCategory) {
     case VFR:
-        if (_raw_text.contains("CAVOK")) {
-            resultList << tr("CAVOK");
+        if (rawText.contains("CAVOK")) {
+            resultList << METAR::tr("CAVOK");
         } else {
-            resultList << tr("VMC");
+            resultList << METAR::tr("VMC");
         }
         break;
     case MVFR:
-        resultList << tr("marginal VMC");
+        resultList << METAR::tr("marginal VMC");
         break;
     case IFR:
-        resultList << tr("IMC");
+        resultList << METAR::tr("IMC");
         break;
     case LIFR:
-        resultList << tr("low IMC");
+        resultList << METAR::tr("low IMC");
         break;
     default:
         break;
     }
 
     // Wind and Gusts
-    if (_gust.toKN() > 15) {
-        resultList << tr("gusts of %1").arg(_gust.toString() );
-    } else if (_wind.toKN() > 10) {
-        resultList << tr("wind at %1").arg(_wind.toString());
+    if (gust.toKN() > 15) {
+        resultList << METAR::tr("gusts of %1").arg(gust.toString() );
+    } else if (wind.toKN() > 10) {
+        resultList << METAR::tr("wind at %1").arg(wind.toString());
     }
 
     // Weather
-    auto curWeather = currentWeather();
-    if (!curWeather.isEmpty()) {
-        resultList << curWeather;
+    if (!currentWeather.isEmpty()) {
+        resultList << currentWeather;
     }
 
     if (resultList.isEmpty()) {
         return QString();
     }
 
-    return tr("%1 %2: %3").arg(messageType(), Navigation::Clock::describeTimeDifference(_observationTime), resultList.join(" • "));
-}
-
-
-void Weather::METAR::write(QDataStream &out)
-{
-    out << _flightCategory;
-    out << _ICAOCode;
-    out << _location;
-    out << _observationTime;
-    out << _qnh;
-    out << _raw_text;
-    out << _wind;
-    out << _gust;
+    return METAR::tr("%1 %2: %3").arg(Decoder::messageType(metadata), Navigation::Clock::describeTimeDifference(observationTime), resultList.join(" • "));
 }
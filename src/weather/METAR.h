@@ -34,8 +34,10 @@ class WeatherDataProvider;
 /*! \brief METAR report
  *
  * This class contains the data of a METAR or SPECI report and provided a few
- * methods to access the data. Instances of this class are provided by the
- * WeatherDataProvider class; there is no way to construct valid instances yourself.
+ * methods to access the data. The data itself is held in a plain value of
+ * type METAR::Data, which is what the WeatherDataProvider stores for every
+ * weather station. Instances of this class are constructed only when a
+ * report is shown in detail, and wrap such a value.
  */
 
 class METAR : public Decoder {
@@ -70,6 +72,64 @@ public:
     };
     Q_ENUM(FlightCategory)
 
+    /*! \brief Plain value holding the data of a METAR report */
+    struct Data {
+        /*! \brief Flight category, as returned by the Aviation Weather Center */
+        FlightCategory flightCategory {unknown};
+
+        /*! \brief Gust speed, as returned by the Aviation Weather Center */
+        Units::Speed gust;
+
+        /*! \brief Station ID, as returned by the Aviation Weather Center */
+        QString ICAOCode;
+
+        /*! \brief Station coordinate, as returned by the Aviation Weather Center */
+        QGeoCoordinate location;
+
+        /*! \brief Observation time, as returned by the Aviation Weather Center */
+        QDateTime observationTime;
+
+        /*! \brief QNH in hPa, or zero if unknown */
+        quint16 qnh {0};
+
+        /*! \brief Raw METAR text, as returned by the Aviation Weather Center */
+        QString rawText;
+
+        /*! \brief Wind speed, as returned by the Aviation Weather Center */
+        Units::Speed wind;
+
+        /*! \brief Metadata, as found by the decoder */
+        Decoder::Metadata metadata;
+
+        /*! \brief Current weather, as found by the decoder */
+        QString currentWeather;
+
+        /*! \brief Expiration time, as in the property METAR::expiration */
+        QDateTime expiration() const;
+
+        /*! \brief Suggested color, as in the property METAR::flightCategoryColor */
+        QString flightCategoryColor() const;
+
+        /*! \brief Check for expiration, as in METAR::isExpired() */
+        bool isExpired() const;
+
+        /*! \brief Check for validity, as in the property METAR::isValid */
+        bool isValid() const;
+
+        /*! \brief One-line summary, as in the property METAR::summary */
+        QString summary() const;
+    };
+
+    /*! \brief Constructs a METAR from data
+     *
+     * The message is parsed again only when the decoded text is first read.
+     *
+     * @param data Data of the METAR
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit METAR(Data data, QObject *parent = nullptr);
+
     /*! \brief Geographical coordinate of the station reporting this METAR
      *
      * If the station coordinate is unknown, the property contains an invalid
@@ -83,7 +143,7 @@ public:
      */
     QGeoCoordinate coordinate() const
     {
-        return _location;
+        return _data.location;
     }
 
     /*! \brief Expiration time and date
@@ -97,7 +157,10 @@ public:
      *
      * @returns Property expiration
      */
-    QDateTime expiration() const;
+    QDateTime expiration() const
+    {
+        return _data.expiration();
+    }
 
     /*! \brief Suggested color describing the flight category for this METAR
      *
@@ -117,7 +180,10 @@ public:
      *
      * @returns Property color
      */
-    QString flightCategoryColor() const;
+    QString flightCategoryColor() const
+    {
+        return _data.flightCategoryColor();
+    }
 
     /*! \brief Flight category for this METAR */
     Q_PROPERTY(FlightCategory flightCategory READ flightCategory CONSTANT)
@@ -128,7 +194,7 @@ public:
      */
     FlightCategory flightCategory() const
     {
-        return _flightCategory;
+        return _data.flightCategory;
     }
 
     /*! \brief ICAO code of the station reporting this METAR
@@ -144,7 +210,7 @@ public:
      */
     QString ICAOCode() const
     {
-        return _ICAOCode;
+        return _data.ICAOCode;
     }
 
     /*! \brief Convenience method to check if this METAR is already expired
@@ -152,7 +218,10 @@ public:
      * @returns true if an expiration date/time is known and if the current time
      * is larger than the expiration
      */
-    Q_INVOKABLE bool isExpired() const;
+    Q_INVOKABLE bool isExpired() const
+    {
+        return _data.isExpired();
+    }
 
     /*! \brief Indicates if the class represents a valid METAR report */
     Q_PROPERTY(bool isValid READ isValid CONSTANT)
@@ -161,7 +230,10 @@ public:
      *
      * @returns Property isValid
      */
-    bool isValid() const;
+    bool isValid() const
+    {
+        return _data.isValid();
+    }
 
     /*! \brief Observation time of this METAR */
     Q_PROPERTY(QDateTime observationTime READ observationTime CONSTANT)
@@ -172,7 +244,7 @@ public:
      */
     QDateTime observationTime() const
     {
-        return _observationTime;
+        return _data.observationTime;
     }
 
     /*! \brief QNH value in this METAR, in hPa
@@ -188,7 +260,7 @@ public:
      */
     quint16 QNH() const
     {
-        return _qnh;
+        return _data.qnh;
     }
 
     /*! \brief Raw METAR text
@@ -204,7 +276,7 @@ public:
      */
     QString rawText() const
     {
-        return _raw_text;
+        return _data.rawText;
     }
 
     /*! \brief Observation time, relative to now
@@ -231,7 +303,10 @@ public:
      *
      * @returns Property summary
      */
-    QString summary() const;
+    QString summary() const
+    {
+        return _data.summary();
+    }
 
 
 signals:
@@ -241,48 +316,29 @@ signals:
     /*! \brief Notifier signal */
     void relativeObservationTimeChanged();
 
-protected:
-    // This constructor reads a XML stream, as provided by the Aviation Weather
-    // Center's Text Data Server, https://www.aviationweather.gov/dataserver
-    explicit METAR(QXmlStreamReader &xml, QObject *parent = nullptr);
-
-    // This constructor reads a serialized METAR from a QDataStream
-    explicit METAR(QDataStream &inputStream, QObject *parent = nullptr);
-
 private:
-    // Connects signals; this method is used internally from the constructor(s)
-    void setupSignals() const;
-
-    // Writes the METAR report to a data stream
-    void write(QDataStream &out);
-
-    Q_DISABLE_COPY_MOVE(METAR)
-
-    // Decoded METAR text
-    QString _decoded;
+    // Reads a METAR from a XML stream, as provided by the Aviation Weather
+    // Center's Text Data Server, https://www.aviationweather.gov/dataserver.
+    // This method is thread-safe and is meant to be run in a worker thread.
+    static Data readXML(QXmlStreamReader &xml);
 
-    // Flight category, as returned by the Aviation Weather Center
-    FlightCategory _flightCategory {unknown};
+    // Parses the raw text of data read by readXML() and sets the metadata and
+    // the current weather. This method is thread-safe and is meant to be run
+    // in a worker thread.
+    static void decode(Data &data);
 
-    // Gust speed, as returned by the Aviation Weather Center
-    Units::Speed _gust;
+    // Reads data from a QDataStream, as written by write()
+    static Data read(QDataStream &inputStream);
 
-    // Station ID, as returned by the Aviation Weather Center
-    QString _ICAOCode;
+    // Writes data to a QDataStream
+    static void write(QDataStream &out, const Data &data);
 
-    // Station coordinate, as returned by the Aviation Weather Center
-    QGeoCoordinate _location;
-
-    // Observation time, as returned by the Aviation Weather Center
-    QDateTime _observationTime;
-
-    // QNH in hPa, as returned by the Aviation Weather Center
-    quint16 _qnh {0};
+    // Connects signals; this method is used internally from the constructor(s)
+    void setupSignals() const;
 
-    // Raw METAR text, as returned by the Aviation Weather Center
-    QString _raw_text;
+    Q_DISABLE_COPY_MOVE(METAR)
 
-    // Wind speed, as returned by the Aviation Weather Center
-    Units::Speed _wind;
+    // Data of the report
+    Data _data;
 };
 }
@@ -22,12 +22,7 @@
 
 #include <QPointer>
 
-#include "weather/METAR.h"
-#include "weather/TAF.h"
-
-namespace GeoMaps {
-class GeoMapProvider;
-}
+#include "weather/StationRecord.h"
 
 
 namespace Weather {
@@ -36,16 +31,20 @@ class WeatherDataProvider;
 
 /*! \brief This class represents a weather station that issues METAR or TAF report
  *
- * This is a very simple class that represents a weather station. Weather stations
- * are uniquely identified by their ICAO code. Depending on available data, they
- * hold pointers to the latest METAR and TAF reports.
+ * This is a very simple class that represents a weather station, for use in
+ * QML pages that show a station in detail. Weather stations are uniquely
+ * identified by their ICAO code. Depending on available data, they hold
+ * pointers to the latest METAR and TAF reports.
+ *
+ * The WeatherDataProvider stores all stations as plain values of type
+ * StationRecord, and lists them through a StationListModel. Instances of
+ * this class are constructed by WeatherDataProvider::findWeatherStation()
+ * only, and are kept up to date for as long as they exist.
  */
 class Station : public QObject {
     Q_OBJECT
 
     friend WeatherDataProvider;
-    friend METAR;
-    friend TAF;
 public:
     /*! \brief Standard constructor
      *
@@ -263,31 +262,17 @@ signals:
     /* \brief Notifier signal */
     void twoLineTitleChanged();
 
-private slots:
-    // This method attempts to find a waypoint matchting this weather station,
-    // in order to learn additional data about the station. This method is
-    // called automaticall whenever the GeoMapProvider has new data.
-    void readDataFromWaypoint();
-
 private:
     Q_DISABLE_COPY_MOVE(Station)
 
     // This constructor is only meant to be called by instances of the
     // WeatherDataProvider class
-    explicit Station(QString id, GeoMaps::GeoMapProvider *geoMapProvider, QObject *parent);
+    explicit Station(const StationRecord& record, QObject *parent);
 
-    // If the metar is valid, not expired and newer than the existing metar,
-    // this method sets the METAR message and deletes any existing METAR;
-    // otherwise, the metar is deleted. In any case, this WeatherStation will
-    // take ownership of the METAR. The signal metarChanged() will be emitted if
-    // appropriate.
-    void setMETAR(Weather::METAR *metar);
-
-    // If the taf is valid, not expired and newer than the existing taf, this
-    // method sets the TAF message and deletes any existing TAF; otherwise, the
-    // taf is deleted. In any case, this WeatherStation will take ownership of
-    // the TAF. The signal tafChanged() will be emitted if appropriate.
-    void setTAF(Weather::TAF *taf);
+    // Updates names, coordinate and reports from the record, emitting the
+    // notifier signals as appropriate. METAR and TAF objects are replaced
+    // only if the raw text of the report has changed.
+    void setRecord(const StationRecord& record);
 
     // Coordinate of this weather station
     QGeoCoordinate _coordinate;
@@ -309,13 +294,6 @@ private:
 
     // Two-Line-Title
     QString _twoLineTitle;
-
-    // Pointer to GeoMapProvider, used in order to find matching waypoints
-    QPointer<GeoMaps::GeoMapProvider> _geoMapProvider;
-
-    // Internal flag to indicate if data has been read from a matching waypoint
-    // already
-    bool hasWaypointData {false};
 };
 
 } // Namespace
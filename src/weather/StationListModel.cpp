@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <utility>
+
+#include "weather/StationListModel.h"
+
+
+Weather::StationListModel::StationListModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+
+auto Weather::StationListModel::data(const QModelIndex& index, int role) const -> QVariant
+{
+    // Paranoid safety checks
+    if (!index.isValid() || (index.row() >= m_stations.size())) {
+        return {};
+    }
+
+    const auto& station = m_stations.at(index.row());
+    switch(role) {
+    case ICAOCodeRole:
+        return station.ICAOCode;
+    case CoordinateRole:
+        return QVariant::fromValue(station.coordinate);
+    case ExtendedNameRole:
+        return station.extendedName;
+    case IconRole:
+        return station.icon;
+    case TwoLineTitleRole:
+        return station.twoLineTitle;
+    case HasMETARRole:
+        return station.metar.has_value();
+    case HasTAFRole:
+        return station.taf.has_value();
+    case FlightCategoryColorRole:
+        return station.metar.has_value() ? station.metar->flightCategoryColor() : QStringLiteral("transparent");
+    case SummaryRole:
+        return station.metar.has_value() ? station.metar->summary() : QString();
+    default:
+        return {};
+    }
+}
+
+
+auto Weather::StationListModel::roleNames() const -> QHash<int, QByteArray>
+{
+    return {{ICAOCodeRole, "ICAOCode"},
+            {CoordinateRole, "coordinate"},
+            {ExtendedNameRole, "extendedName"},
+            {IconRole, "icon"},
+            {TwoLineTitleRole, "twoLineTitle"},
+            {HasMETARRole, "hasMETAR"},
+            {HasTAFRole, "hasTAF"},
+            {FlightCategoryColorRole, "flightCategoryColor"},
+            {SummaryRole, "summary"}};
+}
+
+
+auto Weather::StationListModel::rowCount(const QModelIndex& parent) const -> int
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_stations.size();
+}
+
+
+void Weather::StationListModel::refreshSummaries()
+{
+    if (m_stations.isEmpty()) {
+        return;
+    }
+    emit dataChanged(index(0), index(m_stations.size()-1), {SummaryRole});
+}
+
+
+void Weather::StationListModel::setStations(QVector<StationRecord> stations)
+{
+    beginResetModel();
+    m_stations = std::move(stations);
+    endResetModel();
+}
+
+
+auto Weather::StationListModel::wayTo(int index, const QGeoCoordinate& from, bool useMetricUnits) const -> QString
+{
+    if ((index < 0) || (index >= m_stations.size())) {
+        return {};
+    }
+    return m_stations.at(index).wayTo(from, useMetricUnits);
+}
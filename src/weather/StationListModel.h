@@ -0,0 +1,136 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QVector>
+
+#include "weather/StationRecord.h"
+
+namespace Weather {
+
+/*! \brief List model for weather stations
+ *
+ *  This class exposes the weather stations known to the WeatherDataProvider
+ *  to QML views, sorted by distance to the last known position. Each row is
+ *  a plain StationRecord; no QObjects are constructed for the rows. The
+ *  delegates read the following roles:
+ *
+ *  - "ICAOCode" holds the ICAO code of the station
+ *  - "coordinate" holds the coordinate of the station
+ *  - "extendedName" holds the extended name of the station
+ *  - "icon" holds the icon of the station
+ *  - "twoLineTitle" holds the title of the station
+ *  - "hasMETAR" and "hasTAF" indicate if reports are available
+ *  - "flightCategoryColor" holds the color of the METAR flight category
+ *  - "summary" holds the one-line summary of the METAR
+ *
+ *  To show a station in detail, use
+ *  WeatherDataProvider::findWeatherStation() with the ICAO code.
+ */
+
+class StationListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Roles of the model */
+    enum Roles {
+        ICAOCodeRole = Qt::UserRole+1, /*!< ICAO code */
+        CoordinateRole,                /*!< Coordinate */
+        ExtendedNameRole,              /*!< Extended name */
+        IconRole,                      /*!< Icon */
+        TwoLineTitleRole,              /*!< Title */
+        HasMETARRole,                  /*!< METAR available */
+        HasTAFRole,                    /*!< TAF available */
+        FlightCategoryColorRole,       /*!< Color of the flight category */
+        SummaryRole                    /*!< Summary of the METAR */
+    };
+    Q_ENUM(Roles)
+
+    /*! \brief Constructs an empty model
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit StationListModel(QObject* parent = nullptr);
+
+    // Standard destructor
+    ~StationListModel() override = default;
+
+    /*! \brief Implementation of QAbstractListModel::data
+     *
+     * @param index Index of the station
+     *
+     * @param role Role
+     *
+     * @returns Data
+     */
+    QVariant data(const QModelIndex& index, int role = ICAOCodeRole) const override;
+
+    /*! \brief Implementation of QAbstractListModel::roleNames
+     *
+     * @returns Role names
+     */
+    QHash<int, QByteArray> roleNames() const override;
+
+    /*! \brief Implementation of QAbstractListModel::rowCount
+     *
+     * @param parent Parent index, must be invalid
+     *
+     * @returns Number of stations
+     */
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    /*! \brief Description of the way to a station
+     *
+     * @param index Index of the station
+     *
+     * @param from Starting point of the way
+     *
+     * @param useMetricUnits If true, then description uses metric units.
+     * Otherwise, nautical units are used.
+     *
+     * @returns A string as in StationRecord::wayTo, or an empty string if the
+     * index is out of range
+     */
+    Q_INVOKABLE QString wayTo(int index, const QGeoCoordinate& from, bool useMetricUnits) const;
+
+    /*! \brief Replace all stations
+     *
+     * @param stations Stations, in the order in which they are shown
+     */
+    void setStations(QVector<StationRecord> stations);
+
+    /*! \brief Notify views that the summaries have changed
+     *
+     * Summaries describe the age of the METAR and depend on the preferred
+     * unit system. The WeatherDataProvider calls this method whenever the
+     * minute or the preferred units change.
+     */
+    void refreshSummaries();
+
+private:
+    Q_DISABLE_COPY_MOVE(StationListModel)
+
+    QVector<StationRecord> m_stations;
+};
+
+}
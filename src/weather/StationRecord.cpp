@@ -0,0 +1,86 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "weather/StationRecord.h"
+
+
+auto Weather::StationRecord::setMETAR(const METAR::Data& data) -> bool
+{
+    if (!data.isValid() || data.isExpired() || (data.ICAOCode != ICAOCode)) {
+        return false;
+    }
+    if (metar.has_value() && (metar->observationTime > data.observationTime)) {
+        return false;
+    }
+
+    metar = data;
+    if (!coordinate.isValid()) {
+        coordinate = data.location;
+    }
+    return true;
+}
+
+
+auto Weather::StationRecord::setTAF(const TAF::Data& data) -> bool
+{
+    if (!data.isValid() || data.isExpired() || (data.ICAOCode != ICAOCode)) {
+        return false;
+    }
+    if (taf.has_value() && (taf->issueTime > data.issueTime)) {
+        return false;
+    }
+
+    taf = data;
+    if (!coordinate.isValid()) {
+        coordinate = data.location;
+    }
+    return true;
+}
+
+
+void Weather::StationRecord::setWaypoint(const GeoMaps::Waypoint& waypoint)
+{
+    if (hasWaypointData || !waypoint.isValid()) {
+        return;
+    }
+    hasWaypointData = true;
+
+    coordinate = waypoint.coordinate();
+    extendedName = waypoint.extendedName();
+    icon = waypoint.icon();
+    twoLineTitle = waypoint.twoLineTitle();
+}
+
+
+auto Weather::StationRecord::wayTo(const QGeoCoordinate& from, bool useMetric) const -> QString
+{
+    // Paranoid safety checks
+    if (!from.isValid() || !coordinate.isValid()) {
+        return {};
+    }
+
+    auto dist = Units::Distance::fromM(from.distanceTo(coordinate));
+    auto QUJ = qRound(from.azimuthTo(coordinate));
+
+    if (useMetric) {
+        return QString("DIST %1 km • QUJ %2°").arg(dist.toKM(), 0, 'f', 1).arg(QUJ);
+    }
+    return QString("DIST %1 NM • QUJ %2°").arg(dist.toNM(), 0, 'f', 1).arg(QUJ);
+}
@@ -0,0 +1,112 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <optional>
+
+#include "geomaps/Waypoint.h"
+#include "weather/METAR.h"
+#include "weather/TAF.h"
+
+
+namespace Weather {
+
+/*! \brief Plain value holding the data of a weather station
+ *
+ * The WeatherDataProvider stores one such value for every weather station
+ * that it knows of. The values are cheap to copy and carry no signals, so
+ * that long lists of stations can be shown without constructing QObjects.
+ * Instances of Weather::Station, which wrap a record for use in QML, are
+ * constructed only when a station is shown in detail.
+ */
+
+struct StationRecord
+{
+    /*! \brief ICAO code of the weather station */
+    QString ICAOCode;
+
+    /*! \brief Coordinate, taken from the waypoint or else from the reports */
+    QGeoCoordinate coordinate;
+
+    /*! \brief Extended name, as in Waypoint::extendedName() */
+    QString extendedName;
+
+    /*! \brief Icon, as in Waypoint::icon() */
+    QString icon {QStringLiteral("/icons/waypoints/WP.svg")};
+
+    /*! \brief Two-line title, as in Waypoint::twoLineTitle() */
+    QString twoLineTitle;
+
+    /*! \brief Indicates if names and icon have been read from a waypoint */
+    bool hasWaypointData {false};
+
+    /*! \brief Last METAR, if any */
+    std::optional<METAR::Data> metar;
+
+    /*! \brief Last TAF, if any */
+    std::optional<TAF::Data> taf;
+
+    /*! \brief Set METAR
+     *
+     * The METAR is ignored if it is invalid, expired, older than the
+     * current METAR or issued by another station.
+     *
+     * @param data METAR
+     *
+     * @returns True if the METAR has been set
+     */
+    bool setMETAR(const METAR::Data& data);
+
+    /*! \brief Set TAF
+     *
+     * The TAF is ignored if it is invalid, expired, older than the current
+     * TAF or issued by another station.
+     *
+     * @param data TAF
+     *
+     * @returns True if the TAF has been set
+     */
+    bool setTAF(const TAF::Data& data);
+
+    /*! \brief Copy coordinate, names and icon from a waypoint
+     *
+     * This method does nothing if the waypoint is invalid or if waypoint
+     * data has already been set.
+     *
+     * @param waypoint Waypoint at the location of the station
+     */
+    void setWaypoint(const GeoMaps::Waypoint& waypoint);
+
+    /*! \brief Description of the way from a given point to the weather station
+     *
+     * @param from Starting point of the way
+     *
+     * @param useMetric If true, then description uses metric units. Otherwise,
+     * nautical units are used.
+     *
+     * @returns A string such as "DIST 65.2 NM • QUJ 276°".  If the way cannot
+     * be described (e.g. because one of the coordinates is invalid or unknown),
+     * then an empty string is returned.
+     */
+    QString wayTo(const QGeoCoordinate& from, bool useMetric) const;
+};
+
+}
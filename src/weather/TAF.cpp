@@ -20,6 +20,7 @@
 
 #include <QDataStream>
 #include <QXmlStreamAttribute>
+#include <utility>
 
 #include "GlobalObject.h"
 #include "navigation/Clock.h"
@@ -27,49 +28,52 @@
 #include "weather/TAF.h"
 
 
-Weather::TAF::TAF(QXmlStreamReader &xml, QObject *parent)
-    : Weather::Decoder(parent)
+auto Weather::TAF::readXML(QXmlStreamReader &xml) -> Data
 {
+    Data data;
 
     while (true) {
         xml.readNextStartElement();
+        if (xml.atEnd() || xml.hasError()) {
+            break;
+        }
         QString name = xml.name().toString();
 
         // Read Station_ID
         if (xml.isStartElement() && name == "station_id") {
-            _ICAOCode = xml.readElementText();
+            data.ICAOCode = xml.readElementText();
             continue;
         }
 
         // Read location
         if (xml.isStartElement() && name == "latitude") {
-            _location.setLatitude(xml.readElementText().toDouble());
+            data.location.setLatitude(xml.readElementText().toDouble());
             continue;
         }
         if (xml.isStartElement() && name == "longitude") {
-            _location.setLongitude(xml.readElementText().toDouble());
+            data.location.setLongitude(xml.readElementText().toDouble());
             continue;
         }
         if (xml.isStartElement() && name == "elevation_m") {
-            _location.setAltitude(xml.readElementText().toDouble());
+            data.location.setAltitude(xml.readElementText().toDouble());
             continue;
         }
 
         // Read raw text
         if (xml.isStartElement() && name == "raw_text") {
-            _raw_text = xml.readElementText();
+            data.rawText = xml.readElementText();
             continue;
         }
 
         // Read issue time
         if (xml.isStartElement() && name == "issue_time") {
-            _issueTime = QDateTime::fromString(xml.readElementText(), Qt::ISODate);
+            data.issueTime = QDateTime::fromString(xml.readElementText(), Qt::ISODate);
             continue;
         }
 
         // Read expiration date
         if (xml.isStartElement() && name == "valid_time_to") {
-            _expirationTime = QDateTime::fromString(xml.readElementText(), Qt::ISODate);
+            data.expirationTime = QDateTime::fromString(xml.readElementText(), Qt::ISODate);
             continue;
         }
 
@@ -80,49 +84,80 @@ Weather::TAF::TAF(QXmlStreamReader &xml, QObject *parent)
         xml.skipCurrentElement();
     }
 
-    setRawText(_raw_text, _issueTime.date().addDays(5));
-    setupSignals();
+    return data;
+}
+
+
+void Weather::TAF::decode(Data &data)
+{
+    data.metadata = Decoder::decode(data.rawText, data.issueTime.date().addDays(5)).metadata;
+}
+
+
+auto Weather::TAF::read(QDataStream &inputStream) -> Data
+{
+    Data data;
+    inputStream >> data.expirationTime;
+    inputStream >> data.ICAOCode;
+    inputStream >> data.issueTime;
+    inputStream >> data.location;
+    inputStream >> data.rawText;
+    quint8 type = 0;
+    inputStream >> type;
+    inputStream >> data.metadata.isSpeci;
+    inputStream >> data.metadata.hasParseError;
+    data.metadata.type = static_cast<metaf::ReportType>(type);
+    return data;
 }
 
 
-Weather::TAF::TAF(QDataStream &inputStream, QObject *parent)
-    : Weather::Decoder(parent)
+void Weather::TAF::write(QDataStream &out, const Data &data)
 {
-    inputStream >> _expirationTime;
-    inputStream >> _ICAOCode;
-    inputStream >> _issueTime;
-    inputStream >> _location;
-    inputStream >> _raw_text;
+    out << data.expirationTime;
+    out << data.ICAOCode;
+    out << data.issueTime;
+    out << data.location;
+    out << data.rawText;
+    out << static_cast<quint8>(data.metadata.type);
+    out << data.metadata.isSpeci;
+    out << data.metadata.hasParseError;
+}
 
-    setRawText(_raw_text, _issueTime.date().addDays(5));
+
+Weather::TAF::TAF(Data data, QObject *parent)
+    : Weather::Decoder(parent),
+      _data(std::move(data))
+{
+    // Set the TAF message. It will be parsed only when needed.
+    setRawText(_data.rawText, _data.issueTime.date().addDays(5), _data.metadata);
     setupSignals();
 }
 
 
-auto Weather::TAF::isExpired() const -> bool
+auto Weather::TAF::Data::isExpired() const -> bool
 {
-    if (!_expirationTime.isValid()) {
+    if (!expirationTime.isValid()) {
         return true;
     }
-    return QDateTime::currentDateTime() > _expirationTime;
+    return QDateTime::currentDateTime() > expirationTime;
 }
 
 
-auto Weather::TAF::isValid() const -> bool
+auto Weather::TAF::Data::isValid() const -> bool
 {
-    if (!_location.isValid()) {
+    if (!location.isValid()) {
         return false;
     }
-    if (!_expirationTime.isValid()) {
+    if (!expirationTime.isValid()) {
         return false;
     }
-    if (!_issueTime.isValid()) {
+    if (!issueTime.isValid()) {
         return false;
     }
-    if (_ICAOCode.isEmpty()) {
+    if (ICAOCode.isEmpty()) {
         return false;
     }
-    if (hasParseError()) {
+    if (metadata.hasParseError) {
         return false;
     }
 
@@ -132,11 +167,11 @@ auto Weather::TAF::isValid() const -> bool
 
 auto Weather::TAF::relativeIssueTime() const -> QString
 {
-    if (!_issueTime.isValid()) {
+    if (!_data.issueTime.isValid()) {
         return QString();
     }
 
-    return Navigation::Clock::describeTimeDifference(_issueTime);
+    return Navigation::Clock::describeTimeDifference(_data.issueTime);
 }
 
 
@@ -145,13 +180,3 @@ void Weather::TAF::setupSignals() const
     // Emit notifier signals whenever the time changes
     connect(GlobalObject::navigator()->clock(), &Navigation::Clock::timeChanged, this, &Weather::TAF::relativeIssueTimeChanged);
 }
-
-
-void Weather::TAF::write(QDataStream &out)
-{
-    out << _expirationTime;
-    out << _ICAOCode;
-    out << _issueTime;
-    out << _location;
-    out << _raw_text;
-}
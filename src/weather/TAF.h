@@ -35,8 +35,9 @@ class WeatherDataProvider;
 /*! \brief TAF report
  *
  * This class contains the data of a TAF report and provided a few
- * methods to access the data. Instances of this class are provided by the
- * WeatherDataProvider class; there is no way to construct valid instances yourself.
+ * methods to access the data. As with METAR, the data is held in a plain
+ * value of type TAF::Data, and instances of this class are constructed only
+ * when a forecast is shown in detail.
  */
 
 class TAF : public Decoder {
@@ -56,6 +57,43 @@ public:
     // Standard destructor
     ~TAF() override = default;
 
+    /*! \brief Plain value holding the data of a TAF report */
+    struct Data {
+        /*! \brief End of the last forecast period */
+        QDateTime expirationTime;
+
+        /*! \brief Station ID, as returned by the Aviation Weather Center */
+        QString ICAOCode;
+
+        /*! \brief Issue time, as returned by the Aviation Weather Center */
+        QDateTime issueTime;
+
+        /*! \brief Station coordinate, as returned by the Aviation Weather Center */
+        QGeoCoordinate location;
+
+        /*! \brief Raw TAF text, as returned by the Aviation Weather Center */
+        QString rawText;
+
+        /*! \brief Metadata, as found by the decoder */
+        Decoder::Metadata metadata;
+
+        /*! \brief Check for expiration, as in TAF::isExpired() */
+        bool isExpired() const;
+
+        /*! \brief Check for validity, as in the property TAF::isValid */
+        bool isValid() const;
+    };
+
+    /*! \brief Constructs a TAF from data
+     *
+     * The message is parsed again only when the decoded text is first read.
+     *
+     * @param data Data of the TAF
+     *
+     * @param parent The standard QObject parent pointer
+     */
+    explicit TAF(Data data, QObject *parent = nullptr);
+
     /*! \brief Geographical coordinate of the station reporting this TAF
      *
      * If the station coordinate is unknown, the property contains an invalid coordinate.
@@ -68,7 +106,7 @@ public:
      */
     QGeoCoordinate coordinate() const
     {
-        return _location;
+        return _data.location;
     }
 
     /*! \brief Expiration time and date
@@ -83,7 +121,7 @@ public:
      */
     QDateTime expiration() const
     {
-        return _expirationTime;
+        return _data.expirationTime;
     }
 
     /*! \brief ICAO code of the station reporting this TAF
@@ -99,14 +137,17 @@ public:
      */
     QString ICAOCode() const
     {
-        return _ICAOCode;
+        return _data.ICAOCode;
     }
 
     /*! \brief Convenience method to check if this TAF is already expired
      *
      * @returns true if an expiration date/time is known and if the current time is larger than the expiration
      */
-    Q_INVOKABLE bool isExpired() const;
+    Q_INVOKABLE bool isExpired() const
+    {
+        return _data.isExpired();
+    }
 
     /*! Indicates if the class represents a valid TAF report */
     Q_PROPERTY(bool isValid READ isValid CONSTANT)
@@ -115,7 +156,10 @@ public:
      *
      * @returns Property isValid
      */
-    bool isValid() const;
+    bool isValid() const
+    {
+        return _data.isValid();
+    }
 
     /*! \brief Issue time of this TAF */
     Q_PROPERTY(QDateTime issueTime READ issueTime CONSTANT)
@@ -126,7 +170,7 @@ public:
      */
     QDateTime issueTime() const
     {
-        return _issueTime;
+        return _data.issueTime;
     }
 
     /*! \brief  Raw TAF text
@@ -141,7 +185,7 @@ public:
      */
     QString rawText() const
     {
-        return _raw_text;
+        return _data.rawText;
     }
 
     /*! \brief Issue time, relative to now
@@ -162,35 +206,28 @@ signals:
     void relativeIssueTimeChanged();
 
 private:
-    // This constructor reads a XML stream, as provided by the Aviation Weather Center's Text Data Server,
-    // https://www.aviationweather.gov/dataserver
-    explicit TAF(QXmlStreamReader &xml, QObject *parent = nullptr);
+    // Reads a TAF from a XML stream, as provided by the Aviation Weather
+    // Center's Text Data Server, https://www.aviationweather.gov/dataserver.
+    // This method is thread-safe and is meant to be run in a worker thread.
+    static Data readXML(QXmlStreamReader &xml);
+
+    // Parses the raw text of data read by readXML() and sets the metadata.
+    // This method is thread-safe and is meant to be run in a worker thread.
+    static void decode(Data &data);
 
-    // This constructor reads a serialized TAF from a QDataStream
-    explicit TAF(QDataStream &inputStream, QObject *parent = nullptr);
+    // Reads data from a QDataStream, as written by write()
+    static Data read(QDataStream &inputStream);
+
+    // Writes data to a QDataStream
+    static void write(QDataStream &out, const Data &data);
 
     // Connects signals; this method is used internally from the constructor(s)
     void setupSignals() const;
 
-    // Writes the TAF report to a data stream
-    void write(QDataStream &out);
-
     Q_DISABLE_COPY_MOVE(TAF)
 
-    // Expiration time
-    QDateTime _expirationTime;
-
-    // Station ID, as returned by the Aviation Weather Center
-    QString _ICAOCode;
-
-    // Issue time, as returned by the Aviation Weather Center
-    QDateTime _issueTime;
-
-    // Station coordinate, as returned by the Aviation Weather Center
-    QGeoCoordinate _location;
-
-    // Raw TAF text, as returned by the Aviation Weather Center
-    QString _raw_text;
+    // Data of the report
+    Data _data;
 };
 
 }
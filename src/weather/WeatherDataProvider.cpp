@@ -18,22 +18,33 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include <algorithm>
 #include <gsl/util>
 
 #include <QDataStream>
+#include <QFutureWatcher>
 #include <QLockFile>
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QQmlEngine>
 #include <QSaveFile>
 #include <QStandardPaths>
+#include <QUrlQuery>
 #include <QXmlStreamReader>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtGlobal>
 
 #include "sunset.h"
 
 #include "GlobalObject.h"
+#include "InitScheduler.h"
+#include "Metrics.h"
+#include "MobileAdaptor.h"
+#include "Profiler.h"
 #include "Settings.h"
+#include "Tracer.h"
+#include "geomaps/AviationData.h"
 #include "geomaps/GeoMapProvider.h"
 #include "navigation/Clock.h"
 #include "navigation/FlightRoute.h"
@@ -57,11 +68,22 @@ Weather::WeatherDataProvider::WeatherDataProvider(QObject *parent) : QObject(par
 
     // Connect the timer to check for expired messages
     connect(&_deleteExiredMessagesTimer, &QTimer::timeout, this, &Weather::WeatherDataProvider::deleteExpiredMesages);
-    _deleteExiredMessagesTimer.setInterval(10min);
-    _deleteExiredMessagesTimer.start();
+    _deleteExiredMessagesTimer.setSingleShot(true);
 
-    // Update the description text when needed
-    connect(this, &Weather::WeatherDataProvider::weatherStationsChanged, this, &Weather::WeatherDataProvider::QNHInfoChanged);
+    // Connect the timer for weather briefings along the route
+    connect(&_briefingTimer, &QTimer::timeout, this, [this]() { update(); });
+    _briefingTimer.setSingleShot(true);
+    _briefingTimer.setInterval(5s);
+
+    // Connect the timer for write-behind of the weather data
+    connect(&_saveTimer, &QTimer::timeout, this, &Weather::WeatherDataProvider::save);
+    _saveTimer.setSingleShot(true);
+    _saveTimer.setInterval(10s);
+
+    // Update the description text when needed. Sort the list of weather
+    // stations again when the set of stations changes.
+    connect(this, &Weather::WeatherDataProvider::weatherStationsChanged, this, &Weather::WeatherDataProvider::onWeatherStationsChanged);
+    connect(this, &Weather::WeatherDataProvider::weatherStationsChanged, this, &Weather::WeatherDataProvider::invalidateQNHInfo);
 
     // Set up connections to other static objects, but do so with a little lag to avoid conflicts in the initialisation
     QTimer::singleShot(0, this, &Weather::WeatherDataProvider::deferredInitialization);
@@ -70,57 +92,136 @@ Weather::WeatherDataProvider::WeatherDataProvider(QObject *parent) : QObject(par
 
 void Weather::WeatherDataProvider::deferredInitialization()
 {
-    connect(GlobalObject::positionProvider(), &Positioning::PositionProvider::receivingPositionInfoChanged, this, &Weather::WeatherDataProvider::QNHInfoChanged);
-    connect(GlobalObject::positionProvider(), &Positioning::PositionProvider::receivingPositionInfoChanged, this, &Weather::WeatherDataProvider::sunInfoChanged);
-
-    connect(GlobalObject::navigator()->clock(), &Navigation::Clock::timeChanged, this, &Weather::WeatherDataProvider::QNHInfoChanged);
-    connect(GlobalObject::navigator()->clock(), &Navigation::Clock::timeChanged, this, &Weather::WeatherDataProvider::sunInfoChanged);
+    connect(GlobalObject::mobileAdaptor(), &MobileAdaptor::memoryLow, this, &Weather::WeatherDataProvider::releaseMemory);
+    connect(GlobalObject::positionProvider(), &Positioning::PositionProvider::receivingPositionInfoChanged, this, &Weather::WeatherDataProvider::invalidateQNHInfo);
+    connect(GlobalObject::positionProvider(), &Positioning::PositionProvider::receivingPositionInfoChanged, this, &Weather::WeatherDataProvider::invalidateSunInfo);
+    connect(GlobalObject::positionProvider(), &Positioning::PositionProvider::lastValidCoordinateChanged, this, &Weather::WeatherDataProvider::onLastValidCoordinateChanged);
+
+    connect(GlobalObject::navigator()->clock(), &Navigation::Clock::timeChanged, this, &Weather::WeatherDataProvider::invalidateQNHInfo);
+    connect(GlobalObject::navigator()->clock(), &Navigation::Clock::timeChanged, this, &Weather::WeatherDataProvider::invalidateSunInfo);
+
+    // The summaries shown in the list of stations describe the age of the
+    // METAR, and use the preferred units
+    connect(GlobalObject::navigator()->clock(), &Navigation::Clock::timeChanged, &_stationListModel, &Weather::StationListModel::refreshSummaries);
+    connect(GlobalObject::settings(), &Settings::useMetricUnitsChanged, &_stationListModel, &Weather::StationListModel::refreshSummaries);
+
+    // Stations learn their waypoint data in one batch whenever new aviation data is available
+    connect(GlobalObject::geoMapProvider(), &GeoMaps::GeoMapProvider::geoJSONChanged, this, [this]() {
+        if (resolveWaypoints()) {
+            emit weatherStationsChanged();
+        }
+    });
+
+    // Download the weather along the route once the route has been edited
+    connect(GlobalObject::navigator()->flightRoute(), &Navigation::FlightRoute::waypointsChanged, this, &Weather::WeatherDataProvider::onFlightRouteChanged);
+
+    // Read METAR/TAF from "weather.dat". The file is read in the background;
+    // the weather stations are then constructed in the main thread.
+    auto data = std::make_shared<QByteArray>();
+    GlobalObject::initScheduler()->addTask("weatherCache", {}, [data]() {
+        return QtConcurrent::run([data]() { *data = readCacheFile(); });
+    }, [this, data]() {
+        bool success = load(*data);
+
+        // Compute time for next update
+        auto remainingTime = QDateTime::currentDateTimeUtc().msecsTo( _lastUpdate.addMSecs(updateIntervalNormal_ms) );
+        if (!success || !_lastUpdate.isValid() || (remainingTime < 0)) {
+            update();
+        } else {
+            _updateTimer.setInterval( gsl::narrow_cast<int>(remainingTime) );
+        }
+    });
+}
 
-    // Read METAR/TAF from "weather.dat"
-    bool success = load();
 
-    // Compute time for next update
-    auto remainingTime = QDateTime::currentDateTimeUtc().msecsTo( _lastUpdate.addMSecs(updateIntervalNormal_ms) );
-    if (!success || !_lastUpdate.isValid() || (remainingTime < 0)) {
-        update();
-    } else {
-        _updateTimer.setInterval( gsl::narrow_cast<int>(remainingTime) );
+Weather::WeatherDataProvider::~WeatherDataProvider()
+{
+    if (_saveTimer.isActive()) {
+        save();
     }
 }
 
 
 void Weather::WeatherDataProvider::deleteExpiredMesages()
 {
-    QVector<QString> ICAOCodesToDelete;
+    auto now = QDateTime::currentDateTime();
+    auto later = [](const Expiration& a, const Expiration& b) { return a.time > b.time; };
+
+    bool changed = false;
+    while (!_expirations.empty() && (_expirations.front().time <= now)) {
+        std::pop_heap(_expirations.begin(), _expirations.end(), later);
+        auto ICAOCode = _expirations.back().ICAOCode;
+        _expirations.pop_back();
+        auto weatherStation = _weatherStationsByICAOCode.find(ICAOCode);
+        if (weatherStation == _weatherStationsByICAOCode.end()) {
+            continue;
+        }
 
-    foreach(auto weatherStation, _weatherStationsByICAOCode) {
-        if (weatherStation->hasMETAR()) {
-            if (weatherStation->metar()->expiration() < QDateTime::currentDateTime()) {
-                weatherStation->setMETAR(nullptr);
-            }
+        if (weatherStation->metar.has_value() && (weatherStation->metar->expiration() <= now)) {
+            weatherStation->metar.reset();
+            changed = true;
         }
-        if (weatherStation->hasTAF()) {
-            if (weatherStation->taf()->expiration() < QDateTime::currentDateTime()) {
-                weatherStation->setTAF(nullptr);
-            }
+        if (weatherStation->taf.has_value() && (weatherStation->taf->expirationTime <= now)) {
+            weatherStation->taf.reset();
+            changed = true;
         }
 
-        if (!weatherStation->hasMETAR() && !weatherStation->hasTAF()) {
-            ICAOCodesToDelete << weatherStation->ICAOCode();
-            weatherStation->deleteLater();
+        if (!weatherStation->metar.has_value() && !weatherStation->taf.has_value()) {
+            _weatherStationsByICAOCode.erase(weatherStation);
+            changed = true;
         }
     }
+    restartExpirationTimer();
 
-    // If there is nothing to delete, wonderful
-    if (ICAOCodesToDelete.isEmpty()) {
+    // If there is nothing to delete, wonderful. Otherwise, let the world know
+    if (!changed) {
         return;
     }
-
-    // Otherwiese, remove the weather stations from the list, and let the world know
-    foreach(auto ICAOCodeToDelete, ICAOCodesToDelete)
-        _weatherStationsByICAOCode.remove(ICAOCodeToDelete);
     emit weatherStationsChanged();
-    save();
+    scheduleSave();
+}
+
+
+void Weather::WeatherDataProvider::scheduleExpiration(const Weather::StationRecord& station)
+{
+    auto later = [](const Expiration& a, const Expiration& b) { return a.time > b.time; };
+    auto push = [&](const QDateTime& time) {
+        _expirations.push_back({time, station.ICAOCode});
+        std::push_heap(_expirations.begin(), _expirations.end(), later);
+    };
+
+    if (station.metar.has_value()) {
+        push(station.metar->expiration());
+    }
+    if (station.taf.has_value()) {
+        push(station.taf->expirationTime);
+    }
+    if (!station.metar.has_value() && !station.taf.has_value()) {
+        push(QDateTime::currentDateTime());
+    }
+    restartExpirationTimer();
+}
+
+
+void Weather::WeatherDataProvider::restartExpirationTimer()
+{
+    if (_expirations.empty()) {
+        _deleteExiredMessagesTimer.stop();
+        return;
+    }
+
+    // QTimer takes an int. Reports never live for more than a few days, and
+    // the timer will simply be restarted if the limit is ever reached.
+    auto msecs = QDateTime::currentDateTime().msecsTo(_expirations.front().time);
+    _deleteExiredMessagesTimer.start(gsl::narrow_cast<int>(qBound(static_cast<qint64>(0), msecs, static_cast<qint64>(24*60*60*1000))));
+}
+
+
+void Weather::WeatherDataProvider::scheduleSave()
+{
+    if (!_saveTimer.isActive()) {
+        _saveTimer.start();
+    }
 }
 
 
@@ -140,6 +241,7 @@ auto Weather::WeatherDataProvider::downloading() const -> bool
 
 
 void Weather::WeatherDataProvider::downloadFinished() {
+    PROFILER_SCOPE(Profiler::Weather);
 
     // Start to process the data only once ALL replies have been received. So, we check here if there are any running
     // download processes and abort if indeed there are some.
@@ -150,8 +252,10 @@ void Weather::WeatherDataProvider::downloadFinished() {
     // Update flag
     emit downloadingChanged();
 
-    // Read all replies and store the data in respective maps
+    // Read all replies. Parsing and decoding is expensive and done in a
+    // worker thread.
     bool hasError = false;
+    QVector<QByteArray> replies;
     foreach(auto networkReply, _networkReplies) {
         // Paranoid safety checks
         if (networkReply.isNull()) {
@@ -163,90 +267,227 @@ void Weather::WeatherDataProvider::downloadFinished() {
             continue;
         }
 
-        // Decode XML
-        QXmlStreamReader xml(networkReply);
+        // Remember validators for conditional requests. If the server tells us
+        // that nothing has changed, then there is nothing to read.
+        auto url = networkReply->request().url();
+        auto dataSource = QUrlQuery(url).queryItemValue(QStringLiteral("dataSource"));
+        if (networkReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+            continue;
+        }
+        _cacheValidators[dataSource] = {url, networkReply->rawHeader("ETag"), networkReply->rawHeader("Last-Modified")};
+
+        replies.append(networkReply->readAll());
+    }
+
+    // Clear replies container
+    qDeleteAll(_networkReplies);
+    _networkReplies.clear();
+
+    if (replies.isEmpty()) {
+        processReports({}, hasError);
+        return;
+    }
+
+    auto* watcher = new QFutureWatcher<Reports>(this);
+    connect(watcher, &QFutureWatcher<Reports>::finished, this, [this, watcher, hasError]() {
+        processReports(watcher->result(), hasError);
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(&Weather::WeatherDataProvider::readReplies, replies, GlobalObject::geoMapProvider()->aviationData()));
+}
+
+
+auto Weather::WeatherDataProvider::readReplies(const QVector<QByteArray>& replies, const std::shared_ptr<const GeoMaps::AviationData>& aviationData) -> Reports
+{
+    METRICS_TIME_SCOPE("weather/decode");
+    PROFILER_SCOPE(Profiler::Weather);
+    Reports result;
+    for(const auto& reply : replies) {
+        QXmlStreamReader xml(reply);
         while (!xml.atEnd() && !xml.hasError())
         {
             xml.readNext();
 
             // Read METAR
-            if (xml.isStartElement() && (xml.name() == "METAR")) {
-                auto *metar = new Weather::METAR(xml, this);
-                findOrConstructWeatherStation(metar->ICAOCode())->setMETAR(metar);
+            if (xml.isStartElement() && (xml.name() == QLatin1String("METAR"))) {
+                result.metars.append(Weather::METAR::readXML(xml));
             }
 
             // Read TAF
-            if (xml.isStartElement() && (xml.name() == "TAF")) {
-                auto *taf = new Weather::TAF(xml, this);
-                findOrConstructWeatherStation(taf->ICAOCode())->setTAF(taf);
+            if (xml.isStartElement() && (xml.name() == QLatin1String("TAF"))) {
+                result.tafs.append(Weather::TAF::readXML(xml));
             }
+        }
+    }
+
+    // Parsing the messages is the expensive part. Spread it over all cores.
+    QtConcurrent::blockingMap(result.metars, &Weather::METAR::decode);
+    QtConcurrent::blockingMap(result.tafs, &Weather::TAF::decode);
 
+    // Look up waypoints for all stations, through the ICAO index
+    if (aviationData) {
+        auto resolve = [&](const QString& ICAOCode) {
+            if (result.waypoints.contains(ICAOCode)) {
+                return;
+            }
+            auto waypoint = aviationData->findByID(ICAOCode);
+            if (waypoint.isValid()) {
+                result.waypoints.insert(ICAOCode, waypoint);
+            }
+        };
+        for(const auto& metar : qAsConst(result.metars)) {
+            resolve(metar.ICAOCode);
+        }
+        for(const auto& taf : qAsConst(result.tafs)) {
+            resolve(taf.ICAOCode);
         }
     }
+    return result;
+}
 
-    // Clear replies container
-    qDeleteAll(_networkReplies);
-    _networkReplies.clear();
+
+void Weather::WeatherDataProvider::processReports(const Reports& reports, bool hasError)
+{
+    PROFILER_SCOPE(Profiler::Weather);
+    // Store only those reports that have actually changed
+    for(const auto& data : reports.metars) {
+        auto& station = findOrConstructWeatherStation(data.ICAOCode);
+        if (station.metar.has_value() && (station.metar->rawText == data.rawText)) {
+            continue;
+        }
+        station.setMETAR(data);
+        scheduleExpiration(station);
+    }
+    for(const auto& data : reports.tafs) {
+        auto& station = findOrConstructWeatherStation(data.ICAOCode);
+        if (station.taf.has_value() && (station.taf->rawText == data.rawText)) {
+            continue;
+        }
+        station.setTAF(data);
+        scheduleExpiration(station);
+    }
+
+    // Set waypoint data that has been found in the worker thread. Look up
+    // the remaining stations, in case the aviation data has changed in the
+    // meantime.
+    for(auto it = reports.waypoints.constBegin(); it != reports.waypoints.constEnd(); ++it) {
+        auto weatherStation = _weatherStationsByICAOCode.find(it.key());
+        if (weatherStation != _weatherStationsByICAOCode.end()) {
+            weatherStation->setWaypoint(it.value());
+        }
+    }
+    resolveWaypoints();
 
     // Update flag and signals
     emit weatherStationsChanged();
-    emit QNHInfoChanged();
 
     if (hasError) {
         _updateTimer.setInterval(updateIntervalOnError_ms);
     } else {
         _lastUpdate = QDateTime::currentDateTimeUtc();
         _updateTimer.setInterval(updateIntervalNormal_ms);
-        save();
+        scheduleSave();
     }
 }
 
 
-auto Weather::WeatherDataProvider::findOrConstructWeatherStation(const QString &ICAOCode) -> Weather::Station *
+auto Weather::WeatherDataProvider::findOrConstructWeatherStation(const QString &ICAOCode) -> Weather::StationRecord&
 {
-    auto weatherStationPtr = _weatherStationsByICAOCode.value(ICAOCode, nullptr);
+    auto weatherStation = _weatherStationsByICAOCode.find(ICAOCode);
+    if (weatherStation != _weatherStationsByICAOCode.end()) {
+        return *weatherStation;
+    }
+
+    Weather::StationRecord newWeatherStation;
+    newWeatherStation.ICAOCode = ICAOCode;
+    newWeatherStation.extendedName = ICAOCode;
+    newWeatherStation.twoLineTitle = ICAOCode;
+    return *_weatherStationsByICAOCode.insert(ICAOCode, newWeatherStation);
+}
+
 
-    if (!weatherStationPtr.isNull()) {
-        return weatherStationPtr;
+auto Weather::WeatherDataProvider::findWeatherStation(const QString &ICAOCode) -> Weather::Station *
+{
+    auto weatherStation = _weatherStationsByICAOCode.constFind(ICAOCode);
+    if (weatherStation == _weatherStationsByICAOCode.constEnd()) {
+        return nullptr;
     }
 
-    auto *newWeatherStation = new Weather::Station(ICAOCode, GlobalObject::geoMapProvider(), this);
-    _weatherStationsByICAOCode.insert(ICAOCode, newWeatherStation);
-    return newWeatherStation;
+    auto stationObject = _stationObjects.value(ICAOCode);
+    if (stationObject.isNull()) {
+        stationObject = new Weather::Station(*weatherStation, nullptr);
+        QQmlEngine::setObjectOwnership(stationObject, QQmlEngine::JavaScriptOwnership);
+        _stationObjects.insert(ICAOCode, stationObject);
+    }
+    return stationObject;
 }
 
 
-auto Weather::WeatherDataProvider::load() -> bool
+auto Weather::WeatherDataProvider::resolveWaypoints() -> bool
 {
+    QStringList ICAOCodes;
+    foreach(const auto& weatherStation, _weatherStationsByICAOCode) {
+        if (weatherStation.hasWaypointData) {
+            continue;
+        }
+        ICAOCodes << weatherStation.ICAOCode;
+    }
+    if (ICAOCodes.isEmpty()) {
+        return false;
+    }
+
+    bool changed = false;
+    auto waypoints = GlobalObject::geoMapProvider()->findByIDs(ICAOCodes);
+    for(auto it = waypoints.constBegin(); it != waypoints.constEnd(); ++it) {
+        auto weatherStation = _weatherStationsByICAOCode.find(it.key());
+        if ((weatherStation != _weatherStationsByICAOCode.end()) && it.value().isValid()) {
+            weatherStation->setWaypoint(it.value());
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+
+auto Weather::WeatherDataProvider::readCacheFile() -> QByteArray
+{
+    TRACE_SCOPE("WeatherDataProvider::readCacheFile");
     auto stdFileName = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)+"/weather.dat";
 
     // Use LockFile. If lock could not be obtained, do nothing.
     QLockFile lockFile(stdFileName+".lock");
     if (!lockFile.tryLock()) {
-        return false;
+        return {};
     }
 
     // Open file
     auto inputFile = QFile(stdFileName);
     if (!inputFile.open(QIODevice::ReadOnly)) {
         lockFile.unlock();
-        return false;
+        return {};
     }
+    auto result = inputFile.readAll();
+    lockFile.unlock();
+    return result;
+}
+
+
+auto Weather::WeatherDataProvider::load(const QByteArray& data) -> bool
+{
+    TRACE_SCOPE("WeatherDataProvider::load");
 
     // Generate input stream
-    QDataStream inputStream(&inputFile);
-    inputStream.setVersion(QDataStream::Qt_4_0);
+    QDataStream inputStream(data);
+    inputStream.setVersion(QDataStream::Qt_5_15);
     // Check magic number and version
     quint32 magic = 0;
     inputStream >> magic;
     if (magic != static_cast<quint32>(0x31415)) {
-        lockFile.unlock();
         return false;
     }
     quint32 version = 0;
     inputStream >> version;
-    if (version != static_cast<quint32>(1)) {
-        lockFile.unlock();
+    if (version != cacheFileVersion) {
         return false;
     }
 
@@ -261,14 +502,18 @@ auto Weather::WeatherDataProvider::load() -> bool
 
         if (type == 'M') {
             // Read METAR
-            auto *metar = new Weather::METAR(inputStream, this);
-            findOrConstructWeatherStation(metar->ICAOCode())->setMETAR(metar);
+            auto metar = Weather::METAR::read(inputStream);
+            auto& station = findOrConstructWeatherStation(metar.ICAOCode);
+            station.setMETAR(metar);
+            scheduleExpiration(station);
             continue;
         }
         if (type == 'T') {
             // Read TAF
-            auto *taf = new Weather::TAF(inputStream, this);
-            findOrConstructWeatherStation(taf->ICAOCode())->setTAF(taf);
+            auto taf = Weather::TAF::read(inputStream);
+            auto& station = findOrConstructWeatherStation(taf.ICAOCode);
+            station.setTAF(taf);
+            scheduleExpiration(station);
             continue;
         }
 
@@ -278,7 +523,7 @@ auto Weather::WeatherDataProvider::load() -> bool
     }
 
     // Ok, done
-    lockFile.unlock();
+    resolveWaypoints();
     deleteExpiredMesages();
     emit weatherStationsChanged();
 
@@ -305,32 +550,28 @@ void Weather::WeatherDataProvider::save()
 
     // Generate output stream
     QDataStream outputStream(&outputFile);
-    outputStream.setVersion(QDataStream::Qt_4_0);
+    outputStream.setVersion(QDataStream::Qt_5_15);
 
     // Write magic number and version
     outputStream << static_cast<quint32>(0x31415);
-    outputStream << static_cast<quint32>(1);
+    outputStream << cacheFileVersion;
     outputStream << _lastUpdate;
 
     // Write data
-    foreach(auto weatherStation, _weatherStationsByICAOCode) {
-        if (weatherStation.isNull()) {
-            continue;
-        }
-
-        if (weatherStation->hasMETAR()) {
+    foreach(const auto& weatherStation, _weatherStationsByICAOCode) {
+        if (weatherStation.metar.has_value()) {
             // Save only valid METARs that are not yet expired
-            if (weatherStation->metar()->isValid() && !weatherStation->metar()->isExpired()) {
+            if (weatherStation.metar->isValid() && !weatherStation.metar->isExpired()) {
                 outputStream << QChar('M');
-                weatherStation->metar()->write(outputStream);
+                Weather::METAR::write(outputStream, *weatherStation.metar);
             }
         }
 
-        if (weatherStation->hasTAF()) {
+        if (weatherStation.taf.has_value()) {
             // Save only valid TAFs that are not yet expired
-            if (weatherStation->taf()->isValid() && !weatherStation->taf()->isExpired()) {
+            if (weatherStation.taf->isValid() && !weatherStation.taf->isExpired()) {
                 outputStream << QChar('T');
-                weatherStation->taf()->write(outputStream);
+                Weather::TAF::write(outputStream, *weatherStation.taf);
             }
         }
     }
@@ -340,28 +581,87 @@ void Weather::WeatherDataProvider::save()
 }
 
 
-auto Weather::WeatherDataProvider::sunInfo() -> QString
+void Weather::WeatherDataProvider::onFlightRouteChanged()
+{
+    if (GlobalObject::navigator()->flightRoute()->geoPath().isEmpty()) {
+        return;
+    }
+    _briefingTimer.start();
+}
+
+
+void Weather::WeatherDataProvider::invalidateQNHInfo()
+{
+    _QNHInfoValid = false;
+    emit QNHInfoChanged();
+}
+
+
+void Weather::WeatherDataProvider::invalidateSunInfo()
 {
+    _sunInfoValid = false;
+    emit sunInfoChanged();
+}
+
+
+auto Weather::WeatherDataProvider::sunInfo() const -> QString
+{
+    if (_sunInfoValid) {
+        return _sunInfo;
+    }
+
     // Paranoid safety checks
     auto *positionProvider = GlobalObject::positionProvider();
     if (positionProvider == nullptr) {
         return QString();
     }
     if (!positionProvider->positionInfo().isValid()) {
-        return tr("Waiting for precise position…");
+        _sunInfo = tr("Waiting for precise position…");
+        _sunInfoValid = true;
+        return _sunInfo;
     }
 
-    // Describe next sunset/sunrise
-    QDateTime sunrise;
-    QDateTime sunset;
-    QDateTime sunriseTomorrow;
-
-    SunSet sun;
     auto coord = positionProvider->positionInfo().coordinate();
     auto timeZone = qRound(coord.longitude()/15.0);
-
     auto currentTime = QDateTime::currentDateTimeUtc();
     auto localTime = currentTime.toOffsetFromUtc(timeZone*60*60);
+
+    // Compute sunrise and sunset again only if date or position have changed significantly
+    if ((_sunEvents.localDate != localTime.date())
+            || !_sunEvents.position.isValid()
+            || (_sunEvents.position.distanceTo(coord) > sunEventsDistance_m)) {
+        _sunEvents = computeSunEvents(coord, localTime);
+    }
+    const auto& sunrise = _sunEvents.sunrise;
+    const auto& sunset = _sunEvents.sunset;
+    const auto& sunriseTomorrow = _sunEvents.sunriseTomorrow;
+
+    _sunInfo.clear();
+    if (sunrise.isValid() && sunset.isValid() && sunriseTomorrow.isValid()) {
+        if (currentTime < sunrise) {
+            _sunInfo = tr("SR %1, %2").arg(Navigation::Clock::describePointInTime(sunrise), Navigation::Clock::describeTimeDifference(sunrise));
+        } else if (currentTime < sunset.addSecs(40*60)) {
+            _sunInfo = tr("SS %1, %2").arg(Navigation::Clock::describePointInTime(sunset), Navigation::Clock::describeTimeDifference(sunset));
+        } else {
+            _sunInfo = tr("SR %1, %2").arg(Navigation::Clock::describePointInTime(sunriseTomorrow), Navigation::Clock::describeTimeDifference(sunriseTomorrow));
+        }
+    }
+    _sunInfoValid = true;
+    return _sunInfo;
+}
+
+
+auto Weather::WeatherDataProvider::computeSunEvents(const QGeoCoordinate& coord, QDateTime localTime) -> SunEvents
+{
+    SunEvents result;
+    result.position = coord;
+    result.localDate = localTime.date();
+    auto& sunrise = result.sunrise;
+    auto& sunset = result.sunset;
+    auto& sunriseTomorrow = result.sunriseTomorrow;
+
+    SunSet sun;
+    auto timeZone = qRound(coord.longitude()/15.0);
     auto localDate = localTime.date();
 
     sun.setPosition(coord.latitude(), coord.longitude(), timeZone);
@@ -393,65 +693,51 @@ auto Weather::WeatherDataProvider::sunInfo() -> QString
         sunriseTomorrow = sunriseTomorrow.toOffsetFromUtc(0);
         sunriseTomorrow.setTimeSpec(Qt::UTC);
     }
-
-    if (sunrise.isValid() && sunset.isValid() && sunriseTomorrow.isValid()) {
-        if (currentTime < sunrise) {
-            return tr("SR %1, %2").arg(Navigation::Clock::describePointInTime(sunrise), Navigation::Clock::describeTimeDifference(sunrise));
-        }
-        if (currentTime < sunset.addSecs(40*60)) {
-            return tr("SS %1, %2").arg(Navigation::Clock::describePointInTime(sunset), Navigation::Clock::describeTimeDifference(sunset));
-        }
-        return tr("SR %1, %2").arg(Navigation::Clock::describePointInTime(sunriseTomorrow), Navigation::Clock::describeTimeDifference(sunriseTomorrow));
-    }
-    return QString();
+    return result;
 }
 
 
 auto Weather::WeatherDataProvider::QNHInfo() const -> QString
 {
+    if (_QNHInfoValid) {
+        return _QNHInfo;
+    }
+
     // Paranoid safety checks
     auto *positionProvider = GlobalObject::positionProvider();
     if (positionProvider == nullptr) {
         return QString();
     }
 
-    // Find QNH of nearest airfield
-    Weather::Station *closestReportWithQNH = nullptr;
-    int QNH = 0;
-    foreach(auto weatherStationPtr, _weatherStationsByICAOCode) {
-        if (weatherStationPtr.isNull()) {
-            continue;
-        }
-        if (weatherStationPtr->metar() == nullptr) {
-            continue;
-        }
-        QNH = weatherStationPtr->metar()->QNH();
-        if (QNH == 0) {
+    // Find QNH of nearest airfield. The list of weather stations is already
+    // sorted by distance.
+    const Weather::StationRecord* closestReportWithQNH = nullptr;
+    for(const auto& weatherStation : sortedWeatherStations()) {
+        if (!weatherStation.metar.has_value()) {
             continue;
         }
-        if (!weatherStationPtr->coordinate().isValid()) {
+        if (weatherStation.metar->qnh == 0) {
             continue;
         }
-        if (closestReportWithQNH == nullptr) {
-            closestReportWithQNH = weatherStationPtr;
+        if (!weatherStation.coordinate.isValid()) {
             continue;
         }
-
-        QGeoCoordinate here = Positioning::PositionProvider::lastValidCoordinate();
-        if (here.distanceTo(weatherStationPtr->coordinate()) < here.distanceTo(closestReportWithQNH->coordinate())) {
-            closestReportWithQNH = weatherStationPtr;
-        }
+        closestReportWithQNH = &weatherStation;
+        break;
     }
+    _QNHInfo.clear();
     if (closestReportWithQNH != nullptr) {
-        return tr("QNH: %1 hPa in %2, %3").arg(closestReportWithQNH->metar()->QNH())
-                .arg(closestReportWithQNH->ICAOCode(),
-                     Navigation::Clock::describeTimeDifference(closestReportWithQNH->metar()->observationTime()));
+        _QNHInfo = tr("QNH: %1 hPa in %2, %3").arg(closestReportWithQNH->metar->qnh)
+                .arg(closestReportWithQNH->ICAOCode,
+                     Navigation::Clock::describeTimeDifference(closestReportWithQNH->metar->observationTime));
     }
-    return QString();
+    _QNHInfoValid = true;
+    return _QNHInfo;
 }
 
 
 void Weather::WeatherDataProvider::update(bool isBackgroundUpdate) {
+    PROFILER_SCOPE(Profiler::Weather);
 
     // Refuse to do anything if we are not allowed to connect to the Aviation Weather Center
     if (!Settings::acceptedWeatherTermsStatic()) {
@@ -477,28 +763,42 @@ void Weather::WeatherDataProvider::update(bool isBackgroundUpdate) {
     qDeleteAll(_networkReplies);
     _networkReplies.clear();
 
-    // Generate queries
+    // Generate queries. Radial and route queries used to be separate
+    // requests. Instead, the current position is made the first point of the
+    // flight path, so that one request per data source covers both. The
+    // position is rounded to 0.1°, which is small compared to the 85nm
+    // corridor, so that the URL remains the same while the aircraft does not
+    // move much and conditional requests can succeed.
     const QGeoCoordinate& position = Positioning::PositionProvider::lastValidCoordinate();
     const QVariantList& steerpts = GlobalObject::navigator()->flightRoute()->geoPath();
-    QList<QString> queries;
+    QString qpos;
     if (position.isValid()) {
-        queries.push_back(QString("dataSource=metars&radialDistance=85;%1,%2").arg(position.longitude()).arg(position.latitude()));
-        queries.push_back(QString("dataSource=tafs&radialDistance=85;%1,%2").arg(position.longitude()).arg(position.latitude()));
+        qpos += ";" + QString::number(qRound(position.longitude()*10.0)/10.0) + "," + QString::number(qRound(position.latitude()*10.0)/10.0);
     }
-    if (!steerpts.empty()) {
-        QString qpos;
-        foreach(auto var, steerpts) {
-            auto posit = var.value<QGeoCoordinate>();
-            qpos += ";" + QString::number(posit.longitude()) + "," + QString::number(posit.latitude());
-        }
-        queries.push_back(QString("dataSource=metars&flightPath=85%1").arg(qpos));
-        queries.push_back(QString("dataSource=tafs&flightPath=85%1").arg(qpos));
+    foreach(auto var, steerpts) {
+        auto posit = var.value<QGeoCoordinate>();
+        qpos += ";" + QString::number(posit.longitude()) + "," + QString::number(posit.latitude());
+    }
+    QList<QString> dataSources;
+    if (!qpos.isEmpty()) {
+        dataSources << QStringLiteral("metars") << QStringLiteral("tafs");
     }
 
-    // Fetch data
-    foreach(auto query, queries) {
-        QUrl url = QUrl(QString("https://www.aviationweather.gov/adds/dataserver_current/httpparam?requestType=retrieve&format=xml&hoursBeforeNow=1&mostRecentForEachStation=true&%1").arg(query));
+    // Fetch data. There is no need to set the header "Accept-Encoding" here:
+    // QNetworkAccessManager asks for gzip and decompresses transparently, but
+    // only as long as the header is not set manually.
+    foreach(auto dataSource, dataSources) {
+        QUrl url = QUrl(QString("https://www.aviationweather.gov/adds/dataserver_current/httpparam?requestType=retrieve&format=xml&hoursBeforeNow=1&mostRecentForEachStation=true&dataSource=%1&flightPath=85%2").arg(dataSource, qpos));
         QNetworkRequest request(url);
+        auto validator = _cacheValidators.value(dataSource);
+        if (validator.url == url) {
+            if (!validator.eTag.isEmpty()) {
+                request.setRawHeader("If-None-Match", validator.eTag);
+            }
+            if (!validator.lastModified.isEmpty()) {
+                request.setRawHeader("If-Modified-Since", validator.lastModified);
+            }
+        }
         QPointer<QNetworkReply> reply = GlobalObject::networkAccessManager()->get(request);
         _networkReplies.push_back(reply);
         connect(reply, &QNetworkReply::finished, this, &Weather::WeatherDataProvider::downloadFinished);
@@ -511,22 +811,86 @@ void Weather::WeatherDataProvider::update(bool isBackgroundUpdate) {
 }
 
 
-auto Weather::WeatherDataProvider::weatherStations() const -> QList<Weather::Station *> {
+auto Weather::WeatherDataProvider::sortedWeatherStations() const -> const QVector<Weather::StationRecord>&
+{
+    if (_sortedWeatherStationsValid) {
+        return _sortedWeatherStations;
+    }
+
+    // Compute all distances once, instead of twice per comparison
+    _sortPosition = Positioning::PositionProvider::lastValidCoordinate();
+    QVector<QPair<double, const Weather::StationRecord*>> stationsByDistance;
+    stationsByDistance.reserve(_weatherStationsByICAOCode.size());
+    for(const auto& station : _weatherStationsByICAOCode) {
+        stationsByDistance.append({_sortPosition.distanceTo(station.coordinate), &station});
+    }
+    std::sort(stationsByDistance.begin(), stationsByDistance.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    _sortedWeatherStations.clear();
+    _sortedWeatherStations.reserve(stationsByDistance.size());
+    for(const auto& entry : stationsByDistance) {
+        _sortedWeatherStations.append(*entry.second);
+    }
+    _sortedWeatherStationsValid = true;
+    return _sortedWeatherStations;
+}
 
-    // Produce a list of reports, without nullpointers
-    QList<Weather::Station *> sortedReports;
-    foreach(auto stations, _weatherStationsByICAOCode)
-        if (!stations.isNull()) {
-            sortedReports += stations;
+
+void Weather::WeatherDataProvider::onWeatherStationsChanged()
+{
+    _sortedWeatherStationsValid = false;
+    _stationListModel.setStations(sortedWeatherStations());
+
+    // Update the station objects that are still alive
+    for(auto it = _stationObjects.begin(); it != _stationObjects.end(); ) {
+        if (it.value().isNull()) {
+            it = _stationObjects.erase(it);
+            continue;
+        }
+        auto weatherStation = _weatherStationsByICAOCode.constFind(it.key());
+        if (weatherStation != _weatherStationsByICAOCode.constEnd()) {
+            it.value()->setRecord(*weatherStation);
+        } else {
+            Weather::StationRecord emptyStation;
+            emptyStation.ICAOCode = it.key();
+            emptyStation.coordinate = it.value()->coordinate();
+            emptyStation.extendedName = it.value()->extendedName();
+            emptyStation.icon = it.value()->icon();
+            emptyStation.twoLineTitle = it.value()->twoLineTitle();
+            it.value()->setRecord(emptyStation);
         }
+        ++it;
+    }
+}
 
-    // Sort list
-    auto compare = [&](const Weather::Station *a, const Weather::Station *b) {
-        QGeoCoordinate here = Positioning::PositionProvider::lastValidCoordinate();
-        return here.distanceTo(a->coordinate()) < here.distanceTo(b->coordinate());
-    };
-    std::sort(sortedReports.begin(), sortedReports.end(), compare);
 
-    return sortedReports;
+void Weather::WeatherDataProvider::onLastValidCoordinateChanged(const QGeoCoordinate& coordinate)
+{
+    if (!_sortedWeatherStationsValid) {
+        return;
+    }
+    if (_sortPosition.isValid() && coordinate.isValid() && (_sortPosition.distanceTo(coordinate) < resortDistance_m)) {
+        return;
+    }
+    emit weatherStationsChanged();
 }
 
+
+void Weather::WeatherDataProvider::releaseMemory()
+{
+    static auto* releasedMetric = Metrics::counter(QStringLiteral("memory/weather/bytesReleased"));
+
+    qint64 size = 0;
+    foreach(auto station, _stationObjects) {
+        if (station.isNull()) {
+            continue;
+        }
+        if (station->metar() != nullptr) {
+            size += station->metar()->releaseDecodedText();
+        }
+        if (station->taf() != nullptr) {
+            size += station->taf()->releaseDecodedText();
+        }
+    }
+    releasedMetric->add(size);
+}
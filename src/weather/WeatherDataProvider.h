@@ -20,21 +20,30 @@
 
 #pragma once
 
+#include <QHash>
 #include <QMap>
 #include <QPointer>
 #include <QTimer>
+#include <QUrl>
+#include <memory>
+#include <vector>
 
 class QNetworkAccessManager;
 class QNetworkReply;
 
 #include "positioning/PositionProvider.h"
 #include "weather/Station.h"
+#include "weather/StationListModel.h"
 
 class Clock;
 class FlightRoute;
 class GeoMapProvider;
 class Settings;
 
+namespace GeoMaps {
+class AviationData;
+}
+
 namespace Weather {
 
 /*! \brief WeatherDataProvider, weather service manager
@@ -42,8 +51,10 @@ namespace Weather {
  * This class retrieves METAR/TAF weather reports from the "Aviation Weather
  * Center" at aviationweather.com, for all weather stations that are within 75nm
  * from the last-known user position or current route.  The reports can then be
- * accessed via the property "weatherStations" and the method
- * findWeatherStation.  The WeatherDataProvider class honors
+ * accessed via the list model in the property "weatherStations" and the method
+ * findWeatherStation. Stations are stored as plain values of type
+ * StationRecord; QObjects are constructed only for stations that are shown
+ * in detail.  The WeatherDataProvider class honors
  * GlobalSettings::acceptedWeatherTerms() and will initiate a download only if
  * the user agreed to the privacy warning.
  *
@@ -73,6 +84,13 @@ public:
      */
     explicit WeatherDataProvider(QObject *parent = nullptr);
 
+    /*! \brief Standard destructor
+     *
+     * If saving the weather data to disk is still pending, the data is saved
+     * before the object is destroyed.
+     */
+    ~WeatherDataProvider() override;
+
     //
     // Properties
     //
@@ -104,22 +122,18 @@ public:
 
     /*! \brief Find WeatherStation by ICAO code
      *
-     * This method returns a pointer to the WeatherStation with the given ICAO
+     * This method returns a pointer to a WeatherStation with the given ICAO
      * code, or a nullptr if no WeatherStation with the given code is known to
-     * the WeatherDataProvider.
-     *
-     * @warning The WeatherStation objects are owned by the WeatherDataProvider and
-     * can be deleted anytime.  Store it in a QPointer to avoid dangling
-     * pointers.
+     * the WeatherDataProvider. The object is constructed when it is first
+     * requested and has no parent, so that QML takes ownership. For as long
+     * as it exists, the same object is returned for the same ICAO code, and
+     * it is updated whenever new reports arrive.
      *
      * @param ICAOCode ICAO code name of the WeatherStation, such as "EDDF"
      *
      * @returns Pointer to WeatherStation
      */
-    Q_INVOKABLE Weather::Station *findWeatherStation(const QString &ICAOCode) const
-    {
-        return _weatherStationsByICAOCode.value(ICAOCode, nullptr);
-    }
+    Q_INVOKABLE Weather::Station *findWeatherStation(const QString &ICAOCode);
 
     /*! \brief QNHInfo
      *
@@ -127,6 +141,9 @@ public:
      * information about the QNH of the nearest weather station.  This could
      * typically read like "QNH: 1019 hPa in LFGA, 4min ago".  If no information
      * is available, the property holds an empty string.
+     *
+     * The string is cached. It is computed again only after the weather
+     * stations have changed, the position has moved or the minute has changed.
      */
     Q_PROPERTY(QString QNHInfo READ QNHInfo NOTIFY QNHInfoChanged)
 
@@ -142,6 +159,10 @@ public:
      * information about the next sunset or sunrise at the current position. This
      * could typically read like "SS 17:01, in 3h and 5min" or "Waiting for exact
      * position …"
+     *
+     * The string is cached and computed again after every minute change. The
+     * solar calculation is done again only if the date has changed or the
+     * position has moved by more than sunEventsDistance_m.
      */
     Q_PROPERTY(QString sunInfo READ sunInfo NOTIFY sunInfoChanged)
 
@@ -149,7 +170,7 @@ public:
      *
      * @returns Property infoString
      */
-    static QString sunInfo() ;
+    QString sunInfo() const;
 
     /*! \brief Update method
      *
@@ -174,22 +195,25 @@ public:
 
     /*! \brief List of weather stations
      *
-     * This property holds a list of all weather stations that are currently
-     * known to this instance of the WeatherDataProvider class, sorted according to
-     * the distance to the last known position.  The list can change at any
-     * time.
+     * This property holds a list model of all weather stations that are
+     * currently known to this instance of the WeatherDataProvider class,
+     * sorted according to the distance to the last known position.  The
+     * content of the model can change at any time.
      *
-     * @warning The WeatherStation objects are owned by the WeatherDataProvider and
-     * can be deleted anytime. Store it in a QPointer to avoid dangling
-     * pointers.
+     * The stations are sorted again only when the set of weather stations
+     * changes, or when the last known position has moved by more than one
+     * kilometer.
      */
-    Q_PROPERTY(QList<Weather::Station *> weatherStations READ weatherStations NOTIFY weatherStationsChanged)
+    Q_PROPERTY(Weather::StationListModel* weatherStations READ weatherStations CONSTANT)
 
     /*! \brief Getter method for property of the same name
      *
      * @returns Property weatherStations
      */
-    QList<Weather::Station *> weatherStations() const;
+    Weather::StationListModel* weatherStations()
+    {
+        return &_stationListModel;
+    }
 
 signals:
     /*! \brief Notifier signal */
@@ -220,8 +244,9 @@ private slots:
     // Called when a download is finished
     void downloadFinished();
 
-    // Check for expired METARs and TAFs and delete them.
-    // This also deletes weather stations if they are no longer in use.
+    // Check for expired METARs and TAFs and delete them. Only those stations
+    // are checked whose entries in _expirations are due. This also deletes
+    // weather stations if they are no longer in use.
     void deleteExpiredMesages();
 
     // Name says it all. This method is called from the constructor,
@@ -229,6 +254,27 @@ private slots:
     // static objects.
     void deferredInitialization();
 
+    // Marks the sorted list of weather stations as outdated and emits
+    // weatherStationsChanged if the position has moved by more than
+    // resortDistance_m since the list was last sorted
+    void onLastValidCoordinateChanged(const QGeoCoordinate& coordinate);
+
+    // Releases the decoded texts of all METARs and TAFs of the stations shown
+    // in detail, when the platform reports that memory runs low
+    void releaseMemory();
+
+    // Sorts the stations again, and updates the list model and all station
+    // objects handed out by findWeatherStation()
+    void onWeatherStationsChanged();
+
+    // Starts _briefingTimer, so that the weather along a modified flight
+    // route is downloaded soon
+    void onFlightRouteChanged();
+
+    // Mark cached strings as invalid and emit the notifier signals
+    void invalidateQNHInfo();
+    void invalidateSunInfo();
+
 private:
     Q_DISABLE_COPY_MOVE(WeatherDataProvider)
 
@@ -236,15 +282,66 @@ private:
     static const int updateIntervalNormal_ms  = 30*60*1000;
     static const int updateIntervalOnError_ms =  5*60*1000;
 
-    // Similar to findWeatherStation, but will create a weather station if no
-    // station with the given code is known
-    Weather::Station *findOrConstructWeatherStation(const QString &ICAOCode);
-
-    // This method loads METAR/TAFs from a file "weather.dat" in
+    // Version of the file format used by load() and save(). Version 2 stores
+    // the metadata of the parser, so that the reports need not be parsed
+    // when the file is loaded. Version 3 also stores the current weather of
+    // METARs, which is shown in the list of stations.
+    static constexpr quint32 cacheFileVersion = 3;
+
+    // METARs and TAFs, as read from the replies of aviationweather.com by
+    // readReplies(). The plain values are moved to the main thread in one
+    // batch. The waypoints that match the ICAO codes of the reports are
+    // looked up in the worker thread as well.
+    struct Reports {
+        QVector<Weather::METAR::Data> metars;
+        QVector<Weather::TAF::Data> tafs;
+        QHash<QString, GeoMaps::Waypoint> waypoints;
+    };
+
+    // Reads and decodes all METARs and TAFs contained in the replies, and
+    // looks up the matching waypoints in the ICAO index of aviationData. This
+    // method is thread-safe and is run in a worker thread. The messages are
+    // parsed in parallel, using the global thread pool.
+    static Reports readReplies(const QVector<QByteArray>& replies, const std::shared_ptr<const GeoMaps::AviationData>& aviationData);
+
+    // Stores the reports in the station records, emits the notifier signals
+    // and saves the data. This method is called in the
+    // main thread, once the worker thread has finished.
+    void processReports(const Reports& reports, bool hasError);
+
+    // Adds the expiration times of the reports of the station to
+    // _expirations, and restarts the timer. If the station has no reports,
+    // it is scheduled for deletion right away.
+    void scheduleExpiration(const Weather::StationRecord& station);
+
+    // Starts _deleteExiredMessagesTimer so that it fires at the earliest
+    // expiration time in _expirations
+    void restartExpirationTimer();
+
+    // Calls save() with a little delay. Several calls in short succession
+    // result in a single write.
+    void scheduleSave();
+
+    // Returns the record of the weather station with the given code, and
+    // creates one if no station with the given code is known
+    Weather::StationRecord& findOrConstructWeatherStation(const QString &ICAOCode);
+
+    // Looks up the waypoints for all weather stations that have no waypoint
+    // data yet. All lookups are done in one call to GeoMapProvider::findByIDs.
+    // Returns true if any station has changed.
+    bool resolveWaypoints();
+
+    // This method reads the file "weather.dat" in
     // QStandardPaths::AppDataLocation.  There is locking to ensure that no two
-    // processes access the file. The method will fail silently on error.
-    // Returns true on success and false on failure.
-    bool load();
+    // processes access the file. The method will fail silently on error and
+    // return an empty array. This method is thread-safe and is meant to be
+    // run in a worker thread.
+    static QByteArray readCacheFile();
+
+    // This method loads METAR/TAFs from the content of the file "weather.dat",
+    // as returned by readCacheFile(). Returns true on success and false on
+    // failure.
+    bool load(const QByteArray& data);
 
     // This method saves all METAR/TAFs that are valid and not yet expired to a
     // file "weather.dat" in QStandardPaths::AppDataLocation.  There is locking
@@ -255,20 +352,91 @@ private:
     // List of replies from aviationweather.com
     QList<QPointer<QNetworkReply>> _networkReplies;
 
+    // Validators of the last successful reply, for each data source ("metars"
+    // or "tafs"). If the next request goes to the same URL, it is sent as a
+    // conditional request and the server can answer "304 Not Modified"
+    // without sending any data.
+    struct CacheValidator {
+        QUrl url;
+        QByteArray eTag;
+        QByteArray lastModified;
+    };
+    QHash<QString, CacheValidator> _cacheValidators;
+
     // A timer used for auto-updating the weather reports every 30 minutes
     QTimer _updateTimer;
 
-    // A timer used for deleting expired weather reports ever 11 minutes
+    // Expiration times of weather reports, kept as a min-heap ordered by
+    // time. Entries can be outdated, for instance if a report has been
+    // replaced by a newer one. deleteExpiredMesages() therefore checks the
+    // station again when an entry is due.
+    struct Expiration {
+        QDateTime time;
+        QString ICAOCode;
+    };
+    std::vector<Expiration> _expirations;
+
+    // A single-shot timer used for deleting expired weather reports, set to
+    // fire at the earliest expiration time
     QTimer _deleteExiredMessagesTimer;
 
+    // A single-shot timer used for write-behind of save()
+    QTimer _saveTimer;
+
+    // A single-shot timer that triggers a background update a few seconds
+    // after the flight route has been modified, so that the weather along the
+    // route is available before departure
+    QTimer _briefingTimer;
+
     // Flag, as set by the update() method
     bool _backgroundUpdate {true};
 
     // List of weather stations, accessible by ICAO code
-    QMap<QString, QPointer<Weather::Station>> _weatherStationsByICAOCode;
+    QMap<QString, Weather::StationRecord> _weatherStationsByICAOCode;
+
+    // Station objects handed out by findWeatherStation(), by ICAO code. The
+    // objects are owned by QML and may be deleted at any time.
+    QHash<QString, QPointer<Weather::Station>> _stationObjects;
+
+    // List model of the weather stations, sorted by distance
+    Weather::StationListModel _stationListModel {this};
 
     // Date and Time of last update
     QDateTime _lastUpdate;
+
+    // Weather stations, sorted by distance to _sortPosition. The list is
+    // computed on demand by sortedWeatherStations() and is valid only if
+    // _sortedWeatherStationsValid is true.
+    const QVector<Weather::StationRecord>& sortedWeatherStations() const;
+    mutable QVector<Weather::StationRecord> _sortedWeatherStations;
+    mutable bool _sortedWeatherStationsValid {false};
+    mutable QGeoCoordinate _sortPosition;
+
+    // Distance that the position must move before the list of weather
+    // stations is sorted again
+    static constexpr double resortDistance_m = 1000.0;
+
+    // Cached values of the properties QNHInfo and sunInfo
+    mutable QString _QNHInfo;
+    mutable bool _QNHInfoValid {false};
+    mutable QString _sunInfo;
+    mutable bool _sunInfoValid {false};
+
+    // Times of sunrise, sunset and sunrise on the next day, as computed for
+    // the given local date and position
+    struct SunEvents {
+        QDate localDate;
+        QGeoCoordinate position;
+        QDateTime sunrise;
+        QDateTime sunset;
+        QDateTime sunriseTomorrow;
+    };
+    mutable SunEvents _sunEvents;
+    static SunEvents computeSunEvents(const QGeoCoordinate& coord, QDateTime localTime);
+
+    // Distance that the position must move before the times of sunrise and
+    // sunset are computed again
+    static constexpr double sunEventsDistance_m = 10000.0;
 };
 
 